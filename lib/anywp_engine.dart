@@ -818,6 +818,28 @@ class AnyWPEngine {
     }
   }
 
+  /// Select the state storage backend
+  ///
+  /// - `'journal'` (default): state.json plus an append-only journal
+  /// - `'mappedHash'`: memory-mapped hash file (state.map); opens without
+  ///   parsing the whole store.
+  ///
+  /// Pending writes are flushed before switching, and the state moves to
+  /// the selected backend (the other backend's files are deleted).
+  ///
+  /// - Returns: true if the backend's store was opened
+  static Future<bool> setStorageBackend(String backend) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('setStorageBackend', {
+        'backend': backend,
+      });
+      return result ?? false;
+    } catch (e) {
+      print('Error setting storage backend: $e');
+      return false;
+    }
+  }
+
   /// 获取插件版本号（例如 `1.2.1`）。
   ///
   /// 当预编译包版本与项目依赖不一致时，可用于提示或诊断。
@@ -12,6 +12,8 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <iterator>
+#include <utility>
 #include <cctype>
 #include <direct.h>
 #include <sys/stat.h>
@@ -20,10 +22,13 @@
 
 // New modular headers
 #include "utils/logger.h"
+#include "utils/log_payload.h"
 #include "utils/resource_tracker.h"
 #include "utils/conflict_detector.h"
 #include "utils/desktop_wallpaper_helper.h"
 #include "utils/state_persistence.h"  // v1.4.1+ Phase B
+#include "utils/json_writer.h"
+#include "webmessage_types.h"     // Generated from sdk/types/webmessage.ts
 #include "utils/safety_macros.h"      // v2.0+ Phase 5.3: Exception handling macros
 #include "utils/error_handler.h"      // v2.1.0+ Refactoring: Unified error handling
 #include "modules/event_dispatcher.h" // v2.1.0+ Refactoring: High-performance event routing
@@ -47,6 +52,24 @@ AnyWPEnginePlugin* AnyWPEnginePlugin::display_change_instance_ = nullptr;
 
 namespace {
 
+// Log components of the hook and message-receive paths
+constexpr const char* kHookLogComponent = "MouseHook";
+constexpr const char* kMessageLogComponent = "WebMessage";
+constexpr const char* kStateLogComponent = "StatePersistence";
+
+// Reusable UTF-16 buffer for the state notification scripts
+WideJsonWriter& ScriptWriter() {
+  thread_local WideJsonWriter writer;
+  writer.Clear();
+  return writer;
+}
+
+std::string HandleToString(HWND hwnd) {
+  std::ostringstream oss;
+  oss << hwnd;
+  return oss.str();
+}
+
 // Validate window handle (lightweight check)
 bool IsValidWindowHandle(HWND hwnd) {
   // Only check if handle is valid, do not check visibility
@@ -265,13 +288,15 @@ AnyWPEnginePlugin::AnyWPEnginePlugin() {
       HWND current = hwnd;
       for (int depth = 0; depth < 5 && current; depth++) {
         if (should_log_chain) {
-          std::cout << "[AnyWP] [HWND Check #" << check_count << "] Depth " << depth << ": current=" << current << std::endl;
+          ANYWP_LOG_DEBUG(kHookLogComponent, "HWND check #" + std::to_string(check_count) +
+                          " depth " + std::to_string(depth) + ": current=" + HandleToString(current));
         }
         
         // Check legacy single-monitor window
         if (webview_host_hwnd_ && current == webview_host_hwnd_) {
           if (should_log_chain) {
-            std::cout << "[AnyWP] [HWND Check] MATCH at depth " << depth << " (legacy window)" << std::endl;
+            ANYWP_LOG_DEBUG(kHookLogComponent, "HWND check: MATCH at depth " + std::to_string(depth) +
+                            " (legacy window)");
           }
           return true;
         }
@@ -283,13 +308,14 @@ AnyWPEnginePlugin::AnyWPEnginePlugin() {
             WallpaperInstance* inst = instance_manager_->GetInstanceForMonitor(mon_idx);
             if (inst && inst->webview_host_hwnd) {
               if (should_log_chain) {
-                std::cout << "[AnyWP] [HWND Check] Monitor " << mon_idx 
-                          << " has HWND: " << inst->webview_host_hwnd 
-                          << " (comparing with " << current << ")" << std::endl;
+                ANYWP_LOG_DEBUG(kHookLogComponent, "HWND check: monitor " + std::to_string(mon_idx) +
+                                " has HWND " + HandleToString(inst->webview_host_hwnd) +
+                                " (comparing with " + HandleToString(current) + ")");
               }
               if (current == inst->webview_host_hwnd) {
                 if (should_log_chain) {
-                  std::cout << "[AnyWP] [HWND Check] *** MATCH at depth " << depth << " (monitor " << mon_idx << ") ***" << std::endl;
+                  ANYWP_LOG_DEBUG(kHookLogComponent, "HWND check: MATCH at depth " + std::to_string(depth) +
+                                  " (monitor " + std::to_string(mon_idx) + ")");
                 }
                 return true;
               }
@@ -300,13 +326,13 @@ AnyWPEnginePlugin::AnyWPEnginePlugin() {
         // Move up to parent window
         HWND parent = GetParent(current);
         if (should_log_chain && parent) {
-          std::cout << "[AnyWP] [HWND Check] Moving to parent: " << parent << std::endl;
+          ANYWP_LOG_DEBUG(kHookLogComponent, "HWND check: moving to parent " + HandleToString(parent));
         }
         current = parent;
       }
       
       if (should_log_chain) {
-        std::cout << "[AnyWP] [HWND Check] NO MATCH" << std::endl;
+        ANYWP_LOG_DEBUG(kHookLogComponent, "HWND check: NO MATCH");
       }
       return false;
     });
@@ -330,37 +356,7 @@ AnyWPEnginePlugin::AnyWPEnginePlugin() {
     sdk_bridge_ = std::make_unique<anywp_engine::SDKBridge>();
     
     // v1.4.1+ Phase D: Register message handlers with SDKBridge
-    sdk_bridge_->RegisterHandler("IFRAME_DATA", [this](const std::string& msg) {
-      HandleIframeDataWebMessage(msg);
-    });
-    sdk_bridge_->RegisterHandler("OPEN_URL", [this](const std::string& msg) {
-      HandleOpenUrlWebMessage(msg);
-    });
-    sdk_bridge_->RegisterHandler("openURL", [this](const std::string& msg) {
-      HandleOpenUrlWebMessage(msg);
-    });
-    sdk_bridge_->RegisterHandler("READY", [this](const std::string& msg) {
-      HandleReadyWebMessage(msg);
-    });
-    sdk_bridge_->RegisterHandler("ready", [this](const std::string& msg) {
-      HandleReadyWebMessage(msg);
-    });
-    sdk_bridge_->RegisterHandler("LOG", [this](const std::string& msg) {
-      HandleLogWebMessage(msg);
-    });
-    sdk_bridge_->RegisterHandler("console_log", [this](const std::string& msg) {
-      HandleConsoleLogWebMessage(msg);
-    });
-    sdk_bridge_->RegisterHandler("saveState", [this](const std::string& msg) {
-      HandleSaveStateWebMessage(msg);
-    });
-    sdk_bridge_->RegisterHandler("loadState", [this](const std::string& msg) {
-      HandleLoadStateWebMessage(msg);
-    });
-    sdk_bridge_->RegisterHandler("clearState", [this](const std::string& msg) {
-      HandleClearStateWebMessage(msg);
-    });
-    Logger::Instance().Info("Refactor", "Registered 9 message handlers with SDKBridge");
+    RegisterWebMessageHandlers();
     
     // v2.1.0+ Bidirectional Communication: Set Flutter callback for message forwarding
     sdk_bridge_->SetFlutterCallback([this](const std::string& message) {
@@ -562,6 +558,11 @@ AnyWPEnginePlugin::~AnyWPEnginePlugin() {
     }
   }
   
+  // Write-behind saves: nothing can queue more once the SDK bridge is gone
+  if (state_persistence_ && !state_persistence_->Flush()) {
+    Logger::Instance().Warning("StatePersistence", "Failed to flush pending state on shutdown");
+  }
+  
   // v1.4.0+ Note: Display/Power/Mouse cleanup delegated to modules above
   // Old cleanup methods removed to avoid double-cleanup errors
   
@@ -573,6 +574,9 @@ AnyWPEnginePlugin::~AnyWPEnginePlugin() {
   
   display_change_instance_ = nullptr;
   
+  // Write out anything still queued by the async logger
+  Logger::Instance().Flush();
+  
   std::cout << "[AnyWP] Plugin cleanup complete" << std::endl;
 }
 
@@ -1034,11 +1038,12 @@ void AnyWPEnginePlugin::SetupMessageBridge(ICoreWebView2* webview) {
   ICoreWebView2* target_webview = webview ? webview : webview_.Get();
   if (!target_webview) return;
   
-  std::cout << "[AnyWP] [API] Setting up message bridge..." << std::endl;
+  ANYWP_LOG_INFO(kMessageLogComponent, "Setting up message bridge...");
   
   target_webview->add_WebMessageReceived(
     Microsoft::WRL::Callback<ICoreWebView2WebMessageReceivedEventHandler>(
       [this](ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args) -> HRESULT {
+        ANYWP_HOT_PATH();
         LPWSTR message;
         args->get_WebMessageAsJson(&message);
         
@@ -1049,26 +1054,22 @@ void AnyWPEnginePlugin::SetupMessageBridge(ICoreWebView2* webview) {
         std::string msg(size_needed - 1, 0);
         WideCharToMultiByte(CP_UTF8, 0, wmessage.c_str(), -1, &msg[0], size_needed, nullptr, nullptr);
         
-        // Check if this is a pause/resume result message
-        if (msg.find("\"type\":\"pauseResult\"") != std::string::npos || 
-            msg.find("\"type\":\"resumeResult\"") != std::string::npos) {
-          std::cout << "[AnyWP] [Script Result] " << msg << std::endl;
-        }
-        
         HandleWebMessage(msg);
         
         CoTaskMemFree(message);
         return S_OK;
       }).Get(), nullptr);
   
-  std::cout << "[AnyWP] [API] Message bridge ready" << std::endl;
+  ANYWP_LOG_INFO(kMessageLogComponent, "Message bridge ready");
 }
 
 // API Bridge: Handle messages from web
 // Phase B Refactoring: Simplified dispatcher delegates to specialized handlers
-// v1.4.1+ Phase D: Delegate message handling to SDKBridge
+// v1.4.1+ Phase D: Delegate message handling to SDKBridge, the single
+// dispatch point (MessageRouter slots, see RegisterWebMessageHandlers)
 void AnyWPEnginePlugin::HandleWebMessage(const std::string& message) {
-  std::cout << "[AnyWP] [API] Received message: " << message << std::endl;
+  ANYWP_HOT_PATH();
+  ANYWP_LOG_DEBUG(kMessageLogComponent, "Received message: " + LogPayload(message));
   
   if (sdk_bridge_) {
     sdk_bridge_->HandleMessage(message);
@@ -1080,6 +1081,29 @@ void AnyWPEnginePlugin::HandleWebMessage(const std::string& message) {
   }
 }
 
+// v1.4.1+ Phase D: One handler per SDKBridge slot; a slot covers every
+// spelling of its type (openURL / OPEN_URL)
+void AnyWPEnginePlugin::RegisterWebMessageHandlers() {
+  using Handler = void (AnyWPEnginePlugin::*)(const std::string&);
+  const std::pair<MessageSlot, Handler> handlers[] = {
+    {MessageSlot::IFRAME_DATA, &AnyWPEnginePlugin::HandleIframeDataWebMessage},
+    {MessageSlot::OPEN_URL, &AnyWPEnginePlugin::HandleOpenUrlWebMessage},
+    {MessageSlot::READY, &AnyWPEnginePlugin::HandleReadyWebMessage},
+    {MessageSlot::LOG, &AnyWPEnginePlugin::HandleLogWebMessage},
+    {MessageSlot::CONSOLE_LOG, &AnyWPEnginePlugin::HandleConsoleLogWebMessage},
+    {MessageSlot::SAVE_STATE, &AnyWPEnginePlugin::HandleSaveStateWebMessage},
+    {MessageSlot::LOAD_STATE, &AnyWPEnginePlugin::HandleLoadStateWebMessage},
+    {MessageSlot::CLEAR_STATE, &AnyWPEnginePlugin::HandleClearStateWebMessage},
+  };
+  for (const auto& [slot, handler] : handlers) {
+    sdk_bridge_->SetHandler(slot, [this, handler = handler](const std::string& msg) {
+      (this->*handler)(msg);
+    });
+  }
+  Logger::Instance().Info("Refactor", "Registered " + std::to_string(std::size(handlers)) +
+                          " message handlers with SDKBridge");
+}
+
 // Phase B: Handle IFRAME_DATA messages
 void AnyWPEnginePlugin::HandleIframeDataWebMessage(const std::string& message) {
   // Find the correct instance for this message
@@ -1088,7 +1112,7 @@ void AnyWPEnginePlugin::HandleIframeDataWebMessage(const std::string& message) {
   // Use first instance for now (TODO: improve for multi-monitor)
   if (!wallpaper_instances_.empty()) {
     target_instance = &wallpaper_instances_[0];
-    std::cout << "[AnyWP] [API] Using wallpaper instance for iframe data" << std::endl;
+    ANYWP_LOG_DEBUG(kMessageLogComponent, "Using wallpaper instance for iframe data");
   }
   
   HandleIframeDataMessage(message, target_instance);
@@ -1096,12 +1120,10 @@ void AnyWPEnginePlugin::HandleIframeDataWebMessage(const std::string& message) {
 
 // Phase B: Handle OPEN_URL messages
 void AnyWPEnginePlugin::HandleOpenUrlWebMessage(const std::string& message) {
-  // Extract URL from JSON
-  size_t url_start = message.find("\"url\":\"") + 7;
-  size_t url_end = message.find("\"", url_start);
-  if (url_start != std::string::npos && url_end != std::string::npos) {
-    std::string url = message.substr(url_start, url_end - url_start);
-    std::cout << "[AnyWP] [API] Opening URL: " << url << std::endl;
+  webmessage::OpenUrlMessage open_url;
+  if (webmessage::Decode(message, open_url)) {
+    const std::string& url = open_url.url;
+    ANYWP_LOG_INFO(kMessageLogComponent, "Opening URL: " + LogPayload(url));
     
     // Open URL using ShellExecute
     std::wstring wurl(url.begin(), url.end());
@@ -1111,86 +1133,81 @@ void AnyWPEnginePlugin::HandleOpenUrlWebMessage(const std::string& message) {
 
 // Phase B: Handle READY messages
 void AnyWPEnginePlugin::HandleReadyWebMessage(const std::string& message) {
-  // Extract name
-  size_t name_start = message.find("\"name\":\"") + 8;
-  size_t name_end = message.find("\"", name_start);
-  if (name_start != std::string::npos && name_end != std::string::npos) {
-    std::string name = message.substr(name_start, name_end - name_start);
-    std::cout << "[AnyWP] [API] Wallpaper ready: " << name << std::endl;
+  webmessage::ReadyMessage ready;
+  if (webmessage::Decode(message, ready) && ready.name) {
+    ANYWP_LOG_INFO(kMessageLogComponent, "Wallpaper ready: " + LogPayload(*ready.name));
   }
 }
 
 // Phase B: Handle LOG messages
 void AnyWPEnginePlugin::HandleLogWebMessage(const std::string& message) {
-  // Extract log message
-  size_t msg_start = message.find("\"message\":\"") + 11;
-  size_t msg_end = message.find("\"", msg_start);
-  if (msg_start != std::string::npos && msg_end != std::string::npos) {
-    std::string log_msg = message.substr(msg_start, msg_end - msg_start);
-    std::cout << "[AnyWP] [WebLog] " << log_msg << std::endl;
+  webmessage::LogMessage log;
+  if (webmessage::Decode(message, log)) {
+    ANYWP_LOG_INFO("WebLog", LogPayload(log.message));
   }
 }
 
 // Phase B: Handle console_log messages
 void AnyWPEnginePlugin::HandleConsoleLogWebMessage(const std::string& message) {
   // Enhanced console.log forwarding with level support
-  size_t msg_start = message.find("\"message\":\"") + 11;
-  size_t msg_end = message.rfind("\"");
-  
-  if (msg_start != std::string::npos && msg_end != std::string::npos && msg_end > msg_start) {
-    std::string log_msg = message.substr(msg_start, msg_end - msg_start);
-    bool is_error = message.find("\"level\":\"error\"") != std::string::npos;
-    bool is_warn = message.find("\"level\":\"warn\"") != std::string::npos;
+  webmessage::ConsoleLogMessage log;
+  if (webmessage::Decode(message, log)) {
+    std::string_view level = log.level ? std::string_view(*log.level) : std::string_view();
+    bool is_error = level == "error";
+    bool is_warn = level == "warn";
     
     if (is_error) {
-      std::cout << "[JS-ERROR] " << log_msg << std::endl;
+      ANYWP_LOG_ERROR("JS", LogPayload(log.message));
     } else if (is_warn) {
-      std::cout << "[JS-WARN] " << log_msg << std::endl;
+      ANYWP_LOG_WARNING("JS", LogPayload(log.message));
     } else {
-      std::cout << "[JS-LOG] " << log_msg << std::endl;
+      ANYWP_LOG_INFO("JS", LogPayload(log.message));
     }
   }
 }
 
 // Phase B: Handle saveState messages
 void AnyWPEnginePlugin::HandleSaveStateWebMessage(const std::string& message) {
-  // Extract key and value from JSON
-  size_t key_start = message.find("\"key\":\"") + 7;
-  size_t key_end = message.find("\"", key_start);
-  size_t value_start = message.find("\"value\":\"") + 9;
-  // Find the closing brace, then work backwards to find last quote
-  size_t end_brace = message.rfind("}");
-  size_t value_end = message.rfind("\"", end_brace);
-  
-  if (key_start != std::string::npos && key_end != std::string::npos &&
-      value_start != std::string::npos && value_end != std::string::npos && value_end > value_start) {
-    std::string key = message.substr(key_start, key_end - key_start);
-    std::string value = message.substr(value_start, value_end - value_start);
-    
-    bool success = SaveState(key, value);
-    std::cout << "[AnyWP] [State] Saved via WebMessage: " << key << " = " << value << std::endl;
+  // value is the page's JSON.stringify() output, stored decoded: loadState
+  // hands back exactly what was saved (StatePersistence upgrades stores
+  // that still hold escaped bodies once, on open)
+  webmessage::SaveStateMessage save;
+  if (webmessage::Decode(message, save)) {
+    const std::string& key = save.key;
+    const std::string& value = save.value;
+    StatePersistence::Durability durability = StatePersistence::Durability::ASYNC;
+    if (save.durability == webmessage::SaveStateMessageDurability::SYNC) {
+      durability = StatePersistence::Durability::SYNC;
+    } else if (save.durability == webmessage::SaveStateMessageDurability::MEMORY) {
+      durability = StatePersistence::Durability::MEMORY;
+    }
+    bool success = SaveState(key, value, durability);
+    // Values can be large or private: log only their size and fingerprint
+    ANYWP_LOG_DEBUG(kStateLogComponent, "Saved via WebMessage: " + LogPayload(key, 64) +
+                    " = " + LogDigest(value) + (success ? "" : " (FAILED)"));
     
     // Send success notification back to ALL webviews
-    std::ostringstream js;
-    js << "window.dispatchEvent(new CustomEvent('AnyWP:stateSaved', {"
-       << "detail: {type: 'stateSaved', key: '" << key << "', success: " << (success ? "true" : "false") << "}"
-       << "}));";
-    
-    std::string js_code = js.str();
-    std::wstring wjs_code(js_code.begin(), js_code.end());
+    WideJsonWriter& js = ScriptWriter();
+    js.Raw("window.dispatchEvent(new CustomEvent('AnyWP:stateSaved', {detail: ")
+        .BeginObject()
+        .Key("type").String("stateSaved")
+        .Key("key").String(key)
+        .Key("success").Bool(success)
+        .EndObject()
+        .Raw("}));");
     
     // Send to legacy webview if exists
     if (webview_) {
-      webview_->ExecuteScript(wjs_code.c_str(), nullptr);
+      webview_->ExecuteScript(js.CStr(), nullptr);
     }
     
     // Send to all multi-monitor instances
     for (auto& instance : wallpaper_instances_) {
       if (instance.webview) {
-        instance.webview->ExecuteScript(wjs_code.c_str(), nullptr);
+        instance.webview->ExecuteScript(js.CStr(), nullptr);
       }
     }
-    std::cout << "[AnyWP] [State] Sent stateSaved event to all instances" << std::endl;
+    ANYWP_LOG_DEBUG(kStateLogComponent, "Sent stateSaved event to all instances");
   } else {
     LOG_AND_REPORT_ERROR("StatePersistence", "HandleSaveStateWebMessage", 
       "Failed to parse saveState message",
@@ -1201,67 +1218,67 @@ void AnyWPEnginePlugin::HandleSaveStateWebMessage(const std::string& message) {
 
 // Phase B: Handle loadState messages
 void AnyWPEnginePlugin::HandleLoadStateWebMessage(const std::string& message) {
-  // Extract key
-  size_t key_start = message.find("\"key\":\"") + 7;
-  size_t key_end = message.find("\"", key_start);
-  
-  if (key_start != std::string::npos && key_end != std::string::npos) {
-    std::string key = message.substr(key_start, key_end - key_start);
+  webmessage::LoadStateMessage load;
+  if (webmessage::Decode(message, load)) {
+    const std::string& key = load.key;
     std::string value = LoadState(key);
     
-    std::cout << "[AnyWP] [State] Loaded via WebMessage: " << key << " = " << value << std::endl;
+    ANYWP_LOG_DEBUG(kStateLogComponent, "Loaded via WebMessage: " + LogPayload(key, 64) +
+                    " = " + LogDigest(value));
     
     // Send result back to ALL webviews (to ensure it reaches the right one)
-    std::ostringstream js;
-    js << "window.dispatchEvent(new CustomEvent('AnyWP:stateLoaded', {"
-       << "detail: {type: 'stateLoaded', key: '" << key << "', value: '" << value << "'}"
-       << "}));";
-    
-    std::string js_code = js.str();
-    std::wstring wjs_code(js_code.begin(), js_code.end());
+    WideJsonWriter& js = ScriptWriter();
+    js.Raw("window.dispatchEvent(new CustomEvent('AnyWP:stateLoaded', {detail: ")
+        .BeginObject()
+        .Key("type").String("stateLoaded")
+        .Key("key").String(key)
+        .Key("value").String(value)
+        .EndObject()
+        .Raw("}));");
     
     // Send to legacy webview if exists
     if (webview_) {
-      webview_->ExecuteScript(wjs_code.c_str(), nullptr);
-      std::cout << "[AnyWP] [State] Sent stateLoaded event to legacy webview" << std::endl;
+      webview_->ExecuteScript(js.CStr(), nullptr);
+      ANYWP_LOG_DEBUG(kStateLogComponent, "Sent stateLoaded event to legacy webview");
     }
     
     // Send to all multi-monitor instances
     for (auto& instance : wallpaper_instances_) {
       if (instance.webview) {
-        instance.webview->ExecuteScript(wjs_code.c_str(), nullptr);
+        instance.webview->ExecuteScript(js.CStr(), nullptr);
       }
     }
-    std::cout << "[AnyWP] [State] Sent stateLoaded event to all instances" << std::endl;
+    ANYWP_LOG_DEBUG(kStateLogComponent, "Sent stateLoaded event to all instances");
   }
 }
 
 // Phase B: Handle clearState messages
 void AnyWPEnginePlugin::HandleClearStateWebMessage(const std::string& message) {
   bool success = ClearState();
-  std::cout << "[AnyWP] [State] Cleared all state via WebMessage" << std::endl;
+  ANYWP_LOG_INFO(kStateLogComponent, std::string("Cleared all state via WebMessage") +
+                 (success ? "" : " (FAILED)"));
   
   // Send success notification back to ALL webviews
-  std::ostringstream js;
-  js << "window.dispatchEvent(new CustomEvent('AnyWP:stateCleared', {"
-     << "detail: {type: 'stateCleared', success: " << (success ? "true" : "false") << "}"
-     << "}));";
-  
-  std::string js_code = js.str();
-  std::wstring wjs_code(js_code.begin(), js_code.end());
+  WideJsonWriter& js = ScriptWriter();
+  js.Raw("window.dispatchEvent(new CustomEvent('AnyWP:stateCleared', {detail: ")
+      .BeginObject()
+      .Key("type").String("stateCleared")
+      .Key("success").Bool(success)
+      .EndObject()
+      .Raw("}));");
   
   // Send to legacy webview if exists
   if (webview_) {
-    webview_->ExecuteScript(wjs_code.c_str(), nullptr);
+    webview_->ExecuteScript(js.CStr(), nullptr);
   }
   
   // Send to all multi-monitor instances
   for (auto& instance : wallpaper_instances_) {
     if (instance.webview) {
-      instance.webview->ExecuteScript(wjs_code.c_str(), nullptr);
+      instance.webview->ExecuteScript(js.CStr(), nullptr);
     }
   }
-  std::cout << "[AnyWP] [State] Sent stateCleared event to all instances" << std::endl;
+  ANYWP_LOG_DEBUG(kStateLogComponent, "Sent stateCleared event to all instances");
 }
 
 // ========== State Persistence Helper Functions ==========
@@ -1273,7 +1290,8 @@ void AnyWPEnginePlugin::HandleClearStateWebMessage(const std::string& message) {
 // ========== State Persistence Functions ==========
 
 // State persistence: Save state
-bool AnyWPEnginePlugin::SaveState(const std::string& key, const std::string& value) {
+bool AnyWPEnginePlugin::SaveState(const std::string& key, const std::string& value,
+                                  StatePersistence::Durability durability) {
   // v2.0.1+ Refactoring: Delegate to StatePersistence module
   if (!state_persistence_) {
     LOG_AND_REPORT_ERROR("StatePersistence", "SaveState", 
@@ -1284,7 +1302,7 @@ bool AnyWPEnginePlugin::SaveState(const std::string& key, const std::string& val
   }
   
   try {
-    return state_persistence_->SaveState(key, value);
+    return state_persistence_->SaveState(key, value, durability);
   } catch (const std::exception& e) {
     LOG_AND_REPORT_ERROR_EX("StatePersistence", "SaveState", 
       "Failed to save state",
@@ -2534,6 +2552,11 @@ LRESULT CALLBACK AnyWPEnginePlugin::PowerSavingWndProc(HWND hwnd, UINT message,
           if (display_change_instance_->power_manager_) {
             display_change_instance_->power_manager_->SetSessionLocked(true);
           }
+          // A locked session may be logged off or powered down: get
+          // write-behind saves onto disk now
+          if (display_change_instance_->state_persistence_) {
+            display_change_instance_->state_persistence_->Flush();
+          }
           break;
         case WTS_SESSION_UNLOCK:
           Logger::Instance().Info("PowerSaving", "Event: System UNLOCKED");
@@ -2645,6 +2668,10 @@ LRESULT CALLBACK AnyWPEnginePlugin::PowerSavingWndProc(HWND hwnd, UINT message,
         case PBT_APMSUSPEND:
           std::cout << "[AnyWP] [PowerSaving] System SUSPENDING" << std::endl;
           display_change_instance_->PauseWallpaper("SUSPEND");
+          // Power may not come back: get write-behind saves onto disk now
+          if (display_change_instance_->state_persistence_) {
+            display_change_instance_->state_persistence_->Flush();
+          }
           break;
         case PBT_APMRESUMEAUTOMATIC:
         case PBT_APMRESUMESUSPEND:
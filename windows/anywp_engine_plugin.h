@@ -20,6 +20,7 @@
 
 // Forward declarations of modular classes
 #include "utils/url_validator.h"
+#include "utils/state_persistence.h"
 #include "modules/power_manager.h"  // v1.4.0+ Refactoring: PowerManager module
 #include "modules/monitor_manager.h"  // v1.4.0+ Refactoring: MonitorManager module
 #include "modules/mouse_hook_manager.h"  // v1.4.0+ Refactoring: MouseHookManager module
@@ -141,7 +142,8 @@ class AnyWPEnginePlugin : public flutter::Plugin {
   void SetupSecurityHandlers(ICoreWebView2* webview = nullptr);
   
   // State persistence: Save/load wallpaper state
-  bool SaveState(const std::string& key, const std::string& value);
+  bool SaveState(const std::string& key, const std::string& value,
+                 StatePersistence::Durability durability = StatePersistence::Durability::ASYNC);
   std::string LoadState(const std::string& key);
   bool ClearState();
   void SetApplicationName(const std::string& name);  // Set app identifier for storage isolation
@@ -158,7 +160,9 @@ class AnyWPEnginePlugin : public flutter::Plugin {
   void HandleWebMessage(const std::string& message);
   std::string LoadSDKScript();
   
-  // HandleWebMessage helper methods (Phase B refactoring)
+  // HandleWebMessage helper methods (Phase B refactoring), installed in
+  // SDKBridge's handler slots by RegisterWebMessageHandlers()
+  void RegisterWebMessageHandlers();
   void HandleIframeDataWebMessage(const std::string& message);
   void HandleOpenUrlWebMessage(const std::string& message);
   void HandleReadyWebMessage(const std::string& message);
@@ -1,6 +1,8 @@
 #include "event_dispatcher.h"
 #include "../anywp_engine_plugin.h"
 #include "../utils/logger.h"
+#include "../utils/json_writer.h"
+#include "webmessage_types.h"  // Generated from sdk/types/webmessage.ts
 #include <iostream>
 #include <sstream>
 
@@ -181,19 +183,26 @@ void EventDispatcher::DispatchEventInternal(const MouseEvent& event) {
     return;
   }
   
-  // Build JSON message
-  std::wstringstream json;
-  json << L"{"
-       << L"\"type\":\"mouseEvent\","
-       << L"\"eventType\":\"" << std::wstring(event.event_type, event.event_type + strlen(event.event_type)) << L"\","
-       << L"\"x\":" << event.x << L","
-       << L"\"y\":" << event.y << L","
-       << L"\"button\":0"
-       << L"}";
+  // MouseEventData as the SDK declares it (sdk/types/webmessage.ts)
+  webmessage::MouseEventData data;
+  if (!webmessage::FromString(event.event_type, data.event_type)) {
+    Logger::Instance().Error("EventDispatcher",
+      std::string("Event type not in the SDK schema: ") + event.event_type);
+    return;
+  }
+  data.x = event.x;
+  data.y = event.y;
+  data.button = 0;
+  
+  // Build JSON message: one reused UTF-16 buffer per thread, so a mousemove
+  // stream does not allocate
+  thread_local WideJsonWriter json;
+  json.Clear();
+  webmessage::Encode(data, json);
   
   // Send via WebMessage
   try {
-    HRESULT hr = target_webview->PostWebMessageAsJson(json.str().c_str());
+    HRESULT hr = target_webview->PostWebMessageAsJson(json.CStr());
     
     if (FAILED(hr)) {
       // Only log errors for non-mousemove events
@@ -225,16 +234,17 @@ void EventDispatcher::LogEvent(const MouseEvent& event) {
     return;  // Throttled
   }
   
-  // Log event
-  std::ostringstream oss;
-  oss << "Event #" << count << ": " << event.event_type
-      << " at (" << event.x << "," << event.y << ")"
-      << " target=" << (event.target_instance ? "found" : "none");
+  // Log event (message is only built when the call site is enabled)
+  auto describe = [&event, count]() {
+    return "Event #" + std::to_string(count) + ": " + event.event_type +
+           " at (" + std::to_string(event.x) + "," + std::to_string(event.y) + ")" +
+           " target=" + (event.target_instance ? "found" : "none");
+  };
   
   if (is_mousemove) {
-    Logger::Instance().Debug("EventDispatcher", oss.str());
+    ANYWP_LOG_DEBUG("EventDispatcher", describe());
   } else {
-    Logger::Instance().Info("EventDispatcher", oss.str());
+    ANYWP_LOG_INFO("EventDispatcher", describe());
   }
 }
 
@@ -2,6 +2,7 @@
 #include "../anywp_engine_plugin.h"
 #include "../utils/logger.h"
 #include "../utils/input_validator.h"
+#include "../utils/json_writer.h"
 #include <iostream>
 
 namespace anywp_engine {
@@ -110,6 +111,8 @@ void FlutterBridge::RegisterAllHandlers() {
       [this](auto* args, auto result) { HandleSetApplicationName(args, std::move(result)); });
   RegisterHandler("getStoragePath",
       [this](auto* args, auto result) { HandleGetStoragePath(args, std::move(result)); });
+  RegisterHandler("setStorageBackend",
+      [this](auto* args, auto result) { HandleSetStorageBackend(args, std::move(result)); });
 
   // Utility
   RegisterHandler("getVersion",
@@ -501,6 +504,22 @@ void FlutterBridge::HandleGetConfiguration(
   }
   config_map[flutter::EncodableValue("powerState")] = flutter::EncodableValue(state_str);
   
+  if (plugin_->state_persistence_) {
+    StateCache::Stats cache = plugin_->state_persistence_->GetCacheStats();
+    flutter::EncodableMap cache_map;
+    cache_map[flutter::EncodableValue("hits")] = flutter::EncodableValue(static_cast<int64_t>(cache.hits));
+    cache_map[flutter::EncodableValue("misses")] = flutter::EncodableValue(static_cast<int64_t>(cache.misses));
+    cache_map[flutter::EncodableValue("evictions")] = flutter::EncodableValue(static_cast<int64_t>(cache.evictions));
+    cache_map[flutter::EncodableValue("expirations")] = flutter::EncodableValue(static_cast<int64_t>(cache.expirations));
+    cache_map[flutter::EncodableValue("entries")] = flutter::EncodableValue(static_cast<int64_t>(cache.entries));
+    cache_map[flutter::EncodableValue("bytes")] = flutter::EncodableValue(static_cast<int64_t>(cache.bytes));
+    cache_map[flutter::EncodableValue("maxBytes")] = flutter::EncodableValue(static_cast<int64_t>(cache.max_bytes));
+    config_map[flutter::EncodableValue("stateCache")] = flutter::EncodableValue(cache_map);
+    bool mapped = plugin_->state_persistence_->GetBackend() == StatePersistence::Backend::MAPPED_HASH;
+    config_map[flutter::EncodableValue("storageBackend")] =
+        flutter::EncodableValue(std::string(mapped ? "mappedHash" : "journal"));
+  }
+  
   result->Success(flutter::EncodableValue(config_map));
 }
 
@@ -601,6 +620,38 @@ void FlutterBridge::HandleGetStoragePath(
   result->Success(flutter::EncodableValue(path));
 }
 
+void FlutterBridge::HandleSetStorageBackend(
+    const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  
+  if (!args) {
+    result->Error("INVALID_ARGS", "Arguments must be a map");
+    return;
+  }
+
+  std::string backend;
+  if (!GetStringArgument(args, "backend", backend, result)) {
+    return;
+  }
+
+  StatePersistence::Backend selected;
+  if (backend == "journal") {
+    selected = StatePersistence::Backend::JOURNAL;
+  } else if (backend == "mappedHash") {
+    selected = StatePersistence::Backend::MAPPED_HASH;
+  } else {
+    result->Error("INVALID_BACKEND", "Storage backend must be 'journal' or 'mappedHash'");
+    return;
+  }
+
+  if (!plugin_->state_persistence_) {
+    result->Error("NOT_INITIALIZED", "State persistence is not available");
+    return;
+  }
+  bool success = plugin_->state_persistence_->SetBackend(selected);
+  result->Success(flutter::EncodableValue(success));
+}
+
 // ========================================
 // Utility Handlers
 // ========================================
@@ -676,6 +727,26 @@ void FlutterBridge::HandleSendMessage(
   }
 
   // Step 4: Send message to JavaScript
+  // Build the script once for every instance: the message goes in as an
+  // escaped JS string literal (UTF-16, ready for ExecuteScript) and the page
+  // JSON.parse()s it
+  WideJsonWriter script;
+  script.Raw("(function() {\n"
+             "  const messageStr = ").String(message_json).Raw(";\n"
+             "  try {\n"
+             "    const message = JSON.parse(messageStr);\n"
+             "    const event = new CustomEvent('AnyWP:message', {\n"
+             "      detail: message,\n"
+             "      bubbles: true\n"
+             "    });\n"
+             "    window.dispatchEvent(event);\n"
+             "    console.log('[AnyWP Engine] Message dispatched:', message);\n"
+             "  } catch(e) {\n"
+             "    console.error('[AnyWP Engine] Failed to dispatch message:', e);\n"
+             "    console.error('[AnyWP Engine] Message string:', messageStr);\n"
+             "  }\n"
+             "})();\n");
+
   bool all_success = true;
   int sent_count = 0;
 
@@ -685,57 +756,9 @@ void FlutterBridge::HandleSendMessage(
       continue;
     }
 
-    // Build JavaScript code: trigger CustomEvent
-    // Use JSON.parse() to safely parse the message string
-    // First, escape special characters in the JSON string
-    std::string escaped_json;
-    escaped_json.reserve(message_json.length() * 2);
-    for (char c : message_json) {
-      switch (c) {
-        case '\\': escaped_json += "\\\\"; break;
-        case '\"': escaped_json += "\\\""; break;
-        case '\n': escaped_json += "\\n"; break;
-        case '\r': escaped_json += "\\r"; break;
-        case '\t': escaped_json += "\\t"; break;
-        default: escaped_json += c; break;
-      }
-    }
-    
-    // Convert escaped UTF-8 string to wide string
-    int wide_size = MultiByteToWideChar(CP_UTF8, 0, escaped_json.c_str(), -1, nullptr, 0);
-    if (wide_size == 0) {
-      Logger::Instance().Error("FlutterBridge", "Failed to convert message to wide string");
-      all_success = false;
-      continue;
-    }
-    
-    std::wstring message_wide(wide_size - 1, 0);
-    int result_size = MultiByteToWideChar(CP_UTF8, 0, escaped_json.c_str(), -1, &message_wide[0], wide_size);
-    if (result_size == 0) {
-      Logger::Instance().Error("FlutterBridge", "Failed to convert message to wide string (step 2)");
-      all_success = false;
-      continue;
-    }
-    
-    std::wstring script = L"(function() {\n"
-                          L"  try {\n"
-                          L"    const messageStr = \"" + message_wide + L"\";\n"
-                          L"    const message = JSON.parse(messageStr);\n"
-                          L"    const event = new CustomEvent('AnyWP:message', {\n"
-                          L"      detail: message,\n"
-                          L"      bubbles: true\n"
-                          L"    });\n"
-                          L"    window.dispatchEvent(event);\n"
-                          L"    console.log('[AnyWP Engine] Message dispatched:', message);\n"
-                          L"  } catch(e) {\n"
-                          L"    console.error('[AnyWP Engine] Failed to dispatch message:', e);\n"
-                          L"    console.error('[AnyWP Engine] Message string:', \"" + message_wide + L"\");\n"
-                          L"  }\n"
-                          L"})();\n";
-
     // Execute script
     HRESULT hr = instance->webview->ExecuteScript(
-        script.c_str(),
+        script.CStr(),
         Microsoft::WRL::Callback<ICoreWebView2ExecuteScriptCompletedHandler>(
             [](HRESULT error_code, LPCWSTR result_object_as_json) -> HRESULT {
               if (FAILED(error_code)) {
@@ -151,6 +151,10 @@ private:
   void HandleGetStoragePath(
       const flutter::EncodableMap* args,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  
+  void HandleSetStorageBackend(
+      const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
   // ========================================
   // Utility Methods
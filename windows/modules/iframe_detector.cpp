@@ -1,12 +1,134 @@
 #include "iframe_detector.h"
 #include "../utils/logger.h"
+#include "../utils/log_payload.h"
+#include "../utils/json_reader.h"
 
-#include <iostream>
-#include <sstream>
+#include <cmath>
 
 namespace anywp_engine {
 
+namespace {
+
+constexpr const char* kLogComponent = "IframeDetector";
+
+// Hit-testing runs for every click; keep its DEBUG trace bounded
+constexpr double kDebugLinesPerSecond = 50.0;
+constexpr size_t kDebugBurst = 100;
+
+// Bounds come from getBoundingClientRect() and may be fractional; the
+// SDK rounds them, so anything outside int range is garbage and reads as 0
+int ReadCoordinate(const JsonReader& reader) {
+  double value = 0;
+  if (!reader.GetDouble(value) || !(value > -2147483648.0 && value < 2147483647.0)) {
+    return 0;
+  }
+  return static_cast<int>(std::lround(value));
+}
+
+// "bounds": {"left", "top", "width", "height"}; the reader is on BEGIN_OBJECT
+bool ParseBounds(JsonReader& reader, IframeInfo& iframe) {
+  while (reader.Next() == JsonReader::Token::KEY) {
+    int* field = nullptr;
+    if (reader.TextEquals("left")) field = &iframe.left;
+    else if (reader.TextEquals("top")) field = &iframe.top;
+    else if (reader.TextEquals("width")) field = &iframe.width;
+    else if (reader.TextEquals("height")) field = &iframe.height;
+
+    JsonReader::Token token = reader.Next();
+    if (field && token == JsonReader::Token::NUMBER) {
+      *field = ReadCoordinate(reader);
+    } else if (!reader.SkipValue()) {
+      return false;
+    }
+  }
+  return reader.Current() == JsonReader::Token::END_OBJECT;
+}
+
+// One element of "iframes"; the reader is on its BEGIN_OBJECT
+bool ParseIframe(JsonReader& reader, IframeInfo& iframe) {
+  iframe.visible = true;  // Default to visible
+  while (reader.Next() == JsonReader::Token::KEY) {
+    std::string* text = nullptr;
+    bool bounds = false;
+    bool visible = false;
+    if (reader.TextEquals("id")) text = &iframe.id;
+    else if (reader.TextEquals("src")) text = &iframe.src;
+    else if (reader.TextEquals("clickUrl")) text = &iframe.click_url;
+    else if (reader.TextEquals("bounds")) bounds = true;
+    else if (reader.TextEquals("visible")) visible = true;
+
+    JsonReader::Token token = reader.Next();
+    bool ok = true;
+    if (text && token == JsonReader::Token::STRING) {
+      ok = reader.GetString(*text);
+    } else if (bounds && token == JsonReader::Token::BEGIN_OBJECT) {
+      ok = ParseBounds(reader, iframe);
+    } else if (visible && (token == JsonReader::Token::TRUE_VALUE ||
+                           token == JsonReader::Token::FALSE_VALUE)) {
+      iframe.visible = token == JsonReader::Token::TRUE_VALUE;
+    } else {
+      ok = reader.SkipValue();
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return reader.Current() == JsonReader::Token::END_OBJECT;
+}
+
+// {"type":"IFRAME_DATA","iframes":[{...},{...}]}; all or nothing
+bool ParseIframeMessage(const std::string& json_data, std::vector<IframeInfo>& iframes) {
+  iframes.clear();
+  JsonReader reader(json_data);
+  if (reader.Next() != JsonReader::Token::BEGIN_OBJECT) {
+    ANYWP_LOG_WARNING(kLogComponent, "Iframe data is not a JSON object");
+    return false;
+  }
+  bool found = false;
+  while (reader.Next() == JsonReader::Token::KEY) {
+    bool is_iframes = reader.TextEquals("iframes");
+    JsonReader::Token token = reader.Next();
+    if (!is_iframes || token != JsonReader::Token::BEGIN_ARRAY) {
+      if (!reader.SkipValue()) break;
+      continue;
+    }
+    found = true;
+    while ((token = reader.Next()) != JsonReader::Token::END_ARRAY) {
+      if (token != JsonReader::Token::BEGIN_OBJECT) {
+        if (!reader.SkipValue()) break;
+        continue;
+      }
+      IframeInfo iframe{};
+      if (!ParseIframe(reader, iframe)) break;
+      ANYWP_LOG_DEBUG(kLogComponent, "Added iframe #" + std::to_string(iframes.size() + 1) +
+                      ": id=" + iframe.id +
+                      " pos=(" + std::to_string(iframe.left) + "," + std::to_string(iframe.top) + ")" +
+                      " size=" + std::to_string(iframe.width) + "x" + std::to_string(iframe.height) +
+                      " url=" + LogPayload(iframe.click_url));
+      iframes.push_back(std::move(iframe));
+    }
+  }
+  // Read to the end so a truncated message is rejected as a whole
+  if (reader.Current() == JsonReader::Token::END_OBJECT) {
+    reader.Next();
+  }
+  if (reader.Current() != JsonReader::Token::END) {
+    ANYWP_LOG_WARNING(kLogComponent, "Malformed iframe data at offset " +
+                      std::to_string(reader.ErrorOffset()));
+    iframes.clear();
+    return false;
+  }
+  if (!found) {
+    ANYWP_LOG_DEBUG(kLogComponent, "No iframes array found");
+  }
+  return found;
+}
+
+}  // namespace
+
 IframeDetector::IframeDetector() {
+  Logger::Instance().SetRateLimit(kLogComponent, Logger::Level::DEBUG,
+                                  kDebugLinesPerSecond, kDebugBurst);
 }
 
 IframeDetector::~IframeDetector() {
@@ -17,45 +139,45 @@ IframeDetector::~IframeDetector() {
 void IframeDetector::UpdateIframes(const std::string& json_data) {
   std::lock_guard<std::mutex> lock(mutex_);
   
-  Logger::Instance().Debug("IframeDetector", "Parsing iframe data...");
-  Logger::Instance().Debug("IframeDetector", "Raw JSON: " + json_data);
+  ANYWP_LOG_DEBUG(kLogComponent, "Parsing iframe data: " + LogPayload(json_data));
   
   // Parse and update
   std::vector<IframeInfo> new_iframes;
   if (ParseIframeJson(json_data, new_iframes)) {
     iframes_ = std::move(new_iframes);
-    Logger::Instance().Info("IframeDetector", "Total iframes: " + std::to_string(iframes_.size()));
+    ANYWP_LOG_INFO(kLogComponent, "Total iframes: " + std::to_string(iframes_.size()));
   } else {
-    Logger::Instance().Error("IframeDetector", "Failed to parse iframe data");
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to parse iframe data");
   }
 }
 
 IframeInfo* IframeDetector::GetIframeAtPoint(int x, int y) {
   std::lock_guard<std::mutex> lock(mutex_);
   
-  std::cout << "[AnyWP] [iframe] GetIframeAtPoint: checking (" << x << "," << y << ") against " 
-            << iframes_.size() << " iframes" << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "GetIframeAtPoint: checking (" + std::to_string(x) + "," +
+                  std::to_string(y) + ") against " + std::to_string(iframes_.size()) + " iframes");
   
   for (auto& iframe : iframes_) {
     if (!iframe.visible) {
-      std::cout << "[AnyWP] [iframe]   " << iframe.id << " - HIDDEN" << std::endl;
+      ANYWP_LOG_DEBUG(kLogComponent, "  " + iframe.id + " - HIDDEN");
       continue;
     }
     
     int right = iframe.left + iframe.width;
     int bottom = iframe.top + iframe.height;
     
-    std::cout << "[AnyWP] [iframe]   " << iframe.id << ": [" << iframe.left << "," << iframe.top 
-              << "] ~ [" << right << "," << bottom << "]" << std::endl;
+    ANYWP_LOG_DEBUG(kLogComponent, "  " + iframe.id + ": [" + std::to_string(iframe.left) + "," +
+                    std::to_string(iframe.top) + "] ~ [" + std::to_string(right) + "," +
+                    std::to_string(bottom) + "]");
     
     if (x >= iframe.left && x < right &&
         y >= iframe.top && y < bottom) {
-      std::cout << "[AnyWP] [iframe]   MATCH!" << std::endl;
+      ANYWP_LOG_DEBUG(kLogComponent, "  MATCH!");
       return &iframe;
     }
   }
   
-  std::cout << "[AnyWP] [iframe]   No match found" << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "  No match found");
   return nullptr;
 }
 
@@ -67,7 +189,7 @@ const std::vector<IframeInfo>& IframeDetector::GetIframes() const {
 void IframeDetector::Clear() {
   std::lock_guard<std::mutex> lock(mutex_);
   iframes_.clear();
-  std::cout << "[AnyWP] [iframe] Cleared all iframes" << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "Cleared all iframes");
 }
 
 size_t IframeDetector::GetCount() const {
@@ -78,282 +200,50 @@ size_t IframeDetector::GetCount() const {
 // ========== Private Helpers ==========
 
 bool IframeDetector::ParseIframeJson(const std::string& json_data, std::vector<IframeInfo>& iframes) {
-  iframes.clear();
-  
-  // Simple JSON parsing for iframe array
-  // Format: {"type":"IFRAME_DATA","iframes":[{...},{...}]}
-  size_t iframes_start = json_data.find("\"iframes\":[");
-  if (iframes_start == std::string::npos) {
-    std::cout << "[AnyWP] [iframe] No iframes array found" << std::endl;
-    return false;
-  }
-  
-  size_t array_end = json_data.find("]", iframes_start);
-  if (array_end == std::string::npos) {
-    std::cout << "[AnyWP] [iframe] No array end found" << std::endl;
-    return false;
-  }
-  
-  // Find each iframe object in the array
-  size_t pos = iframes_start + 11;  // Start after "iframes":[
-  
-  while (pos < array_end) {
-    // Find next iframe object start
-    pos = json_data.find("{", pos);
-    if (pos == std::string::npos || pos >= array_end) break;
-    
-    // Find the end of this iframe object (matching closing brace)
-    int brace_count = 1;
-    size_t obj_end = pos + 1;
-    while (obj_end < array_end && brace_count > 0) {
-      if (json_data[obj_end] == '{') brace_count++;
-      else if (json_data[obj_end] == '}') brace_count--;
-      obj_end++;
-    }
-    
-    if (brace_count != 0) {
-      std::cout << "[AnyWP] [iframe] ERROR: Unmatched braces at pos " << pos << std::endl;
-      break;
-    }
-    
-    // Extract iframe data within [pos, obj_end)
-    std::string obj_data = json_data.substr(pos, obj_end - pos);
-    std::cout << "[AnyWP] [iframe] Object data: " << obj_data << std::endl;
-    
-    IframeInfo iframe;
-    
-    // Extract fields using helper
-    iframe.id = ExtractJsonValue(obj_data, "id");
-    iframe.src = ExtractJsonValue(obj_data, "src");
-    iframe.click_url = ExtractJsonValue(obj_data, "clickUrl");
-    
-    // Extract bounds
-    size_t bounds_start = obj_data.find("\"bounds\":{");
-    if (bounds_start != std::string::npos) {
-      // Extract left
-      size_t left_start = obj_data.find("\"left\":", bounds_start);
-      if (left_start != std::string::npos) {
-        left_start += 7;
-        iframe.left = std::stoi(obj_data.substr(left_start, 10));
-      }
-      
-      // Extract top
-      size_t top_start = obj_data.find("\"top\":", bounds_start);
-      if (top_start != std::string::npos) {
-        top_start += 6;
-        iframe.top = std::stoi(obj_data.substr(top_start, 10));
-      }
-      
-      // Extract width
-      size_t width_start = obj_data.find("\"width\":", bounds_start);
-      if (width_start != std::string::npos) {
-        width_start += 8;
-        iframe.width = std::stoi(obj_data.substr(width_start, 10));
-      }
-      
-      // Extract height
-      size_t height_start = obj_data.find("\"height\":", bounds_start);
-      if (height_start != std::string::npos) {
-        height_start += 9;
-        iframe.height = std::stoi(obj_data.substr(height_start, 10));
-      }
-    }
-    
-    // Extract visible
-    size_t visible_start = obj_data.find("\"visible\":");
-    if (visible_start != std::string::npos) {
-      visible_start += 10;
-      iframe.visible = (obj_data.substr(visible_start, 4) == "true");
-    } else {
-      iframe.visible = true;  // Default to visible
-    }
-    
-    // Add to list
-    iframes.push_back(iframe);
-    
-    std::cout << "[AnyWP] [iframe] Added iframe #" << iframes.size() << ": id=" << iframe.id 
-              << " pos=(" << iframe.left << "," << iframe.top << ")"
-              << " size=" << iframe.width << "x" << iframe.height
-              << " url=" << iframe.click_url << std::endl;
-    
-    // Move to next object
-    pos = obj_end;
-  }
-  
-  return !iframes.empty();
-}
-
-std::string IframeDetector::ExtractJsonValue(const std::string& json, const std::string& key) {
-  std::string search = "\"" + key + "\":\"";
-  size_t start = json.find(search);
-  if (start == std::string::npos) {
-    return "";
-  }
-  
-  start += search.length();
-  size_t end = json.find("\"", start);
-  if (end == std::string::npos) {
-    return "";
-  }
-  
-  return json.substr(start, end - start);
+  return ParseIframeMessage(json_data, iframes);
 }
 
 // ========== v1.4.0+ Static Helpers for WallpaperInstance ==========
 
 bool IframeDetector::UpdateIframeVector(const std::string& json_data, std::vector<IframeInfo>& target_iframes) {
-  std::cout << "[AnyWP] [iframe] UpdateIframeVector: Parsing iframe data..." << std::endl;
-  std::cout << "[AnyWP] [iframe] Raw JSON: " << json_data << std::endl;
-  
-  target_iframes.clear();
-  
-  // Simple JSON parsing for iframe array
-  // Format: {"type":"IFRAME_DATA","iframes":[{...},{...}]}
-  size_t iframes_start = json_data.find("\"iframes\":[");
-  if (iframes_start == std::string::npos) {
-    std::cout << "[AnyWP] [iframe] No iframes array found" << std::endl;
-    return false;
-  }
+  ANYWP_LOG_DEBUG(kLogComponent, "UpdateIframeVector: parsing iframe data: " + LogPayload(json_data));
   
-  size_t array_end = json_data.find("]", iframes_start);
-  if (array_end == std::string::npos) {
-    std::cout << "[AnyWP] [iframe] No array end found" << std::endl;
+  std::vector<IframeInfo> new_iframes;
+  if (!ParseIframeMessage(json_data, new_iframes)) {
+    target_iframes.clear();
     return false;
   }
+  target_iframes = std::move(new_iframes);
   
-  // Find each iframe object in the array
-  size_t pos = iframes_start + 11;  // Start after "iframes":[
-  
-  while (pos < array_end) {
-    // Find next iframe object start
-    pos = json_data.find("{", pos);
-    if (pos == std::string::npos || pos >= array_end) break;
-    
-    // Find the end of this iframe object (matching closing brace)
-    int brace_count = 1;
-    size_t obj_end = pos + 1;
-    while (obj_end < array_end && brace_count > 0) {
-      if (json_data[obj_end] == '{') brace_count++;
-      else if (json_data[obj_end] == '}') brace_count--;
-      obj_end++;
-    }
-    
-    if (brace_count != 0) {
-      std::cout << "[AnyWP] [iframe] ERROR: Unmatched braces at pos " << pos << std::endl;
-      break;
-    }
-    
-    // Extract iframe data within [pos, obj_end)
-    std::string obj_data = json_data.substr(pos, obj_end - pos);
-    std::cout << "[AnyWP] [iframe] Object data: " << obj_data << std::endl;
-    
-    IframeInfo iframe;
-    
-    // Extract id
-    size_t id_start = obj_data.find("\"id\":\"");
-    if (id_start != std::string::npos) {
-      id_start += 6;
-      size_t id_end = obj_data.find("\"", id_start);
-      iframe.id = obj_data.substr(id_start, id_end - id_start);
-    }
-    
-    // Extract src
-    size_t src_start = obj_data.find("\"src\":\"");
-    if (src_start != std::string::npos) {
-      src_start += 7;
-      size_t src_end = obj_data.find("\"", src_start);
-      iframe.src = obj_data.substr(src_start, src_end - src_start);
-    }
-    
-    // Extract clickUrl
-    size_t url_start = obj_data.find("\"clickUrl\":\"");
-    if (url_start != std::string::npos) {
-      url_start += 12;
-      size_t url_end = obj_data.find("\"", url_start);
-      iframe.click_url = obj_data.substr(url_start, url_end - url_start);
-    }
-    
-    // Extract bounds
-    size_t bounds_start = obj_data.find("\"bounds\":{");
-    if (bounds_start != std::string::npos) {
-      // Extract left
-      size_t left_start = obj_data.find("\"left\":", bounds_start);
-      if (left_start != std::string::npos) {
-        left_start += 7;
-        iframe.left = std::stoi(obj_data.substr(left_start, 10));
-      }
-      
-      // Extract top
-      size_t top_start = obj_data.find("\"top\":", bounds_start);
-      if (top_start != std::string::npos) {
-        top_start += 6;
-        iframe.top = std::stoi(obj_data.substr(top_start, 10));
-      }
-      
-      // Extract width
-      size_t width_start = obj_data.find("\"width\":", bounds_start);
-      if (width_start != std::string::npos) {
-        width_start += 8;
-        iframe.width = std::stoi(obj_data.substr(width_start, 10));
-      }
-      
-      // Extract height
-      size_t height_start = obj_data.find("\"height\":", bounds_start);
-      if (height_start != std::string::npos) {
-        height_start += 9;
-        iframe.height = std::stoi(obj_data.substr(height_start, 10));
-      }
-    }
-    
-    // Extract visible
-    size_t visible_start = obj_data.find("\"visible\":");
-    if (visible_start != std::string::npos) {
-      visible_start += 10;
-      iframe.visible = (obj_data.substr(visible_start, 4) == "true");
-    } else {
-      iframe.visible = true;  // Default to visible
-    }
-    
-    // Add to list
-    target_iframes.push_back(iframe);
-    
-    std::cout << "[AnyWP] [iframe] Added iframe #" << target_iframes.size() << ": id=" << iframe.id 
-              << " pos=(" << iframe.left << "," << iframe.top << ")"
-              << " size=" << iframe.width << "x" << iframe.height
-              << " url=" << iframe.click_url << std::endl;
-    
-    // Move to next object
-    pos = obj_end;
-  }
-  
-  std::cout << "[AnyWP] [iframe] Total iframes: " << target_iframes.size() << std::endl;
-  return !target_iframes.empty();
+  ANYWP_LOG_DEBUG(kLogComponent, "Total iframes: " + std::to_string(target_iframes.size()));
+  return true;
 }
 
 IframeInfo* IframeDetector::GetIframeAtPointInVector(int x, int y, std::vector<IframeInfo>& iframes) {
-  std::cout << "[AnyWP] [iframe] GetIframeAtPointInVector: checking (" << x << "," << y << ") against " 
-            << iframes.size() << " iframes" << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "GetIframeAtPointInVector: checking (" + std::to_string(x) + "," +
+                  std::to_string(y) + ") against " + std::to_string(iframes.size()) + " iframes");
   
   for (auto& iframe : iframes) {
     if (!iframe.visible) {
-      std::cout << "[AnyWP] [iframe]   " << iframe.id << " - HIDDEN" << std::endl;
+      ANYWP_LOG_DEBUG(kLogComponent, "  " + iframe.id + " - HIDDEN");
       continue;
     }
     
     int right = iframe.left + iframe.width;
     int bottom = iframe.top + iframe.height;
     
-    std::cout << "[AnyWP] [iframe]   " << iframe.id << ": [" << iframe.left << "," << iframe.top 
-              << "] ~ [" << right << "," << bottom << "]" << std::endl;
+    ANYWP_LOG_DEBUG(kLogComponent, "  " + iframe.id + ": [" + std::to_string(iframe.left) + "," +
+                    std::to_string(iframe.top) + "] ~ [" + std::to_string(right) + "," +
+                    std::to_string(bottom) + "]");
     
     if (x >= iframe.left && x < right &&
         y >= iframe.top && y < bottom) {
-      std::cout << "[AnyWP] [iframe]   MATCH!" << std::endl;
+      ANYWP_LOG_DEBUG(kLogComponent, "  MATCH!");
       return &iframe;
     }
   }
   
-  std::cout << "[AnyWP] [iframe]   No match found" << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "  No match found");
   return nullptr;
 }
 
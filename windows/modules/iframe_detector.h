@@ -59,12 +59,9 @@ public:
   size_t GetCount() const;
 
 private:
-  // Parse JSON data into IframeInfo structures
+  // Parse JSON data into IframeInfo structures (see utils/json_reader.h)
   bool ParseIframeJson(const std::string& json_data, std::vector<IframeInfo>& iframes);
   
-  // Extract JSON field value
-  std::string ExtractJsonValue(const std::string& json, const std::string& key);
-  
   std::vector<IframeInfo> iframes_;
   mutable std::mutex mutex_;
 };
@@ -1,9 +1,43 @@
 #include "mouse_hook_manager.h"
-#include <iostream>
+#include <sstream>
 #include "../anywp_engine_plugin.h"
+#include "../utils/logger.h"
+#include "../utils/log_payload.h"
 
 namespace anywp_engine {
 
+namespace {
+
+// Hook-thread log components: mousemove detail is logged separately so a
+// mouse storm cannot use up the budget of click events
+constexpr const char* kLogComponent = "MouseHook";
+constexpr const char* kMoveLogComponent = "MouseHook.Move";
+
+// DEBUG budgets (lines beyond them are counted and summarized by Logger)
+constexpr double kDebugLinesPerSecond = 20.0;
+constexpr size_t kDebugBurst = 50;
+constexpr uint32_t kMoveSampleRate = 50;   // Keep one mousemove in 50
+constexpr double kMoveLinesPerSecond = 5.0;
+constexpr size_t kMoveBurst = 10;
+
+std::string HandleToString(HWND hwnd) {
+  std::ostringstream oss;
+  oss << hwnd;
+  return oss.str();
+}
+
+std::string WideToUtf8(const wchar_t* text) {
+  int size_needed = WideCharToMultiByte(CP_UTF8, 0, text, -1, nullptr, 0, nullptr, nullptr);
+  if (size_needed <= 1) {
+    return std::string();
+  }
+  std::string result(size_needed - 1, '\0');
+  WideCharToMultiByte(CP_UTF8, 0, text, -1, &result[0], size_needed, nullptr, nullptr);
+  return result;
+}
+
+}  // namespace
+
 MouseHookManager* MouseHookManager::instance_ = nullptr;
 
 MouseHookManager::MouseHookManager()
@@ -24,7 +58,12 @@ bool MouseHookManager::Install() {
   }
   
   try {
-    std::cout << "[AnyWP] [MouseHook] Installing low-level mouse hook..." << std::endl;
+    ANYWP_LOG_INFO(kLogComponent, "Installing low-level mouse hook...");
+    
+    // Bound hook-thread DEBUG output before the first event arrives
+    Logger::Instance().SetRateLimit(kLogComponent, kLogLevelDebug, kDebugLinesPerSecond, kDebugBurst);
+    Logger::Instance().SetSampling(kMoveLogComponent, kLogLevelDebug, kMoveSampleRate);
+    Logger::Instance().SetRateLimit(kMoveLogComponent, kLogLevelDebug, kMoveLinesPerSecond, kMoveBurst);
     
     hook_ = SetWindowsHookExW(
       WH_MOUSE_LL,
@@ -34,25 +73,25 @@ bool MouseHookManager::Install() {
     );
     
     if (hook_) {
-      std::cout << "[AnyWP] [MouseHook] Hook installed successfully" << std::endl;
+      ANYWP_LOG_INFO(kLogComponent, "Hook installed successfully");
       return true;
     } else {
       DWORD error = GetLastError();
-      std::cout << "[AnyWP] [MouseHook] ERROR: Failed to install hook: " << error << std::endl;
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to install hook: " + std::to_string(error));
       return false;
     }
   } catch (const std::exception& e) {
-    std::cout << "[AnyWP] [MouseHook] ERROR: Exception in Install: " << e.what() << std::endl;
+    ANYWP_LOG_ERROR(kLogComponent, std::string("Exception in Install: ") + e.what());
     return false;
   } catch (...) {
-    std::cout << "[AnyWP] [MouseHook] ERROR: Unknown exception in Install" << std::endl;
+    ANYWP_LOG_ERROR(kLogComponent, "Unknown exception in Install");
     return false;
   }
 }
 
 void MouseHookManager::Uninstall() {
   if (hook_) {
-    std::cout << "[AnyWP] [MouseHook] Uninstalling mouse hook..." << std::endl;
+    ANYWP_LOG_INFO(kLogComponent, "Uninstalling mouse hook...");
     UnhookWindowsHookEx(hook_);
     hook_ = nullptr;
   }
@@ -88,42 +127,25 @@ bool MouseHookManager::IsPaused() const {
 
 
 LRESULT CALLBACK MouseHookManager::LowLevelMouseProc(int nCode, WPARAM wParam, LPARAM lParam) {
-  // v2.0.10+ CRITICAL DEBUG: Output IMMEDIATELY to confirm callback is called
-  static int total_calls = 0;
-  total_calls++;
+  // Runs on the input thread of the whole desktop: never block on the console
+  ANYWP_HOT_PATH();
   
-  // ALWAYS output first 20 calls, then every 10th
-  static bool first_call_logged = false;
-  if (!first_call_logged) {
-    std::wcout << L"[MouseHook] *** CALLBACK FIRST CALL *** nCode=" << nCode << L", wParam=" << wParam << std::endl;
-    first_call_logged = true;
-  }
+  // Hook-thread logging is rate limited per component (see Install); lines
+  // over the budget are dropped before their message is built
+  const char* log_component = (wParam == WM_MOUSEMOVE) ? kMoveLogComponent : kLogComponent;
   
-  if (total_calls <= 20 || total_calls % 10 == 0) {
-    std::wcout << L"[MouseHook] Callback #" << total_calls << L" nCode=" << nCode << L", wParam=" << wParam << std::endl;
-  }
-  
-  // v2.0.10+ DEBUG: Track early returns (log ALL for debugging)
-  static int early_return_ncode = 0;
-  static int early_return_paused = 0;
+  ANYWP_LOG_DEBUG(log_component, "Callback nCode=" + std::to_string(nCode) +
+                  ", wParam=" + std::to_string(wParam));
   
   if (nCode < 0 || !instance_) {
-    early_return_ncode++;
-    // Log first 50 or every 20th
-    if (early_return_ncode <= 50 || early_return_ncode % 20 == 0) {
-      std::wcout << L"[MouseHook] DEBUG: Early return (nCode=" << nCode 
-                 << L", instance=" << (instance_ ? L"OK" : L"NULL")
-                 << L"), count: " << early_return_ncode << std::endl;
-    }
+    ANYWP_LOG_DEBUG(log_component, "Early return (nCode=" + std::to_string(nCode) +
+                    ", instance=" + (instance_ ? "OK" : "NULL") + ")");
     return CallNextHookEx(nullptr, nCode, wParam, lParam);
   }
   
   // Skip if paused (performance optimization)
   if (instance_->paused_) {
-    early_return_paused++;
-    if (early_return_paused <= 50 || early_return_paused % 20 == 0) {
-      std::wcout << L"[MouseHook] DEBUG: Paused, skipping event, count: " << early_return_paused << std::endl;
-    }
+    ANYWP_LOG_DEBUG(log_component, "Paused, skipping event");
     return CallNextHookEx(nullptr, nCode, wParam, lParam);
   }
   
@@ -139,28 +161,11 @@ LRESULT CALLBACK MouseHookManager::LowLevelMouseProc(int nCode, WPARAM wParam, L
     GetClassNameW(window_at_point, className, 256);
   }
   
-  // Debug logging (v2.0.10+ log ALL non-mousemove events unconditionally)
-  static int debug_count = 0;
-  static int mousemove_debug_count = 0;
-  bool should_log = (wParam != WM_MOUSEMOVE);  // Always log non-mousemove events
-  
-  // For mousemove, log every 50th event
-  if (wParam == WM_MOUSEMOVE) {
-    mousemove_debug_count++;
-    should_log = (mousemove_debug_count % 50 == 0);
-  }
-  
-  if (should_log) {
-    debug_count++;
-    std::wcout << L"[MouseHook] Event: " << wParam 
-               << L" at (" << pt.x << L"," << pt.y << L")";
-    if (instance_->is_mouse_down_) {
-      std::wcout << L" [MOUSE_DOWN]";
-    }
-    std::wcout << std::endl;
-    std::wcout << L"[MouseHook] WindowAtPoint: " << window_at_point 
-               << L" ClassName: " << className << std::endl;
-  }
+  ANYWP_LOG_DEBUG(log_component, "Event: " + std::to_string(wParam) +
+                  " at (" + std::to_string(pt.x) + "," + std::to_string(pt.y) + ")" +
+                  (instance_->is_mouse_down_ ? " [MOUSE_DOWN]" : "") +
+                  " WindowAtPoint: " + HandleToString(window_at_point) +
+                  " ClassName: " + WideToUtf8(className));
   
   // Check if this is a top-level application window (not desktop layer)
   bool is_app_window = false;
@@ -176,11 +181,8 @@ LRESULT CALLBACK MouseHookManager::LowLevelMouseProc(int nCode, WPARAM wParam, L
       wchar_t rootClassName[256] = {0};
       GetClassNameW(root_window, rootClassName, 256);
       
-      // v2.0.10+ DEBUG: Log root window class
-      if (should_log) {
-        std::wcout << L"[MouseHook] Root window: " << root_window 
-                   << L" Class: " << rootClassName << std::endl;
-      }
+      ANYWP_LOG_DEBUG(log_component, "Root window: " + HandleToString(root_window) +
+                      " Class: " + WideToUtf8(rootClassName));
       
       // v2.0.10+ CRITICAL FIX: Detect desktop AND desktop icon list
       // SysListView32 is the icon container, we need to forward these events too
@@ -200,10 +202,8 @@ LRESULT CALLBACK MouseHookManager::LowLevelMouseProc(int nCode, WPARAM wParam, L
         bool check_root = instance_->hwnd_check_callback_(root_window);
         is_our_window = check_window || check_root;
         
-        if (should_log) {
-          std::wcout << L"[MouseHook] HWND Check - window_at_point: " << check_window 
-                     << L", root_window: " << check_root << std::endl;
-        }
+        ANYWP_LOG_DEBUG(log_component, std::string("HWND Check - window_at_point: ") +
+                        (check_window ? "1" : "0") + ", root_window: " + (check_root ? "1" : "0"));
       }
       
       // Fallback: Also check if it's our Chrome WebView2 window
@@ -212,16 +212,14 @@ LRESULT CALLBACK MouseHookManager::LowLevelMouseProc(int nCode, WPARAM wParam, L
           WallpaperInstance* inst = instance_->instance_callback_(pt.x, pt.y);
           is_our_window = (inst != nullptr);
           
-          if (should_log) {
-            std::wcout << L"[MouseHook] Chrome window check: " << (inst != nullptr) << std::endl;
-          }
+          ANYWP_LOG_DEBUG(log_component, std::string("Chrome window check: ") +
+                          (inst != nullptr ? "1" : "0"));
         }
       }
       
-      if (should_log) {
-        std::wcout << L"[MouseHook] is_desktop_window: " << is_desktop_window 
-                   << L", is_our_window: " << is_our_window << std::endl;
-      }
+      ANYWP_LOG_DEBUG(log_component, std::string("is_desktop_window: ") +
+                      (is_desktop_window ? "1" : "0") + ", is_our_window: " +
+                      (is_our_window ? "1" : "0"));
       
       if (!is_desktop_window && !is_our_window) {
         // Check if it's a normal app window (has caption or is popup)
@@ -244,16 +242,12 @@ LRESULT CALLBACK MouseHookManager::LowLevelMouseProc(int nCode, WPARAM wParam, L
     event_type = "mousedown";
     // v2.0.4+ Track mouse button down state - MUST set this before any early returns
     instance_->is_mouse_down_ = true;
-    if (should_log) {
-      std::wcout << L"[MouseHook] 🖱️ Mouse button down" << std::endl;
-    }
+    ANYWP_LOG_DEBUG(kLogComponent, "Mouse button down");
   } else if (wParam == WM_LBUTTONUP) {
     event_type = "mouseup";
     // v2.0.4+ Clear mouse button down state
     instance_->is_mouse_down_ = false;
-    if (should_log) {
-      std::wcout << L"[MouseHook] 🖱️ Mouse button up" << std::endl;
-    }
+    ANYWP_LOG_DEBUG(kLogComponent, "Mouse button up");
   } else if (wParam == WM_MOUSEMOVE) {
     event_type = "mousemove";
   }
@@ -261,22 +255,12 @@ LRESULT CALLBACK MouseHookManager::LowLevelMouseProc(int nCode, WPARAM wParam, L
   // v2.0.4+ NOW check is_app_window (after mouse button state is set)
   // Don't block events when mouse button is pressed
   if (is_app_window && !instance_->is_mouse_down_) {
-    if (should_log) {
-      std::wcout << L"[MouseHook] BLOCKED - is_app_window = true, mouse button not down" << std::endl;
-    }
+    ANYWP_LOG_DEBUG(log_component, "BLOCKED - is_app_window = true, mouse button not down");
     return CallNextHookEx(nullptr, nCode, wParam, lParam);
   }
   
-  // v2.0.10+ DEBUG: Always log FORWARDING decision
-  static int forward_count = 0;
-  forward_count++;
-  if (should_log || forward_count <= 10) {
-    std::wcout << L"[MouseHook] FORWARDING #" << forward_count << L" event to WebView";
-    if (instance_->is_mouse_down_) {
-      std::wcout << L" (mouse down)";
-    }
-    std::wcout << std::endl;
-  }
+  ANYWP_LOG_DEBUG(log_component, std::string("FORWARDING event to WebView") +
+                  (instance_->is_mouse_down_ ? " (mouse down)" : ""));
   
   // Get target wallpaper instance (via callback)
   WallpaperInstance* target_instance = nullptr;
@@ -289,9 +273,9 @@ LRESULT CALLBACK MouseHookManager::LowLevelMouseProc(int nCode, WPARAM wParam, L
     IframeInfo* iframe = instance_->iframe_callback_(pt.x, pt.y, target_instance);
     
     if (iframe && !iframe->click_url.empty()) {
-      std::cout << "[AnyWP] [MouseHook] Click on iframe: " << iframe->id 
-                << " at (" << pt.x << "," << pt.y << ")" << std::endl;
-      std::cout << "[AnyWP] [MouseHook] Opening URL: " << iframe->click_url << std::endl;
+      ANYWP_LOG_INFO(kLogComponent, "Click on iframe: " + iframe->id + " at (" +
+                     std::to_string(pt.x) + "," + std::to_string(pt.y) + "), opening URL: " +
+                     LogPayload(iframe->click_url));
       
       // Open the ad URL directly
       std::wstring url_wide(iframe->click_url.begin(), iframe->click_url.end());
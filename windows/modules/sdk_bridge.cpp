@@ -1,7 +1,12 @@
 #include "sdk_bridge.h"
+#include "../utils/logger.h"
+#include "../utils/log_payload.h"
+#include "../utils/json_reader.h"
+#include "webmessage_types.h"  // Generated from sdk/types/webmessage.ts
 
-#include <iostream>
+#include <cstdio>
 #include <fstream>
+#include <utility>
 #include <vector>
 #include <codecvt>
 #include <locale>
@@ -12,7 +17,44 @@ namespace anywp_engine {
 std::string SDKBridge::cached_sdk_script_ = "";
 bool SDKBridge::sdk_script_loaded_ = false;
 
+namespace {
+
+constexpr const char* kLogComponent = "SDKBridge";
+
+// Per-message trace: wallpapers can post at animation rate
+constexpr double kDebugLinesPerSecond = 20.0;
+constexpr size_t kDebugBurst = 50;
+
+std::string HResultToString(HRESULT hr) {
+  char buffer[16];
+  std::snprintf(buffer, sizeof(buffer), "0x%08lX", static_cast<unsigned long>(hr));
+  return buffer;
+}
+
+std::string WideToUtf8(LPCWSTR text) {
+  if (!text) {
+    return "";
+  }
+  int size = WideCharToMultiByte(CP_UTF8, 0, text, -1, nullptr, 0, nullptr, nullptr);
+  if (size <= 1) {
+    return "";
+  }
+  std::string result(size - 1, '\0');
+  WideCharToMultiByte(CP_UTF8, 0, text, -1, &result[0], size, nullptr, nullptr);
+  return result;
+}
+
+}  // namespace
+
 SDKBridge::SDKBridge() {
+  Logger::Instance().SetRateLimit(kLogComponent, Logger::Level::DEBUG,
+                                  kDebugLinesPerSecond, kDebugBurst);
+  router_.SetHandler(MessageSlot::SDK_READY, [this](const std::string& message) {
+    HandleSdkReady(message);
+  });
+  router_.SetHandler(MessageSlot::SDK_ERROR, [this](const std::string& message) {
+    HandleSdkError(message);
+  });
 }
 
 SDKBridge::~SDKBridge() {
@@ -22,7 +64,7 @@ SDKBridge::~SDKBridge() {
 
 void SDKBridge::SetWebView(Microsoft::WRL::ComPtr<ICoreWebView2> webview) {
   webview_ = webview;
-  std::cout << "[AnyWP] [SDKBridge] WebView set" << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "WebView set");
 }
 
 Microsoft::WRL::ComPtr<ICoreWebView2> SDKBridge::GetWebView() const {
@@ -33,17 +75,17 @@ Microsoft::WRL::ComPtr<ICoreWebView2> SDKBridge::GetWebView() const {
 
 void SDKBridge::InjectSDK() {
   if (!webview_) {
-    std::cout << "[AnyWP] [SDKBridge] ERROR: WebView not set" << std::endl;
+    ANYWP_LOG_ERROR(kLogComponent, "WebView not set");
     return;
   }
   
-  std::cout << "[AnyWP] [SDKBridge] Injecting AnyWallpaper SDK..." << std::endl;
+  ANYWP_LOG_INFO(kLogComponent, "Injecting AnyWallpaper SDK...");
   
   // Load SDK script
   std::string sdk_script = LoadSDKScript();
   std::wstring wsdk_script(sdk_script.begin(), sdk_script.end());
   
-  std::cout << "[AnyWP] [SDKBridge] SDK script size: " << sdk_script.length() << " bytes" << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "SDK script size: " + std::to_string(sdk_script.length()) + " bytes");
   
   // Inject on every navigation (for future navigations)
   webview_->AddScriptToExecuteOnDocumentCreated(
@@ -51,9 +93,9 @@ void SDKBridge::InjectSDK() {
     Microsoft::WRL::Callback<ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler>(
       [](HRESULT result, LPCWSTR id) -> HRESULT {
         if (SUCCEEDED(result)) {
-          std::wcout << L"[AnyWP] [SDKBridge] SDK registered for future pages, ID: " << id << std::endl;
+          ANYWP_LOG_DEBUG(kLogComponent, "SDK registered for future pages, ID: " + WideToUtf8(id));
         } else {
-          std::cout << "[AnyWP] [SDKBridge] ERROR: Failed to register SDK: " << std::hex << result << std::endl;
+          ANYWP_LOG_ERROR(kLogComponent, "Failed to register SDK: " + HResultToString(result));
         }
         return S_OK;
       }).Get());
@@ -61,17 +103,18 @@ void SDKBridge::InjectSDK() {
   // IMPORTANT: Also inject immediately for current page
   // Note: This may fail if page hasn't loaded yet, but AddScriptToExecuteOnDocumentCreated
   // will ensure SDK is injected when page is created
-  std::cout << "[AnyWP] [SDKBridge] Attempting to inject SDK into current page..." << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "Attempting to inject SDK into current page...");
   webview_->ExecuteScript(
     wsdk_script.c_str(),
     Microsoft::WRL::Callback<ICoreWebView2ExecuteScriptCompletedHandler>(
       [](HRESULT result, LPCWSTR resultObjectAsJson) -> HRESULT {
         if (SUCCEEDED(result)) {
-          std::cout << "[AnyWP] [SDKBridge] SDK executed successfully on current page" << std::endl;
+          ANYWP_LOG_DEBUG(kLogComponent, "SDK executed successfully on current page");
         } else {
-          std::cout << "[AnyWP] [SDKBridge] WARNING: Failed to execute SDK on current page (may not be loaded yet): " 
-                    << std::hex << result << std::endl;
-          std::cout << "[AnyWP] [SDKBridge] SDK will be injected via AddScriptToExecuteOnDocumentCreated when page loads" << std::endl;
+          ANYWP_LOG_WARNING(kLogComponent,
+                            "Failed to execute SDK on current page (may not be loaded yet): " +
+                            HResultToString(result) +
+                            "; it will be injected via AddScriptToExecuteOnDocumentCreated when the page loads");
         }
         return S_OK;
       }).Get());
@@ -81,12 +124,12 @@ void SDKBridge::InjectSDK() {
     L"  if (window.AnyWP && window.AnyWP.version) {"
     L"    console.log('[AnyWP] SDK verification: SDK loaded successfully, version:', window.AnyWP.version);"
     L"    if (window.chrome && window.chrome.webview && window.chrome.webview.postMessage) {"
-    L"      window.chrome.webview.postMessage(JSON.stringify({type:'sdkReady', version: window.AnyWP.version}));"
+    L"      window.chrome.webview.postMessage({type:'sdkReady', version: window.AnyWP.version});"
     L"    }"
     L"  } else {"
     L"    console.error('[AnyWP] SDK verification: SDK NOT loaded! window.AnyWP:', window.AnyWP);"
     L"    if (window.chrome && window.chrome.webview && window.chrome.webview.postMessage) {"
-    L"      window.chrome.webview.postMessage(JSON.stringify({type:'sdkError', error:'SDK not found'}));"
+    L"      window.chrome.webview.postMessage({type:'sdkError', error:'SDK not found'});"
     L"    }"
     L"  }"
     L"}, 1000);";
@@ -96,9 +139,10 @@ void SDKBridge::InjectSDK() {
     Microsoft::WRL::Callback<ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler>(
       [](HRESULT result, LPCWSTR id) -> HRESULT {
         if (SUCCEEDED(result)) {
-          std::wcout << L"[AnyWP] [SDKBridge] SDK verification script registered, ID: " << id << std::endl;
+          ANYWP_LOG_DEBUG(kLogComponent, "SDK verification script registered, ID: " + WideToUtf8(id));
         } else {
-          std::cout << "[AnyWP] [SDKBridge] WARNING: Failed to register verification script: " << std::hex << result << std::endl;
+          ANYWP_LOG_WARNING(kLogComponent,
+                            "Failed to register verification script: " + HResultToString(result));
         }
         return S_OK;
       }).Get());
@@ -106,15 +150,16 @@ void SDKBridge::InjectSDK() {
 
 void SDKBridge::SetupMessageBridge() {
   if (!webview_) {
-    std::cout << "[AnyWP] [SDKBridge] ERROR: WebView not set" << std::endl;
+    ANYWP_LOG_ERROR(kLogComponent, "WebView not set");
     return;
   }
   
-  std::cout << "[AnyWP] [SDKBridge] Setting up message bridge..." << std::endl;
+  ANYWP_LOG_INFO(kLogComponent, "Setting up message bridge...");
   
   webview_->add_WebMessageReceived(
     Microsoft::WRL::Callback<ICoreWebView2WebMessageReceivedEventHandler>(
       [this](ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args) -> HRESULT {
+        ANYWP_HOT_PATH();
         LPWSTR message;
         args->get_WebMessageAsJson(&message);
         
@@ -126,76 +171,81 @@ void SDKBridge::SetupMessageBridge() {
         std::string msg(size_needed - 1, 0);  // -1 to exclude null terminator
         WideCharToMultiByte(CP_UTF8, 0, wmessage.c_str(), -1, &msg[0], size_needed, nullptr, nullptr);
         
-        // Check if this is a pause/resume result message
-        if (msg.find("\"type\":\"pauseResult\"") != std::string::npos || 
-            msg.find("\"type\":\"resumeResult\"") != std::string::npos) {
-          std::cout << "[AnyWP] [SDKBridge] Script Result: " << msg << std::endl;
-        }
-        
         HandleMessage(msg);
         
         CoTaskMemFree(message);
         return S_OK;
       }).Get(), nullptr);
   
-  std::cout << "[AnyWP] [SDKBridge] Message bridge ready" << std::endl;
+  ANYWP_LOG_INFO(kLogComponent, "Message bridge ready");
 }
 
 // ========== Message Handling ==========
 
+void SDKBridge::SetHandler(MessageSlot slot, MessageHandler handler) {
+  router_.SetHandler(slot, std::move(handler));
+}
+
 void SDKBridge::RegisterHandler(const std::string& message_type, MessageHandler handler) {
-  handlers_[message_type] = handler;
-  std::cout << "[AnyWP] [SDKBridge] Registered handler for: " << message_type << std::endl;
+  router_.SetHandler(message_type, std::move(handler));
+  ANYWP_LOG_DEBUG(kLogComponent, "Registered handler for: " + message_type);
 }
 
 void SDKBridge::UnregisterHandler(const std::string& message_type) {
-  handlers_.erase(message_type);
-  std::cout << "[AnyWP] [SDKBridge] Unregistered handler for: " << message_type << std::endl;
+  router_.RemoveHandler(message_type);
+  ANYWP_LOG_DEBUG(kLogComponent, "Unregistered handler for: " + message_type);
 }
 
 void SDKBridge::HandleMessage(const std::string& message) {
-  std::cout << "[AnyWP] [SDKBridge] Received message: " << message << std::endl;
+  ANYWP_HOT_PATH();
+  ANYWP_LOG_DEBUG(kLogComponent, "Received message: " + LogPayload(message));
   
-  // Determine message type first
   std::string type = GetMessageType(message);
-  
-  // Check for SDK verification messages (handle before other handlers)
-  if (type == "sdkReady" || message.find("\"type\":\"sdkReady\"") != std::string::npos) {
-    std::cout << "[AnyWP] [SDKBridge] SDK verification: SDK loaded successfully" << std::endl;
-    // Extract version if present
-    std::string version = ExtractJsonValue(message, "version");
-    if (!version.empty()) {
-      std::cout << "[AnyWP] [SDKBridge] SDK version: " << version << std::endl;
-    }
+  if (type.empty()) {
+    ANYWP_LOG_WARNING(kLogComponent, "Unknown message type (showing raw): " + LogPayload(message));
     return;
   }
+  MessageSlot slot = MessageRouter::Lookup(type);
   
-  if (type == "sdkError" || message.find("\"type\":\"sdkError\"") != std::string::npos) {
-    std::cout << "[AnyWP] [SDKBridge] SDK verification: SDK NOT loaded" << std::endl;
-    std::string error = ExtractJsonValue(message, "error");
-    if (!error.empty()) {
-      std::cout << "[AnyWP] [SDKBridge] Error: " << error << std::endl;
-    }
+  // SDK verification messages stay in the engine
+  if (slot == MessageSlot::SDK_READY || slot == MessageSlot::SDK_ERROR) {
+    router_.Dispatch(slot, message);
     return;
   }
   
-  if (type.empty()) {
-    std::cout << "[AnyWP] [SDKBridge] Unknown message type (showing raw): " << message << std::endl;
-    return;
+  if (slot == MessageSlot::PAUSE_RESULT || slot == MessageSlot::RESUME_RESULT) {
+    ANYWP_LOG_DEBUG(kLogComponent, "Script Result: " + LogPayload(message));
   }
   
   // v2.1.0+ Bidirectional Communication: Forward ALL messages to Flutter
   // This allows Flutter to handle any message type from JavaScript
-  std::cout << "[AnyWP] [SDKBridge] Forwarding message to Flutter (type: " << type << ")" << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "Forwarding message to Flutter (type: " + type + ")");
   ForwardMessageToFlutter(message);
   
   // Also invoke registered handler (if any) for backward compatibility
-  auto it = handlers_.find(type);
-  if (it != handlers_.end()) {
-    std::cout << "[AnyWP] [SDKBridge] Invoking registered handler for type: " << type << std::endl;
-    it->second(message);
+  bool handled = slot != MessageSlot::NONE ? router_.Dispatch(slot, message)
+                                           : router_.Dispatch(type, message);
+  if (handled) {
+    ANYWP_LOG_DEBUG(kLogComponent, "Invoked registered handler for type: " + type);
   } else {
-    std::cout << "[AnyWP] [SDKBridge] No registered handler for type: " << type << " (message still forwarded to Flutter)" << std::endl;
+    ANYWP_LOG_DEBUG(kLogComponent, "No registered handler for type: " + type +
+                    " (message still forwarded to Flutter)");
+  }
+}
+
+void SDKBridge::HandleSdkReady(const std::string& message) {
+  ANYWP_LOG_INFO(kLogComponent, "SDK verification: SDK loaded successfully");
+  webmessage::SdkReadyMessage ready;
+  if (webmessage::Decode(message, ready) && ready.version && !ready.version->empty()) {
+    ANYWP_LOG_INFO(kLogComponent, "SDK version: " + LogPayload(*ready.version));
+  }
+}
+
+void SDKBridge::HandleSdkError(const std::string& message) {
+  ANYWP_LOG_ERROR(kLogComponent, "SDK verification: SDK NOT loaded");
+  webmessage::SdkErrorMessage sdk_error;
+  if (webmessage::Decode(message, sdk_error) && sdk_error.error && !sdk_error.error->empty()) {
+    ANYWP_LOG_ERROR(kLogComponent, "Error: " + LogPayload(*sdk_error.error));
   }
 }
 
@@ -203,25 +253,24 @@ void SDKBridge::HandleMessage(const std::string& message) {
 
 void SDKBridge::SetFlutterCallback(std::function<void(const std::string&)> callback) {
   flutter_callback_ = callback;
-  std::cout << "[AnyWP] [SDKBridge] Flutter callback registered" << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "Flutter callback registered");
 }
 
 void SDKBridge::ForwardMessageToFlutter(const std::string& message) {
   if (!flutter_callback_) {
-    std::cout << "[AnyWP] [SDKBridge] WARNING: Flutter callback not set, cannot forward message" << std::endl;
+    ANYWP_LOG_WARNING(kLogComponent, "Flutter callback not set, cannot forward message");
     return;
   }
 
-  std::cout << "[AnyWP] [SDKBridge] Forwarding to Flutter: " << message.substr(0, 100) 
-            << (message.length() > 100 ? "..." : "") << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "Forwarding to Flutter: " + LogPayload(message, 100));
 
   try {
     // Call Flutter callback
     flutter_callback_(message);
-    std::cout << "[AnyWP] [SDKBridge] Message forwarded successfully" << std::endl;
+    ANYWP_LOG_DEBUG(kLogComponent, "Message forwarded successfully");
   } catch (const std::exception& e) {
-    std::cout << "[AnyWP] [SDKBridge] ERROR: Exception during message forwarding: " 
-              << e.what() << std::endl;
+    ANYWP_LOG_ERROR(kLogComponent,
+                    std::string("Exception during message forwarding: ") + e.what());
   }
 }
 
@@ -229,7 +278,7 @@ void SDKBridge::ForwardMessageToFlutter(const std::string& message) {
 
 bool SDKBridge::ExecuteScript(const std::wstring& script) {
   if (!webview_) {
-    std::cout << "[AnyWP] [SDKBridge] ERROR: WebView not set" << std::endl;
+    ANYWP_LOG_ERROR(kLogComponent, "WebView not set");
     return false;
   }
   
@@ -245,19 +294,12 @@ bool SDKBridge::ExecuteScript(const std::string& script) {
 // ========== Utility ==========
 
 std::string SDKBridge::ExtractJsonValue(const std::string& json, const std::string& key) {
-  std::string search = "\"" + key + "\":\"";
-  size_t start = json.find(search);
-  if (start == std::string::npos) {
+  // Top-level string member, escapes decoded; "" if absent or not a string
+  std::string value;
+  if (!JsonReader::FindString(json, key, value)) {
     return "";
   }
-  
-  start += search.length();
-  size_t end = json.find("\"", start);
-  if (end == std::string::npos) {
-    return "";
-  }
-  
-  return json.substr(start, end - start);
+  return value;
 }
 
 // ========== Private Helpers ==========
@@ -265,8 +307,8 @@ std::string SDKBridge::ExtractJsonValue(const std::string& json, const std::stri
 std::string SDKBridge::LoadSDKScript() {
   // Performance optimization: Use cached SDK if already loaded
   if (sdk_script_loaded_ && !cached_sdk_script_.empty()) {
-    std::cout << "[AnyWP] [SDKBridge] Using cached SDK (size: " 
-              << cached_sdk_script_.length() << " bytes)" << std::endl;
+    ANYWP_LOG_DEBUG(kLogComponent, "Using cached SDK (size: " +
+                    std::to_string(cached_sdk_script_.length()) + " bytes)");
     return cached_sdk_script_;
   }
   
@@ -288,8 +330,8 @@ std::string SDKBridge::LoadSDKScript() {
       sdk_file.close();
       
       if (!sdk_content.empty()) {
-        std::cout << "[AnyWP] [SDKBridge] SDK loaded from: " << sdk_path 
-                  << " (size: " << sdk_content.length() << " bytes)" << std::endl;
+        ANYWP_LOG_INFO(kLogComponent, "SDK loaded from: " + sdk_path +
+                       " (size: " + std::to_string(sdk_content.length()) + " bytes)");
         
         // Cache the SDK script for future use
         cached_sdk_script_ = sdk_content;
@@ -301,11 +343,11 @@ std::string SDKBridge::LoadSDKScript() {
   }
   
   // Fallback: Return error shim if SDK file not found
-  std::cout << "[AnyWP] [SDKBridge] WARNING: SDK file not found, using error shim" << std::endl;
-  std::cout << "[AnyWP] [SDKBridge] Tried paths:" << std::endl;
+  std::string tried;
   for (const auto& path : sdk_paths) {
-    std::cout << "[AnyWP] [SDKBridge]   - " << path << std::endl;
+    tried += (tried.empty() ? "" : ", ") + path;
   }
+  ANYWP_LOG_WARNING(kLogComponent, "SDK file not found, using error shim (tried: " + tried + ")");
   
   return R"(
 console.log('[AnyWP] Note: Full SDK should be loaded via <script src="../windows/anywp_sdk.js">');
@@ -320,28 +362,8 @@ if (!window.AnyWP) {
 }
 
 std::string SDKBridge::GetMessageType(const std::string& message) {
-  // Try to extract type field
-  std::string type = ExtractJsonValue(message, "type");
-  
-  if (!type.empty()) {
-    return type;
-  }
-  
-  // Fallback: check for known patterns
-  if (message.find("\"type\":\"sdkReady\"") != std::string::npos) return "sdkReady";
-  if (message.find("\"type\":\"sdkError\"") != std::string::npos) return "sdkError";
-  if (message.find("\"type\":\"IFRAME_DATA\"") != std::string::npos) return "IFRAME_DATA";
-  if (message.find("\"type\":\"OPEN_URL\"") != std::string::npos) return "OPEN_URL";
-  if (message.find("\"type\":\"openURL\"") != std::string::npos) return "openURL";
-  if (message.find("\"type\":\"READY\"") != std::string::npos) return "READY";
-  if (message.find("\"type\":\"ready\"") != std::string::npos) return "ready";
-  if (message.find("\"type\":\"LOG\"") != std::string::npos) return "LOG";
-  if (message.find("\"type\":\"console_log\"") != std::string::npos) return "console_log";
-  if (message.find("\"type\":\"saveState\"") != std::string::npos) return "saveState";
-  if (message.find("\"type\":\"loadState\"") != std::string::npos) return "loadState";
-  if (message.find("\"type\":\"clearState\"") != std::string::npos) return "clearState";
-  
-  return "";
+  // "type" is the SDK's first member, so this rarely reads past it
+  return ExtractJsonValue(message, "type");
 }
 
 }  // namespace anywp_engine
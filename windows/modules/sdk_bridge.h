@@ -5,7 +5,8 @@
 #include <wrl.h>
 #include <string>
 #include <functional>
-#include <map>
+
+#include "../utils/message_router.h"
 
 namespace anywp_engine {
 
@@ -19,6 +20,10 @@ namespace anywp_engine {
  * - Execute scripts in WebView
  * - Type-safe message handlers
  * 
+ * Every web message goes through HandleMessage(): known types dispatch to
+ * handler slots through MessageRouter's compile-time perfect hash, custom
+ * types registered by applications through its fallback map.
+ * 
  * Message Types:
  * - IFRAME_DATA: iframe click regions
  * - OPEN_URL: open external URL
@@ -42,7 +47,9 @@ public:
   void InjectSDK();
   void SetupMessageBridge();
 
-  // Message handling
+  // Message handling. Known types may be registered by slot or by any of
+  // their names; other names are custom types.
+  void SetHandler(MessageSlot slot, MessageHandler handler);
   void RegisterHandler(const std::string& message_type, MessageHandler handler);
   void UnregisterHandler(const std::string& message_type);
   void HandleMessage(const std::string& message);
@@ -67,9 +74,11 @@ public:
 private:
   std::string LoadSDKScript();
   std::string GetMessageType(const std::string& message);
+  void HandleSdkReady(const std::string& message);
+  void HandleSdkError(const std::string& message);
 
   Microsoft::WRL::ComPtr<ICoreWebView2> webview_;
-  std::map<std::string, MessageHandler> handlers_;
+  MessageRouter router_;
   
   // Performance optimization: Cache SDK script to avoid repeated file I/O
   static std::string cached_sdk_script_;
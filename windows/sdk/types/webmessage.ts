@@ -64,6 +64,111 @@ export type WebMessageData =
   | LogEventData
   | PowerStateChangeData;
 
+// ========== JavaScript -> C++ ==========
+//
+// Messages the page posts with chrome.webview.postMessage(). The engine's
+// C++ structs and decoders are generated from these interfaces
+// (windows/tools/webmessage_codegen), so a change here must keep to the
+// types the generator knows: string, number, boolean, string literal
+// unions, optional members.
+
+/**
+ * SDK loaded and verified (sent by the engine's injection check)
+ */
+export interface SdkReadyMessage {
+  type: 'sdkReady';
+  version?: string;
+}
+
+/**
+ * SDK failed to load (sent by the engine's injection check)
+ */
+export interface SdkErrorMessage {
+  type: 'sdkError';
+  error?: string;
+}
+
+/**
+ * Open a URL in the default browser
+ */
+export interface OpenUrlMessage {
+  type: 'openURL' | 'OPEN_URL';
+  url: string;
+}
+
+/**
+ * Wallpaper finished loading
+ */
+export interface ReadyMessage {
+  type: 'ready' | 'READY';
+  name?: string;
+}
+
+/**
+ * Log line for the engine log
+ */
+export interface LogMessage {
+  type: 'log' | 'LOG';
+  message: string;
+}
+
+/**
+ * Forwarded console output
+ */
+export interface ConsoleLogMessage {
+  type: 'console_log';
+  message: string;
+  level?: string;    // 'error' and 'warn' map to engine levels, the rest to info
+}
+
+/**
+ * Persist a value under a key
+ */
+export interface SaveStateMessage {
+  type: 'saveState';
+  key: string;
+  value: string;     // JSON.stringify() of the page's value
+  durability?: 'memory' | 'async' | 'sync';  // Default: async
+}
+
+/**
+ * Read a value back (answered with an AnyWP:stateLoaded event)
+ */
+export interface LoadStateMessage {
+  type: 'loadState';
+  key: string;
+}
+
+/**
+ * Remove all saved state
+ */
+export interface ClearStateMessage {
+  type: 'clearState';
+}
+
+/**
+ * Toggle mouse interaction
+ */
+export interface SetInteractiveMessage {
+  type: 'setInteractive';
+  interactive: boolean;
+}
+
+/**
+ * Union type of all messages sent to C++
+ */
+export type NativeMessageData =
+  | SdkReadyMessage
+  | SdkErrorMessage
+  | OpenUrlMessage
+  | ReadyMessage
+  | LogMessage
+  | ConsoleLogMessage
+  | SaveStateMessage
+  | LoadStateMessage
+  | ClearStateMessage
+  | SetInteractiveMessage;
+
 /**
  * WebMessage event from chrome.webview
  */
@@ -0,0 +1,240 @@
+// AnyWP Engine - Fuzz target for utils/json_reader.cpp
+//
+// Feeds arbitrary bytes to JsonReader and to the web-message parsers built
+// on it, and aborts if an invariant breaks:
+// - every document ends in END or ERROR within one token per input byte
+// - depth never exceeds JsonReader::kMaxDepth
+// - a decoded string compares equal to itself via TextEquals() and
+//   survives a ConfigJson::Quote() / Unescape() round trip
+// - JsonWriter::String() of any bytes reads back as exactly one STRING
+// - a reader over a JsonStructuralIndex, built by every kernel this CPU
+//   supports, yields the same tokens and error offset as a plain one
+//
+// With Clang and -DANYWP_LIBFUZZER=ON this is a libFuzzer target:
+//   fuzz_json_reader corpus_dir
+// Otherwise a built-in driver replays seed payloads and random mutations
+// of them (CTest runs it as a smoke test):
+//   fuzz_json_reader [iterations] [input files...]
+
+#include "../modules/iframe_detector.h"
+#include "../utils/config_json.h"
+#include "../utils/json_reader.h"
+#include "../utils/json_structural_index.h"
+#include "../utils/json_writer.h"
+#include "../utils/logger.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace anywp_engine;
+
+namespace {
+
+void Check(bool condition, const char* what) {
+  if (!condition) {
+    std::fprintf(stderr, "fuzz_json_reader: invariant failed: %s\n", what);
+    std::abort();
+  }
+}
+
+void CheckString(const JsonReader& reader) {
+  std::string decoded;
+  if (!reader.GetString(decoded)) {
+    return;  // Unpaired surrogate: rejected on decode only
+  }
+  Check(reader.TextEquals(decoded), "TextEquals(GetString())");
+  std::string quoted = ConfigJson::Quote(decoded);
+  std::string round_trip;
+  Check(JsonReader::Unescape(std::string_view(quoted).substr(1, quoted.size() - 2), round_trip),
+        "Unescape(Quote())");
+  Check(round_trip == decoded, "Quote() round trip");
+}
+
+void Tokenize(std::string_view input) {
+  JsonReader reader(input);
+  size_t tokens = 0;
+  while (true) {
+    JsonReader::Token token = reader.Next();
+    Check(++tokens <= input.size() + 1, "token count bounded by input size");
+    Check(reader.Depth() <= JsonReader::kMaxDepth, "depth bounded");
+    if (token == JsonReader::Token::END || token == JsonReader::Token::ERROR) {
+      Check(reader.Next() == token, "END/ERROR is final");
+      Check(token == JsonReader::Token::ERROR || reader.Depth() == 0, "END at depth 0");
+      return;
+    }
+    if (token == JsonReader::Token::KEY || token == JsonReader::Token::STRING) {
+      CheckString(reader);
+    } else if (token == JsonReader::Token::NUMBER) {
+      int integer = 0;
+      double real = 0;
+      reader.GetInt(integer);
+      reader.GetDouble(real);
+    }
+  }
+}
+
+void CompareIndexed(std::string_view input) {
+  static JsonStructuralIndex index;
+  for (auto kernel : {JsonStructuralIndex::Kernel::SCALAR, JsonStructuralIndex::Kernel::SSE2,
+                      JsonStructuralIndex::Kernel::AVX2, JsonStructuralIndex::Kernel::NEON}) {
+    if (!index.Build(input, kernel)) continue;
+    JsonReader plain(input);
+    JsonReader indexed(input, &index);
+    while (true) {
+      JsonReader::Token token = plain.Next();
+      Check(indexed.Next() == token, "indexed token matches");
+      Check(indexed.Text() == plain.Text(), "indexed text matches");
+      Check(indexed.HasEscapes() == plain.HasEscapes(), "indexed escapes match");
+      if (token == JsonReader::Token::ERROR) {
+        Check(indexed.ErrorOffset() == plain.ErrorOffset(), "indexed error offset matches");
+      }
+      if (token == JsonReader::Token::END || token == JsonReader::Token::ERROR) break;
+    }
+  }
+}
+
+void CheckWriter(std::string_view input) {
+  static JsonWriter writer;
+  writer.Clear();
+  writer.String(input);
+  JsonReader reader(writer.View());
+  Check(reader.Next() == JsonReader::Token::STRING, "writer emits a JSON string");
+  Check(reader.Next() == JsonReader::Token::END, "writer string is the whole document");
+}
+
+void RunOne(std::string_view input) {
+  Tokenize(input);
+  CompareIndexed(input);
+  CheckWriter(input);
+
+  // The consumers take std::string; same bytes
+  std::string message(input);
+  std::string value;
+  JsonReader::FindString(message, "type", value);
+  std::vector<IframeInfo> iframes;
+  IframeDetector::UpdateIframeVector(message, iframes);
+
+  // Skipping from the first value must land on its last token
+  JsonReader reader(input);
+  JsonReader::Token first = reader.Next();
+  if (first != JsonReader::Token::END && first != JsonReader::Token::ERROR && reader.SkipValue()) {
+    Check(reader.Depth() == 0, "SkipValue() returns to depth 0");
+  }
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  static bool quiet = [] {
+    Logger::Instance().EnableConsoleLogging(false);
+    return true;
+  }();
+  (void)quiet;
+  RunOne(std::string_view(reinterpret_cast<const char*>(data), size));
+  return 0;
+}
+
+#ifndef ANYWP_LIBFUZZER
+
+namespace {
+
+const char* const kSeeds[] = {
+    R"({"type":"IFRAME_DATA","iframes":[{"index":0,"id":"ad-1","src":"https://ads.example/f.html",)"
+    R"("bounds":{"left":10,"top":20,"width":300,"height":250},"clickUrl":"https://example.com",)"
+    R"("visible":true},{"id":"b","bounds":{"left":-1.5,"top":2e3},"visible":false}]})",
+    R"({"type":"saveState","key":"layout","value":"{\"clock\":{\"left\":12,\"top\":40}}",)"
+    R"("durability":"sync"})",
+    R"({"type":"console_log","level":"warn","message":"café 😀 \"quoted\"\n"})",
+    R"({"type":"OPEN_URL","url":"https:\/\/example.com\/?a=1&b=2"})",
+    R"([[[[[[[[{"a":[1,-0,0.5,1E+2,-3e-4,true,false,null,"",{}]}]]]]]]]])",
+    R"({"key":"\ud800","x":"\udc00"})",
+};
+
+struct Random {
+  uint64_t state = 0x9E3779B97F4A7C15ull;
+  uint64_t Next() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+  size_t Below(size_t n) { return n == 0 ? 0 : static_cast<size_t>(Next() % n); }
+};
+
+// Bytes that steer the tokenizer into its interesting branches
+constexpr char kAlphabet[] = "{}[]\",:\\/u0123456789abcdefABCDEF-+.eEtrufalsn \t\r\n\x01\x7f\xc3\xa9";
+
+std::string Mutate(const std::string& seed, Random& random) {
+  std::string data = seed;
+  size_t edits = 1 + random.Below(4);
+  for (size_t e = 0; e < edits; e++) {
+    size_t at = random.Below(data.size() + 1);
+    switch (random.Below(5)) {
+      case 0:  // Replace
+        if (at < data.size()) data[at] = kAlphabet[random.Below(sizeof(kAlphabet) - 1)];
+        break;
+      case 1:  // Insert
+        data.insert(at, 1, kAlphabet[random.Below(sizeof(kAlphabet) - 1)]);
+        break;
+      case 2:  // Erase a run
+        if (at < data.size()) data.erase(at, 1 + random.Below(8));
+        break;
+      case 3:  // Truncate
+        data.resize(at);
+        break;
+      default: {  // Duplicate a slice
+        size_t from = random.Below(data.size() + 1);
+        size_t length = random.Below(32);
+        data.insert(at, data.substr(from, length));
+        break;
+      }
+    }
+  }
+  return data;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Logger::Instance().EnableConsoleLogging(false);
+
+  size_t iterations = 10000;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; i++) {
+    char* end = nullptr;
+    unsigned long long count = std::strtoull(argv[i], &end, 10);
+    if (end != argv[i] && *end == '\0') {
+      iterations = static_cast<size_t>(count);
+      continue;
+    }
+    std::ifstream file(argv[i], std::ios::binary);
+    if (!file) {
+      std::fprintf(stderr, "fuzz_json_reader: cannot read %s\n", argv[i]);
+      return 1;
+    }
+    inputs.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  for (const char* seed : kSeeds) {
+    inputs.emplace_back(seed);
+  }
+
+  for (const std::string& input : inputs) {
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+  }
+  Random random;
+  for (size_t i = 0; i < iterations; i++) {
+    std::string data = Mutate(inputs[random.Below(inputs.size())], random);
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+  }
+  std::printf("fuzz_json_reader: %zu inputs, %zu mutations OK\n", inputs.size(), iterations);
+  return 0;
+}
+
+#endif  // ANYWP_LIBFUZZER
@@ -0,0 +1,1424 @@
+// AnyWP Engine - Portable performance benchmarks
+//
+// Micro-benchmarks for the Win32-independent hot paths (logging, ...).
+// Builds on Windows and Linux; run the perf_benchmarks executable directly.
+//
+// Usage:
+//   perf_benchmarks            Run every benchmark
+//   perf_benchmarks <filter>   Run benchmarks whose name contains <filter>
+
+#include "../modules/iframe_detector.h"
+#include "../utils/config_json.h"
+#include "../utils/config_manager.h"
+#include "../utils/event_bus.h"
+#include "../utils/event_history.h"
+#include "../utils/event_types.h"
+#include "../utils/json_reader.h"
+#include "../utils/json_structural_index.h"
+#include "../utils/json_writer.h"
+#include "../utils/logger.h"
+#include "../utils/message_router.h"
+#include "../utils/log_flight_recorder.h"
+#include "../utils/log_formatter.h"
+#include "../utils/state_cache.h"
+#include "../utils/state_hash_file.h"
+#include "../utils/state_journal.h"
+#include "webmessage_types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace anywp_engine;
+
+// ========== Allocation counting ==========
+// Global operator new replacement so benchmarks can report heap
+// allocations per operation.
+
+namespace {
+std::atomic<size_t> g_allocations{0};
+
+// Out of line on purpose: inlined into operator new, the malloc is visible
+// to GCC, which then flags every matching operator delete
+// (-Wmismatched-new-delete)
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void* CountedAllocate(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void CountedFree(void* p) noexcept {
+  std::free(p);
+}
+}  // namespace
+
+void* operator new(std::size_t size) {
+  return CountedAllocate(size);
+}
+
+void* operator new[](std::size_t size) {
+  return CountedAllocate(size);
+}
+
+void operator delete(void* p) noexcept {
+  CountedFree(p);
+}
+
+void operator delete[](void* p) noexcept {
+  CountedFree(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  CountedFree(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+  CountedFree(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkCase {
+  std::string name;
+  std::function<void()> run;
+};
+
+std::vector<BenchmarkCase>& Registry() {
+  static std::vector<BenchmarkCase> cases;
+  return cases;
+}
+
+void Register(const std::string& name, std::function<void()> run) {
+  Registry().push_back({name, std::move(run)});
+}
+
+std::string TempPath(const std::string& name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+void PrintHeader(const char* title) {
+  std::printf("\n=== %s ===\n", title);
+}
+
+// ========== Logger: synchronous vs asynchronous ==========
+
+struct CallerLatency {
+  double avg_ns = 0.0;
+  double max_ns = 0.0;
+  double total_ms = 0.0;   // Wall time until every producer returned
+  double drain_ms = 0.0;   // Extra time until Flush() returned
+};
+
+CallerLatency RunLoggerWorkload(bool async, int threads, int per_thread) {
+  std::string path = TempPath(async ? "anywp_bench_async.log" : "anywp_bench_sync.log");
+  std::filesystem::remove(path);
+
+  Logger& logger = Logger::Instance();
+  logger.EnableConsoleLogging(false);
+  logger.SetMinLevel(Logger::Level::DEBUG);
+  logger.EnableFileLogging(path);
+  if (async) {
+    logger.EnableAsync(true, 16384, Logger::OverflowPolicy::BLOCK);
+  }
+
+  std::vector<double> sum_ns(threads, 0.0);
+  std::vector<double> max_ns(threads, 0.0);
+  const std::string component = "MouseHookManager";
+  const std::string message = "Event: 512 at (1280,720) WindowAtPoint: 0x000A01F2 ClassName: WorkerW";
+
+  auto start = Clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      for (int i = 0; i < per_thread; i++) {
+        auto call_start = Clock::now();
+        logger.Debug(component, message);
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - call_start).count();
+        sum_ns[t] += ns;
+        max_ns[t] = std::max(max_ns[t], ns);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  auto produced = Clock::now();
+  logger.Flush();
+  auto drained = Clock::now();
+
+  logger.EnableAsync(false);
+  logger.DisableFileLogging();
+  logger.SetMinLevel(Logger::Level::INFO);
+  logger.EnableConsoleLogging(true);
+  std::filesystem::remove(path);
+
+  CallerLatency result;
+  double total_ns = 0.0;
+  for (int t = 0; t < threads; t++) {
+    total_ns += sum_ns[t];
+    result.max_ns = std::max(result.max_ns, max_ns[t]);
+  }
+  result.avg_ns = total_ns / (static_cast<double>(threads) * per_thread);
+  result.total_ms = std::chrono::duration<double, std::milli>(produced - start).count();
+  result.drain_ms = std::chrono::duration<double, std::milli>(drained - produced).count();
+  return result;
+}
+
+void BenchmarkLoggerSyncVsAsync() {
+  PrintHeader("Logger: caller-thread cost, file sink (sync vs async)");
+  std::printf("%-8s %8s %12s %14s %12s %12s\n",
+              "mode", "threads", "avg ns/call", "max us/call", "produce ms", "drain ms");
+
+  const int kPerThread = 20000;
+  for (int threads : {1, 4}) {
+    for (bool async : {false, true}) {
+      CallerLatency r = RunLoggerWorkload(async, threads, kPerThread);
+      std::printf("%-8s %8d %12.0f %14.1f %12.1f %12.1f\n",
+                  async ? "async" : "sync", threads, r.avg_ns, r.max_ns / 1000.0,
+                  r.total_ms, r.drain_ms);
+    }
+  }
+}
+
+// ========== Logger: cost of a filtered-out DEBUG line ==========
+
+// Keeps the compiler from deleting benchmark loops
+volatile int g_sink = 0;
+
+template <typename Body>
+double NanosPerIteration(int iterations, Body body) {
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    body(i);
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+void BenchmarkDisabledLogSite() {
+  PrintHeader("Logger: filtered-out DEBUG line (min level INFO)");
+
+  Logger::Instance().EnableConsoleLogging(false);
+  Logger::Instance().SetMinLevel(Logger::Level::INFO);
+
+  const int kIterations = 10000000;
+  const std::string event_type = "monitor.changed";
+
+  double baseline = NanosPerIteration(kIterations, [](int i) { g_sink = i; });
+  double macro_site = NanosPerIteration(kIterations, [&](int i) {
+    g_sink = i;
+    ANYWP_LOG_DEBUG("EventBus", "Subscribed to '" + event_type + "' (ID: " +
+                    std::to_string(i) + ", Priority: 0)");
+  });
+  double eager_call = NanosPerIteration(kIterations / 10, [&](int i) {
+    g_sink = i;
+    Logger::Instance().Debug("EventBus", "Subscribed to '" + event_type + "' (ID: " +
+                             std::to_string(i) + ", Priority: 0)");
+  });
+  double eager_literal = NanosPerIteration(kIterations, [&](int i) {
+    g_sink = i;
+    Logger::Instance().Debug("EventBus", "Subscribed");
+  });
+
+  std::printf("%-44s %10.2f ns\n", "empty loop (baseline)", baseline);
+  std::printf("%-44s %10.2f ns\n", "ANYWP_LOG_DEBUG, disabled site", macro_site);
+  std::printf("%-44s %10.2f ns\n", "Logger::Debug, concatenated message", eager_call);
+  std::printf("%-44s %10.2f ns\n", "Logger::Debug, string literal", eager_literal);
+  std::printf("disabled site overhead over baseline: %.2f ns\n", macro_site - baseline);
+
+  Logger::Instance().EnableConsoleLogging(true);
+}
+
+// ========== Logger: line formatting ==========
+
+// Pre-formatter implementation (ostringstream + put_time), for comparison
+std::string StreamFormat(Logger::Level level, const std::string& component,
+                         const std::string& message,
+                         const std::chrono::system_clock::time_point& now) {
+  auto time_t_now = std::chrono::system_clock::to_time_t(now);
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      now.time_since_epoch()) % 1000;
+  std::tm tm_now;
+#ifdef _WIN32
+  localtime_s(&tm_now, &time_t_now);
+#else
+  localtime_r(&time_t_now, &tm_now);
+#endif
+  std::ostringstream ts;
+  ts << std::put_time(&tm_now, "%Y-%m-%d %H:%M:%S");
+  ts << '.' << std::setfill('0') << std::setw(3) << ms.count();
+
+  std::string level_name = level == Logger::Level::DEBUG ? "DEBUG" : "INFO";
+  std::ostringstream oss;
+  oss << "[" << ts.str() << "] "
+      << "[" << level_name << "] "
+      << "[" << component << "] "
+      << message;
+  return oss.str();
+}
+
+void BenchmarkLogFormatter() {
+  PrintHeader("Logger: line formatting (ostringstream vs LogFormatter)");
+
+  const int kIterations = 1000000;
+  const std::string component = "MouseHookManager";
+  const std::string message = "Event: 512 at (1280,720) WindowAtPoint: 0x000A01F2 ClassName: WorkerW";
+  auto start_time = std::chrono::system_clock::now();
+
+  // Timestamps advance 1 ms per line, so the second cache refreshes every 1000 lines
+  auto run = [&](auto format) {
+    size_t allocations_before = g_allocations.load();
+    double ns = NanosPerIteration(kIterations, [&](int i) {
+      auto now = start_time + std::chrono::milliseconds(i);
+      g_sink = static_cast<int>(format(now));
+    });
+    double allocs = static_cast<double>(g_allocations.load() - allocations_before) / kIterations;
+    return std::make_pair(ns, allocs);
+  };
+
+  auto stream = run([&](const std::chrono::system_clock::time_point& now) {
+    return StreamFormat(Logger::Level::DEBUG, component, message, now).size();
+  });
+  auto formatter = run([&](const std::chrono::system_clock::time_point& now) {
+    return LogFormatter::Format(Logger::Level::DEBUG, component, message, now).size();
+  });
+
+  std::printf("%-36s %10s %14s\n", "formatter", "ns/line", "allocs/line");
+  std::printf("%-36s %10.1f %14.2f\n", "ostringstream + put_time", stream.first, stream.second);
+  std::printf("%-36s %10.1f %14.2f\n", "LogFormatter", formatter.first, formatter.second);
+  std::printf("speedup: %.1fx\n", stream.first / formatter.first);
+}
+
+// ========== Logger: DEBUG storm with and without a rate limit ==========
+
+void BenchmarkRateLimitedStorm() {
+  PrintHeader("Logger: DEBUG storm to the file sink, 1 thread (unlimited vs 20 lines/s)");
+
+  std::string path = TempPath("anywp_bench_storm.log");
+  const int kIterations = 200000;
+  const std::string event_type = "mousemove";
+
+  auto run = [&](bool limited) {
+    std::filesystem::remove(path);
+    Logger& logger = Logger::Instance();
+    logger.EnableConsoleLogging(false);
+    logger.SetMinLevel(Logger::Level::DEBUG);
+    logger.EnableFileLogging(path);
+    if (limited) {
+      logger.SetRateLimit("MouseHook", Logger::Level::DEBUG, 20.0, 50);
+    }
+
+    double ns = NanosPerIteration(kIterations, [&](int i) {
+      ANYWP_LOG_DEBUG("MouseHook", "Event: " + event_type + " at (" + std::to_string(i) + ",720)");
+    });
+
+    logger.ClearRateLimits();
+    logger.DisableFileLogging();
+    logger.SetMinLevel(Logger::Level::INFO);
+    logger.EnableConsoleLogging(true);
+    std::filesystem::remove(path);
+    return ns;
+  };
+
+  double unlimited = run(false);
+  double limited = run(true);
+  std::printf("%-36s %10.1f ns/call\n", "unlimited", unlimited);
+  std::printf("%-36s %10.1f ns/call\n", "rate limited (suppressed lines)", limited);
+}
+
+// ========== Logger: flight recorder vs unbuffered file sink ==========
+
+void BenchmarkFlightRecorder() {
+  PrintHeader("Logger: sync sink cost per line (unbuffered file vs flight recorder)");
+
+  const int kIterations = 200000;
+  const std::string message = "Event: 512 at (1280,720) WindowAtPoint: 0x000A01F2 ClassName: WorkerW";
+  std::string file_path = TempPath("anywp_bench_sink.log");
+  std::string ring_path = TempPath("anywp_bench_sink.ring");
+  std::filesystem::remove(file_path);
+  std::filesystem::remove(ring_path);
+
+  Logger& logger = Logger::Instance();
+  logger.EnableConsoleLogging(false);
+
+  logger.EnableFileLogging(file_path);
+  double file_ns = NanosPerIteration(kIterations, [&](int) { logger.Info("MouseHook", message); });
+  logger.DisableFileLogging();
+
+  logger.EnableFlightRecorder(ring_path, 4 * 1024 * 1024);
+  double ring_ns = NanosPerIteration(kIterations, [&](int) { logger.Info("MouseHook", message); });
+  logger.DisableFlightRecorder();
+
+  LogFlightRecorder recorder;
+  recorder.Open(ring_path, 4 * 1024 * 1024);
+  double append_ns = NanosPerIteration(kIterations, [&](int) { recorder.Append(message); });
+  recorder.Close();
+
+  logger.EnableConsoleLogging(true);
+  std::filesystem::remove(file_path);
+  std::filesystem::remove(ring_path);
+
+  std::printf("%-40s %10.1f ns/line\n", "Logger -> file (write + flush per line)", file_ns);
+  std::printf("%-40s %10.1f ns/line\n", "Logger -> flight recorder", ring_ns);
+  std::printf("%-40s %10.1f ns/line\n", "LogFlightRecorder::Append only", append_ns);
+}
+
+// ========== Logger: caller latency across rotations ==========
+
+void BenchmarkRotationLatency() {
+  PrintHeader("Logger: caller latency with rotation every 1MB (sync file sink)");
+  std::printf("%-22s %10s %12s %12s %12s\n", "mode", "rotations", "p50 ns", "p99.99 us", "max us");
+
+  const int kLines = 200000;
+  const std::string message = "Event: 512 at (1280,720) WindowAtPoint: 0x000A01F2 ClassName: WorkerW";
+  std::string path = TempPath("anywp_bench_rotate.log");
+
+  for (bool rotate : {false, true}) {
+    for (const auto& archive : LogRotator::ListArchives(path)) {
+      std::filesystem::remove(archive);
+    }
+    std::filesystem::remove(path);
+
+    Logger& logger = Logger::Instance();
+    logger.EnableConsoleLogging(false);
+    logger.EnableFileLogging(path);
+    logger.SetRotationPolicy(3, 0, true);
+    logger.EnableRotation(rotate ? 1024 * 1024 : static_cast<size_t>(-1));
+    size_t rotations_before = logger.GetStatistics()["Rotations"];
+
+    std::vector<double> latencies(kLines);
+    for (int i = 0; i < kLines; i++) {
+      auto start = Clock::now();
+      logger.Info("MouseHook", message);
+      latencies[i] = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+    logger.Flush();
+    size_t rotations = logger.GetStatistics()["Rotations"] - rotations_before;
+
+    logger.DisableFileLogging();
+    logger.EnableRotation(static_cast<size_t>(-1));
+    logger.SetRotationPolicy(5, 50 * 1024 * 1024, true);
+    logger.EnableConsoleLogging(true);
+
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("%-22s %10zu %12.0f %12.1f %12.1f\n",
+                rotate ? "rotation (background)" : "no rotation", rotations,
+                latencies[kLines / 2], latencies[kLines - kLines / 10000] / 1000.0,
+                latencies.back() / 1000.0);
+  }
+
+  for (const auto& archive : LogRotator::ListArchives(path)) {
+    std::filesystem::remove(archive);
+  }
+  std::filesystem::remove(path);
+}
+
+// ========== EventBus: publish throughput vs subscriber count ==========
+
+// The pre-snapshot Publish: lock, copy the subscriber vector, unlock, call
+class MutexCopyBus {
+public:
+  void Subscribe(const std::string& type, EventHandler handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscribers_[type].push_back(std::move(handler));
+  }
+
+  void Publish(const Event& event) {
+    std::vector<EventHandler> handlers;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = subscribers_.find(event.type);
+      if (it != subscribers_.end()) {
+        handlers = it->second;
+      }
+    }
+    for (const auto& handler : handlers) {
+      handler(event);
+    }
+  }
+
+private:
+  std::map<std::string, std::vector<EventHandler>> subscribers_;
+  std::mutex mutex_;
+};
+
+thread_local size_t t_handler_work = 0;
+
+struct PublishResult {
+  double ns_per_publish = 0.0;     // Wall time / publishes per thread
+  double million_per_sec = 0.0;    // Aggregate publishes across threads
+  double allocs_per_publish = 0.0;
+};
+
+template <typename PublishFn>
+PublishResult RunPublishWorkload(int threads, int per_thread, PublishFn publish) {
+  PublishResult result;
+  {
+    // Heap traffic of the publish itself (single thread, event built up front)
+    const int kSamples = 1000;
+    Event event("bench.tick", "Bench");
+    size_t allocs_before = g_allocations.load();
+    for (int i = 0; i < kSamples; i++) {
+      publish(event);
+    }
+    result.allocs_per_publish = static_cast<double>(g_allocations.load() - allocs_before) / kSamples;
+  }
+
+  auto start = Clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&] {
+      Event event("bench.tick", "Bench");
+      for (int i = 0; i < per_thread; i++) {
+        publish(event);
+      }
+      g_sink = g_sink + static_cast<int>(t_handler_work);
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+  double total = static_cast<double>(threads) * per_thread;
+  result.ns_per_publish = ns / per_thread;
+  result.million_per_sec = total / ns * 1000.0;
+  return result;
+}
+
+void BenchmarkEventBusPublish() {
+  PrintHeader("EventBus: publish throughput (trivial handlers)");
+  std::printf("%-14s %6s %8s %14s %12s %14s\n",
+              "bus", "subs", "threads", "ns/publish", "Mpub/s", "allocs/publish");
+
+  EventBus& bus = EventBus::Instance();
+  Logger::Instance().EnableConsoleLogging(false);
+  EventHandler handler = [](const Event& e) { t_handler_work += e.type.size(); };
+
+  for (int subscribers : {1, 10, 100}) {
+    const int per_thread = 2000000 / subscribers;
+
+    bus.Clear();
+    MutexCopyBus legacy;
+    for (int i = 0; i < subscribers; i++) {
+      bus.Subscribe("bench.tick", handler);
+      legacy.Subscribe("bench.tick", handler);
+    }
+
+    for (int threads : {1, 4}) {
+      PublishResult before = RunPublishWorkload(threads, per_thread,
+          [&](const Event& e) { legacy.Publish(e); });
+      PublishResult after = RunPublishWorkload(threads, per_thread,
+          [&](const Event& e) { bus.Publish(e); });
+      std::printf("%-14s %6d %8d %14.1f %12.2f %14.2f\n", "mutex+copy", subscribers, threads,
+                  before.ns_per_publish, before.million_per_sec, before.allocs_per_publish);
+      std::printf("%-14s %6d %8d %14.1f %12.2f %14.2f\n", "snapshot", subscribers, threads,
+                  after.ns_per_publish, after.million_per_sec, after.allocs_per_publish);
+    }
+  }
+
+  bus.Clear();
+  Logger::Instance().EnableConsoleLogging(true);
+}
+
+// ========== EventBus: publisher cost with a slow handler ==========
+
+void BenchmarkEventBusPublishAsync() {
+  PrintHeader("EventBus: publisher cost with a 50 us handler (Publish vs PublishAsync)");
+  std::printf("%-14s %12s %12s %16s %16s\n",
+              "mode", "avg us/call", "max us/call", "queue avg us", "queue max us");
+
+  const int kEvents = 2000;
+  EventBus& bus = EventBus::Instance();
+  Logger::Instance().EnableConsoleLogging(false);
+  bus.ConfigureAsyncDispatch(1, kEvents, EventExecutor::OverflowPolicy::BLOCK);
+  bus.Clear();
+  bus.Subscribe("bench.slow", [](const Event&) {
+    auto until = Clock::now() + std::chrono::microseconds(50);
+    while (Clock::now() < until) {
+    }
+  });
+
+  for (bool async : {false, true}) {
+    Event event("bench.slow", "Bench");
+    double sum_ns = 0.0;
+    double max_ns = 0.0;
+    for (int i = 0; i < kEvents; i++) {
+      auto start = Clock::now();
+      if (async) {
+        bus.PublishAsync(event);
+      } else {
+        bus.Publish(event);
+      }
+      double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+      sum_ns += ns;
+      max_ns = std::max(max_ns, ns);
+    }
+    bus.FlushAsync();
+
+    EventExecutor::TopicMetrics metrics = bus.GetTopicMetrics()["bench.slow"];
+    std::printf("%-14s %12.2f %12.1f %16.1f %16.1f\n",
+                async ? "PublishAsync" : "Publish", sum_ns / kEvents / 1000.0, max_ns / 1000.0,
+                metrics.avg_latency_us, metrics.max_latency_us);
+  }
+
+  bus.Clear();
+  bus.ConfigureAsyncDispatch(1, 1024, EventExecutor::OverflowPolicy::DROP_OLDEST);
+  Logger::Instance().EnableConsoleLogging(true);
+}
+
+// ========== EventBus: string events vs typed payloads ==========
+
+void BenchmarkEventBusTyped() {
+  PrintHeader("EventBus: build + publish monitor.changed, 1 subscriber (Event vs typed struct)");
+  std::printf("%-28s %12s %16s\n", "api", "ns/publish", "allocs/publish");
+
+  const int kIterations = 200000;
+  EventBus& bus = EventBus::Instance();
+  Logger::Instance().EnableConsoleLogging(false);
+  bus.ConfigureAsyncDispatch(1, kIterations, EventExecutor::OverflowPolicy::BLOCK);
+
+  auto run = [&](const char* name, auto publish) {
+    size_t allocations_before = g_allocations.load();
+    double ns = NanosPerIteration(kIterations, publish);
+    bus.FlushAsync();
+    double allocs = static_cast<double>(g_allocations.load() - allocations_before) / kIterations;
+    std::printf("%-28s %12.1f %16.2f\n", name, ns, allocs);
+  };
+
+  auto publish_event = [&](int i, bool async) {
+    Event event("monitor.changed", "DisplayManager");
+    event.SetData("monitor_count", i & 3);
+    event.SetData("primary_index", 0);
+    if (async) {
+      bus.PublishAsync(event);
+    } else {
+      bus.Publish(event);
+    }
+  };
+
+  bus.Clear();
+  bus.Subscribe("monitor.changed", [](const Event& e) {
+    t_handler_work += static_cast<size_t>(e.GetData<int>("monitor_count", 0));
+  });
+  run("Publish(Event)", [&](int i) { publish_event(i, false); });
+  run("PublishAsync(Event)", [&](int i) { publish_event(i, true); });
+
+  bus.Clear();
+  bus.Subscribe<MonitorChanged>([](const MonitorChanged& m) {
+    t_handler_work += static_cast<size_t>(m.monitor_count);
+  });
+  run("Publish(MonitorChanged)", [&](int i) { bus.Publish(MonitorChanged{i & 3, 0}); });
+  run("PublishAsync(MonitorChanged)", [&](int i) { bus.PublishAsync(MonitorChanged{i & 3, 0}); });
+
+  bus.Clear();
+  bus.ConfigureAsyncDispatch(1, 1024, EventExecutor::OverflowPolicy::DROP_OLDEST);
+  Logger::Instance().EnableConsoleLogging(true);
+}
+
+// ========== EventBus: exact vs wildcard subscribers ==========
+
+void BenchmarkEventBusWildcard() {
+  PrintHeader("EventBus: publish wallpaper.navigation.started, 1 subscriber (exact vs pattern)");
+  std::printf("%-28s %12s %16s\n", "subscription", "ns/publish", "allocs/publish");
+
+  const int kIterations = 1000000;
+  EventBus& bus = EventBus::Instance();
+  Logger::Instance().EnableConsoleLogging(false);
+  EventHandler handler = [](const Event& e) { t_handler_work += e.type.size(); };
+  Event event("wallpaper.navigation.started", "Bench");
+
+  for (const char* subscription : {"wallpaper.navigation.started", "wallpaper.**",
+                                   "wallpaper.*.started"}) {
+    bus.Clear();
+    bus.Subscribe(subscription, handler);
+    // Unrelated patterns, as a real application would have
+    bus.Subscribe("monitor.*", handler);
+    bus.Subscribe("webview.**", handler);
+    bus.Publish(event);  // Fill the per-topic cache
+
+    size_t allocations_before = g_allocations.load();
+    double ns = NanosPerIteration(kIterations, [&](int) { bus.Publish(event); });
+    double allocs = static_cast<double>(g_allocations.load() - allocations_before) / kIterations;
+    std::printf("%-28s %12.1f %16.2f\n", subscription, ns, allocs);
+  }
+
+  bus.Clear();
+  Logger::Instance().EnableConsoleLogging(true);
+}
+
+// ========== EventBus: history append and query ==========
+
+void BenchmarkEventHistory() {
+  PrintHeader("EventHistory: append at capacity and 30 s query (vector+erase vs ring)");
+  std::printf("%-22s %10s %14s %16s %14s\n",
+              "history", "capacity", "ns/append", "allocs/append", "us/query");
+
+  const int kIterations = 200000;
+  TopicId monitor = TopicRegistry::Instance().Intern("monitor.changed");
+  TopicId other = TopicRegistry::Instance().Intern("bench.history");
+
+  auto make_event = [](int i) {
+    Event event(i % 10 ? "bench.history" : "monitor.changed", "Bench");
+    event.SetData("monitor_count", i & 3);
+    return event;
+  };
+
+  for (size_t capacity : {1000, 10000}) {
+    // The previous EventBus history: copy in, erase(begin()) once full, scan to query
+    std::vector<Event> legacy;
+    size_t allocations_before = g_allocations.load();
+    double legacy_ns = NanosPerIteration(kIterations, [&](int i) {
+      legacy.push_back(make_event(i));
+      if (legacy.size() > capacity) {
+        legacy.erase(legacy.begin());
+      }
+    });
+    double legacy_allocs = static_cast<double>(g_allocations.load() - allocations_before) / kIterations;
+    auto since = std::chrono::system_clock::now() - std::chrono::seconds(30);
+    double legacy_query_ns = NanosPerIteration(100, [&](int) {
+      std::vector<Event> matches;
+      for (const auto& event : legacy) {
+        if (event.type == "monitor.changed" && event.timestamp >= since) {
+          matches.push_back(event);
+        }
+      }
+      g_sink = static_cast<int>(matches.size());
+    });
+
+    EventHistory ring(capacity, capacity * 1024);
+    allocations_before = g_allocations.load();
+    double ring_ns = NanosPerIteration(kIterations, [&](int i) {
+      auto event = std::make_shared<const Event>(make_event(i));
+      ring.Append(i % 10 ? other : monitor, std::move(event));
+    });
+    double ring_allocs = static_cast<double>(g_allocations.load() - allocations_before) / kIterations;
+    double ring_query_ns = NanosPerIteration(100, [&](int) {
+      g_sink = static_cast<int>(ring.Query(monitor, std::chrono::seconds(30)).size());
+    });
+
+    std::printf("%-22s %10zu %14.1f %16.2f %14.2f\n", "vector+erase", capacity,
+                legacy_ns, legacy_allocs, legacy_query_ns / 1000.0);
+    std::printf("%-22s %10zu %14.1f %16.2f %14.2f\n", "ring+index", capacity,
+                ring_ns, ring_allocs, ring_query_ns / 1000.0);
+  }
+}
+
+// ========== ConfigManager: contended reads ==========
+
+void BenchmarkConfigContendedGet() {
+  PrintHeader("ConfigManager: read webview.max_cache_size_mb (Get<int>(key) vs ConfigKey<int>)");
+  std::printf("%-16s %8s %10s %12s %16s\n", "api", "readers", "writer", "ns/read", "allocs/read");
+
+  const int kReadsPerThread = 500000;
+  ConfigManager& config = ConfigManager::Instance();
+  Logger::Instance().EnableConsoleLogging(false);
+  config.Clear();
+  static const ConfigKey<int> kMaxCache("webview.max_cache_size_mb", 100);
+
+  for (bool typed : {false, true}) {
+    for (int readers : {1, 4}) {
+      for (bool writing : {false, true}) {
+        std::atomic<bool> done{false};
+        std::thread writer;
+        if (writing) {
+          // A config change every ~10 us: far busier than any real application
+          writer = std::thread([&] {
+            for (int i = 0; !done; i++) {
+              config.Set("webview.max_cache_size_mb", 100 + (i & 7));
+              std::this_thread::sleep_for(std::chrono::microseconds(10));
+            }
+          });
+        }
+
+        std::vector<double> ns(readers, 0.0);
+        size_t allocations_before = g_allocations.load();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < readers; t++) {
+          workers.emplace_back([&, t] {
+            int sum = 0;
+            ns[t] = NanosPerIteration(kReadsPerThread, [&](int) {
+              sum += typed ? kMaxCache.Get()
+                           : config.Get<int>("webview.max_cache_size_mb", 100);
+            });
+            g_sink = sum;
+          });
+        }
+        for (auto& worker : workers) {
+          worker.join();
+        }
+        size_t allocations = g_allocations.load() - allocations_before;
+        done = true;
+        if (writer.joinable()) {
+          writer.join();
+        }
+
+        double avg_ns = 0.0;
+        for (double n : ns) {
+          avg_ns += n / readers;
+        }
+        std::printf("%-16s %8d %10s %12.1f %16.3f\n", typed ? "ConfigKey<int>" : "Get<int>(key)",
+                    readers, writing ? "Set/10us" : "idle", avg_ns,
+                    static_cast<double>(allocations) / (static_cast<double>(readers) * kReadsPerThread));
+      }
+    }
+  }
+
+  config.Clear();
+  Logger::Instance().EnableConsoleLogging(true);
+}
+
+// ========== StateJournal: one small write into a large store ==========
+
+void BenchmarkStateJournal() {
+  PrintHeader("State store: save one 8-byte value (full-file rewrite vs journal append)");
+  std::printf("%-16s %8s %12s %14s\n", "store", "keys", "us/save", "bytes/save");
+
+  std::string directory = TempPath("anywp_bench_state");
+  auto fill = [](size_t keys) {
+    std::map<std::string, std::string> state;
+    for (size_t i = 0; i < keys; i++) {
+      state["wallpaper.setting." + std::to_string(i)] = std::string(24, 'v');
+    }
+    return state;
+  };
+
+  for (size_t keys : {100, 10000}) {
+    std::map<std::string, std::string> state = fill(keys);
+
+    // The previous StatePersistence::SaveState: rewrite the whole file
+    std::string legacy_path = TempPath("anywp_bench_state_legacy.json");
+    const int kLegacySaves = keys > 1000 ? 200 : 2000;
+    uintmax_t legacy_bytes = 0;
+    double legacy_ns = NanosPerIteration(kLegacySaves, [&](int i) {
+      state["clock.tick"] = std::to_string(10000000 + i);
+      std::ofstream file(legacy_path);
+      file << "{\n";
+      bool first = true;
+      for (const auto& pair : state) {
+        file << (first ? "" : ",\n") << "  \"" << pair.first << "\": \"" << pair.second << "\"";
+        first = false;
+      }
+      file << "\n}\n";
+    });
+    legacy_bytes = std::filesystem::file_size(legacy_path);
+    std::filesystem::remove(legacy_path);
+
+    std::printf("%-16s %8zu %12.2f %14ju\n", "rewrite", keys, legacy_ns / 1000.0, legacy_bytes);
+
+    // SYNC appends every save; ASYNC coalesces the burst into a few flushes
+    for (auto durability : {StateJournal::Durability::SYNC, StateJournal::Durability::ASYNC}) {
+      std::filesystem::remove_all(directory);
+      StateJournal journal(directory);
+      journal.Open();
+      journal.Replace(state);
+      const int kSaves = 20000;
+      StateJournal::Stats before = journal.GetStats();
+      double journal_ns = NanosPerIteration(kSaves, [&](int i) {
+        journal.Put("clock.tick", std::to_string(10000000 + i), durability);
+      });
+      journal.Flush();
+      journal.WaitForCompaction();
+      // Records appended plus the snapshots compaction wrote, per save
+      uint64_t journal_bytes = (journal.GetStats().written_bytes - before.written_bytes) / kSaves;
+
+      std::printf("%-16s %8zu %12.2f %14ju\n",
+                  durability == StateJournal::Durability::SYNC ? "journal sync" : "journal async",
+                  keys, journal_ns / 1000.0, static_cast<uintmax_t>(journal_bytes));
+    }
+  }
+
+  // Replay: 10k-key snapshot plus 10k journal records
+  {
+    StateJournal::Options options;
+    options.compact_min_bytes = SIZE_MAX;
+    std::filesystem::remove_all(directory);
+    StateJournal journal(directory, options);
+    journal.Open();
+    journal.Replace(fill(10000));
+    for (int i = 0; i < 10000; i++) {
+      journal.Put("wallpaper.setting." + std::to_string(i), "updated");
+    }
+    journal.Close();
+
+    auto start = Clock::now();
+    journal.Open();
+    double open_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::printf("Open() of 10000 keys + %zu journal records: %.2f ms\n",
+                journal.GetStats().replayed_records, open_ms);
+    journal.Close();
+  }
+  std::filesystem::remove_all(directory);
+}
+
+// ========== State: cached vs on-disk reads ==========
+
+void BenchmarkStateCache() {
+  PrintHeader("State store: LoadState of a 16 KB value (1000 keys, 4 MB cache)");
+
+  std::string directory = TempPath("anywp_bench_state_cache");
+  std::filesystem::remove_all(directory);
+  std::map<std::string, std::string> state;
+  for (int i = 0; i < 1000; i++) {
+    state["blob." + std::to_string(i)] = std::string(16 * 1024, static_cast<char>('a' + i % 26));
+  }
+  StateJournal journal(directory);
+  journal.Open();
+  journal.Replace(state);
+  StateCache cache;
+
+  // What LoadState does: cache first, then one key from disk
+  auto load = [&](const std::string& key) {
+    std::string value;
+    if (!cache.Get(key, value) && journal.Get(key, value)) {
+      cache.Put(key, value);
+    }
+    g_sink = static_cast<int>(value.size());
+  };
+
+  const int kReads = 20000;
+  std::vector<std::string> keys;
+  for (int i = 0; i < kReads; i++) {
+    keys.push_back("blob." + std::to_string((i * 7919) % 1000));
+  }
+  double disk_ns = NanosPerIteration(kReads, [&](int i) {
+    std::string value;
+    journal.Get(keys[i], value);
+    g_sink = static_cast<int>(value.size());
+  });
+  // 32 hot keys: fits the budget
+  double hot_ns = NanosPerIteration(kReads, [&](int i) { load(keys[i % 32]); });
+  StateCache::Stats hot = cache.GetStats();
+  cache.Clear();
+  // Every key in turn: ~16 MB working set through a 4 MB cache
+  double cold_ns = NanosPerIteration(kReads, [&](int i) { load(keys[i]); });
+  StateCache::Stats cold = cache.GetStats();
+
+  std::printf("%-28s %10s %10s %10s %12s\n", "workload", "us/load", "hit rate", "evictions", "cache KB");
+  std::printf("%-28s %10.2f %10s %10s %12s\n", "journal Get, no cache", disk_ns / 1000.0, "-", "-", "-");
+  std::printf("%-28s %10.2f %9.1f%% %10ju %12zu\n", "cache, 32 hot keys", hot_ns / 1000.0,
+              100.0 * hot.hits / (hot.hits + hot.misses), static_cast<uintmax_t>(hot.evictions),
+              hot.bytes / 1024);
+  uint64_t cold_hits = cold.hits - hot.hits;
+  uint64_t cold_lookups = cold_hits + cold.misses - hot.misses;
+  std::printf("%-28s %10.2f %9.1f%% %10ju %12zu\n", "cache, 1000 keys round robin", cold_ns / 1000.0,
+              100.0 * cold_hits / cold_lookups,
+              static_cast<uintmax_t>(cold.evictions - hot.evictions), cold.bytes / 1024);
+  std::printf("journal memory: %zu keys indexed, %ju bytes of values held\n",
+              journal.GetStats().keys, static_cast<uintmax_t>(journal.GetStats().pending_bytes));
+
+  journal.Close();
+  std::filesystem::remove_all(directory);
+}
+
+// ========== State: journal vs memory-mapped hash file ==========
+
+void BenchmarkStateHashFile() {
+  PrintHeader("State store: journal vs memory-mapped hash file (64-byte values)");
+  std::printf("%-12s %8s %10s %10s %10s %12s\n", "store", "keys", "open ms", "us/get", "us/put",
+              "file KB");
+
+  std::string journal_dir = TempPath("anywp_bench_state_backend_journal");
+  std::string hash_dir = TempPath("anywp_bench_state_backend_hash");
+  for (size_t keys : {1000, 100000}) {
+    std::map<std::string, std::string> state;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < keys; i++) {
+      names.push_back("wallpaper.setting." + std::to_string(i));
+      state[names.back()] = std::string(64, static_cast<char>('a' + i % 26));
+    }
+    const int kOps = 20000;
+    auto key_at = [&](int i) -> const std::string& {
+      return names[(static_cast<size_t>(i) * 7919) % keys];
+    };
+
+    std::filesystem::remove_all(journal_dir);
+    {
+      StateJournal journal(journal_dir);
+      journal.Open();
+      journal.Replace(state);
+    }
+    {
+      StateJournal journal(journal_dir);
+      auto start = Clock::now();
+      journal.Open();
+      double open_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+      double get_ns = NanosPerIteration(kOps, [&](int i) {
+        std::string value;
+        journal.Get(key_at(i), value);
+        g_sink = static_cast<int>(value.size());
+      });
+      double put_ns = NanosPerIteration(kOps, [&](int i) {
+        journal.Put(key_at(i), std::to_string(i), StateJournal::Durability::SYNC);
+      });
+      journal.Close();
+      uintmax_t bytes = std::filesystem::file_size(std::filesystem::path(journal_dir) /
+                                                   StateJournal::kSnapshotName);
+      std::printf("%-12s %8zu %10.2f %10.2f %10.2f %12ju\n", "journal", keys, open_ms,
+                  get_ns / 1000.0, put_ns / 1000.0, bytes / 1024);
+    }
+
+    // Migration path: the same state written as a hash file
+    std::filesystem::remove_all(hash_dir);
+    StateHashFile::Write(hash_dir, state, StateHashFile::Options());
+    {
+      StateHashFile file(hash_dir);
+      auto start = Clock::now();
+      file.Open();
+      double open_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+      double get_ns = NanosPerIteration(kOps, [&](int i) {
+        std::string value;
+        file.Get(key_at(i), value);
+        g_sink = static_cast<int>(value.size());
+      });
+      double put_ns = NanosPerIteration(kOps, [&](int i) {
+        file.Put(key_at(i), std::to_string(i));
+      });
+      uint64_t bytes = file.GetStats().file_bytes;
+      file.Close();
+      std::printf("%-12s %8zu %10.2f %10.2f %10.2f %12ju\n", "hash file", keys, open_ms,
+                  get_ns / 1000.0, put_ns / 1000.0, static_cast<uintmax_t>(bytes / 1024));
+    }
+  }
+  std::filesystem::remove_all(journal_dir);
+  std::filesystem::remove_all(hash_dir);
+}
+
+// ========== Web messages: find/substr scanning vs JsonReader ==========
+// Payloads as the SDK posts them (get_WebMessageAsJson); the legacy
+// functions reproduce the string-search parsers JsonReader replaced.
+
+std::string IframeDataMessage(int count) {
+  std::string json = "{\"type\":\"IFRAME_DATA\",\"iframes\":[";
+  for (int i = 0; i < count; i++) {
+    if (i > 0) json += ",";
+    json += "{\"index\":" + std::to_string(i) + ",\"id\":\"ad-slot-" + std::to_string(i) +
+            "\",\"src\":\"https://ads.example.com/creative/" + std::to_string(1000 + i) +
+            "/frame.html?campaign=spring&size=300x250\",\"bounds\":{\"left\":" +
+            std::to_string(40 + (i % 6) * 310) + ",\"top\":" + std::to_string(80 + (i / 6) * 260) +
+            ",\"width\":300,\"height\":250},\"clickUrl\":\"https://example.com/landing?ad=" +
+            std::to_string(i) + "&utm_source=wallpaper\",\"visible\":" +
+            (i % 5 == 4 ? "false" : "true") + "}";
+  }
+  return json + "]}";
+}
+
+// saveState with `fields` settings, JSON.stringify()-ed into "value"
+std::string SaveStateMessage(int fields) {
+  std::string value = "{";
+  for (int i = 0; i < fields; i++) {
+    if (i > 0) value += ",";
+    value += "\\\"widget" + std::to_string(i) + "\\\":{\\\"left\\\":" + std::to_string(i * 13) +
+             ",\\\"top\\\":" + std::to_string(i * 7) + ",\\\"label\\\":\\\"Clock \\u00e9 " +
+             std::to_string(i) + "\\\"}";
+  }
+  value += "}";
+  return "{\"type\":\"saveState\",\"key\":\"layout.positions\",\"value\":\"" + value +
+         "\",\"durability\":\"async\"}";
+}
+
+bool LegacyParseIframes(const std::string& json_data, std::vector<IframeInfo>& iframes) {
+  iframes.clear();
+  size_t iframes_start = json_data.find("\"iframes\":[");
+  if (iframes_start == std::string::npos) return false;
+  size_t array_end = json_data.find("]", iframes_start);
+  if (array_end == std::string::npos) return false;
+  auto string_field = [](const std::string& obj, const std::string& key) {
+    std::string search = "\"" + key + "\":\"";
+    size_t start = obj.find(search);
+    if (start == std::string::npos) return std::string();
+    start += search.length();
+    return obj.substr(start, obj.find("\"", start) - start);
+  };
+  auto int_field = [](const std::string& obj, const std::string& key, size_t from) {
+    size_t start = obj.find("\"" + key + "\":", from);
+    return start == std::string::npos ? 0 : std::stoi(obj.substr(start + key.size() + 3, 10));
+  };
+  size_t pos = iframes_start + 11;
+  while (pos < array_end) {
+    pos = json_data.find("{", pos);
+    if (pos == std::string::npos || pos >= array_end) break;
+    int brace_count = 1;
+    size_t obj_end = pos + 1;
+    while (obj_end < array_end && brace_count > 0) {
+      if (json_data[obj_end] == '{') brace_count++;
+      else if (json_data[obj_end] == '}') brace_count--;
+      obj_end++;
+    }
+    if (brace_count != 0) break;
+    std::string obj = json_data.substr(pos, obj_end - pos);
+    IframeInfo iframe;
+    iframe.id = string_field(obj, "id");
+    iframe.src = string_field(obj, "src");
+    iframe.click_url = string_field(obj, "clickUrl");
+    size_t bounds = obj.find("\"bounds\":{");
+    if (bounds != std::string::npos) {
+      iframe.left = int_field(obj, "left", bounds);
+      iframe.top = int_field(obj, "top", bounds);
+      iframe.width = int_field(obj, "width", bounds);
+      iframe.height = int_field(obj, "height", bounds);
+    }
+    size_t visible = obj.find("\"visible\":");
+    iframe.visible = visible == std::string::npos || obj.substr(visible + 10, 4) == "true";
+    iframes.push_back(iframe);
+    pos = obj_end;
+  }
+  return !iframes.empty();
+}
+
+bool LegacyParseSaveState(const std::string& message, std::string& key, std::string& value) {
+  size_t key_start = message.find("\"key\":\"") + 7;
+  size_t key_end = message.find("\"", key_start);
+  size_t value_start = message.find("\"value\":\"") + 9;
+  size_t end_brace = message.rfind("}");
+  size_t value_end = message.rfind("\"", end_brace);
+  size_t durability_pos = message.rfind(",\"durability\":\"");
+  if (durability_pos != std::string::npos && durability_pos > value_start) {
+    std::string mode = message.substr(durability_pos + 15, value_end - durability_pos - 15);
+    g_sink = static_cast<int>(mode.size());
+    value_end = message.rfind("\"", durability_pos);
+  }
+  if (key_end == std::string::npos || value_end == std::string::npos || value_end <= value_start) {
+    return false;
+  }
+  key = message.substr(key_start, key_end - key_start);
+  value = message.substr(value_start, value_end - value_start);
+  return true;
+}
+
+// Hand-written saveState parse, before the generated decoder
+bool ReaderParseSaveState(const std::string& message, std::string& key, std::string& value) {
+  JsonReader reader(message, JsonStructuralIndex::ForThread(message));
+  bool has_key = false;
+  bool has_value = false;
+  if (reader.Next() != JsonReader::Token::BEGIN_OBJECT) return false;
+  while (reader.Next() == JsonReader::Token::KEY) {
+    bool is_key = reader.TextEquals("key");
+    bool is_value = !is_key && reader.TextEquals("value");
+    bool is_durability = !is_key && !is_value && reader.TextEquals("durability");
+    JsonReader::Token token = reader.Next();
+    if (token == JsonReader::Token::STRING && is_key) {
+      has_key = reader.GetString(key);
+    } else if (token == JsonReader::Token::STRING && is_value) {
+      value.assign(reader.Text().data(), reader.Text().size());
+      has_value = true;
+    } else if (token == JsonReader::Token::STRING && is_durability) {
+      g_sink = reader.TextEquals("sync") ? 1 : 0;
+    } else if (!reader.SkipValue()) {
+      return false;
+    }
+  }
+  return reader.Current() == JsonReader::Token::END_OBJECT &&
+         reader.Next() == JsonReader::Token::END && has_key && has_value;
+}
+
+void PrintMessageRow(const char* parser, const std::string& payload, int iterations,
+                     const std::function<void()>& parse) {
+  size_t allocations_before = g_allocations.load();
+  double ns = NanosPerIteration(iterations, [&](int) { parse(); });
+  double allocs = static_cast<double>(g_allocations.load() - allocations_before) / iterations;
+  std::printf("%-22s %8zu %10.0f %10.1f %10.1f\n", parser, payload.size(), ns,
+              payload.size() / ns * 1000.0, allocs);
+}
+
+void BenchmarkIframeDataMessage() {
+  PrintHeader("Web message: IFRAME_DATA parse (find/substr vs JsonReader)");
+  std::printf("%-22s %8s %10s %10s %10s\n", "parser", "bytes", "ns/msg", "MB/s", "allocs");
+  for (int count : {1, 8, 64}) {
+    std::string payload = IframeDataMessage(count);
+    std::vector<IframeInfo> legacy;
+    std::vector<IframeInfo> parsed;
+    LegacyParseIframes(payload, legacy);
+    IframeDetector::UpdateIframeVector(payload, parsed);
+    if (legacy.size() != parsed.size() || parsed.back().click_url != legacy.back().click_url) {
+      std::printf("MISMATCH for %d iframes\n", count);
+    }
+    const int kIterations = count > 8 ? 5000 : 50000;
+    std::string label = std::to_string(count) + " iframe" + (count > 1 ? "s" : "");
+    PrintMessageRow(("legacy, " + label).c_str(), payload, kIterations, [&] {
+      LegacyParseIframes(payload, legacy);
+      g_sink = static_cast<int>(legacy.size());
+    });
+    PrintMessageRow(("JsonReader, " + label).c_str(), payload, kIterations, [&] {
+      IframeDetector::UpdateIframeVector(payload, parsed);
+      g_sink = static_cast<int>(parsed.size());
+    });
+  }
+}
+
+void BenchmarkSaveStateMessage() {
+  PrintHeader("Web message: saveState parse (rfind vs JsonReader vs generated Decode)");
+  std::printf("%-22s %8s %10s %10s %10s\n", "parser", "bytes", "ns/msg", "MB/s", "allocs");
+  for (int fields : {2, 400}) {
+    std::string payload = SaveStateMessage(fields);
+    std::string key;
+    std::string value;
+    std::string legacy_value;
+    LegacyParseSaveState(payload, key, legacy_value);
+    ReaderParseSaveState(payload, key, value);
+    if (value != legacy_value) {
+      std::printf("MISMATCH for %d fields\n", fields);
+    }
+    const int kIterations = fields > 2 ? 20000 : 200000;
+    PrintMessageRow("legacy rfind", payload, kIterations, [&] {
+      LegacyParseSaveState(payload, key, value);
+      g_sink = static_cast<int>(value.size());
+    });
+    PrintMessageRow("JsonReader", payload, kIterations, [&] {
+      ReaderParseSaveState(payload, key, value);
+      g_sink = static_cast<int>(value.size());
+    });
+    webmessage::SaveStateMessage message;
+    if (!webmessage::Decode(payload, message) || message.value != legacy_value) {
+      std::printf("MISMATCH (generated) for %d fields\n", fields);
+    }
+    PrintMessageRow("generated Decode", payload, kIterations, [&] {
+      webmessage::Decode(payload, message);
+      g_sink = static_cast<int>(message.value.size());
+    });
+  }
+}
+
+// Whole-document tokenize, as the consumers' loops do
+size_t TokenizeAll(const std::string& json, const JsonStructuralIndex* index) {
+  JsonReader reader(json, index);
+  size_t tokens = 0;
+  JsonReader::Token token;
+  while ((token = reader.Next()) != JsonReader::Token::END && token != JsonReader::Token::ERROR) {
+    tokens++;
+  }
+  return tokens;
+}
+
+void BenchmarkStructuralIndex() {
+  PrintHeader("Web message: structural index (stage 1) per kernel");
+  std::printf("best kernel: %s\n", JsonStructuralIndex::KernelName(JsonStructuralIndex::BestKernel()));
+  std::printf("%-28s %8s %10s %10s\n", "pass", "bytes", "ns/msg", "GB/s");
+  struct Payload {
+    const char* name;
+    std::string json;
+  };
+  const Payload payloads[] = {
+      {"iframes x8", IframeDataMessage(8)},
+      {"iframes x64", IframeDataMessage(64)},
+      {"iframes x256", IframeDataMessage(256)},
+      {"saveState x400", SaveStateMessage(400)},
+  };
+  auto row = [](const std::string& pass, size_t bytes, double ns) {
+    // bytes per ns == GB/s
+    std::printf("%-28s %8zu %10.0f %10.2f\n", pass.c_str(), bytes, ns, bytes / ns);
+  };
+  JsonStructuralIndex index;
+  for (const Payload& payload : payloads) {
+    const int kIterations = static_cast<int>(std::max<size_t>(2000, 20000000 / payload.json.size()));
+    for (auto kernel : {JsonStructuralIndex::Kernel::SCALAR, JsonStructuralIndex::Kernel::SSE2,
+                        JsonStructuralIndex::Kernel::AVX2, JsonStructuralIndex::Kernel::NEON}) {
+      if (!JsonStructuralIndex::IsSupported(kernel)) continue;
+      double ns = NanosPerIteration(kIterations, [&](int) {
+        index.Build(payload.json, kernel);
+        g_sink = static_cast<int>(index.Size());
+      });
+      row(std::string(payload.name) + ", " + JsonStructuralIndex::KernelName(kernel),
+          payload.json.size(), ns);
+    }
+    index.Build(payload.json);
+    size_t plain_tokens = TokenizeAll(payload.json, nullptr);
+    if (TokenizeAll(payload.json, &index) != plain_tokens) {
+      std::printf("MISMATCH for %s\n", payload.name);
+    }
+    row(std::string(payload.name) + ", reader", payload.json.size(),
+        NanosPerIteration(kIterations, [&](int) {
+          g_sink = static_cast<int>(TokenizeAll(payload.json, nullptr));
+        }));
+    row(std::string(payload.name) + ", index+reader", payload.json.size(),
+        NanosPerIteration(kIterations, [&](int) {
+          index.Build(payload.json);
+          g_sink = static_cast<int>(TokenizeAll(payload.json, &index));
+        }));
+  }
+}
+
+// ========== Outbound messages: string streams vs JsonWriter ==========
+// The legacy lambdas reproduce the stream-based builders JsonWriter
+// replaced (EventDispatcher, HandleSaveStateWebMessage, HandleSendMessage).
+
+void PrintOutboundRow(const char* builder, int iterations, const std::function<size_t()>& build) {
+  size_t allocations_before = g_allocations.load();
+  size_t chars = 0;
+  double ns = NanosPerIteration(iterations, [&](int) { chars = build(); });
+  double allocs = static_cast<double>(g_allocations.load() - allocations_before) / iterations;
+  std::printf("%-28s %8zu %10.0f %10.1f\n", builder, chars, ns, allocs);
+}
+
+void BenchmarkOutboundMessages() {
+  PrintHeader("Outbound messages: string streams vs JsonWriter (UTF-16 out)");
+  std::printf("%-28s %8s %10s %10s\n", "builder", "chars", "ns/msg", "allocs");
+  const int kIterations = 200000;
+  const char* event_type = "mousemove";
+  int x = 1234;
+  int y = 567;
+
+  PrintOutboundRow("mouseEvent, wstringstream", kIterations, [&] {
+    std::wstringstream json;
+    json << L"{" << L"\"type\":\"mouseEvent\","
+         << L"\"eventType\":\"" << std::wstring(event_type, event_type + std::strlen(event_type)) << L"\","
+         << L"\"x\":" << x << L"," << L"\"y\":" << y << L"," << L"\"button\":0" << L"}";
+    return json.str().size();
+  });
+  WideJsonWriter writer;
+  PrintOutboundRow("mouseEvent, JsonWriter", kIterations, [&] {
+    writer.Clear();
+    writer.BeginObject().Key("type").String("mouseEvent").Key("eventType").String(event_type)
+        .Key("x").Int(x).Key("y").Int(y).Key("button").Int(0).EndObject();
+    return writer.Size();
+  });
+
+  std::string key = "layout.positions";
+  PrintOutboundRow("stateSaved, ostringstream", kIterations, [&] {
+    std::ostringstream js;
+    js << "window.dispatchEvent(new CustomEvent('AnyWP:stateSaved', {"
+       << "detail: {type: 'stateSaved', key: " << ConfigJson::Quote(key)
+       << ", success: " << "true" << "}" << "}));";
+    std::string js_code = js.str();
+    std::wstring wjs_code(js_code.begin(), js_code.end());
+    return wjs_code.size();
+  });
+  PrintOutboundRow("stateSaved, JsonWriter", kIterations, [&] {
+    writer.Clear();
+    writer.Raw("window.dispatchEvent(new CustomEvent('AnyWP:stateSaved', {detail: ")
+        .BeginObject().Key("type").String("stateSaved").Key("key").String(key)
+        .Key("success").Bool(true).EndObject().Raw("}));");
+    return writer.Size();
+  });
+
+  // sendMessage with a 4 KB settings payload
+  std::string message = SaveStateMessage(40);
+  const int kMessageIterations = 20000;
+  PrintOutboundRow("sendMessage 4KB, escape+widen", kMessageIterations, [&] {
+    std::string escaped_json;
+    escaped_json.reserve(message.length() * 2);
+    for (char c : message) {
+      switch (c) {
+        case '\\': escaped_json += "\\\\"; break;
+        case '\"': escaped_json += "\\\""; break;
+        case '\n': escaped_json += "\\n"; break;
+        case '\r': escaped_json += "\\r"; break;
+        case '\t': escaped_json += "\\t"; break;
+        default: escaped_json += c; break;
+      }
+    }
+    std::wstring message_wide(escaped_json.begin(), escaped_json.end());  // MultiByteToWideChar
+    std::wstring script = L"(function() {\n  const messageStr = \"" + message_wide + L"\";\n})();\n";
+    return script.size();
+  });
+  PrintOutboundRow("sendMessage 4KB, JsonWriter", kMessageIterations, [&] {
+    writer.Clear();
+    writer.Raw("(function() {\n  const messageStr = ").String(message).Raw(";\n})();\n");
+    return writer.Size();
+  });
+}
+
+void BenchmarkMessageDispatch() {
+  PrintHeader("Web message: dispatch by type (std::map vs perfect hash)");
+  const std::vector<std::string> types = {
+      "IFRAME_DATA", "openURL", "OPEN_URL", "ready", "READY", "log", "LOG", "console_log",
+      "saveState", "loadState", "clearState", "pauseResult", "myWidgetEvent"};
+  const std::string message = R"({"type":"saveState"})";
+  int calls = 0;
+  auto handler = [&calls](const std::string&) { calls++; };
+
+  // The former SDKBridge table: every spelling is a map entry
+  std::map<std::string, std::function<void(const std::string&)>> legacy;
+  MessageRouter router;
+  for (const std::string& type : types) {
+    legacy[type] = handler;
+    router.SetHandler(type, handler);
+  }
+
+  const int kIterations = 1000000;
+  std::printf("%-22s %10s\n", "", "ns/msg");
+  int found = 0;
+  double ns = NanosPerIteration(kIterations, [&](int i) {
+    found += legacy.find(types[i % types.size()]) != legacy.end();
+  });
+  std::printf("%-22s %10.1f\n", "lookup, std::map", ns);
+  ns = NanosPerIteration(kIterations, [&](int i) {
+    found += MessageRouter::Lookup(types[i % types.size()]) != MessageSlot::NONE;
+  });
+  std::printf("%-22s %10.1f\n", "lookup, perfect hash", ns);
+  ns = NanosPerIteration(kIterations, [&](int i) {
+    auto it = legacy.find(types[i % types.size()]);
+    if (it != legacy.end()) it->second(message);
+  });
+  std::printf("%-22s %10.1f\n", "dispatch, std::map", ns);
+  ns = NanosPerIteration(kIterations, [&](int i) {
+    router.Dispatch(types[i % types.size()], message);
+  });
+  std::printf("%-22s %10.1f\n", "dispatch, router", ns);
+  g_sink = calls + found;
+}
+
+void RegisterBenchmarks() {
+  Register("logger.sync_vs_async", BenchmarkLoggerSyncVsAsync);
+  Register("logger.disabled_site", BenchmarkDisabledLogSite);
+  Register("logger.formatter", BenchmarkLogFormatter);
+  Register("logger.rate_limited_storm", BenchmarkRateLimitedStorm);
+  Register("logger.flight_recorder", BenchmarkFlightRecorder);
+  Register("logger.rotation_latency", BenchmarkRotationLatency);
+  Register("eventbus.publish", BenchmarkEventBusPublish);
+  Register("eventbus.publish_async", BenchmarkEventBusPublishAsync);
+  Register("eventbus.typed", BenchmarkEventBusTyped);
+  Register("eventbus.wildcard", BenchmarkEventBusWildcard);
+  Register("eventbus.history", BenchmarkEventHistory);
+  Register("config.contended_get", BenchmarkConfigContendedGet);
+  Register("state.journal", BenchmarkStateJournal);
+  Register("state.cache", BenchmarkStateCache);
+  Register("state.hash_file", BenchmarkStateHashFile);
+  Register("message.iframe_data", BenchmarkIframeDataMessage);
+  Register("message.save_state", BenchmarkSaveStateMessage);
+  Register("message.structural_index", BenchmarkStructuralIndex);
+  Register("message.outbound", BenchmarkOutboundMessages);
+  Register("message.dispatch", BenchmarkMessageDispatch);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  RegisterBenchmarks();
+
+  std::string filter = argc > 1 ? argv[1] : "";
+  for (const auto& bench : Registry()) {
+    if (filter.empty() || bench.name.find(filter) != std::string::npos) {
+      bench.run();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,3410 @@
+#include "test_framework.h"
+#include "../utils/config_json.h"
+#include "../utils/config_manager.h"
+#include "../utils/event_bus.h"
+#include "../utils/event_history.h"
+#include "../utils/event_timer.h"
+#include "../utils/event_topic_trie.h"
+#include "../utils/event_types.h"
+#include "../utils/logger.h"
+#include "../modules/iframe_detector.h"
+#include "../utils/json_reader.h"
+#include "../utils/json_structural_index.h"
+#include "../utils/json_writer.h"
+#include "../utils/log_flight_recorder.h"
+#include "../utils/log_formatter.h"
+#include "../utils/log_payload.h"
+#include "../utils/log_rate_limiter.h"
+#include "../utils/log_rotator.h"
+#include "../utils/mapped_state_storage.h"
+#include "../utils/snapshot_ptr.h"
+#include "../utils/message_router.h"
+#include "../utils/state_cache.h"
+#include "../utils/state_hash_file.h"
+#include "../utils/state_journal.h"
+#include "webmessage_types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Portable unit tests: modules that do not depend on Win32 or Flutter.
+// Built on every platform (see CMakeLists.txt) and registered with CTest.
+
+using namespace anywp_engine;
+using namespace anywp_engine::test;
+
+namespace {
+
+// One directory per process, so both test binaries can run at once
+// (ctest -j); removed by main() when the run ends
+std::filesystem::path MakeTestDirectory() {
+#ifdef _WIN32
+  int pid = _getpid();
+#else
+  int pid = static_cast<int>(getpid());
+#endif
+  std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / ("anywp_tests_" + std::to_string(pid));
+  std::filesystem::create_directories(directory);
+  return directory;
+}
+
+const std::filesystem::path kTestDirectory = MakeTestDirectory();
+
+std::string TempPath(const std::string& name) {
+  return (kTestDirectory / name).string();
+}
+
+size_t CountLines(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  size_t lines = 0;
+  std::string line;
+  while (std::getline(file, line)) {
+    lines++;
+  }
+  return lines;
+}
+
+// Route the singleton logger to a fresh file with the console disabled
+std::string ResetLoggerToFile(const std::string& name) {
+  std::string path = TempPath(name);
+  std::filesystem::remove(path);
+  Logger::Instance().EnableConsoleLogging(false);
+  Logger::Instance().SetMinLevel(Logger::Level::DEBUG);
+  Logger::Instance().EnableFileLogging(path);
+  return path;
+}
+
+// The original ostringstream/put_time formatting, kept as the byte-exact reference
+std::string ReferenceFormat(Logger::Level level, const std::string& component,
+                            const std::string& message,
+                            const std::chrono::system_clock::time_point& now) {
+  auto time_t_now = std::chrono::system_clock::to_time_t(now);
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      now.time_since_epoch()) % 1000;
+  std::tm tm_now;
+#ifdef _WIN32
+  localtime_s(&tm_now, &time_t_now);
+#else
+  localtime_r(&time_t_now, &tm_now);
+#endif
+  const char* level_name = "UNKNOWN";
+  switch (level) {
+    case Logger::Level::DEBUG:   level_name = "DEBUG"; break;
+    case Logger::Level::INFO:    level_name = "INFO"; break;
+    case Logger::Level::WARNING: level_name = "WARNING"; break;
+    case Logger::Level::ERROR:   level_name = "ERROR"; break;
+  }
+  std::ostringstream oss;
+  oss << "[" << std::put_time(&tm_now, "%Y-%m-%d %H:%M:%S")
+      << '.' << std::setfill('0') << std::setw(3) << ms.count() << "] "
+      << "[" << level_name << "] "
+      << "[" << component << "] "
+      << message;
+  return oss.str();
+}
+
+// gzip -dc is used to check archives where available (skipped otherwise)
+bool GzipToolAvailable() {
+#ifdef _WIN32
+  return false;
+#else
+  return std::system("gzip --version > /dev/null 2>&1") == 0;
+#endif
+}
+
+std::string GunzipWithTool(const std::string& path) {
+  std::string out_path = path + ".out";
+  std::string command = "gzip -dc '" + path + "' > '" + out_path + "'";
+  if (std::system(command.c_str()) != 0) {
+    return "<gzip failed>";
+  }
+  std::ifstream file(out_path, std::ios::binary);
+  std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  file.close();
+  std::filesystem::remove(out_path);
+  return text;
+}
+
+void RemoveLogAndArchives(const std::string& path) {
+  for (const auto& archive : LogRotator::ListArchives(path)) {
+    std::filesystem::remove(archive);
+  }
+  std::filesystem::remove(path);
+}
+
+// Redirects std::cout into a string for the lifetime of the object
+class ConsoleCapture {
+public:
+  ConsoleCapture() : previous_(std::cout.rdbuf(captured_.rdbuf())) {}
+  ~ConsoleCapture() { std::cout.rdbuf(previous_); }
+
+  std::string Text() const { return captured_.str(); }
+
+private:
+  std::ostringstream captured_;
+  std::streambuf* previous_;
+};
+
+size_t Statistic(const std::string& name) {
+  return Logger::Instance().GetStatistics()[name];
+}
+
+void RestoreLogger() {
+  Logger::Instance().EnableAsync(false);
+  Logger::Instance().DisableFileLogging();
+  Logger::Instance().SetMinLevel(Logger::Level::INFO);
+  Logger::Instance().EnableConsoleLogging(true);
+}
+
+}  // namespace
+
+TEST_SUITE(AsyncLogger) {
+  TEST_CASE(enable_disable) {
+    Logger::Instance().EnableAsync(true, 64);
+    ASSERT_TRUE(Logger::Instance().IsAsync());
+    Logger::Instance().EnableAsync(false);
+    ASSERT_FALSE(Logger::Instance().IsAsync());
+  }
+
+  TEST_CASE(flush_writes_all_queued_records) {
+    std::string path = ResetLoggerToFile("anywp_async_flush.log");
+    Logger::Instance().EnableAsync(true, 1024, Logger::OverflowPolicy::BLOCK);
+
+    for (int i = 0; i < 500; i++) {
+      Logger::Instance().Info("Test", "Record " + std::to_string(i));
+    }
+    Logger::Instance().Flush();
+
+    ASSERT_EQUAL(static_cast<size_t>(500), CountLines(path));
+    RestoreLogger();
+  }
+
+  TEST_CASE(block_policy_loses_nothing_under_contention) {
+    std::string path = ResetLoggerToFile("anywp_async_block.log");
+    // Tiny ring forces producers to block on the writer
+    Logger::Instance().EnableAsync(true, 16, Logger::OverflowPolicy::BLOCK);
+
+    const int kThreads = 4;
+    const int kPerThread = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+      threads.emplace_back([t] {
+        for (int i = 0; i < kPerThread; i++) {
+          Logger::Instance().Debug("Thread" + std::to_string(t), "Message " + std::to_string(i));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // Disabling async drains the ring before the writer exits
+    Logger::Instance().EnableAsync(false);
+    Logger::Instance().DisableFileLogging();
+
+    ASSERT_EQUAL(static_cast<size_t>(kThreads * kPerThread), CountLines(path));
+    ASSERT_EQUAL(static_cast<size_t>(0), Logger::Instance().GetStatistics()["AsyncDropped"]);
+    RestoreLogger();
+  }
+
+  TEST_CASE(drop_policies_count_every_record) {
+    const Logger::OverflowPolicy policies[] = {
+      Logger::OverflowPolicy::DROP_OLDEST,
+      Logger::OverflowPolicy::DROP_NEWEST
+    };
+
+    for (auto policy : policies) {
+      std::string path = ResetLoggerToFile("anywp_async_drop.log");
+      Logger::Instance().EnableAsync(true, 8, policy);
+
+      size_t dropped_before = Logger::Instance().GetStatistics()["AsyncDropped"];
+      const size_t kTotal = 5000;
+      for (size_t i = 0; i < kTotal; i++) {
+        Logger::Instance().Info("Test", "Burst " + std::to_string(i));
+      }
+      Logger::Instance().EnableAsync(false);
+      Logger::Instance().DisableFileLogging();
+
+      size_t dropped = Logger::Instance().GetStatistics()["AsyncDropped"] - dropped_before;
+      // Every record is either written or counted as dropped
+      ASSERT_EQUAL(kTotal, CountLines(path) + dropped);
+    }
+    RestoreLogger();
+  }
+
+  TEST_CASE(level_filter_applies_before_enqueue) {
+    std::string path = ResetLoggerToFile("anywp_async_filter.log");
+    Logger::Instance().SetMinLevel(Logger::Level::WARNING);
+    Logger::Instance().EnableAsync(true, 64);
+
+    Logger::Instance().Debug("Test", "filtered");
+    Logger::Instance().Info("Test", "filtered");
+    Logger::Instance().Error("Test", "kept");
+    Logger::Instance().Flush();
+
+    ASSERT_EQUAL(static_cast<size_t>(1), CountLines(path));
+    RestoreLogger();
+  }
+}
+
+TEST_SUITE(LogSiteRegistry) {
+  TEST_CASE(disabled_site_skips_argument_evaluation) {
+    Logger::Instance().EnableConsoleLogging(false);
+    Logger::Instance().SetMinLevel(Logger::Level::INFO);
+
+    int evaluations = 0;
+    auto expensive = [&evaluations]() {
+      evaluations++;
+      return std::string("built");
+    };
+
+    for (int i = 0; i < 10; i++) {
+      ANYWP_LOG_DEBUG("Test", expensive());
+    }
+    ASSERT_EQUAL(0, evaluations);
+
+    ANYWP_LOG_INFO("Test", expensive());
+    ASSERT_EQUAL(1, evaluations);
+    RestoreLogger();
+  }
+
+  TEST_CASE(site_registers_with_file_and_line) {
+    size_t before = LogSiteRegistry::Instance().GetSiteCount();
+    const int line = __LINE__ + 1;
+    ANYWP_LOG_DEBUG("Test", "register me");
+    ASSERT_EQUAL(before + 1, LogSiteRegistry::Instance().GetSiteCount());
+
+    bool found = false;
+    for (const auto& site : LogSiteRegistry::Instance().GetSites()) {
+      if (site.line == line && site.file.find("portable_tests.cpp") != std::string::npos) {
+        found = true;
+        ASSERT_EQUAL(LogSiteId(__FILE__, line), site.id);
+        ASSERT_TRUE(site.level == Logger::Level::DEBUG);
+      }
+    }
+    ASSERT_TRUE(found);
+  }
+
+  TEST_CASE(site_id_ignores_build_path) {
+    static_assert(LogSiteId("/home/ci/src/windows/utils/logger.cpp", 42) ==
+                  LogSiteId("C:\\Users\\dev\\anywp\\windows\\utils\\logger.cpp", 42));
+    static_assert(LogSiteId("../utils/logger.cpp", 42) == LogSiteId("logger.cpp", 42));
+    ASSERT_TRUE(LogSiteId("utils/logger.cpp", 42) != LogSiteId("utils/logger.cpp", 43));
+    ASSERT_TRUE(LogSiteId("utils/logger.cpp", 42) != LogSiteId("utils/log_site.cpp", 42));
+    ASSERT_EQUAL(std::string("x.cpp"), std::string(LogSiteFileName("a\\b/x.cpp")));
+  }
+
+  TEST_CASE(enable_single_site_by_id) {
+    Logger::Instance().EnableConsoleLogging(false);
+    Logger::Instance().SetMinLevel(Logger::Level::INFO);
+
+    int first = 0;
+    int second = 0;
+    auto run = [&]() {
+      ANYWP_LOG_DEBUG("Test", std::to_string(++first));
+      ANYWP_LOG_DEBUG("Test", std::to_string(++second));
+    };
+    const int first_line = __LINE__ - 3;
+
+    run();
+    ASSERT_EQUAL(0, first);
+
+    LogSiteRegistry::Instance().SetSiteEnabled(LogSiteId(__FILE__, first_line), true);
+    run();
+    ASSERT_EQUAL(1, first);
+    ASSERT_EQUAL(0, second);
+
+    LogSiteRegistry::Instance().ClearOverrides();
+    run();
+    ASSERT_EQUAL(1, first);
+    RestoreLogger();
+  }
+
+  TEST_CASE(file_rule_and_min_level_refresh) {
+    Logger::Instance().EnableConsoleLogging(false);
+    Logger::Instance().SetMinLevel(Logger::Level::INFO);
+
+    int count = 0;
+    auto run = [&]() { ANYWP_LOG_INFO("Test", std::to_string(++count)); };
+
+    run();
+    ASSERT_EQUAL(1, count);
+
+    LogSiteRegistry::Instance().SetFileEnabled("portable_tests.cpp", false);
+    run();
+    ASSERT_EQUAL(1, count);
+
+    LogSiteRegistry::Instance().ClearOverrides();
+    Logger::Instance().SetMinLevel(Logger::Level::ERROR);
+    run();
+    ASSERT_EQUAL(1, count);
+
+    Logger::Instance().SetMinLevel(Logger::Level::DEBUG);
+    run();
+    ASSERT_EQUAL(2, count);
+    RestoreLogger();
+  }
+}
+
+TEST_SUITE(LogFormatter) {
+  TEST_CASE(matches_reference_format) {
+    const Logger::Level levels[] = {
+      Logger::Level::DEBUG, Logger::Level::INFO, Logger::Level::WARNING, Logger::Level::ERROR
+    };
+    auto base = std::chrono::system_clock::now();
+
+    // Walk across several second (and minute) boundaries, hitting every ms digit pattern
+    for (int step = 0; step < 5000; step++) {
+      auto now = base + std::chrono::milliseconds(step * 37);
+      Logger::Level level = levels[step % 4];
+      std::string component = "Component" + std::to_string(step % 7);
+      std::string message = "Message " + std::to_string(step);
+
+      std::string expected = ReferenceFormat(level, component, message, now);
+      std::string actual(LogFormatter::Format(level, component, message, now));
+      ASSERT_EQUAL(expected, actual);
+    }
+  }
+
+  TEST_CASE(time_going_backwards_refreshes_cache) {
+    auto now = std::chrono::system_clock::now();
+    auto earlier = now - std::chrono::hours(30);
+
+    std::string first(LogFormatter::Format(Logger::Level::INFO, "Test", "a", now));
+    std::string second(LogFormatter::Format(Logger::Level::INFO, "Test", "a", earlier));
+    ASSERT_EQUAL(ReferenceFormat(Logger::Level::INFO, "Test", "a", now), first);
+    ASSERT_EQUAL(ReferenceFormat(Logger::Level::INFO, "Test", "a", earlier), second);
+  }
+
+  TEST_CASE(components_beyond_intern_limit) {
+    auto now = std::chrono::system_clock::now();
+    for (size_t i = 0; i < LogFormatter::kMaxInternedComponents + 20; i++) {
+      std::string component = "Dynamic" + std::to_string(i);
+      ASSERT_EQUAL(ReferenceFormat(Logger::Level::WARNING, component, "", now),
+                   std::string(LogFormatter::Format(Logger::Level::WARNING, component, "", now)));
+    }
+  }
+
+  TEST_CASE(file_sink_output_unchanged) {
+    std::string path = ResetLoggerToFile("anywp_formatter_file.log");
+    Logger::Instance().Info("Plugin", "Plugin initialized");
+    Logger::Instance().Error("WebViewManager", "Failed to create WebView");
+    Logger::Instance().DisableFileLogging();
+
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+    ASSERT_TRUE(static_cast<bool>(std::getline(file, line)));
+    // New log files start with a UTF-8 BOM
+    ASSERT_EQUAL(static_cast<size_t>(3 + 26), line.find("[INFO] [Plugin] Plugin initialized"));
+    ASSERT_TRUE(static_cast<bool>(std::getline(file, line)));
+    ASSERT_EQUAL(static_cast<size_t>(26), line.find("[ERROR] [WebViewManager] Failed to create WebView"));
+    RestoreLogger();
+  }
+}
+
+TEST_SUITE(LogRateLimiter) {
+  TEST_CASE(token_bucket_burst_then_refill) {
+    LogRateLimiter limiter;
+    limiter.SetRateLimit("Hook", 0, 10.0, 5);
+    auto t0 = LogRateLimiter::Clock::now();
+
+    int admitted = 0;
+    for (int i = 0; i < 100; i++) {
+      admitted += limiter.Admit(0, "Hook", t0) ? 1 : 0;
+    }
+    ASSERT_EQUAL(5, admitted);
+
+    // 10 msg/s: half a second refills five tokens
+    admitted = 0;
+    for (int i = 0; i < 100; i++) {
+      admitted += limiter.Admit(0, "Hook", t0 + std::chrono::milliseconds(500)) ? 1 : 0;
+    }
+    ASSERT_EQUAL(5, admitted);
+    ASSERT_EQUAL(static_cast<uint64_t>(190), limiter.GetSuppressedTotal());
+  }
+
+  TEST_CASE(rules_are_per_component_and_level) {
+    LogRateLimiter limiter;
+    limiter.SetRateLimit("Hook", 0, 1.0, 1);
+    auto now = LogRateLimiter::Clock::now();
+
+    ASSERT_TRUE(limiter.Admit(0, "Hook", now));
+    ASSERT_FALSE(limiter.Admit(0, "Hook", now));
+    // Other level and other component are untouched
+    ASSERT_TRUE(limiter.Admit(1, "Hook", now));
+    ASSERT_TRUE(limiter.Admit(0, "SDKBridge", now));
+    ASSERT_TRUE(limiter.Admit(0, "SDKBridge", now));
+  }
+
+  TEST_CASE(sampling_keeps_one_in_n) {
+    LogRateLimiter limiter;
+    limiter.SetSampling("Iframe", 0, 10);
+    auto now = LogRateLimiter::Clock::now();
+
+    int admitted = 0;
+    for (int i = 0; i < 1000; i++) {
+      admitted += limiter.Admit(0, "Iframe", now) ? 1 : 0;
+    }
+    ASSERT_EQUAL(100, admitted);
+  }
+
+  TEST_CASE(default_rule_and_override) {
+    LogRateLimiter limiter;
+    limiter.SetRateLimit("*", 0, 1.0, 2);
+    limiter.SetRateLimit("Important", 0, 1000.0, 1000);
+    auto now = LogRateLimiter::Clock::now();
+
+    int any = 0;
+    int important = 0;
+    for (int i = 0; i < 10; i++) {
+      any += limiter.Admit(0, "Anything", now) ? 1 : 0;
+      important += limiter.Admit(0, "Important", now) ? 1 : 0;
+    }
+    ASSERT_EQUAL(2, any);
+    ASSERT_EQUAL(10, important);
+
+    limiter.Clear();
+    ASSERT_FALSE(limiter.HasRules());
+    ASSERT_TRUE(limiter.Admit(0, "Anything", now));
+  }
+
+  TEST_CASE(concurrent_admits_share_one_bucket) {
+    LogRateLimiter limiter;
+    limiter.SetRateLimit("*", 0, 1.0, 100);
+    auto now = LogRateLimiter::Clock::now();
+
+    std::atomic<int> admitted{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < 1000; i++) {
+          admitted += limiter.Admit(0, "Storm", now) ? 1 : 0;
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    ASSERT_EQUAL(100, admitted.load());
+    ASSERT_EQUAL(static_cast<uint64_t>(3900), limiter.GetSuppressedTotal());
+
+    // Rules set again after Clear() start from a full bucket
+    limiter.Clear();
+    limiter.SetRateLimit("Storm", 0, 1.0, 2);
+    ASSERT_TRUE(limiter.Admit(0, "Storm", now));
+    ASSERT_TRUE(limiter.Admit(0, "Storm", now));
+    ASSERT_FALSE(limiter.Admit(0, "Storm", now));
+  }
+
+  TEST_CASE(suppressions_reported_once_per_interval) {
+    LogRateLimiter limiter;
+    limiter.SetReportInterval(std::chrono::seconds(5));
+    limiter.SetRateLimit("Hook", 0, 1.0, 1);
+    auto t0 = LogRateLimiter::Clock::now();
+
+    ASSERT_FALSE(limiter.ReportDue(t0));
+    for (int i = 0; i < 4; i++) {
+      limiter.Admit(0, "Hook", t0);
+    }
+    // First summary is due one interval after the first suppression
+    ASSERT_FALSE(limiter.ReportDue(t0));
+    ASSERT_TRUE(limiter.ReportDue(t0 + std::chrono::seconds(5)));
+
+    auto report = limiter.TakeSuppressions(t0);
+    ASSERT_EQUAL(static_cast<size_t>(1), report.size());
+    ASSERT_EQUAL(std::string("Hook"), report[0].component);
+    ASSERT_EQUAL(static_cast<uint64_t>(3), report[0].count);
+
+    limiter.Admit(0, "Hook", t0 + std::chrono::seconds(1));
+    limiter.Admit(0, "Hook", t0 + std::chrono::seconds(1));
+    ASSERT_FALSE(limiter.ReportDue(t0 + std::chrono::seconds(1)));
+    ASSERT_TRUE(limiter.ReportDue(t0 + std::chrono::seconds(5)));
+  }
+
+  TEST_CASE(logger_writes_summary_line) {
+    std::string path = ResetLoggerToFile("anywp_rate_limit.log");
+    Logger::Instance().SetRateLimit("Storm", Logger::Level::DEBUG, 1.0, 3);
+
+    int built = 0;
+    for (int i = 0; i < 50; i++) {
+      ANYWP_LOG_DEBUG("Storm", "event " + std::to_string(++built));
+    }
+    Logger::Instance().Flush();
+    Logger::Instance().ClearRateLimits();
+    Logger::Instance().DisableFileLogging();
+
+    // Rate-limited ANYWP_LOG_* lines never build their message
+    ASSERT_EQUAL(3, built);
+    ASSERT_EQUAL(static_cast<size_t>(4), CountLines(path));
+
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+    std::string last;
+    while (std::getline(file, line)) {
+      last = line;
+    }
+    ASSERT_TRUE(last.find("[DEBUG] [Logger] Suppressed 47 messages from Storm (DEBUG, rate limit)") !=
+                std::string::npos);
+    RestoreLogger();
+  }
+}
+
+TEST_SUITE(LogFlightRecorder) {
+  TEST_CASE(append_and_read_back) {
+    std::string path = TempPath("anywp_fr_basic.ring");
+    std::filesystem::remove(path);
+
+    LogFlightRecorder recorder;
+    ASSERT_TRUE(recorder.Open(path, 8192));
+    recorder.Append("first line");
+    recorder.Append("second line");
+    recorder.Close();
+
+    std::string history;
+    ASSERT_TRUE(LogFlightRecorder::ReadFile(path, history));
+    ASSERT_EQUAL(std::string("first line\nsecond line\n"), history);
+    std::filesystem::remove(path);
+  }
+
+  TEST_CASE(wrap_keeps_newest_complete_lines) {
+    std::string path = TempPath("anywp_fr_wrap.ring");
+    std::filesystem::remove(path);
+
+    LogFlightRecorder recorder;
+    ASSERT_TRUE(recorder.Open(path, 4096));
+    const int kLines = 2000;
+    for (int i = 0; i < kLines; i++) {
+      recorder.Append("line " + std::to_string(i));
+    }
+    ASSERT_TRUE(recorder.GetTotalWritten() > recorder.GetCapacity());
+
+    // Readable while the recorder is still open (hung-process case)
+    std::string history;
+    ASSERT_TRUE(LogFlightRecorder::ReadFile(path, history));
+    ASSERT_TRUE(history.size() <= 4096);
+
+    std::istringstream lines(history);
+    std::string line;
+    int expected = -1;
+    while (std::getline(lines, line)) {
+      int value = std::stoi(line.substr(5));
+      if (expected >= 0) {
+        ASSERT_EQUAL(expected, value);
+      }
+      expected = value + 1;
+    }
+    ASSERT_EQUAL(kLines, expected);
+    std::filesystem::remove(path);
+  }
+
+  TEST_CASE(max_bytes_limits_history) {
+    std::string path = TempPath("anywp_fr_tail.ring");
+    std::filesystem::remove(path);
+
+    LogFlightRecorder recorder;
+    ASSERT_TRUE(recorder.Open(path, 8192));
+    for (int i = 0; i < 100; i++) {
+      recorder.Append("entry " + std::to_string(i));
+    }
+
+    std::string history;
+    ASSERT_TRUE(LogFlightRecorder::ReadFile(path, history, 12));
+    ASSERT_EQUAL(std::string("entry 99\n"), history);
+    recorder.Close();
+    std::filesystem::remove(path);
+  }
+
+  TEST_CASE(reopen_after_torn_write_keeps_clobbered_bytes_out) {
+    std::string path = TempPath("anywp_fr_torn.ring");
+    std::filesystem::remove(path);
+
+    uint64_t commit_pos = 0;
+    {
+      LogFlightRecorder recorder;
+      ASSERT_TRUE(recorder.Open(path, 4096));
+      for (int i = 0; i < 1000; i++) {
+        recorder.Append("line " + std::to_string(i));
+      }
+      commit_pos = recorder.GetTotalWritten();
+    }
+
+    // Crash mid-Append: 100 bytes claimed, written over the oldest lines,
+    // never committed
+    {
+      std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+      uint64_t reserve_pos = commit_pos + 100;
+      file.seekp(24);
+      file.write(reinterpret_cast<const char*>(&reserve_pos), sizeof(reserve_pos));
+      file.seekp(static_cast<std::streamoff>(LogFlightRecorder::kHeaderSize + commit_pos % 4096));
+      std::string torn;
+      while (torn.size() < 100) {
+        torn += "torn\n";
+      }
+      file.write(torn.data(), 100);
+    }
+
+    {
+      LogFlightRecorder recorder;
+      ASSERT_TRUE(recorder.Open(path, 4096));
+      recorder.Append("next session");
+    }
+    std::string history;
+    ASSERT_TRUE(LogFlightRecorder::ReadFile(path, history));
+    ASSERT_TRUE(history.find("torn\n") == std::string::npos);
+    ASSERT_TRUE(history.find("line 999\n[flight recorder: torn write dropped]") != std::string::npos);
+    ASSERT_EQUAL(history.size() - 13, history.find("next session\n"));
+    std::filesystem::remove(path);
+  }
+
+  TEST_CASE(claim_larger_than_the_ring_is_corruption) {
+    std::string path = TempPath("anywp_fr_huge_claim.ring");
+    std::filesystem::remove(path);
+    {
+      LogFlightRecorder recorder;
+      ASSERT_TRUE(recorder.Open(path, 4096));
+      recorder.Append("previous session");
+    }
+
+    // A reserve_pos no write can produce: recovery must not size a filler by it
+    {
+      std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+      uint64_t reserve_pos = uint64_t(1) << 62;
+      file.seekp(24);
+      file.write(reinterpret_cast<const char*>(&reserve_pos), sizeof(reserve_pos));
+    }
+    std::string history;
+    ASSERT_FALSE(LogFlightRecorder::ReadFile(path, history));
+
+    {
+      LogFlightRecorder recorder;
+      ASSERT_TRUE(recorder.Open(path, 4096));  // Starts over
+      recorder.Append("next session");
+    }
+    ASSERT_TRUE(LogFlightRecorder::ReadFile(path, history));
+    ASSERT_EQUAL(std::string("next session\n"), history);
+    std::filesystem::remove(path);
+  }
+
+  TEST_CASE(reopen_keeps_history_unless_capacity_changes) {
+    std::string path = TempPath("anywp_fr_reopen.ring");
+    std::filesystem::remove(path);
+
+    {
+      LogFlightRecorder recorder;
+      ASSERT_TRUE(recorder.Open(path, 8192));
+      recorder.Append("previous session");
+    }
+    {
+      LogFlightRecorder recorder;
+      ASSERT_TRUE(recorder.Open(path, 8192));
+      recorder.Append("next session");
+    }
+    std::string history;
+    ASSERT_TRUE(LogFlightRecorder::ReadFile(path, history));
+    ASSERT_EQUAL(std::string("previous session\nnext session\n"), history);
+
+    LogFlightRecorder resized;
+    ASSERT_TRUE(resized.Open(path, 16384));
+    resized.Close();
+    ASSERT_TRUE(LogFlightRecorder::ReadFile(path, history));
+    ASSERT_TRUE(history.empty());
+    std::filesystem::remove(path);
+  }
+
+  TEST_CASE(rejects_non_recorder_file) {
+    std::string path = TempPath("anywp_fr_garbage.ring");
+    {
+      std::ofstream file(path, std::ios::binary);
+      file << "definitely not a flight recorder";
+    }
+    std::string history;
+    ASSERT_FALSE(LogFlightRecorder::ReadFile(path, history));
+    std::filesystem::remove(path);
+  }
+
+#ifndef _WIN32
+  TEST_CASE(history_survives_process_crash) {
+    std::string path = TempPath("anywp_fr_crash.ring");
+    std::filesystem::remove(path);
+
+    pid_t child = fork();
+    if (child == 0) {
+      LogFlightRecorder recorder;
+      if (!recorder.Open(path, 8192)) {
+        _exit(1);
+      }
+      recorder.Append("before crash 1");
+      recorder.Append("before crash 2");
+      abort();  // No Close(), no flush, no destructors
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    ASSERT_TRUE(WIFSIGNALED(status));
+
+    std::string history;
+    ASSERT_TRUE(LogFlightRecorder::ReadFile(path, history));
+    ASSERT_EQUAL(std::string("before crash 1\nbefore crash 2\n"), history);
+    std::filesystem::remove(path);
+  }
+#endif
+
+  TEST_CASE(logger_sink_sync_and_async) {
+    std::string path = TempPath("anywp_fr_logger.ring");
+    std::filesystem::remove(path);
+    Logger::Instance().EnableConsoleLogging(false);
+    ASSERT_TRUE(Logger::Instance().EnableFlightRecorder(path, 64 * 1024));
+
+    Logger::Instance().Info("Recorder", "sync line");
+    Logger::Instance().EnableAsync(true, 64);
+    Logger::Instance().Info("Recorder", "async line");
+    Logger::Instance().Flush();
+    Logger::Instance().EnableAsync(false);
+    Logger::Instance().DisableFlightRecorder();
+
+    std::string history;
+    ASSERT_TRUE(LogFlightRecorder::ReadFile(path, history));
+    ASSERT_EQUAL(static_cast<size_t>(26), history.find("[INFO] [Recorder] sync line\n"));
+    ASSERT_TRUE(history.find("[INFO] [Recorder] async line\n") != std::string::npos);
+    RestoreLogger();
+    std::filesystem::remove(path);
+  }
+}
+
+TEST_SUITE(LogRotator) {
+  TEST_CASE(gzip_output_round_trips) {
+    std::string source = TempPath("anywp_gzip_source.txt");
+    std::string compressed = source + ".gz";
+
+    std::string text;
+    for (int i = 0; i < 5000; i++) {
+      text += "[2025-01-15 10:30:45.123] [INFO] [WebViewManager] Navigation " +
+              std::to_string(i * 7919 % 1000) + "\n";
+    }
+    text += std::string("\0\xff\x01binary tail", 14);
+    {
+      std::ofstream file(source, std::ios::binary);
+      file << text;
+    }
+
+    ASSERT_TRUE(LogRotator::CompressFile(source, compressed));
+    size_t compressed_size = std::filesystem::file_size(compressed);
+    ASSERT_TRUE(compressed_size * 3 < text.size());
+
+    std::ifstream gz(compressed, std::ios::binary);
+    unsigned char magic[2] = {0, 0};
+    gz.read(reinterpret_cast<char*>(magic), 2);
+    gz.close();
+    ASSERT_EQUAL(0x1F, static_cast<int>(magic[0]));
+    ASSERT_EQUAL(0x8B, static_cast<int>(magic[1]));
+
+    if (GzipToolAvailable()) {
+      ASSERT_TRUE(GunzipWithTool(compressed) == text);
+    }
+    std::filesystem::remove(source);
+    std::filesystem::remove(compressed);
+  }
+
+  TEST_CASE(retention_by_count_and_bytes) {
+    std::string path = TempPath("anywp_retention.log");
+    RemoveLogAndArchives(path);
+    for (int i = 1; i <= 6; i++) {
+      std::ofstream file(path + "." + std::to_string(1000 + i) + (i % 2 ? ".gz" : ""), std::ios::binary);
+      file << std::string(100, 'x');
+    }
+    // Not archives of this log
+    std::ofstream(path + ".tmp") << "x";
+    std::ofstream(path + ".1007.gz.tmp") << "x";
+
+    ASSERT_EQUAL(static_cast<size_t>(6), LogRotator::ListArchives(path).size());
+
+    LogRotator::Policy by_count;
+    by_count.max_archives = 4;
+    by_count.max_total_bytes = 0;
+    LogRotator::EnforceRetention(path, by_count);
+    auto archives = LogRotator::ListArchives(path);
+    ASSERT_EQUAL(static_cast<size_t>(4), archives.size());
+    ASSERT_TRUE(archives.front().find(".1003") != std::string::npos);
+
+    LogRotator::Policy by_bytes;
+    by_bytes.max_archives = 0;
+    by_bytes.max_total_bytes = 250;
+    LogRotator::EnforceRetention(path, by_bytes);
+    archives = LogRotator::ListArchives(path);
+    ASSERT_EQUAL(static_cast<size_t>(2), archives.size());
+    ASSERT_TRUE(archives.back().find(".1006") != std::string::npos);
+
+    RemoveLogAndArchives(path);
+    std::filesystem::remove(path + ".tmp");
+    std::filesystem::remove(path + ".1007.gz.tmp");
+  }
+
+  TEST_CASE(logger_rotation_loses_no_lines) {
+    std::string path = TempPath("anywp_rotate.log");
+    RemoveLogAndArchives(path);
+    ResetLoggerToFile("anywp_rotate.log");
+    Logger::Instance().SetRotationPolicy(100, 0, true);
+    Logger::Instance().EnableRotation(4096);
+
+    const int kLines = 2000;
+    for (int i = 0; i < kLines; i++) {
+      Logger::Instance().Info("Rotate", "line " + std::to_string(i));
+    }
+    Logger::Instance().Flush();
+    Logger::Instance().DisableFileLogging();
+    Logger::Instance().EnableRotation(static_cast<size_t>(-1));
+
+    auto archives = LogRotator::ListArchives(path);
+    ASSERT_TRUE(archives.size() >= 2);
+    for (const auto& archive : archives) {
+      ASSERT_TRUE(archive.size() > 3 && archive.compare(archive.size() - 3, 3, ".gz") == 0);
+    }
+
+    if (GzipToolAvailable()) {
+      std::string all;
+      for (const auto& archive : archives) {
+        all += GunzipWithTool(archive);
+      }
+      std::ifstream active(path, std::ios::binary);
+      all += std::string((std::istreambuf_iterator<char>(active)), std::istreambuf_iterator<char>());
+
+      // Every line exactly once, in order (each file starts with a BOM)
+      std::istringstream lines(all);
+      std::string line;
+      int expected = 0;
+      while (std::getline(lines, line)) {
+        if (line.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+          line.erase(0, 3);
+        }
+        if (line.empty()) {
+          continue;  // Freshly rotated active file holding only its BOM
+        }
+        size_t at = line.find("line ");
+        ASSERT_TRUE(at != std::string::npos);
+        ASSERT_EQUAL(expected, std::stoi(line.substr(at + 5)));
+        expected++;
+      }
+      ASSERT_EQUAL(kLines, expected);
+    }
+
+    Logger::Instance().SetRotationPolicy(5, 50 * 1024 * 1024, true);
+    RemoveLogAndArchives(path);
+    RestoreLogger();
+  }
+
+  TEST_CASE(retention_applied_after_rotation) {
+    std::string path = TempPath("anywp_rotate_keep.log");
+    RemoveLogAndArchives(path);
+    ResetLoggerToFile("anywp_rotate_keep.log");
+    Logger::Instance().SetRotationPolicy(2, 0, false);
+    Logger::Instance().EnableRotation(1024);
+
+    for (int i = 0; i < 500; i++) {
+      Logger::Instance().Info("Rotate", "retained line " + std::to_string(i));
+    }
+    Logger::Instance().Flush();
+    Logger::Instance().DisableFileLogging();
+    Logger::Instance().EnableRotation(static_cast<size_t>(-1));
+
+    auto archives = LogRotator::ListArchives(path);
+    ASSERT_EQUAL(static_cast<size_t>(2), archives.size());
+    ASSERT_TRUE(archives[0].find(".gz") == std::string::npos);
+
+    Logger::Instance().SetRotationPolicy(5, 50 * 1024 * 1024, true);
+    RemoveLogAndArchives(path);
+    RestoreLogger();
+  }
+}
+
+TEST_SUITE(LogPayload) {
+  TEST_CASE(short_payload_passes_through) {
+    ASSERT_EQUAL(std::string("{\"type\":\"ready\"}"), LogPayload("{\"type\":\"ready\"}"));
+    ASSERT_EQUAL(std::string(""), LogPayload(""));
+  }
+
+  TEST_CASE(long_payload_truncated_with_digest) {
+    std::string payload(100000, 'x');
+    std::string rendered = LogPayload(payload);
+
+    ASSERT_EQUAL(std::string(kLogPayloadPreview, 'x'), rendered.substr(0, kLogPayloadPreview));
+    ASSERT_EQUAL(std::string("... ") + LogDigest(payload), rendered.substr(kLogPayloadPreview));
+    ASSERT_TRUE(rendered.find("<100000 bytes, fnv1a=") != std::string::npos);
+    ASSERT_TRUE(rendered.size() < kLogPayloadPreview + 64);
+  }
+
+  TEST_CASE(digest_is_fnv1a_without_content) {
+    ASSERT_EQUAL(std::string("<0 bytes, fnv1a=811c9dc5>"), LogDigest(""));
+    ASSERT_EQUAL(std::string("<1 bytes, fnv1a=e40c292c>"), LogDigest("a"));
+    ASSERT_EQUAL(LogDigest("secret-token"), LogDigest(std::string("secret-token")));
+    ASSERT_NOT_EQUAL(LogDigest("secret-token"), LogDigest("secret-tokem"));
+    ASSERT_TRUE(LogDigest("secret-token").find("secret") == std::string::npos);
+  }
+
+  TEST_CASE(truncation_keeps_utf8_sequences_whole) {
+    std::string payload;
+    for (int i = 0; i < 10; i++) {
+      payload += "\xE4\xBD\xA0";  // 3-byte code point
+    }
+    std::string rendered = LogPayload(payload, 7);
+    ASSERT_EQUAL(std::string("\xE4\xBD\xA0\xE4\xBD\xA0... ") + LogDigest(payload), rendered);
+  }
+
+  TEST_CASE(control_characters_cannot_forge_lines) {
+    ASSERT_EQUAL(std::string("a\\nb\\rc\\td?e"), LogPayload("a\nb\rc\td\x01" "e"));
+  }
+}
+
+TEST_SUITE(HotPathConsole) {
+  TEST_CASE(sync_console_lines_on_hot_path_are_counted) {
+    RestoreLogger();
+    size_t before = Statistic("HotPathConsoleLines");
+    std::string text;
+    {
+      ConsoleCapture capture;
+      {
+        ANYWP_HOT_PATH();
+        ASSERT_TRUE(HotPathScope::IsActive());
+        Logger::Instance().Info("HotPath", "inside hook");
+      }
+      ASSERT_FALSE(HotPathScope::IsActive());
+      Logger::Instance().Info("HotPath", "outside hook");
+      text = capture.Text();
+    }
+
+    ASSERT_EQUAL(before + 1, Statistic("HotPathConsoleLines"));
+    ASSERT_TRUE(text.find("outside hook") != std::string::npos);
+#ifdef ANYWP_NO_CONSOLE_IO
+    ASSERT_TRUE(text.find("inside hook") == std::string::npos);
+#else
+    ASSERT_TRUE(text.find("inside hook") != std::string::npos);
+#endif
+  }
+
+  TEST_CASE(hot_path_lines_still_reach_file) {
+    std::string path = ResetLoggerToFile("anywp_hot_path.log");
+    Logger::Instance().EnableConsoleLogging(true);
+    {
+      ConsoleCapture capture;
+      ANYWP_HOT_PATH();
+      ANYWP_LOG_INFO("HotPath", "hook line");
+    }
+    Logger::Instance().Flush();
+    Logger::Instance().DisableFileLogging();
+
+    std::ifstream file(path, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ASSERT_TRUE(content.find("[HotPath] hook line") != std::string::npos);
+    RestoreLogger();
+  }
+
+  TEST_CASE(async_mode_writes_console_off_the_hot_thread) {
+    RestoreLogger();
+    size_t before = Statistic("HotPathConsoleLines");
+    std::string text;
+    {
+      ConsoleCapture capture;
+      Logger::Instance().EnableAsync(true, 64);
+      {
+        ANYWP_HOT_PATH();
+        Logger::Instance().Info("HotPath", "queued from hook");
+      }
+      Logger::Instance().Flush();
+      Logger::Instance().EnableAsync(false);
+      text = capture.Text();
+    }
+
+    ASSERT_EQUAL(before, Statistic("HotPathConsoleLines"));
+    ASSERT_TRUE(text.find("queued from hook") != std::string::npos);
+  }
+
+  TEST_CASE(hot_path_never_blocks_on_full_ring) {
+    ResetLoggerToFile("anywp_hot_path_block.log");
+    size_t blocked_before = Statistic("AsyncBlocked");
+    size_t dropped_before = Statistic("AsyncDropped");
+    Logger::Instance().EnableAsync(true, 2, Logger::OverflowPolicy::BLOCK);
+    {
+      ANYWP_HOT_PATH();
+      for (int i = 0; i < 500; i++) {
+        Logger::Instance().Info("HotPath", "storm " + std::to_string(i));
+      }
+    }
+    Logger::Instance().Flush();
+    Logger::Instance().EnableAsync(false);
+
+    ASSERT_EQUAL(blocked_before, Statistic("AsyncBlocked"));
+    ASSERT_TRUE(Statistic("AsyncDropped") > dropped_before);
+    RestoreLogger();
+  }
+}
+
+TEST_SUITE(EventBusSnapshots) {
+  TEST_CASE(retired_snapshot_lives_until_readers_leave) {
+    struct Tracked {
+      explicit Tracked(std::atomic<int>* counter) : live(counter) { live->fetch_add(1); }
+      ~Tracked() { live->fetch_sub(1); }
+      std::atomic<int>* live;
+    };
+    std::atomic<int> live{0};
+    SnapshotPtr<Tracked> snapshot(std::make_unique<const Tracked>(&live));
+
+    std::atomic<bool> reading{false};
+    std::atomic<bool> release{false};
+    bool intact = false;
+    std::thread reader([&] {
+      EpochGuard guard;
+      const Tracked* seen = snapshot.Load();
+      reading = true;
+      while (!release) {
+        std::this_thread::yield();
+      }
+      intact = seen->live == &live;
+    });
+    while (!reading) {
+      std::this_thread::yield();
+    }
+
+    snapshot.Store(std::make_unique<const Tracked>(&live));
+    ASSERT_EQUAL(2, live.load());  // The reader may still use the old one
+    release = true;
+    reader.join();
+    ASSERT_TRUE(intact);
+
+    snapshot.Store(std::make_unique<const Tracked>(&live));
+    ASSERT_EQUAL(1, live.load());
+  }
+
+  TEST_CASE(priority_then_subscription_order) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    std::vector<int> calls;
+    bus.Subscribe("order", [&](const Event&) { calls.push_back(1); }, 0);
+    bus.Subscribe("order", [&](const Event&) { calls.push_back(2); }, 5);
+    bus.Subscribe("order", [&](const Event&) { calls.push_back(3); }, 0);
+    bus.Subscribe("order", [&](const Event&) { calls.push_back(4); }, 5);
+
+    bus.Publish("order");
+    ASSERT_EQUAL(std::vector<int>({2, 4, 1, 3}), calls);
+    bus.Clear();
+  }
+
+  TEST_CASE(unsubscribe_removes_only_that_handler) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    int first = 0;
+    int second = 0;
+    auto sub = bus.Subscribe("unsub", [&](const Event&) { first++; });
+    bus.Subscribe("unsub", [&](const Event&) { second++; });
+    bus.Subscribe("other", [](const Event&) {});
+
+    bus.Unsubscribe(sub);
+    bus.Unsubscribe(sub);  // Second call is a no-op
+    bus.Publish("unsub");
+
+    ASSERT_EQUAL(0, first);
+    ASSERT_EQUAL(1, second);
+    ASSERT_EQUAL(static_cast<size_t>(1), bus.GetSubscriberCount("unsub"));
+    ASSERT_EQUAL(std::vector<std::string>({"other", "unsub"}), bus.GetActiveEventTypes());
+    bus.Clear();
+    ASSERT_EQUAL(static_cast<size_t>(0), bus.GetActiveEventTypes().size());
+  }
+
+  TEST_CASE(handlers_may_subscribe_during_publish) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    int late_calls = 0;
+    std::shared_ptr<EventSubscription> self;
+    self = bus.Subscribe("reentrant", [&](const Event&) {
+      // Would deadlock if Publish held the writer mutex
+      bus.Subscribe("reentrant", [&](const Event&) { late_calls++; });
+      bus.Unsubscribe(self);
+    });
+
+    bus.Publish("reentrant");  // Runs on the old snapshot
+    ASSERT_EQUAL(0, late_calls);
+    bus.Publish("reentrant");
+    ASSERT_EQUAL(1, late_calls);
+    bus.Clear();
+  }
+
+  TEST_CASE(concurrent_publish_and_subscribe) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    std::atomic<size_t> delivered{0};
+    bus.Subscribe("storm", [&](const Event&) { delivered.fetch_add(1); });
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> publishers;
+    for (int t = 0; t < 3; t++) {
+      publishers.emplace_back([&] {
+        Event event("storm", "Test");
+        do {
+          bus.Publish(event);
+        } while (!stop.load());
+      });
+    }
+    for (int i = 0; i < 200; i++) {
+      auto sub = bus.Subscribe("storm", [](const Event&) {}, i % 3);
+      bus.Unsubscribe(sub);
+    }
+    stop.store(true);
+    for (auto& publisher : publishers) {
+      publisher.join();
+    }
+
+    ASSERT_TRUE(delivered.load() > 0);
+    ASSERT_EQUAL(static_cast<size_t>(1), bus.GetSubscriberCount("storm"));
+    bus.Clear();
+  }
+}
+
+namespace {
+
+// Spins until `open` is set; used to hold a dispatcher worker inside a handler
+void WaitForGate(const std::atomic<bool>& open) {
+  while (!open.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void RestoreDefaultDispatch() {
+  EventBus::Instance().ConfigureAsyncDispatch(1, 1024, EventExecutor::OverflowPolicy::DROP_OLDEST);
+  EventBus::Instance().Clear();
+}
+
+}  // namespace
+
+TEST_SUITE(EventBusAsync) {
+  TEST_CASE(publish_async_runs_on_dispatcher_thread) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    std::atomic<int> calls{0};
+    std::thread::id handler_thread;
+    bus.Subscribe("async.basic", [&](const Event&) {
+      handler_thread = std::this_thread::get_id();
+      calls.fetch_add(1);
+    });
+
+    ASSERT_TRUE(bus.PublishAsync(Event("async.basic", "Test")));
+    bus.FlushAsync();
+
+    ASSERT_EQUAL(1, calls.load());
+    ASSERT_TRUE(handler_thread != std::this_thread::get_id());
+    bus.Clear();
+  }
+
+  TEST_CASE(delivery_modes_choose_the_handler_thread) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    bus.RegisterExecutor("test.executor", 1, 16, EventExecutor::OverflowPolicy::BLOCK);
+
+    std::thread::id inline_thread, async_thread, executor_thread;
+    bus.Subscribe("async.modes", [&](const Event&) { inline_thread = std::this_thread::get_id(); });
+
+    EventBus::SubscribeOptions async_options;
+    async_options.delivery = EventBus::Delivery::ASYNC;
+    bus.Subscribe("async.modes", [&](const Event&) { async_thread = std::this_thread::get_id(); },
+                  async_options);
+
+    EventBus::SubscribeOptions executor_options;
+    executor_options.delivery = EventBus::Delivery::EXECUTOR;
+    executor_options.executor = "test.executor";
+    bus.Subscribe("async.modes", [&](const Event&) { executor_thread = std::this_thread::get_id(); },
+                  executor_options);
+
+    bus.Publish(Event("async.modes", "Test"));
+    ASSERT_TRUE(inline_thread == std::this_thread::get_id());
+    bus.FlushAsync();
+
+    ASSERT_TRUE(async_thread != std::thread::id());
+    ASSERT_TRUE(executor_thread != std::thread::id());
+    ASSERT_TRUE(async_thread != std::this_thread::get_id());
+    ASSERT_TRUE(executor_thread != std::this_thread::get_id());
+    ASSERT_TRUE(async_thread != executor_thread);
+    bus.Clear();
+  }
+
+  TEST_CASE(executor_released_by_its_own_task_finishes_the_queue) {
+    auto executor = std::make_shared<EventExecutor>("test.self_release", 1, 16,
+                                                    EventExecutor::OverflowPolicy::BLOCK);
+    std::atomic<bool> go{false};
+    std::atomic<bool> done{false};
+    // The last reference drops on the worker when this task is released
+    executor->Post("self", [keep = executor, &go] {
+      while (!go.load()) {
+        std::this_thread::yield();
+      }
+    });
+    executor->Post("self", [&done] { done.store(true); });
+    executor.reset();
+    go.store(true);
+
+    for (int i = 0; i < 500 && !done.load(); i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT_TRUE(done.load());
+  }
+
+  TEST_CASE(executor_metrics_fold_topics_beyond_the_limit) {
+    EventExecutor executor("test.topic_limit", 1, 1024, EventExecutor::OverflowPolicy::BLOCK);
+    size_t topics = EventExecutor::kMaxTopics + 100;
+    for (size_t i = 0; i < topics; i++) {
+      executor.Post("test.topic." + std::to_string(i), [] {});
+    }
+    executor.Drain();
+
+    auto metrics = executor.GetMetrics();
+    ASSERT_EQUAL(EventExecutor::kMaxTopics + 1, metrics.size());
+    ASSERT_EQUAL(static_cast<size_t>(1), metrics["test.topic.0"].delivered);
+    ASSERT_EQUAL(static_cast<size_t>(100), metrics[EventExecutor::kOtherTopics].delivered);
+    size_t delivered = 0;
+    for (const auto& pair : metrics) {
+      delivered += pair.second.delivered;
+      ASSERT_EQUAL(static_cast<size_t>(0), pair.second.queued);
+    }
+    ASSERT_EQUAL(topics, delivered);
+  }
+
+  TEST_CASE(single_worker_keeps_publish_order) {
+    EventBus& bus = EventBus::Instance();
+    bus.ConfigureAsyncDispatch(1, 64, EventExecutor::OverflowPolicy::BLOCK);
+    bus.Clear();
+
+    std::vector<int> seen;
+    bus.Subscribe("async.order", [&](const Event& e) { seen.push_back(e.GetData<int>("seq", -1)); });
+
+    for (int i = 0; i < 500; i++) {
+      Event event("async.order", "Test");
+      event.SetData("seq", i);
+      ASSERT_TRUE(bus.PublishAsync(event));
+    }
+    bus.FlushAsync();
+
+    ASSERT_EQUAL(static_cast<size_t>(500), seen.size());
+    for (int i = 0; i < 500; i++) {
+      ASSERT_EQUAL(i, seen[i]);
+    }
+    RestoreDefaultDispatch();
+  }
+
+  TEST_CASE(drop_newest_counts_every_event) {
+    EventBus& bus = EventBus::Instance();
+    bus.ConfigureAsyncDispatch(1, 4, EventExecutor::OverflowPolicy::DROP_NEWEST);
+    bus.Clear();
+
+    std::atomic<bool> open{false};
+    std::atomic<size_t> delivered{0};
+    bus.Subscribe("async.drop_newest", [&](const Event&) {
+      WaitForGate(open);
+      delivered.fetch_add(1);
+    });
+
+    size_t accepted = 0;
+    for (int i = 0; i < 20; i++) {
+      accepted += bus.PublishAsync(Event("async.drop_newest", "Test")) ? 1 : 0;
+    }
+    open.store(true);
+    bus.FlushAsync();
+
+    auto metrics = bus.GetTopicMetrics()["async.drop_newest"];
+    ASSERT_TRUE(metrics.dropped > 0);
+    ASSERT_EQUAL(accepted, delivered.load());
+    ASSERT_EQUAL(static_cast<size_t>(20), metrics.delivered + metrics.dropped);
+    ASSERT_EQUAL(static_cast<size_t>(0), metrics.queued);
+    RestoreDefaultDispatch();
+  }
+
+  TEST_CASE(drop_oldest_keeps_the_latest_event) {
+    EventBus& bus = EventBus::Instance();
+    bus.ConfigureAsyncDispatch(1, 4, EventExecutor::OverflowPolicy::DROP_OLDEST);
+    bus.Clear();
+
+    std::atomic<bool> open{false};
+    std::vector<int> seen;
+    bus.Subscribe("async.drop_oldest", [&](const Event& e) {
+      WaitForGate(open);
+      seen.push_back(e.GetData<int>("seq", -1));
+    });
+
+    for (int i = 0; i < 20; i++) {
+      Event event("async.drop_oldest", "Test");
+      event.SetData("seq", i);
+      ASSERT_TRUE(bus.PublishAsync(event));
+    }
+    open.store(true);
+    bus.FlushAsync();
+
+    auto metrics = bus.GetTopicMetrics()["async.drop_oldest"];
+    ASSERT_TRUE(metrics.dropped > 0);
+    ASSERT_EQUAL(metrics.delivered, seen.size());
+    ASSERT_FALSE(seen.empty());
+    ASSERT_EQUAL(19, seen.back());
+    ASSERT_TRUE(metrics.max_queued <= 4);
+    RestoreDefaultDispatch();
+  }
+
+  TEST_CASE(block_policy_loses_nothing) {
+    EventBus& bus = EventBus::Instance();
+    bus.ConfigureAsyncDispatch(2, 2, EventExecutor::OverflowPolicy::BLOCK);
+    bus.Clear();
+
+    std::atomic<size_t> delivered{0};
+    bus.Subscribe("async.block", [&](const Event&) { delivered.fetch_add(1); });
+
+    std::vector<std::thread> publishers;
+    for (int t = 0; t < 3; t++) {
+      publishers.emplace_back([&] {
+        for (int i = 0; i < 200; i++) {
+          bus.PublishAsync(Event("async.block", "Test"));
+        }
+      });
+    }
+    for (auto& publisher : publishers) {
+      publisher.join();
+    }
+    bus.FlushAsync();
+
+    auto metrics = bus.GetTopicMetrics()["async.block"];
+    ASSERT_EQUAL(static_cast<size_t>(600), delivered.load());
+    ASSERT_EQUAL(static_cast<size_t>(600), metrics.enqueued);
+    ASSERT_EQUAL(static_cast<size_t>(0), metrics.dropped);
+    ASSERT_TRUE(metrics.max_queued <= 2);
+    RestoreDefaultDispatch();
+  }
+
+  TEST_CASE(unknown_executor_falls_back_to_dispatcher) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    std::thread::id handler_thread;
+
+    EventBus::SubscribeOptions options;
+    options.delivery = EventBus::Delivery::EXECUTOR;
+    options.executor = "no.such.executor";
+    bus.Subscribe("async.fallback", [&](const Event&) { handler_thread = std::this_thread::get_id(); },
+                  options);
+
+    bus.Publish(Event("async.fallback", "Test"));
+    bus.FlushAsync();
+
+    ASSERT_TRUE(handler_thread != std::thread::id());
+    ASSERT_TRUE(handler_thread != std::this_thread::get_id());
+    bus.Clear();
+  }
+}
+
+namespace {
+
+struct PluginPing {
+  static constexpr const char* kTopic = "test.plugin_ping";
+  int sequence = 0;
+};
+
+// Counts copies so tests can check that inline delivery never copies
+struct CopyCounted {
+  static constexpr const char* kTopic = "test.copy_counted";
+  static int copies;
+
+  std::vector<int> values;
+
+  CopyCounted() = default;
+  CopyCounted(const CopyCounted& other) : values(other.values) { copies++; }
+  CopyCounted(CopyCounted&&) = default;
+};
+int CopyCounted::copies = 0;
+
+}  // namespace
+
+TEST_SUITE(EventBusTypedTopics) {
+  TEST_CASE(builtin_topics_have_fixed_ids) {
+    TopicRegistry& registry = TopicRegistry::Instance();
+    ASSERT_EQUAL(static_cast<TopicId>(topics::kMonitorChanged), registry.Find("monitor.changed"));
+    ASSERT_EQUAL(std::string("power.state_changed"), registry.Name(topics::kPowerStateChanged));
+    ASSERT_EQUAL(kInvalidTopic, registry.Find("test.never_interned"));
+
+    TopicId id = registry.Intern("test.interned");
+    ASSERT_TRUE(id > static_cast<TopicId>(topics::kBuiltinCount));
+    ASSERT_EQUAL(id, registry.Intern("test.interned"));
+    ASSERT_EQUAL(std::string("test.interned"), registry.Name(id));
+  }
+
+  TEST_CASE(typed_publish_reaches_typed_subscriber) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    MonitorChanged received;
+    int calls = 0;
+    bus.Subscribe<MonitorChanged>([&](const MonitorChanged& m) {
+      received = m;
+      calls++;
+    });
+
+    bus.Publish(MonitorChanged{3, 1});
+
+    ASSERT_EQUAL(1, calls);
+    ASSERT_EQUAL(3, received.monitor_count);
+    ASSERT_EQUAL(1, received.primary_index);
+    ASSERT_EQUAL(static_cast<size_t>(1), bus.GetSubscriberCount("monitor.changed"));
+    bus.Clear();
+  }
+
+  TEST_CASE(string_subscribers_see_an_adapted_event) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    std::string type;
+    int monitor_count = 0;
+    bus.Subscribe("monitor.changed", [&](const Event& e) {
+      type = e.type;
+      monitor_count = e.GetData<MonitorChanged>("payload").monitor_count;
+    });
+
+    bus.Publish(MonitorChanged{2, 0});
+
+    ASSERT_EQUAL(std::string("monitor.changed"), type);
+    ASSERT_EQUAL(2, monitor_count);
+    bus.Clear();
+  }
+
+  TEST_CASE(typed_subscribers_skip_string_events) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    int typed_calls = 0;
+    int string_calls = 0;
+    bus.Subscribe<MonitorChanged>([&](const MonitorChanged&) { typed_calls++; });
+    bus.Subscribe("monitor.changed", [&](const Event&) { string_calls++; });
+
+    bus.Publish(Event("monitor.changed", "Test"));
+
+    ASSERT_EQUAL(0, typed_calls);
+    ASSERT_EQUAL(1, string_calls);
+    bus.Clear();
+  }
+
+  TEST_CASE(named_topics_are_interned_on_first_use) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    int last = -1;
+    auto sub = bus.Subscribe<PluginPing>([&](const PluginPing& p) { last = p.sequence; });
+
+    bus.Publish(PluginPing{7});
+
+    ASSERT_EQUAL(7, last);
+    ASSERT_EQUAL(TopicOf<PluginPing>(), TopicRegistry::Instance().Find("test.plugin_ping"));
+    bus.Unsubscribe(sub);
+    ASSERT_EQUAL(static_cast<size_t>(0), bus.GetSubscriberCount("test.plugin_ping"));
+    bus.Clear();
+  }
+
+  TEST_CASE(inline_delivery_never_copies_the_payload) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    size_t size = 0;
+    bus.Subscribe<CopyCounted>([&](const CopyCounted& c) { size = c.values.size(); });
+
+    CopyCounted payload;
+    payload.values.assign(100, 1);
+    CopyCounted::copies = 0;
+    bus.Publish(payload);
+
+    ASSERT_EQUAL(static_cast<size_t>(100), size);
+    ASSERT_EQUAL(0, CopyCounted::copies);
+    bus.Clear();
+  }
+
+  TEST_CASE(publish_async_moves_the_payload) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    size_t size = 0;
+    bus.Subscribe<CopyCounted>([&](const CopyCounted& c) { size = c.values.size(); });
+
+    CopyCounted payload;
+    payload.values.assign(100, 1);
+    CopyCounted::copies = 0;
+    ASSERT_TRUE(bus.PublishAsync(std::move(payload)));
+    bus.FlushAsync();
+
+    ASSERT_EQUAL(static_cast<size_t>(100), size);
+    ASSERT_EQUAL(0, CopyCounted::copies);
+    bus.Clear();
+  }
+}
+
+TEST_SUITE(EventHistory) {
+  TEST_CASE(ring_keeps_the_newest_events) {
+    EventHistory history(3, 1024 * 1024);
+    TopicId topic = TopicRegistry::Instance().Intern("test.history");
+    for (int i = 0; i < 5; i++) {
+      auto event = std::make_shared<Event>("test.history");
+      event->SetData("index", i);
+      history.Append(topic, event);
+    }
+
+    auto events = history.Recent(10);
+    ASSERT_EQUAL(static_cast<size_t>(3), events.size());
+    ASSERT_EQUAL(2, events.front()->GetData<int>("index"));
+    ASSERT_EQUAL(4, events.back()->GetData<int>("index"));
+    ASSERT_EQUAL(static_cast<size_t>(2), history.GetStats().evicted);
+  }
+
+  TEST_CASE(byte_ceiling_bounds_memory) {
+    Event sample("test.history");
+    sample.SetData("blob", std::string(200, 'x'));
+    size_t per_event = EventHistory::EstimateBytes(sample);
+    EventHistory history(1000, per_event * 4);
+    TopicId topic = TopicRegistry::Instance().Intern("test.history");
+
+    for (int i = 0; i < 50; i++) {
+      history.Append(topic, std::make_shared<Event>(sample));
+    }
+
+    EventHistory::Stats stats = history.GetStats();
+    ASSERT_EQUAL(static_cast<size_t>(4), stats.events);
+    ASSERT_TRUE(stats.bytes <= per_event * 4);
+    ASSERT_EQUAL(static_cast<size_t>(46), stats.evicted);
+  }
+
+  TEST_CASE(query_by_topic_and_time_window) {
+    EventHistory history(100, 1024 * 1024);
+    TopicId monitor = TopicRegistry::Instance().Intern("monitor.changed");
+    TopicId other = TopicRegistry::Instance().Intern("test.history");
+    auto now = EventHistory::Clock::now();
+
+    for (int i = 0; i < 6; i++) {
+      // One event every 10 s, alternating topics; the last one is "now"
+      auto recorded = now - std::chrono::seconds(10 * (5 - i));
+      auto event = std::make_shared<Event>(i % 2 ? "monitor.changed" : "test.history");
+      event->SetData("index", i);
+      history.Append(i % 2 ? monitor : other, event, recorded);
+    }
+
+    auto recent = history.Query(monitor, now - std::chrono::seconds(30), now);
+    ASSERT_EQUAL(static_cast<size_t>(2), recent.size());
+    ASSERT_EQUAL(3, recent[0]->GetData<int>("index"));
+    ASSERT_EQUAL(5, recent[1]->GetData<int>("index"));
+
+    ASSERT_EQUAL(static_cast<size_t>(4),
+                 history.Query(kInvalidTopic, now - std::chrono::seconds(30), now).size());
+    ASSERT_EQUAL(static_cast<size_t>(3), history.Query(monitor, now - std::chrono::hours(1)).size());
+  }
+
+  TEST_CASE(shrinking_limits_keeps_the_index_valid) {
+    EventHistory history(10, 1024 * 1024);
+    TopicId topic = TopicRegistry::Instance().Intern("test.history");
+    for (int i = 0; i < 10; i++) {
+      auto event = std::make_shared<Event>("test.history");
+      event->SetData("index", i);
+      history.Append(topic, event);
+    }
+
+    history.SetLimits(4, 1024 * 1024);
+
+    auto events = history.Query(topic, EventHistory::Clock::time_point());
+    ASSERT_EQUAL(static_cast<size_t>(4), events.size());
+    ASSERT_EQUAL(6, events.front()->GetData<int>("index"));
+    ASSERT_EQUAL(9, events.back()->GetData<int>("index"));
+  }
+
+  TEST_CASE(evicted_events_spill_to_disk) {
+    std::string path = TempPath("anywp_test_history_spill.log");
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".1");
+    {
+      EventHistory history(2, 1024 * 1024);
+      ASSERT_TRUE(history.EnableSpill(path));
+      TopicId topic = TopicRegistry::Instance().Intern("monitor.changed");
+      for (int i = 0; i < 5; i++) {
+        auto event = std::make_shared<Event>("monitor.changed", "DisplayManager");
+        event->SetData("count", i);
+        history.Append(topic, event);
+      }
+      ASSERT_EQUAL(static_cast<size_t>(3), history.GetStats().spilled);
+    }
+
+    ASSERT_EQUAL(static_cast<size_t>(3), CountLines(path));
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    ASSERT_TRUE(line.find("\tmonitor.changed\tDisplayManager\tcount=0") != std::string::npos);
+    file.close();
+    std::filesystem::remove(path);
+  }
+
+  TEST_CASE(spill_queue_counts_against_the_byte_ceiling) {
+    std::string path = TempPath("anywp_test_history_spill_bytes.log");
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".1");
+    Event sample("test.history");
+    sample.SetData("blob", std::string(2000, 'x'));
+    size_t per_event = EventHistory::EstimateBytes(sample);
+    size_t max_bytes = per_event * 16;
+    TopicId topic = TopicRegistry::Instance().Intern("test.history");
+    {
+      EventHistory history(1000, max_bytes);
+      ASSERT_TRUE(history.EnableSpill(path));
+      size_t peak = 0;
+      for (int i = 0; i < 500; i++) {
+        history.Append(topic, std::make_shared<Event>(sample));
+        EventHistory::Stats stats = history.GetStats();
+        peak = std::max(peak, stats.bytes + stats.spill_queued_bytes);
+      }
+
+      // Larger than the spill queue's share: never queued
+      Event huge("test.history");
+      huge.SetData("blob", std::string(max_bytes, 'x'));
+      history.Append(topic, std::make_shared<Event>(huge));
+
+      EventHistory::Stats stats = history.GetStats();
+      peak = std::max(peak, stats.bytes + stats.spill_queued_bytes);
+      ASSERT_TRUE(peak <= max_bytes);
+      ASSERT_TRUE(stats.events <= 12);  // The ring keeps three quarters
+      ASSERT_TRUE(stats.spill_dropped >= 1);
+      ASSERT_EQUAL(stats.evicted, stats.spilled + stats.spill_dropped);
+      ASSERT_EQUAL(static_cast<size_t>(501), stats.events + stats.evicted);
+    }
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".1");
+  }
+
+  TEST_CASE(event_bus_shares_history_and_queries_by_type) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    bus.SetHistoryTracking(true, 100);
+
+    bus.Publish(Event("test.history_unsubscribed", "Test"));
+    bus.Publish(MonitorChanged{2, 0});
+    bus.Publish(Event("monitor.changed", "Test"));
+
+    ASSERT_EQUAL(static_cast<size_t>(3), bus.GetHistory().size());
+    ASSERT_EQUAL(std::string("monitor.changed"), bus.GetHistory().back().type);
+    ASSERT_EQUAL(bus.GetRecentHistory(2).front().get(), bus.QueryHistory("monitor.changed",
+                 std::chrono::seconds(30)).front().get());
+    auto monitor = bus.QueryHistory("monitor.changed", std::chrono::seconds(30));
+    ASSERT_EQUAL(static_cast<size_t>(2), monitor.size());
+    ASSERT_EQUAL(2, monitor[0]->GetData<MonitorChanged>("payload").monitor_count);
+    ASSERT_EQUAL(static_cast<size_t>(1),
+                 bus.QueryHistory("test.history_unsubscribed", std::chrono::seconds(30)).size());
+    ASSERT_EQUAL(static_cast<size_t>(0),
+                 bus.QueryHistory("test.history_never_published", std::chrono::seconds(30)).size());
+
+    bus.SetHistoryTracking(false);
+    ASSERT_EQUAL(static_cast<size_t>(0), bus.GetHistory().size());
+    ASSERT_EQUAL(static_cast<size_t>(0), bus.GetHistoryStats().events);
+    bus.Clear();
+  }
+}
+
+TEST_SUITE(TopicTrie) {
+  TEST_CASE(detects_whole_segment_wildcards) {
+    ASSERT_TRUE(TopicTrie::IsPattern("wallpaper.*"));
+    ASSERT_TRUE(TopicTrie::IsPattern("wallpaper.**"));
+    ASSERT_TRUE(TopicTrie::IsPattern("*.error"));
+    ASSERT_FALSE(TopicTrie::IsPattern("wallpaper.stopped"));
+    ASSERT_FALSE(TopicTrie::IsPattern("wall*.stopped"));
+  }
+
+  TEST_CASE(star_matches_one_segment_globstar_several) {
+    TopicTrie trie;
+    TopicTrie::PatternId one = trie.Insert("wallpaper.*");
+    TopicTrie::PatternId many = trie.Insert("wallpaper.**");
+    TopicTrie::PatternId error = trie.Insert("*.error");
+    ASSERT_EQUAL(one, trie.Insert("wallpaper.*"));
+    ASSERT_EQUAL(static_cast<size_t>(3), trie.PatternCount());
+
+    ASSERT_EQUAL((std::vector<TopicTrie::PatternId>{one, many}), trie.Match("wallpaper.stopped"));
+    ASSERT_EQUAL(std::vector<TopicTrie::PatternId>{many}, trie.Match("wallpaper.navigation.started"));
+    ASSERT_EQUAL(std::vector<TopicTrie::PatternId>{error}, trie.Match("webview.error"));
+    ASSERT_TRUE(trie.Match("wallpaper").empty());
+    ASSERT_TRUE(trie.Match("monitor.changed").empty());
+  }
+
+  TEST_CASE(globstar_in_the_middle_reports_each_pattern_once) {
+    TopicTrie trie;
+    TopicTrie::PatternId id = trie.Insert("a.**.z");
+    ASSERT_EQUAL(std::vector<TopicTrie::PatternId>{id}, trie.Match("a.b.z"));
+    ASSERT_EQUAL(std::vector<TopicTrie::PatternId>{id}, trie.Match("a.z.z.z"));
+    ASSERT_TRUE(trie.Match("a.z").empty());
+    ASSERT_EQUAL(TopicTrie::kNoPattern, trie.Find("a.*.z"));
+    ASSERT_EQUAL(id, trie.Find("a.**.z"));
+  }
+
+  TEST_CASE(remove_prunes_the_pattern_and_reuses_its_id) {
+    TopicTrie trie;
+    TopicTrie::PatternId deep = trie.Insert("a.b.*");
+    TopicTrie::PatternId shallow = trie.Insert("a.*");
+
+    ASSERT_TRUE(trie.Remove("a.b.*"));
+    ASSERT_FALSE(trie.Remove("a.b.*"));
+    ASSERT_EQUAL(TopicTrie::kNoPattern, trie.Find("a.b.*"));
+    ASSERT_TRUE(trie.Match("a.b.c").empty());
+    ASSERT_EQUAL(std::vector<TopicTrie::PatternId>{shallow}, trie.Match("a.b"));
+    ASSERT_EQUAL(static_cast<size_t>(1), trie.PatternCount());
+
+    ASSERT_EQUAL(deep, trie.Insert("x.**"));
+    ASSERT_EQUAL(std::vector<TopicTrie::PatternId>{deep}, trie.Match("x.y.z"));
+    ASSERT_TRUE(trie.Remove("a.*"));
+    ASSERT_TRUE(trie.Match("a.b").empty());
+  }
+}
+
+TEST_SUITE(EventBusWildcards) {
+  TEST_CASE(patterns_receive_matching_topics) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    std::vector<std::string> one;
+    std::vector<std::string> many;
+    bus.Subscribe("wallpaper.*", [&](const Event& e) { one.push_back(e.type); });
+    bus.Subscribe("wallpaper.**", [&](const Event& e) { many.push_back(e.type); });
+
+    bus.Publish("wallpaper.stopped");
+    bus.Publish("wallpaper.navigation.started");
+    bus.Publish("wallpaper.test_never_interned");
+    bus.Publish("monitor.changed");
+
+    ASSERT_EQUAL((std::vector<std::string>{"wallpaper.stopped", "wallpaper.test_never_interned"}),
+                 one);
+    ASSERT_EQUAL(static_cast<size_t>(3), many.size());
+    ASSERT_EQUAL(static_cast<size_t>(1), bus.GetSubscriberCount("wallpaper.*"));
+    bus.Clear();
+  }
+
+  TEST_CASE(unknown_names_are_matched_without_being_interned) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    std::atomic<int> calls{0};
+    bus.Subscribe("probe.**", [&](const Event&) { calls++; });
+    TopicId max_id = TopicRegistry::Instance().MaxId();
+
+    for (int i = 0; i < 100; i++) {
+      bus.Publish("probe.test_unique_" + std::to_string(i));
+      bus.PublishAsync(Event("probe.test_async_" + std::to_string(i)));
+    }
+    bus.FlushAsync();
+
+    ASSERT_EQUAL(200, calls.load());
+    ASSERT_EQUAL(max_id, TopicRegistry::Instance().MaxId());
+    ASSERT_EQUAL(kInvalidTopic, TopicRegistry::Instance().Find("probe.test_unique_0"));
+    bus.Clear();
+  }
+
+  TEST_CASE(exact_and_pattern_subscribers_merge_by_priority) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    std::vector<std::string> order;
+    bus.Subscribe("webview.error", [&](const Event&) { order.push_back("exact"); }, 0);
+    bus.Subscribe("*.error", [&](const Event&) { order.push_back("pattern-high"); }, 10);
+    bus.Subscribe("webview.**", [&](const Event&) { order.push_back("pattern-low"); }, 0);
+
+    bus.Publish("webview.error");
+
+    ASSERT_EQUAL((std::vector<std::string>{"pattern-high", "exact", "pattern-low"}), order);
+    bus.Clear();
+  }
+
+  TEST_CASE(typed_publish_reaches_pattern_subscribers) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    int monitor_count = 0;
+    bus.Subscribe("monitor.*", [&](const Event& e) {
+      monitor_count = e.GetData<MonitorChanged>("payload").monitor_count;
+    });
+
+    bus.Publish(MonitorChanged{4, 0});
+
+    ASSERT_EQUAL(4, monitor_count);
+    bus.Clear();
+  }
+
+  TEST_CASE(unsubscribe_invalidates_the_cached_sets) {
+    EventBus& bus = EventBus::Instance();
+    bus.Clear();
+    int pattern_calls = 0;
+    int exact_calls = 0;
+    auto pattern = bus.Subscribe("state.*", [&](const Event&) { pattern_calls++; });
+    auto exact = bus.Subscribe("state.saved", [&](const Event&) { exact_calls++; });
+
+    bus.Publish("state.saved");
+    bus.Unsubscribe(pattern);
+    bus.Publish("state.saved");
+    bus.Unsubscribe(exact);
+    bus.Publish("state.saved");
+
+    ASSERT_EQUAL(1, pattern_calls);
+    ASSERT_EQUAL(2, exact_calls);
+    ASSERT_EQUAL(static_cast<size_t>(0), bus.GetSubscriberCount("state.*"));
+    ASSERT_TRUE(bus.GetActiveEventTypes().empty());
+    bus.Clear();
+  }
+}
+
+TEST_SUITE(EventTimer) {
+  TEST_CASE(virtual_clock_runs_due_callbacks_in_order) {
+    EventTimer timer(EventTimer::Mode::VIRTUAL);
+    auto start = timer.Now();
+    std::vector<int> order;
+    timer.Schedule(start + std::chrono::milliseconds(20), [&] { order.push_back(2); });
+    timer.Schedule(start + std::chrono::milliseconds(10), [&] { order.push_back(1); });
+    timer.Schedule(start + std::chrono::milliseconds(20), [&] { order.push_back(3); });
+    timer.Schedule(start + std::chrono::milliseconds(50), [&] { order.push_back(4); });
+
+    timer.Advance(std::chrono::milliseconds(20));
+
+    ASSERT_EQUAL((std::vector<int>{1, 2, 3}), order);
+    ASSERT_EQUAL(static_cast<size_t>(1), timer.PendingCount());
+    ASSERT_TRUE(timer.Now() == start + std::chrono::milliseconds(20));
+  }
+
+  TEST_CASE(callbacks_see_their_due_time_and_may_reschedule) {
+    EventTimer timer(EventTimer::Mode::VIRTUAL);
+    auto start = timer.Now();
+    std::vector<long long> fired_at;
+    std::function<void()> tick = [&] {
+      fired_at.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(
+          timer.Now() - start).count());
+      if (fired_at.size() < 3) {
+        timer.Schedule(timer.Now() + std::chrono::milliseconds(10), tick);
+      }
+    };
+    timer.Schedule(start + std::chrono::milliseconds(10), tick);
+
+    timer.Advance(std::chrono::seconds(1));
+
+    ASSERT_EQUAL((std::vector<long long>{10, 20, 30}), fired_at);
+  }
+
+  TEST_CASE(real_time_timer_fires) {
+    EventTimer timer;
+    std::atomic<bool> fired{false};
+    timer.Schedule(timer.Now() + std::chrono::milliseconds(5), [&] { fired = true; });
+
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!fired && std::chrono::steady_clock::now() < until) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(fired.load());
+  }
+
+  TEST_CASE(timer_released_by_its_own_callback_shuts_down) {
+    auto timer = std::make_shared<EventTimer>();
+    std::atomic<bool> released{false};
+    std::atomic<bool> stopped{false};
+    timer->Schedule(timer->Now(), [self = timer, &released, &stopped] {
+      while (!released) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      self->Stop();
+      stopped = true;
+    });  // Destroying the callback then destroys the timer on its own worker
+    timer.reset();
+    released = true;
+
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!stopped && std::chrono::steady_clock::now() < until) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_TRUE(stopped.load());
+  }
+}
+
+namespace {
+
+// Routes EventBus coalescing to a virtual clock for one test
+class VirtualBusClock {
+public:
+  VirtualBusClock() : timer_(std::make_shared<EventTimer>(EventTimer::Mode::VIRTUAL)) {
+    EventBus::Instance().Clear();
+    EventBus::Instance().SetTimer(timer_);
+  }
+  ~VirtualBusClock() {
+    EventBus::Instance().SetCoalescing("monitor.changed", EventBus::Coalesce::NONE,
+                                       std::chrono::milliseconds(0));
+    EventBus::Instance().FlushAsync();
+    EventBus::Instance().SetTimer(nullptr);
+    EventBus::Instance().Clear();
+  }
+
+  // Advance the clock and wait for the deliveries it triggered
+  void Advance(std::chrono::milliseconds duration) {
+    timer_->Advance(duration);
+    EventBus::Instance().FlushAsync();
+  }
+
+private:
+  std::shared_ptr<EventTimer> timer_;
+};
+
+Event MonitorEvent(int count) {
+  Event event("monitor.changed", "DisplayManager");
+  event.SetData("count", count);
+  return event;
+}
+
+}  // namespace
+
+TEST_SUITE(EventBusCoalescing) {
+  TEST_CASE(latest_wins_turns_a_storm_into_one_call) {
+    VirtualBusClock clock;
+    EventBus& bus = EventBus::Instance();
+    std::vector<int> received;
+    bus.Subscribe("monitor.changed", [&](const Event& e) { received.push_back(e.GetData<int>("count")); });
+    bus.SetCoalescing("monitor.changed", EventBus::Coalesce::LATEST, std::chrono::milliseconds(100));
+
+    for (int i = 1; i <= 30; i++) {
+      bus.Publish(MonitorEvent(i));
+      clock.Advance(std::chrono::milliseconds(2));
+    }
+    ASSERT_TRUE(received.empty());
+
+    clock.Advance(std::chrono::milliseconds(100));
+    ASSERT_EQUAL(std::vector<int>{30}, received);
+  }
+
+  TEST_CASE(count_aggregate_reports_the_burst_size) {
+    VirtualBusClock clock;
+    EventBus& bus = EventBus::Instance();
+    size_t coalesced = 0;
+    int last = 0;
+    bus.Subscribe("monitor.changed", [&](const Event& e) {
+      coalesced = e.GetData<size_t>("coalesced_count");
+      last = e.GetData<int>("count");
+    });
+    bus.SetCoalescing("monitor.changed", EventBus::Coalesce::COUNT, std::chrono::milliseconds(50));
+
+    for (int i = 1; i <= 30; i++) {
+      bus.PublishAsync(MonitorEvent(i));
+    }
+    clock.Advance(std::chrono::milliseconds(50));
+
+    ASSERT_EQUAL(static_cast<size_t>(30), coalesced);
+    ASSERT_EQUAL(30, last);
+  }
+
+  TEST_CASE(leading_debounce_delivers_the_first_event_once_per_burst) {
+    VirtualBusClock clock;
+    EventBus& bus = EventBus::Instance();
+    std::vector<int> received;
+    bus.Subscribe("monitor.changed", [&](const Event& e) { received.push_back(e.GetData<int>("count")); });
+    bus.SetCoalescing("monitor.changed", EventBus::Coalesce::DEBOUNCE_LEADING,
+                      std::chrono::milliseconds(100));
+
+    for (int i = 1; i <= 30; i++) {
+      bus.Publish(MonitorEvent(i));
+      clock.Advance(std::chrono::milliseconds(10));  // Never quiet for 100 ms
+    }
+    clock.Advance(std::chrono::milliseconds(100));
+    bus.Publish(MonitorEvent(31));
+
+    ASSERT_EQUAL((std::vector<int>{1, 31}), received);
+  }
+
+  TEST_CASE(trailing_debounce_waits_for_a_quiet_window) {
+    VirtualBusClock clock;
+    EventBus& bus = EventBus::Instance();
+    std::vector<int> received;
+    bus.Subscribe("monitor.changed", [&](const Event& e) { received.push_back(e.GetData<int>("count")); });
+    bus.SetCoalescing("monitor.changed", EventBus::Coalesce::DEBOUNCE_TRAILING,
+                      std::chrono::milliseconds(100));
+
+    for (int i = 1; i <= 30; i++) {
+      bus.Publish(MonitorEvent(i));
+      clock.Advance(std::chrono::milliseconds(50));  // Each event restarts the window
+    }
+    ASSERT_TRUE(received.empty());
+
+    clock.Advance(std::chrono::milliseconds(50));
+    ASSERT_EQUAL(std::vector<int>{30}, received);
+  }
+
+  TEST_CASE(typed_payloads_are_coalesced_too) {
+    VirtualBusClock clock;
+    EventBus& bus = EventBus::Instance();
+    std::vector<int> received;
+    bus.Subscribe<MonitorChanged>([&](const MonitorChanged& m) { received.push_back(m.monitor_count); });
+    bus.SetCoalescing("monitor.changed", EventBus::Coalesce::LATEST, std::chrono::milliseconds(20));
+
+    for (int i = 1; i <= 30; i++) {
+      bus.Publish(MonitorChanged{i, 0});
+    }
+    clock.Advance(std::chrono::milliseconds(20));
+
+    ASSERT_EQUAL(std::vector<int>{30}, received);
+  }
+
+  TEST_CASE(removing_the_policy_flushes_the_held_event) {
+    VirtualBusClock clock;
+    EventBus& bus = EventBus::Instance();
+    std::vector<int> received;
+    bus.Subscribe("monitor.changed", [&](const Event& e) { received.push_back(e.GetData<int>("count")); });
+    bus.SetCoalescing("monitor.changed", EventBus::Coalesce::LATEST, std::chrono::seconds(10));
+
+    bus.Publish(MonitorEvent(1));
+    bus.Publish(MonitorEvent(2));
+    bus.SetCoalescing("monitor.changed", EventBus::Coalesce::NONE, std::chrono::milliseconds(0));
+    bus.FlushAsync();
+    bus.Publish(MonitorEvent(3));
+    clock.Advance(std::chrono::seconds(10));
+
+    ASSERT_EQUAL((std::vector<int>{2, 3}), received);
+  }
+}
+
+TEST_SUITE(ConfigJson) {
+  TEST_CASE(nested_objects_flatten_to_dotted_keys) {
+    std::istringstream input(R"({
+      "log": { "level": "DEBUG", "max_file_size_mb": 20 },
+      "webview.cache_enabled": false,
+      "ratio": 1.5,
+      "big": 10000000000,
+      "security": { "url_whitelist": ["https://a.example", "https://b.example"] },
+      "unset": null
+    })");
+    ConfigJson::Values values;
+    ASSERT_TRUE(ConfigJson::Parse(input, values));
+
+    ASSERT_EQUAL(std::string("DEBUG"), values["log.level"].Get<std::string>());
+    ASSERT_EQUAL(20, values["log.max_file_size_mb"].Get<int>());
+    ASSERT_FALSE(values["webview.cache_enabled"].Get<bool>(true));
+    ASSERT_EQUAL(1.5, values["ratio"].Get<double>());
+    ASSERT_EQUAL(1e10, values["big"].Get<double>());
+    ASSERT_EQUAL(static_cast<size_t>(2),
+                 values["security.url_whitelist"].Get<std::vector<std::string>>().size());
+    ASSERT_TRUE(values.find("unset") == values.end());
+  }
+
+  TEST_CASE(strings_decode_every_escape) {
+    std::istringstream input(R"({"s": "q\" b\\ s\/ \n\t \u00e9 \ud83d\ude00"})");
+    ConfigJson::Values values;
+    ASSERT_TRUE(ConfigJson::Parse(input, values));
+    ASSERT_EQUAL(std::string("q\" b\\ s/ \n\t \xC3\xA9 \xF0\x9F\x98\x80"),
+                 values["s"].Get<std::string>());
+  }
+
+  TEST_CASE(errors_report_line_and_column) {
+    std::istringstream input("{\n  \"a\": 1,\n  \"b\": tru\n}");
+    ConfigJson::Values values;
+    std::string error;
+    ASSERT_FALSE(ConfigJson::Parse(input, values, &error));
+    ASSERT_TRUE(error.find("3:") == 0);
+
+    std::istringstream trailing("{\"a\": 1} x");
+    ASSERT_FALSE(ConfigJson::Parse(trailing, values));
+    std::istringstream unterminated("{\"a\": \"open");
+    ASSERT_FALSE(ConfigJson::Parse(unterminated, values));
+  }
+
+  TEST_CASE(write_then_parse_round_trips) {
+    ConfigJson::Values values;
+    values["path"] = ConfigValue(std::string("C:\\logs\\\"quoted\"\n\x01.log"));
+    values["flag"] = ConfigValue(true);
+    values["count"] = ConfigValue(-42);
+    values["ratio"] = ConfigValue(2.0);
+    values["list"] = ConfigValue(std::vector<std::string>{"a,b", "c\"d"});
+
+    std::ostringstream output;
+    ConfigJson::Write(output, values);
+    std::istringstream input(output.str());
+    ConfigJson::Values parsed;
+    ASSERT_TRUE(ConfigJson::Parse(input, parsed));
+
+    ASSERT_EQUAL(values.size(), parsed.size());
+    for (const auto& pair : values) {
+      ASSERT_TRUE(parsed[pair.first] == pair.second);
+    }
+  }
+}
+
+namespace {
+
+void SetEnvironment(const char* name, const char* value) {
+#ifdef _WIN32
+  _putenv_s(name, value ? value : "");
+#else
+  if (value) {
+    setenv(name, value, 1);
+  } else {
+    unsetenv(name);
+  }
+#endif
+}
+
+void WriteFile(const std::string& path, const std::string& text) {
+  // Replace atomically, as editors do
+  std::string temp = path + ".tmp";
+  {
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    file << text;
+  }
+  std::filesystem::rename(temp, path);
+}
+
+}  // namespace
+
+TEST_SUITE(ConfigManagerLoading) {
+  TEST_CASE(reload_notifies_only_changed_keys) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    std::string path = TempPath("anywp_test_config.json");
+    WriteFile(path, R"({"log": {"level": "DEBUG", "max_file_size_mb": 20}})");
+    ASSERT_TRUE(config.LoadFromFile(path));
+    ASSERT_EQUAL(std::string("DEBUG"), config.Get<std::string>("log.level"));
+
+    std::vector<std::string> changed;
+    config.Subscribe("log.level", [&](const ConfigValue&) { changed.push_back("log.level"); });
+    config.Subscribe("log.max_file_size_mb", [&](const ConfigValue& v) {
+      changed.push_back("log.max_file_size_mb=" + std::to_string(v.Get<int>()));
+    });
+
+    WriteFile(path, R"({"log": {"level": "DEBUG"}})");
+    ASSERT_TRUE(config.LoadFromFile(path));
+
+    // Dropped from the file: back to the default, and only that key notified
+    ASSERT_EQUAL(std::vector<std::string>{"log.max_file_size_mb=10"}, changed);
+    std::filesystem::remove(path);
+    config.Clear();
+  }
+
+  TEST_CASE(invalid_file_changes_nothing) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    config.RegisterValidator("webview.max_cache_size_mb",
+                             [](const ConfigValue& v) { return v.Get<int>() > 0; });
+    std::string path = TempPath("anywp_test_config_invalid.json");
+
+    WriteFile(path, R"({"log.level": "ERROR", )");
+    ASSERT_FALSE(config.LoadFromFile(path));
+    WriteFile(path, R"({"log.level": "ERROR", "webview.max_cache_size_mb": -5})");
+    ASSERT_FALSE(config.LoadFromFile(path));
+
+    ASSERT_EQUAL(std::string("INFO"), config.Get<std::string>("log.level"));
+    ASSERT_EQUAL(100, config.Get<int>("webview.max_cache_size_mb"));
+    std::filesystem::remove(path);
+    config.Clear();
+  }
+
+  TEST_CASE(save_escapes_and_round_trips) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    std::string path = TempPath("anywp_test_config_save.json");
+    std::string tricky = "C:\\Users\\\"me\"\\anywp.log";
+    config.Set("log.file_path", tricky);
+    ASSERT_TRUE(config.SaveToFile(path));
+
+    config.Clear();
+    ASSERT_TRUE(config.LoadFromFile(path));
+    ASSERT_EQUAL(tricky, config.Get<std::string>("log.file_path"));
+    std::filesystem::remove(path);
+    config.Clear();
+  }
+
+  TEST_CASE(environment_overrides_are_typed_and_win_over_files) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    SetEnvironment("ANYWP_LOG_LEVEL", "DEBUG");
+    SetEnvironment("ANYWP_WEBVIEW_MAX_CACHE_SIZE_MB", "250");
+    SetEnvironment("ANYWP_SECURITY_HTTPS_ONLY", "yes");
+    SetEnvironment("ANYWP_TEST__NESTED_KEY", "value");
+
+    config.LoadFromEnvironment();
+
+    ASSERT_EQUAL(std::string("DEBUG"), config.Get<std::string>("log.level"));
+    ASSERT_EQUAL(250, config.Get<int>("webview.max_cache_size_mb"));
+    ASSERT_TRUE(config.Get<bool>("security.https_only"));
+    ASSERT_EQUAL(std::string("value"), config.Get<std::string>("test.nested_key"));
+
+    std::string path = TempPath("anywp_test_config_env.json");
+    WriteFile(path, R"({"log.level": "ERROR", "log.max_file_size_mb": 30})");
+    ASSERT_TRUE(config.LoadFromFile(path));
+    ASSERT_EQUAL(std::string("DEBUG"), config.Get<std::string>("log.level"));
+    ASSERT_EQUAL(30, config.Get<int>("log.max_file_size_mb"));
+
+    config.Set("log.level", std::string("WARNING"));
+    config.Remove("webview.max_cache_size_mb");
+    ConfigTransaction transaction = config.BeginTransaction();
+    transaction.Set("security.https_only", false);
+    transaction.Set("log.max_file_size_mb", 40);
+    ASSERT_TRUE(transaction.Commit());
+    ASSERT_EQUAL(std::string("DEBUG"), config.Get<std::string>("log.level"));
+    ASSERT_EQUAL(250, config.Get<int>("webview.max_cache_size_mb"));
+    ASSERT_TRUE(config.Get<bool>("security.https_only"));
+    ASSERT_EQUAL(40, config.Get<int>("log.max_file_size_mb"));
+
+    for (const char* name : {"ANYWP_LOG_LEVEL", "ANYWP_WEBVIEW_MAX_CACHE_SIZE_MB",
+                             "ANYWP_SECURITY_HTTPS_ONLY", "ANYWP_TEST__NESTED_KEY"}) {
+      SetEnvironment(name, nullptr);
+    }
+    std::filesystem::remove(path);
+    config.Clear();
+  }
+
+  TEST_CASE(hot_reload_applies_saved_changes) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    std::string path = TempPath("anywp_test_config_hot.json");
+    WriteFile(path, R"({"log.level": "DEBUG", "power.optimization_enabled": true})");
+    ASSERT_TRUE(config.LoadFromFile(path));
+
+    std::atomic<int> level_calls{0};
+    std::atomic<int> power_calls{0};
+    config.Subscribe("log.level", [&](const ConfigValue&) { level_calls++; });
+    config.Subscribe("power.optimization_enabled", [&](const ConfigValue&) { power_calls++; });
+    ASSERT_TRUE(config.EnableHotReload(path));
+    ASSERT_TRUE(config.IsHotReloadEnabled());
+
+    WriteFile(path, R"({"log.level": "WARNING", "power.optimization_enabled": true})");
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (level_calls == 0 && std::chrono::steady_clock::now() < until) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    ASSERT_EQUAL(1, level_calls.load());
+    ASSERT_EQUAL(0, power_calls.load());
+    ASSERT_EQUAL(std::string("WARNING"), config.Get<std::string>("log.level"));
+    config.DisableHotReload();
+    ASSERT_FALSE(config.IsHotReloadEnabled());
+    std::filesystem::remove(path);
+    config.Clear();
+  }
+}
+
+TEST_SUITE(ConfigKeys) {
+  TEST_CASE(typed_key_reads_current_value_or_default) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    static const ConfigKey<int> kMaxCache("webview.max_cache_size_mb", 50);
+    static const ConfigKey<std::string> kMissing("test.config_key.missing", "fallback");
+    static const ConfigKey<bool> kWrongType("log.level", true);
+
+    ASSERT_EQUAL(100, kMaxCache.Get());
+    ASSERT_EQUAL(std::string("fallback"), kMissing.Get());
+    ASSERT_TRUE(kWrongType.Get());
+
+    kMaxCache.Set(250);
+    ASSERT_EQUAL(250, kMaxCache.Get());
+    config.Set("test.config_key.missing", std::string("set"));
+    ASSERT_EQUAL(std::string("set"), kMissing.Get());
+    config.Remove("test.config_key.missing");
+    ASSERT_EQUAL(std::string("fallback"), kMissing.Get());
+
+    // Slots survive Clear(); the value goes back to the built-in default
+    config.Clear();
+    ASSERT_EQUAL(100, kMaxCache.Get());
+  }
+
+  TEST_CASE(typed_key_sees_file_and_environment_changes) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    static const ConfigKey<std::string> kLevel("log.level", "INFO");
+    ASSERT_EQUAL(std::string("INFO"), kLevel.Get());
+
+    std::string path = TempPath("anywp_test_config_key.json");
+    WriteFile(path, R"({"log": {"level": "ERROR"}})");
+    ASSERT_TRUE(config.LoadFromFile(path));
+    ASSERT_EQUAL(std::string("ERROR"), kLevel.Get());
+
+    SetEnvironment("ANYWP_LOG_LEVEL", "DEBUG");
+    config.LoadFromEnvironment();
+    SetEnvironment("ANYWP_LOG_LEVEL", nullptr);
+    ASSERT_EQUAL(std::string("DEBUG"), kLevel.Get());
+
+    std::filesystem::remove(path);
+    config.Clear();
+  }
+
+  TEST_CASE(concurrent_reads_see_only_written_values) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    static const ConfigKey<int> kCounter("test.config_key.counter", -1);
+    config.Set("test.config_key.counter", 0);
+
+    std::atomic<bool> done{false};
+    std::atomic<int> bad_reads{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+      readers.emplace_back([&] {
+        int last = 0;
+        while (!done) {
+          int value = kCounter.Get();
+          if (value < last) {
+            bad_reads++;  // Values only grow; never the default either
+          }
+          last = value;
+        }
+      });
+    }
+    for (int i = 1; i <= 2000; i++) {
+      config.Set("test.config_key.counter", i);
+    }
+    done = true;
+    for (auto& reader : readers) {
+      reader.join();
+    }
+
+    ASSERT_EQUAL(0, bad_reads.load());
+    ASSERT_EQUAL(2000, kCounter.Get());
+    config.Clear();
+  }
+}
+
+TEST_SUITE(ConfigTransactions) {
+  TEST_CASE(commit_notifies_each_subscriber_once) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    int level_calls = 0;
+    std::string level_seen;
+    std::vector<ConfigManager::ChangeSet> change_sets;
+    config.Subscribe("log.level", [&](const ConfigValue& v) {
+      level_calls++;
+      level_seen = v.Get<std::string>();
+    });
+    config.SubscribeChanges([&](const ConfigManager::ChangeSet& changes) {
+      change_sets.push_back(changes);
+    });
+
+    ConfigTransaction transaction = config.BeginTransaction();
+    transaction.Set("log.level", std::string("WARNING"))
+               .Set("log.file_enabled", true)
+               .Set("log.level", std::string("DEBUG"))
+               .Set("power.optimization_enabled", true)  // Unchanged
+               .Remove("security.permission_policy");
+    ASSERT_EQUAL(static_cast<size_t>(4), transaction.Size());
+
+    // Staged only
+    ASSERT_EQUAL(std::string("INFO"), config.Get<std::string>("log.level"));
+    ASSERT_EQUAL(0, level_calls);
+
+    ASSERT_TRUE(transaction.Commit());
+    ASSERT_TRUE(transaction.Empty());
+    ASSERT_EQUAL(1, level_calls);
+    ASSERT_EQUAL(std::string("DEBUG"), level_seen);
+    ASSERT_TRUE(config.Get<bool>("log.file_enabled"));
+    ASSERT_FALSE(config.Has("security.permission_policy"));
+
+    ASSERT_EQUAL(static_cast<size_t>(1), change_sets.size());
+    ASSERT_EQUAL(static_cast<size_t>(3), change_sets[0].size());
+    ASSERT_TRUE(change_sets[0]["security.permission_policy"].IsEmpty());
+    ASSERT_TRUE(change_sets[0].find("power.optimization_enabled") == change_sets[0].end());
+    config.Clear();
+  }
+
+  TEST_CASE(failed_validation_applies_nothing) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    config.RegisterValidator("webview.max_cache_size_mb",
+                             [](const ConfigValue& v) { return v.Get<int>() > 0; });
+    int calls = 0;
+    config.SubscribeChanges([&](const ConfigManager::ChangeSet&) { calls++; });
+
+    ConfigTransaction transaction = config.BeginTransaction();
+    transaction.Set("log.level", std::string("ERROR")).Set("webview.max_cache_size_mb", -1);
+    ASSERT_FALSE(transaction.Commit());
+    ASSERT_EQUAL(std::string("INFO"), config.Get<std::string>("log.level"));
+    ASSERT_EQUAL(100, config.Get<int>("webview.max_cache_size_mb"));
+    ASSERT_EQUAL(0, calls);
+
+    // Still staged: fix the bad value and try again
+    transaction.Set("webview.max_cache_size_mb", 200);
+    ASSERT_TRUE(transaction.Commit());
+    ASSERT_EQUAL(std::string("ERROR"), config.Get<std::string>("log.level"));
+    ASSERT_EQUAL(1, calls);
+    config.Clear();
+  }
+
+  TEST_CASE(callbacks_run_outside_the_lock) {
+    ConfigManager& config = ConfigManager::Instance();
+    config.Clear();
+    // Would deadlock if callbacks ran under the manager's mutex
+    config.Subscribe("log.level", [&](const ConfigValue&) {
+      config.Set("log.file_enabled", config.Get<std::string>("log.level") == "DEBUG");
+    });
+    ASSERT_TRUE(config.BeginTransaction().Set("log.level", std::string("DEBUG")).Commit());
+    ASSERT_TRUE(config.Get<bool>("log.file_enabled"));
+    config.Clear();
+  }
+}
+
+namespace {
+
+std::string FreshDirectory(const std::string& name) {
+  std::string directory = TempPath(name);
+  std::filesystem::remove_all(directory);
+  return directory;
+}
+
+}  // namespace
+
+TEST_SUITE(StateJournal) {
+  TEST_CASE(writes_survive_reopen) {
+    std::string directory = FreshDirectory("anywp_test_state_reopen");
+    {
+      StateJournal journal(directory);
+      ASSERT_TRUE(journal.Open());
+      ASSERT_TRUE(journal.Put("volume", "0.5"));
+      ASSERT_TRUE(journal.Put("theme", "dark"));
+      ASSERT_TRUE(journal.Put("volume", "0.8"));
+      ASSERT_TRUE(journal.Put("quote", "a \"b\"\n\\c"));
+      ASSERT_TRUE(journal.Erase("theme"));
+    }
+
+    StateJournal journal(directory);
+    ASSERT_TRUE(journal.Open());
+    std::string value;
+    ASSERT_TRUE(journal.Get("volume", value));
+    ASSERT_EQUAL(std::string("0.8"), value);
+    ASSERT_FALSE(journal.Get("theme", value));
+    ASSERT_TRUE(journal.Get("quote", value));
+    ASSERT_EQUAL(std::string("a \"b\"\n\\c"), value);
+    ASSERT_EQUAL(static_cast<size_t>(5), journal.GetStats().replayed_records);
+
+    // Compacting writes the same state as a JSON snapshot
+    ASSERT_TRUE(journal.Compact());
+    ASSERT_EQUAL(static_cast<uint64_t>(0), journal.GetStats().journal_bytes);
+    std::map<std::string, std::string> read;
+    ASSERT_TRUE(StateJournal::Read(directory, read));
+    ASSERT_EQUAL(journal.GetAll(), read);
+    journal.Close();
+    std::filesystem::remove_all(directory);
+  }
+
+  TEST_CASE(torn_tail_is_discarded) {
+    std::string directory = FreshDirectory("anywp_test_state_torn");
+    {
+      StateJournal journal(directory);
+      ASSERT_TRUE(journal.Open());
+      ASSERT_TRUE(journal.Put("a", "1"));
+      ASSERT_TRUE(journal.Put("b", "2"));
+    }
+    std::string path = (std::filesystem::path(directory) / StateJournal::kJournalName).string();
+    auto intact = std::filesystem::file_size(path);
+    {
+      // Half a record, as a crash mid-append would leave it
+      std::ofstream file(path, std::ios::binary | std::ios::app);
+      file.write("\x12\x34\x56\x78\x01\x05\x00\x00\x00", 9);
+    }
+
+    StateJournal journal(directory);
+    ASSERT_TRUE(journal.Open());
+    ASSERT_EQUAL(static_cast<uint64_t>(9), journal.GetStats().discarded_bytes);
+    ASSERT_EQUAL(static_cast<uintmax_t>(intact), std::filesystem::file_size(path));
+    ASSERT_TRUE(journal.Put("c", "3"));
+    journal.Close();
+
+    ASSERT_TRUE(journal.Open());
+    ASSERT_EQUAL(static_cast<size_t>(3), journal.GetAll().size());
+    journal.Close();
+    std::filesystem::remove_all(directory);
+  }
+
+  TEST_CASE(background_compaction_keeps_every_write) {
+    std::string directory = FreshDirectory("anywp_test_state_compact");
+    StateJournal::Options options;
+    options.compact_min_bytes = 4096;
+    std::map<std::string, std::string> expected;
+    {
+      StateJournal journal(directory, options);
+      ASSERT_TRUE(journal.Open());
+      for (int i = 0; i < 5000; i++) {
+        std::string key = "key" + std::to_string(i % 50);
+        std::string value = std::to_string(i);
+        ASSERT_TRUE(journal.Put(key, value));
+        expected[key] = value;
+      }
+      journal.WaitForCompaction();
+      ASSERT_TRUE(journal.GetStats().compactions > 0);
+    }
+
+    StateJournal journal(directory, options);
+    ASSERT_TRUE(journal.Open());
+    ASSERT_EQUAL(expected, journal.GetAll());
+    journal.Close();
+    std::filesystem::remove_all(directory);
+  }
+
+  TEST_CASE(interrupted_compaction_is_recovered) {
+    std::string directory = FreshDirectory("anywp_test_state_interrupted");
+    std::filesystem::path root(directory);
+    {
+      StateJournal journal(directory);
+      ASSERT_TRUE(journal.Open());
+      ASSERT_TRUE(journal.Put("a", "1"));
+      ASSERT_TRUE(journal.Compact());
+      ASSERT_TRUE(journal.Put("b", "2"));
+      ASSERT_TRUE(journal.Put("a", "3"));
+    }
+    // Crash after the rotation, before the new snapshot: journal moved aside
+    std::filesystem::rename(root / StateJournal::kJournalName, root / "state.journal.1");
+    {
+      StateJournal journal(directory);
+      ASSERT_TRUE(journal.Open());
+      ASSERT_TRUE(journal.Put("c", "4"));
+    }
+    ASSERT_FALSE(std::filesystem::exists(root / "state.journal.1"));
+
+    StateJournal journal(directory);
+    ASSERT_TRUE(journal.Open());
+    std::map<std::string, std::string> expected = {{"a", "3"}, {"b", "2"}, {"c", "4"}};
+    ASSERT_EQUAL(expected, journal.GetAll());
+
+    ASSERT_TRUE(journal.Clear());
+    ASSERT_TRUE(journal.GetAll().empty());
+    ASSERT_FALSE(std::filesystem::exists(root / StateJournal::kSnapshotName));
+    journal.Close();
+    std::filesystem::remove_all(directory);
+  }
+
+  TEST_CASE(async_writes_coalesce_and_flush_in_background) {
+    std::string directory = FreshDirectory("anywp_test_state_async");
+    StateJournal::Options options;
+    options.flush_window = std::chrono::milliseconds(20);
+    StateJournal journal(directory, options);
+    ASSERT_TRUE(journal.Open());
+    for (int i = 0; i < 100; i++) {
+      ASSERT_TRUE(journal.Put("drag", std::to_string(i), StateJournal::Durability::ASYNC));
+    }
+    std::string value;
+    ASSERT_TRUE(journal.Get("drag", value));
+    ASSERT_EQUAL(std::string("99"), value);
+
+    // Polled rather than slept so a slow machine only waits longer
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (journal.GetStats().pending_keys > 0 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    StateJournal::Stats stats = journal.GetStats();
+    ASSERT_EQUAL(static_cast<size_t>(0), stats.pending_keys);
+    ASSERT_TRUE(stats.written_bytes < 100 * 15);  // Far fewer than one record per Put
+
+    std::map<std::string, std::string> read;
+    ASSERT_TRUE(StateJournal::Read(directory, read));
+    ASSERT_EQUAL(std::string("99"), read["drag"]);
+    journal.Close();
+    std::filesystem::remove_all(directory);
+  }
+
+  TEST_CASE(memory_writes_wait_for_flush) {
+    std::string directory = FreshDirectory("anywp_test_state_memory");
+    StateJournal journal(directory);
+    ASSERT_TRUE(journal.Open());
+    ASSERT_TRUE(journal.Put("a", "1", StateJournal::Durability::MEMORY));
+    ASSERT_TRUE(journal.Put("b", "2"));
+    ASSERT_TRUE(journal.Erase("b", StateJournal::Durability::MEMORY));
+    ASSERT_EQUAL(static_cast<size_t>(2), journal.GetStats().pending_keys);
+
+    // Only the SYNC write is on disk until the flush
+    std::map<std::string, std::string> read;
+    ASSERT_TRUE(StateJournal::Read(directory, read));
+    std::map<std::string, std::string> expected = {{"b", "2"}};
+    ASSERT_EQUAL(expected, read);
+
+    ASSERT_TRUE(journal.Flush());
+    read.clear();
+    ASSERT_TRUE(StateJournal::Read(directory, read));
+    expected = {{"a", "1"}};
+    ASSERT_EQUAL(expected, read);
+    ASSERT_EQUAL(static_cast<size_t>(1), journal.GetStats().flushes);
+
+    // Close() flushes whatever is still pending
+    ASSERT_TRUE(journal.Put("c", "3", StateJournal::Durability::MEMORY));
+    journal.Close();
+    read.clear();
+    ASSERT_TRUE(StateJournal::Read(directory, read));
+    ASSERT_EQUAL(std::string("3"), read["c"]);
+    std::filesystem::remove_all(directory);
+  }
+
+  TEST_CASE(values_are_read_from_disk_on_demand) {
+    std::string directory = FreshDirectory("anywp_test_state_lazy");
+    std::filesystem::path root(directory);
+    std::filesystem::create_directories(root);
+    {
+      // Layout of the pre-journal StatePersistence, escapes included
+      std::ofstream file(root / StateJournal::kSnapshotName, std::ios::binary);
+      file << "{\n  \"plain\": \"value\",\n  \"esc\\\"aped\": \"a\\\"b\\\\c\\n\\u00e9\"\n}\n";
+    }
+    StateJournal journal(directory);
+    ASSERT_TRUE(journal.Open());
+    ASSERT_EQUAL(static_cast<uint64_t>(0), journal.GetStats().pending_bytes);
+    std::string value;
+    ASSERT_TRUE(journal.Get("plain", value));
+    ASSERT_EQUAL(std::string("value"), value);
+    ASSERT_TRUE(journal.Get("esc\"aped", value));
+    ASSERT_EQUAL(std::string("a\"b\\c\n\xC3\xA9"), value);
+
+    // Locations move into the new snapshot when it is compacted
+    ASSERT_TRUE(journal.Put("plain", "changed"));
+    ASSERT_TRUE(journal.Compact());
+    ASSERT_TRUE(journal.Get("plain", value));
+    ASSERT_EQUAL(std::string("changed"), value);
+    ASSERT_TRUE(journal.Get("esc\"aped", value));
+    ASSERT_EQUAL(std::string("a\"b\\c\n\xC3\xA9"), value);
+    journal.Close();
+
+    {
+      // Not a flat object of strings: parsed in full and rewritten
+      std::ofstream file(root / StateJournal::kSnapshotName, std::ios::binary);
+      file << R"({"volume": "0.5", "count": 3})";
+    }
+    ASSERT_TRUE(journal.Open());
+    std::map<std::string, std::string> expected = {{"volume", "0.5"}};
+    ASSERT_EQUAL(expected, journal.GetAll());
+    journal.Close();
+    std::filesystem::remove_all(directory);
+  }
+
+  TEST_CASE(unreadable_snapshot_is_set_aside_not_compacted_over) {
+    std::string directory = FreshDirectory("anywp_test_state_corrupt");
+    std::filesystem::path root(directory);
+    std::filesystem::create_directories(root);
+    const std::string garbage = "{\"cut\": \"off mid-wr";
+    {
+      std::ofstream file(root / StateJournal::kSnapshotName, std::ios::binary);
+      file << garbage;
+    }
+
+    StateJournal journal(directory);
+    ASSERT_TRUE(journal.Open());
+    ASSERT_TRUE(journal.GetAll().empty());
+    ASSERT_TRUE(journal.Put("a", "1"));
+    ASSERT_TRUE(journal.Compact());
+    journal.Close();
+
+    std::ifstream moved(root / "state.json.corrupt", std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(moved)), std::istreambuf_iterator<char>());
+    ASSERT_EQUAL(garbage, content);
+    moved.close();
+    std::filesystem::remove_all(directory);
+  }
+}
+
+TEST_SUITE(StateCache) {
+  TEST_CASE(least_recently_used_are_evicted_by_bytes) {
+    StateCache::Options options;
+    options.max_bytes = 3 * (StateCache::kEntryOverhead + 2 + 100);
+    StateCache cache(options);
+    std::string blob(100, 'x');
+    cache.Put("k1", blob);
+    cache.Put("k2", blob);
+    cache.Put("k3", blob);
+    std::string value;
+    ASSERT_TRUE(cache.Get("k1", value));  // k2 is now the coldest
+    cache.Put("k4", blob);
+
+    ASSERT_FALSE(cache.Get("k2", value));
+    ASSERT_TRUE(cache.Get("k1", value));
+    ASSERT_TRUE(cache.Get("k4", value));
+    StateCache::Stats stats = cache.GetStats();
+    ASSERT_EQUAL(static_cast<uint64_t>(1), stats.evictions);
+    ASSERT_EQUAL(static_cast<uint64_t>(3), stats.hits);
+    ASSERT_EQUAL(static_cast<uint64_t>(1), stats.misses);
+    ASSERT_EQUAL(static_cast<size_t>(3), stats.entries);
+    ASSERT_TRUE(stats.bytes <= options.max_bytes);
+
+    // Larger than the whole budget: not cached, nothing evicted for it
+    cache.Put("huge", std::string(options.max_bytes, 'y'));
+    ASSERT_FALSE(cache.Get("huge", value));
+    ASSERT_EQUAL(static_cast<size_t>(3), cache.GetStats().entries);
+
+    // Shrinking the budget evicts right away
+    options.max_bytes = StateCache::kEntryOverhead + 2 + 100;
+    cache.SetOptions(options);
+    ASSERT_EQUAL(static_cast<size_t>(1), cache.GetStats().entries);
+  }
+
+  TEST_CASE(entries_expire_lazily_after_ttl) {
+    StateCache::Options options;
+    options.ttl = std::chrono::milliseconds(1000);
+    StateCache cache(options);
+    auto start = StateCache::Clock::now();
+    cache.Put("old", "1", start);
+    cache.Put("fresh", "2", start + std::chrono::milliseconds(900));
+
+    std::string value;
+    ASSERT_TRUE(cache.Get("old", value, start + std::chrono::milliseconds(999)));
+    ASSERT_FALSE(cache.Get("old", value, start + std::chrono::milliseconds(1000)));
+    ASSERT_EQUAL(static_cast<uint64_t>(1), cache.GetStats().expirations);
+
+    // Put() reclaims expired entries at the cold end
+    cache.Put("new", "3", start + std::chrono::milliseconds(1850));
+    ASSERT_EQUAL(static_cast<size_t>(2), cache.GetStats().entries);
+    cache.Put("newer", "4", start + std::chrono::milliseconds(2000));
+    ASSERT_EQUAL(static_cast<size_t>(2), cache.GetStats().entries);
+    ASSERT_EQUAL(static_cast<uint64_t>(2), cache.GetStats().expirations);
+  }
+}
+
+TEST_SUITE(StateHashFile) {
+  TEST_CASE(writes_survive_reopen_and_table_growth) {
+    std::string directory = FreshDirectory("anywp_test_hash_reopen");
+    StateHashFile::Options options;
+    options.initial_buckets = 8;
+    options.compact_min_bytes = 1024;
+    std::map<std::string, std::string> expected;
+    {
+      StateHashFile file(directory, options);
+      ASSERT_TRUE(file.Open());
+      for (int i = 0; i < 3000; i++) {
+        std::string key = "key" + std::to_string(i % 500);
+        std::string value = "value" + std::to_string(i);
+        ASSERT_TRUE(file.Put(key, value));
+        expected[key] = value;
+        if (i % 7 == 0) {
+          ASSERT_TRUE(file.Erase(key));
+          expected.erase(key);
+        }
+      }
+      ASSERT_TRUE(file.Put("quote", "a \"b\"\n\\c \xC3\xA9"));
+      expected["quote"] = "a \"b\"\n\\c \xC3\xA9";
+
+      StateHashFile::Stats stats = file.GetStats();
+      ASSERT_EQUAL(expected.size(), stats.keys);
+      ASSERT_TRUE(stats.rebuilds > 0);
+      ASSERT_TRUE(stats.buckets >= 512);
+      ASSERT_TRUE(stats.garbage_bytes <= stats.heap_bytes);
+      ASSERT_EQUAL(expected, file.GetAll());
+    }
+
+    StateHashFile file(directory, options);
+    ASSERT_TRUE(file.Open());
+    ASSERT_FALSE(file.GetStats().recovered);
+    ASSERT_EQUAL(expected.size(), file.GetStats().keys);
+    ASSERT_EQUAL(expected, file.GetAll());
+    std::string value;
+    ASSERT_TRUE(file.Get("quote", value));
+    ASSERT_EQUAL(expected["quote"], value);
+    ASSERT_FALSE(file.Contains("key6"));  // Erased by its last write (i = 2506)
+
+    // Replace() swaps in a whole new file
+    ASSERT_TRUE(file.Replace({{"only", "1"}}));
+    ASSERT_EQUAL(static_cast<size_t>(1), file.GetKeys().size());
+    file.Close();
+    std::filesystem::remove_all(directory);
+  }
+
+  TEST_CASE(replace_fails_when_the_rename_fails) {
+    std::string directory = FreshDirectory("anywp_test_hash_rename");
+    std::filesystem::path path = std::filesystem::path(directory) / StateHashFile::kFileName;
+    std::filesystem::path aside = path;
+    aside += ".aside";
+    {
+      StateHashFile file(directory);
+      ASSERT_TRUE(file.Open());
+      ASSERT_TRUE(file.Put("kept", "old"));
+      ASSERT_TRUE(file.Flush());
+
+      // A directory where state.map was: the rename over it fails
+      std::filesystem::rename(path, aside);
+      std::filesystem::create_directory(path);
+      std::ofstream(path / "blocker") << "x";
+      ASSERT_FALSE(file.Replace({{"new", "1"}}));
+      ASSERT_FALSE(file.Clear());
+      ASSERT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+    }
+
+    std::filesystem::remove_all(path);
+    std::filesystem::rename(aside, path);
+    StateHashFile file(directory);
+    ASSERT_TRUE(file.Open());
+    std::string value;
+    ASSERT_TRUE(file.Get("kept", value));
+    ASSERT_EQUAL(std::string("old"), value);
+    ASSERT_FALSE(file.Contains("new"));
+    file.Close();
+    std::filesystem::remove_all(directory);
+  }
+
+  TEST_CASE(crash_keeps_intact_versions) {
+    std::string directory = FreshDirectory("anywp_test_hash_crash");
+    std::string copy = FreshDirectory("anywp_test_hash_crash_copy");
+    std::string path = (std::filesystem::path(copy) / StateHashFile::kFileName).string();
+    {
+      StateHashFile file(directory);
+      ASSERT_TRUE(file.Open());
+      ASSERT_TRUE(file.Put("a", "first"));
+      ASSERT_TRUE(file.Put("b", "kept"));
+      ASSERT_TRUE(file.Put("a", "second"));
+
+      // Copy the file while it is still open, as a crash would leave it
+      std::filesystem::create_directories(copy);
+      std::filesystem::copy_file(std::filesystem::path(directory) / StateHashFile::kFileName, path);
+    }
+
+    // The newest value's heap bytes never reached the disk
+    std::string content;
+    {
+      std::ifstream in(path, std::ios::binary);
+      content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    size_t pos = content.rfind("asecond");
+    ASSERT_TRUE(pos != std::string::npos);
+    content[pos + 1] = 'X';
+    {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+
+    StateHashFile file(copy);
+    ASSERT_TRUE(file.Open());
+    ASSERT_TRUE(file.GetStats().recovered);
+    ASSERT_EQUAL(static_cast<size_t>(2), file.GetStats().keys);
+    std::string value;
+    ASSERT_TRUE(file.Get("a", value));
+    ASSERT_EQUAL(std::string("first"), value);
+    ASSERT_TRUE(file.Get("b", value));
+    ASSERT_EQUAL(std::string("kept"), value);
+
+    // New writes go after everything the slots still point at
+    ASSERT_TRUE(file.Put("c", "new"));
+    ASSERT_TRUE(file.Get("a", value));
+    ASSERT_EQUAL(std::string("first"), value);
+    file.Close();
+    std::filesystem::remove_all(directory);
+    std::filesystem::remove_all(copy);
+  }
+
+  TEST_CASE(storage_migrates_journal_store_and_deletes_it) {
+    std::string root = FreshDirectory("anywp_test_hash_migrate");
+    std::string directory = (std::filesystem::path(root) / "App").string();
+    std::map<std::string, std::string> expected = {
+        {"theme", "dark"}, {"quote", "say \"hi\" \\ bye"}, {"unicode", "caf\xC3\xA9 \xE2\x9C\x93"}};
+    {
+      StateJournal journal(directory);
+      ASSERT_TRUE(journal.Open());
+      ASSERT_TRUE(journal.Replace({{"theme", "light"}, {"quote", expected["quote"]}}));
+      ASSERT_TRUE(journal.Put("theme", "dark"));  // In the journal, not the snapshot
+      ASSERT_TRUE(journal.Put("unicode", expected["unicode"]));
+    }
+
+    MappedStateStorage storage(root);
+    ASSERT_FALSE(storage.SaveState("k", "v"));  // No application yet
+    ASSERT_TRUE(storage.SetApplicationName("App"));
+    ASSERT_TRUE(StateHashFile::Exists(directory));
+    ASSERT_FALSE(StateJournal::Exists(directory));
+    ASSERT_EQUAL(expected, storage.LoadAllStates());
+    ASSERT_EQUAL(static_cast<size_t>(3), storage.GetAllKeys().size());
+
+    ASSERT_TRUE(storage.SaveState("theme", "blue"));
+    ASSERT_TRUE(storage.ClearState("quote"));
+    ASSERT_FALSE(storage.HasState("quote"));
+    ASSERT_FALSE(storage.SetApplicationName("../Other"));
+
+    // Switching away and back reopens state.map; no second migration
+    ASSERT_TRUE(storage.SetApplicationName("Other"));
+    ASSERT_TRUE(storage.GetAllKeys().empty());
+    ASSERT_TRUE(storage.SetApplicationName("App"));
+    std::string value;
+    ASSERT_TRUE(storage.LoadState("theme", value));
+    ASSERT_EQUAL(std::string("blue"), value);
+    ASSERT_FALSE(storage.LoadState("quote", value));
+
+    // Writes made through the journal meanwhile (the other backend) win
+    ASSERT_TRUE(storage.SetApplicationName("Other"));
+    {
+      StateJournal journal(directory);
+      ASSERT_TRUE(journal.Open());
+      ASSERT_TRUE(journal.Replace({{"theme", "green"}}));
+    }
+    ASSERT_TRUE(storage.SetApplicationName("App"));
+    ASSERT_TRUE(storage.LoadState("theme", value));
+    ASSERT_EQUAL(std::string("green"), value);
+    ASSERT_EQUAL(static_cast<size_t>(1), storage.GetAllKeys().size());
+    ASSERT_FALSE(StateJournal::Exists(directory));
+    ASSERT_TRUE(storage.ClearAllState());
+    ASSERT_TRUE(storage.GetAllKeys().empty());
+    ASSERT_TRUE(storage.SetApplicationName("Other"));  // Closes App before removal
+    std::filesystem::remove_all(root);
+  }
+}
+
+// ==========================================
+// JsonReader
+// ==========================================
+
+TEST_SUITE(JsonReader) {
+  TEST_CASE(tokens_and_values) {
+    using Token = JsonReader::Token;
+    std::string json = R"( {"type":"saveState", "n":[-12, 3.5e2, 0], "ok":true,
+                             "no":false, "none":null, "nested":{"a":{}}} )";
+    JsonReader reader(json);
+    std::vector<Token> tokens;
+    Token token;
+    while ((token = reader.Next()) != Token::END && token != Token::ERROR) {
+      tokens.push_back(token);
+    }
+    ASSERT_TRUE(token == Token::END);
+    std::vector<Token> expected = {
+        Token::BEGIN_OBJECT, Token::KEY, Token::STRING, Token::KEY, Token::BEGIN_ARRAY,
+        Token::NUMBER, Token::NUMBER, Token::NUMBER, Token::END_ARRAY, Token::KEY,
+        Token::TRUE_VALUE, Token::KEY, Token::FALSE_VALUE, Token::KEY, Token::NULL_VALUE,
+        Token::KEY, Token::BEGIN_OBJECT, Token::KEY, Token::BEGIN_OBJECT, Token::END_OBJECT,
+        Token::END_OBJECT, Token::END_OBJECT};
+    ASSERT_TRUE(tokens == expected);
+    ASSERT_TRUE(reader.Next() == Token::END);  // END is final
+
+    // Values are views into the input; numbers convert on demand
+    JsonReader numbers(R"([-12, 3.5e2, 2147483648])");
+    int integer = 0;
+    double real = 0;
+    ASSERT_TRUE(numbers.Next() == Token::BEGIN_ARRAY);
+    ASSERT_TRUE(numbers.Next() == Token::NUMBER);
+    ASSERT_EQUAL(std::string("-12"), std::string(numbers.Text()));
+    ASSERT_TRUE(numbers.GetInt(integer));
+    ASSERT_EQUAL(-12, integer);
+    ASSERT_TRUE(numbers.Next() == Token::NUMBER);
+    ASSERT_FALSE(numbers.GetInt(integer));
+    ASSERT_TRUE(numbers.GetDouble(real));
+    ASSERT_TRUE(real == 350.0);
+    ASSERT_TRUE(numbers.Next() == Token::NUMBER);
+    ASSERT_FALSE(numbers.GetInt(integer));  // Out of int range
+
+    // SkipValue() leaves the container's last token current
+    JsonReader skipping(R"({"skip":{"a":[1,{"b":2}]},"keep":"x"})");
+    std::string keep;
+    ASSERT_TRUE(skipping.Next() == Token::BEGIN_OBJECT);
+    ASSERT_TRUE(skipping.Next() == Token::KEY);
+    ASSERT_TRUE(skipping.Next() == Token::BEGIN_OBJECT);
+    ASSERT_TRUE(skipping.SkipValue());
+    ASSERT_TRUE(skipping.Current() == Token::END_OBJECT);
+    ASSERT_EQUAL(static_cast<size_t>(1), skipping.Depth());
+    ASSERT_TRUE(skipping.Next() == Token::KEY);
+    ASSERT_TRUE(skipping.TextEquals("keep"));
+  }
+
+  TEST_CASE(escapes_decode_only_on_demand) {
+    using Token = JsonReader::Token;
+    // saveState carries the page's JSON.stringify() output as a string
+    std::string json = R"({"k\u0065y":"a\"b\\c\/\n\t\u00e9\u2713\ud83d\ude00","plain":"x"})";
+    JsonReader reader(json);
+    std::string text;
+    ASSERT_TRUE(reader.Next() == Token::BEGIN_OBJECT);
+    ASSERT_TRUE(reader.Next() == Token::KEY);
+    ASSERT_TRUE(reader.HasEscapes());
+    ASSERT_TRUE(reader.TextEquals("key"));
+    ASSERT_FALSE(reader.TextEquals("ke"));
+    ASSERT_FALSE(reader.TextEquals("keys"));
+    ASSERT_TRUE(reader.Next() == Token::STRING);
+    ASSERT_EQUAL(std::string(R"(a\"b\\c\/\n\t\u00e9\u2713\ud83d\ude00)"), std::string(reader.Text()));
+    ASSERT_TRUE(reader.GetString(text));
+    ASSERT_EQUAL(std::string("a\"b\\c/\n\t\xC3\xA9\xE2\x9C\x93\xF0\x9F\x98\x80"), text);
+    ASSERT_TRUE(reader.TextEquals(text));
+
+    ASSERT_TRUE(JsonReader::FindString(json, "plain", text));
+    ASSERT_EQUAL(std::string("x"), text);
+    ASSERT_TRUE(JsonReader::FindString(json, "key", text));
+    ASSERT_FALSE(JsonReader::FindString(json, "missing", text));
+    ASSERT_FALSE(JsonReader::FindString(R"({"n":{"type":"nested"}})", "type", text));  // Top level only
+    ASSERT_FALSE(JsonReader::FindString(R"({"type":1})", "type", text));
+
+    // Unpaired surrogates are rejected when decoded
+    ASSERT_FALSE(JsonReader::Unescape(R"(\ud83d)", text));
+    ASSERT_FALSE(JsonReader::Unescape(R"(\ude00x)", text));
+    ASSERT_FALSE(JsonReader::Unescape(R"(\ud83d\u0041)", text));
+    ASSERT_TRUE(JsonReader::Unescape(R"(caf\u00E9)", text));
+    ASSERT_EQUAL(std::string("caf\xC3\xA9"), text);
+  }
+
+  TEST_CASE(malformed_input_is_an_error) {
+    const char* cases[] = {
+        "", "   ", "{", "}", "[1,]", "{\"a\":1,}", "{\"a\" 1}", "{\"a\":}", "{1:2}",
+        "[01]", "[1.]", "[-]", "[1e]", "[.5]", "[+1]", "[tru]", "[nul]", "[\"\\x\"]",
+        "[\"\\u12G4\"]", "[\"unterminated]", "[\"tab\there\"]", "{\"a\":1} x", "[1 2]",
+        "[1]]", "{\"a\":1]", "{'a':1}",
+    };
+    for (const char* text : cases) {
+      JsonReader reader(text);
+      JsonReader::Token token;
+      do {
+        token = reader.Next();
+      } while (token != JsonReader::Token::END && token != JsonReader::Token::ERROR);
+      ASSERT_TRUE(token == JsonReader::Token::ERROR);
+      ASSERT_TRUE(reader.Next() == JsonReader::Token::ERROR);  // Errors are final
+    }
+
+    // Nesting is bounded without recursion
+    std::string deep(JsonReader::kMaxDepth, '[');
+    deep += std::string(JsonReader::kMaxDepth, ']');
+    JsonReader ok(deep);
+    while (ok.Next() == JsonReader::Token::BEGIN_ARRAY) {}
+    ASSERT_TRUE(ok.Current() == JsonReader::Token::END_ARRAY);
+    std::string deeper = "[" + deep + "]";
+    JsonReader too_deep(deeper);
+    while (too_deep.Next() == JsonReader::Token::BEGIN_ARRAY) {}
+    ASSERT_TRUE(too_deep.Current() == JsonReader::Token::ERROR);
+    ASSERT_EQUAL(JsonReader::kMaxDepth, too_deep.ErrorOffset());
+  }
+}
+
+TEST_SUITE(IframeDetectorParsing) {
+  TEST_CASE(parses_sdk_iframe_data) {
+    // As sent by the SDK: bounds rounded, members in any order, extra fields
+    std::string json = R"({"type":"IFRAME_DATA","iframes":[
+        {"index":0,"id":"ad-\"1\"","src":"https://ads.example/a?x=1&y=\u00e9",
+         "bounds":{"left":10,"top":20,"width":300,"height":250},
+         "clickUrl":"https://example.com/landing","visible":true},
+        {"visible":false,"bounds":{"height":50.6,"width":60,"top":-5,"left":0,"extra":[1,2]},
+         "id":"banner","meta":{"bounds":{"left":999}}},
+        7]})";
+    std::vector<IframeInfo> iframes;
+    ASSERT_TRUE(IframeDetector::UpdateIframeVector(json, iframes));
+    ASSERT_EQUAL(static_cast<size_t>(2), iframes.size());
+    ASSERT_EQUAL(std::string("ad-\"1\""), iframes[0].id);
+    ASSERT_EQUAL(std::string("https://ads.example/a?x=1&y=\xC3\xA9"), iframes[0].src);
+    ASSERT_EQUAL(std::string("https://example.com/landing"), iframes[0].click_url);
+    ASSERT_EQUAL(10, iframes[0].left);
+    ASSERT_EQUAL(250, iframes[0].height);
+    ASSERT_TRUE(iframes[0].visible);
+    ASSERT_EQUAL(std::string("banner"), iframes[1].id);
+    ASSERT_EQUAL(-5, iframes[1].top);
+    ASSERT_EQUAL(0, iframes[1].left);
+    ASSERT_EQUAL(51, iframes[1].height);
+    ASSERT_FALSE(iframes[1].visible);
+    ASSERT_TRUE(iframes[1].click_url.empty());
+    ASSERT_TRUE(IframeDetector::GetIframeAtPointInVector(15, 25, iframes) == &iframes[0]);
+
+    // An empty list clears; a truncated message is rejected as a whole
+    ASSERT_TRUE(IframeDetector::UpdateIframeVector(R"({"type":"IFRAME_DATA","iframes":[]})", iframes));
+    ASSERT_TRUE(iframes.empty());
+    ASSERT_FALSE(IframeDetector::UpdateIframeVector(json.substr(0, json.size() / 2), iframes));
+    ASSERT_TRUE(iframes.empty());
+    ASSERT_FALSE(IframeDetector::UpdateIframeVector(R"({"type":"IFRAME_DATA"})", iframes));
+  }
+}
+
+// ==========================================
+// JsonStructuralIndex
+// ==========================================
+
+namespace {
+
+// Byte-at-a-time model of the index: unescaped quotes, structurals outside
+// strings, and the first malformed byte inside a string
+void ReferenceIndex(const std::string& json, std::vector<uint32_t>& positions, size_t& first_error) {
+  positions.clear();
+  first_error = JsonStructuralIndex::kNoError;
+  bool in_string = false;
+  bool escape_next = false;
+  size_t pending_hex = 0;
+  for (size_t i = 0; i < json.size(); i++) {
+    unsigned char c = static_cast<unsigned char>(json[i]);
+    bool escaped = escape_next;
+    escape_next = c == '\\' && !escaped;
+    bool quote = c == '"' && !escaped;
+    bool content = in_string && !quote;
+    bool needs_hex = pending_hex > 0;
+    if (pending_hex > 0) pending_hex--;
+    bool valid_escape = c == '"' || c == '\\' || c == '/' || c == 'b' || c == 'f' ||
+                        c == 'n' || c == 'r' || c == 't' || c == 'u';
+    bool error = (content && (c < 0x20 || (escaped && !valid_escape))) ||
+                 (needs_hex && !std::isxdigit(c) && (content || quote));
+    if (escaped && c == 'u') pending_hex = 4;
+    if (error && first_error == JsonStructuralIndex::kNoError) first_error = i;
+    if (quote) {
+      positions.push_back(static_cast<uint32_t>(i));
+      in_string = !in_string;
+    } else if (!in_string && (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',')) {
+      positions.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+std::vector<JsonStructuralIndex::Kernel> SupportedKernels() {
+  std::vector<JsonStructuralIndex::Kernel> kernels;
+  for (auto kernel : {JsonStructuralIndex::Kernel::SCALAR, JsonStructuralIndex::Kernel::SSE2,
+                      JsonStructuralIndex::Kernel::AVX2, JsonStructuralIndex::Kernel::NEON}) {
+    if (JsonStructuralIndex::IsSupported(kernel)) kernels.push_back(kernel);
+  }
+  return kernels;
+}
+
+// Every token, its text and the error offset, for comparing readers
+std::string TokenTrace(JsonReader& reader) {
+  std::string trace;
+  JsonReader::Token token;
+  do {
+    token = reader.Next();
+    trace += std::to_string(static_cast<int>(token)) + ":" + std::string(reader.Text()) +
+             (reader.HasEscapes() ? "\\" : "") + "|";
+  } while (token != JsonReader::Token::END && token != JsonReader::Token::ERROR);
+  if (token == JsonReader::Token::ERROR) trace += "@" + std::to_string(reader.ErrorOffset());
+  return trace;
+}
+
+}  // namespace
+
+TEST_SUITE(JsonStructuralIndex) {
+  TEST_CASE(kernels_match_reference_model) {
+    // Backslash runs, quotes and \u escapes straddling 64-byte blocks
+    std::vector<std::string> inputs = {"", "{}", "\"", "[\"a\\\"b\",1]"};
+    for (size_t shift = 56; shift < 72; shift++) {
+      std::string pad(shift, ' ');
+      inputs.push_back(pad + "[\"x\\\\\\\"y\",{\"k\":\"\\u00e9\"}]");
+      inputs.push_back(pad + "\"\\u12G4\"");
+      inputs.push_back(pad + "\"\\u12\",\"ok\"");
+      inputs.push_back(pad + "\"\\\\\\\\\\\\\\\\\\\"\",\"\\q\"");
+      inputs.push_back("\"" + pad + "\x01\"");
+    }
+    uint64_t seed = 0x2545F4914F6CDD1Dull;
+    const char alphabet[] = "\"\\\\\\u0a9F{}[]:, x\x01\xc3";
+    for (int n = 0; n < 3000; n++) {
+      seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+      std::string text(seed % 300, ' ');
+      for (char& c : text) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        c = alphabet[seed % (sizeof(alphabet) - 1)];
+      }
+      inputs.push_back(text);
+    }
+
+    JsonStructuralIndex index;
+    std::vector<uint32_t> expected;
+    size_t expected_error = 0;
+    for (const std::string& input : inputs) {
+      ReferenceIndex(input, expected, expected_error);
+      for (auto kernel : SupportedKernels()) {
+        ASSERT_TRUE(index.Build(input, kernel));
+        ASSERT_TRUE(index.GetKernel() == kernel);
+        std::vector<uint32_t> actual(index.Positions(), index.Positions() + index.Size());
+        ASSERT_TRUE(actual == expected);
+        ASSERT_EQUAL(expected_error, index.FirstError());
+      }
+    }
+    ASSERT_TRUE(JsonStructuralIndex::IsSupported(JsonStructuralIndex::BestKernel()));
+  }
+
+  TEST_CASE(indexed_reader_matches_plain_reader) {
+    std::string message = R"({"type":"IFRAME_DATA","iframes":[)";
+    for (int i = 0; i < 40; i++) {
+      message += std::string(i ? "," : "") + R"({"id":"ad-)" + std::to_string(i) +
+                 R"(","src":"https:\/\/ads.example\/c?q=\"x\"&n=\u00e9\ud83d\ude00",)"
+                 R"("bounds":{"left":)" + std::to_string(i * 10) +
+                 R"(,"top":0,"width":300,"height":250},"visible":true})";
+    }
+    message += "]}";
+    ASSERT_TRUE(message.size() >= JsonStructuralIndex::kMinIndexedBytes);
+
+    // The message, then truncations and single-byte corruptions of it
+    std::vector<std::string> inputs = {message};
+    for (size_t at = 1; at < message.size(); at += 97) {
+      inputs.push_back(message.substr(0, at));
+      for (char c : {'"', '\\', '\x01', '}', 'u'}) {
+        std::string corrupt = message;
+        corrupt[at] = c;
+        inputs.push_back(corrupt);
+      }
+    }
+    JsonStructuralIndex index;
+    for (const std::string& input : inputs) {
+      JsonReader plain(input);
+      std::string expected = TokenTrace(plain);
+      for (auto kernel : SupportedKernels()) {
+        ASSERT_TRUE(index.Build(input, kernel));
+        JsonReader indexed(input, &index);
+        ASSERT_EQUAL(expected, TokenTrace(indexed));
+      }
+    }
+
+    // Only messages large enough to pay for the pass get an index
+    ASSERT_TRUE(JsonStructuralIndex::ForThread(message) != nullptr);
+    ASSERT_TRUE(JsonStructuralIndex::ForThread("{}") == nullptr);
+  }
+}
+
+// ==========================================
+// JsonWriter
+// ==========================================
+
+TEST_SUITE(JsonWriter) {
+  TEST_CASE(commas_and_values) {
+    JsonWriter json;
+    json.BeginObject()
+        .Key("a").Int(-5)
+        .Key("b").BeginArray().Bool(true).Null().String("x").BeginObject().EndObject().EndArray()
+        .Key("c").Int(INT64_MIN)
+        .EndObject();
+    ASSERT_EQUAL(std::string(R"({"a":-5,"b":[true,null,"x",{}],"c":-9223372036854775808})"),
+                 std::string(json.View()));
+    JsonReader reader(json.View());
+    ASSERT_TRUE(reader.Next() == JsonReader::Token::BEGIN_OBJECT);
+    ASSERT_TRUE(reader.SkipValue());
+    ASSERT_TRUE(reader.Next() == JsonReader::Token::END);
+
+    // Clear() starts over; Raw() text is verbatim and takes no comma
+    json.Clear();
+    json.Raw("f({detail: ").BeginObject().Key("ok").Bool(false).EndObject().Raw("});");
+    ASSERT_EQUAL(std::string(R"(f({detail: {"ok":false}});)"), std::string(json.View()));
+
+    WideJsonWriter wide;
+    wide.Raw("go(").BeginArray().Int(1).Int(2).EndArray().Raw(")");
+    ASSERT_TRUE(wide.View() == L"go([1,2])");
+  }
+
+  TEST_CASE(strings_escape_for_json_and_js) {
+    const std::string text = "q\"b\\n\n\x01\x7f \xC3\xA9 \xE2\x80\xA8 \xF0\x9F\x98\x80";
+    JsonWriter json;
+    json.String(text);
+    ASSERT_EQUAL(std::string("\"q\\\"b\\\\n\\n\\u0001\x7f \xC3\xA9 \\u2028 \xF0\x9F\x98\x80\""),
+                 std::string(json.View()));
+    std::string decoded;
+    std::string_view body = json.View().substr(1, json.Size() - 2);
+    ASSERT_TRUE(JsonReader::Unescape(body, decoded));
+    ASSERT_EQUAL(text, decoded);
+
+    // UTF-16 out, surrogate pair for the emoji
+    WideJsonWriter wide;
+    wide.String("\xC3\xA9\xE2\x80\xA9\xF0\x9F\x98\x80");
+    std::wstring expected = L"\"";
+    expected += static_cast<wchar_t>(0xE9);
+    expected += L"\\u2029";
+    expected += static_cast<wchar_t>(0xD83D);
+    expected += static_cast<wchar_t>(0xDE00);
+    expected += L"\"";
+    ASSERT_TRUE(wide.View() == expected);
+
+    // Invalid UTF-8 (stray byte, encoded surrogate, truncated) -> U+FFFD
+    json.Clear();
+    json.String("a\xFF" "b\xED\xA0\x80" "c\xE2\x82");
+    ASSERT_EQUAL(std::string("\"a\xEF\xBF\xBD" "b\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD" "c\xEF\xBF\xBD\xEF\xBF\xBD\""),
+                 std::string(json.View()));
+    wide.Clear();
+    wide.String("\xC0\xAF");  // Overlong '/'
+    ASSERT_TRUE(wide.View() == L"\"\xFFFD\xFFFD\"");
+  }
+}
+
+TEST_SUITE(WebMessageTypes) {
+  TEST_CASE(decode_reads_declared_members_in_one_pass) {
+    webmessage::SaveStateMessage save;
+    ASSERT_TRUE(webmessage::Decode(
+        R"({"type":"saveState","extra":{"a":[1,{"key":"no"}]},"key":"k\u00e9",)"
+        R"("value":"{\"n\":1}","durability":"sync"})", save));
+    ASSERT_EQUAL(std::string("k\xC3\xA9"), save.key);
+    ASSERT_EQUAL(std::string(R"({"n":1})"), save.value);
+    ASSERT_TRUE(save.durability == webmessage::SaveStateMessageDurability::SYNC);
+
+    ASSERT_TRUE(webmessage::Decode(R"({"key":"k","value":"","durability":null,"type":"saveState"})",
+                                   save));
+    ASSERT_FALSE(save.durability.has_value());
+
+    const char* rejected[] = {
+        R"({"type":"saveState","value":"v"})",                          // Missing key
+        R"({"type":"saveState","key":1,"value":"v"})",                   // Wrong JSON type
+        R"({"type":"saveState","key":"k","value":"v","durability":"x"})",  // Not in the union
+        R"({"type":"loadState","key":"k","value":"v"})",                 // Other message
+        R"({"key":"k","value":"v"})",                                    // No type
+        R"({"type":"saveState","key":"k","value":"v"} x)",
+        R"({"type":"saveState","key":"k","value":"v")",
+    };
+    for (const char* json : rejected) {
+      ASSERT_FALSE(webmessage::Decode(json, save));
+    }
+
+    // Alternative type names decode to the same struct
+    webmessage::OpenUrlMessage open_url;
+    ASSERT_TRUE(webmessage::Decode(R"({"type":"OPEN_URL","url":"https://a.b/"})", open_url));
+    ASSERT_EQUAL(std::string("https://a.b/"), open_url.url);
+    ASSERT_EQUAL(size_t(2), std::size(webmessage::OpenUrlMessage::kTypes));
+  }
+
+  TEST_CASE(encode_round_trips) {
+    webmessage::SaveStateMessage save;
+    save.key = "k\n";
+    save.value = "{\"n\":\"\xE2\x80\xA8\"}";  // U+2028 goes out escaped
+    save.durability = webmessage::SaveStateMessageDurability::MEMORY;
+    JsonWriter json;
+    webmessage::Encode(save, json);
+    ASSERT_EQUAL(std::string(R"({"type":"saveState","key":"k\n","value":"{\"n\":\"\u2028\"}",)"
+                             R"("durability":"memory"})"),
+                 std::string(json.View()));
+    webmessage::SaveStateMessage decoded;
+    ASSERT_TRUE(webmessage::Decode(json.View(), decoded));
+    ASSERT_EQUAL(save.key, decoded.key);
+    ASSERT_EQUAL(save.value, decoded.value);
+    ASSERT_TRUE(decoded.durability == save.durability);
+
+    // The mouse event EventDispatcher posts, in UTF-16
+    webmessage::MouseEventData mouse;
+    ASSERT_TRUE(webmessage::FromString("mousemove", mouse.event_type));
+    ASSERT_FALSE(webmessage::FromString("wheel", mouse.event_type));
+    mouse.x = 1920;
+    mouse.y = -5;
+    mouse.button = 0;
+    WideJsonWriter wide;
+    webmessage::Encode(mouse, wide);
+    ASSERT_TRUE(wide.View() ==
+                L"{\"type\":\"mouseEvent\",\"eventType\":\"mousemove\",\"x\":1920,\"y\":-5,\"button\":0}");
+
+    json.Clear();
+    json.BeginArray().Double(0.1).Double(1e6).Double(-2.5e-7).Double(std::nan("")).EndArray();
+    ASSERT_EQUAL(std::string("[0.1,1000000,-2.5e-07,null]"), std::string(json.View()));
+  }
+}
+
+TEST_SUITE(MessageRouter) {
+  TEST_CASE(known_types_resolve_to_slots) {
+    // Every spelling the SDK declares has a slot, and only exact names match
+    for (std::string_view type : webmessage::OpenUrlMessage::kTypes) {
+      ASSERT_TRUE(MessageRouter::Lookup(type) == MessageSlot::OPEN_URL);
+    }
+    for (std::string_view type : webmessage::LogMessage::kTypes) {
+      ASSERT_TRUE(MessageRouter::Lookup(type) == MessageSlot::LOG);
+    }
+    ASSERT_TRUE(MessageRouter::Lookup("IFRAME_DATA") == MessageSlot::IFRAME_DATA);
+    ASSERT_TRUE(MessageRouter::Lookup("sdkReady") == MessageSlot::SDK_READY);
+    ASSERT_TRUE(MessageRouter::Lookup("resumeResult") == MessageSlot::RESUME_RESULT);
+    for (const char* other : {"", "saveStat", "saveStatee", "SAVESTATE", "x", "mouseEvent"}) {
+      ASSERT_TRUE(MessageRouter::Lookup(other) == MessageSlot::NONE);
+    }
+  }
+
+  TEST_CASE(dispatches_slots_and_custom_types) {
+    MessageRouter router;
+    std::vector<std::string> calls;
+    auto record = [&calls](const char* tag) {
+      return [&calls, tag](const std::string& message) { calls.push_back(tag + message); };
+    };
+    router.SetHandler(MessageSlot::OPEN_URL, record("url:"));
+    router.SetHandler("READY", record("ready:"));  // Known name: fills the slot
+    router.SetHandler("myWidgetEvent", record("custom:"));
+
+    ASSERT_TRUE(router.Dispatch("OPEN_URL", "1"));
+    ASSERT_TRUE(router.Dispatch("openURL", "2"));
+    ASSERT_TRUE(router.Dispatch("ready", "3"));
+    ASSERT_TRUE(router.Dispatch("myWidgetEvent", "4"));
+    ASSERT_FALSE(router.Dispatch("saveState", "5"));     // Known, no handler
+    ASSERT_FALSE(router.Dispatch("otherWidget", "6"));   // Unknown
+    ASSERT_EQUAL(size_t(4), calls.size());
+    ASSERT_EQUAL(std::string("url:1"), calls[0]);
+    ASSERT_EQUAL(std::string("url:2"), calls[1]);
+    ASSERT_EQUAL(std::string("ready:3"), calls[2]);
+    ASSERT_EQUAL(std::string("custom:4"), calls[3]);
+
+    router.RemoveHandler("openURL");
+    router.RemoveHandler("myWidgetEvent");
+    ASSERT_FALSE(router.HasHandler("OPEN_URL"));
+    ASSERT_FALSE(router.HasHandler("myWidgetEvent"));
+    ASSERT_TRUE(router.HasHandler("READY"));
+    ASSERT_FALSE(router.Dispatch("OPEN_URL", "7"));
+    ASSERT_FALSE(router.Dispatch("myWidgetEvent", "8"));
+  }
+}
+
+// Main test runner
+int main() {
+  int result = TestRunner::Instance().Run();
+  std::error_code ec;
+  std::filesystem::remove_all(kTestDirectory, ec);
+  return result;
+}
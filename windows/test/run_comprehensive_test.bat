@@ -45,6 +45,10 @@ cl /EHsc /std:c++17 ^
    /I"%WEBVIEW2_DIR%\build\native\include" ^
    "%cd%\comprehensive_test.cpp" ^
    "%cd%\..\utils\logger.cpp" ^
+   "%cd%\..\utils\log_site.cpp" ^
+   "%cd%\..\utils\log_rate_limiter.cpp" ^
+   "%cd%\..\utils\log_flight_recorder.cpp" ^
+   "%cd%\..\utils\log_rotator.cpp" ^
    "%cd%\..\utils\resource_tracker.cpp" ^
    "%cd%\..\utils\desktop_wallpaper_helper.cpp" ^
    "%cd%\..\utils\url_validator.cpp" ^
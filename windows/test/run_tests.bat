@@ -42,6 +42,10 @@ cl /EHsc /std:c++17 ^
    /I"%WEBVIEW2_DIR%\build\native\include" ^
    "%cd%\unit_tests.cpp" ^
    "%cd%\..\utils\logger.cpp" ^
+   "%cd%\..\utils\log_site.cpp" ^
+   "%cd%\..\utils\log_rate_limiter.cpp" ^
+   "%cd%\..\utils\log_flight_recorder.cpp" ^
+   "%cd%\..\utils\log_rotator.cpp" ^
    "%cd%\..\utils\resource_tracker.cpp" ^
    "%cd%\..\utils\conflict_detector.cpp" ^
    "%cd%\..\utils\desktop_wallpaper_helper.cpp" ^
@@ -89,6 +93,10 @@ cl /EHsc /std:c++17 ^
    /I"%WEBVIEW2_DIR%\build\native\include" ^
    "%cd%\webview_manager_tests.cpp" ^
    "%cd%\..\utils\logger.cpp" ^
+   "%cd%\..\utils\log_site.cpp" ^
+   "%cd%\..\utils\log_rate_limiter.cpp" ^
+   "%cd%\..\utils\log_flight_recorder.cpp" ^
+   "%cd%\..\utils\log_rotator.cpp" ^
    "%cd%\..\modules\webview_manager.cpp" ^
    /link /out:"webview_tests.exe" ^
    "%WEBVIEW2_DIR%\build\native\x64\WebView2LoaderStatic.lib" ^
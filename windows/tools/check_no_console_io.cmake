@@ -0,0 +1,59 @@
+# Fails when a source on the mouse-hook or message paths writes to the console
+# directly. Such code logs through ANYWP_LOG_* instead, which honours levels,
+# rate limits and HotPathScope (utils/hot_path.h).
+#
+# Usage: cmake -DSOURCE_DIR=<windows dir> -P check_no_console_io.cmake
+#
+# anywp_engine_plugin.cpp handles messages too but still prints directly;
+# add it here once its std::cout calls go through the logger.
+
+set(MESSAGE_PATH_SOURCES
+  modules/iframe_detector.cpp
+  modules/mouse_hook_manager.cpp
+  modules/power_manager.cpp
+  modules/sdk_bridge.cpp
+  utils/file_sync.cpp
+  utils/json_reader.cpp
+  utils/json_structural_index.cpp
+  utils/json_writer.cpp
+  utils/mapped_state_storage.cpp
+  utils/message_router.cpp
+  utils/snapshot_ptr.cpp
+  utils/state_hash_file.cpp
+  utils/state_journal.cpp
+  utils/state_persistence.cpp
+  utils/url_validator.cpp
+)
+
+# Console streams and the printf family, as whole identifiers
+set(CONSOLE_IO_REGEX
+  "(^|[^A-Za-z0-9_])(w?c(out|err|log)[ \t]*<<|w?printf[ \t]*\\(|puts[ \t]*\\(|OutputDebugString[AW]?[ \t]*\\()")
+
+if(NOT SOURCE_DIR)
+  message(FATAL_ERROR "check_no_console_io.cmake: SOURCE_DIR is not set")
+endif()
+
+set(violations "")
+foreach(source ${MESSAGE_PATH_SOURCES})
+  file(READ "${SOURCE_DIR}/${source}" content)
+  # One list element per line; ';' and brackets would split or merge elements
+  string(REPLACE ";" "," content "${content}")
+  string(REPLACE "[" "(" content "${content}")
+  string(REPLACE "]" ")" content "${content}")
+  string(REPLACE "\n" ";" lines "${content}")
+  set(line_number 0)
+  foreach(line IN LISTS lines)
+    math(EXPR line_number "${line_number} + 1")
+    if(line MATCHES "^[ \t]*(//|\\*)")
+      continue()
+    endif()
+    if(line MATCHES "${CONSOLE_IO_REGEX}")
+      string(STRIP "${line}" line)
+      string(APPEND violations "\n  ${source}:${line_number}: ${line}")
+    endif()
+  endforeach()
+endforeach()
+
+if(violations)
+  message(FATAL_ERROR "Direct console I/O on a message path (use ANYWP_LOG_*):${violations}")
+endif()
@@ -0,0 +1,62 @@
+// AnyWP Engine - Flight recorder dump tool
+//
+// Recovers the log history kept by Logger::EnableFlightRecorder() from the
+// ring file, e.g. after a crash or while the process is hung. Works on any
+// copy of the file, on Windows or Linux.
+//
+// Usage:
+//   flight_recorder_dump <recorder-file> [max-size]
+//
+//   max-size  Only print the most recent bytes, e.g. 65536, 512K or 2M
+//             (default: everything still in the ring)
+
+#include "../utils/log_flight_recorder.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// Parse "65536", "512K" or "2M"; returns false on malformed input
+bool ParseSize(const std::string& text, size_t& bytes) {
+  char* end = nullptr;
+  unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+  if (end == text.c_str()) {
+    return false;
+  }
+  std::string suffix(end);
+  if (suffix == "K" || suffix == "k") {
+    value *= 1024;
+  } else if (suffix == "M" || suffix == "m") {
+    value *= 1024 * 1024;
+  } else if (!suffix.empty()) {
+    return false;
+  }
+  bytes = static_cast<size_t>(value);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    std::fprintf(stderr, "Usage: %s <recorder-file> [max-size, e.g. 512K or 2M]\n", argv[0]);
+    return 2;
+  }
+
+  size_t max_bytes = 0;
+  if (argc == 3 && !ParseSize(argv[2], max_bytes)) {
+    std::fprintf(stderr, "Invalid size: %s\n", argv[2]);
+    return 2;
+  }
+
+  std::string history;
+  if (!anywp_engine::LogFlightRecorder::ReadFile(argv[1], history, max_bytes)) {
+    std::fprintf(stderr, "Not a readable flight recorder file: %s\n", argv[1]);
+    return 1;
+  }
+
+  std::fwrite(history.data(), 1, history.size(), stdout);
+  return 0;
+}
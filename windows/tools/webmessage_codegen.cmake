@@ -0,0 +1,43 @@
+# Sets WEBMESSAGE_CODEGEN, the webmessage_codegen command for
+# add_custom_command/add_test, and WEBMESSAGE_CODEGEN_DEPENDS.
+#
+# Native builds compile it as a target. A cross build cannot run a target
+# binary, so the generator is built once for the build machine at configure
+# time (tools/CMakeLists.txt, host compiler), or taken from
+# -DWEBMESSAGE_HOST_CODEGEN=<path> when that is not possible.
+
+if(CMAKE_CROSSCOMPILING)
+  set(WEBMESSAGE_HOST_CODEGEN "" CACHE FILEPATH
+      "webmessage_codegen built for the build machine (cross builds)")
+  if(NOT WEBMESSAGE_HOST_CODEGEN)
+    set(_host_dir "${CMAKE_BINARY_DIR}/host_tools")
+    # No toolchain file, platform or CC/CXX: the host defaults
+    execute_process(
+      COMMAND "${CMAKE_COMMAND}" -E env --unset=CC --unset=CXX
+              "${CMAKE_COMMAND}" -S "${CMAKE_CURRENT_LIST_DIR}" -B "${_host_dir}"
+              -G "${CMAKE_GENERATOR}" -DCMAKE_BUILD_TYPE=Release
+      RESULT_VARIABLE _result)
+    if(_result EQUAL 0)
+      execute_process(
+        COMMAND "${CMAKE_COMMAND}" --build "${_host_dir}" --config Release
+        RESULT_VARIABLE _result)
+    endif()
+    if(NOT _result EQUAL 0)
+      message(FATAL_ERROR "Cannot build webmessage_codegen for the build machine; "
+                          "pass -DWEBMESSAGE_HOST_CODEGEN=<path to a host build>")
+    endif()
+    set(WEBMESSAGE_HOST_CODEGEN "${_host_dir}/bin/webmessage_codegen")
+    if(CMAKE_HOST_WIN32)
+      string(APPEND WEBMESSAGE_HOST_CODEGEN ".exe")
+    endif()
+    # Reconfigure (and so rebuild it) when the generator changes
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS
+                 "${CMAKE_CURRENT_LIST_DIR}/webmessage_codegen.cpp")
+  endif()
+  set(WEBMESSAGE_CODEGEN "${WEBMESSAGE_HOST_CODEGEN}")
+  set(WEBMESSAGE_CODEGEN_DEPENDS "${WEBMESSAGE_HOST_CODEGEN}")
+else()
+  add_executable(webmessage_codegen "${CMAKE_CURRENT_LIST_DIR}/webmessage_codegen.cpp")
+  set(WEBMESSAGE_CODEGEN webmessage_codegen)
+  set(WEBMESSAGE_CODEGEN_DEPENDS webmessage_codegen)
+endif()
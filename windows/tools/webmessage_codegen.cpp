@@ -0,0 +1,727 @@
+// AnyWP Engine - Web-message type generator
+//
+// Turns the message interfaces in sdk/types/webmessage.ts into C++:
+// one struct per message, a single-pass decoder (JsonReader) and an
+// encoder (JsonWriter) for each, and constexpr name tables for string
+// literal unions. CMake runs it on every build that touches the .ts file,
+// so the engine always compiles against the SDK's current message shapes:
+// a renamed or retyped member breaks the C++ that uses it.
+//
+// A message is an interface whose `type` member is a string literal or a
+// union of them. Its other members may be string, number, boolean or a
+// union of string literals, each optionally `?`. Anything else in a
+// message stops the build with "file:line: error: ..."; other declarations
+// (type guards, unions, interfaces without a literal `type`) are ignored.
+//
+// A string member whose doc comment says @raw keeps its JSON literal body,
+// escapes intact, instead of the decoded text.
+//
+// Usage:
+//   webmessage_codegen <webmessage.ts> <output-dir>
+// writes <output-dir>/webmessage_types.h and webmessage_types.cpp.
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// ========== Tokenizer ==========
+
+struct Token {
+  enum Kind { IDENT, STRING, PUNCT, END } kind = END;
+  std::string text;  // STRING: contents without quotes
+  int line = 0;
+  std::string doc;      // /** */ comment just before this token
+  std::string trailer;  // // comment after this token on the same line
+};
+
+std::vector<Token> Tokenize(const std::string& source) {
+  std::vector<Token> tokens;
+  std::string pending_doc;
+  int line = 1;
+  size_t i = 0;
+  while (i < source.size()) {
+    char c = source[i];
+    if (c == '\n') {
+      line++;
+      i++;
+    } else if (std::isspace(static_cast<unsigned char>(c))) {
+      i++;
+    } else if (source.compare(i, 2, "//") == 0) {
+      size_t end = source.find('\n', i);
+      if (end == std::string::npos) end = source.size();
+      if (!tokens.empty() && tokens.back().line == line) {
+        tokens.back().trailer = source.substr(i + 2, end - i - 2);
+      }
+      i = end;
+    } else if (source.compare(i, 2, "/*") == 0) {
+      size_t end = source.find("*/", i + 2);
+      if (end == std::string::npos) end = source.size();
+      std::string body = source.substr(i + 2, end - i - 2);
+      for (char ch : body) {
+        if (ch == '\n') line++;
+      }
+      if (!body.empty() && body[0] == '*') {
+        pending_doc = body.substr(1);
+      }
+      i = end + 2;
+    } else {
+      Token token;
+      token.line = line;
+      token.doc.swap(pending_doc);
+      if (std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '$' ||
+          std::isdigit(static_cast<unsigned char>(c))) {
+        size_t start = i;
+        while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) ||
+                                     source[i] == '_' || source[i] == '$')) {
+          i++;
+        }
+        token.kind = Token::IDENT;
+        token.text = source.substr(start, i - start);
+      } else if (c == '\'' || c == '"' || c == '`') {
+        size_t start = ++i;
+        while (i < source.size() && source[i] != c) {
+          if (source[i] == '\\') i++;
+          if (i < source.size() && source[i] == '\n') line++;
+          i++;
+        }
+        token.kind = Token::STRING;
+        token.text = source.substr(start, i - start);
+        i++;
+      } else {
+        token.kind = Token::PUNCT;
+        token.text = std::string(1, c);
+        i++;
+      }
+      tokens.push_back(token);
+    }
+  }
+  Token end;
+  end.line = line;
+  tokens.push_back(end);
+  return tokens;
+}
+
+// ========== Schema ==========
+
+struct Field {
+  enum Kind { STRING, RAW, NUMBER, BOOL, ENUM } kind = STRING;
+  std::string name;      // TypeScript member name (the JSON key)
+  std::string cpp_name;  // snake_case
+  std::string enum_name;
+  std::vector<std::string> literals;
+  std::string comment;
+  bool optional = false;
+};
+
+struct Message {
+  std::string name;
+  std::vector<std::string> types;  // Values of the `type` member
+  std::vector<Field> fields;
+};
+
+std::string g_path;
+bool g_failed = false;
+
+void Error(int line, const std::string& what) {
+  std::fprintf(stderr, "%s:%d: error: %s\n", g_path.c_str(), line, what.c_str());
+  g_failed = true;
+}
+
+std::string SnakeCase(const std::string& name) {
+  static const std::set<std::string> kKeywords = {
+      "auto", "bool", "case", "char", "class", "const", "default", "delete", "do", "double",
+      "enum", "explicit", "float", "for", "if", "int", "long", "namespace", "new", "operator",
+      "private", "public", "register", "return", "short", "signed", "static", "struct", "switch",
+      "template", "this", "union", "unsigned", "using", "virtual", "void", "while"};
+  std::string out;
+  for (size_t i = 0; i < name.size(); i++) {
+    unsigned char c = static_cast<unsigned char>(name[i]);
+    if (std::isupper(c) && i > 0 && !std::isupper(static_cast<unsigned char>(name[i - 1]))) {
+      out += '_';
+    }
+    out += std::isalnum(c) ? static_cast<char>(std::tolower(c)) : '_';
+  }
+  return kKeywords.count(out) ? out + "_" : out;
+}
+
+std::string UpperSnakeCase(const std::string& text) {
+  std::string out = SnakeCase(text);
+  if (!out.empty() && out.back() == '_' && text.back() != '_') out.pop_back();
+  for (char& c : out) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+  if (out.empty() || std::isdigit(static_cast<unsigned char>(out[0]))) out = "K_" + out;
+  return out;
+}
+
+std::string PascalCase(const std::string& name) {
+  std::string out = name;
+  if (!out.empty()) out[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(out[0])));
+  return out;
+}
+
+// One line of comment text: leading '*'s and whitespace runs collapsed
+std::string CommentText(const std::string& raw) {
+  std::string out;
+  bool space = false;
+  for (size_t i = 0; i < raw.size(); i++) {
+    char c = raw[i];
+    if (c == '*' && (out.empty() || space)) continue;
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      space = !out.empty();
+      continue;
+    }
+    if (space) out += ' ';
+    space = false;
+    out += c;
+  }
+  return out;
+}
+
+// ========== Parser ==========
+
+class Parser {
+public:
+  explicit Parser(std::vector<Token> tokens) : tokens_(std::move(tokens)) {}
+
+  std::vector<Message> Run() {
+    std::vector<Message> messages;
+    while (Peek().kind != Token::END) {
+      if (Is("export") || Is("declare") || Is(";")) {
+        pos_++;
+      } else if (Is("interface")) {
+        Message message;
+        if (ParseInterface(message)) {
+          messages.push_back(message);
+        }
+      } else {
+        SkipStatement();
+      }
+    }
+    return messages;
+  }
+
+private:
+  struct Member {
+    std::vector<Token> tokens;
+  };
+
+  const Token& Peek(size_t ahead = 0) const {
+    size_t at = pos_ + ahead;
+    return at < tokens_.size() ? tokens_[at] : tokens_.back();
+  }
+  bool Is(const char* text, size_t ahead = 0) const {
+    const Token& token = Peek(ahead);
+    return token.kind != Token::STRING && token.kind != Token::END && token.text == text;
+  }
+
+  // Up to and including the ';' or the block's closing brace
+  void SkipStatement() {
+    int depth = 0;
+    while (Peek().kind != Token::END) {
+      const Token& token = tokens_[pos_++];
+      if (token.kind != Token::PUNCT) continue;
+      if (token.text == "{" || token.text == "(" || token.text == "[") depth++;
+      if (token.text == "}" || token.text == ")" || token.text == "]") {
+        if (--depth <= 0 && token.text == "}") return;
+      }
+      if (token.text == ";" && depth <= 0) return;
+    }
+  }
+
+  // interface Name [extends ...] { members }; true if it is a message
+  bool ParseInterface(Message& message) {
+    pos_++;  // interface
+    message.name = Peek().text;
+    int line = Peek().line;
+    while (Peek().kind != Token::END && !Is("{")) pos_++;
+    pos_++;  // {
+
+    std::vector<Member> members;
+    Member current;
+    int depth = 0;
+    while (Peek().kind != Token::END) {
+      const Token& token = tokens_[pos_];
+      if (depth == 0 && token.kind == Token::PUNCT && token.text == "}") {
+        pos_++;
+        break;
+      }
+      // Members end at ';' or ',', or at a line break where no union
+      // continues
+      bool line_break = !current.tokens.empty() && token.line != current.tokens.back().line &&
+                        current.tokens.back().text != "|" && token.text != "|";
+      if (depth == 0 && (line_break || (token.kind == Token::PUNCT &&
+                                        (token.text == ";" || token.text == ",")))) {
+        if (!current.tokens.empty()) members.push_back(current);
+        current = Member();
+        if (!line_break) {
+          if (!token.trailer.empty() && !members.empty()) {
+            members.back().tokens.back().trailer = token.trailer;
+          }
+          pos_++;
+        }
+        continue;
+      }
+      if (token.kind == Token::PUNCT) {
+        const std::string& p = token.text;
+        if (p == "{" || p == "(" || p == "[" || p == "<") depth++;
+        if (p == "}" || p == ")" || p == "]" || p == ">") depth--;
+      }
+      current.tokens.push_back(token);
+      pos_++;
+    }
+    if (!current.tokens.empty()) members.push_back(current);
+
+    // A message has `type: 'literal' | ...`
+    bool is_message = false;
+    for (const Member& member : members) {
+      std::vector<std::string> literals;
+      const auto& t = member.tokens;
+      if (t.size() >= 3 && t[0].text == "type" && t[0].kind == Token::IDENT && t[1].text == ":" &&
+          ParseLiterals(t, 2, literals)) {
+        is_message = true;
+        message.types = literals;
+      }
+    }
+    if (!is_message) return false;
+
+    std::set<std::string> names;
+    for (const Member& member : members) {
+      Field field;
+      if (member.tokens[0].text == "type" && member.tokens[0].kind == Token::IDENT) {
+        continue;
+      }
+      if (ParseField(message.name, member, field)) {
+        if (!names.insert(field.name).second) {
+          Error(member.tokens[0].line, message.name + "." + field.name + " declared twice");
+        }
+        if (field.kind == Field::ENUM) {
+          field.enum_name = message.name + PascalCase(field.name);
+        }
+        message.fields.push_back(field);
+      }
+    }
+    if (message.fields.size() > 31) {
+      Error(line, message.name + ": more than 31 members");
+    }
+    return true;
+  }
+
+  // 'a' | 'b' ... from `start` to the end of `tokens` (leading '|' allowed)
+  static bool ParseLiterals(const std::vector<Token>& tokens, size_t start,
+                            std::vector<std::string>& literals) {
+    size_t i = start;
+    if (i < tokens.size() && tokens[i].text == "|" && tokens[i].kind == Token::PUNCT) i++;
+    while (i < tokens.size()) {
+      if (tokens[i].kind != Token::STRING) return false;
+      literals.push_back(tokens[i].text);
+      if (++i == tokens.size()) break;
+      if (tokens[i].kind != Token::PUNCT || tokens[i].text != "|") return false;
+      i++;
+    }
+    return !literals.empty() && i == tokens.size();
+  }
+
+  bool ParseField(const std::string& owner, const Member& member, Field& field) {
+    const auto& t = member.tokens;
+    size_t i = 0;
+    if (t[i].kind == Token::IDENT && t[i].text == "readonly" && t.size() > 1 &&
+        t[1].kind == Token::IDENT) {
+      i++;
+    }
+    int line = t[i].line;
+    if (t[i].kind != Token::IDENT && t[i].kind != Token::STRING) {
+      Error(line, owner + ": unsupported member '" + t[i].text + "'");
+      return false;
+    }
+    field.name = t[i].text;
+    field.cpp_name = SnakeCase(field.name);
+    i++;
+    if (i < t.size() && t[i].text == "?" && t[i].kind == Token::PUNCT) {
+      field.optional = true;
+      i++;
+    }
+    if (i >= t.size() || t[i].text != ":") {
+      Error(line, "'" + owner + "." + field.name + "': expected ':' and a type");
+      return false;
+    }
+    i++;
+
+    std::string doc = t[0].doc;
+    bool raw = doc.find("@raw") != std::string::npos;
+    field.comment = CommentText(t.back().trailer);
+    if (field.comment.empty()) {
+      std::string text = doc;
+      size_t at = text.find("@raw");
+      if (at != std::string::npos) text.erase(at, 4);
+      field.comment = CommentText(text);
+    }
+
+    if (i + 1 == t.size() && t[i].kind == Token::IDENT) {
+      const std::string& type = t[i].text;
+      if (type == "string") {
+        field.kind = raw ? Field::RAW : Field::STRING;
+        return true;
+      }
+      if (type == "number") {
+        field.kind = Field::NUMBER;
+      } else if (type == "boolean") {
+        field.kind = Field::BOOL;
+      } else {
+        Error(line, "'" + owner + "." + field.name + "': unsupported type '" + type +
+                        "' (string, number, boolean or string literals)");
+        return false;
+      }
+    } else if (ParseLiterals(t, i, field.literals)) {
+      field.kind = Field::ENUM;
+      std::set<std::string> enumerators;
+      for (const std::string& literal : field.literals) {
+        if (!enumerators.insert(UpperSnakeCase(literal)).second) {
+          Error(line, "'" + owner + "." + field.name + "': literal '" + literal +
+                          "' clashes with another");
+        }
+      }
+    } else {
+      std::string type;
+      for (size_t j = i; j < t.size(); j++) type += t[j].text;
+      Error(line, "'" + owner + "." + field.name + "': unsupported type '" + type +
+                      "' (string, number, boolean or string literals)");
+      return false;
+    }
+    if (raw) {
+      Error(line, "'" + owner + "." + field.name + "': @raw applies to string members only");
+    }
+    return true;
+  }
+
+  std::vector<Token> tokens_;
+  size_t pos_ = 0;
+};
+
+// ========== Output ==========
+
+std::string Quote(const std::string& text) {
+  std::string out = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+std::string CppType(const Field& field) {
+  switch (field.kind) {
+    case Field::NUMBER: return "double";
+    case Field::BOOL: return "bool";
+    case Field::ENUM: return field.enum_name;
+    default: return "std::string";
+  }
+}
+
+const char* kBanner =
+    "// Generated by tools/webmessage_codegen from sdk/types/webmessage.ts.\n"
+    "// Do not edit: change the TypeScript types and rebuild.\n";
+
+std::string GenerateHeader(const std::vector<Message>& messages) {
+  std::ostringstream h;
+  h << kBanner << "\n"
+    << "#ifndef ANYWP_ENGINE_WEBMESSAGE_TYPES_H_\n"
+    << "#define ANYWP_ENGINE_WEBMESSAGE_TYPES_H_\n\n"
+    << "#include <cstddef>\n#include <iterator>\n#include <optional>\n#include <string>\n"
+    << "#include <string_view>\n\n"
+    << "#include \"utils/json_writer.h\"\n\n"
+    << "namespace anywp_engine {\nnamespace webmessage {\n";
+
+  for (const Message& message : messages) {
+    h << "\n// ========== " << message.name << " ==========\n";
+    for (const Field& field : message.fields) {
+      if (field.kind != Field::ENUM) continue;
+      const std::string table = "k" + field.enum_name + "Names";
+      h << "\nenum class " << field.enum_name << " {\n";
+      for (const std::string& literal : field.literals) {
+        h << "  " << UpperSnakeCase(literal) << ",\n";
+      }
+      h << "};\n\nconstexpr std::string_view " << table << "[] = {\n";
+      for (const std::string& literal : field.literals) {
+        h << "  " << Quote(literal) << ",\n";
+      }
+      h << "};\n\n"
+        << "constexpr std::string_view ToString(" << field.enum_name << " value) {\n"
+        << "  return " << table << "[static_cast<size_t>(value)];\n}\n\n"
+        << "constexpr bool FromString(std::string_view text, " << field.enum_name << "& value) {\n"
+        << "  for (size_t i = 0; i < std::size(" << table << "); ++i) {\n"
+        << "    if (" << table << "[i] == text) {\n"
+        << "      value = static_cast<" << field.enum_name << ">(i);\n"
+        << "      return true;\n    }\n  }\n  return false;\n}\n";
+    }
+
+    h << "\nstruct " << message.name << " {\n"
+      << "  // \"type\" values this message is sent with; Encode() writes the first\n"
+      << "  static constexpr std::string_view kTypes[] = {";
+    for (size_t i = 0; i < message.types.size(); i++) {
+      h << (i ? ", " : "") << Quote(message.types[i]);
+    }
+    h << "};\n";
+    if (!message.fields.empty()) h << "\n";
+    for (const Field& field : message.fields) {
+      std::string type = CppType(field);
+      h << "  " << (field.optional ? "std::optional<" + type + ">" : type) << " " << field.cpp_name;
+      if (!field.optional) {
+        h << (field.kind == Field::NUMBER ? " = 0" : field.kind == Field::BOOL ? " = false"
+              : field.kind == Field::ENUM ? "{}" : "");
+      }
+      h << ";";
+      std::string comment = field.comment;
+      if (field.kind == Field::RAW) {
+        comment = "JSON literal body, escapes intact" + (comment.empty() ? "" : ": " + comment);
+      }
+      if (!comment.empty()) h << "  // " << comment;
+      h << "\n";
+    }
+    h << "};\n\n"
+      << "bool Decode(std::string_view json, " << message.name << "& message);\n"
+      << "void Encode(const " << message.name << "& message, JsonWriter& writer);\n"
+      << "void Encode(const " << message.name << "& message, WideJsonWriter& writer);\n";
+  }
+
+  h << "\n}  // namespace webmessage\n}  // namespace anywp_engine\n\n"
+    << "#endif  // ANYWP_ENGINE_WEBMESSAGE_TYPES_H_\n";
+  return h.str();
+}
+
+const char* kSourcePrelude = R"(
+#include "webmessage_types.h"
+
+#include <cstdint>
+
+#include "utils/json_reader.h"
+#include "utils/json_structural_index.h"
+
+namespace anywp_engine {
+namespace webmessage {
+
+namespace {
+
+using Token = JsonReader::Token;
+
+// Readers for the value just reached; false if it has the wrong JSON type
+
+bool Read(JsonReader& reader, Token token, std::string& value) {
+  return token == Token::STRING && reader.GetString(value);
+}
+)";
+
+// Only emitted when a @raw member uses it (-Wunused-function otherwise)
+const char* kSourceReadRaw = R"(
+bool ReadRaw(JsonReader& reader, Token token, std::string& value) {
+  if (token != Token::STRING) {
+    return false;
+  }
+  value.assign(reader.Text().data(), reader.Text().size());
+  return true;
+}
+)";
+
+const char* kSourceReaders = R"(
+bool Read(JsonReader& reader, Token token, double& value) {
+  return token == Token::NUMBER && reader.GetDouble(value);
+}
+
+bool Read(JsonReader&, Token token, bool& value) {
+  if (token != Token::TRUE_VALUE && token != Token::FALSE_VALUE) {
+    return false;
+  }
+  value = token == Token::TRUE_VALUE;
+  return true;
+}
+
+template <typename Enum, size_t N>
+bool ReadEnum(JsonReader& reader, Token token, const std::string_view (&names)[N], Enum& value) {
+  if (token != Token::STRING) {
+    return false;
+  }
+  for (size_t i = 0; i < N; ++i) {
+    if (reader.TextEquals(names[i])) {
+      value = static_cast<Enum>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+template <size_t N>
+bool ReadType(JsonReader& reader, Token token, const std::string_view (&types)[N]) {
+  if (token != Token::STRING) {
+    return false;
+  }
+  for (size_t i = 0; i < N; ++i) {
+    if (reader.TextEquals(types[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// A member this schema does not know
+bool Skip(JsonReader& reader) {
+  reader.Next();
+  return reader.SkipValue();
+}
+
+bool Finish(JsonReader& reader) {
+  return reader.Current() == Token::END_OBJECT && reader.Next() == Token::END;
+}
+
+// A @raw member goes back out decoded and re-escaped: the same string
+template <typename Writer>
+void WriteRaw(Writer& writer, const std::string& body) {
+  std::string decoded;
+  writer.String(JsonReader::Unescape(body, decoded) ? decoded : body);
+}
+
+}  // namespace
+)";
+
+std::string GenerateSource(const std::vector<Message>& messages) {
+  std::ostringstream s;
+  bool has_raw = std::any_of(messages.begin(), messages.end(), [](const Message& message) {
+    return std::any_of(message.fields.begin(), message.fields.end(),
+                       [](const Field& field) { return field.kind == Field::RAW; });
+  });
+  s << kBanner << kSourcePrelude << (has_raw ? kSourceReadRaw : "") << kSourceReaders;
+
+  for (const Message& message : messages) {
+    const std::string& name = message.name;
+    uint32_t required = 1;  // Bit 0: "type"
+    s << "\n// ========== " << name << " ==========\n\n"
+      << "bool Decode(std::string_view json, " << name
+      << (message.fields.empty() ? "&" : "& message") << ") {\n";
+    // Reset member by member: strings keep their capacity across messages
+    for (const Field& field : message.fields) {
+      s << "  message." << field.cpp_name;
+      if (field.optional) {
+        s << ".reset();\n";
+      } else if (field.kind == Field::STRING || field.kind == Field::RAW) {
+        s << ".clear();\n";
+      } else {
+        s << (field.kind == Field::NUMBER ? " = 0;\n" : field.kind == Field::BOOL ? " = false;\n"
+                                                                                    : " = {};\n");
+      }
+    }
+    s << "  JsonReader reader(json, JsonStructuralIndex::ForThread(json));\n"
+      << "  uint32_t seen = 0;\n"
+      << "  if (reader.Next() != Token::BEGIN_OBJECT) {\n    return false;\n  }\n"
+      << "  while (reader.Next() == Token::KEY) {\n"
+      << "    if (reader.TextEquals(\"type\")) {\n"
+      << "      if (!ReadType(reader, reader.Next(), " << name << "::kTypes)) {\n"
+      << "        return false;\n      }\n"
+      << "      seen |= 1u;\n";
+    for (size_t i = 0; i < message.fields.size(); i++) {
+      const Field& field = message.fields[i];
+      std::string read;
+      std::string target = field.optional ? "message." + field.cpp_name + ".emplace()"
+                                          : "message." + field.cpp_name;
+      if (field.kind == Field::ENUM) {
+        read = "ReadEnum(reader, token, k" + field.enum_name + "Names, " + target + ")";
+      } else {
+        read = std::string(field.kind == Field::RAW ? "ReadRaw" : "Read") + "(reader, token, " +
+               target + ")";
+      }
+      s << "    } else if (reader.TextEquals(" << Quote(field.name) << ")) {\n"
+        << "      Token token = reader.Next();\n";
+      if (field.optional) {
+        s << "      if (token == Token::NULL_VALUE) {\n"
+          << "        message." << field.cpp_name << ".reset();\n"
+          << "      } else if (!" << read << ") {\n"
+          << "        return false;\n      }\n";
+      } else {
+        uint32_t bit = 1u << (i + 1);
+        required |= bit;
+        s << "      if (!" << read << ") {\n        return false;\n      }\n"
+          << "      seen |= " << bit << "u;\n";
+      }
+    }
+    s << "    } else if (!Skip(reader)) {\n      return false;\n    }\n  }\n"
+      << "  return Finish(reader) && (seen & " << required << "u) == " << required << "u;\n}\n\n";
+
+    s << "template <typename Writer>\n"
+      << "void Write(const " << name << (message.fields.empty() ? "&" : "& message")
+      << ", Writer& writer) {\n"
+      << "  writer.BeginObject();\n"
+      << "  writer.Key(\"type\").String(" << name << "::kTypes[0]);\n";
+    for (const Field& field : message.fields) {
+      std::string value = (field.optional ? "*message." : "message.") + field.cpp_name;
+      std::string indent = field.optional ? "    " : "  ";
+      if (field.optional) s << "  if (message." << field.cpp_name << ") {\n";
+      s << indent << "writer.Key(" << Quote(field.name) << ")";
+      switch (field.kind) {
+        case Field::STRING: s << ".String(" << value << ");\n"; break;
+        case Field::RAW: s << ";\n" << indent << "WriteRaw(writer, " << value << ");\n"; break;
+        case Field::NUMBER: s << ".Double(" << value << ");\n"; break;
+        case Field::BOOL: s << ".Bool(" << value << ");\n"; break;
+        case Field::ENUM: s << ".String(ToString(" << value << "));\n"; break;
+      }
+      if (field.optional) s << "  }\n";
+    }
+    s << "  writer.EndObject();\n}\n\n"
+      << "void Encode(const " << name << "& message, JsonWriter& writer) {\n"
+      << "  Write(message, writer);\n}\n\n"
+      << "void Encode(const " << name << "& message, WideJsonWriter& writer) {\n"
+      << "  Write(message, writer);\n}\n";
+  }
+
+  s << "\n}  // namespace webmessage\n}  // namespace anywp_engine\n";
+  return s.str();
+}
+
+bool WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << content;
+  return static_cast<bool>(file);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::fprintf(stderr, "Usage: %s <webmessage.ts> <output-dir>\n", argv[0]);
+    return 2;
+  }
+  g_path = argv[1];
+  std::ifstream input(g_path, std::ios::binary);
+  if (!input) {
+    std::fprintf(stderr, "%s: error: cannot read\n", g_path.c_str());
+    return 1;
+  }
+  std::string source((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+  Parser parser(Tokenize(source));
+  std::vector<Message> messages = parser.Run();
+  std::set<std::string> names;
+  for (const Message& message : messages) {
+    if (!names.insert(message.name).second) {
+      Error(0, "message " + message.name + " declared twice");
+    }
+  }
+  if (messages.empty()) {
+    Error(0, "no message interfaces (an interface with a literal 'type' member)");
+  }
+  if (g_failed) {
+    return 1;
+  }
+
+  std::string directory = argv[2];
+  if (!WriteFile(directory + "/webmessage_types.h", GenerateHeader(messages)) ||
+      !WriteFile(directory + "/webmessage_types.cpp", GenerateSource(messages))) {
+    std::fprintf(stderr, "%s: error: cannot write\n", directory.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,434 @@
+#include "config_json.h"
+
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+namespace anywp_engine {
+
+namespace {
+
+// Deeper nesting is rejected rather than risking the stack
+constexpr int kMaxDepth = 32;
+
+class Reader {
+public:
+  Reader(std::istream& input, ConfigJson::Values& out)
+      : buffer_(input.rdbuf()), out_(out) {}
+
+  bool Run() {
+    SkipWhitespace();
+    if (!ParseObject("", 0)) {
+      return false;
+    }
+    SkipWhitespace();
+    if (Peek() != EOF) {
+      return Fail("unexpected data after the top-level object");
+    }
+    return true;
+  }
+
+  // A lone string literal; used by ConfigJson::Unquote()
+  bool RunString(std::string& text) {
+    if (Peek() != '"' || !ParseString(text)) {
+      return Fail("expected a string");
+    }
+    if (Peek() != EOF) {
+      return Fail("unexpected data after the string");
+    }
+    return true;
+  }
+
+  const std::string& Error() const { return error_; }
+
+private:
+  int Peek() {
+    return buffer_ ? buffer_->sgetc() : EOF;
+  }
+
+  int Next() {
+    int c = buffer_ ? buffer_->sbumpc() : EOF;
+    if (c == '\n') {
+      line_++;
+      column_ = 1;
+    } else if (c != EOF) {
+      column_++;
+    }
+    return c;
+  }
+
+  bool Fail(const std::string& message) {
+    if (error_.empty()) {
+      error_ = std::to_string(line_) + ":" + std::to_string(column_) + ": " + message;
+    }
+    return false;
+  }
+
+  bool Expect(char expected) {
+    if (Next() != expected) {
+      return Fail(std::string("expected '") + expected + "'");
+    }
+    return true;
+  }
+
+  void SkipWhitespace() {
+    int c = Peek();
+    while (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      Next();
+      c = Peek();
+    }
+  }
+
+  bool ParseObject(const std::string& prefix, int depth) {
+    if (depth >= kMaxDepth) {
+      return Fail("nesting too deep");
+    }
+    if (!Expect('{')) {
+      return false;
+    }
+    SkipWhitespace();
+    if (Peek() == '}') {
+      Next();
+      return true;
+    }
+
+    while (true) {
+      SkipWhitespace();
+      std::string key;
+      if (Peek() != '"') {
+        return Fail("expected a key");
+      }
+      if (!ParseString(key)) {
+        return false;
+      }
+      SkipWhitespace();
+      if (!Expect(':')) {
+        return false;
+      }
+      SkipWhitespace();
+
+      std::string full_key = prefix + key;
+      if (Peek() == '{') {
+        if (!ParseObject(full_key + ".", depth + 1)) {
+          return false;
+        }
+      } else if (Peek() == '[') {
+        std::vector<std::string> items;
+        if (!ParseArray(items)) {
+          return false;
+        }
+        out_[full_key] = ConfigValue(items);
+      } else {
+        ConfigValue value;
+        if (!ParseScalar(value)) {
+          return false;
+        }
+        if (!value.IsEmpty()) {
+          out_[full_key] = value;
+        }
+      }
+
+      SkipWhitespace();
+      int c = Next();
+      if (c == '}') {
+        return true;
+      }
+      if (c != ',') {
+        return Fail("expected ',' or '}'");
+      }
+    }
+  }
+
+  // Arrays hold scalars; each element is kept as its text
+  bool ParseArray(std::vector<std::string>& items) {
+    Next();  // '['
+    SkipWhitespace();
+    if (Peek() == ']') {
+      Next();
+      return true;
+    }
+    while (true) {
+      SkipWhitespace();
+      std::string item;
+      int c = Peek();
+      if (c == '"') {
+        if (!ParseString(item)) {
+          return false;
+        }
+      } else if (c == '{' || c == '[') {
+        return Fail("nested arrays and objects are not supported in arrays");
+      } else {
+        if (!ParseBareToken(item)) {
+          return false;
+        }
+      }
+      items.push_back(std::move(item));
+
+      SkipWhitespace();
+      c = Next();
+      if (c == ']') {
+        return true;
+      }
+      if (c != ',') {
+        return Fail("expected ',' or ']'");
+      }
+    }
+  }
+
+  bool ParseScalar(ConfigValue& value) {
+    if (Peek() == '"') {
+      std::string text;
+      if (!ParseString(text)) {
+        return false;
+      }
+      value = ConfigValue(text);
+      return true;
+    }
+
+    std::string token;
+    if (!ParseBareToken(token)) {
+      return false;
+    }
+    if (token == "true" || token == "false") {
+      value = ConfigValue(token == "true");
+      return true;
+    }
+    if (token == "null") {
+      value = ConfigValue();
+      return true;
+    }
+
+    // A JSON number: integer when it fits, double otherwise
+    const char* begin = token.c_str();
+    char* end = nullptr;
+    errno = 0;
+    long long integer = std::strtoll(begin, &end, 10);
+    if (*end == '\0' && errno == 0 && integer >= INT_MIN && integer <= INT_MAX) {
+      value = ConfigValue(static_cast<int>(integer));
+      return true;
+    }
+    errno = 0;
+    double number = std::strtod(begin, &end);
+    if (*end != '\0' || errno != 0) {
+      return Fail("invalid value '" + token + "'");
+    }
+    value = ConfigValue(number);
+    return true;
+  }
+
+  // Literal or number: everything up to the next delimiter
+  bool ParseBareToken(std::string& token) {
+    int c = Peek();
+    while (c != EOF && c != ',' && c != '}' && c != ']' &&
+           c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+      token.push_back(static_cast<char>(Next()));
+      c = Peek();
+    }
+    if (token.empty()) {
+      return Fail("expected a value");
+    }
+    if (token != "true" && token != "false" && token != "null" &&
+        token.find_first_not_of("+-0123456789.eE") != std::string::npos) {
+      return Fail("invalid value '" + token + "'");
+    }
+    return true;
+  }
+
+  bool ParseString(std::string& text) {
+    Next();  // Opening quote
+    while (true) {
+      int c = Next();
+      if (c == EOF) {
+        return Fail("unterminated string");
+      }
+      if (c == '"') {
+        return true;
+      }
+      if (static_cast<unsigned char>(c) < 0x20) {
+        return Fail("control character in string");
+      }
+      if (c != '\\') {
+        text.push_back(static_cast<char>(c));
+        continue;
+      }
+
+      c = Next();
+      switch (c) {
+        case '"':  text.push_back('"'); break;
+        case '\\': text.push_back('\\'); break;
+        case '/':  text.push_back('/'); break;
+        case 'b':  text.push_back('\b'); break;
+        case 'f':  text.push_back('\f'); break;
+        case 'n':  text.push_back('\n'); break;
+        case 'r':  text.push_back('\r'); break;
+        case 't':  text.push_back('\t'); break;
+        case 'u':
+          if (!ParseUnicodeEscape(text)) {
+            return false;
+          }
+          break;
+        default:
+          return Fail("invalid escape");
+      }
+    }
+  }
+
+  bool ParseHex4(uint32_t& code) {
+    code = 0;
+    for (int i = 0; i < 4; i++) {
+      int c = Next();
+      code <<= 4;
+      if (c >= '0' && c <= '9') {
+        code |= static_cast<uint32_t>(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        code |= static_cast<uint32_t>(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        code |= static_cast<uint32_t>(c - 'A' + 10);
+      } else {
+        return Fail("invalid \\u escape");
+      }
+    }
+    return true;
+  }
+
+  bool ParseUnicodeEscape(std::string& text) {
+    uint32_t code;
+    if (!ParseHex4(code)) {
+      return false;
+    }
+    if (code >= 0xD800 && code <= 0xDBFF) {
+      // High surrogate: the low half must follow
+      uint32_t low;
+      if (Next() != '\\' || Next() != 'u' || !ParseHex4(low) || low < 0xDC00 || low > 0xDFFF) {
+        return Fail("unpaired surrogate in \\u escape");
+      }
+      code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    } else if (code >= 0xDC00 && code <= 0xDFFF) {
+      return Fail("unpaired surrogate in \\u escape");
+    }
+
+    if (code < 0x80) {
+      text.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+      text.push_back(static_cast<char>(0xC0 | (code >> 6)));
+      text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+      text.push_back(static_cast<char>(0xE0 | (code >> 12)));
+      text.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+      text.push_back(static_cast<char>(0xF0 | (code >> 18)));
+      text.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+      text.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+    return true;
+  }
+
+  std::streambuf* buffer_;
+  ConfigJson::Values& out_;
+  std::string error_;
+  size_t line_ = 1;
+  size_t column_ = 1;
+};
+
+}  // namespace
+
+bool ConfigJson::Parse(std::istream& input, Values& out, std::string* error) {
+  Reader reader(input, out);
+  if (!reader.Run()) {
+    if (error) {
+      *error = reader.Error();
+    }
+    return false;
+  }
+  return true;
+}
+
+void ConfigJson::Write(std::ostream& output, const Values& values) {
+  output << "{\n";
+  bool first = true;
+  for (const auto& pair : values) {
+    if (!first) {
+      output << ",\n";
+    }
+    first = false;
+    output << "  " << Quote(pair.first) << ": ";
+
+    const ConfigValue& value = pair.second;
+    bool bool_value;
+    int int_value;
+    double double_value;
+    std::string string_value;
+    std::vector<std::string> list_value;
+    if (value.TryGet(bool_value)) {
+      output << (bool_value ? "true" : "false");
+    } else if (value.TryGet(int_value)) {
+      output << int_value;
+    } else if (value.TryGet(double_value) && std::isfinite(double_value)) {
+      char buffer[32];
+      std::snprintf(buffer, sizeof(buffer), "%.17g", double_value);
+      std::string text(buffer);
+      if (text.find_first_of(".eE") == std::string::npos) {
+        text += ".0";  // Keep it a double on the way back in
+      }
+      output << text;
+    } else if (value.TryGet(string_value)) {
+      output << Quote(string_value);
+    } else if (value.TryGet(list_value)) {
+      output << "[";
+      for (size_t i = 0; i < list_value.size(); i++) {
+        output << (i ? ", " : "") << Quote(list_value[i]);
+      }
+      output << "]";
+    } else {
+      output << "null";
+    }
+  }
+  output << "\n}\n";
+}
+
+std::string ConfigJson::Quote(const std::string& value) {
+  std::string quoted;
+  quoted.reserve(value.size() + 2);
+  quoted.push_back('"');
+  for (char ch : value) {
+    unsigned char c = static_cast<unsigned char>(ch);
+    switch (c) {
+      case '"':  quoted += "\\\""; break;
+      case '\\': quoted += "\\\\"; break;
+      case '\b': quoted += "\\b"; break;
+      case '\f': quoted += "\\f"; break;
+      case '\n': quoted += "\\n"; break;
+      case '\r': quoted += "\\r"; break;
+      case '\t': quoted += "\\t"; break;
+      default:
+        if (c < 0x20) {
+          char escape[7];
+          std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+          quoted += escape;
+        } else {
+          quoted.push_back(ch);  // UTF-8 passes through
+        }
+    }
+  }
+  quoted.push_back('"');
+  return quoted;
+}
+
+bool ConfigJson::Unquote(const std::string& literal, std::string& value) {
+  std::istringstream input(literal);
+  ConfigJson::Values unused;
+  Reader reader(input, unused);
+  value.clear();
+  return reader.RunString(value);
+}
+
+}  // namespace anywp_engine
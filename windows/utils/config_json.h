@@ -0,0 +1,52 @@
+#ifndef ANYWP_ENGINE_CONFIG_JSON_H_
+#define ANYWP_ENGINE_CONFIG_JSON_H_
+
+#include <iosfwd>
+#include <map>
+#include <string>
+
+#include "config_manager.h"
+
+namespace anywp_engine {
+
+/**
+ * ConfigJson - Single-pass JSON reader and writer for ConfigManager files
+ *
+ * The reader pulls characters straight from the stream and emits flat
+ * configuration keys as it goes; no document tree is built. Nested objects
+ * are flattened to dotted keys, so both of these set "log.level":
+ *   { "log": { "level": "DEBUG" } }
+ *   { "log.level": "DEBUG" }
+ *
+ * Value mapping:
+ * - true/false                    -> bool
+ * - integers that fit in an int   -> int (other numbers -> double)
+ * - strings (all escapes, \uXXXX) -> std::string (UTF-8)
+ * - arrays of scalars             -> std::vector<std::string>
+ * - null                          -> key is skipped
+ *
+ * The writer emits one flat, sorted object with every string escaped, so
+ * Write() followed by Parse() gives back the same values.
+ *
+ * Thread-safe: Yes (stateless)
+ */
+class ConfigJson {
+public:
+  using Values = std::map<std::string, ConfigValue>;
+
+  // Parse one JSON object from `input` into `out` (existing keys are
+  // overwritten). On failure `error` gets "line:column: message".
+  static bool Parse(std::istream& input, Values& out, std::string* error = nullptr);
+
+  static void Write(std::ostream& output, const Values& values);
+
+  // `value` as a JSON string literal, quotes included
+  static std::string Quote(const std::string& value);
+
+  // Inverse of Quote(): decode one complete JSON string literal
+  static bool Unquote(const std::string& literal, std::string& value);
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_CONFIG_JSON_H_
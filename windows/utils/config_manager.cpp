@@ -1,13 +1,188 @@
 #include "config_manager.h"
+#include "config_json.h"
+#include "config_watcher.h"
 #include "logger.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
 #include <cstdlib>
 #include <cstring>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+extern char** environ;
+#endif
+
 namespace anywp_engine {
 
+namespace {
+
+constexpr const char kEnvironmentPrefix[] = "ANYWP_";
+
+template <typename T>
+bool SameValue(const ConfigValue& a, const ConfigValue& b, bool& equal) {
+  T left;
+  if (!a.TryGet(left)) {
+    return false;
+  }
+  T right;
+  equal = b.TryGet(right) && left == right;
+  return true;
+}
+
+// ANYWP_* variables as (name without prefix, value)
+std::vector<std::pair<std::string, std::string>> PrefixedEnvironment() {
+  std::vector<std::pair<std::string, std::string>> variables;
+  const size_t prefix_length = sizeof(kEnvironmentPrefix) - 1;
+  auto add = [&](const std::string& entry) {
+    size_t equals = entry.find('=');
+    if (equals != std::string::npos && equals > prefix_length &&
+        entry.compare(0, prefix_length, kEnvironmentPrefix) == 0) {
+      variables.emplace_back(entry.substr(prefix_length, equals - prefix_length),
+                             entry.substr(equals + 1));
+    }
+  };
+
+#ifdef _WIN32
+  // Wide block: the narrow CRT copy is not populated for wWinMain programs
+  wchar_t* block = GetEnvironmentStringsW();
+  if (!block) {
+    return variables;
+  }
+  for (const wchar_t* entry = block; *entry; entry += wcslen(entry) + 1) {
+    int size = WideCharToMultiByte(CP_UTF8, 0, entry, -1, nullptr, 0, nullptr, nullptr);
+    if (size <= 1) {
+      continue;
+    }
+    std::string utf8(static_cast<size_t>(size - 1), '\0');
+    WideCharToMultiByte(CP_UTF8, 0, entry, -1, &utf8[0], size, nullptr, nullptr);
+    add(utf8);
+  }
+  FreeEnvironmentStringsW(block);
+#else
+  for (char** entry = environ; entry && *entry; entry++) {
+    add(*entry);
+  }
+#endif
+  return variables;
+}
+
+// LOG_LEVEL -> "log.level"; A__B_C -> "a.b_c"
+std::string EnvironmentKey(const std::string& name) {
+  std::string key;
+  key.reserve(name.size());
+  for (char c : name) {
+    key.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+  }
+  size_t separator = key.find("__");
+  if (separator == std::string::npos) {
+    separator = key.find('_');
+    if (separator != std::string::npos) {
+      key[separator] = '.';
+    }
+    return key;
+  }
+  while (separator != std::string::npos) {
+    key.replace(separator, 2, ".");
+    separator = key.find("__", separator + 1);
+  }
+  return key;
+}
+
+bool ParseBool(std::string text, bool& value) {
+  for (char& c : text) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  if (text == "1" || text == "true" || text == "yes" || text == "on") {
+    value = true;
+    return true;
+  }
+  if (text == "0" || text == "false" || text == "no" || text == "off") {
+    value = false;
+    return true;
+  }
+  return false;
+}
+
+bool ParseInt(const std::string& text, int& value) {
+  if (text.empty()) {
+    return false;
+  }
+  char* end = nullptr;
+  errno = 0;
+  long long parsed = std::strtoll(text.c_str(), &end, 10);
+  if (*end != '\0' || errno != 0 || parsed < INT_MIN || parsed > INT_MAX) {
+    return false;
+  }
+  value = static_cast<int>(parsed);
+  return true;
+}
+
+// Environment text as a value of the same type as `current`
+ConfigValue EnvironmentValue(const std::string& text, const ConfigValue* current) {
+  bool bool_value;
+  int int_value;
+  if (current && !current->IsEmpty()) {
+    if (current->TryGet(bool_value)) {
+      return ParseBool(text, bool_value) ? ConfigValue(bool_value) : ConfigValue();
+    }
+    if (current->TryGet(int_value)) {
+      return ParseInt(text, int_value) ? ConfigValue(int_value) : ConfigValue();
+    }
+    double double_value;
+    if (current->TryGet(double_value)) {
+      char* end = nullptr;
+      double_value = std::strtod(text.c_str(), &end);
+      return !text.empty() && *end == '\0' ? ConfigValue(double_value) : ConfigValue();
+    }
+    std::vector<std::string> list_value;
+    if (current->TryGet(list_value)) {
+      std::vector<std::string> items;
+      std::stringstream stream(text);
+      std::string item;
+      while (std::getline(stream, item, ',')) {
+        items.push_back(item);
+      }
+      return ConfigValue(items);
+    }
+    return ConfigValue(text);
+  }
+
+  // Unknown key: infer the type
+  std::string lowered = text;
+  for (char& c : lowered) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  if (lowered == "true" || lowered == "false") {
+    return ConfigValue(lowered == "true");
+  }
+  if (ParseInt(text, int_value)) {
+    return ConfigValue(int_value);
+  }
+  return ConfigValue(text);
+}
+
+}  // namespace
+
+bool ConfigValue::operator==(const ConfigValue& other) const {
+  if (IsEmpty() || other.IsEmpty()) {
+    return IsEmpty() && other.IsEmpty();
+  }
+  bool equal = false;
+  if (SameValue<bool>(*this, other, equal) ||
+      SameValue<int>(*this, other, equal) ||
+      SameValue<double>(*this, other, equal) ||
+      SameValue<std::string>(*this, other, equal) ||
+      SameValue<std::vector<std::string>>(*this, other, equal)) {
+    return equal;
+  }
+  return false;
+}
+
 ConfigManager& ConfigManager::Instance() {
   static ConfigManager instance;
   return instance;
@@ -16,41 +191,51 @@ ConfigManager& ConfigManager::Instance() {
 ConfigManager::ConfigManager()
     : next_subscription_id_(1),
       current_profile_("default") {
-  LoadDefaults();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadDefaults();
+  }
   Logger::Instance().Info("ConfigManager", "ConfigManager initialized with profile: " + current_profile_);
 }
 
 ConfigManager::~ConfigManager() {
-  // Nothing to clean up
+  DisableHotReload();
 }
 
 void ConfigManager::LoadDefaults() {
+  defaults_.clear();
+  
   // WebView defaults
-  Set("webview.cache_enabled", true);
-  Set("webview.max_cache_size_mb", 100);
-  Set("webview.hardware_acceleration", true);
+  defaults_["webview.cache_enabled"] = ConfigValue(true);
+  defaults_["webview.max_cache_size_mb"] = ConfigValue(100);
+  defaults_["webview.hardware_acceleration"] = ConfigValue(true);
   
   // Logging defaults
-  Set("log.level", std::string("INFO"));
-  Set("log.file_enabled", false);
-  Set("log.file_path", std::string("anywp_engine.log"));
-  Set("log.max_file_size_mb", 10);
-  Set("log.rotation_enabled", false);
-  Set("log.buffering_enabled", false);
-  Set("log.buffer_size", 100);
+  defaults_["log.level"] = ConfigValue(std::string("INFO"));
+  defaults_["log.file_enabled"] = ConfigValue(false);
+  defaults_["log.file_path"] = ConfigValue(std::string("anywp_engine.log"));
+  defaults_["log.max_file_size_mb"] = ConfigValue(10);
+  defaults_["log.rotation_enabled"] = ConfigValue(false);
+  defaults_["log.buffering_enabled"] = ConfigValue(false);
+  defaults_["log.buffer_size"] = ConfigValue(100);
   
   // Performance defaults
-  Set("performance.cpu_profiling", false);
-  Set("performance.memory_profiling", false);
-  Set("performance.benchmark_enabled", false);
+  defaults_["performance.cpu_profiling"] = ConfigValue(false);
+  defaults_["performance.memory_profiling"] = ConfigValue(false);
+  defaults_["performance.benchmark_enabled"] = ConfigValue(false);
   
   // Power defaults
-  Set("power.optimization_enabled", true);
-  Set("power.auto_pause_when_hidden", false);
+  defaults_["power.optimization_enabled"] = ConfigValue(true);
+  defaults_["power.auto_pause_when_hidden"] = ConfigValue(false);
   
   // Security defaults
-  Set("security.https_only", false);
-  Set("security.permission_policy", std::string("default"));
+  defaults_["security.https_only"] = ConfigValue(false);
+  defaults_["security.permission_policy"] = ConfigValue(std::string("default"));
+  
+  for (const auto& pair : defaults_) {
+    config_[pair.first] = pair.second;
+  }
+  PublishSnapshot();
   
   Logger::Instance().Debug("ConfigManager", "Default configuration loaded");
 }
@@ -60,16 +245,120 @@ bool ConfigManager::Has(const std::string& key) const {
   return config_.find(key) != config_.end();
 }
 
+void ConfigManager::SetValue(const std::string& key, ConfigValue value) {
+  std::vector<Notification> notifications;
+  std::vector<ChangeSetCallback> listeners;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (IsOverridden(key)) {
+      return;
+    }
+    config_[key] = std::move(value);
+    if (slots_.find(key) != slots_.end()) {
+      PublishSnapshot();
+    }
+    notifications.push_back(PrepareNotification(key));
+    listeners = ChangeSetListeners();
+  }
+  Notify(notifications, listeners);
+}
+
+bool ConfigManager::IsOverridden(const std::string& key) const {
+  if (env_overrides_.find(key) == env_overrides_.end()) {
+    return false;
+  }
+  Logger::Instance().Debug("ConfigManager", 
+    "Ignoring change to '" + key + "': set by the environment");
+  return true;
+}
+
 void ConfigManager::Remove(const std::string& key) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  config_.erase(key);
+  std::vector<Notification> notifications;
+  std::vector<ChangeSetCallback> listeners;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (IsOverridden(key) || !config_.erase(key)) {
+      return;
+    }
+    if (slots_.find(key) != slots_.end()) {
+      PublishSnapshot();
+    }
+    notifications.push_back(PrepareNotification(key));
+    listeners = ChangeSetListeners();
+  }
+  Notify(notifications, listeners);
   Logger::Instance().Debug("ConfigManager", "Removed configuration key: " + key);
 }
 
+ConfigTransaction ConfigManager::BeginTransaction() {
+  return ConfigTransaction(*this);
+}
+
+bool ConfigTransaction::Commit() {
+  if (!manager_->CommitTransaction(staged_)) {
+    return false;
+  }
+  staged_.clear();
+  return true;
+}
+
+bool ConfigManager::CommitTransaction(const ChangeSet& staged) {
+  std::vector<Notification> notifications;
+  std::vector<ChangeSetCallback> listeners;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& pair : staged) {
+      auto validator = validators_.find(pair.first);
+      if (!pair.second.IsEmpty() && validator != validators_.end() &&
+          !validator->second(pair.second)) {
+        Logger::Instance().Error("ConfigManager", 
+          "Transaction rejected, validation failed for configuration key: " + pair.first);
+        return false;
+      }
+    }
+    
+    for (const auto& pair : staged) {
+      if (IsOverridden(pair.first)) {
+        continue;
+      }
+      auto current = config_.find(pair.first);
+      if (pair.second.IsEmpty()) {
+        if (current == config_.end()) {
+          continue;
+        }
+        config_.erase(current);
+      } else if (current == config_.end()) {
+        config_.emplace(pair.first, pair.second);
+      } else if (current->second != pair.second) {
+        current->second = pair.second;
+      } else {
+        continue;  // Already that value: nothing to report
+      }
+      notifications.push_back(PrepareNotification(pair.first));
+    }
+    
+    if (!notifications.empty()) {
+      PublishSnapshot();
+      listeners = ChangeSetListeners();
+    }
+  }
+  Notify(notifications, listeners);
+  
+  Logger::Instance().Debug("ConfigManager", 
+    "Transaction committed: " + std::to_string(notifications.size()) + " of " +
+    std::to_string(staged.size()) + " keys changed");
+  return true;
+}
+
 void ConfigManager::Clear() {
+  DisableHotReload();
+  
   std::lock_guard<std::mutex> lock(mutex_);
   config_.clear();
+  file_values_.clear();
+  env_overrides_.clear();
   subscriptions_.clear();
+  change_set_subscriptions_.clear();
   validators_.clear();
   LoadDefaults();
   Logger::Instance().Info("ConfigManager", "Configuration cleared and reset to defaults");
@@ -107,6 +396,18 @@ int ConfigManager::Subscribe(const std::string& key,
   return subscription_id;
 }
 
+int ConfigManager::SubscribeChanges(ChangeSetCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  
+  int subscription_id = next_subscription_id_++;
+  change_set_subscriptions_.push_back({subscription_id, std::move(callback)});
+  
+  Logger::Instance().Debug("ConfigManager", 
+    "Subscribed to config change sets (ID: " + std::to_string(subscription_id) + ")");
+  
+  return subscription_id;
+}
+
 void ConfigManager::Unsubscribe(int subscription_id) {
   std::lock_guard<std::mutex> lock(mutex_);
   
@@ -115,81 +416,119 @@ void ConfigManager::Unsubscribe(int subscription_id) {
       [subscription_id](const Subscription& s) { return s.id == subscription_id; }),
     subscriptions_.end()
   );
+  change_set_subscriptions_.erase(
+    std::remove_if(change_set_subscriptions_.begin(), change_set_subscriptions_.end(),
+      [subscription_id](const ChangeSetSubscription& s) { return s.id == subscription_id; }),
+    change_set_subscriptions_.end()
+  );
   
   Logger::Instance().Debug("ConfigManager", 
     "Unsubscribed from config changes (ID: " + std::to_string(subscription_id) + ")");
 }
 
-void ConfigManager::NotifySubscribers(const std::string& key) {
-  // Get current value
+int ConfigManager::ResolveSlot(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = slots_.find(key);
+  if (it != slots_.end()) {
+    return it->second;
+  }
+  int slot = static_cast<int>(slot_keys_.size());
+  slots_.emplace(key, slot);
+  slot_keys_.push_back(key);
+  PublishSnapshot();
+  return slot;
+}
+
+void ConfigManager::PublishSnapshot() {
+  // A few dozen keys at most, and config changes are rare: rebuild it whole
+  auto snapshot = std::make_unique<Snapshot>();
+  snapshot->slots.reserve(slot_keys_.size());
+  for (const std::string& key : slot_keys_) {
+    auto it = config_.find(key);
+    snapshot->slots.push_back(it != config_.end() ? it->second : ConfigValue());
+  }
+  snapshot_.Store(std::move(snapshot));
+}
+
+ConfigManager::Notification ConfigManager::PrepareNotification(const std::string& key) const {
+  Notification notification;
+  notification.key = key;
   auto it = config_.find(key);
-  if (it == config_.end()) {
-    return;
+  if (it != config_.end()) {
+    notification.value = it->second;
   }
-  
-  ConfigValue value = it->second;
-  
-  // Find matching subscriptions
-  std::vector<std::function<void(const ConfigValue&)>> callbacks;
   for (const auto& sub : subscriptions_) {
     if (sub.key == key) {
-      callbacks.push_back(sub.callback);
+      notification.callbacks.push_back(sub.callback);
+    }
+  }
+  return notification;
+}
+
+std::vector<ConfigManager::ChangeSetCallback> ConfigManager::ChangeSetListeners() const {
+  std::vector<ChangeSetCallback> listeners;
+  listeners.reserve(change_set_subscriptions_.size());
+  for (const auto& sub : change_set_subscriptions_) {
+    listeners.push_back(sub.callback);
+  }
+  return listeners;
+}
+
+void ConfigManager::Notify(const std::vector<Notification>& notifications,
+                           const std::vector<ChangeSetCallback>& listeners) const {
+  for (const auto& notification : notifications) {
+    for (const auto& callback : notification.callbacks) {
+      try {
+        callback(notification.value);
+      } catch (const std::exception& e) {
+        Logger::Instance().Error("ConfigManager", 
+          "Exception in config change callback for '" + notification.key + "': " + e.what());
+      } catch (...) {
+        Logger::Instance().Error("ConfigManager", 
+          "Unknown exception in config change callback for '" + notification.key + "'");
+      }
     }
   }
   
-  // Call callbacks outside of lock to avoid deadlocks
-  for (const auto& callback : callbacks) {
+  if (listeners.empty() || notifications.empty()) {
+    return;
+  }
+  ChangeSet changes;
+  for (const auto& notification : notifications) {
+    changes[notification.key] = notification.value;
+  }
+  for (const auto& listener : listeners) {
     try {
-      callback(value);
+      listener(changes);
     } catch (const std::exception& e) {
       Logger::Instance().Error("ConfigManager", 
-        "Exception in config change callback for '" + key + "': " + e.what());
+        std::string("Exception in config change set callback: ") + e.what());
     } catch (...) {
-      Logger::Instance().Error("ConfigManager", 
-        "Unknown exception in config change callback for '" + key + "'");
+      Logger::Instance().Error("ConfigManager", "Unknown exception in config change set callback");
     }
   }
 }
 
 bool ConfigManager::SaveToFile(const std::string& file_path) const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, ConfigValue> snapshot;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshot = config_;
+  }
   
   try {
-    std::ofstream file(file_path);
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
     if (!file.is_open()) {
       Logger::Instance().Error("ConfigManager", "Failed to open file for writing: " + file_path);
       return false;
     }
     
-    file << "{\n";
-    bool first = true;
-    for (const auto& pair : config_) {
-      if (!first) {
-        file << ",\n";
-      }
-      first = false;
-      
-      file << "  \"" << pair.first << "\": ";
-      
-      // Try different types (simple serialization)
-      bool bool_value;
-      if (pair.second.TryGet(bool_value)) {
-        file << (bool_value ? "true" : "false");
-      } else {
-        int int_value;
-        if (pair.second.TryGet(int_value)) {
-          file << int_value;
-        } else {
-          std::string str_value;
-          if (pair.second.TryGet(str_value)) {
-            file << "\"" << str_value << "\"";
-          } else {
-            file << "null";
-          }
-        }
-      }
+    ConfigJson::Write(file, snapshot);
+    file.close();
+    if (!file) {
+      Logger::Instance().Error("ConfigManager", "Failed to write configuration: " + file_path);
+      return false;
     }
-    file << "\n}\n";
     
     Logger::Instance().Info("ConfigManager", "Configuration saved to: " + file_path);
     return true;
@@ -201,10 +540,128 @@ bool ConfigManager::SaveToFile(const std::string& file_path) const {
 }
 
 bool ConfigManager::LoadFromFile(const std::string& file_path) {
-  // Simple JSON parsing - for production, use a proper JSON library
-  Logger::Instance().Warning("ConfigManager", 
-    "LoadFromFile not fully implemented - using defaults");
-  return false;
+  std::ifstream file(file_path, std::ios::binary);
+  if (!file.is_open()) {
+    Logger::Instance().Error("ConfigManager", "Failed to open configuration file: " + file_path);
+    return false;
+  }
+  
+  std::map<std::string, ConfigValue> values;
+  std::string error;
+  if (!ConfigJson::Parse(file, values, &error)) {
+    Logger::Instance().Error("ConfigManager", 
+      "Invalid configuration file " + file_path + ":" + error + " (configuration unchanged)");
+    return false;
+  }
+  
+  std::vector<Notification> notifications;
+  std::vector<ChangeSetCallback> listeners;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ApplyFileValues(std::move(values), notifications)) {
+      Logger::Instance().Error("ConfigManager", 
+        "Configuration file " + file_path + " failed validation (configuration unchanged)");
+      return false;
+    }
+    listeners = ChangeSetListeners();
+  }
+  Notify(notifications, listeners);
+  
+  Logger::Instance().Info("ConfigManager", 
+    "Configuration loaded from: " + file_path + " (" + std::to_string(notifications.size()) +
+    " keys changed)");
+  return true;
+}
+
+bool ConfigManager::ApplyFileValues(std::map<std::string, ConfigValue> values,
+                                    std::vector<Notification>& notifications) {
+  for (const auto& pair : values) {
+    auto validator = validators_.find(pair.first);
+    if (validator != validators_.end() && !validator->second(pair.second)) {
+      Logger::Instance().Error("ConfigManager", 
+        "Validation failed for configuration key: " + pair.first);
+      return false;
+    }
+  }
+  
+  // Keys in either file, in order; only those whose file value differs matter
+  std::vector<std::string> keys;
+  for (const auto& pair : file_values_) {
+    keys.push_back(pair.first);
+  }
+  for (const auto& pair : values) {
+    if (file_values_.find(pair.first) == file_values_.end()) {
+      keys.push_back(pair.first);
+    }
+  }
+  
+  for (const std::string& key : keys) {
+    auto old_value = file_values_.find(key);
+    auto new_value = values.find(key);
+    bool in_old = old_value != file_values_.end();
+    bool in_new = new_value != values.end();
+    if (in_old && in_new && old_value->second == new_value->second) {
+      continue;
+    }
+    if (env_overrides_.find(key) != env_overrides_.end()) {
+      continue;  // The environment wins
+    }
+    
+    auto current = config_.find(key);
+    ConfigValue before = current != config_.end() ? current->second : ConfigValue();
+    if (in_new) {
+      config_[key] = new_value->second;
+    } else if (defaults_.find(key) != defaults_.end()) {
+      config_[key] = defaults_[key];
+    } else {
+      config_.erase(key);
+    }
+    
+    auto after = config_.find(key);
+    if (after == config_.end() ? !before.IsEmpty() : after->second != before) {
+      notifications.push_back(PrepareNotification(key));
+    }
+  }
+  
+  file_values_ = std::move(values);
+  if (!notifications.empty()) {
+    PublishSnapshot();
+  }
+  return true;
+}
+
+bool ConfigManager::EnableHotReload(const std::string& file_path) {
+  DisableHotReload();
+  
+  auto watcher = std::make_unique<ConfigWatcher>(file_path, [this, file_path] {
+    LoadFromFile(file_path);
+  });
+  if (!watcher->Start()) {
+    Logger::Instance().Error("ConfigManager", "Cannot watch configuration file: " + file_path);
+    return false;
+  }
+  
+  std::lock_guard<std::mutex> lock(watcher_mutex_);
+  watcher_ = std::move(watcher);
+  Logger::Instance().Info("ConfigManager", "Hot reload enabled for: " + file_path);
+  return true;
+}
+
+void ConfigManager::DisableHotReload() {
+  std::unique_ptr<ConfigWatcher> watcher;
+  {
+    std::lock_guard<std::mutex> lock(watcher_mutex_);
+    watcher = std::move(watcher_);
+  }
+  if (watcher) {
+    watcher->Stop();
+    Logger::Instance().Info("ConfigManager", "Hot reload disabled for: " + watcher->Path());
+  }
+}
+
+bool ConfigManager::IsHotReloadEnabled() const {
+  std::lock_guard<std::mutex> lock(watcher_mutex_);
+  return watcher_ && watcher_->IsRunning();
 }
 
 void ConfigManager::SetProfile(const std::string& profile) {
@@ -219,13 +676,39 @@ std::string ConfigManager::GetProfile() const {
 }
 
 void ConfigManager::LoadFromEnvironment() {
-  // This is a simplified implementation
-  // For production, use platform-specific environment iteration
-  
-  Logger::Instance().Info("ConfigManager", "Environment variables loaded (if any)");
+  std::vector<Notification> notifications;
+  std::vector<ChangeSetCallback> listeners;
+  size_t loaded = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& variable : PrefixedEnvironment()) {
+      std::string key = EnvironmentKey(variable.first);
+      auto current = config_.find(key);
+      ConfigValue value = EnvironmentValue(variable.second,
+                                           current != config_.end() ? &current->second : nullptr);
+      if (value.IsEmpty()) {
+        Logger::Instance().Warning("ConfigManager", 
+          "Ignoring " + std::string(kEnvironmentPrefix) + variable.first + "='" +
+          variable.second + "': wrong type for '" + key + "'");
+        continue;
+      }
+      
+      loaded++;
+      env_overrides_[key] = value;
+      if (current == config_.end() || current->second != value) {
+        config_[key] = value;
+        notifications.push_back(PrepareNotification(key));
+      }
+    }
+    if (!notifications.empty()) {
+      PublishSnapshot();
+      listeners = ChangeSetListeners();
+    }
+  }
+  Notify(notifications, listeners);
   
-  // Unused variable removed to avoid warning
-  (void)0;  // Placeholder to avoid empty function body warning
+  Logger::Instance().Info("ConfigManager", 
+    "Environment overrides loaded: " + std::to_string(loaded));
 }
 
 bool ConfigManager::Validate() const {
@@ -5,11 +5,20 @@
 #include <map>
 #include <mutex>
 #include <any>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <functional>
+#include <vector>
+
+#include "snapshot_ptr.h"
 
 namespace anywp_engine {
 
+class ConfigWatcher;
+class ConfigTransaction;
+template <typename T> class ConfigKey;
+
 /**
  * @brief Configuration value with type safety
  */
@@ -22,25 +31,31 @@ public:
   
   template<typename T>
   T Get(const T& default_value = T()) const {
-    try {
-      return std::any_cast<T>(value_);
-    } catch (const std::bad_any_cast&) {
-      return default_value;
-    }
+    const T* value = GetIf<T>();
+    return value ? *value : default_value;
   }
   
   template<typename T>
   bool TryGet(T& out_value) const {
-    try {
-      out_value = std::any_cast<T>(value_);
-      return true;
-    } catch (const std::bad_any_cast&) {
+    const T* value = GetIf<T>();
+    if (!value) {
       return false;
     }
+    out_value = *value;
+    return true;
   }
   
+  // The held value if it is a T, else nullptr (no exceptions thrown)
+  template<typename T>
+  const T* GetIf() const noexcept { return std::any_cast<T>(&value_); }
+  
   bool IsEmpty() const { return !value_.has_value(); }
   
+  // Equal type and value (bool, int, double, std::string, std::vector<std::string>);
+  // values of other types never compare equal
+  bool operator==(const ConfigValue& other) const;
+  bool operator!=(const ConfigValue& other) const { return !(*this == other); }
+  
 private:
   std::any value_;
 };
@@ -56,6 +71,8 @@ private:
  * - Configuration profiles (dev, prod, test)
  * - Default values
  * - Environment variable overrides
+ * - Hot reload: the file is watched and only changed keys are notified
+ * - Lock-free typed reads through ConfigKey<T> (see below)
  * 
  * Usage:
  *   // Set configuration
@@ -77,6 +94,23 @@ private:
  *   // Save/Load
  *   ConfigManager::Instance().SaveToFile("config.json");
  *   ConfigManager::Instance().LoadFromFile("config.json");
+ *   
+ *   // Reload on every save; subscribers of unchanged keys are not called
+ *   ConfigManager::Instance().EnableHotReload("config.json");
+ *   
+ *   // Several keys at once: validated together, one notification per subscriber
+ *   ConfigTransaction transaction = ConfigManager::Instance().BeginTransaction();
+ *   transaction.Set("log.level", std::string("DEBUG"));
+ *   transaction.Set("log.file_enabled", true);
+ *   transaction.Commit();
+ *   
+ *   // Hot paths: a typed key declared once, read without locking
+ *   static const ConfigKey<int> kMaxCache("webview.max_cache_size_mb", 50);
+ *   int max_cache = kMaxCache.Get();
+ * 
+ * Sources, lowest precedence first:
+ *   defaults < Set() / file values (whichever came last) < ANYWP_* variables
+ *   A reload applies only the keys whose value in the file changed.
  * 
  * Configuration Keys (Recommended):
  * - "webview.cache_enabled" (bool) - Enable WebView cache
@@ -100,6 +134,10 @@ private:
  */
 class ConfigManager {
 public:
+  // Changed keys and their new values; an empty value means removed
+  using ChangeSet = std::map<std::string, ConfigValue>;
+  using ChangeSetCallback = std::function<void(const ChangeSet&)>;
+  
   static ConfigManager& Instance();
   
   /**
@@ -108,13 +146,13 @@ public:
    * @param key Configuration key (use dot notation for hierarchy)
    * @param value Configuration value
    * 
+   * Ignored for keys set by an ANYWP_* variable (see LoadFromEnvironment).
+   * 
    * Thread-safe: Yes
    */
   template<typename T>
   void Set(const std::string& key, const T& value) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    config_[key] = ConfigValue(value);
-    NotifySubscribers(key);
+    SetValue(key, ConfigValue(value));
   }
   
   /**
@@ -152,6 +190,8 @@ public:
    * 
    * @param key Configuration key
    * 
+   * Ignored for keys set by an ANYWP_* variable.
+   * 
    * Thread-safe: Yes
    */
   void Remove(const std::string& key);
@@ -159,6 +199,8 @@ public:
   /**
    * Clear all configuration
    * 
+   * Also stops hot reload and forgets environment overrides.
+   * 
    * Thread-safe: Yes
    */
   void Clear();
@@ -183,18 +225,42 @@ public:
    */
   int Subscribe(const std::string& key, std::function<void(const ConfigValue&)> callback);
   
+  /**
+   * Subscribe to every change, one call per batch
+   * 
+   * A transaction commit, file load or environment load arrives as a single
+   * ChangeSet; Set() and Remove() as a ChangeSet of one key.
+   * 
+   * @param callback Function to call with the changed keys
+   * @return Subscription ID (use to unsubscribe)
+   * 
+   * Thread-safe: Yes
+   */
+  int SubscribeChanges(ChangeSetCallback callback);
+  
   /**
    * Unsubscribe from configuration changes
    * 
-   * @param subscription_id Subscription ID from Subscribe()
+   * @param subscription_id Subscription ID from Subscribe() or SubscribeChanges()
    * 
    * Thread-safe: Yes
    */
   void Unsubscribe(int subscription_id);
   
+  /**
+   * Start staging changes to apply together
+   * 
+   * Nothing is visible until ConfigTransaction::Commit().
+   * 
+   * Thread-safe: Yes
+   */
+  ConfigTransaction BeginTransaction();
+  
   /**
    * Save configuration to JSON file
    * 
+   * Writes one flat object of dotted keys (see config_json.h).
+   * 
    * @param file_path Path to JSON file
    * @return true if successful
    * 
@@ -205,6 +271,11 @@ public:
   /**
    * Load configuration from JSON file
    * 
+   * Nested objects flatten to dotted keys. Compared with the previous load
+   * of a file, only keys whose value changed are applied and notified; keys
+   * no longer in the file revert to their default. A file that does not
+   * parse, or fails a registered validator, changes nothing.
+   * 
    * @param file_path Path to JSON file
    * @return true if successful
    * 
@@ -212,6 +283,29 @@ public:
    */
   bool LoadFromFile(const std::string& file_path);
   
+  /**
+   * Reload a file whenever it is saved
+   * 
+   * The file is watched (ReadDirectoryChangesW on Windows, inotify on Linux)
+   * and LoadFromFile() runs on the watcher thread once writes settle.
+   * Call LoadFromFile() first for the initial load.
+   * 
+   * @param file_path Path to JSON file
+   * @return false if the file's directory cannot be watched
+   * 
+   * Thread-safe: Yes
+   */
+  bool EnableHotReload(const std::string& file_path);
+  
+  /**
+   * Stop watching the file
+   * 
+   * Thread-safe: Yes (not from a change callback)
+   */
+  void DisableHotReload();
+  
+  bool IsHotReloadEnabled() const;
+  
   /**
    * Set configuration profile
    * 
@@ -235,6 +329,13 @@ public:
    * Looks for variables with prefix "ANYWP_"
    * Example: ANYWP_LOG_LEVEL=DEBUG sets "log.level" to "DEBUG"
    * 
+   * The name is lowercased and its first '_' becomes '.'
+   * (ANYWP_WEBVIEW_MAX_CACHE_SIZE_MB -> "webview.max_cache_size_mb"); names
+   * containing "__" use it as the separator instead (ANYWP_A__B_C -> "a.b_c").
+   * Values take the type of the key's current value (bool accepts
+   * 1/0/true/false/yes/no/on/off, string lists are comma-separated); new
+   * keys become bool, int or string. Overrides survive later file loads.
+   * 
    * Thread-safe: Yes
    */
   void LoadFromEnvironment();
@@ -260,28 +361,184 @@ public:
                          std::function<bool(const ConfigValue&)> validator);
 
 private:
+  template <typename T> friend class ConfigKey;
+  friend class ConfigTransaction;
+  
   ConfigManager();
   ~ConfigManager();
   
   ConfigManager(const ConfigManager&) = delete;
   ConfigManager& operator=(const ConfigManager&) = delete;
   
-  void NotifySubscribers(const std::string& key);
-  void LoadDefaults();
+  using Callback = std::function<void(const ConfigValue&)>;
   
   struct Subscription {
     int id;
     std::string key;
-    std::function<void(const ConfigValue&)> callback;
+    Callback callback;
+  };
+  
+  struct ChangeSetSubscription {
+    int id;
+    ChangeSetCallback callback;
+  };
+  
+  // A change to report once mutex_ is released
+  struct Notification {
+    std::string key;
+    ConfigValue value;                // Empty when the key was removed
+    std::vector<Callback> callbacks;
   };
   
+  // Values of every ConfigKey slot; immutable once published
+  struct Snapshot {
+    std::vector<ConfigValue> slots;
+  };
+  
+  void SetValue(const std::string& key, ConfigValue value);
+  // True (and logged) if an ANYWP_* variable pins the key. Requires mutex_
+  bool IsOverridden(const std::string& key) const;
+  
+  // Validates and applies `staged` (empty value = remove) under one lock;
+  // false if a validator rejects any value (nothing is applied then)
+  bool CommitTransaction(const ChangeSet& staged);
+  
+  // Slot of `key` in every snapshot from now on; slots are never reused
+  int ResolveSlot(const std::string& key);
+  
+  // The current snapshot: one atomic load. Requires an EpochGuard, and the
+  // pointer is valid only until that guard ends.
+  const Snapshot* LoadSnapshot() const { return snapshot_.Load(); }
+  
+  void PublishSnapshot();                                           // Requires mutex_
+  Notification PrepareNotification(const std::string& key) const;  // Requires mutex_
+  std::vector<ChangeSetCallback> ChangeSetListeners() const;        // Requires mutex_
+  
+  // Per-key callbacks, then each listener once with all the changes.
+  // Called without mutex_, so callbacks may read or change the configuration.
+  void Notify(const std::vector<Notification>& notifications,
+              const std::vector<ChangeSetCallback>& listeners) const;
+  void LoadDefaults();                                              // Requires mutex_
+  
+  // Applies the keys that differ from the previous file load; false if a
+  // validator rejects the new values (nothing is applied then)
+  bool ApplyFileValues(std::map<std::string, ConfigValue> values,
+                       std::vector<Notification>& notifications);  // Requires mutex_
+  
   std::map<std::string, ConfigValue> config_;
+  std::map<std::string, ConfigValue> defaults_;
+  std::map<std::string, ConfigValue> file_values_;    // As of the last LoadFromFile()
+  std::map<std::string, ConfigValue> env_overrides_;  // From LoadFromEnvironment()
   std::map<std::string, std::function<bool(const ConfigValue&)>> validators_;
   std::vector<Subscription> subscriptions_;
+  std::vector<ChangeSetSubscription> change_set_subscriptions_;
   int next_subscription_id_;
   std::string current_profile_;
   
   mutable std::mutex mutex_;
+  
+  // ConfigKey slots; the snapshot is republished after every change to config_
+  std::map<std::string, int> slots_;   // Guarded by mutex_
+  std::vector<std::string> slot_keys_;  // Guarded by mutex_
+  SnapshotPtr<Snapshot> snapshot_;      // Stored under mutex_
+  
+  // Hot reload; never joined while mutex_ is held (the watcher takes it)
+  std::unique_ptr<ConfigWatcher> watcher_;  // Guarded by watcher_mutex_
+  mutable std::mutex watcher_mutex_;
+};
+
+/**
+ * @brief ConfigTransaction - Changes to several keys applied as one
+ * 
+ * Set() and Remove() only stage; Commit() runs every registered validator
+ * against the staged values and then applies all of them under one lock, or
+ * none. Subscribers are called after the lock is released: each key
+ * subscriber at most once per commit (keys whose value ends up unchanged are
+ * skipped) and each SubscribeChanges() listener once with the whole change
+ * set. Keys set by an ANYWP_* variable keep that value. A transaction
+ * dropped without Commit() changes nothing.
+ * 
+ * Thread-safe: No (one transaction per thread; commits are atomic)
+ */
+class ConfigTransaction {
+public:
+  explicit ConfigTransaction(ConfigManager& manager) : manager_(&manager) {}
+  
+  ConfigTransaction(ConfigTransaction&&) = default;
+  ConfigTransaction& operator=(ConfigTransaction&&) = default;
+  ConfigTransaction(const ConfigTransaction&) = delete;
+  ConfigTransaction& operator=(const ConfigTransaction&) = delete;
+  
+  // A later Set() or Remove() of the same key replaces the earlier one
+  template<typename T>
+  ConfigTransaction& Set(const std::string& key, const T& value) {
+    staged_[key] = ConfigValue(value);
+    return *this;
+  }
+  
+  ConfigTransaction& Remove(const std::string& key) {
+    staged_[key] = ConfigValue();
+    return *this;
+  }
+  
+  // Applies the staged changes and clears them; on validation failure
+  // returns false and keeps them staged
+  bool Commit();
+  
+  void Rollback() { staged_.clear(); }
+  
+  size_t Size() const { return staged_.size(); }
+  bool Empty() const { return staged_.empty(); }
+
+private:
+  ConfigManager* manager_;
+  ConfigManager::ChangeSet staged_;
+};
+
+/**
+ * @brief ConfigKey - Typed handle to one configuration key
+ * 
+ * Declare once (typically static) with the value type and default; Get()
+ * then reads a slot of ConfigManager's published snapshot: no mutex, no map
+ * lookup, no exceptions. The default is returned while the key is unset or
+ * holds another type. Writes go through ConfigManager::Set() as usual.
+ * 
+ * Usage:
+ *   static const ConfigKey<bool> kHttpsOnly("security.https_only", false);
+ *   if (kHttpsOnly.Get()) { ... }
+ * 
+ * Thread-safe: Yes
+ */
+template <typename T>
+class ConfigKey {
+public:
+  ConfigKey(std::string name, T default_value)
+      : name_(std::move(name)), default_(std::move(default_value)) {}
+  
+  T Get() const {
+    ConfigManager& manager = ConfigManager::Instance();
+    int slot = slot_.load(std::memory_order_acquire);
+    if (slot < 0) {
+      slot = manager.ResolveSlot(name_);
+      slot_.store(slot, std::memory_order_release);
+    }
+    EpochGuard guard;  // Until the value is copied out
+    const ConfigManager::Snapshot* snapshot = manager.LoadSnapshot();
+    const T* value = static_cast<size_t>(slot) < snapshot->slots.size()
+                         ? snapshot->slots[slot].template GetIf<T>()
+                         : nullptr;
+    return value ? *value : default_;
+  }
+  
+  void Set(const T& value) const { ConfigManager::Instance().Set(name_, value); }
+  
+  const std::string& Name() const { return name_; }
+  const T& Default() const { return default_; }
+
+private:
+  const std::string name_;
+  const T default_;
+  mutable std::atomic<int> slot_{-1};
 };
 
 }  // namespace anywp_engine
@@ -0,0 +1,276 @@
+#include "config_watcher.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace anywp_engine {
+
+namespace {
+
+std::filesystem::path WatchedDirectory(const std::filesystem::path& file) {
+  std::filesystem::path directory = file.parent_path();
+  return directory.empty() ? std::filesystem::path(".") : directory;
+}
+
+}  // namespace
+
+#ifdef _WIN32
+
+struct ConfigWatcher::Platform {
+  HANDLE directory = INVALID_HANDLE_VALUE;
+  HANDLE stop_event = nullptr;
+  std::wstring name;
+};
+
+#elif defined(__linux__)
+
+struct ConfigWatcher::Platform {
+  int inotify_fd = -1;
+  int stop_fd = -1;  // eventfd written by Stop()
+  std::string name;
+};
+
+#else
+
+struct ConfigWatcher::Platform {
+  static constexpr std::chrono::milliseconds kPollInterval{250};
+};
+
+#endif
+
+ConfigWatcher::ConfigWatcher(const std::string& path, Callback on_change,
+                             std::chrono::milliseconds settle)
+    : path_(path),
+      on_change_(std::move(on_change)),
+      settle_(settle) {
+}
+
+ConfigWatcher::~ConfigWatcher() {
+  Stop();
+}
+
+bool ConfigWatcher::Start() {
+  if (running_) {
+    return true;
+  }
+  Stop();  // Reaps a watch thread that exited on an error
+  std::filesystem::path file(path_);
+  auto platform = new Platform();
+
+#ifdef _WIN32
+  platform->name = file.filename().wstring();
+  platform->directory = CreateFileW(WatchedDirectory(file).wstring().c_str(), FILE_LIST_DIRECTORY,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                    nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+  platform->stop_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+  if (platform->directory == INVALID_HANDLE_VALUE || !platform->stop_event) {
+    if (platform->directory != INVALID_HANDLE_VALUE) {
+      CloseHandle(platform->directory);
+    }
+    if (platform->stop_event) {
+      CloseHandle(platform->stop_event);
+    }
+    delete platform;
+    return false;
+  }
+#elif defined(__linux__)
+  platform->name = file.filename().string();
+  platform->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  platform->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (platform->inotify_fd < 0 || platform->stop_fd < 0 ||
+      inotify_add_watch(platform->inotify_fd, WatchedDirectory(file).c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+    if (platform->inotify_fd >= 0) {
+      close(platform->inotify_fd);
+    }
+    if (platform->stop_fd >= 0) {
+      close(platform->stop_fd);
+    }
+    delete platform;
+    return false;
+  }
+#else
+  std::error_code ec;
+  if (!std::filesystem::is_directory(WatchedDirectory(file), ec)) {
+    delete platform;
+    return false;
+  }
+#endif
+
+  platform_ = platform;
+  running_ = true;
+  thread_ = std::thread([this] {
+    Run();
+    running_ = false;  // Also when the watch itself failed
+  });
+  return true;
+}
+
+void ConfigWatcher::Stop() {
+  running_ = false;
+  if (!platform_) {
+    return;
+  }
+
+#ifdef _WIN32
+  SetEvent(platform_->stop_event);
+#elif defined(__linux__)
+  uint64_t one = 1;
+  (void)write(platform_->stop_fd, &one, sizeof(one));
+#endif
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+#ifdef _WIN32
+  CloseHandle(platform_->directory);
+  CloseHandle(platform_->stop_event);
+#elif defined(__linux__)
+  close(platform_->inotify_fd);
+  close(platform_->stop_fd);
+#endif
+  delete platform_;
+  platform_ = nullptr;
+}
+
+#ifdef _WIN32
+
+void ConfigWatcher::Run() {
+  OVERLAPPED overlapped = {};
+  overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+  if (!overlapped.hEvent) {
+    return;
+  }
+  alignas(DWORD) BYTE buffer[16 * 1024];
+  bool pending = false;  // A ReadDirectoryChangesW call is outstanding
+  bool dirty = false;    // The file changed; waiting for it to settle
+
+  while (running_) {
+    if (!pending) {
+      ResetEvent(overlapped.hEvent);
+      if (!ReadDirectoryChangesW(platform_->directory, buffer, sizeof(buffer), FALSE,
+                                 FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME |
+                                 FILE_NOTIFY_CHANGE_SIZE,
+                                 nullptr, &overlapped, nullptr)) {
+        break;
+      }
+      pending = true;
+    }
+
+    HANDLE handles[2] = {platform_->stop_event, overlapped.hEvent};
+    DWORD wait = WaitForMultipleObjects(2, handles, FALSE,
+                                        dirty ? static_cast<DWORD>(settle_.count()) : INFINITE);
+    if (wait == WAIT_OBJECT_0) {
+      break;
+    }
+    if (wait == WAIT_TIMEOUT) {
+      dirty = false;
+      on_change_();
+      continue;
+    }
+    if (wait != WAIT_OBJECT_0 + 1) {
+      break;
+    }
+
+    pending = false;
+    DWORD bytes = 0;
+    if (!GetOverlappedResult(platform_->directory, &overlapped, &bytes, FALSE)) {
+      continue;
+    }
+    if (bytes == 0) {
+      dirty = true;  // Buffer overflow: the details are lost, assume our file changed
+      continue;
+    }
+    const BYTE* entry = buffer;
+    while (true) {
+      auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+      std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+      if (_wcsicmp(name.c_str(), platform_->name.c_str()) == 0) {
+        dirty = true;
+      }
+      if (info->NextEntryOffset == 0) {
+        break;
+      }
+      entry += info->NextEntryOffset;
+    }
+  }
+
+  if (pending) {
+    DWORD bytes = 0;
+    CancelIoEx(platform_->directory, &overlapped);
+    GetOverlappedResult(platform_->directory, &overlapped, &bytes, TRUE);
+  }
+  CloseHandle(overlapped.hEvent);
+}
+
+#elif defined(__linux__)
+
+void ConfigWatcher::Run() {
+  alignas(struct inotify_event) char buffer[16 * 1024];
+  bool dirty = false;  // The file changed; waiting for it to settle
+
+  while (running_) {
+    pollfd fds[2] = {{platform_->stop_fd, POLLIN, 0}, {platform_->inotify_fd, POLLIN, 0}};
+    int ready = poll(fds, 2, dirty ? static_cast<int>(settle_.count()) : -1);
+    if (ready < 0) {
+      continue;  // EINTR
+    }
+    if (ready == 0) {
+      dirty = false;
+      on_change_();
+      continue;
+    }
+    if (fds[0].revents & POLLIN) {
+      break;
+    }
+
+    ssize_t length;
+    while ((length = read(platform_->inotify_fd, buffer, sizeof(buffer))) > 0) {
+      for (char* p = buffer; p < buffer + length;) {
+        auto event = reinterpret_cast<const struct inotify_event*>(p);
+        if ((event->mask & IN_Q_OVERFLOW) ||
+            (event->len > 0 && platform_->name == event->name)) {
+          dirty = true;
+        }
+        p += sizeof(struct inotify_event) + event->len;
+      }
+    }
+  }
+}
+
+#else
+
+void ConfigWatcher::Run() {
+  std::error_code ec;
+  auto last_write = std::filesystem::last_write_time(path_, ec);
+  auto quiet_since = std::chrono::steady_clock::now();
+  bool dirty = false;
+
+  while (running_) {
+    std::this_thread::sleep_for(std::min(Platform::kPollInterval, settle_));
+    auto write_time = std::filesystem::last_write_time(path_, ec);
+    if (!ec && write_time != last_write) {
+      last_write = write_time;
+      quiet_since = std::chrono::steady_clock::now();
+      dirty = true;
+    } else if (dirty && std::chrono::steady_clock::now() - quiet_since >= settle_) {
+      dirty = false;
+      on_change_();
+    }
+  }
+}
+
+#endif
+
+}  // namespace anywp_engine
@@ -0,0 +1,67 @@
+#ifndef ANYWP_ENGINE_CONFIG_WATCHER_H_
+#define ANYWP_ENGINE_CONFIG_WATCHER_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace anywp_engine {
+
+/**
+ * ConfigWatcher - Calls back when one file is written or replaced
+ *
+ * Watches the file's directory, so editors that save by writing a temp file
+ * and renaming it over the original are seen too:
+ * - Windows: ReadDirectoryChangesW (overlapped, with a stop event)
+ * - Linux:   inotify (IN_CLOSE_WRITE, IN_MOVED_TO, IN_CREATE)
+ * - Others:  last-write-time polling
+ *
+ * Bursts of changes (several writes from one save) are settled: the
+ * callback runs once the file has been quiet for `settle`. It runs on the
+ * watcher thread.
+ *
+ * Usage:
+ *   ConfigWatcher watcher("config.json", [] { Reload(); });
+ *   watcher.Start();
+ *
+ * Thread-safe: Start()/Stop() from one owner thread
+ */
+class ConfigWatcher {
+public:
+  using Callback = std::function<void()>;
+
+  static constexpr std::chrono::milliseconds kDefaultSettle{100};
+
+  ConfigWatcher(const std::string& path, Callback on_change,
+                std::chrono::milliseconds settle = kDefaultSettle);
+  ~ConfigWatcher();
+
+  ConfigWatcher(const ConfigWatcher&) = delete;
+  ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+  // False if the directory cannot be watched
+  bool Start();
+  void Stop();
+
+  bool IsRunning() const { return running_.load(); }
+  const std::string& Path() const { return path_; }
+
+private:
+  struct Platform;  // Handles of the platform watch
+
+  void Run();
+
+  const std::string path_;
+  const Callback on_change_;
+  const std::chrono::milliseconds settle_;
+
+  Platform* platform_ = nullptr;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_CONFIG_WATCHER_H_
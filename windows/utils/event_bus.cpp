@@ -1,9 +1,88 @@
 #include "event_bus.h"
 #include "logger.h"
 #include <algorithm>
+#include <optional>
 
 namespace anywp_engine {
 
+namespace {
+
+// PublishAsync dispatcher used until ConfigureAsyncDispatch() is called
+constexpr size_t kDefaultDispatchWorkers = 1;
+constexpr size_t kDefaultDispatchCapacity = 1024;
+
+// Name for log lines; events published under a never-interned name carry
+// it themselves (they are always Events)
+const std::string& TopicName(TopicId topic, const void* payload) {
+  return topic != kInvalidTopic ? TopicRegistry::Instance().Name(topic)
+                                : static_cast<const Event*>(payload)->type;
+}
+
+void InvokeHandler(const std::function<void(const void*)>& handler, const void* payload,
+                   TopicId topic) {
+  try {
+    handler(payload);
+  } catch (const std::exception& e) {
+    Logger::Instance().Error("EventBus", 
+      "Exception in event handler for '" + TopicName(topic, payload) + "': " + e.what());
+  } catch (...) {
+    Logger::Instance().Error("EventBus", 
+      "Unknown exception in event handler for '" + TopicName(topic, payload) + "'");
+  }
+}
+
+const char* CoalesceName(EventBus::Coalesce mode) {
+  switch (mode) {
+    case EventBus::Coalesce::NONE:              return "off";
+    case EventBus::Coalesce::LATEST:            return "latest";
+    case EventBus::Coalesce::COUNT:             return "count";
+    case EventBus::Coalesce::DEBOUNCE_LEADING:  return "leading debounce";
+    case EventBus::Coalesce::DEBOUNCE_TRAILING: return "trailing debounce";
+  }
+  return "unknown";
+}
+
+// Copy of `current` with `subscriber` inserted after every subscriber of
+// higher or equal priority (no re-sort)
+template <typename List, typename Item>
+std::shared_ptr<const List> WithSubscriber(const std::shared_ptr<const List>& current,
+                                           Item subscriber) {
+  auto list = std::make_shared<List>();
+  if (current) {
+    list->reserve(current->size() + 1);
+    list->assign(current->begin(), current->end());
+  }
+  int priority = subscriber.priority;
+  auto position = std::find_if(list->begin(), list->end(),
+    [priority](const Item& s) { return s.priority < priority; });
+  list->insert(position, std::move(subscriber));
+  return list;
+}
+
+// Copy of `current` without subscription `id` (null when nothing is left)
+template <typename List>
+std::shared_ptr<const List> WithoutSubscriber(const List& current, int id) {
+  if (current.size() == 1) {
+    return nullptr;
+  }
+  auto list = std::make_shared<List>();
+  list->reserve(current.size() - 1);
+  for (const auto& s : current) {
+    if (s.id != id) {
+      list->push_back(s);
+    }
+  }
+  return list;
+}
+
+template <typename List>
+bool HasSubscriber(const std::shared_ptr<const List>& list, int id) {
+  return list && std::any_of(list->begin(), list->end(),
+                             [id](const auto& s) { return s.id == id; });
+}
+
+}  // namespace
+
 EventBus& EventBus::Instance() {
   static EventBus instance;
   return instance;
@@ -11,38 +90,126 @@ EventBus& EventBus::Instance() {
 
 EventBus::EventBus()
     : next_subscription_id_(1),
+      subscribers_(std::make_unique<const SubscriberTable>()),
       history_enabled_(false),
-      max_history_size_(1000) {
+      coalesced_topics_(0) {
   Logger::Instance().Info("EventBus", "EventBus initialized");
 }
 
 EventBus::~EventBus() {
+  std::shared_ptr<EventTimer> timer;
+  {
+    std::lock_guard<std::mutex> lock(coalesce_mutex_);
+    timer = timer_;
+  }
+  if (timer) {
+    timer->Stop();
+  }
+  StopExecutors();
   Clear();
 }
 
+// ========== Snapshot access ==========
+// SnapshotPtr (snapshot_ptr.h): readers load the current snapshot under an
+// EpochGuard; writers publish a complete new one and the old one is freed
+// once no reader can still see it.
+
+const EventBus::SubscriberTable* EventBus::LoadSubscribers() const {
+  return subscribers_.Load();
+}
+
+void EventBus::StoreSubscribers(std::unique_ptr<const SubscriberTable> table) {
+  subscribers_.Store(std::move(table));
+}
+
 std::shared_ptr<EventSubscription> EventBus::Subscribe(
     const std::string& event_type,
     EventHandler handler,
     int priority) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  
-  int subscription_id = next_subscription_id_++;
+  SubscribeOptions options;
+  options.priority = priority;
+  return Subscribe(event_type, std::move(handler), options);
+}
+
+std::shared_ptr<EventSubscription> EventBus::Subscribe(
+    const std::string& event_type,
+    EventHandler handler,
+    const SubscribeOptions& options) {
+  bool pattern = TopicTrie::IsPattern(event_type);
+  return SubscribeInternal(pattern ? kInvalidTopic : TopicRegistry::Instance().Intern(event_type),
+    pattern ? event_type : std::string(),
+    [handler = std::move(handler)](const void* data) {
+      handler(*static_cast<const Event*>(data));
+    },
+    PayloadTypeOf<Event>(), options);
+}
+
+std::shared_ptr<EventSubscription> EventBus::SubscribeInternal(
+    TopicId topic,
+    const std::string& pattern,
+    PayloadHandler handler,
+    const void* payload_type,
+    const SubscribeOptions& options) {
+  const std::string& event_type = pattern.empty() ? TopicRegistry::Instance().Name(topic) : pattern;
+  int priority = options.priority;
   
   Subscriber subscriber;
-  subscriber.id = subscription_id;
   subscriber.handler = std::move(handler);
+  subscriber.payload_type = payload_type;
   subscriber.priority = priority;
+  subscriber.delivery = options.delivery;
+  if (options.delivery == Delivery::EXECUTOR) {
+    std::lock_guard<std::mutex> executors_lock(executors_mutex_);
+    auto found = executors_.find(options.executor);
+    if (found != executors_.end()) {
+      subscriber.executor = found->second;
+    } else {
+      subscriber.delivery = Delivery::ASYNC;
+      Logger::Instance().Warning("EventBus", 
+        "Unknown executor '" + options.executor + "' for '" + event_type + 
+        "', using the dispatcher");
+    }
+  }
+  
+  std::lock_guard<std::mutex> lock(mutex_);
   
-  subscribers_[event_type].push_back(subscriber);
+  int subscription_id = next_subscription_id_++;
+  subscriber.id = subscription_id;
   
-  // Sort by priority
-  std::sort(subscribers_[event_type].begin(), subscribers_[event_type].end());
+  // Copy-on-write: new list for this topic, other topics share their lists
+  auto table = std::make_unique<SubscriberTable>(*LoadSubscribers());
+  if (pattern.empty()) {
+    if (table->exact.size() <= topic) {
+      table->exact.resize(topic + 1);
+    }
+    table->exact[topic] = WithSubscriber(table->exact[topic], std::move(subscriber));
+    if (table->pattern_subscribers > 0) {
+      ExtendResolved(*table);
+      table->resolved[topic] = Resolve(*table, topic);
+    }
+  } else {
+    // Compile the pattern into a new trie only the first time it is seen
+    TopicTrie::PatternId id = table->trie ? table->trie->Find(pattern) : TopicTrie::kNoPattern;
+    if (id == TopicTrie::kNoPattern) {
+      auto trie = table->trie ? std::make_shared<TopicTrie>(*table->trie)
+                              : std::make_shared<TopicTrie>();
+      id = trie->Insert(pattern);
+      table->trie = std::move(trie);
+    }
+    if (table->patterns.size() <= id) {
+      table->patterns.resize(id + 1);
+    }
+    table->patterns[id] = WithSubscriber(table->patterns[id], std::move(subscriber));
+    table->pattern_subscribers++;
+    ResolveAll(*table);
+  }
+  StoreSubscribers(std::move(table));
   
-  Logger::Instance().Debug("EventBus", 
+  ANYWP_LOG_DEBUG("EventBus", 
     "Subscribed to '" + event_type + "' (ID: " + std::to_string(subscription_id) + 
     ", Priority: " + std::to_string(priority) + ")");
   
-  return std::make_shared<EventSubscription>(subscription_id, event_type);
+  return std::make_shared<EventSubscription>(subscription_id, event_type, topic);
 }
 
 void EventBus::Unsubscribe(std::shared_ptr<EventSubscription> subscription) {
@@ -54,136 +221,685 @@ void EventBus::Unsubscribe(std::shared_ptr<EventSubscription> subscription) {
   
   const std::string& event_type = subscription->GetEventType();
   int subscription_id = subscription->GetId();
+  const SubscriberTable* current = LoadSubscribers();
+  std::unique_ptr<SubscriberTable> table;
   
-  auto it = subscribers_.find(event_type);
-  if (it != subscribers_.end()) {
-    auto& subs = it->second;
-    subs.erase(
-      std::remove_if(subs.begin(), subs.end(),
-        [subscription_id](const Subscriber& s) { return s.id == subscription_id; }),
-      subs.end()
-    );
-    
-    if (subs.empty()) {
-      subscribers_.erase(it);
+  if (TopicTrie::IsPattern(event_type)) {
+    TopicTrie::PatternId id =
+      current->trie ? current->trie->Find(event_type) : TopicTrie::kNoPattern;
+    if (id >= current->patterns.size() ||
+        !HasSubscriber(current->patterns[id], subscription_id)) {
+      return;
+    }
+    table = std::make_unique<SubscriberTable>(*current);
+    table->patterns[id] = WithoutSubscriber(*current->patterns[id], subscription_id);
+    table->pattern_subscribers--;
+    if (!table->patterns[id]) {
+      // Last subscriber of the pattern: drop it (and its nodes) from the trie
+      auto trie = std::make_shared<TopicTrie>(*current->trie);
+      trie->Remove(event_type);
+      table->trie = trie->PatternCount() > 0 ? std::move(trie) : nullptr;
+    }
+    ResolveAll(*table);
+  } else {
+    TopicId topic = subscription->GetTopicId();
+    if (topic == kInvalidTopic) {
+      topic = TopicRegistry::Instance().Find(event_type);
+    }
+    if (topic >= current->exact.size() ||
+        !HasSubscriber(current->exact[topic], subscription_id)) {
+      return;
+    }
+    table = std::make_unique<SubscriberTable>(*current);
+    table->exact[topic] = WithoutSubscriber(*current->exact[topic], subscription_id);
+    if (topic < table->resolved.size()) {
+      table->resolved[topic] = Resolve(*table, topic);
     }
-    
-    Logger::Instance().Debug("EventBus", 
-      "Unsubscribed from '" + event_type + "' (ID: " + std::to_string(subscription_id) + ")");
   }
+  StoreSubscribers(std::move(table));
+  
+  ANYWP_LOG_DEBUG("EventBus", 
+    "Unsubscribed from '" + event_type + "' (ID: " + std::to_string(subscription_id) + ")");
 }
 
 void EventBus::Publish(const Event& event) {
-  std::vector<Subscriber> handlers_to_call;
+  // Never-subscribed names are not interned: only pattern subscribers can be
+  // listening, and they are matched by name, so arbitrary event names never
+  // grow the registry. The history indexes by topic, so it interns them.
+  TopicId topic = TopicRegistry::Instance().Find(event.type);
+  if (topic == kInvalidTopic && history_enabled_.load(std::memory_order_relaxed)) {
+    topic = TopicRegistry::Instance().Intern(event.type);
+  }
+  Payload payload{&event, PayloadTypeOf<Event>(), nullptr, &CopyPayload<Event>, nullptr};
+  RecordHistory(topic, payload);
+  
+  if (topic == kInvalidTopic) {
+    DeliverByName(event, payload, false);
+    return;
+  }
+  if (Coalesced(topic, payload)) {
+    return;
+  }
+  Deliver(topic, payload, false);
+}
+
+void EventBus::Publish(const std::string& event_type, const std::string& source) {
+  Event event(event_type, source);
+  Publish(event);
+}
+
+bool EventBus::PublishAsync(const Event& event) {
+  TopicId topic = TopicRegistry::Instance().Find(event.type);
+  if (topic == kInvalidTopic && history_enabled_.load(std::memory_order_relaxed)) {
+    topic = TopicRegistry::Instance().Intern(event.type);
+  }
+  auto shared = std::make_shared<const Event>(event);
+  Payload payload{shared.get(), PayloadTypeOf<Event>(), shared, &CopyPayload<Event>, nullptr};
+  if (topic != kInvalidTopic) {
+    return PublishPayloadAsync(topic, std::move(payload));
+  }
   
+  bool queued = Dispatcher()->Post(event.type, [this, payload]() mutable {
+    DeliverByName(*static_cast<const Event*>(payload.data), payload, true);
+  });
+  if (!queued) {
+    ANYWP_LOG_DEBUG("EventBus", "Dropped async event '" + event.type + "' (queue full)");
+  }
+  return queued;
+}
+
+void EventBus::PublishPayload(TopicId topic, Payload& payload) {
+  RecordHistory(topic, payload);
+  if (Coalesced(topic, payload)) {
+    return;
+  }
+  Deliver(topic, payload, false);
+}
+
+bool EventBus::PublishPayloadAsync(TopicId topic, Payload payload) {
+  RecordHistory(topic, payload);
+  if (Coalesced(topic, payload)) {
+    return true;
+  }
+  
+  const std::string& event_type = TopicRegistry::Instance().Name(topic);
+  bool queued = Dispatcher()->Post(event_type, [this, topic, payload]() mutable {
+    Deliver(topic, payload, true);
+  });
+  if (!queued) {
+    ANYWP_LOG_DEBUG("EventBus", "Dropped async event '" + event_type + "' (queue full)");
+  }
+  return queued;
+}
+
+void EventBus::RecordHistory(TopicId topic, const Payload& payload) {
+  if (!history_enabled_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  // Share the queued copy when there is one; otherwise one copy per event
+  EventHistory::EventPtr event;
+  if (payload.to_event) {
+    event = std::make_shared<const Event>(payload.to_event(topic, payload.data));
+  } else if (payload.shared) {
+    event = std::static_pointer_cast<const Event>(payload.shared);
+  } else {
+    event = std::make_shared<const Event>(*static_cast<const Event*>(payload.data));
+  }
+  history_.Append(topic, std::move(event));
+}
+
+void EventBus::Deliver(TopicId topic, Payload& payload, bool on_dispatcher) {
+  // Lock-free read of the current snapshot; the list outlives the guard
+  std::shared_ptr<const SubscriberList> list;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
+    EpochGuard guard;
+    list = SubscribersOf(*LoadSubscribers(), topic);
+  }
+  DeliverTo(list, topic, TopicRegistry::Instance().Name(topic), payload, on_dispatcher);
+}
+
+void EventBus::DeliverByName(const Event& event, Payload& payload, bool on_dispatcher) {
+  std::shared_ptr<const SubscriberList> list;
+  {
+    EpochGuard guard;
+    const SubscriberTable* table = LoadSubscribers();
+    if (table->pattern_subscribers > 0) {
+      list = Merge(*table, nullptr, event.type);
+    }
+  }
+  DeliverTo(list, kInvalidTopic, event.type, payload, on_dispatcher);
+}
+
+void EventBus::DeliverTo(const std::shared_ptr<const SubscriberList>& list, TopicId topic,
+                         const std::string& name, Payload& payload, bool on_dispatcher) {
+  if (!list) {
+    ANYWP_LOG_DEBUG("EventBus", "Published event '" + name + "' to 0 subscribers");
+    return;
+  }
+  
+  // String-API subscribers of a typed topic see an adapted Event, built once
+  std::optional<Event> adapted;
+  Payload adapted_payload{nullptr, PayloadTypeOf<Event>(), nullptr, &CopyPayload<Event>, nullptr};
+  
+  // Handlers run without any lock held, so they may publish or (un)subscribe
+  size_t delivered = 0;
+  for (const auto& subscriber : *list) {
+    Payload* view = &payload;
+    if (subscriber.payload_type != payload.type) {
+      if (subscriber.payload_type != PayloadTypeOf<Event>() || !payload.to_event) {
+        continue;  // Typed subscriber, different payload type
+      }
+      if (!adapted) {
+        adapted.emplace(payload.to_event(topic, payload.data));
+        adapted_payload.data = &*adapted;
+      }
+      view = &adapted_payload;
+    }
+    delivered++;
+    
+    if (subscriber.delivery == Delivery::INLINE ||
+        (subscriber.delivery == Delivery::ASYNC && on_dispatcher)) {
+      InvokeHandler(subscriber.handler, view->data, topic);
+      continue;
+    }
     
-    // Add to history if enabled
-    if (history_enabled_) {
-      event_history_.push_back(event);
-      if (event_history_.size() > max_history_size_) {
-        event_history_.erase(event_history_.begin());
+    // Posted tasks keep the payload and this snapshot's list (and so the
+    // handler) alive until they have run
+    if (!view->shared) {
+      view->shared = view->copy(view->data);
+    }
+    std::shared_ptr<EventExecutor> executor =
+      subscriber.delivery == Delivery::EXECUTOR ? subscriber.executor : Dispatcher();
+    executor->Post(name,
+      [list, &subscriber, shared = view->shared, topic] {
+        InvokeHandler(subscriber.handler, shared.get(), topic);
+      });
+  }
+  
+  ANYWP_LOG_DEBUG("EventBus", 
+    "Published event '" + name + "' to " + std::to_string(delivered) + " subscribers");
+}
+
+// ========== Coalescing ==========
+
+void EventBus::SetCoalescing(const std::string& event_type, Coalesce mode,
+                             std::chrono::milliseconds window) {
+  TopicId topic = TopicRegistry::Instance().Intern(event_type);
+  std::optional<Payload> flushed;
+  {
+    std::lock_guard<std::mutex> lock(coalesce_mutex_);
+    auto it = coalescing_.find(topic);
+    if (it != coalescing_.end()) {
+      flushed = std::move(it->second.pending);
+      coalescing_.erase(it);
+      coalesced_topics_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (mode != Coalesce::NONE) {
+      CoalesceState& state = coalescing_[topic];
+      state.mode = mode;
+      state.window = window;
+      state.generation = ++next_coalesce_generation_;
+      coalesced_topics_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  if (flushed) {
+    DeliverCoalesced(topic, std::move(*flushed));
+  }
+  
+  Logger::Instance().Info("EventBus", 
+    "Coalescing for '" + event_type + "': " + CoalesceName(mode) +
+    (mode == Coalesce::NONE ? "" : " (" + std::to_string(window.count()) + " ms)"));
+}
+
+void EventBus::SetTimer(std::shared_ptr<EventTimer> timer) {
+  std::shared_ptr<EventTimer> previous;
+  std::vector<std::pair<TopicId, Payload>> flushed;
+  {
+    std::lock_guard<std::mutex> lock(coalesce_mutex_);
+    previous = std::move(timer_);
+    timer_ = std::move(timer);
+    // Deadlines of the old clock mean nothing on the new one
+    for (auto& entry : coalescing_) {
+      CoalesceState& state = entry.second;
+      if (state.pending) {
+        flushed.emplace_back(entry.first, std::move(*state.pending));
+        state.pending.reset();
       }
+      state.armed = false;
+      state.count = 0;
+      state.generation = ++next_coalesce_generation_;
     }
+  }
+  if (previous) {
+    previous->Stop();
+  }
+  for (auto& entry : flushed) {
+    DeliverCoalesced(entry.first, std::move(entry.second));
+  }
+}
+
+std::shared_ptr<EventTimer> EventBus::Timer() {
+  if (!timer_) {
+    timer_ = std::make_shared<EventTimer>();
+  }
+  return timer_;
+}
+
+bool EventBus::Coalesced(TopicId topic, const Payload& payload) {
+  if (coalesced_topics_.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  
+  std::lock_guard<std::mutex> lock(coalesce_mutex_);
+  auto it = coalescing_.find(topic);
+  if (it == coalescing_.end()) {
+    return false;
+  }
+  CoalesceState& state = it->second;
+  std::shared_ptr<EventTimer> timer = Timer();
+  EventTimer::Clock::time_point now = timer->Now();
+  
+  if (state.mode == Coalesce::DEBOUNCE_LEADING) {
+    bool quiet = !state.armed || now >= state.deadline;
+    state.armed = true;
+    state.deadline = now + state.window;  // Every event extends the quiet period
+    return !quiet;
+  }
+  
+  // Hold the newest event; the caller's payload may live on its stack
+  Payload held = payload;
+  if (!held.shared) {
+    held.shared = held.copy(held.data);
+  }
+  held.data = held.shared.get();
+  state.pending = std::move(held);
+  state.count++;
+  
+  if (state.mode == Coalesce::DEBOUNCE_TRAILING || !state.armed) {
+    state.deadline = now + state.window;
+  }
+  if (!state.armed) {
+    state.armed = true;
+    uint64_t generation = state.generation;
+    timer->Schedule(state.deadline, [this, topic, generation] {
+      FireCoalesced(topic, generation);
+    });
+  }
+  return true;
+}
+
+void EventBus::FireCoalesced(TopicId topic, uint64_t generation) {
+  Payload payload{};
+  size_t count = 0;
+  Coalesce mode = Coalesce::NONE;
+  {
+    std::lock_guard<std::mutex> lock(coalesce_mutex_);
+    auto it = coalescing_.find(topic);
+    if (it == coalescing_.end() || it->second.generation != generation || !it->second.armed) {
+      return;
+    }
+    CoalesceState& state = it->second;
+    std::shared_ptr<EventTimer> timer = Timer();
     
-    // Get all subscribers for this event type
-    auto it = subscribers_.find(event.type);
-    if (it != subscribers_.end()) {
-      handlers_to_call = it->second;
+    // Trailing debounce: later events moved the deadline; one timer per window
+    if (timer->Now() < state.deadline) {
+      timer->Schedule(state.deadline, [this, topic, generation] {
+        FireCoalesced(topic, generation);
+      });
+      return;
     }
+    state.armed = false;
+    if (!state.pending) {
+      return;
+    }
+    payload = std::move(*state.pending);
+    state.pending.reset();
+    count = state.count;
+    state.count = 0;
+    mode = state.mode;
+  }
+  
+  if (mode == Coalesce::COUNT && !payload.to_event) {
+    auto event = std::make_shared<Event>(*static_cast<const Event*>(payload.data));
+    event->SetData("coalesced_count", count);
+    payload.data = event.get();
+    payload.shared = std::move(event);
+  }
+  DeliverCoalesced(topic, std::move(payload));
+}
+
+void EventBus::DeliverCoalesced(TopicId topic, Payload payload) {
+  const std::string& event_type = TopicRegistry::Instance().Name(topic);
+  bool queued = Dispatcher()->Post(event_type, [this, topic, payload]() mutable {
+    Deliver(topic, payload, true);
+  });
+  if (!queued) {
+    ANYWP_LOG_DEBUG("EventBus", "Dropped coalesced event '" + event_type + "' (queue full)");
+  }
+}
+
+// ========== Wildcard resolution ==========
+
+std::shared_ptr<const EventBus::SubscriberList> EventBus::SubscribersOf(
+    const SubscriberTable& table, TopicId topic) {
+  if (table.pattern_subscribers == 0) {
+    return topic < table.exact.size() ? table.exact[topic] : nullptr;
+  }
+  if (topic < table.resolved.size()) {
+    return table.resolved[topic];
   }
   
-  // Call handlers outside of lock to avoid deadlocks
-  for (const auto& subscriber : handlers_to_call) {
-    try {
-      subscriber.handler(event);
-    } catch (const std::exception& e) {
-      Logger::Instance().Error("EventBus", 
-        "Exception in event handler for '" + event.type + "': " + e.what());
-    } catch (...) {
-      Logger::Instance().Error("EventBus", 
-        "Unknown exception in event handler for '" + event.type + "'");
+  // Interned after the snapshot was built: resolve it here, and extend the
+  // cache only if no writer holds mutex_. A publisher never waits on it.
+  std::shared_ptr<const SubscriberList> list = Resolve(table, topic);
+  std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+  if (lock.owns_lock()) {
+    const SubscriberTable* current = LoadSubscribers();
+    if (current->pattern_subscribers > 0 && topic >= current->resolved.size()) {
+      auto extended = std::make_unique<SubscriberTable>(*current);
+      ExtendResolved(*extended);
+      StoreSubscribers(std::move(extended));
     }
   }
+  return list;
+}
+
+std::shared_ptr<const EventBus::SubscriberList> EventBus::Resolve(const SubscriberTable& table,
+                                                                  TopicId topic) {
+  std::shared_ptr<const SubscriberList> exact =
+    topic < table.exact.size() ? table.exact[topic] : nullptr;
+  return Merge(table, std::move(exact), TopicRegistry::Instance().Name(topic));
+}
+
+std::shared_ptr<const EventBus::SubscriberList> EventBus::Merge(
+    const SubscriberTable& table, std::shared_ptr<const SubscriberList> exact,
+    const std::string& name) {
+  if (!table.trie) {
+    return exact;
+  }
+  
+  std::vector<TopicTrie::PatternId> matches = table.trie->Match(name);
+  auto merged = std::make_shared<SubscriberList>();
+  if (exact) {
+    merged->assign(exact->begin(), exact->end());
+  }
+  for (TopicTrie::PatternId id : matches) {
+    if (id < table.patterns.size() && table.patterns[id]) {
+      merged->insert(merged->end(), table.patterns[id]->begin(), table.patterns[id]->end());
+    }
+  }
+  if (merged->size() == (exact ? exact->size() : 0)) {
+    return exact;  // No pattern subscriber matches: share the exact list
+  }
   
-  Logger::Instance().Debug("EventBus", 
-    "Published event '" + event.type + "' from '" + event.source + 
-    "' to " + std::to_string(handlers_to_call.size()) + " subscribers");
+  // Same order as a single list: priority (desc), then subscription order
+  std::sort(merged->begin(), merged->end(), [](const Subscriber& a, const Subscriber& b) {
+    return a.priority != b.priority ? a.priority > b.priority : a.id < b.id;
+  });
+  return merged;
 }
 
-void EventBus::Publish(const std::string& event_type, const std::string& source) {
-  Event event(event_type, source);
-  Publish(event);
+void EventBus::ResolveAll(SubscriberTable& table) {
+  table.resolved.clear();
+  ExtendResolved(table);
 }
 
-std::vector<Event> EventBus::GetHistory(size_t count) const {
-  std::lock_guard<std::mutex> lock(mutex_);
+void EventBus::ExtendResolved(SubscriberTable& table) {
+  if (table.pattern_subscribers == 0) {
+    table.resolved.clear();
+    return;
+  }
+  TopicId max_id = TopicRegistry::Instance().MaxId();
+  TopicId first = static_cast<TopicId>(std::max<size_t>(table.resolved.size(), 1));
+  if (table.resolved.size() < static_cast<size_t>(max_id) + 1) {
+    table.resolved.resize(max_id + 1);
+  }
+  for (TopicId topic = first; topic <= max_id; topic++) {
+    table.resolved[topic] = Resolve(table, topic);
+  }
+}
+
+// ========== Executors ==========
+
+std::shared_ptr<EventExecutor> EventBus::Dispatcher() {
+  {
+    EpochGuard guard;
+    if (const auto* dispatcher = dispatcher_.Load()) {
+      return *dispatcher;
+    }
+  }
   
-  if (!history_enabled_ || event_history_.empty()) {
-    return {};
+  std::lock_guard<std::mutex> lock(executors_mutex_);
+  if (const auto* dispatcher = dispatcher_.Load()) {
+    return *dispatcher;
+  }
+  auto dispatcher = std::make_shared<EventExecutor>("dispatcher", kDefaultDispatchWorkers,
+    kDefaultDispatchCapacity, EventExecutor::OverflowPolicy::DROP_OLDEST);
+  dispatcher_.Store(std::make_unique<const std::shared_ptr<EventExecutor>>(dispatcher));
+  return dispatcher;
+}
+
+void EventBus::ConfigureAsyncDispatch(size_t workers, size_t queue_capacity,
+                                      EventExecutor::OverflowPolicy policy) {
+  auto replacement = std::make_shared<EventExecutor>("dispatcher", workers, queue_capacity, policy);
+  std::shared_ptr<EventExecutor> previous;
+  {
+    std::lock_guard<std::mutex> lock(executors_mutex_);
+    if (const auto* current = dispatcher_.Load()) {
+      previous = *current;
+    }
+    dispatcher_.Store(std::make_unique<const std::shared_ptr<EventExecutor>>(replacement));
+  }
+  if (previous) {
+    previous->Stop();
   }
   
-  size_t start_index = event_history_.size() > count ? 
-                       event_history_.size() - count : 0;
+  Logger::Instance().Info("EventBus", 
+    "Async dispatch: " + std::to_string(workers) + " workers, queue " + 
+    std::to_string(queue_capacity));
+}
+
+void EventBus::RegisterExecutor(const std::string& name, size_t workers, size_t queue_capacity,
+                                EventExecutor::OverflowPolicy policy) {
+  auto executor = std::make_shared<EventExecutor>(name, workers, queue_capacity, policy);
+  std::shared_ptr<EventExecutor> previous;
+  {
+    std::lock_guard<std::mutex> lock(executors_mutex_);
+    previous = std::move(executors_[name]);
+    executors_[name] = std::move(executor);
+  }
+  // Subscribers that resolved the old executor keep it; it drops from now on
+  if (previous) {
+    previous->Stop();
+  }
   
-  return std::vector<Event>(
-    event_history_.begin() + start_index,
-    event_history_.end()
-  );
+  Logger::Instance().Info("EventBus", 
+    "Registered executor '" + name + "' (" + std::to_string(workers) + " workers, queue " + 
+    std::to_string(queue_capacity) + ")");
+}
+
+std::vector<std::shared_ptr<EventExecutor>> EventBus::AllExecutors() const {
+  std::vector<std::shared_ptr<EventExecutor>> all;
+  std::lock_guard<std::mutex> lock(executors_mutex_);
+  if (const auto* dispatcher = dispatcher_.Load()) {
+    all.push_back(*dispatcher);
+  }
+  for (const auto& pair : executors_) {
+    all.push_back(pair.second);
+  }
+  return all;
+}
+
+void EventBus::FlushAsync() {
+  // Dispatcher tasks may post to executors and executor tasks may publish
+  // asynchronously again, so repeat until one full pass finds nothing queued
+  bool busy = true;
+  while (busy) {
+    busy = false;
+    for (const auto& executor : AllExecutors()) {
+      executor->Drain();
+    }
+    for (const auto& executor : AllExecutors()) {
+      if (!executor->IsIdle() && !executor->IsWorkerThread()) {
+        busy = true;
+      }
+    }
+  }
+}
+
+std::map<std::string, EventExecutor::TopicMetrics> EventBus::GetTopicMetrics() const {
+  std::map<std::string, EventExecutor::TopicMetrics> totals;
+  for (const auto& executor : AllExecutors()) {
+    for (const auto& pair : executor->GetMetrics()) {
+      const EventExecutor::TopicMetrics& m = pair.second;
+      EventExecutor::TopicMetrics& total = totals[pair.first];
+      size_t delivered = total.delivered + m.delivered;
+      if (delivered > 0) {
+        total.avg_latency_us = (total.avg_latency_us * total.delivered +
+                                m.avg_latency_us * m.delivered) / delivered;
+      }
+      total.queued += m.queued;
+      total.max_queued = std::max(total.max_queued, m.max_queued);
+      total.enqueued += m.enqueued;
+      total.delivered = delivered;
+      total.dropped += m.dropped;
+      total.max_latency_us = std::max(total.max_latency_us, m.max_latency_us);
+    }
+  }
+  return totals;
+}
+
+void EventBus::StopExecutors() {
+  for (const auto& executor : AllExecutors()) {
+    executor->Stop();
+  }
+}
+
+std::vector<Event> EventBus::GetHistory(size_t count) const {
+  std::vector<Event> events;
+  for (const auto& event : GetRecentHistory(count)) {
+    events.push_back(*event);
+  }
+  return events;
+}
+
+std::vector<EventHistory::EventPtr> EventBus::GetRecentHistory(size_t count) const {
+  if (!history_enabled_.load(std::memory_order_relaxed)) {
+    return {};
+  }
+  return history_.Recent(count);
+}
+
+std::vector<EventHistory::EventPtr> EventBus::QueryHistory(
+    const std::string& event_type,
+    std::chrono::system_clock::duration window) const {
+  return QueryHistory(event_type, std::chrono::system_clock::now() - window,
+                      std::chrono::system_clock::time_point::max());
+}
+
+std::vector<EventHistory::EventPtr> EventBus::QueryHistory(
+    const std::string& event_type,
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to) const {
+  if (!history_enabled_.load(std::memory_order_relaxed)) {
+    return {};
+  }
+  TopicId topic = kInvalidTopic;
+  if (!event_type.empty()) {
+    topic = TopicRegistry::Instance().Find(event_type);
+    if (topic == kInvalidTopic) {
+      return {};  // Never published while history was on
+    }
+  }
+  return history_.Query(topic, from, to);
 }
 
 void EventBus::ClearHistory() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  event_history_.clear();
+  history_.Clear();
   Logger::Instance().Debug("EventBus", "Event history cleared");
 }
 
-void EventBus::SetHistoryTracking(bool enabled, size_t max_size) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  history_enabled_ = enabled;
-  max_history_size_ = max_size;
+void EventBus::SetHistoryTracking(bool enabled, size_t max_size, size_t max_bytes) {
+  history_enabled_.store(enabled, std::memory_order_relaxed);
+  history_.SetLimits(max_size, max_bytes);
   
   if (!enabled) {
-    event_history_.clear();
-  } else {
-    event_history_.reserve(max_size);
+    history_.Clear();
   }
   
   Logger::Instance().Info("EventBus", 
     std::string("Event history tracking ") + (enabled ? "enabled" : "disabled") +
-    " (max size: " + std::to_string(max_size) + ")");
+    " (max size: " + std::to_string(max_size) +
+    ", max bytes: " + std::to_string(max_bytes) + ")");
+}
+
+bool EventBus::EnableHistorySpill(const std::string& path, uint64_t max_file_bytes) {
+  if (!history_.EnableSpill(path, max_file_bytes)) {
+    Logger::Instance().Warning("EventBus", "Cannot open history spill file: " + path);
+    return false;
+  }
+  Logger::Instance().Info("EventBus", "Event history spills to " + path);
+  return true;
+}
+
+void EventBus::DisableHistorySpill() {
+  history_.DisableSpill();
+}
+
+bool EventBus::DumpHistory(const std::string& path) const {
+  return history_.Dump(path);
+}
+
+EventHistory::Stats EventBus::GetHistoryStats() const {
+  return history_.GetStats();
 }
 
 size_t EventBus::GetSubscriberCount(const std::string& event_type) const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  EpochGuard guard;
+  const SubscriberTable* table = LoadSubscribers();
+  
+  // Subscriptions made with exactly this string (a pattern counts as itself)
+  if (TopicTrie::IsPattern(event_type)) {
+    TopicTrie::PatternId id = table->trie ? table->trie->Find(event_type) : TopicTrie::kNoPattern;
+    if (id < table->patterns.size() && table->patterns[id]) {
+      return table->patterns[id]->size();
+    }
+    return 0;
+  }
   
-  auto it = subscribers_.find(event_type);
-  if (it != subscribers_.end()) {
-    return it->second.size();
+  TopicId topic = TopicRegistry::Instance().Find(event_type);
+  if (topic < table->exact.size() && table->exact[topic]) {
+    return table->exact[topic]->size();
   }
   return 0;
 }
 
 std::vector<std::string> EventBus::GetActiveEventTypes() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  EpochGuard guard;
+  const SubscriberTable* table = LoadSubscribers();
   
   std::vector<std::string> types;
-  types.reserve(subscribers_.size());
-  
-  for (const auto& pair : subscribers_) {
-    if (!pair.second.empty()) {
-      types.push_back(pair.first);
+  for (TopicId topic = 0; topic < table->exact.size(); topic++) {
+    if (table->exact[topic] && !table->exact[topic]->empty()) {
+      types.push_back(TopicRegistry::Instance().Name(topic));
+    }
+  }
+  for (TopicTrie::PatternId id = 0; id < table->patterns.size(); id++) {
+    if (table->patterns[id] && !table->patterns[id]->empty()) {
+      types.push_back(table->trie->Pattern(id));
     }
   }
+  std::sort(types.begin(), types.end());
   
   return types;
 }
 
 void EventBus::Clear() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  subscribers_.clear();
-  event_history_.clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StoreSubscribers(std::make_unique<const SubscriberTable>());
+  }
+  history_.Clear();
   Logger::Instance().Info("EventBus", "All subscriptions cleared");
 }
 
@@ -8,12 +8,24 @@
 #include <mutex>
 #include <memory>
 #include <any>
+#include <atomic>
 #include <chrono>
+#include <optional>
+#include <type_traits>
+
+#include "event_executor.h"
+#include "event_history.h"
+#include "event_timer.h"
+#include "event_topic.h"
+#include "event_topic_trie.h"
+#include "snapshot_ptr.h"
 
 namespace anywp_engine {
 
 /**
  * @brief Event data structure
+ * 
+ * The string API. Typed structs (event_types.h) avoid the map and std::any.
  */
 struct Event {
   std::string type;                          // Event type (e.g., "wallpaper.initialized")
@@ -23,8 +35,8 @@ struct Event {
   
   Event(const std::string& event_type, const std::string& event_source = "")
     : type(event_type), 
-      source(event_source),
-      timestamp(std::chrono::system_clock::now()) {}
+      timestamp(std::chrono::system_clock::now()),
+      source(event_source) {}
   
   // Helper to get typed data
   template<typename T>
@@ -57,15 +69,17 @@ using EventHandler = std::function<void(const Event&)>;
  */
 class EventSubscription {
 public:
-  EventSubscription(int id, const std::string& event_type)
-    : id_(id), event_type_(event_type) {}
+  EventSubscription(int id, const std::string& event_type, TopicId topic = kInvalidTopic)
+    : id_(id), event_type_(event_type), topic_(topic) {}
   
   int GetId() const { return id_; }
   const std::string& GetEventType() const { return event_type_; }
+  TopicId GetTopicId() const { return topic_; }
   
 private:
   int id_;
   std::string event_type_;
+  TopicId topic_;
 };
 
 /**
@@ -77,7 +91,21 @@ private:
  * - Unsubscribe using subscription handle
  * - Event filtering and prioritization
  * - Thread-safe operations
- * - Event history tracking
+ * - Event history tracking (bounded ring, queries by topic and time window)
+ * - Lock-free, copy-free Publish (copy-on-write subscriber snapshots)
+ * - PublishAsync and per-subscriber delivery (inline, async, named executor)
+ *   on bounded queues with an overflow policy and per-topic metrics
+ * - Interned integer topics and typed payloads (no map, no std::any)
+ * - Wildcard subscriptions ("wallpaper.*", "wallpaper.**")
+ * - Per-topic coalescing and debounce for bursty topics, on one shared timer
+ * 
+ * Subscriber lists live in an immutable snapshot that Publish reads through
+ * a SnapshotPtr (epoch-based reclamation, snapshot_ptr.h): no mutex, no
+ * spinlock, no copy of the handler list. Subscribe,
+ * Unsubscribe and Clear build a new snapshot under a writer mutex and swap
+ * it in. A publish that is already running keeps the snapshot it started
+ * with, so a handler may still run once after Unsubscribe() returns, and
+ * handlers may (un)subscribe from inside a callback.
  * 
  * Usage:
  *   // Subscribe to events
@@ -96,6 +124,84 @@ private:
  *   // Unsubscribe
  *   EventBus::Instance().Unsubscribe(sub);
  * 
+ * Typed Events:
+ *   Topics are interned to TopicIds (event_topic.h); routing never compares
+ *   strings. Structs from event_types.h (or any struct declaring kTopicId or
+ *   kTopic) are published and received as-is:
+ *   
+ *   EventBus::Instance().Subscribe<MonitorChanged>([](const MonitorChanged& m) {
+ *     RebuildLayout(m.monitor_count);
+ *   });
+ *   EventBus::Instance().Publish(MonitorChanged{3, 0});
+ *   
+ *   The string API is an adapter over the same table: Publish(Event) resolves
+ *   event.type to its TopicId, and string subscribers of a typed topic get an
+ *   Event with the struct under GetData<T>("payload"). Typed subscribers only
+ *   receive their own struct type.
+ * 
+ * Wildcard Subscriptions:
+ *   A string subscription whose topic has a "*" segment (exactly one
+ *   segment) or a "**" segment (one or more) is a pattern; see
+ *   event_topic_trie.h. Patterns are compiled into a TopicTrie when they are
+ *   subscribed, and each snapshot caches the merged subscriber list (exact +
+ *   matching patterns, by priority) per concrete topic. Publish reads that
+ *   list like any other: there is no pattern matching per publish, except
+ *   once for a topic first seen after the last (un)subscribe.
+ *   
+ *   EventBus::Instance().Subscribe("wallpaper.**", [](const Event& e) {
+ *     Trace(e.type);  // wallpaper.stopped, wallpaper.navigation.started, ...
+ *   });
+ * 
+ * Asynchronous Delivery:
+ *   PublishAsync() queues the event on the dispatcher (default: 1 worker,
+ *   1024 events, DROP_OLDEST; see ConfigureAsyncDispatch) and returns at once;
+ *   a dispatcher worker then delivers it. Independently, each subscriber
+ *   chooses where its handler runs:
+ *   - Delivery::INLINE   - on the thread that delivers the event (default)
+ *   - Delivery::ASYNC    - posted to the dispatcher, even from Publish()
+ *   - Delivery::EXECUTOR - posted to a named executor (RegisterExecutor)
+ *   With one dispatcher worker, asynchronously delivered events keep publish
+ *   order. FlushAsync() waits until every queue is empty.
+ * 
+ *   EventBus::Instance().RegisterExecutor("ui", 1, 256,
+ *     EventExecutor::OverflowPolicy::BLOCK);
+ *   EventBus::SubscribeOptions options;
+ *   options.delivery = EventBus::Delivery::EXECUTOR;
+ *   options.executor = "ui";
+ *   EventBus::Instance().Subscribe("monitor.changed", handler, options);
+ *   EventBus::Instance().PublishAsync(Event("monitor.changed", "DisplayManager"));
+ * 
+ * Coalescing:
+ *   Display hot-plug, resize and power transitions arrive in bursts. A topic
+ *   can be given a policy so that a burst reaches subscribers once:
+ *   - Coalesce::LATEST            - the first event opens a window; when it
+ *                                   closes, the latest event is delivered
+ *   - Coalesce::COUNT             - as LATEST; Event payloads also carry
+ *                                   GetData<size_t>("coalesced_count")
+ *   - Coalesce::DEBOUNCE_LEADING  - the first event is delivered at once;
+ *                                   the rest are dropped until the topic has
+ *                                   been quiet for a whole window
+ *   - Coalesce::DEBOUNCE_TRAILING - only the last event is delivered, once
+ *                                   the topic has been quiet for a window
+ *   Windows run on one shared EventTimer (event_timer.h). Deferred
+ *   deliveries go through the dispatcher, like PublishAsync. Topics without
+ *   a policy pay one relaxed atomic load.
+ *   
+ *   EventBus::Instance().SetCoalescing("monitor.changed",
+ *     EventBus::Coalesce::DEBOUNCE_TRAILING, std::chrono::milliseconds(200));
+ * 
+ * Event History:
+ *   Off by default. When enabled, published events go to an EventHistory
+ *   ring (event_history.h) bounded by an event count and a byte ceiling.
+ *   GetRecentHistory() and QueryHistory() share the stored events instead of
+ *   copying them (GetHistory() still returns copies). Queries go through the
+ *   topic index:
+ *   
+ *   EventBus::Instance().SetHistoryTracking(true, 1000, 1024 * 1024);
+ *   EventBus::Instance().EnableHistorySpill("events.log");
+ *   auto recent = EventBus::Instance().QueryHistory("monitor.changed",
+ *                                                   std::chrono::seconds(30));
+ * 
  * Common Event Types:
  * - "wallpaper.initialized" - Wallpaper initialization completed
  * - "wallpaper.stopped" - Wallpaper stopped
@@ -113,12 +219,34 @@ private:
  */
 class EventBus {
 public:
+  // Where a subscriber's handler runs
+  enum class Delivery {
+    INLINE,    // On the delivering thread (publisher, or dispatcher for PublishAsync)
+    ASYNC,     // Posted to the dispatcher pool
+    EXECUTOR   // Posted to the executor named in SubscribeOptions::executor
+  };
+  
+  // Per-topic burst policy (see "Coalescing" above)
+  enum class Coalesce {
+    NONE,
+    LATEST,
+    COUNT,
+    DEBOUNCE_LEADING,
+    DEBOUNCE_TRAILING
+  };
+  
+  struct SubscribeOptions {
+    int priority = 0;
+    Delivery delivery = Delivery::INLINE;
+    std::string executor;  // For Delivery::EXECUTOR
+  };
+  
   static EventBus& Instance();
   
   /**
    * Subscribe to an event type
    * 
-   * @param event_type Event type to listen for
+   * @param event_type Event type to listen for, or a pattern ("wallpaper.*", "wallpaper.**")
    * @param handler Callback function to invoke when event occurs
    * @param priority Higher priority handlers are invoked first (default: 0)
    * @return Subscription handle for unsubscribing
@@ -131,6 +259,30 @@ public:
     int priority = 0
   );
   
+  /**
+   * Subscribe with a delivery mode
+   * 
+   * An unknown executor name falls back to the dispatcher (with a warning).
+   * 
+   * Thread-safe: Yes
+   */
+  std::shared_ptr<EventSubscription> Subscribe(
+    const std::string& event_type,
+    EventHandler handler,
+    const SubscribeOptions& options
+  );
+  
+  /**
+   * Subscribe to a typed event (T declares kTopicId or kTopic)
+   * 
+   * Thread-safe: Yes
+   */
+  template <typename T>
+  std::shared_ptr<EventSubscription> Subscribe(
+    std::function<void(const T&)> handler,
+    const SubscribeOptions& options = SubscribeOptions()
+  );
+  
   /**
    * Unsubscribe from events
    * 
@@ -159,16 +311,136 @@ public:
    */
   void Publish(const std::string& event_type, const std::string& source = "");
   
+  /**
+   * Queue an event for delivery on the dispatcher and return immediately
+   * 
+   * @param event Event to publish
+   * @return false if the event was dropped by the overflow policy
+   * 
+   * Thread-safe: Yes
+   */
+  bool PublishAsync(const Event& event);
+  
+  /**
+   * Publish a typed event; inline subscribers get a reference to `payload`
+   * 
+   * Thread-safe: Yes
+   */
+  template <typename T, typename = std::enable_if_t<IsTypedEvent<std::decay_t<T>>>>
+  void Publish(T&& payload);
+  
+  /**
+   * Queue a typed event; the payload is moved into the queued task
+   * 
+   * @return false if the event was dropped by the overflow policy
+   * 
+   * Thread-safe: Yes
+   */
+  template <typename T, typename = std::enable_if_t<IsTypedEvent<std::decay_t<T>>>>
+  bool PublishAsync(T&& payload);
+  
+  /**
+   * Replace the dispatcher pool used by PublishAsync and Delivery::ASYNC
+   * 
+   * Events queued on the previous dispatcher are delivered first. Intended
+   * for startup, before the first asynchronous publish.
+   * 
+   * Thread-safe: Yes
+   */
+  void ConfigureAsyncDispatch(size_t workers, size_t queue_capacity,
+                              EventExecutor::OverflowPolicy policy);
+  
+  /**
+   * Create (or replace) a named executor for Delivery::EXECUTOR subscribers
+   * 
+   * Subscribers resolve the name when they subscribe.
+   * 
+   * Thread-safe: Yes
+   */
+  void RegisterExecutor(const std::string& name, size_t workers, size_t queue_capacity,
+                        EventExecutor::OverflowPolicy policy);
+  
+  /**
+   * Wait until the dispatcher and every executor are idle
+   * 
+   * Thread-safe: Yes (returns without waiting for the caller's own pool)
+   */
+  void FlushAsync();
+  
+  /**
+   * Queue metrics per topic, summed over the dispatcher and all executors
+   * 
+   * Thread-safe: Yes
+   */
+  std::map<std::string, EventExecutor::TopicMetrics> GetTopicMetrics() const;
+  
+  /**
+   * Set the burst policy of one topic (Coalesce::NONE removes it)
+   * 
+   * An event held by the previous policy is delivered right away.
+   * 
+   * @param event_type Concrete event type (not a pattern)
+   * @param mode Coalescing policy
+   * @param window Coalescing window or quiet period
+   * 
+   * Thread-safe: Yes
+   */
+  void SetCoalescing(const std::string& event_type, Coalesce mode,
+                     std::chrono::milliseconds window);
+  
+  /**
+   * Replace the timer behind coalescing windows (nullptr = real-time default)
+   * 
+   * Tests pass an EventTimer in VIRTUAL mode and call Advance(). Events held
+   * on the previous timer are delivered right away.
+   * 
+   * Thread-safe: Yes
+   */
+  void SetTimer(std::shared_ptr<EventTimer> timer);
+  
   /**
    * Get event history (last N events)
    * 
    * @param count Number of recent events to retrieve (default: 100)
-   * @return Vector of recent events
+   * @return Vector of recent events (copies; see GetRecentHistory)
    * 
    * Thread-safe: Yes
    */
   std::vector<Event> GetHistory(size_t count = 100) const;
   
+  /**
+   * Get event history (last N events) without copying them
+   * 
+   * @param count Number of recent events to retrieve (default: 100)
+   * @return Recent events, oldest first (shared with the history)
+   * 
+   * Thread-safe: Yes
+   */
+  std::vector<EventHistory::EventPtr> GetRecentHistory(size_t count = 100) const;
+  
+  /**
+   * Get events of one type recorded within `window` before now
+   * 
+   * @param event_type Event type ("" = every type)
+   * @param window Time window, e.g. std::chrono::seconds(30)
+   * @return Matching events, oldest first
+   * 
+   * Thread-safe: Yes
+   */
+  std::vector<EventHistory::EventPtr> QueryHistory(
+    const std::string& event_type,
+    std::chrono::system_clock::duration window) const;
+  
+  /**
+   * Get events of one type recorded in [from, to]
+   * 
+   * Thread-safe: Yes
+   */
+  std::vector<EventHistory::EventPtr> QueryHistory(
+    const std::string& event_type,
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to) const;
+  
   /**
    * Clear event history
    * 
@@ -180,17 +452,47 @@ public:
    * Enable/disable event history tracking
    * 
    * @param enabled true to enable history tracking
-   * @param max_size Maximum history size (default: 1000)
+   * @param max_size Maximum number of stored events (default: 1000)
+   * @param max_bytes Memory ceiling for stored events (default: 1 MB)
    * 
    * Thread-safe: Yes
    */
-  void SetHistoryTracking(bool enabled, size_t max_size = 1000);
+  void SetHistoryTracking(bool enabled, size_t max_size = EventHistory::kDefaultMaxEvents,
+                          size_t max_bytes = EventHistory::kDefaultMaxBytes);
+  
+  /**
+   * Append events evicted from the history to a file, for postmortems
+   * 
+   * @param path Spill file (rotated once to "<path>.1")
+   * @param max_file_bytes Size at which the spill file rotates
+   * @return false if the file cannot be opened
+   * 
+   * Thread-safe: Yes
+   */
+  bool EnableHistorySpill(const std::string& path,
+                          uint64_t max_file_bytes = EventHistory::kDefaultSpillBytes);
+  void DisableHistorySpill();
+  
+  /**
+   * Write every stored event to a file (overwrites)
+   * 
+   * Thread-safe: Yes
+   */
+  bool DumpHistory(const std::string& path) const;
+  
+  /**
+   * History counters: stored events, estimated bytes, evictions, spills
+   * 
+   * Thread-safe: Yes
+   */
+  EventHistory::Stats GetHistoryStats() const;
   
   /**
    * Get subscription count for an event type
    * 
-   * @param event_type Event type
-   * @return Number of active subscriptions
+   * @param event_type Event type or pattern
+   * @return Number of subscriptions made with exactly this string
+   *         (wildcard subscribers that match it are not counted)
    * 
    * Thread-safe: Yes
    */
@@ -199,7 +501,7 @@ public:
   /**
    * Get all active event types
    * 
-   * @return Vector of event types with active subscriptions
+   * @return Vector of event types and patterns with active subscriptions
    * 
    * Thread-safe: Yes
    */
@@ -219,27 +521,158 @@ private:
   EventBus(const EventBus&) = delete;
   EventBus& operator=(const EventBus&) = delete;
   
+  // Handlers see the payload through a pointer to the Event or typed struct
+  using PayloadHandler = std::function<void(const void*)>;
+  
+  // A payload being delivered: an Event or a typed struct, never copied for
+  // inline delivery
+  struct Payload {
+    const void* data;
+    const void* type;                                   // PayloadTypeOf<T>()
+    std::shared_ptr<const void> shared;                 // Heap copy for posted tasks
+    std::shared_ptr<const void> (*copy)(const void*);   // Makes `shared`
+    Event (*to_event)(TopicId, const void*);            // String-API adapter; nullptr for Event
+  };
+  
   struct Subscriber {
     int id;
-    EventHandler handler;
+    PayloadHandler handler;
+    const void* payload_type;                 // PayloadTypeOf<T>() the handler expects
     int priority;
-    
-    bool operator<(const Subscriber& other) const {
-      return priority > other.priority;  // Higher priority first
-    }
+    Delivery delivery;
+    std::shared_ptr<EventExecutor> executor;  // Delivery::EXECUTOR only
   };
   
-  int next_subscription_id_;
-  std::map<std::string, std::vector<Subscriber>> subscribers_;
+  // Immutable once published; ordered by priority (desc), then subscription order
+  using SubscriberList = std::vector<Subscriber>;
+  using SubscriberLists = std::vector<std::shared_ptr<const SubscriberList>>;
+  
+  // The snapshot Publish reads; immutable once published
+  struct SubscriberTable {
+    SubscriberLists exact;     // Index = TopicId; null for topics without subscribers
+    SubscriberLists patterns;  // Index = TopicTrie::PatternId; null once all unsubscribed
+    std::shared_ptr<const TopicTrie> trie;  // Patterns with subscribers; null if none
+    size_t pattern_subscribers = 0;
+    // Index = TopicId; exact + matching pattern subscribers while
+    // pattern_subscribers > 0 (exact is used otherwise). Topics interned
+    // later are resolved on first publish and appended when mutex_ is free.
+    SubscriberLists resolved;
+  };
+  
+  template <typename T>
+  static std::shared_ptr<const void> CopyPayload(const void* data) {
+    return std::make_shared<const T>(*static_cast<const T*>(data));
+  }
+  
+  template <typename T>
+  static Event PayloadToEvent(TopicId topic, const void* data) {
+    Event event(TopicRegistry::Instance().Name(topic));
+    event.SetData("payload", *static_cast<const T*>(data));
+    return event;
+  }
+  
+  template <typename T>
+  static Payload MakePayload(const T& data) {
+    return {&data, PayloadTypeOf<T>(), nullptr, &CopyPayload<T>, &PayloadToEvent<T>};
+  }
+  
+  // A coalesced topic: the policy and the event held for the window
+  struct CoalesceState {
+    Coalesce mode = Coalesce::NONE;
+    EventTimer::Clock::duration window{};
+    std::optional<Payload> pending;            // Owns its data (Payload::shared)
+    size_t count = 0;                          // Events folded into `pending`
+    bool armed = false;                        // Window open
+    EventTimer::Clock::time_point deadline;
+    uint64_t generation = 0;                   // Ignores timers of a replaced policy
+  };
+  
+  // `pattern` is empty for exact subscriptions, else topic is kInvalidTopic
+  std::shared_ptr<EventSubscription> SubscribeInternal(
+    TopicId topic, const std::string& pattern, PayloadHandler handler,
+    const void* payload_type, const SubscribeOptions& options);
+  void PublishPayload(TopicId topic, Payload& payload);
+  bool PublishPayloadAsync(TopicId topic, Payload payload);
+  
+  const SubscriberTable* LoadSubscribers() const;  // Requires an EpochGuard or mutex_
+  void StoreSubscribers(std::unique_ptr<const SubscriberTable> table);  // Requires mutex_
+  
+  // Subscribers of `topic` in `table`, patterns included
+  std::shared_ptr<const SubscriberList> SubscribersOf(const SubscriberTable& table, TopicId topic);
+  // Merged list for one topic, for a name (exact list given), for every
+  // interned topic, and for the topics interned since `resolved` was filled
+  static std::shared_ptr<const SubscriberList> Resolve(const SubscriberTable& table, TopicId topic);
+  static std::shared_ptr<const SubscriberList> Merge(
+    const SubscriberTable& table, std::shared_ptr<const SubscriberList> exact,
+    const std::string& name);
+  static void ResolveAll(SubscriberTable& table);
+  static void ExtendResolved(SubscriberTable& table);
+  
+  void RecordHistory(TopicId topic, const Payload& payload);
+  // True if the topic's policy holds or drops the event instead of delivering it now
+  bool Coalesced(TopicId topic, const Payload& payload);
+  void FireCoalesced(TopicId topic, uint64_t generation);
+  void DeliverCoalesced(TopicId topic, Payload payload);  // Via the dispatcher
+  std::shared_ptr<EventTimer> Timer();  // Requires coalesce_mutex_; created on first use
+  // Runs INLINE handlers and posts the others; on_dispatcher runs ASYNC ones in place
+  void Deliver(TopicId topic, Payload& payload, bool on_dispatcher);
+  // Same for an Event whose name was never interned: only patterns can match
+  void DeliverByName(const Event& event, Payload& payload, bool on_dispatcher);
+  void DeliverTo(const std::shared_ptr<const SubscriberList>& list, TopicId topic,
+                 const std::string& name, Payload& payload, bool on_dispatcher);
+  std::shared_ptr<EventExecutor> Dispatcher();  // Created on first use
+  std::vector<std::shared_ptr<EventExecutor>> AllExecutors() const;
+  void StopExecutors();
+  
+  int next_subscription_id_;               // Guarded by mutex_
+  SnapshotPtr<SubscriberTable> subscribers_;
   
   // Event history
-  bool history_enabled_;
-  size_t max_history_size_;
-  std::vector<Event> event_history_;
+  std::atomic<bool> history_enabled_;
+  EventHistory history_;
+  
+  mutable std::mutex mutex_;  // Serializes snapshot writers (Subscribe/Unsubscribe/Clear)
+  
+  // Coalescing
+  std::atomic<size_t> coalesced_topics_;
+  std::map<TopicId, CoalesceState> coalescing_;  // Guarded by coalesce_mutex_
+  uint64_t next_coalesce_generation_ = 0;        // Guarded by coalesce_mutex_
+  std::shared_ptr<EventTimer> timer_;            // Guarded by coalesce_mutex_
+  std::mutex coalesce_mutex_;
   
-  mutable std::mutex mutex_;
+  // Asynchronous delivery
+  SnapshotPtr<std::shared_ptr<EventExecutor>> dispatcher_;  // Stored under executors_mutex_
+  std::map<std::string, std::shared_ptr<EventExecutor>> executors_;  // Guarded by executors_mutex_
+  mutable std::mutex executors_mutex_;
 };
 
+// ========== Typed API ==========
+
+template <typename T>
+std::shared_ptr<EventSubscription> EventBus::Subscribe(
+    std::function<void(const T&)> handler,
+    const SubscribeOptions& options) {
+  return SubscribeInternal(TopicOf<T>(), std::string(),
+    [handler = std::move(handler)](const void* data) { handler(*static_cast<const T*>(data)); },
+    PayloadTypeOf<T>(), options);
+}
+
+template <typename T, typename>
+void EventBus::Publish(T&& payload) {
+  using Type = std::decay_t<T>;
+  Payload erased = MakePayload<Type>(payload);
+  PublishPayload(TopicOf<Type>(), erased);
+}
+
+template <typename T, typename>
+bool EventBus::PublishAsync(T&& payload) {
+  using Type = std::decay_t<T>;
+  auto shared = std::make_shared<const Type>(std::forward<T>(payload));
+  Payload erased = MakePayload<Type>(*shared);
+  erased.shared = std::move(shared);
+  return PublishPayloadAsync(TopicOf<Type>(), std::move(erased));
+}
+
 }  // namespace anywp_engine
 
 #endif  // ANYWP_ENGINE_EVENT_BUS_H_
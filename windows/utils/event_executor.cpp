@@ -0,0 +1,195 @@
+#include "event_executor.h"
+#include "hot_path.h"
+#include "logger.h"
+#include <algorithm>
+
+namespace anywp_engine {
+
+namespace {
+
+// Queue state of the executor whose worker is running on this thread
+// (nullptr elsewhere)
+thread_local const void* t_current_state = nullptr;
+
+}  // namespace
+
+EventExecutor::EventExecutor(const std::string& name, size_t workers, size_t capacity,
+                             OverflowPolicy policy)
+    : state_(std::make_shared<State>(name, std::max<size_t>(capacity, 1), policy)) {
+  size_t count = std::max<size_t>(workers, 1);
+  workers_.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    workers_.emplace_back(&EventExecutor::WorkerLoop, state_);
+  }
+}
+
+EventExecutor::~EventExecutor() {
+  Stop();
+}
+
+bool EventExecutor::Post(const std::string& topic, Task task) {
+  State& state = *state_;
+  std::unique_lock<std::mutex> lock(state.mutex);
+
+  while (!state.stopping && state.queue.size() >= state.capacity) {
+    // A worker waiting on its own queue would never wake; a hot-path thread
+    // (hook callback, message receive) must not wait at all
+    if (state.policy == OverflowPolicy::DROP_NEWEST ||
+        (state.policy == OverflowPolicy::BLOCK && (IsWorkerThread() || HotPathScope::IsActive()))) {
+      CountDropped(state, topic);
+      return false;
+    }
+    if (state.policy == OverflowPolicy::DROP_OLDEST) {
+      Item& oldest = state.queue.front();
+      TopicStats& oldest_stats = StatsFor(state, oldest.topic);
+      oldest_stats.queued--;
+      oldest_stats.dropped++;
+      state.queue.pop_front();
+      break;
+    }
+    state.space_cv.wait(lock);
+  }
+
+  if (state.stopping) {
+    CountDropped(state, topic);
+    return false;
+  }
+
+  TopicStats& stats = StatsFor(state, topic);
+  stats.enqueued++;
+  stats.queued++;
+  stats.max_queued = std::max(stats.max_queued, stats.queued);
+  state.queue.push_back({topic, std::move(task), Clock::now()});
+
+  lock.unlock();
+  state.work_cv.notify_one();
+  return true;
+}
+
+void EventExecutor::Drain() {
+  if (IsWorkerThread()) {
+    return;
+  }
+  State& state = *state_;
+  std::unique_lock<std::mutex> lock(state.mutex);
+  state.idle_cv.wait(lock, [&state] { return state.queue.empty() && state.running == 0; });
+}
+
+void EventExecutor::Stop() {
+  std::lock_guard<std::mutex> stop_lock(stop_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->stopping = true;
+  }
+  state_->work_cv.notify_all();
+  state_->space_cv.notify_all();
+
+  for (auto& worker : workers_) {
+    if (!worker.joinable()) {
+      continue;
+    }
+    if (worker.get_id() == std::this_thread::get_id()) {
+      // Stopped (or destroyed) from its own task: the worker finishes that
+      // task and the queue on its own reference to state_
+      worker.detach();
+    } else {
+      worker.join();
+    }
+  }
+}
+
+bool EventExecutor::IsIdle() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->queue.empty() && state_->running == 0;
+}
+
+bool EventExecutor::IsWorkerThread() const {
+  return t_current_state == state_.get();
+}
+
+std::map<std::string, EventExecutor::TopicMetrics> EventExecutor::GetMetrics() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+
+  std::map<std::string, TopicMetrics> metrics;
+  for (const auto& pair : state_->stats) {
+    const TopicStats& stats = pair.second;
+    TopicMetrics& m = metrics[pair.first];
+    m.queued = stats.queued;
+    m.max_queued = stats.max_queued;
+    m.enqueued = stats.enqueued;
+    m.delivered = stats.delivered;
+    m.dropped = stats.dropped;
+    m.avg_latency_us = stats.delivered > 0 ? stats.total_latency_us / stats.delivered : 0.0;
+    m.max_latency_us = stats.max_latency_us;
+  }
+  return metrics;
+}
+
+void EventExecutor::WorkerLoop(std::shared_ptr<State> state_ref) {
+  State& state = *state_ref;
+  t_current_state = &state;
+
+  std::unique_lock<std::mutex> lock(state.mutex);
+  while (true) {
+    state.work_cv.wait(lock, [&state] { return state.stopping || !state.queue.empty(); });
+    if (state.queue.empty()) {
+      break;  // Stopping and fully drained
+    }
+
+    Item item = std::move(state.queue.front());
+    state.queue.pop_front();
+    state.running++;
+
+    double latency_us = std::chrono::duration<double, std::micro>(
+        Clock::now() - item.enqueued).count();
+    TopicStats& stats = StatsFor(state, item.topic);
+    stats.queued--;
+    stats.delivered++;
+    stats.total_latency_us += latency_us;
+    stats.max_latency_us = std::max(stats.max_latency_us, latency_us);
+
+    lock.unlock();
+    state.space_cv.notify_one();
+
+    try {
+      item.task();
+    } catch (const std::exception& e) {
+      Logger::Instance().Error("EventExecutor",
+        "Exception in task for '" + item.topic + "' on '" + state.name + "': " + e.what());
+    } catch (...) {
+      Logger::Instance().Error("EventExecutor",
+        "Unknown exception in task for '" + item.topic + "' on '" + state.name + "'");
+    }
+    // Release captures before reporting idle; this may destroy the executor
+    item.task = nullptr;
+
+    lock.lock();
+    state.running--;
+    if (state.queue.empty() && state.running == 0) {
+      state.idle_cv.notify_all();
+    }
+  }
+
+  state.idle_cv.notify_all();
+  lock.unlock();
+  t_current_state = nullptr;
+}
+
+EventExecutor::TopicStats& EventExecutor::StatsFor(State& state, const std::string& topic) {
+  auto it = state.stats.find(topic);
+  if (it != state.stats.end()) {
+    return it->second;
+  }
+  // Entries are never removed, so a topic resolves to the same entry from
+  // Post() to the end of its task
+  if (state.stats.size() >= kMaxTopics) {
+    return state.stats[kOtherTopics];
+  }
+  return state.stats[topic];
+}
+
+void EventExecutor::CountDropped(State& state, const std::string& topic) {
+  StatsFor(state, topic).dropped++;
+}
+
+}  // namespace anywp_engine
@@ -0,0 +1,144 @@
+#ifndef ANYWP_ENGINE_EVENT_EXECUTOR_H_
+#define ANYWP_ENGINE_EVENT_EXECUTOR_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace anywp_engine {
+
+/**
+ * EventExecutor - Bounded task queue drained by a small worker pool
+ *
+ * Used by EventBus for PublishAsync and for subscribers that asked for
+ * asynchronous or named-executor delivery, so that a slow handler never runs
+ * on the publisher's thread (display-change WndProc, power-state thread).
+ *
+ * Features:
+ * - Fixed capacity; a full queue applies the executor's OverflowPolicy
+ * - Tasks run in FIFO order; with one worker they also complete in order
+ * - Per-topic metrics: current and peak queue depth, enqueued, delivered,
+ *   dropped, and queue latency (enqueue to start of execution). At most
+ *   kMaxTopics topics get their own entry; later ones share kOtherTopics
+ * - Stop() (and the destructor) runs every queued task before joining
+ * - Stopping or destroying an executor from one of its own tasks is safe:
+ *   that worker is detached and keeps the queue state alive (workers share
+ *   it through a shared_ptr) until it has finished
+ *
+ * Usage:
+ *   EventExecutor executor("ui", 1, 256, EventExecutor::OverflowPolicy::BLOCK);
+ *   executor.Post("monitor.changed", [] { ... });
+ *   executor.Drain();  // Wait until the queue is empty and no task is running
+ *
+ * Thread-safe: Yes
+ */
+class EventExecutor {
+public:
+  using Task = std::function<void()>;
+
+  // What Post() does when the queue is full
+  enum class OverflowPolicy {
+    DROP_OLDEST,  // Discard the oldest queued task to make room
+    DROP_NEWEST,  // Discard the task being posted
+    BLOCK         // Wait for a free slot (workers of this executor and hot-path threads drop instead)
+  };
+
+  // Per-topic metrics entries, and the one every topic beyond them shares
+  static constexpr size_t kMaxTopics = 256;
+  static constexpr const char* kOtherTopics = "(other)";
+
+  struct TopicMetrics {
+    size_t queued = 0;          // Tasks waiting right now
+    size_t max_queued = 0;      // Peak of `queued`
+    size_t enqueued = 0;
+    size_t delivered = 0;
+    size_t dropped = 0;
+    double avg_latency_us = 0.0;  // Enqueue to start of execution
+    double max_latency_us = 0.0;
+  };
+
+  EventExecutor(const std::string& name, size_t workers, size_t capacity, OverflowPolicy policy);
+  ~EventExecutor();
+
+  EventExecutor(const EventExecutor&) = delete;
+  EventExecutor& operator=(const EventExecutor&) = delete;
+
+  // Queue a task; false if this task was dropped (full queue or stopped)
+  bool Post(const std::string& topic, Task task);
+
+  // Wait until the queue is empty and no task is running (no-op on a worker)
+  void Drain();
+
+  // Run what is queued, then join the workers; later Post() calls drop
+  void Stop();
+
+  // True when nothing is queued or running
+  bool IsIdle() const;
+
+  // True when called from one of this executor's workers
+  bool IsWorkerThread() const;
+
+  const std::string& Name() const { return state_->name; }
+  size_t Capacity() const { return state_->capacity; }
+  OverflowPolicy Policy() const { return state_->policy; }
+
+  std::map<std::string, TopicMetrics> GetMetrics() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Item {
+    std::string topic;
+    Task task;
+    Clock::time_point enqueued;
+  };
+
+  struct TopicStats {
+    size_t queued = 0;
+    size_t max_queued = 0;
+    size_t enqueued = 0;
+    size_t delivered = 0;
+    size_t dropped = 0;
+    double total_latency_us = 0.0;
+    double max_latency_us = 0.0;
+  };
+
+  // Everything a worker touches; each worker holds a reference, so one
+  // detached by Stop() outlives the executor safely
+  struct State {
+    State(const std::string& name, size_t capacity, OverflowPolicy policy)
+        : name(name), capacity(capacity), policy(policy) {}
+
+    const std::string name;
+    const size_t capacity;
+    const OverflowPolicy policy;
+
+    std::deque<Item> queue;                          // Guarded by mutex
+    std::map<std::string, TopicStats, std::less<>> stats;  // Guarded by mutex; see StatsFor()
+    size_t running = 0;                              // Tasks executing; guarded by mutex
+    bool stopping = false;                           // Guarded by mutex
+    mutable std::mutex mutex;
+    std::condition_variable work_cv;   // Wakes workers
+    std::condition_variable space_cv;  // Wakes producers blocked on a full queue
+    std::condition_variable idle_cv;   // Wakes Drain()
+  };
+
+  static void WorkerLoop(std::shared_ptr<State> state);
+  static TopicStats& StatsFor(State& state, const std::string& topic);  // Requires state.mutex
+  static void CountDropped(State& state, const std::string& topic);  // Requires state.mutex
+
+  const std::shared_ptr<State> state_;
+  std::vector<std::thread> workers_;
+  std::mutex stop_mutex_;             // Serializes Stop()
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_EVENT_EXECUTOR_H_
@@ -0,0 +1,383 @@
+#include "event_history.h"
+#include "event_bus.h"
+#include "log_formatter.h"
+#include "log_payload.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+namespace anywp_engine {
+
+namespace {
+
+// std::string keeps up to 15 chars inline in all three major standard libraries
+constexpr size_t kInlineStringCapacity = 15;
+
+// Map node header (links, color) on top of the key/value pair
+constexpr size_t kMapNodeOverhead = 32;
+
+// shared_ptr control block allocated alongside each stored event
+constexpr size_t kSharedControlBlock = 16;
+
+// Heap payload assumed for std::any values of types we cannot see into
+constexpr size_t kOpaqueValueBytes = 32;
+
+// Buffered spill lines are flushed at least this often
+constexpr auto kSpillFlushInterval = std::chrono::seconds(1);
+
+// Evicted events waiting for the spill writer; further ones are not spilled
+constexpr size_t kSpillQueueCapacity = 4096;
+
+// While spilling, 1/kSpillShare of the byte ceiling holds the events
+// waiting for the writer
+constexpr size_t kSpillShare = 4;
+
+size_t StringHeapBytes(const std::string& s) {
+  return s.capacity() > kInlineStringCapacity ? s.capacity() + 1 : 0;
+}
+
+std::string FormatValue(const std::any& value) {
+  if (auto v = std::any_cast<int>(&value)) return std::to_string(*v);
+  if (auto v = std::any_cast<unsigned int>(&value)) return std::to_string(*v);
+  if (auto v = std::any_cast<long>(&value)) return std::to_string(*v);
+  if (auto v = std::any_cast<long long>(&value)) return std::to_string(*v);
+  if (auto v = std::any_cast<unsigned long>(&value)) return std::to_string(*v);
+  if (auto v = std::any_cast<unsigned long long>(&value)) return std::to_string(*v);
+  if (auto v = std::any_cast<double>(&value)) return std::to_string(*v);
+  if (auto v = std::any_cast<float>(&value)) return std::to_string(*v);
+  if (auto v = std::any_cast<bool>(&value)) return *v ? "true" : "false";
+  if (auto v = std::any_cast<std::string>(&value)) return *v;
+  if (auto v = std::any_cast<const char*>(&value)) return *v ? *v : "";
+  return value.has_value() ? "<object>" : "<empty>";
+}
+
+}  // namespace
+
+EventHistory::EventHistory(size_t max_events, size_t max_bytes)
+    : ring_(std::max<size_t>(max_events, 1)),
+      max_bytes_(max_bytes) {
+}
+
+EventHistory::~EventHistory() {
+  DisableSpill();
+}
+
+void EventHistory::SetLimits(size_t max_events, size_t max_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_bytes_ = max_bytes;
+  while (next_seq_ > first_seq_ && bytes_ > RingBytes()) {
+    EvictOldest();
+  }
+  Resize(std::max<size_t>(max_events, 1));
+}
+
+void EventHistory::Append(TopicId topic, EventPtr event, Clock::time_point recorded) {
+  if (!event) {
+    return;
+  }
+  size_t bytes = EstimateBytes(*event);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t ring_bytes = RingBytes();
+
+  // Make room: count limit first, then the byte ceiling
+  while (next_seq_ - first_seq_ >= ring_.size() ||
+         (next_seq_ > first_seq_ && bytes_ + bytes > ring_bytes)) {
+    EvictOldest();
+  }
+
+  Entry entry;
+  entry.topic = topic;
+  entry.recorded = std::max(recorded, last_recorded_);
+  entry.event = std::move(event);
+  entry.bytes = bytes;
+  last_recorded_ = entry.recorded;
+
+  if (bytes > ring_bytes) {
+    // Larger than the whole ceiling: never stored, but still kept for postmortems
+    Spill(entry);
+    evicted_++;
+    return;
+  }
+
+  uint64_t seq = next_seq_++;
+  At(seq) = std::move(entry);
+  bytes_ += bytes;
+
+  if (by_topic_.size() <= topic) {
+    by_topic_.resize(topic + 1);
+  }
+  by_topic_[topic].push_back(seq);
+}
+
+std::vector<EventHistory::EventPtr> EventHistory::Recent(size_t count) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  uint64_t stored = next_seq_ - first_seq_;
+  uint64_t begin = stored > count ? next_seq_ - count : first_seq_;
+
+  std::vector<EventPtr> events;
+  events.reserve(static_cast<size_t>(next_seq_ - begin));
+  for (uint64_t seq = begin; seq < next_seq_; seq++) {
+    events.push_back(At(seq).event);
+  }
+  return events;
+}
+
+std::vector<EventHistory::EventPtr> EventHistory::Query(TopicId topic, Clock::time_point from,
+                                                        Clock::time_point to) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<EventPtr> events;
+
+  auto recorded_before = [this](uint64_t seq, Clock::time_point t) { return At(seq).recorded < t; };
+
+  if (topic == kInvalidTopic) {
+    // Record times are non-decreasing in sequence order: binary search the ring
+    uint64_t low = first_seq_;
+    uint64_t high = next_seq_;
+    while (low < high) {
+      uint64_t mid = low + (high - low) / 2;
+      if (recorded_before(mid, from)) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    for (uint64_t seq = low; seq < next_seq_ && At(seq).recorded <= to; seq++) {
+      events.push_back(At(seq).event);
+    }
+    return events;
+  }
+
+  if (topic >= by_topic_.size()) {
+    return events;
+  }
+  const std::deque<uint64_t>& index = by_topic_[topic];
+  auto it = std::lower_bound(index.begin(), index.end(), from, recorded_before);
+  for (; it != index.end() && At(*it).recorded <= to; ++it) {
+    events.push_back(At(*it).event);
+  }
+  return events;
+}
+
+std::vector<EventHistory::EventPtr> EventHistory::Query(TopicId topic,
+                                                        Clock::duration window) const {
+  return Query(topic, Clock::now() - window);
+}
+
+void EventHistory::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (uint64_t seq = first_seq_; seq < next_seq_; seq++) {
+    At(seq) = Entry();
+  }
+  first_seq_ = next_seq_;
+  bytes_ = 0;
+  by_topic_.clear();
+}
+
+bool EventHistory::EnableSpill(const std::string& path, uint64_t max_file_bytes) {
+  DisableSpill();  // Writes what the previous file still has queued
+
+  {
+    std::lock_guard<std::mutex> spill_lock(spill_mutex_);
+    spill_file_.open(path, std::ios::app | std::ios::binary);
+    if (!spill_file_.is_open()) {
+      spill_path_.clear();
+      return false;
+    }
+
+    std::error_code ec;
+    auto existing = std::filesystem::file_size(path, ec);
+    spill_path_ = path;
+    spill_max_bytes_ = max_file_bytes;
+    spill_bytes_ = ec ? 0 : existing;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  spill_writer_ = std::make_unique<EventExecutor>("history.spill", 1, kSpillQueueCapacity,
+                                                  EventExecutor::OverflowPolicy::DROP_NEWEST);
+  while (next_seq_ > first_seq_ && bytes_ > RingBytes()) {
+    EvictOldest();  // The spill queue's share comes out of the ring
+  }
+  return true;
+}
+
+void EventHistory::DisableSpill() {
+  std::unique_ptr<EventExecutor> writer;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writer = std::move(spill_writer_);
+  }
+  writer.reset();  // Stop() writes every queued line first
+
+  std::lock_guard<std::mutex> spill_lock(spill_mutex_);
+  if (spill_file_.is_open()) {
+    spill_file_.close();
+  }
+  spill_path_.clear();
+}
+
+bool EventHistory::Dump(const std::string& path) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::ofstream file(path, std::ios::trunc | std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  for (uint64_t seq = first_seq_; seq < next_seq_; seq++) {
+    const Entry& entry = At(seq);
+    file << FormatLine(*entry.event, entry.recorded) << '\n';
+  }
+  return file.good();
+}
+
+EventHistory::Stats EventHistory::GetStats() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Stats stats;
+  stats.events = static_cast<size_t>(next_seq_ - first_seq_);
+  stats.bytes = bytes_;
+  stats.evicted = evicted_;
+  stats.spilled = spilled_;
+  stats.spill_dropped = spill_dropped_;
+  stats.spill_queued_bytes = spill_queued_bytes_.load(std::memory_order_relaxed);
+  lock.unlock();
+
+  std::lock_guard<std::mutex> spill_lock(spill_mutex_);
+  stats.spill_bytes = spill_bytes_;
+  return stats;
+}
+
+size_t EventHistory::EstimateBytes(const Event& event) {
+  size_t bytes = sizeof(Event) + kSharedControlBlock;
+  bytes += StringHeapBytes(event.type) + StringHeapBytes(event.source);
+  for (const auto& pair : event.data) {
+    bytes += sizeof(pair) + kMapNodeOverhead + StringHeapBytes(pair.first);
+    if (auto s = std::any_cast<std::string>(&pair.second)) {
+      bytes += sizeof(std::string) + StringHeapBytes(*s);
+    } else if (pair.second.has_value()) {
+      bytes += kOpaqueValueBytes;
+    }
+  }
+  return bytes;
+}
+
+std::string EventHistory::FormatLine(const Event& event, Clock::time_point recorded) {
+  char timestamp[LogFormatter::kTimestampLength];
+  LogFormatter::FormatTimestamp(recorded, timestamp);
+
+  std::string data;
+  for (const auto& pair : event.data) {
+    if (!data.empty()) {
+      data += ' ';
+    }
+    data += pair.first;
+    data += '=';
+    data += FormatValue(pair.second);
+  }
+
+  std::string line(timestamp, LogFormatter::kTimestampLength);
+  line += '\t';
+  line += LogPayload(event.type);
+  line += '\t';
+  line += LogPayload(event.source);
+  line += '\t';
+  line += LogPayload(data);
+  return line;
+}
+
+size_t EventHistory::RingBytes() const {
+  return spill_writer_ ? max_bytes_ - max_bytes_ / kSpillShare : max_bytes_;
+}
+
+void EventHistory::EvictOldest() {
+  Entry& oldest = At(first_seq_);
+  Spill(oldest);
+
+  if (oldest.topic < by_topic_.size() && !by_topic_[oldest.topic].empty()) {
+    by_topic_[oldest.topic].pop_front();  // The oldest entry is also its topic's oldest
+  }
+  bytes_ -= oldest.bytes;
+  oldest = Entry();
+  first_seq_++;
+  evicted_++;
+}
+
+void EventHistory::Resize(size_t max_events) {
+  if (max_events == ring_.size()) {
+    return;
+  }
+  while (next_seq_ - first_seq_ > max_events) {
+    EvictOldest();
+  }
+
+  // Entries move to seq % new size; sequences (and so the topic index) stay valid
+  std::vector<Entry> resized(max_events);
+  for (uint64_t seq = first_seq_; seq < next_seq_; seq++) {
+    resized[seq % max_events] = std::move(At(seq));
+  }
+  ring_ = std::move(resized);
+}
+
+void EventHistory::Spill(const Entry& entry) {
+  if (!spill_writer_ || !entry.event) {
+    return;
+  }
+
+  // Only the writer lowers the queued bytes, so this check cannot go stale
+  size_t bytes = entry.bytes;
+  if (spill_queued_bytes_.load(std::memory_order_relaxed) + bytes > max_bytes_ / kSpillShare) {
+    spill_dropped_++;
+    return;
+  }
+  spill_queued_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+
+  // Formatting and file I/O happen on the writer; the event is shared, not copied
+  EventPtr event = entry.event;
+  Clock::time_point recorded = entry.recorded;
+  bool queued = spill_writer_->Post("history.spill", [this, event, recorded, bytes] {
+    std::string line = FormatLine(*event, recorded);
+    line += '\n';
+    {
+      std::lock_guard<std::mutex> spill_lock(spill_mutex_);
+      WriteSpillLine(line);
+    }
+    spill_queued_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  });
+  if (queued) {
+    spilled_++;
+  } else {
+    spill_queued_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    spill_dropped_++;
+  }
+}
+
+void EventHistory::WriteSpillLine(const std::string& line) {
+  if (!spill_file_.is_open()) {
+    return;
+  }
+
+  if (spill_bytes_ + line.size() > spill_max_bytes_ && spill_bytes_ > 0) {
+    // Keep one previous file: "<path>" -> "<path>.1"
+    spill_file_.close();
+    std::error_code ec;
+    std::filesystem::remove(spill_path_ + ".1", ec);  // rename() does not replace on Windows
+    std::filesystem::rename(spill_path_, spill_path_ + ".1", ec);
+    spill_file_.open(spill_path_, std::ios::trunc | std::ios::binary);
+    spill_bytes_ = 0;
+    if (!spill_file_.is_open()) {
+      return;
+    }
+  }
+
+  spill_file_.write(line.data(), static_cast<std::streamsize>(line.size()));
+  spill_bytes_ += line.size();
+
+  auto now = Clock::now();
+  if (now - spill_flushed_ >= kSpillFlushInterval) {
+    spill_file_.flush();
+    spill_flushed_ = now;
+  }
+}
+
+}  // namespace anywp_engine
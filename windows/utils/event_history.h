@@ -0,0 +1,155 @@
+#ifndef ANYWP_ENGINE_EVENT_HISTORY_H_
+#define ANYWP_ENGINE_EVENT_HISTORY_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "event_executor.h"
+#include "event_topic.h"
+
+namespace anywp_engine {
+
+struct Event;
+
+/**
+ * EventHistory - Fixed-capacity ring of published events with indexes
+ *
+ * Features:
+ * - O(1) append; the oldest event is evicted when either the event count or
+ *   the byte ceiling would be exceeded, so memory stays bounded even with
+ *   history enabled in production
+ * - Events are shared, never deep-copied: queries return shared_ptrs
+ * - Indexes by topic and by record time: "every monitor.changed of the last
+ *   30 s" is a binary search over that topic's entries, not a scan
+ * - Optional spill-to-disk: evicted events are appended as text lines to a
+ *   size-capped file (one rotation to "<path>.1") for postmortems, and
+ *   Dump() writes the whole ring on demand
+ * - Spilling never runs on the appending (publishing) thread: evicted
+ *   events are handed, still shared, to a one-worker EventExecutor that
+ *   formats and writes them in eviction order. A full spill queue drops
+ *   lines rather than block the publisher
+ * - Events waiting to be spilled count against the byte ceiling: while
+ *   spilling, a quarter of it is set aside for them and the ring keeps the
+ *   rest, so the ceiling bounds both together
+ *
+ * Spill/dump line format (values cut to kLogPayloadPreview bytes):
+ *   2026-01-15 10:30:45.123<TAB>monitor.changed<TAB>DisplayManager<TAB>count=3 primary=0
+ *
+ * Record times are the append time, clamped so they never go backwards
+ * (the index stays sorted across wall-clock adjustments).
+ *
+ * Thread-safe: Yes
+ */
+class EventHistory {
+public:
+  using Clock = std::chrono::system_clock;
+  using EventPtr = std::shared_ptr<const Event>;
+
+  static constexpr size_t kDefaultMaxEvents = 1000;
+  static constexpr size_t kDefaultMaxBytes = 1024 * 1024;
+  static constexpr uint64_t kDefaultSpillBytes = 16 * 1024 * 1024;
+
+  struct Stats {
+    size_t events = 0;
+    size_t bytes = 0;          // Estimated memory held by the stored events
+    size_t evicted = 0;
+    size_t spilled = 0;        // Evicted events handed to the spill writer
+    size_t spill_dropped = 0;  // Evicted events not spilled: the spill queue was full
+    size_t spill_queued_bytes = 0;  // Estimated memory of events waiting for the writer
+    uint64_t spill_bytes = 0;  // Size of the current spill file
+  };
+
+  explicit EventHistory(size_t max_events = kDefaultMaxEvents,
+                        size_t max_bytes = kDefaultMaxBytes);
+  ~EventHistory();
+
+  EventHistory(const EventHistory&) = delete;
+  EventHistory& operator=(const EventHistory&) = delete;
+
+  // Evicts (and spills) the oldest events until the new limits hold
+  void SetLimits(size_t max_events, size_t max_bytes);
+
+  void Append(TopicId topic, EventPtr event, Clock::time_point recorded = Clock::now());
+
+  // Newest `count` events, oldest first
+  std::vector<EventPtr> Recent(size_t count) const;
+
+  // Events of `topic` (kInvalidTopic = every topic) recorded in [from, to], oldest first
+  std::vector<EventPtr> Query(TopicId topic, Clock::time_point from,
+                              Clock::time_point to = Clock::time_point::max()) const;
+
+  // Events of `topic` recorded within `window` before now
+  std::vector<EventPtr> Query(TopicId topic, Clock::duration window) const;
+
+  void Clear();
+
+  // Append evicted events to `path` (rotated to "<path>.1" past max_file_bytes)
+  bool EnableSpill(const std::string& path, uint64_t max_file_bytes = kDefaultSpillBytes);
+  void DisableSpill();
+
+  // Write every stored event to `path` (overwrites)
+  bool Dump(const std::string& path) const;
+
+  Stats GetStats() const;
+
+  // Estimated heap + inline size of one event (what the byte ceiling counts)
+  static size_t EstimateBytes(const Event& event);
+
+  // One spill/dump line, without the trailing newline
+  static std::string FormatLine(const Event& event, Clock::time_point recorded);
+
+private:
+  struct Entry {
+    TopicId topic = kInvalidTopic;
+    Clock::time_point recorded;
+    EventPtr event;
+    size_t bytes = 0;
+  };
+
+  // Entry for sequence `seq` (first_seq_ <= seq < next_seq_)
+  const Entry& At(uint64_t seq) const { return ring_[seq % ring_.size()]; }
+  Entry& At(uint64_t seq) { return ring_[seq % ring_.size()]; }
+
+  size_t RingBytes() const;        // Requires mutex_; the ring's share of max_bytes_
+  void EvictOldest();              // Requires mutex_
+  void Resize(size_t max_events);  // Requires mutex_
+  void Spill(const Entry& entry);  // Requires mutex_; queues the write
+  void WriteSpillLine(const std::string& line);  // Spill writer thread; requires spill_mutex_
+
+  std::vector<Entry> ring_;
+  uint64_t first_seq_ = 0;         // Oldest stored sequence
+  uint64_t next_seq_ = 0;          // Sequence of the next append
+  size_t max_bytes_;
+  size_t bytes_ = 0;
+  size_t evicted_ = 0;
+  Clock::time_point last_recorded_;
+
+  // Index = TopicId; stored sequences of that topic, oldest first
+  std::vector<std::deque<uint64_t>> by_topic_;
+
+  size_t spilled_ = 0;
+  size_t spill_dropped_ = 0;
+  std::atomic<size_t> spill_queued_bytes_{0};  // Raised under mutex_, lowered by the writer
+  std::unique_ptr<EventExecutor> spill_writer_;  // Set while spilling; guarded by mutex_
+
+  // Written by the spill writer
+  std::string spill_path_;
+  std::ofstream spill_file_;
+  uint64_t spill_max_bytes_ = kDefaultSpillBytes;
+  uint64_t spill_bytes_ = 0;
+  Clock::time_point spill_flushed_;
+  mutable std::mutex spill_mutex_;
+
+  mutable std::mutex mutex_;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_EVENT_HISTORY_H_
@@ -0,0 +1,106 @@
+#include "event_timer.h"
+
+#include <algorithm>
+
+namespace anywp_engine {
+
+EventTimer::EventTimer(Mode mode) : mode_(mode), state_(std::make_shared<State>()) {
+  if (mode_ == Mode::REAL_TIME) {
+    worker_ = std::thread(&EventTimer::WorkerLoop, state_);
+  }
+}
+
+EventTimer::~EventTimer() {
+  Stop();
+}
+
+EventTimer::Clock::time_point EventTimer::Now() const {
+  if (mode_ == Mode::REAL_TIME) {
+    return Clock::now();
+  }
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->virtual_now;
+}
+
+void EventTimer::Schedule(Clock::time_point when, Callback callback) {
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (state_->stopping) {
+      return;
+    }
+    state_->pending.emplace(std::make_pair(when, state_->next_sequence++), std::move(callback));
+  }
+  state_->wake_cv.notify_one();
+}
+
+void EventTimer::Advance(Clock::duration duration) {
+  if (mode_ != Mode::VIRTUAL) {
+    return;
+  }
+  std::lock_guard<std::mutex> advance_lock(advance_mutex_);
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  Clock::time_point target = state_->virtual_now + duration;
+
+  // One callback at a time: each may schedule more work inside the window
+  while (!state_->stopping && !state_->pending.empty() &&
+         state_->pending.begin()->first.first <= target) {
+    auto next = state_->pending.begin();
+    state_->virtual_now = std::max(state_->virtual_now, next->first.first);
+    Callback callback = std::move(next->second);
+    state_->pending.erase(next);
+
+    lock.unlock();
+    callback();
+    lock.lock();
+  }
+  state_->virtual_now = target;
+}
+
+void EventTimer::Stop() {
+  std::lock_guard<std::mutex> stop_lock(stop_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->stopping = true;
+    state_->pending.clear();
+  }
+  state_->wake_cv.notify_all();
+  if (!worker_.joinable()) {
+    return;
+  }
+  if (worker_.get_id() == std::this_thread::get_id()) {
+    // Stopped (or destroyed) from a callback: the worker returns from it
+    // and exits on its own reference to state_
+    worker_.detach();
+  } else {
+    worker_.join();
+  }
+}
+
+size_t EventTimer::PendingCount() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->pending.size();
+}
+
+void EventTimer::WorkerLoop(std::shared_ptr<State> state) {
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (!state->stopping) {
+    if (state->pending.empty()) {
+      state->wake_cv.wait(lock);
+      continue;
+    }
+    Clock::time_point due = state->pending.begin()->first.first;
+    if (Clock::now() < due) {
+      state->wake_cv.wait_until(lock, due);  // Also wakes for an earlier Schedule()
+      continue;
+    }
+
+    Callback callback = std::move(state->pending.begin()->second);
+    state->pending.erase(state->pending.begin());
+    lock.unlock();
+    callback();
+    callback = nullptr;  // May hold the last reference to the timer: Stop() locks
+    lock.lock();
+  }
+}
+
+}  // namespace anywp_engine
@@ -0,0 +1,95 @@
+#ifndef ANYWP_ENGINE_EVENT_TIMER_H_
+#define ANYWP_ENGINE_EVENT_TIMER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace anywp_engine {
+
+/**
+ * EventTimer - One shared timer thread for deferred EventBus work
+ *
+ * EventBus schedules its coalescing and debounce deadlines here instead of
+ * starting a thread (or a Win32 timer) per topic.
+ *
+ * Two clocks:
+ * - REAL_TIME: steady_clock; a worker thread runs callbacks when they are due
+ * - VIRTUAL:   time only moves through Advance(), which runs the due
+ *              callbacks on the calling thread; no thread is started. Used
+ *              by tests so debounce windows need no sleeping.
+ *
+ * Callbacks due at the same time run in scheduling order. They run without
+ * the timer lock held, so they may schedule again.
+ *
+ * Usage:
+ *   EventTimer timer(EventTimer::Mode::VIRTUAL);
+ *   timer.Schedule(timer.Now() + std::chrono::milliseconds(50), [] { ... });
+ *   timer.Advance(std::chrono::milliseconds(50));  // Runs the callback
+ *
+ * Thread-safe: Yes
+ */
+class EventTimer {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void()>;
+
+  enum class Mode {
+    REAL_TIME,
+    VIRTUAL
+  };
+
+  explicit EventTimer(Mode mode = Mode::REAL_TIME);
+  ~EventTimer();
+
+  EventTimer(const EventTimer&) = delete;
+  EventTimer& operator=(const EventTimer&) = delete;
+
+  Clock::time_point Now() const;
+
+  // Run `callback` at `when` (as soon as possible if already past)
+  void Schedule(Clock::time_point when, Callback callback);
+
+  // VIRTUAL only: move the clock forward, running every callback due on the way
+  void Advance(Clock::duration duration);
+
+  // Drop pending callbacks and join the worker; later Schedule() calls are
+  // ignored. From a callback (or a destructor run by one) the worker is
+  // detached instead and exits once that callback returns.
+  void Stop();
+
+  size_t PendingCount() const;
+
+  Mode GetMode() const { return mode_; }
+
+private:
+  // Everything the worker touches; it holds a reference, so a worker
+  // detached by Stop() outlives the timer safely
+  struct State {
+    // Key: (due time, scheduling sequence) so equal deadlines keep their order
+    std::map<std::pair<Clock::time_point, uint64_t>, Callback> pending;  // Guarded by mutex
+    uint64_t next_sequence = 0;        // Guarded by mutex
+    Clock::time_point virtual_now;     // VIRTUAL only; guarded by mutex
+    bool stopping = false;             // Guarded by mutex
+    mutable std::mutex mutex;
+    std::condition_variable wake_cv;
+  };
+
+  static void WorkerLoop(std::shared_ptr<State> state);
+
+  const Mode mode_;
+  const std::shared_ptr<State> state_;
+  std::thread worker_;                 // REAL_TIME only
+  std::mutex stop_mutex_;              // Serializes Stop()
+  std::mutex advance_mutex_;           // Serializes Advance()
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_EVENT_TIMER_H_
@@ -0,0 +1,72 @@
+#include "event_topic.h"
+
+#include <mutex>
+
+namespace anywp_engine {
+
+TopicRegistry& TopicRegistry::Instance() {
+  static TopicRegistry instance;
+  return instance;
+}
+
+TopicRegistry::TopicRegistry() {
+  for (const char* name : topics::kBuiltinTopicNames) {
+    Intern(name);
+  }
+}
+
+TopicId TopicRegistry::Intern(std::string_view name) {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  auto it = ids_.find(name);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+  names_.emplace_back(name);
+  TopicId id = static_cast<TopicId>(names_.size());
+  ids_.emplace(names_.back(), id);
+  return id;
+}
+
+TopicId TopicRegistry::Find(std::string_view name) const {
+  // IDs never change once handed out, so each thread keeps the names it has
+  // resolved and skips the shared lock next time (misses are not cached)
+  thread_local std::unordered_map<std::string_view, TopicId> resolved;
+  auto cached = resolved.find(name);
+  if (cached != resolved.end()) {
+    return cached->second;
+  }
+
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  auto it = ids_.find(name);
+  if (it == ids_.end()) {
+    return kInvalidTopic;
+  }
+  if (resolved.size() < kMaxCachedPerThread) {
+    resolved.emplace(it->first, it->second);  // Key views the registry's own copy
+  }
+  return it->second;
+}
+
+const std::string& TopicRegistry::Name(TopicId id) const {
+  static const std::string kUnknown;
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  if (id == kInvalidTopic || id > names_.size()) {
+    return kUnknown;
+  }
+  return names_[id - 1];
+}
+
+TopicId TopicRegistry::MaxId() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return static_cast<TopicId>(names_.size());
+}
+
+}  // namespace anywp_engine
@@ -0,0 +1,138 @@
+#ifndef ANYWP_ENGINE_EVENT_TOPIC_H_
+#define ANYWP_ENGINE_EVENT_TOPIC_H_
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+namespace anywp_engine {
+
+/**
+ * Interned EventBus topics
+ *
+ * EventBus routes by small dense integers instead of strings. A topic name is
+ * interned once into a TopicId; the well-known topics below are registered
+ * in this order at startup, so their IDs are compile-time constants.
+ *
+ * Typed payloads name their topic with one of:
+ *   struct MonitorChanged { static constexpr TopicId kTopicId = topics::kMonitorChanged; ... };
+ *   struct PluginEvent    { static constexpr const char* kTopic = "plugin.custom"; ... };
+ * TopicOf<T>() returns the ID (a constant, or interned on first use).
+ *
+ * Thread-safe: Yes (interning takes an exclusive lock, lookups a shared one)
+ */
+
+using TopicId = uint32_t;
+
+constexpr TopicId kInvalidTopic = 0;
+
+namespace topics {
+
+// Keep in the same order as kBuiltinTopicNames
+enum : TopicId {
+  kWallpaperInitialized = 1,
+  kWallpaperStopped,
+  kWallpaperNavigationStarted,
+  kWallpaperNavigationCompleted,
+  kMonitorChanged,
+  kWebViewCreated,
+  kWebViewError,
+  kStateSaved,
+  kStateLoaded,
+  kPermissionDenied,
+  kErrorOccurred,
+  kPowerStateChanged,
+  kBuiltinCount = kPowerStateChanged
+};
+
+constexpr const char* kBuiltinTopicNames[] = {
+  "wallpaper.initialized",
+  "wallpaper.stopped",
+  "wallpaper.navigation.started",
+  "wallpaper.navigation.completed",
+  "monitor.changed",
+  "webview.created",
+  "webview.error",
+  "state.saved",
+  "state.loaded",
+  "permission.denied",
+  "error.occurred",
+  "power.state_changed",
+};
+
+static_assert(sizeof(kBuiltinTopicNames) / sizeof(kBuiltinTopicNames[0]) == kBuiltinCount,
+              "kBuiltinTopicNames out of sync with the topic enum");
+
+}  // namespace topics
+
+class TopicRegistry {
+public:
+  static TopicRegistry& Instance();
+
+  // ID for `name`, registering it on first use
+  TopicId Intern(std::string_view name);
+
+  // ID for `name`, or kInvalidTopic if it was never interned
+  TopicId Find(std::string_view name) const;
+
+  // Name of `id` ("" for unknown IDs); the reference stays valid for the process lifetime
+  const std::string& Name(TopicId id) const;
+
+  // Highest ID handed out so far
+  TopicId MaxId() const;
+
+private:
+  // Per-thread cache bound for Find()
+  static constexpr size_t kMaxCachedPerThread = 1024;
+
+  TopicRegistry();
+
+  TopicRegistry(const TopicRegistry&) = delete;
+  TopicRegistry& operator=(const TopicRegistry&) = delete;
+
+  std::deque<std::string> names_;                           // Index = id - 1; never shrinks
+  std::unordered_map<std::string_view, TopicId> ids_;       // Views into names_
+  mutable std::shared_mutex mutex_;
+};
+
+// ========== Typed payload helpers ==========
+
+template <typename T, typename = void>
+struct HasTopicId : std::false_type {};
+template <typename T>
+struct HasTopicId<T, std::void_t<decltype(T::kTopicId)>> : std::true_type {};
+
+template <typename T, typename = void>
+struct HasTopicName : std::false_type {};
+template <typename T>
+struct HasTopicName<T, std::void_t<decltype(T::kTopic)>> : std::true_type {};
+
+// True for structs usable with EventBus::Publish<T> / Subscribe<T>
+template <typename T>
+constexpr bool IsTypedEvent = HasTopicId<T>::value || HasTopicName<T>::value;
+
+template <typename T>
+TopicId TopicOf() {
+  static_assert(IsTypedEvent<T>, "Typed events declare kTopicId or kTopic");
+  if constexpr (HasTopicId<T>::value) {
+    return T::kTopicId;
+  } else {
+    static const TopicId id = TopicRegistry::Instance().Intern(T::kTopic);
+    return id;
+  }
+}
+
+// Unique address per payload type (type check without RTTI)
+template <typename T>
+const void* PayloadTypeOf() {
+  static const char tag = 0;
+  return &tag;
+}
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_EVENT_TOPIC_H_
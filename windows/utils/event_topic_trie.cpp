@@ -0,0 +1,183 @@
+#include "event_topic_trie.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace anywp_engine {
+
+namespace {
+
+constexpr std::string_view kStar = "*";
+constexpr std::string_view kGlobstar = "**";
+
+std::vector<std::string_view> SplitSegments(std::string_view topic) {
+  std::vector<std::string_view> segments;
+  size_t start = 0;
+  while (true) {
+    size_t dot = topic.find('.', start);
+    segments.push_back(topic.substr(start, dot == std::string_view::npos ? dot : dot - start));
+    if (dot == std::string_view::npos) {
+      return segments;
+    }
+    start = dot + 1;
+  }
+}
+
+}  // namespace
+
+TopicTrie::TopicTrie() : nodes_(1) {
+}
+
+bool TopicTrie::IsPattern(std::string_view topic) {
+  for (std::string_view segment : SplitSegments(topic)) {
+    if (segment == kStar || segment == kGlobstar) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TopicTrie::PatternId TopicTrie::Insert(std::string_view pattern) {
+  uint32_t node = 0;
+  for (std::string_view segment : SplitSegments(pattern)) {
+    uint32_t next = Child(node, segment);
+    if (next == 0) {
+      next = AllocateNode();  // May invalidate references into nodes_
+      if (segment == kStar) {
+        nodes_[node].star = next;
+      } else if (segment == kGlobstar) {
+        nodes_[node].globstar = next;
+      } else {
+        nodes_[node].children.emplace(std::string(segment), next);
+      }
+    }
+    node = next;
+  }
+
+  if (nodes_[node].pattern == kNoPattern) {
+    if (!free_patterns_.empty()) {
+      nodes_[node].pattern = free_patterns_.back();
+      free_patterns_.pop_back();
+      patterns_[nodes_[node].pattern] = std::string(pattern);
+    } else {
+      nodes_[node].pattern = static_cast<PatternId>(patterns_.size());
+      patterns_.emplace_back(pattern);
+    }
+  }
+  return nodes_[node].pattern;
+}
+
+bool TopicTrie::Remove(std::string_view pattern) {
+  // (parent, segment) of every node on the path
+  std::vector<std::pair<uint32_t, std::string_view>> path;
+  uint32_t node = 0;
+  for (std::string_view segment : SplitSegments(pattern)) {
+    uint32_t next = Child(node, segment);
+    if (next == 0) {
+      return false;
+    }
+    path.emplace_back(node, segment);
+    node = next;
+  }
+
+  PatternId id = nodes_[node].pattern;
+  if (id == kNoPattern) {
+    return false;
+  }
+  nodes_[node].pattern = kNoPattern;
+  patterns_[id].clear();
+  free_patterns_.push_back(id);
+
+  // Unlink the nodes left with nothing below them, deepest first
+  while (!path.empty()) {
+    const Node& current = nodes_[node];
+    if (current.pattern != kNoPattern || !current.children.empty() ||
+        current.star != 0 || current.globstar != 0) {
+      break;
+    }
+    auto [parent, segment] = path.back();
+    path.pop_back();
+    if (segment == kStar) {
+      nodes_[parent].star = 0;
+    } else if (segment == kGlobstar) {
+      nodes_[parent].globstar = 0;
+    } else {
+      nodes_[parent].children.erase(nodes_[parent].children.find(segment));
+    }
+    free_nodes_.push_back(node);
+    node = parent;
+  }
+  return true;
+}
+
+TopicTrie::PatternId TopicTrie::Find(std::string_view pattern) const {
+  uint32_t node = 0;
+  for (std::string_view segment : SplitSegments(pattern)) {
+    node = Child(node, segment);
+    if (node == 0) {
+      return kNoPattern;
+    }
+  }
+  return nodes_[node].pattern;
+}
+
+std::vector<TopicTrie::PatternId> TopicTrie::Match(std::string_view topic) const {
+  std::vector<PatternId> matches;
+  if (PatternCount() == 0) {
+    return matches;
+  }
+  Walk(0, SplitSegments(topic), 0, matches);
+
+  // "**" can reach the same pattern along several paths
+  std::sort(matches.begin(), matches.end());
+  matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+  return matches;
+}
+
+uint32_t TopicTrie::Child(uint32_t node, std::string_view segment) const {
+  const Node& current = nodes_[node];
+  if (segment == kStar) {
+    return current.star;
+  }
+  if (segment == kGlobstar) {
+    return current.globstar;
+  }
+  auto it = current.children.find(segment);
+  return it != current.children.end() ? it->second : 0;
+}
+
+uint32_t TopicTrie::AllocateNode() {
+  if (!free_nodes_.empty()) {
+    uint32_t node = free_nodes_.back();
+    free_nodes_.pop_back();
+    return node;
+  }
+  nodes_.emplace_back();
+  return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+void TopicTrie::Walk(uint32_t node, const std::vector<std::string_view>& segments, size_t index,
+                     std::vector<PatternId>& matches) const {
+  const Node& current = nodes_[node];
+  if (index == segments.size()) {
+    if (current.pattern != kNoPattern) {
+      matches.push_back(current.pattern);
+    }
+    return;
+  }
+
+  auto it = current.children.find(segments[index]);
+  if (it != current.children.end()) {
+    Walk(it->second, segments, index + 1, matches);
+  }
+  if (current.star != 0) {
+    Walk(current.star, segments, index + 1, matches);
+  }
+  if (current.globstar != 0) {
+    for (size_t end = index + 1; end <= segments.size(); end++) {
+      Walk(current.globstar, segments, end, matches);
+    }
+  }
+}
+
+}  // namespace anywp_engine
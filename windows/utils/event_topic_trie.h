@@ -0,0 +1,82 @@
+#ifndef ANYWP_ENGINE_EVENT_TOPIC_TRIE_H_
+#define ANYWP_ENGINE_EVENT_TOPIC_TRIE_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace anywp_engine {
+
+/**
+ * TopicTrie - Compiled set of wildcard topic patterns
+ *
+ * Topics are dot-separated segments ("wallpaper.navigation.started").
+ * A pattern segment may be a wildcard:
+ * - "*"  matches exactly one segment:   "wallpaper.*"  matches "wallpaper.stopped"
+ * - "**" matches one or more segments:  "wallpaper.**" also matches
+ *                                       "wallpaper.navigation.started"
+ * Wildcards only count as whole segments ("wall*" is a literal). Neither
+ * form matches the bare prefix: "wallpaper.**" does not match "wallpaper".
+ *
+ * Each distinct pattern gets a dense PatternId on Insert(). An ID stays
+ * valid until Remove() drops its pattern; later inserts reuse freed IDs and
+ * nodes, so a trie that sees patterns come and go does not grow. The trie
+ * is a plain value: EventBus copies it when a pattern is first subscribed
+ * or last unsubscribed and publishes the copy in its subscriber snapshot.
+ *
+ * Thread-safe: No (const methods may run concurrently)
+ */
+class TopicTrie {
+public:
+  using PatternId = uint32_t;
+
+  static constexpr PatternId kNoPattern = UINT32_MAX;
+
+  TopicTrie();
+
+  // True if `topic` has a "*" or "**" segment
+  static bool IsPattern(std::string_view topic);
+
+  // ID for `pattern`, adding it on first use
+  PatternId Insert(std::string_view pattern);
+
+  // Drop `pattern` and the nodes only it used; false if it is not present
+  bool Remove(std::string_view pattern);
+
+  // ID for `pattern`, or kNoPattern
+  PatternId Find(std::string_view pattern) const;
+
+  // "" for a removed ID
+  const std::string& Pattern(PatternId id) const { return patterns_[id]; }
+  size_t PatternCount() const { return patterns_.size() - free_patterns_.size(); }
+
+  // IDs of every pattern matching the concrete `topic`, ascending, no duplicates
+  std::vector<PatternId> Match(std::string_view topic) const;
+
+private:
+  // Children are node indexes; 0 (the root) doubles as "none"
+  struct Node {
+    std::map<std::string, uint32_t, std::less<>> children;
+    uint32_t star = 0;
+    uint32_t globstar = 0;
+    PatternId pattern = kNoPattern;  // Pattern ending at this node
+  };
+
+  // Child of `node` for one pattern segment, or 0
+  uint32_t Child(uint32_t node, std::string_view segment) const;
+  uint32_t AllocateNode();
+  void Walk(uint32_t node, const std::vector<std::string_view>& segments, size_t index,
+            std::vector<PatternId>& matches) const;
+
+  std::vector<Node> nodes_;            // nodes_[0] is the root
+  std::vector<std::string> patterns_;  // Index = PatternId
+  std::vector<uint32_t> free_nodes_;   // Unlinked by Remove(), reused by Insert()
+  std::vector<PatternId> free_patterns_;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_EVENT_TOPIC_TRIE_H_
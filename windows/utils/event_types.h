@@ -0,0 +1,38 @@
+#ifndef ANYWP_ENGINE_EVENT_TYPES_H_
+#define ANYWP_ENGINE_EVENT_TYPES_H_
+
+#include "event_topic.h"
+
+namespace anywp_engine {
+
+/**
+ * Typed EventBus payloads
+ *
+ * Flat structs published with EventBus::Publish(MonitorChanged{...}) and
+ * received with Subscribe<MonitorChanged>(...): no map, no std::any, and no
+ * heap allocation for inline delivery. Subscribers using the string API on
+ * the same topic receive an Event whose "payload" entry holds the struct.
+ */
+
+struct MonitorChanged {
+  static constexpr TopicId kTopicId = topics::kMonitorChanged;
+  int monitor_count = 0;
+  int primary_index = -1;
+};
+
+struct WallpaperInitialized {
+  static constexpr TopicId kTopicId = topics::kWallpaperInitialized;
+  int monitor_index = -1;
+  bool success = false;
+};
+
+// States are PowerManager::PowerState values
+struct PowerStateChanged {
+  static constexpr TopicId kTopicId = topics::kPowerStateChanged;
+  int old_state = 0;
+  int new_state = 0;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_EVENT_TYPES_H_
@@ -0,0 +1,26 @@
+#ifndef ANYWP_ENGINE_FILE_SYNC_H_
+#define ANYWP_ENGINE_FILE_SYNC_H_
+
+#include <cstdio>
+#include <filesystem>
+
+namespace anywp_engine {
+
+/**
+ * Durable-write helpers shared by the state backends (StateJournal,
+ * StateHashFile): open by Unicode path, flush a file to the disk, and make a
+ * rename durable.
+ */
+
+// fopen() with a UTF-16 path on Windows
+std::FILE* OpenFile(const std::filesystem::path& path, const char* mode);
+
+// Push the file's written data to the disk (call after fflush)
+bool SyncFile(std::FILE* file);
+
+// Make a rename in `directory` durable (NTFS journals it on its own)
+void SyncDirectory(const std::filesystem::path& directory);
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_FILE_SYNC_H_
@@ -0,0 +1,48 @@
+#ifndef ANYWP_ENGINE_HOT_PATH_H_
+#define ANYWP_ENGINE_HOT_PATH_H_
+
+namespace anywp_engine {
+
+/**
+ * HotPathScope - Marks code that must never block on console output
+ *
+ * The low-level mouse hook and the WebView message-receive callbacks run on
+ * threads where a stalled console (a paused terminal, a full pipe, a slow
+ * conhost) stalls input for the whole desktop. Code on those paths opens a
+ * scope with ANYWP_HOT_PATH(); Logger then counts every console line written
+ * from inside it (statistic "HotPathConsoleLines"), and ANYWP_NO_CONSOLE_IO
+ * builds drop those lines from the console sink entirely (file and flight
+ * recorder still get them). A hot-path thread in async mode never waits for
+ * ring space either, even under OverflowPolicy::BLOCK.
+ *
+ * Usage:
+ *   LRESULT CALLBACK HookProc(int code, WPARAM w, LPARAM l) {
+ *     ANYWP_HOT_PATH();
+ *     ANYWP_LOG_DEBUG("MouseHook", "...");  // Never reaches std::cout here
+ *   }
+ *
+ * Thread-safe: Yes (per-thread nesting depth)
+ */
+class HotPathScope {
+public:
+  HotPathScope() { Depth()++; }
+  ~HotPathScope() { Depth()--; }
+
+  HotPathScope(const HotPathScope&) = delete;
+  HotPathScope& operator=(const HotPathScope&) = delete;
+
+  // True while the calling thread is inside at least one scope
+  static bool IsActive() { return Depth() > 0; }
+
+private:
+  static int& Depth() {
+    thread_local int depth = 0;
+    return depth;
+  }
+};
+
+}  // namespace anywp_engine
+
+#define ANYWP_HOT_PATH() anywp_engine::HotPathScope anywp_hot_path_scope_
+
+#endif  // ANYWP_ENGINE_HOT_PATH_H_
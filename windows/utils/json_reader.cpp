@@ -0,0 +1,510 @@
+#include "json_reader.h"
+#include "json_structural_index.h"
+
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+namespace anywp_engine {
+
+namespace {
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Four hex digits at `text`[`i`]
+bool ReadHex4(std::string_view text, size_t i, uint32_t& out) {
+  if (i + 4 > text.size()) {
+    return false;
+  }
+  out = 0;
+  for (size_t k = 0; k < 4; ++k) {
+    int digit = HexValue(text[i + k]);
+    if (digit < 0) {
+      return false;
+    }
+    out = (out << 4) | static_cast<uint32_t>(digit);
+  }
+  return true;
+}
+
+size_t EncodeUtf8(uint32_t code, char* out) {
+  if (code < 0x80) {
+    out[0] = static_cast<char>(code);
+    return 1;
+  }
+  if (code < 0x800) {
+    out[0] = static_cast<char>(0xC0 | (code >> 6));
+    out[1] = static_cast<char>(0x80 | (code & 0x3F));
+    return 2;
+  }
+  if (code < 0x10000) {
+    out[0] = static_cast<char>(0xE0 | (code >> 12));
+    out[1] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    out[2] = static_cast<char>(0x80 | (code & 0x3F));
+    return 3;
+  }
+  out[0] = static_cast<char>(0xF0 | (code >> 18));
+  out[1] = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+  out[2] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+  out[3] = static_cast<char>(0x80 | (code & 0x3F));
+  return 4;
+}
+
+// Decode one byte or escape sequence of a string body at `i` into `out`
+// (up to 4 bytes) and advance `i` past it
+bool DecodeOne(std::string_view text, size_t& i, char* out, size_t& length) {
+  char c = text[i];
+  if (c != '\\') {
+    out[0] = c;
+    length = 1;
+    ++i;
+    return true;
+  }
+  if (i + 1 >= text.size()) {
+    return false;
+  }
+  length = 1;
+  switch (text[i + 1]) {
+    case '"':  out[0] = '"'; break;
+    case '\\': out[0] = '\\'; break;
+    case '/':  out[0] = '/'; break;
+    case 'b':  out[0] = '\b'; break;
+    case 'f':  out[0] = '\f'; break;
+    case 'n':  out[0] = '\n'; break;
+    case 'r':  out[0] = '\r'; break;
+    case 't':  out[0] = '\t'; break;
+    case 'u': {
+      uint32_t code = 0;
+      if (!ReadHex4(text, i + 2, code)) {
+        return false;
+      }
+      i += 6;
+      if (code >= 0xD800 && code <= 0xDBFF) {
+        // High surrogate: the low half must follow
+        uint32_t low = 0;
+        if (i + 1 >= text.size() || text[i] != '\\' || text[i + 1] != 'u' ||
+            !ReadHex4(text, i + 2, low) || low < 0xDC00 || low > 0xDFFF) {
+          return false;
+        }
+        i += 6;
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+      } else if (code >= 0xDC00 && code <= 0xDFFF) {
+        return false;
+      }
+      length = EncodeUtf8(code, out);
+      return true;
+    }
+    default:
+      return false;
+  }
+  i += 2;
+  return true;
+}
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Bytes that end a plain run inside a string: '"', '\\' and controls
+struct StringStopTable {
+  bool stop[256] = {};
+  constexpr StringStopTable() {
+    for (int c = 0; c < 0x20; ++c) stop[c] = true;
+    stop[static_cast<unsigned char>('"')] = true;
+    stop[static_cast<unsigned char>('\\')] = true;
+  }
+};
+constexpr StringStopTable kStringStops;
+
+}  // namespace
+
+JsonReader::JsonReader(std::string_view json) : json_(json) {
+}
+
+JsonReader::JsonReader(std::string_view json, const JsonStructuralIndex* index)
+    : json_(json),
+      index_(index) {
+}
+
+// ========== Tokens ==========
+
+JsonReader::Token JsonReader::Next() {
+  if (failed_) {
+    return Token::ERROR;
+  }
+  text_ = std::string_view();
+  escaped_ = false;
+  SkipWhitespace();
+
+  switch (state_) {
+    case State::AFTER_VALUE:
+      if (depth_ == 0) {
+        // Only whitespace may follow the document
+        return pos_ == json_.size() ? Set(Token::END) : Fail();
+      }
+      if (pos_ < json_.size() && json_[pos_] == (InObject() ? '}' : ']')) {
+        return Close();
+      }
+      if (pos_ >= json_.size() || json_[pos_] != ',') {
+        return Fail();
+      }
+      ++pos_;
+      SkipWhitespace();
+      return InObject() ? ReadKey() : ReadValue();
+
+    case State::FIRST_MEMBER:
+      if (pos_ < json_.size() && json_[pos_] == '}') {
+        return Close();
+      }
+      return ReadKey();
+
+    case State::FIRST_ELEMENT:
+      if (pos_ < json_.size() && json_[pos_] == ']') {
+        return Close();
+      }
+      return ReadValue();
+
+    case State::VALUE:
+    default:
+      return ReadValue();
+  }
+}
+
+JsonReader::Token JsonReader::Open(bool object) {
+  if (depth_ >= kMaxDepth) {
+    return Fail();
+  }
+  uint64_t bit = uint64_t{1} << depth_;
+  object_bits_ = object ? (object_bits_ | bit) : (object_bits_ & ~bit);
+  ++depth_;
+  ++pos_;
+  state_ = object ? State::FIRST_MEMBER : State::FIRST_ELEMENT;
+  return Set(object ? Token::BEGIN_OBJECT : Token::BEGIN_ARRAY);
+}
+
+JsonReader::Token JsonReader::Close() {
+  bool object = InObject();
+  --depth_;
+  ++pos_;
+  state_ = State::AFTER_VALUE;
+  return Set(object ? Token::END_OBJECT : Token::END_ARRAY);
+}
+
+JsonReader::Token JsonReader::ReadKey() {
+  if (pos_ >= json_.size() || json_[pos_] != '"' || !ScanString()) {
+    return Fail();
+  }
+  SkipWhitespace();
+  if (pos_ >= json_.size() || json_[pos_] != ':') {
+    return Fail();
+  }
+  ++pos_;
+  state_ = State::VALUE;
+  return Set(Token::KEY);
+}
+
+JsonReader::Token JsonReader::ReadValue() {
+  if (pos_ >= json_.size()) {
+    return Fail();
+  }
+  switch (json_[pos_]) {
+    case '{':
+      return Open(true);
+    case '[':
+      return Open(false);
+    case '"':
+      if (!ScanString()) {
+        return Fail();
+      }
+      state_ = State::AFTER_VALUE;
+      return Set(Token::STRING);
+    case 't':
+      return ReadLiteral("true", Token::TRUE_VALUE);
+    case 'f':
+      return ReadLiteral("false", Token::FALSE_VALUE);
+    case 'n':
+      return ReadLiteral("null", Token::NULL_VALUE);
+    default:
+      if (!ScanNumber()) {
+        return Fail();
+      }
+      state_ = State::AFTER_VALUE;
+      return Set(Token::NUMBER);
+  }
+}
+
+JsonReader::Token JsonReader::ReadLiteral(std::string_view word, Token token) {
+  if (json_.compare(pos_, word.size(), word) != 0) {
+    return Fail();
+  }
+  pos_ += word.size();
+  state_ = State::AFTER_VALUE;
+  return Set(token);
+}
+
+// pos_ is on the opening quote; on success text_ is the body and pos_ is
+// past the closing quote. Escapes are only validated here.
+bool JsonReader::ScanString() {
+  bool ok = false;
+  if (index_ && ScanIndexedString(ok)) {
+    return ok;
+  }
+  size_t i = pos_ + 1;
+  size_t size = json_.size();
+  bool escaped = false;
+  while (i < size) {
+    while (i < size && !kStringStops.stop[static_cast<unsigned char>(json_[i])]) {
+      ++i;
+    }
+    if (i >= size) {
+      break;
+    }
+    unsigned char c = static_cast<unsigned char>(json_[i]);
+    if (c == '"') {
+      text_ = json_.substr(pos_ + 1, i - pos_ - 1);
+      escaped_ = escaped;
+      pos_ = i + 1;
+      return true;
+    }
+    if (c == '\\') {
+      escaped = true;
+      if (i + 1 >= size) {
+        return false;
+      }
+      char kind = json_[i + 1];
+      if (kind == 'u') {
+        uint32_t unused = 0;
+        if (!ReadHex4(json_, i + 2, unused)) {
+          return false;
+        }
+        i += 6;
+        continue;
+      }
+      if (kind != '"' && kind != '\\' && kind != '/' && kind != 'b' &&
+          kind != 'f' && kind != 'n' && kind != 'r' && kind != 't') {
+        return false;
+      }
+      i += 2;
+      continue;
+    }
+    return false;  // Control character
+  }
+  return false;  // Unterminated
+}
+
+// The index holds every unescaped quote, and its first error covers the
+// checks ScanString() makes on the bytes in between
+bool JsonReader::ScanIndexedString(bool& ok) {
+  const uint32_t* positions = index_->Positions();
+  size_t count = index_->Size();
+  while (cursor_ < count && positions[cursor_] < pos_) {
+    ++cursor_;
+  }
+  if (cursor_ + 1 >= count || positions[cursor_] != pos_) {
+    return false;  // Unterminated, or not a string the index saw
+  }
+  size_t close = positions[cursor_ + 1];
+  if (json_[close] != '"') {
+    return false;
+  }
+  size_t error = index_->FirstError();
+  if (error != JsonStructuralIndex::kNoError && error > pos_ && error <= close) {
+    ok = false;
+    return true;
+  }
+  text_ = json_.substr(pos_ + 1, close - pos_ - 1);
+  escaped_ = std::memchr(text_.data(), '\\', text_.size()) != nullptr;
+  pos_ = close + 1;
+  cursor_ += 2;
+  ok = true;
+  return true;
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+bool JsonReader::ScanNumber() {
+  size_t i = pos_;
+  size_t size = json_.size();
+  if (i < size && json_[i] == '-') {
+    ++i;
+  }
+  if (i >= size || !IsDigit(json_[i])) {
+    return false;
+  }
+  if (json_[i] == '0') {
+    ++i;
+  } else {
+    while (i < size && IsDigit(json_[i])) ++i;
+  }
+  if (i < size && json_[i] == '.') {
+    ++i;
+    if (i >= size || !IsDigit(json_[i])) {
+      return false;
+    }
+    while (i < size && IsDigit(json_[i])) ++i;
+  }
+  if (i < size && (json_[i] == 'e' || json_[i] == 'E')) {
+    ++i;
+    if (i < size && (json_[i] == '+' || json_[i] == '-')) {
+      ++i;
+    }
+    if (i >= size || !IsDigit(json_[i])) {
+      return false;
+    }
+    while (i < size && IsDigit(json_[i])) ++i;
+  }
+  text_ = json_.substr(pos_, i - pos_);
+  pos_ = i;
+  return true;
+}
+
+void JsonReader::SkipWhitespace() {
+  while (pos_ < json_.size()) {
+    char c = json_[pos_];
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+      return;
+    }
+    ++pos_;
+  }
+}
+
+JsonReader::Token JsonReader::Set(Token token) {
+  current_ = token;
+  return token;
+}
+
+JsonReader::Token JsonReader::Fail() {
+  failed_ = true;
+  error_offset_ = pos_;
+  text_ = std::string_view();
+  escaped_ = false;
+  return Set(Token::ERROR);
+}
+
+// ========== Values ==========
+
+bool JsonReader::GetString(std::string& out) const {
+  if (current_ != Token::KEY && current_ != Token::STRING) {
+    return false;
+  }
+  if (!escaped_) {
+    out.assign(text_.data(), text_.size());
+    return true;
+  }
+  return Unescape(text_, out);
+}
+
+bool JsonReader::TextEquals(std::string_view expected) const {
+  if (current_ != Token::KEY && current_ != Token::STRING) {
+    return false;
+  }
+  if (!escaped_) {
+    return text_ == expected;
+  }
+  size_t matched = 0;
+  size_t i = 0;
+  char buffer[4];
+  while (i < text_.size()) {
+    size_t length = 0;
+    if (!DecodeOne(text_, i, buffer, length) || matched + length > expected.size() ||
+        expected.compare(matched, length, buffer, length) != 0) {
+      return false;
+    }
+    matched += length;
+  }
+  return matched == expected.size();
+}
+
+bool JsonReader::GetInt(int& out) const {
+  int64_t value = 0;
+  if (!GetInt64(value) || value < std::numeric_limits<int>::min() ||
+      value > std::numeric_limits<int>::max()) {
+    return false;
+  }
+  out = static_cast<int>(value);
+  return true;
+}
+
+bool JsonReader::GetInt64(int64_t& out) const {
+  if (current_ != Token::NUMBER) {
+    return false;
+  }
+  const char* end = text_.data() + text_.size();
+  auto result = std::from_chars(text_.data(), end, out);
+  return result.ec == std::errc() && result.ptr == end;
+}
+
+bool JsonReader::GetDouble(double& out) const {
+  if (current_ != Token::NUMBER) {
+    return false;
+  }
+  const char* end = text_.data() + text_.size();
+  auto result = std::from_chars(text_.data(), end, out);
+  return result.ec == std::errc() && result.ptr == end;
+}
+
+bool JsonReader::SkipValue() {
+  if (current_ != Token::BEGIN_OBJECT && current_ != Token::BEGIN_ARRAY) {
+    return current_ != Token::ERROR && current_ != Token::END &&
+           current_ != Token::KEY && current_ != Token::END_OBJECT &&
+           current_ != Token::END_ARRAY;
+  }
+  size_t target = depth_ - 1;
+  while (depth_ > target) {
+    if (Next() == Token::ERROR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ========== Static Helpers ==========
+
+bool JsonReader::FindString(std::string_view json, std::string_view key, std::string& value) {
+  JsonReader reader(json);
+  if (reader.Next() != Token::BEGIN_OBJECT) {
+    return false;
+  }
+  while (reader.Next() == Token::KEY) {
+    bool match = reader.TextEquals(key);
+    Token token = reader.Next();
+    if (match && token == Token::STRING) {
+      return reader.GetString(value);
+    }
+    if (!reader.SkipValue()) {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool JsonReader::Unescape(std::string_view escaped, std::string& out) {
+  out.clear();
+  out.reserve(escaped.size());
+  size_t i = 0;
+  char buffer[4];
+  while (i < escaped.size()) {
+    // Copy the run up to the next escape in one go
+    size_t next = escaped.find('\\', i);
+    if (next == std::string_view::npos) {
+      next = escaped.size();
+    }
+    out.append(escaped.data() + i, next - i);
+    i = next;
+    if (i == escaped.size()) {
+      break;
+    }
+    size_t length = 0;
+    if (!DecodeOne(escaped, i, buffer, length)) {
+      return false;
+    }
+    out.append(buffer, length);
+  }
+  return true;
+}
+
+}  // namespace anywp_engine
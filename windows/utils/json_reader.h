@@ -0,0 +1,138 @@
+#ifndef ANYWP_ENGINE_JSON_READER_H_
+#define ANYWP_ENGINE_JSON_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace anywp_engine {
+
+class JsonStructuralIndex;
+
+/**
+ * JsonReader - Allocation-free pull tokenizer for web messages
+ *
+ * Walks a JSON document held by the caller one token at a time; no tree is
+ * built and nothing is copied. Keys, strings and numbers are reported as
+ * views into the input, so the input must outlive the reader.
+ *
+ *   JsonReader reader(message);
+ *   if (reader.Next() != JsonReader::Token::BEGIN_OBJECT) return false;
+ *   while (reader.Next() == JsonReader::Token::KEY) {
+ *     bool is_type = reader.TextEquals("type");
+ *     reader.Next();
+ *     if (is_type) reader.GetString(type); else reader.SkipValue();
+ *   }
+ *
+ * The full grammar is checked as tokens are read (RFC 8259: no trailing
+ * commas, no control characters in strings, no leading zeros), nesting is
+ * limited to kMaxDepth, and one error is final: every later Next() returns
+ * ERROR. Escapes, \uXXXX surrogate pairs included, are decoded only when a
+ * string is copied out with GetString(); unpaired surrogates are rejected.
+ *
+ * Large messages: with a JsonStructuralIndex built over the same input
+ * (see JsonStructuralIndex::ForThread()), strings end at the next indexed
+ * quote instead of being scanned byte by byte. Tokens and errors are the
+ * same either way.
+ *
+ * Thread-safe: No (one reader per thread; the static helpers are stateless)
+ */
+class JsonReader {
+public:
+  enum class Token {
+    END,           // Whole document read
+    ERROR,         // Malformed input; see ErrorOffset()
+    BEGIN_OBJECT,
+    END_OBJECT,
+    BEGIN_ARRAY,
+    END_ARRAY,
+    KEY,           // Object member name; the value follows
+    STRING,
+    NUMBER,
+    TRUE_VALUE,
+    FALSE_VALUE,
+    NULL_VALUE,
+  };
+
+  static constexpr size_t kMaxDepth = 64;
+
+  explicit JsonReader(std::string_view json);
+  // `index` (may be nullptr) must have been built over `json`
+  JsonReader(std::string_view json, const JsonStructuralIndex* index);
+
+  // Advance to the next token
+  Token Next();
+  Token Current() const { return current_; }
+
+  // Raw text of the current KEY/STRING (between the quotes, escapes not
+  // decoded) or NUMBER; empty for other tokens
+  std::string_view Text() const { return text_; }
+  // Whether the current KEY/STRING contains escapes
+  bool HasEscapes() const { return escaped_; }
+
+  // Decoded current KEY/STRING (UTF-8)
+  bool GetString(std::string& out) const;
+  // Compare the decoded current KEY/STRING without copying it
+  bool TextEquals(std::string_view expected) const;
+  // Current NUMBER; GetInt() accepts integers that fit in an int only
+  bool GetInt(int& out) const;
+  bool GetInt64(int64_t& out) const;
+  bool GetDouble(double& out) const;
+
+  // Skip the value whose first token is current (the whole object or array
+  // for BEGIN_*), leaving its last token current; call right after a KEY's
+  // Next() or on an array element
+  bool SkipValue();
+
+  // Open objects and arrays around the current position
+  size_t Depth() const { return depth_; }
+  size_t Offset() const { return pos_; }
+  size_t ErrorOffset() const { return error_offset_; }
+
+  // Top-level string member `key` of a JSON object, decoded. Stops at the
+  // first match, so the rest of the document is not validated.
+  static bool FindString(std::string_view json, std::string_view key, std::string& value);
+
+  // Decode the body of a JSON string literal (no quotes)
+  static bool Unescape(std::string_view escaped, std::string& out);
+
+private:
+  enum class State {
+    VALUE,          // A value must follow
+    FIRST_MEMBER,   // After '{': a key or '}'
+    FIRST_ELEMENT,  // After '[': a value or ']'
+    AFTER_VALUE,    // ',' or the closing bracket; END at depth 0
+  };
+
+  Token Open(bool object);
+  Token Close();
+  Token ReadKey();
+  Token ReadValue();
+  Token ReadLiteral(std::string_view word, Token token);
+  bool ScanString();
+  // ScanString() via index_; false if the index does not cover this string
+  bool ScanIndexedString(bool& ok);
+  bool ScanNumber();
+  void SkipWhitespace();
+  bool InObject() const { return (object_bits_ >> (depth_ - 1)) & 1u; }
+  Token Set(Token token);
+  Token Fail();
+
+  const std::string_view json_;
+  const JsonStructuralIndex* index_ = nullptr;
+  size_t cursor_ = 0;  // First index position not yet passed
+  size_t pos_ = 0;
+  State state_ = State::VALUE;
+  Token current_ = Token::END;
+  bool failed_ = false;
+  std::string_view text_;
+  bool escaped_ = false;
+  size_t depth_ = 0;
+  uint64_t object_bits_ = 0;  // Bit i: container at depth i+1 is an object
+  size_t error_offset_ = 0;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_JSON_READER_H_
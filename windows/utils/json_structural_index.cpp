@@ -0,0 +1,582 @@
+#include "json_structural_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ANYWP_JSON_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define ANYWP_JSON_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang compile intrinsics only inside functions built for the ISA;
+// MSVC accepts them anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define ANYWP_TARGET_SSE2 __attribute__((target("sse2")))
+#define ANYWP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ANYWP_TARGET_SSE2
+#define ANYWP_TARGET_AVX2
+#endif
+
+namespace anywp_engine {
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+constexpr size_t kChunkBlocks = 64;  // Blocks classified per kernel call (4 KB)
+
+// One 64-byte block as bitmasks, bit i = byte i. The escape classes are
+// only needed near backslashes; a kernel leaves them permissive (all
+// escape chars and hex digits valid, no 'u') when neither this block nor
+// the previous one has a backslash.
+struct BlockMasks {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t control;      // < 0x20
+  uint64_t structural;   // { } [ ] : ,
+  uint64_t escape_char;  // Valid after a backslash: " \ / b f n r t u
+  uint64_t hex;
+  uint64_t u;
+};
+
+// Classify `blocks` blocks at `data`; `prev_backslash` carries across calls
+using ClassifyFn = void (*)(const uint8_t* data, size_t blocks, BlockMasks* out,
+                            bool& prev_backslash);
+
+void SetPermissiveEscapes(BlockMasks& masks) {
+  masks.escape_char = ~uint64_t{0};
+  masks.hex = ~uint64_t{0};
+  masks.u = 0;
+}
+
+// ========== Scalar ==========
+
+// SWAR over 8 bytes at a time (little-endian: byte k is bits 8k..8k+7).
+// Each test leaves 0x80 in the matching bytes, which Gather8() packs into
+// 8 mask bits.
+constexpr uint64_t kOnes = 0x0101010101010101ull;
+constexpr uint64_t kLow7 = 0x7F7F7F7F7F7F7F7Full;
+constexpr uint64_t kHigh = 0x8080808080808080ull;
+
+inline uint64_t ZeroBytes(uint64_t x) {
+  return ~(((x & kLow7) + kLow7) | x | kLow7);
+}
+
+inline uint64_t EqualBytes(uint64_t x, uint8_t c) {
+  return ZeroBytes(x ^ (kOnes * c));
+}
+
+inline uint64_t Gather8(uint64_t high_bits) {
+  return ((high_bits >> 7) * 0x0102040810204080ull) >> 56;
+}
+
+enum EscapeClass : uint8_t {
+  kEscapeChar = 1 << 0,
+  kHex = 1 << 1,
+  kU = 1 << 2,
+};
+
+struct EscapeClassTable {
+  uint8_t classes[256] = {};
+  constexpr EscapeClassTable() {
+    for (char c : {'"', '\\', '/', 'b', 'f', 'n', 'r', 't', 'u'}) {
+      classes[static_cast<uint8_t>(c)] |= kEscapeChar;
+    }
+    for (int c = '0'; c <= '9'; ++c) classes[c] |= kHex;
+    for (int c = 'a'; c <= 'f'; ++c) classes[c] |= kHex;
+    for (int c = 'A'; c <= 'F'; ++c) classes[c] |= kHex;
+    classes[static_cast<uint8_t>('u')] |= kU;
+  }
+};
+constexpr EscapeClassTable kEscapeClasses;
+
+void ClassifyScalar(const uint8_t* data, size_t blocks, BlockMasks* out, bool& prev_backslash) {
+  for (size_t b = 0; b < blocks; ++b) {
+    const uint8_t* block = data + b * kBlockSize;
+    BlockMasks& masks = out[b];
+    masks = BlockMasks{0, 0, 0, 0, 0, 0, 0};
+    for (size_t w = 0; w < kBlockSize; w += 8) {
+      uint64_t x;
+      std::memcpy(&x, block + w, sizeof(x));
+      uint64_t folded = x | (kOnes * 0x20);  // '[' -> '{', ']' -> '}'
+      uint64_t structural = EqualBytes(folded, '{') | EqualBytes(folded, '}') |
+                            EqualBytes(x, ':') | EqualBytes(x, ',');
+      // Bytes < 0x20: adding 0x60 to the low 7 bits leaves the high bit clear
+      uint64_t control = ~(((x & kLow7) + kOnes * 0x60) | x) & kHigh;
+      masks.quote |= Gather8(EqualBytes(x, '"')) << w;
+      masks.backslash |= Gather8(EqualBytes(x, '\\')) << w;
+      masks.control |= Gather8(control) << w;
+      masks.structural |= Gather8(structural) << w;
+    }
+    bool backslash = masks.backslash != 0;
+    if (!backslash && !prev_backslash) {
+      SetPermissiveEscapes(masks);
+    } else {
+      for (size_t i = 0; i < kBlockSize; ++i) {
+        uint64_t classes = kEscapeClasses.classes[block[i]];
+        masks.escape_char |= (classes & 1) << i;
+        masks.hex |= ((classes >> 1) & 1) << i;
+        masks.u |= ((classes >> 2) & 1) << i;
+      }
+    }
+    prev_backslash = backslash;
+  }
+}
+
+// ========== SSE2 / AVX2 ==========
+
+#if defined(ANYWP_JSON_X86)
+
+// lo <= byte <= hi, unsigned: SSE2 has no unsigned compare, so compare
+// the offset against its minimum with the range width
+ANYWP_TARGET_SSE2 inline __m128i InRange128(__m128i x, uint8_t lo, uint8_t hi) {
+  __m128i offset = _mm_sub_epi8(x, _mm_set1_epi8(static_cast<char>(lo)));
+  return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(static_cast<char>(hi - lo))), offset);
+}
+
+ANYWP_TARGET_SSE2 inline uint64_t Bits128(__m128i x, size_t chunk) {
+  return static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(x))) << (chunk * 16);
+}
+
+ANYWP_TARGET_SSE2
+void ClassifySse2(const uint8_t* data, size_t blocks, BlockMasks* out, bool& prev_backslash) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i lower = _mm_set1_epi8(0x20);  // '[' | 0x20 == '{', ']' | 0x20 == '}'
+  const __m128i open = _mm_set1_epi8('{');
+  const __m128i close = _mm_set1_epi8('}');
+  const __m128i colon = _mm_set1_epi8(':');
+  const __m128i comma = _mm_set1_epi8(',');
+  for (size_t b = 0; b < blocks; ++b) {
+    const uint8_t* block = data + b * kBlockSize;
+    BlockMasks& masks = out[b];
+    masks = BlockMasks{0, 0, 0, 0, 0, 0, 0};
+    __m128i chunks[4];
+    for (size_t c = 0; c < 4; ++c) {
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + c * 16));
+      chunks[c] = x;
+      __m128i folded = _mm_or_si128(x, lower);
+      __m128i structural = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+          _mm_or_si128(_mm_cmpeq_epi8(x, colon), _mm_cmpeq_epi8(x, comma)));
+      masks.quote |= Bits128(_mm_cmpeq_epi8(x, quote), c);
+      masks.backslash |= Bits128(_mm_cmpeq_epi8(x, backslash), c);
+      masks.control |= Bits128(InRange128(x, 0x00, 0x1F), c);
+      masks.structural |= Bits128(structural, c);
+    }
+    bool has_backslash = masks.backslash != 0;
+    if (!has_backslash && !prev_backslash) {
+      SetPermissiveEscapes(masks);
+    } else {
+      for (size_t c = 0; c < 4; ++c) {
+        __m128i x = chunks[c];
+        __m128i folded = _mm_or_si128(x, lower);
+        __m128i escape = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+            _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('/')), _mm_cmpeq_epi8(x, _mm_set1_epi8('b'))));
+        escape = _mm_or_si128(escape, _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('f')), _mm_cmpeq_epi8(x, _mm_set1_epi8('n'))),
+            _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('r')), _mm_cmpeq_epi8(x, _mm_set1_epi8('t')))));
+        __m128i u = _mm_cmpeq_epi8(x, _mm_set1_epi8('u'));
+        __m128i hex = _mm_or_si128(InRange128(x, '0', '9'), InRange128(folded, 'a', 'f'));
+        masks.escape_char |= Bits128(_mm_or_si128(escape, u), c);
+        masks.hex |= Bits128(hex, c);
+        masks.u |= Bits128(u, c);
+      }
+    }
+    prev_backslash = has_backslash;
+  }
+}
+
+ANYWP_TARGET_AVX2 inline __m256i InRange256(__m256i x, uint8_t lo, uint8_t hi) {
+  __m256i offset = _mm256_sub_epi8(x, _mm256_set1_epi8(static_cast<char>(lo)));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(static_cast<char>(hi - lo))),
+                           offset);
+}
+
+ANYWP_TARGET_AVX2 inline uint64_t Bits256(__m256i x, size_t chunk) {
+  return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(x))) << (chunk * 32);
+}
+
+ANYWP_TARGET_AVX2
+void ClassifyAvx2(const uint8_t* data, size_t blocks, BlockMasks* out, bool& prev_backslash) {
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i lower = _mm256_set1_epi8(0x20);
+  const __m256i open = _mm256_set1_epi8('{');
+  const __m256i close = _mm256_set1_epi8('}');
+  const __m256i colon = _mm256_set1_epi8(':');
+  const __m256i comma = _mm256_set1_epi8(',');
+  for (size_t b = 0; b < blocks; ++b) {
+    const uint8_t* block = data + b * kBlockSize;
+    BlockMasks& masks = out[b];
+    masks = BlockMasks{0, 0, 0, 0, 0, 0, 0};
+    __m256i chunks[2];
+    for (size_t c = 0; c < 2; ++c) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + c * 32));
+      chunks[c] = x;
+      __m256i folded = _mm256_or_si256(x, lower);
+      __m256i structural = _mm256_or_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)),
+          _mm256_or_si256(_mm256_cmpeq_epi8(x, colon), _mm256_cmpeq_epi8(x, comma)));
+      masks.quote |= Bits256(_mm256_cmpeq_epi8(x, quote), c);
+      masks.backslash |= Bits256(_mm256_cmpeq_epi8(x, backslash), c);
+      masks.control |= Bits256(InRange256(x, 0x00, 0x1F), c);
+      masks.structural |= Bits256(structural, c);
+    }
+    bool has_backslash = masks.backslash != 0;
+    if (!has_backslash && !prev_backslash) {
+      SetPermissiveEscapes(masks);
+    } else {
+      for (size_t c = 0; c < 2; ++c) {
+        __m256i x = chunks[c];
+        __m256i folded = _mm256_or_si256(x, lower);
+        __m256i escape = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, backslash)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('/')),
+                            _mm256_cmpeq_epi8(x, _mm256_set1_epi8('b'))));
+        escape = _mm256_or_si256(escape, _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('f')),
+                            _mm256_cmpeq_epi8(x, _mm256_set1_epi8('n'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('r')),
+                            _mm256_cmpeq_epi8(x, _mm256_set1_epi8('t')))));
+        __m256i u = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('u'));
+        __m256i hex = _mm256_or_si256(InRange256(x, '0', '9'), InRange256(folded, 'a', 'f'));
+        masks.escape_char |= Bits256(_mm256_or_si256(escape, u), c);
+        masks.hex |= Bits256(hex, c);
+        masks.u |= Bits256(u, c);
+      }
+    }
+    prev_backslash = has_backslash;
+  }
+}
+
+struct CpuFeatures {
+  bool sse2 = false;
+  bool avx2 = false;
+};
+
+CpuFeatures DetectCpu() {
+  CpuFeatures features;
+  unsigned int max_leaf = 0, ebx7 = 0, ecx1 = 0, edx1 = 0;
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  max_leaf = static_cast<unsigned int>(info[0]);
+  __cpuid(info, 1);
+  ecx1 = static_cast<unsigned int>(info[2]);
+  edx1 = static_cast<unsigned int>(info[3]);
+  if (max_leaf >= 7) {
+    __cpuidex(info, 7, 0);
+    ebx7 = static_cast<unsigned int>(info[1]);
+  }
+#else
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) {
+    return features;
+  }
+  max_leaf = eax;
+  __get_cpuid(1, &eax, &ebx, &ecx1, &edx1);
+  if (max_leaf >= 7) {
+    __get_cpuid_count(7, 0, &eax, &ebx7, &ecx, &edx);
+  }
+#endif
+  features.sse2 = (edx1 & (1u << 26)) != 0;
+
+  // AVX2 also needs the OS to save YMM state (OSXSAVE, then XCR0 bits 1-2)
+  bool osxsave = (ecx1 & (1u << 27)) != 0;
+  bool avx = (ecx1 & (1u << 28)) != 0;
+  if (osxsave && avx && (ebx7 & (1u << 5)) != 0) {
+#if defined(_MSC_VER)
+    uint64_t xcr0 = _xgetbv(0);
+#else
+    uint32_t xcr0_lo = 0, xcr0_hi = 0;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    uint64_t xcr0 = (static_cast<uint64_t>(xcr0_hi) << 32) | xcr0_lo;
+#endif
+    features.avx2 = (xcr0 & 0x6) == 0x6;
+  }
+  return features;
+}
+
+const CpuFeatures& Cpu() {
+  static const CpuFeatures features = DetectCpu();
+  return features;
+}
+
+#endif  // ANYWP_JSON_X86
+
+// ========== NEON ==========
+
+#if defined(ANYWP_JSON_NEON)
+
+// Four compare results (0x00/0xFF per byte) -> one 64-bit mask
+inline uint64_t NeonBits(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d) {
+  const uint8x16_t weights = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                              0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+  uint8x16_t sum0 = vpaddq_u8(vandq_u8(a, weights), vandq_u8(b, weights));
+  uint8x16_t sum1 = vpaddq_u8(vandq_u8(c, weights), vandq_u8(d, weights));
+  sum0 = vpaddq_u8(sum0, sum1);
+  sum0 = vpaddq_u8(sum0, sum0);
+  return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+void ClassifyNeon(const uint8_t* data, size_t blocks, BlockMasks* out, bool& prev_backslash) {
+  const uint8x16_t lower = vdupq_n_u8(0x20);
+  for (size_t b = 0; b < blocks; ++b) {
+    const uint8_t* block = data + b * kBlockSize;
+    BlockMasks& masks = out[b];
+    uint8x16_t x[4];
+    uint8x16_t quote[4], backslash[4], control[4], structural[4];
+    for (size_t c = 0; c < 4; ++c) {
+      x[c] = vld1q_u8(block + c * 16);
+      uint8x16_t folded = vorrq_u8(x[c], lower);
+      quote[c] = vceqq_u8(x[c], vdupq_n_u8('"'));
+      backslash[c] = vceqq_u8(x[c], vdupq_n_u8('\\'));
+      control[c] = vcltq_u8(x[c], vdupq_n_u8(0x20));
+      structural[c] = vorrq_u8(
+          vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')), vceqq_u8(folded, vdupq_n_u8('}'))),
+          vorrq_u8(vceqq_u8(x[c], vdupq_n_u8(':')), vceqq_u8(x[c], vdupq_n_u8(','))));
+    }
+    masks.quote = NeonBits(quote[0], quote[1], quote[2], quote[3]);
+    masks.backslash = NeonBits(backslash[0], backslash[1], backslash[2], backslash[3]);
+    masks.control = NeonBits(control[0], control[1], control[2], control[3]);
+    masks.structural = NeonBits(structural[0], structural[1], structural[2], structural[3]);
+
+    bool has_backslash = masks.backslash != 0;
+    if (!has_backslash && !prev_backslash) {
+      SetPermissiveEscapes(masks);
+    } else {
+      uint8x16_t escape[4], hex[4], u[4];
+      for (size_t c = 0; c < 4; ++c) {
+        uint8x16_t folded = vorrq_u8(x[c], lower);
+        u[c] = vceqq_u8(x[c], vdupq_n_u8('u'));
+        uint8x16_t e = vorrq_u8(quote[c], backslash[c]);
+        for (uint8_t ch : {'/', 'b', 'f', 'n', 'r', 't'}) {
+          e = vorrq_u8(e, vceqq_u8(x[c], vdupq_n_u8(ch)));
+        }
+        escape[c] = vorrq_u8(e, u[c]);
+        uint8x16_t digit = vcleq_u8(vsubq_u8(x[c], vdupq_n_u8('0')), vdupq_n_u8(9));
+        uint8x16_t letter = vcleq_u8(vsubq_u8(folded, vdupq_n_u8('a')), vdupq_n_u8(5));
+        hex[c] = vorrq_u8(digit, letter);
+      }
+      masks.escape_char = NeonBits(escape[0], escape[1], escape[2], escape[3]);
+      masks.hex = NeonBits(hex[0], hex[1], hex[2], hex[3]);
+      masks.u = NeonBits(u[0], u[1], u[2], u[3]);
+    }
+    prev_backslash = has_backslash;
+  }
+}
+
+#endif  // ANYWP_JSON_NEON
+
+// ========== Portable bit arithmetic ==========
+
+inline unsigned CountTrailingZeros(uint64_t bits) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long index;
+  _BitScanForward64(&index, bits);
+  return static_cast<unsigned>(index);
+#elif defined(_MSC_VER)
+  unsigned long index;
+  if (_BitScanForward(&index, static_cast<unsigned long>(bits))) {
+    return static_cast<unsigned>(index);
+  }
+  _BitScanForward(&index, static_cast<unsigned long>(bits >> 32));
+  return static_cast<unsigned>(index) + 32;
+#else
+  return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+}
+
+// Bit i = XOR of bits 0..i: 1 from an opening quote up to (not including)
+// its closing quote
+inline uint64_t PrefixXor(uint64_t bits) {
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+}
+
+struct Stage1State {
+  uint64_t prev_escaped = 0;    // Bit 0: first byte of the block is escaped
+  uint64_t prev_in_string = 0;  // All ones if the previous block ended inside a string
+  uint64_t hex_carry = 0;       // \u digits owed by the previous block
+  size_t first_error = JsonStructuralIndex::kNoError;
+};
+
+// Bytes escaped by a backslash: the second of each pair in a backslash run
+// (simdjson's branchless odd-sequence trick)
+inline uint64_t FindEscaped(uint64_t backslash, uint64_t& prev_escaped) {
+  backslash &= ~prev_escaped;
+  uint64_t follows_escape = (backslash << 1) | prev_escaped;
+  constexpr uint64_t kEvenBits = 0x5555555555555555ull;
+  uint64_t odd_sequence_starts = backslash & ~kEvenBits & ~follows_escape;
+  uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+  prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts ? 1 : 0;
+  uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+  return (kEvenBits ^ invert_mask) & follows_escape;
+}
+
+uint32_t* ResolveBlock(const BlockMasks& masks, size_t base, Stage1State& state, uint32_t* out) {
+  uint64_t escaped = FindEscaped(masks.backslash, state.prev_escaped);
+  uint64_t quotes = masks.quote & ~escaped;
+  uint64_t in_string = PrefixXor(quotes) ^ state.prev_in_string;
+  state.prev_in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+  uint64_t content = in_string & ~quotes;
+
+  // Four hex digits after each \u, possibly running into the next block
+  uint64_t u = escaped & masks.u;
+  uint64_t need_hex = (u << 1) | (u << 2) | (u << 3) | (u << 4) | state.hex_carry;
+  state.hex_carry = ((u >> 63) & 1) * 0xF | ((u >> 62) & 1) * 0x7 |
+                    ((u >> 61) & 1) * 0x3 | ((u >> 60) & 1);
+
+  // The closing quote counts as part of the string: "\u12" fails there
+  uint64_t errors = ((masks.control | (escaped & ~masks.escape_char)) & content) |
+                    (need_hex & ~masks.hex & (content | quotes));
+  if (errors != 0 && state.first_error == JsonStructuralIndex::kNoError) {
+    state.first_error = base + CountTrailingZeros(errors);
+  }
+
+  uint64_t bits = quotes | (masks.structural & ~in_string);
+  while (bits != 0) {
+    *out++ = static_cast<uint32_t>(base + CountTrailingZeros(bits));
+    bits &= bits - 1;
+  }
+  return out;
+}
+
+ClassifyFn ClassifierFor(JsonStructuralIndex::Kernel kernel) {
+  switch (kernel) {
+#if defined(ANYWP_JSON_X86)
+    case JsonStructuralIndex::Kernel::SSE2:
+      return ClassifySse2;
+    case JsonStructuralIndex::Kernel::AVX2:
+      return ClassifyAvx2;
+#endif
+#if defined(ANYWP_JSON_NEON)
+    case JsonStructuralIndex::Kernel::NEON:
+      return ClassifyNeon;
+#endif
+    default:
+      return ClassifyScalar;
+  }
+}
+
+}  // namespace
+
+JsonStructuralIndex::JsonStructuralIndex() {
+}
+
+JsonStructuralIndex::~JsonStructuralIndex() {
+}
+
+bool JsonStructuralIndex::Build(std::string_view json) {
+  return Build(json, BestKernel());
+}
+
+bool JsonStructuralIndex::Build(std::string_view json, Kernel kernel) {
+  size_ = 0;
+  first_error_ = kNoError;
+  if (!IsSupported(kernel) || json.size() >= std::numeric_limits<uint32_t>::max()) {
+    return false;
+  }
+  // At most one position per byte
+  size_t needed = std::max<size_t>(json.size(), 1);
+  if (capacity_ < needed) {
+    positions_.reset(new uint32_t[needed]);
+    capacity_ = needed;
+  }
+
+  ClassifyFn classify = ClassifierFor(kernel);
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(json.data());
+  size_t full_blocks = json.size() / kBlockSize;
+  uint32_t* out = positions_.get();
+  Stage1State state;
+  bool prev_backslash = false;
+  BlockMasks masks[kChunkBlocks];
+
+  for (size_t block = 0; block < full_blocks; block += kChunkBlocks) {
+    size_t count = std::min(kChunkBlocks, full_blocks - block);
+    classify(data + block * kBlockSize, count, masks, prev_backslash);
+    for (size_t i = 0; i < count; ++i) {
+      out = ResolveBlock(masks[i], (block + i) * kBlockSize, state, out);
+    }
+  }
+  size_t tail = json.size() % kBlockSize;
+  if (tail != 0) {
+    // Pad with spaces: no class of interest
+    uint8_t padded[kBlockSize];
+    std::memset(padded, ' ', sizeof(padded));
+    std::memcpy(padded, data + full_blocks * kBlockSize, tail);
+    classify(padded, 1, masks, prev_backslash);
+    out = ResolveBlock(masks[0], full_blocks * kBlockSize, state, out);
+  }
+
+  size_ = static_cast<size_t>(out - positions_.get());
+  // \u digits owed past the end fall in the padding: an unterminated string
+  first_error_ = state.first_error < json.size() ? state.first_error : kNoError;
+  kernel_ = kernel;
+  return true;
+}
+
+JsonStructuralIndex::Kernel JsonStructuralIndex::BestKernel() {
+  static const Kernel best = [] {
+    if (IsSupported(Kernel::AVX2)) return Kernel::AVX2;
+    if (IsSupported(Kernel::NEON)) return Kernel::NEON;
+    if (IsSupported(Kernel::SSE2)) return Kernel::SSE2;
+    return Kernel::SCALAR;
+  }();
+  return best;
+}
+
+bool JsonStructuralIndex::IsSupported(Kernel kernel) {
+  switch (kernel) {
+    case Kernel::SCALAR:
+      return true;
+#if defined(ANYWP_JSON_X86)
+    case Kernel::SSE2:
+      return Cpu().sse2;
+    case Kernel::AVX2:
+      return Cpu().avx2;
+#endif
+#if defined(ANYWP_JSON_NEON)
+    case Kernel::NEON:
+      return true;  // Mandatory on ARM64
+#endif
+    default:
+      return false;
+  }
+}
+
+const char* JsonStructuralIndex::KernelName(Kernel kernel) {
+  switch (kernel) {
+    case Kernel::SCALAR: return "scalar";
+    case Kernel::SSE2:   return "sse2";
+    case Kernel::AVX2:   return "avx2";
+    case Kernel::NEON:   return "neon";
+  }
+  return "unknown";
+}
+
+const JsonStructuralIndex* JsonStructuralIndex::ForThread(std::string_view json) {
+  if (json.size() < kMinIndexedBytes) {
+    return nullptr;
+  }
+  thread_local JsonStructuralIndex index;
+  return index.Build(json) ? &index : nullptr;
+}
+
+}  // namespace anywp_engine
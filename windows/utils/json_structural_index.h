@@ -0,0 +1,89 @@
+#ifndef ANYWP_ENGINE_JSON_STRUCTURAL_INDEX_H_
+#define ANYWP_ENGINE_JSON_STRUCTURAL_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace anywp_engine {
+
+/**
+ * JsonStructuralIndex - Bulk structural scan of a JSON document
+ *
+ * One pass over the input, 64 bytes at a time (simdjson's "stage 1"),
+ * that records the offset of every unescaped quote and of every { } [ ] :
+ * and , outside strings. JsonReader uses it to jump from an opening quote
+ * straight to its closing one instead of scanning the string byte by byte,
+ * which is most of the work on a saveState message carrying a stringified
+ * layout. Messages made of many short strings and numbers (IFRAME_DATA)
+ * gain less than the pass costs and are read unindexed.
+ *
+ * Per block, a kernel compares the bytes against each character class and
+ * turns the results into 64-bit masks. Portable bit arithmetic then finds
+ * escaped characters (odd runs of backslashes), the quote-to-quote string
+ * regions (prefix XOR) and the structurals outside them. The same pass
+ * validates string contents: control characters, unknown escapes and
+ * \u escapes without four hex digits are reported through FirstError(),
+ * so an indexed reader rejects exactly what an unindexed one does.
+ *
+ * Kernels: AVX2 and SSE2 on x86/x64, NEON on ARM64, and a table-driven
+ * scalar fallback. BestKernel() picks one once from CPUID; every kernel
+ * produces the same index.
+ *
+ * Thread-safe: No (one index per thread; see ForThread())
+ */
+class JsonStructuralIndex {
+public:
+  enum class Kernel {
+    SCALAR,
+    SSE2,
+    AVX2,
+    NEON,
+  };
+
+  // Below this size a plain JsonReader scan is as fast as indexing first
+  // (perf_benchmarks message.structural_index)
+  static constexpr size_t kMinIndexedBytes = 1024;
+
+  JsonStructuralIndex();
+  ~JsonStructuralIndex();
+
+  JsonStructuralIndex(const JsonStructuralIndex&) = delete;
+  JsonStructuralIndex& operator=(const JsonStructuralIndex&) = delete;
+
+  // Index `json` (which must outlive the index's use) with BestKernel() or
+  // `kernel`; false if the kernel is not supported here or the input is
+  // 4 GB or larger. Storage is reused across calls.
+  bool Build(std::string_view json);
+  bool Build(std::string_view json, Kernel kernel);
+
+  // Offsets of quotes and structurals, ascending
+  const uint32_t* Positions() const { return positions_.get(); }
+  size_t Size() const { return size_; }
+
+  // Offset of the first malformed byte inside a string, or kNoError
+  static constexpr size_t kNoError = static_cast<size_t>(-1);
+  size_t FirstError() const { return first_error_; }
+
+  Kernel GetKernel() const { return kernel_; }
+
+  static Kernel BestKernel();
+  static bool IsSupported(Kernel kernel);
+  static const char* KernelName(Kernel kernel);
+
+  // This thread's reusable index built over `json`, or nullptr when `json`
+  // is under kMinIndexedBytes (or cannot be indexed)
+  static const JsonStructuralIndex* ForThread(std::string_view json);
+
+private:
+  std::unique_ptr<uint32_t[]> positions_;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+  size_t first_error_ = kNoError;
+  Kernel kernel_ = Kernel::SCALAR;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_JSON_STRUCTURAL_INDEX_H_
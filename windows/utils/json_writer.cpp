@@ -0,0 +1,264 @@
+#include "json_writer.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace anywp_engine {
+
+namespace {
+
+// Byte classes: plain ASCII is copied in runs, the rest is handled one at
+// a time. Escaped bytes map to the letter after the backslash ('u' for
+// \u00XX).
+constexpr uint8_t kPlain = 0;
+constexpr uint8_t kNonAscii = 1;
+
+struct ByteClassTable {
+  uint8_t classes[256] = {};
+  constexpr ByteClassTable() {
+    for (int c = 0; c < 0x20; ++c) classes[c] = 'u';
+    classes[static_cast<uint8_t>('\b')] = 'b';
+    classes[static_cast<uint8_t>('\f')] = 'f';
+    classes[static_cast<uint8_t>('\n')] = 'n';
+    classes[static_cast<uint8_t>('\r')] = 'r';
+    classes[static_cast<uint8_t>('\t')] = 't';
+    classes[static_cast<uint8_t>('"')] = '"';
+    classes[static_cast<uint8_t>('\\')] = '\\';
+    for (int c = 0x80; c < 0x100; ++c) classes[c] = kNonAscii;
+  }
+};
+constexpr ByteClassTable kByteClasses;
+
+constexpr uint32_t kReplacement = 0xFFFD;
+
+// Decode the UTF-8 sequence at `p` (first byte >= 0x80). Returns its
+// length, or 0 if it is not well-formed (overlong, surrogate, > U+10FFFF,
+// truncated).
+size_t DecodeUtf8(const uint8_t* p, const uint8_t* end, uint32_t& code_point) {
+  uint8_t lead = p[0];
+  size_t length;
+  uint8_t min_next = 0x80;
+  uint8_t max_next = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+    code_point = lead & 0x1F;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    code_point = lead & 0x0F;
+    if (lead == 0xE0) min_next = 0xA0;
+    if (lead == 0xED) max_next = 0x9F;  // No surrogates
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    code_point = lead & 0x07;
+    if (lead == 0xF0) min_next = 0x90;
+    if (lead == 0xF4) max_next = 0x8F;
+  } else {
+    return 0;
+  }
+  if (static_cast<size_t>(end - p) < length) {
+    return 0;
+  }
+  for (size_t i = 1; i < length; ++i) {
+    uint8_t next = p[i];
+    if (next < min_next || next > max_next) {
+      return 0;
+    }
+    min_next = 0x80;
+    max_next = 0xBF;
+    code_point = (code_point << 6) | (next & 0x3F);
+  }
+  return length;
+}
+
+}  // namespace
+
+template <typename Char>
+void BasicJsonWriter<Char>::Clear() {
+  buffer_.clear();
+  need_comma_ = false;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::BeginObject() {
+  BeforeValue();
+  buffer_.push_back(static_cast<Char>('{'));
+  need_comma_ = false;
+  return *this;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::EndObject() {
+  buffer_.push_back(static_cast<Char>('}'));
+  need_comma_ = true;
+  return *this;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::BeginArray() {
+  BeforeValue();
+  buffer_.push_back(static_cast<Char>('['));
+  need_comma_ = false;
+  return *this;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::EndArray() {
+  buffer_.push_back(static_cast<Char>(']'));
+  need_comma_ = true;
+  return *this;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::Key(std::string_view utf8) {
+  String(utf8);
+  buffer_.push_back(static_cast<Char>(':'));
+  need_comma_ = false;
+  return *this;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::String(std::string_view utf8) {
+  BeforeValue();
+  buffer_.reserve(buffer_.size() + utf8.size() + 2);
+  buffer_.push_back(static_cast<Char>('"'));
+  Append(utf8, true);
+  buffer_.push_back(static_cast<Char>('"'));
+  return *this;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::Int(int64_t value) {
+  BeforeValue();
+  char digits[24];
+  auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  AppendAscii(digits, static_cast<size_t>(result.ptr - digits));
+  return *this;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::Double(double value) {
+  if (!std::isfinite(value)) {
+    return Null();
+  }
+  // Whole numbers as integers: shortest form would give 1e+06 for 1000000
+  if (value == std::trunc(value) && std::fabs(value) < 9007199254740992.0) {
+    return Int(static_cast<int64_t>(value));
+  }
+  BeforeValue();
+  char digits[32];
+  auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  AppendAscii(digits, static_cast<size_t>(result.ptr - digits));
+  return *this;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::Bool(bool value) {
+  BeforeValue();
+  if (value) {
+    AppendAscii("true", 4);
+  } else {
+    AppendAscii("false", 5);
+  }
+  return *this;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::Null() {
+  BeforeValue();
+  AppendAscii("null", 4);
+  return *this;
+}
+
+template <typename Char>
+BasicJsonWriter<Char>& BasicJsonWriter<Char>::Raw(std::string_view utf8) {
+  Append(utf8, false);
+  need_comma_ = false;
+  return *this;
+}
+
+template <typename Char>
+void BasicJsonWriter<Char>::BeforeValue() {
+  if (need_comma_) {
+    buffer_.push_back(static_cast<Char>(','));
+  }
+  need_comma_ = true;
+}
+
+template <typename Char>
+void BasicJsonWriter<Char>::AppendAscii(const char* text, size_t length) {
+  if constexpr (sizeof(Char) == 1) {
+    buffer_.append(text, length);
+  } else if (length < 16) {
+    // Runs between escapes are short; resize() costs more than it saves
+    for (size_t i = 0; i < length; ++i) {
+      buffer_.push_back(static_cast<Char>(static_cast<uint8_t>(text[i])));
+    }
+  } else {
+    // Widen in place: append(first, last) from another character type
+    // builds a temporary string
+    size_t old_size = buffer_.size();
+    buffer_.resize(old_size + length);
+    Char* out = &buffer_[old_size];
+    for (size_t i = 0; i < length; ++i) {
+      out[i] = static_cast<Char>(static_cast<uint8_t>(text[i]));
+    }
+  }
+}
+
+template <typename Char>
+void BasicJsonWriter<Char>::Append(std::string_view utf8, bool escape) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(utf8.data());
+  const uint8_t* end = p + utf8.size();
+  while (p < end) {
+    const uint8_t* run = p;
+    if (escape) {
+      while (p < end && kByteClasses.classes[*p] == kPlain) ++p;
+    } else {
+      while (p < end && *p < 0x80) ++p;
+    }
+    AppendAscii(reinterpret_cast<const char*>(run), static_cast<size_t>(p - run));
+    if (p == end) {
+      break;
+    }
+
+    uint8_t byte_class = kByteClasses.classes[*p];
+    if (byte_class != kNonAscii) {
+      buffer_.push_back(static_cast<Char>('\\'));
+      buffer_.push_back(static_cast<Char>(byte_class));
+      if (byte_class == 'u') {
+        static const char kHexDigits[] = "0123456789abcdef";
+        char digits[4] = {'0', '0', kHexDigits[*p >> 4], kHexDigits[*p & 0xF]};
+        AppendAscii(digits, sizeof(digits));
+      }
+      ++p;
+      continue;
+    }
+
+    uint32_t code_point = 0;
+    size_t length = DecodeUtf8(p, end, code_point);
+    if (length == 0) {
+      code_point = kReplacement;
+    }
+    if (escape && (code_point == 0x2028 || code_point == 0x2029)) {
+      AppendAscii(code_point == 0x2028 ? "\\u2028" : "\\u2029", 6);
+    } else if constexpr (sizeof(Char) == 1) {
+      if (length == 0) {
+        AppendAscii("\xEF\xBF\xBD", 3);
+      } else {
+        buffer_.append(reinterpret_cast<const char*>(p), length);
+      }
+    } else if (code_point < 0x10000) {
+      buffer_.push_back(static_cast<Char>(code_point));
+    } else {
+      code_point -= 0x10000;
+      buffer_.push_back(static_cast<Char>(0xD800 + (code_point >> 10)));
+      buffer_.push_back(static_cast<Char>(0xDC00 + (code_point & 0x3FF)));
+    }
+    p += length == 0 ? 1 : length;
+  }
+}
+
+template class BasicJsonWriter<char>;
+template class BasicJsonWriter<wchar_t>;
+
+}  // namespace anywp_engine
@@ -0,0 +1,88 @@
+#ifndef ANYWP_ENGINE_JSON_WRITER_H_
+#define ANYWP_ENGINE_JSON_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace anywp_engine {
+
+/**
+ * BasicJsonWriter - Streaming JSON / JS-literal writer for outbound messages
+ *
+ * Appends JSON straight into one buffer that is kept across messages:
+ * Clear() empties it without giving the memory back, so a writer reused
+ * for every mouse event or state notification stops allocating after the
+ * first few. Commas are inserted automatically; the caller only says
+ * what comes next.
+ *
+ *   WideJsonWriter& json = ...;
+ *   json.Clear();
+ *   json.BeginObject().Key("type").String("mouseEvent").Key("x").Int(x).EndObject();
+ *   webview->PostWebMessageAsJson(json.CStr());
+ *
+ * Input text is UTF-8. JsonWriter (char) writes UTF-8 and WideJsonWriter
+ * (wchar_t) writes UTF-16, the encoding WebView2 takes, so no separate
+ * conversion pass is needed. Strings are escaped once, as they are
+ * appended, for both JSON and JavaScript: quotes, backslashes, control
+ * characters and U+2028/U+2029 (line terminators inside JS string
+ * literals). Invalid UTF-8 becomes U+FFFD. A String() is therefore
+ * always a valid JSON string and a valid JS string literal, whatever the
+ * bytes it came from.
+ *
+ * Raw() appends script text around the JSON, unescaped:
+ *   json.Raw("window.dispatchEvent(new CustomEvent('AnyWP:stateSaved', {detail: ");
+ *   json.BeginObject()...EndObject();
+ *   json.Raw("}));");
+ *
+ * Thread-safe: No (one writer per thread)
+ */
+template <typename Char>
+class BasicJsonWriter {
+public:
+  BasicJsonWriter() = default;
+
+  // Start a new message, keeping the buffer's capacity
+  void Clear();
+
+  BasicJsonWriter& BeginObject();
+  BasicJsonWriter& EndObject();
+  BasicJsonWriter& BeginArray();
+  BasicJsonWriter& EndArray();
+  BasicJsonWriter& Key(std::string_view utf8);
+
+  BasicJsonWriter& String(std::string_view utf8);
+  BasicJsonWriter& Int(int64_t value);
+  // Whole numbers as integers, others in shortest round-trip form ("0.1");
+  // NaN and infinities as null
+  BasicJsonWriter& Double(double value);
+  BasicJsonWriter& Bool(bool value);
+  BasicJsonWriter& Null();
+
+  // Script or pre-encoded JSON, appended verbatim (UTF-8 in); the next
+  // value or key starts without a comma
+  BasicJsonWriter& Raw(std::string_view utf8);
+
+  const Char* CStr() const { return buffer_.c_str(); }
+  std::basic_string_view<Char> View() const { return buffer_; }
+  size_t Size() const { return buffer_.size(); }
+
+private:
+  void BeforeValue();
+  void Append(std::string_view utf8, bool escape);
+  void AppendAscii(const char* text, size_t length);
+
+  std::basic_string<Char> buffer_;
+  bool need_comma_ = false;
+};
+
+using JsonWriter = BasicJsonWriter<char>;
+using WideJsonWriter = BasicJsonWriter<wchar_t>;
+
+extern template class BasicJsonWriter<char>;
+extern template class BasicJsonWriter<wchar_t>;
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_JSON_WRITER_H_
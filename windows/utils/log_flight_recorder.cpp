@@ -0,0 +1,390 @@
+#include "log_flight_recorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace anywp_engine {
+
+namespace {
+
+constexpr char kMagic[8] = {'A', 'N', 'Y', 'W', 'P', 'F', 'R', '1'};
+constexpr uint32_t kVersion = 1;
+
+// On-disk header; the positions are updated in place through the mapping
+struct RecorderHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t capacity;
+  std::atomic<uint64_t> reserve_pos;
+  std::atomic<uint64_t> commit_pos;
+  char reserved[24];
+};
+
+static_assert(sizeof(RecorderHeader) == LogFlightRecorder::kHeaderSize,
+              "Flight recorder header must stay 64 bytes");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "Header positions must have plain uint64 layout");
+
+// Plain-data view of the header, used by the offline reader
+struct HeaderFields {
+  uint64_t capacity;
+  uint64_t reserve_pos;
+  uint64_t commit_pos;
+};
+
+bool ParseHeader(const char* data, size_t size, HeaderFields& fields) {
+  if (size < LogFlightRecorder::kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+  uint32_t version = 0;
+  uint32_t header_size = 0;
+  std::memcpy(&version, data + 8, sizeof(version));
+  std::memcpy(&header_size, data + 12, sizeof(header_size));
+  std::memcpy(&fields.capacity, data + 16, sizeof(fields.capacity));
+  std::memcpy(&fields.reserve_pos, data + 24, sizeof(fields.reserve_pos));
+  std::memcpy(&fields.commit_pos, data + 32, sizeof(fields.commit_pos));
+  // No write claims more than the ring holds: a larger gap is corruption
+  return version == kVersion && header_size == LogFlightRecorder::kHeaderSize &&
+         fields.capacity > 0 && fields.commit_pos <= fields.reserve_pos &&
+         fields.reserve_pos - fields.commit_pos <= fields.capacity;
+}
+
+RecorderHeader* HeaderOf(char* base) {
+  return reinterpret_cast<RecorderHeader*>(base);
+}
+
+}  // namespace
+
+// ========== Platform Mapping ==========
+
+class LogFlightRecorder::MappedFile {
+public:
+  ~MappedFile() { Unmap(); }
+
+  // Map `size` bytes of `path`, creating or resizing the file as needed
+  bool Map(const std::string& path, size_t size) {
+#ifdef _WIN32
+    file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    LARGE_INTEGER current;
+    if (!GetFileSizeEx(file_, &current) || static_cast<uint64_t>(current.QuadPart) != size) {
+      LARGE_INTEGER target;
+      target.QuadPart = static_cast<LONGLONG>(size);
+      if (!SetFilePointerEx(file_, target, nullptr, FILE_BEGIN) || !SetEndOfFile(file_)) {
+        Unmap();
+        return false;
+      }
+      resized_ = true;
+    }
+    uint64_t size64 = size;
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE,
+                                  static_cast<DWORD>(size64 >> 32),
+                                  static_cast<DWORD>(size64 & 0xFFFFFFFFu), nullptr);
+    if (!mapping_) {
+      Unmap();
+      return false;
+    }
+    data_ = static_cast<char*>(MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, size));
+    if (!data_) {
+      Unmap();
+      return false;
+    }
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+      return false;
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) != size) {
+      if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        Unmap();
+        return false;
+      }
+      resized_ = true;
+    }
+    void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED) {
+      Unmap();
+      return false;
+    }
+    data_ = static_cast<char*>(data);
+#endif
+    size_ = size;
+    return true;
+  }
+
+  void Unmap() {
+#ifdef _WIN32
+    if (data_) {
+      UnmapViewOfFile(data_);
+    }
+    if (mapping_) {
+      CloseHandle(mapping_);
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(file_);
+    }
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_) {
+      ::munmap(data_, size_);
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  void Sync() {
+    if (!data_) {
+      return;
+    }
+#ifdef _WIN32
+    FlushViewOfFile(data_, size_);
+#else
+    ::msync(data_, size_, MS_ASYNC);
+#endif
+  }
+
+  char* Data() const { return data_; }
+  bool WasResized() const { return resized_; }
+
+private:
+#ifdef _WIN32
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  bool resized_ = false;
+};
+
+// ========== Lifecycle ==========
+
+LogFlightRecorder::LogFlightRecorder() = default;
+
+LogFlightRecorder::~LogFlightRecorder() {
+  Close();
+}
+
+bool LogFlightRecorder::Open(const std::string& path, size_t capacity) {
+  Close();
+
+  capacity = std::max(capacity, kMinCapacity);
+  auto mapping = std::make_unique<MappedFile>();
+  if (!mapping->Map(path, kHeaderSize + capacity)) {
+    return false;
+  }
+
+  char* base = mapping->Data();
+  HeaderFields existing;
+  bool keep_history = !mapping->WasResized() &&
+                      ParseHeader(base, kHeaderSize, existing) &&
+                      existing.capacity == capacity;
+
+  RecorderHeader* header = HeaderOf(base);
+  if (!keep_history) {
+    std::memset(base, 0, kHeaderSize);
+    std::memcpy(header->magic, kMagic, sizeof(kMagic));
+    header->version = kVersion;
+    header->header_size = static_cast<uint32_t>(kHeaderSize);
+    header->capacity = capacity;
+    header->reserve_pos.store(0, std::memory_order_relaxed);
+    header->commit_pos.store(0, std::memory_order_release);
+  }
+
+  mapping_ = std::move(mapping);
+  path_ = path;
+  ring_ = base + kHeaderSize;
+  capacity_ = capacity;
+
+  if (keep_history && existing.reserve_pos > existing.commit_pos) {
+    SealTornWrite(existing.commit_pos, existing.reserve_pos);
+  }
+  return true;
+}
+
+void LogFlightRecorder::Close() {
+  if (mapping_) {
+    mapping_->Sync();
+    mapping_.reset();
+  }
+  ring_ = nullptr;
+  capacity_ = 0;
+}
+
+bool LogFlightRecorder::IsOpen() const {
+  return ring_ != nullptr;
+}
+
+// ========== Writing ==========
+
+void LogFlightRecorder::Append(std::string_view line) {
+  if (!ring_) {
+    return;
+  }
+
+  // Keep the tail of a line longer than the ring
+  if (line.size() + 1 > capacity_) {
+    line = line.substr(line.size() + 1 - capacity_);
+  }
+
+  RecorderHeader* header = HeaderOf(mapping_->Data());
+  uint64_t pos = header->commit_pos.load(std::memory_order_relaxed);
+  uint64_t end = pos + line.size() + 1;
+
+  header->reserve_pos.store(end, std::memory_order_release);
+  CopyIn(pos, line.data(), line.size());
+  CopyIn(pos + line.size(), "\n", 1);
+  header->commit_pos.store(end, std::memory_order_release);
+}
+
+void LogFlightRecorder::AppendRaw(std::string_view text) {
+  if (!ring_ || text.empty()) {
+    return;
+  }
+
+  if (text.size() > capacity_) {
+    text = text.substr(text.size() - capacity_);
+  }
+
+  RecorderHeader* header = HeaderOf(mapping_->Data());
+  uint64_t pos = header->commit_pos.load(std::memory_order_relaxed);
+  uint64_t end = pos + text.size();
+
+  header->reserve_pos.store(end, std::memory_order_release);
+  CopyIn(pos, text.data(), text.size());
+  header->commit_pos.store(end, std::memory_order_release);
+}
+
+void LogFlightRecorder::SealTornWrite(uint64_t commit_pos, uint64_t reserve_pos) {
+  // A crashed session claimed [commit_pos, reserve_pos) and may have
+  // overwritten the oldest bytes of the ring with part of it. Lowering
+  // reserve_pos would put those bytes back in the trusted window; instead
+  // the claimed range becomes a marker line and is committed, so the window
+  // moves past what the torn write clobbered.
+  static constexpr std::string_view kMarker = "[flight recorder: torn write dropped]";
+  // ParseHeader() rejects larger gaps; the clamp only keeps this allocation
+  // bounded by the ring whatever the header says
+  uint64_t gap = std::min<uint64_t>(reserve_pos - commit_pos, capacity_);
+  std::string filler(static_cast<size_t>(gap), ' ');
+  kMarker.copy(&filler[0], std::min(kMarker.size(), filler.size() - 1));
+  filler.back() = '\n';
+
+  RecorderHeader* header = HeaderOf(mapping_->Data());
+  CopyIn(reserve_pos - gap, filler.data(), filler.size());
+  header->commit_pos.store(reserve_pos, std::memory_order_release);
+}
+
+void LogFlightRecorder::CopyIn(uint64_t pos, const char* data, size_t size) {
+  size_t offset = static_cast<size_t>(pos % capacity_);
+  size_t first = std::min(size, capacity_ - offset);
+  std::memcpy(ring_ + offset, data, first);
+  if (first < size) {
+    std::memcpy(ring_, data + first, size - first);
+  }
+}
+
+void LogFlightRecorder::Sync() {
+  if (mapping_) {
+    mapping_->Sync();
+  }
+}
+
+size_t LogFlightRecorder::GetCapacity() const {
+  return capacity_;
+}
+
+uint64_t LogFlightRecorder::GetTotalWritten() const {
+  if (!mapping_) {
+    return 0;
+  }
+  return HeaderOf(mapping_->Data())->commit_pos.load(std::memory_order_acquire);
+}
+
+// ========== Offline Recovery ==========
+
+bool LogFlightRecorder::ReadFile(const std::string& path, std::string& out, size_t max_bytes) {
+  out.clear();
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  char header_bytes[kHeaderSize];
+  if (!file.read(header_bytes, kHeaderSize)) {
+    return false;
+  }
+  HeaderFields header;
+  if (!ParseHeader(header_bytes, kHeaderSize, header)) {
+    return false;
+  }
+
+  // The ring must be in the file before it is allocated
+  std::error_code ec;
+  uint64_t file_size = std::filesystem::file_size(path, ec);
+  if (ec || file_size - kHeaderSize < header.capacity) {
+    return false;
+  }
+
+  std::vector<char> ring(static_cast<size_t>(header.capacity));
+  if (!file.read(ring.data(), static_cast<std::streamsize>(ring.size()))) {
+    return false;
+  }
+
+  // Trusted window: anything before reserve_pos - capacity may be overwritten
+  uint64_t end = header.commit_pos;
+  uint64_t begin = header.reserve_pos > header.capacity ? header.reserve_pos - header.capacity : 0;
+  if (max_bytes > 0 && end - begin > max_bytes) {
+    begin = end - max_bytes;
+  }
+  if (begin >= end) {
+    return true;
+  }
+
+  std::string text;
+  text.reserve(static_cast<size_t>(end - begin));
+  for (uint64_t pos = begin; pos < end;) {
+    size_t offset = static_cast<size_t>(pos % header.capacity);
+    size_t chunk = static_cast<size_t>(std::min<uint64_t>(end - pos, header.capacity - offset));
+    text.append(ring.data() + offset, chunk);
+    pos += chunk;
+  }
+
+  // Drop the partial first line unless the window starts at the very beginning
+  size_t start = 0;
+  if (begin > 0) {
+    size_t newline = text.find('\n');
+    start = newline == std::string::npos ? text.size() : newline + 1;
+  }
+  out.assign(text, start, std::string::npos);
+  return true;
+}
+
+}  // namespace anywp_engine
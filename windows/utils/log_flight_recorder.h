@@ -0,0 +1,89 @@
+#ifndef ANYWP_ENGINE_LOG_FLIGHT_RECORDER_H_
+#define ANYWP_ENGINE_LOG_FLIGHT_RECORDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace anywp_engine {
+
+/**
+ * LogFlightRecorder - Crash-surviving circular log file
+ *
+ * A fixed-size file mapped into memory and written as a byte ring. Appending
+ * a line is two memcpy calls plus two stores into the mapped header. There are
+ * no syscalls and no flushes. The OS writes the pages back on its own, even if
+ * the process crashes or is killed, so the last `capacity` bytes of log history
+ * can be recovered offline with ReadFile() (see tools/flight_recorder_dump.cpp).
+ *
+ * File layout (little-endian):
+ *   [0..64)    Header
+ *     magic        "ANYWPFR1"
+ *     version      uint32
+ *     header_size  uint32
+ *     capacity     uint64  ring size in bytes
+ *     reserve_pos  uint64  total bytes claimed (updated before the copy)
+ *     commit_pos   uint64  total bytes written (updated after the copy)
+ *   [64..64+capacity)  Ring of newline-terminated log lines
+ *
+ * A reader trusts [reserve_pos - capacity, commit_pos). Bytes that a torn
+ * write may have overwritten are excluded, and the first partial line is dropped.
+ *
+ * Reopening an existing recorder with the same capacity keeps its history,
+ * so the previous session is still there after a crash and restart. A write
+ * the crash tore (reserve_pos > commit_pos) is overwritten with a marker
+ * line and committed, never un-claimed.
+ *
+ * Thread-safe: No (Logger serializes Append under its mutex)
+ */
+class LogFlightRecorder {
+public:
+  static constexpr size_t kHeaderSize = 64;
+  static constexpr size_t kDefaultCapacity = 4 * 1024 * 1024;  // 4MB
+  static constexpr size_t kMinCapacity = 4096;
+
+  LogFlightRecorder();
+  ~LogFlightRecorder();
+
+  LogFlightRecorder(const LogFlightRecorder&) = delete;
+  LogFlightRecorder& operator=(const LogFlightRecorder&) = delete;
+
+  // Create or reopen the ring file; capacity is rounded up to kMinCapacity
+  bool Open(const std::string& path, size_t capacity = kDefaultCapacity);
+  void Close();
+  bool IsOpen() const;
+
+  // Append one line (a newline is added). Lines longer than the ring keep their tail.
+  void Append(std::string_view line);
+
+  // Append pre-formatted text that already ends in newlines
+  void AppendRaw(std::string_view text);
+
+  // Ask the OS to write dirty pages back now (not needed for crash safety)
+  void Sync();
+
+  size_t GetCapacity() const;
+  uint64_t GetTotalWritten() const;
+  const std::string& GetPath() const { return path_; }
+
+  // Offline recovery: the most recent complete lines (at most max_bytes;
+  // 0 = everything in the ring). Returns false if the file is not a recorder.
+  static bool ReadFile(const std::string& path, std::string& out, size_t max_bytes = 0);
+
+private:
+  class MappedFile;  // Platform mapping (POSIX mmap / Win32 file mapping)
+
+  void SealTornWrite(uint64_t commit_pos, uint64_t reserve_pos);
+  void CopyIn(uint64_t pos, const char* data, size_t size);
+
+  std::unique_ptr<MappedFile> mapping_;
+  std::string path_;
+  char* ring_ = nullptr;
+  size_t capacity_ = 0;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_LOG_FLIGHT_RECORDER_H_
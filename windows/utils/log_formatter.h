@@ -0,0 +1,205 @@
+#ifndef ANYWP_ENGINE_LOG_FORMATTER_H_
+#define ANYWP_ENGINE_LOG_FORMATTER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "logger.h"
+
+namespace anywp_engine {
+
+/**
+ * LogFormatter - Allocation-free formatter for Logger lines
+ *
+ * Produces exactly the Logger format:
+ *   [YYYY-MM-DD HH:MM:SS.mmm] [LEVEL] [COMPONENT] message
+ *
+ * Features:
+ * - Writes into a reusable per-thread buffer (no heap allocation once the
+ *   buffer has grown to the longest line seen on that thread)
+ * - Caches the "YYYY-MM-DD HH:MM:SS" prefix per thread and only calls
+ *   localtime when the second changes; milliseconds are patched in
+ * - "[LEVEL] " prefixes are compile-time constants; "[Component] "
+ *   prefixes are interned per thread on first use
+ *
+ * The returned view stays valid until the next Format() on the same thread.
+ *
+ * Lines logged after the thread's buffers were destroyed (static destructors
+ * running at process exit, e.g. ~EventBus) fall back to a fixed-size buffer
+ * and are cut at kExitLineCapacity bytes.
+ *
+ * Thread-safe: Yes (all state is thread-local)
+ */
+class LogFormatter {
+public:
+  // Length of "YYYY-MM-DD HH:MM:SS.mmm"
+  static constexpr size_t kTimestampLength = 23;
+
+  // Maximum interned component prefixes per thread (further ones are
+  // formatted inline, which is still allocation-free)
+  static constexpr size_t kMaxInternedComponents = 256;
+
+  // Line length limit once the thread's buffers have been destroyed
+  static constexpr size_t kExitLineCapacity = 1024;
+
+  static std::string_view Format(Logger::Level level,
+                                 const std::string& component,
+                                 const std::string& message,
+                                 const std::chrono::system_clock::time_point& now) {
+    char timestamp[kTimestampLength];
+    FormatTimestamp(now, timestamp);
+
+    if (TornDown()) {
+      return FormatAtExit(level, component, message, timestamp);
+    }
+
+    ThreadState& state = State();
+    std::string& buffer = state.buffer;
+    buffer.clear();
+
+    buffer += '[';
+    buffer.append(timestamp, kTimestampLength);
+    buffer += "] ";
+    buffer += LevelPrefix(level);
+
+    const std::string* prefix = InternComponent(state, component);
+    if (prefix) {
+      buffer += *prefix;
+    } else {
+      buffer += '[';
+      buffer += component;
+      buffer += "] ";
+    }
+
+    buffer += message;
+    return buffer;
+  }
+
+  // Writes "YYYY-MM-DD HH:MM:SS.mmm" (kTimestampLength chars, no terminator)
+  static void FormatTimestamp(const std::chrono::system_clock::time_point& now, char* out) {
+    SecondCache& cache = TimestampCache();
+
+    std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+    if (seconds != cache.second) {
+      std::tm tm_now;
+#ifdef _WIN32
+      localtime_s(&tm_now, &seconds);
+#else
+      localtime_r(&seconds, &tm_now);
+#endif
+      WriteDigits(cache.text + 0, tm_now.tm_year + 1900, 4);
+      cache.text[4] = '-';
+      WriteDigits(cache.text + 5, tm_now.tm_mon + 1, 2);
+      cache.text[7] = '-';
+      WriteDigits(cache.text + 8, tm_now.tm_mday, 2);
+      cache.text[10] = ' ';
+      WriteDigits(cache.text + 11, tm_now.tm_hour, 2);
+      cache.text[13] = ':';
+      WriteDigits(cache.text + 14, tm_now.tm_min, 2);
+      cache.text[16] = ':';
+      WriteDigits(cache.text + 17, tm_now.tm_sec, 2);
+      cache.second = seconds;
+    }
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now.time_since_epoch()).count() % 1000;
+
+    for (size_t i = 0; i < 19; ++i) {
+      out[i] = cache.text[i];
+    }
+    out[19] = '.';
+    WriteDigits(out + 20, static_cast<int>(ms), 3);
+  }
+
+  // "[LEVEL] " including the trailing space
+  static std::string_view LevelPrefix(Logger::Level level) {
+    switch (level) {
+      case Logger::Level::DEBUG:   return "[DEBUG] ";
+      case Logger::Level::INFO:    return "[INFO] ";
+      case Logger::Level::WARNING: return "[WARNING] ";
+      case Logger::Level::ERROR:   return "[ERROR] ";
+      default:                     return "[UNKNOWN] ";
+    }
+  }
+
+private:
+  struct SecondCache {
+    std::time_t second = static_cast<std::time_t>(-1);
+    char text[19] = {};
+  };
+
+  struct ThreadState {
+    std::string buffer;
+    std::unordered_map<std::string, std::string> prefixes;
+
+    ThreadState() { buffer.reserve(512); }
+    ~ThreadState() { TornDown() = true; }
+  };
+
+  static ThreadState& State() {
+    thread_local ThreadState state;
+    return state;
+  }
+
+  // Trivially destructible, so it stays readable after ThreadState is gone
+  static bool& TornDown() {
+    thread_local bool torn_down = false;
+    return torn_down;
+  }
+
+  static std::string_view FormatAtExit(Logger::Level level,
+                                       const std::string& component,
+                                       const std::string& message,
+                                       const char* timestamp) {
+    thread_local char line[kExitLineCapacity];
+    size_t length = 0;
+    auto append = [&](std::string_view part) {
+      size_t n = part.size() < kExitLineCapacity - length ? part.size() : kExitLineCapacity - length;
+      part.copy(line + length, n);
+      length += n;
+    };
+    append("[");
+    append(std::string_view(timestamp, kTimestampLength));
+    append("] ");
+    append(LevelPrefix(level));
+    append("[");
+    append(component);
+    append("] ");
+    append(message);
+    return std::string_view(line, length);
+  }
+
+  static SecondCache& TimestampCache() {
+    thread_local SecondCache cache;
+    return cache;
+  }
+
+  // Returns the interned "[component] " or nullptr if the table is full
+  static const std::string* InternComponent(ThreadState& state, const std::string& component) {
+    auto& prefixes = state.prefixes;
+    auto it = prefixes.find(component);
+    if (it != prefixes.end()) {
+      return &it->second;
+    }
+    if (prefixes.size() >= kMaxInternedComponents) {
+      return nullptr;
+    }
+    auto inserted = prefixes.emplace(component, "[" + component + "] ");
+    return &inserted.first->second;
+  }
+
+  static void WriteDigits(char* out, int value, int width) {
+    for (int i = width - 1; i >= 0; --i) {
+      out[i] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    }
+  }
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_LOG_FORMATTER_H_
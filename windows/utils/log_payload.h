@@ -0,0 +1,95 @@
+#ifndef ANYWP_ENGINE_LOG_PAYLOAD_H_
+#define ANYWP_ENGINE_LOG_PAYLOAD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace anywp_engine {
+
+/**
+ * Bounded rendering of web-supplied payloads for log lines
+ *
+ * Message bodies and state values come from wallpaper content and can be
+ * megabytes long, contain newlines that forge log lines, or hold private data.
+ * Log lines therefore never carry them verbatim:
+ *
+ *   LogPayload(message)  ->  {"type":"saveState","key":"a... <18734 bytes, fnv1a=8c2f01d3>
+ *   LogDigest(value)     ->  <18734 bytes, fnv1a=8c2f01d3>
+ *
+ * LogPayload keeps a short preview (cut on a UTF-8 boundary, control
+ * characters escaped); LogDigest keeps no content at all. The fingerprint is
+ * enough to tell whether two lines refer to the same payload.
+ */
+
+constexpr size_t kLogPayloadPreview = 120;
+
+// FNV-1a, the same hash LogSiteId uses
+inline uint32_t LogPayloadHash(std::string_view payload) {
+  uint32_t hash = 2166136261u;
+  for (unsigned char c : payload) {
+    hash = (hash ^ c) * 16777619u;
+  }
+  return hash;
+}
+
+// "<N bytes, fnv1a=xxxxxxxx>"
+inline std::string LogDigest(std::string_view payload) {
+  static const char kHex[] = "0123456789abcdef";
+  uint32_t hash = LogPayloadHash(payload);
+  char hex[8];
+  for (int i = 7; i >= 0; i--) {
+    hex[i] = kHex[hash & 0xF];
+    hash >>= 4;
+  }
+
+  std::string digest;
+  digest.reserve(40);
+  digest += '<';
+  digest += std::to_string(payload.size());
+  digest += " bytes, fnv1a=";
+  digest.append(hex, sizeof(hex));
+  digest += '>';
+  return digest;
+}
+
+// Preview of at most `preview` bytes; longer payloads end in "... <digest>"
+inline std::string LogPayload(std::string_view payload, size_t preview = kLogPayloadPreview) {
+  size_t keep = payload.size();
+  bool truncated = keep > preview;
+  if (truncated) {
+    keep = preview;
+    // Never split a UTF-8 sequence: back up over continuation bytes
+    while (keep > 0 && (static_cast<unsigned char>(payload[keep]) & 0xC0) == 0x80) {
+      keep--;
+    }
+  }
+
+  std::string out;
+  out.reserve(keep + (truncated ? 44 : 0));
+  for (size_t i = 0; i < keep; i++) {
+    char c = payload[i];
+    if (c == '\n') {
+      out += "\\n";
+    } else if (c == '\r') {
+      out += "\\r";
+    } else if (c == '\t') {
+      out += "\\t";
+    } else if (static_cast<unsigned char>(c) < 0x20 || c == 0x7F) {
+      out += '?';
+    } else {
+      out += c;
+    }
+  }
+
+  if (truncated) {
+    out += "... ";
+    out += LogDigest(payload);
+  }
+  return out;
+}
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_LOG_PAYLOAD_H_
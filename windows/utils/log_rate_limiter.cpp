@@ -0,0 +1,309 @@
+#include "log_rate_limiter.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace anywp_engine {
+
+namespace {
+
+constexpr std::chrono::seconds kDefaultReportInterval(5);
+constexpr const char* kDefaultComponent = "*";
+
+bool ValidLevel(int level) {
+  return level >= 0 && level < LogRateLimiter::kLevelCount;
+}
+
+}  // namespace
+
+LogRateLimiter::LogRateLimiter()
+    : tracked_(0),
+      default_rules_(nullptr),
+      has_rules_(false),
+      has_pending_(false),
+      report_interval_ticks_(Clock::duration(kDefaultReportInterval).count()),
+      next_report_ticks_(0),
+      suppressed_total_(0) {
+  default_rules_.store(Retain(std::make_unique<RuleSet>()), std::memory_order_release);
+}
+
+LogRateLimiter::~LogRateLimiter() {
+  for (auto& slot : table_) {
+    delete slot.load(std::memory_order_relaxed);
+  }
+}
+
+// ========== Configuration ==========
+
+void LogRateLimiter::SetRateLimit(const std::string& component, int level,
+                                  double messages_per_second, size_t burst) {
+  if (!ValidLevel(level)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Rule rule = CurrentRule(component, level);
+  rule.rate = messages_per_second > 0.0 ? messages_per_second : 0.0;
+  rule.burst = static_cast<double>(std::max<size_t>(burst, 1));
+  Publish(component, level, rule);
+}
+
+void LogRateLimiter::SetSampling(const std::string& component, int level, uint32_t keep_one_in) {
+  if (!ValidLevel(level)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Rule rule = CurrentRule(component, level);
+  rule.sample = std::max<uint32_t>(keep_one_in, 1);
+  Publish(component, level, rule);
+}
+
+void LogRateLimiter::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  default_rules_.store(Retain(std::make_unique<RuleSet>()), std::memory_order_release);
+  for (auto& slot : table_) {
+    ComponentState* entry = slot.load(std::memory_order_acquire);
+    if (!entry) {
+      continue;
+    }
+    entry->rules.store(nullptr, std::memory_order_release);
+    for (LevelState& state : entry->levels) {
+      state.suppressed.store(0, std::memory_order_relaxed);
+    }
+  }
+  has_pending_.store(false, std::memory_order_relaxed);
+  UpdateHasRules();
+}
+
+void LogRateLimiter::SetReportInterval(Clock::duration interval) {
+  report_interval_ticks_.store(interval.count(), std::memory_order_relaxed);
+}
+
+// ========== Hot Path ==========
+
+bool LogRateLimiter::Admit(int level, std::string_view component, Clock::time_point now) {
+  if (!HasRules() || !ValidLevel(level)) {
+    return true;
+  }
+
+  const Rule& fallback = default_rules_.load(std::memory_order_acquire)->levels[level];
+  ComponentState* entry = Find(component);
+  if (!entry) {
+    // Untracked component: only the "*" rule can apply
+    if (!fallback.IsActive()) {
+      return true;
+    }
+    entry = Track(component, false);
+    if (!entry) {
+      return true;
+    }
+  }
+
+  const RuleSet* own = entry->rules.load(std::memory_order_acquire);
+  const Rule& rule = own && own->levels[level].set ? own->levels[level] : fallback;
+  if (!rule.IsActive()) {
+    return true;
+  }
+
+  // First line under a new rule: start with a full bucket
+  LevelState& state = entry->levels[level];
+  uint64_t version = state.version.load(std::memory_order_relaxed);
+  if (version != rule.version &&
+      state.version.compare_exchange_strong(version, rule.version, std::memory_order_relaxed)) {
+    state.full_at.store(0, std::memory_order_relaxed);
+    state.sample_counter.store(0, std::memory_order_relaxed);
+  }
+
+  bool admitted = true;
+  if (rule.sample > 1 &&
+      (state.sample_counter.fetch_add(1, std::memory_order_relaxed) % rule.sample) != 0) {
+    admitted = false;
+  }
+
+  int64_t ticks = now.time_since_epoch().count();
+  if (admitted && rule.rate > 0.0) {
+    admitted = TakeToken(state, rule, ticks);
+  }
+
+  if (!admitted) {
+    // First suppression after a quiet period: report one interval from now
+    if (!has_pending_.load(std::memory_order_relaxed) &&
+        !has_pending_.exchange(true, std::memory_order_relaxed) &&
+        ticks >= next_report_ticks_.load(std::memory_order_relaxed)) {
+      next_report_ticks_.store(ticks + report_interval_ticks_.load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+    }
+    state.suppressed.fetch_add(1, std::memory_order_relaxed);
+    suppressed_total_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return admitted;
+}
+
+bool LogRateLimiter::ReportDue(Clock::time_point now) const {
+  return has_pending_.load(std::memory_order_relaxed) &&
+         now.time_since_epoch().count() >= next_report_ticks_.load(std::memory_order_relaxed);
+}
+
+std::vector<LogRateLimiter::Suppression> LogRateLimiter::TakeSuppressions(Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Clear the flag first: a line suppressed during the scan sets it again
+  has_pending_.store(false, std::memory_order_relaxed);
+
+  std::vector<Suppression> result;
+  for (auto& slot : table_) {
+    ComponentState* entry = slot.load(std::memory_order_acquire);
+    if (!entry) {
+      continue;
+    }
+    for (int level = 0; level < kLevelCount; level++) {
+      uint64_t count = entry->levels[level].suppressed.exchange(0, std::memory_order_relaxed);
+      if (count > 0) {
+        result.push_back({entry->name, level, count});
+      }
+    }
+  }
+
+  // Stable output order for the summary lines
+  std::sort(result.begin(), result.end(), [](const Suppression& a, const Suppression& b) {
+    return a.component != b.component ? a.component < b.component : a.level < b.level;
+  });
+
+  next_report_ticks_.store(now.time_since_epoch().count() +
+                               report_interval_ticks_.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+  return result;
+}
+
+// ========== Internal Helpers ==========
+
+LogRateLimiter::ComponentState* LogRateLimiter::Find(std::string_view component) const {
+  size_t index = std::hash<std::string_view>()(component);
+  for (size_t probe = 0; probe < kTableSize; probe++, index++) {
+    ComponentState* entry = table_[index % kTableSize].load(std::memory_order_acquire);
+    if (!entry) {
+      return nullptr;
+    }
+    if (entry->name == component) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+LogRateLimiter::ComponentState* LogRateLimiter::Track(std::string_view component, bool configured) {
+  std::unique_ptr<ComponentState> created;
+  size_t index = std::hash<std::string_view>()(component);
+  for (size_t probe = 0; probe < kTableSize; probe++, index++) {
+    std::atomic<ComponentState*>& slot = table_[index % kTableSize];
+    ComponentState* entry = slot.load(std::memory_order_acquire);
+    if (!entry) {
+      if (!created) {
+        if (!configured && tracked_.load(std::memory_order_relaxed) >= kMaxTrackedComponents) {
+          return nullptr;
+        }
+        created = std::make_unique<ComponentState>(component);
+      }
+      if (slot.compare_exchange_strong(entry, created.get(), std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+        tracked_.fetch_add(1, std::memory_order_relaxed);
+        return created.release();
+      }
+      // Another thread filled the slot first; `entry` is its component
+    }
+    if (entry->name == component) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+LogRateLimiter::Rule LogRateLimiter::CurrentRule(const std::string& component, int level) const {
+  const RuleSet* defaults = default_rules_.load(std::memory_order_relaxed);
+  if (component == kDefaultComponent) {
+    return defaults->levels[level];
+  }
+  ComponentState* entry = Find(component);
+  const RuleSet* own = entry ? entry->rules.load(std::memory_order_relaxed) : nullptr;
+  Rule rule = own && own->levels[level].set ? own->levels[level] : defaults->levels[level];
+  rule.set = true;
+  return rule;
+}
+
+void LogRateLimiter::Publish(const std::string& component, int level, Rule rule) {
+  bool is_default = component == kDefaultComponent;
+  ComponentState* entry = is_default ? nullptr : Track(component, true);
+  if (!is_default && !entry) {
+    return;  // Table full
+  }
+  const RuleSet* current = is_default ? default_rules_.load(std::memory_order_relaxed)
+                                      : entry->rules.load(std::memory_order_relaxed);
+
+  const Rule* old = current ? &current->levels[level] : nullptr;
+  if (old && old->set == rule.set && old->rate == rule.rate && old->burst == rule.burst &&
+      old->sample == rule.sample) {
+    return;  // Unchanged: keep the bucket
+  }
+
+  if (rule.rate > 0.0) {
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / rule.rate));
+    rule.interval = std::max<int64_t>(interval.count(), 1);
+    double tolerance = (rule.burst - 1.0) * static_cast<double>(rule.interval);
+    rule.tolerance = static_cast<int64_t>(std::min(tolerance, 4.0e18));
+  }
+  rule.version = next_version_++;
+
+  auto rules = current ? std::make_unique<RuleSet>(*current) : std::make_unique<RuleSet>();
+  rules->levels[level] = rule;
+  if (is_default) {
+    default_rules_.store(Retain(std::move(rules)), std::memory_order_release);
+  } else {
+    entry->rules.store(Retain(std::move(rules)), std::memory_order_release);
+  }
+  UpdateHasRules();
+}
+
+const LogRateLimiter::RuleSet* LogRateLimiter::Retain(std::unique_ptr<RuleSet> rules) {
+  rule_sets_.push_back(std::move(rules));
+  return rule_sets_.back().get();
+}
+
+bool LogRateLimiter::TakeToken(LevelState& state, const Rule& rule, int64_t now) {
+  // GCRA: taking a token moves the full-again time one interval later; the
+  // bucket is empty once that time is more than (burst - 1) intervals away
+  int64_t full_at = state.full_at.load(std::memory_order_relaxed);
+  for (;;) {
+    int64_t from = std::max(full_at, now);
+    if (from - now > rule.tolerance) {
+      return false;
+    }
+    if (state.full_at.compare_exchange_weak(full_at, from + rule.interval,
+                                            std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+}
+
+void LogRateLimiter::UpdateHasRules() {
+  bool any = false;
+  for (const Rule& rule : default_rules_.load(std::memory_order_relaxed)->levels) {
+    any = any || rule.IsActive();
+  }
+  for (const auto& slot : table_) {
+    ComponentState* entry = slot.load(std::memory_order_acquire);
+    const RuleSet* own = entry ? entry->rules.load(std::memory_order_relaxed) : nullptr;
+    if (!own) {
+      continue;
+    }
+    for (const Rule& rule : own->levels) {
+      any = any || (rule.set && rule.IsActive());
+    }
+  }
+  has_rules_.store(any, std::memory_order_relaxed);
+}
+
+}  // namespace anywp_engine
@@ -0,0 +1,154 @@
+#ifndef ANYWP_ENGINE_LOG_RATE_LIMITER_H_
+#define ANYWP_ENGINE_LOG_RATE_LIMITER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace anywp_engine {
+
+/**
+ * LogRateLimiter - Per-component, per-level token bucket and sampler
+ *
+ * Features:
+ * - Token bucket: at most `burst` lines at once, refilled at
+ *   `messages_per_second`
+ * - Sampling: keep one line in N (applied before the bucket)
+ * - Component "*" is the default for components without their own rule
+ * - Counts suppressed lines per component/level so the logger can emit a
+ *   periodic "Suppressed N messages from X" summary
+ *
+ * Admit() takes no lock. Components live in a fixed open-addressing table
+ * of atomic pointers, found with one hash and a string compare; rules are
+ * immutable RuleSets published by pointer (one for "*", one per configured
+ * component); each bucket is a single atomic (GCRA: the time the bucket is
+ * full again) updated with one CAS. mutex_ only serializes configuration
+ * and suppression reports.
+ *
+ * Nothing a reader may hold is freed before the limiter is destroyed:
+ * components stay in the table after Clear() (so kMaxTrackedComponents
+ * counts every component ever tracked), and every published RuleSet is
+ * kept. Setting a rule to its current value publishes nothing.
+ *
+ * Levels are the integer values of Logger::Level (this header is included
+ * by logger.h).
+ *
+ * Thread-safe: Yes
+ */
+class LogRateLimiter {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr int kLevelCount = 4;
+
+  // Components tracked through the "*" rule (further ones are admitted)
+  static constexpr size_t kMaxTrackedComponents = 1024;
+
+  struct Suppression {
+    std::string component;
+    int level;
+    uint64_t count;
+  };
+
+  LogRateLimiter();
+  ~LogRateLimiter();
+
+  LogRateLimiter(const LogRateLimiter&) = delete;
+  LogRateLimiter& operator=(const LogRateLimiter&) = delete;
+
+  // messages_per_second <= 0 removes the rate limit for this component/level
+  void SetRateLimit(const std::string& component, int level,
+                    double messages_per_second, size_t burst);
+
+  // keep_one_in <= 1 disables sampling for this component/level
+  void SetSampling(const std::string& component, int level, uint32_t keep_one_in);
+
+  // Remove every rule and pending suppression count
+  void Clear();
+
+  // Minimum time between two suppression summaries
+  void SetReportInterval(Clock::duration interval);
+
+  bool HasRules() const { return has_rules_.load(std::memory_order_relaxed); }
+
+  // Returns false if the line must be suppressed (and counts it)
+  bool Admit(int level, std::string_view component, Clock::time_point now);
+
+  // True when lines were suppressed and the report interval has elapsed
+  bool ReportDue(Clock::time_point now) const;
+
+  // Collect and reset the pending suppression counts
+  std::vector<Suppression> TakeSuppressions(Clock::time_point now);
+
+  uint64_t GetSuppressedTotal() const {
+    return suppressed_total_.load(std::memory_order_relaxed);
+  }
+
+private:
+  // Configured components fit beside the ones tracked through "*"
+  static constexpr size_t kTableSize = 2 * kMaxTrackedComponents;
+
+  struct Rule {
+    double rate = 0.0;        // Tokens per second (0 = unlimited)
+    double burst = 0.0;       // Bucket capacity
+    uint32_t sample = 1;      // Keep one in N (1 = keep all)
+    int64_t interval = 0;     // Clock ticks per token
+    int64_t tolerance = 0;    // (burst - 1) * interval
+    uint64_t version = 0;     // New for every published change; 0 = never set
+    bool set = false;         // Component rules: false inherits the "*" rule
+
+    bool IsActive() const { return rate > 0.0 || sample > 1; }
+  };
+
+  struct RuleSet {
+    std::array<Rule, kLevelCount> levels;
+  };
+
+  struct LevelState {
+    std::atomic<uint64_t> version{0};  // Rule the bucket was last filled for
+    std::atomic<int64_t> full_at{0};   // Clock ticks at which the bucket is full
+    std::atomic<uint64_t> sample_counter{0};
+    std::atomic<uint64_t> suppressed{0};  // Since the last report
+  };
+
+  struct ComponentState {
+    explicit ComponentState(std::string_view component) : name(component) {}
+
+    const std::string name;
+    std::atomic<const RuleSet*> rules{nullptr};  // Own rules; null: all from "*"
+    std::array<LevelState, kLevelCount> levels;
+  };
+
+  ComponentState* Find(std::string_view component) const;
+  // Null if the table (or, unless `configured`, the tracking cap) is full
+  ComponentState* Track(std::string_view component, bool configured);
+  Rule CurrentRule(const std::string& component, int level) const;  // Requires mutex_
+  void Publish(const std::string& component, int level, Rule rule);  // Requires mutex_
+  const RuleSet* Retain(std::unique_ptr<RuleSet> rules);  // Requires mutex_
+  void UpdateHasRules();  // Requires mutex_
+
+  static bool TakeToken(LevelState& state, const Rule& rule, int64_t now);
+
+  std::array<std::atomic<ComponentState*>, kTableSize> table_{};
+  std::atomic<size_t> tracked_;
+  std::atomic<const RuleSet*> default_rules_;
+  std::vector<std::unique_ptr<RuleSet>> rule_sets_;  // Every RuleSet ever published
+  uint64_t next_version_ = 1;
+
+  std::atomic<bool> has_rules_;
+  std::atomic<bool> has_pending_;
+  std::atomic<int64_t> report_interval_ticks_;
+  std::atomic<int64_t> next_report_ticks_;
+  std::atomic<uint64_t> suppressed_total_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_LOG_RATE_LIMITER_H_
@@ -0,0 +1,181 @@
+#ifndef ANYWP_ENGINE_LOG_RING_BUFFER_H_
+#define ANYWP_ENGINE_LOG_RING_BUFFER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace anywp_engine {
+
+/**
+ * @brief Single log record carried from producer threads to the log writer
+ *
+ * Strings are reserved once when the ring is created so that assigning a
+ * typical component/message pair reuses the slot's capacity instead of
+ * allocating on the producer thread.
+ */
+struct LogRecord {
+  int level = 0;
+  std::chrono::system_clock::time_point timestamp;
+  std::string component;
+  std::string message;
+};
+
+/**
+ * @brief LogRingBuffer - Bounded lock-free multi-producer queue of log records
+ *
+ * Features:
+ * - Fixed capacity (rounded up to a power of two), allocated once
+ * - Lock-free push/pop (sequence-numbered slots, one CAS per operation)
+ * - Pre-sized record slots (no heap allocation for messages that fit)
+ * - Safe for multiple consumers, which lets producers discard the oldest
+ *   record themselves when the ring is full (drop-oldest policy)
+ *
+ * Usage:
+ *   LogRingBuffer ring(4096);
+ *   ring.TryPush(level, now, "Plugin", "Started");   // producer threads
+ *   LogRecord record;
+ *   while (ring.TryPop(record)) { ... }              // writer thread
+ *
+ * Thread-safe: Yes (lock-free)
+ */
+class LogRingBuffer {
+public:
+  // Reserved capacity of each slot's strings
+  static constexpr size_t kComponentReserve = 32;
+  static constexpr size_t kMessageReserve = 224;
+
+  explicit LogRingBuffer(size_t capacity)
+      : capacity_(RoundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)),
+        mask_(capacity_ - 1),
+        slots_(new Slot[capacity_]),
+        enqueue_pos_(0),
+        dequeue_pos_(0) {
+    for (size_t i = 0; i < capacity_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+      slots_[i].record.component.reserve(kComponentReserve);
+      slots_[i].record.message.reserve(kMessageReserve);
+    }
+  }
+
+  LogRingBuffer(const LogRingBuffer&) = delete;
+  LogRingBuffer& operator=(const LogRingBuffer&) = delete;
+
+  /**
+   * Push a record (copied into a pre-sized slot)
+   *
+   * @return false if the ring is full
+   */
+  bool TryPush(int level,
+               std::chrono::system_clock::time_point timestamp,
+               const std::string& component,
+               const std::string& message) {
+    Slot* slot = nullptr;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      slot = &slots_[pos & mask_];
+      size_t seq = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->record.level = level;
+    slot->record.timestamp = timestamp;
+    slot->record.component.assign(component);
+    slot->record.message.assign(message);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Pop the oldest record into out (copied, so out keeps its own capacity)
+   *
+   * @return false if the ring is empty
+   */
+  bool TryPop(LogRecord& out) {
+    return PopInternal(&out);
+  }
+
+  /**
+   * Discard the oldest record (used by producers for drop-oldest overflow)
+   *
+   * @return false if the ring is empty
+   */
+  bool DiscardOldest() {
+    return PopInternal(nullptr);
+  }
+
+  // Approximate number of queued records (exact when quiescent)
+  size_t SizeApprox() const {
+    size_t head = dequeue_pos_.load(std::memory_order_acquire);
+    size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+    return tail >= head ? tail - head : 0;
+  }
+
+  size_t Capacity() const { return capacity_; }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    LogRecord record;
+  };
+
+  static size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  bool PopInternal(LogRecord* out) {
+    Slot* slot = nullptr;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      slot = &slots_[pos & mask_];
+      size_t seq = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    if (out) {
+      out->level = slot->record.level;
+      out->timestamp = slot->record.timestamp;
+      out->component.assign(slot->record.component);
+      out->message.assign(slot->record.message);
+    }
+    slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+
+  // Producer and consumer cursors live on separate cache lines
+  alignas(64) std::atomic<size_t> enqueue_pos_;
+  alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_LOG_RING_BUFFER_H_
@@ -0,0 +1,422 @@
+#include "log_rotator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace anywp_engine {
+
+namespace {
+
+// ========== gzip / deflate encoder ==========
+// LZ77 with hash chains + the fixed Huffman code (RFC 1951 section 3.2.6).
+// Log text compresses several-fold without a dynamic-table encoder, and the
+// output is readable by any gzip tool.
+
+constexpr size_t kWindowSize = 32768;
+constexpr size_t kMinMatch = 3;
+constexpr size_t kMaxMatch = 258;
+constexpr size_t kHashBits = 15;
+constexpr size_t kMaxChain = 32;
+
+constexpr uint16_t kLengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+constexpr uint8_t kLengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+constexpr uint16_t kDistanceBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+constexpr uint8_t kDistanceExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+class BitWriter {
+public:
+  explicit BitWriter(std::string& out) : out_(out) {}
+
+  // Extra bits and header fields: least significant bit first
+  void PutBits(uint32_t value, int count) {
+    bits_ |= static_cast<uint64_t>(value) << bit_count_;
+    bit_count_ += count;
+    while (bit_count_ >= 8) {
+      out_.push_back(static_cast<char>(bits_ & 0xFF));
+      bits_ >>= 8;
+      bit_count_ -= 8;
+    }
+  }
+
+  // Huffman codes: most significant bit first
+  void PutCode(uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) {
+      reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    PutBits(reversed, length);
+  }
+
+  void Finish() {
+    if (bit_count_ > 0) {
+      out_.push_back(static_cast<char>(bits_ & 0xFF));
+    }
+    bits_ = 0;
+    bit_count_ = 0;
+  }
+
+private:
+  std::string& out_;
+  uint64_t bits_ = 0;
+  int bit_count_ = 0;
+};
+
+void PutLiteralLength(BitWriter& writer, uint32_t symbol) {
+  if (symbol <= 143) {
+    writer.PutCode(0x30 + symbol, 8);
+  } else if (symbol <= 255) {
+    writer.PutCode(0x190 + (symbol - 144), 9);
+  } else if (symbol <= 279) {
+    writer.PutCode(symbol - 256, 7);
+  } else {
+    writer.PutCode(0xC0 + (symbol - 280), 8);
+  }
+}
+
+template <size_t N, typename T>
+size_t FindBase(const T (&bases)[N], uint32_t value) {
+  size_t index = 0;
+  while (index + 1 < N && bases[index + 1] <= value) {
+    index++;
+  }
+  return index;
+}
+
+void PutMatch(BitWriter& writer, uint32_t length, uint32_t distance) {
+  size_t length_index = FindBase(kLengthBase, length);
+  PutLiteralLength(writer, static_cast<uint32_t>(257 + length_index));
+  writer.PutBits(length - kLengthBase[length_index], kLengthExtra[length_index]);
+
+  size_t distance_index = FindBase(kDistanceBase, distance);
+  writer.PutCode(static_cast<uint32_t>(distance_index), 5);
+  writer.PutBits(distance - kDistanceBase[distance_index], kDistanceExtra[distance_index]);
+}
+
+uint32_t Hash3(const uint8_t* p) {
+  uint32_t value = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+  return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+void Deflate(const std::string& input, std::string& out) {
+  BitWriter writer(out);
+  writer.PutBits(1, 1);  // BFINAL
+  writer.PutBits(1, 2);  // BTYPE = fixed Huffman
+
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(input.data());
+  const size_t size = input.size();
+  std::vector<int32_t> head(size_t(1) << kHashBits, -1);
+  std::vector<int32_t> prev(kWindowSize, -1);
+
+  auto insert = [&](size_t pos) {
+    if (pos + kMinMatch <= size) {
+      uint32_t h = Hash3(data + pos);
+      prev[pos % kWindowSize] = head[h];
+      head[h] = static_cast<int32_t>(pos);
+    }
+  };
+
+  size_t pos = 0;
+  while (pos < size) {
+    size_t best_length = 0;
+    size_t best_distance = 0;
+
+    if (pos + kMinMatch <= size) {
+      size_t max_length = std::min(kMaxMatch, size - pos);
+      int32_t candidate = head[Hash3(data + pos)];
+      for (size_t chain = 0; candidate >= 0 && chain < kMaxChain; chain++) {
+        size_t distance = pos - static_cast<size_t>(candidate);
+        if (distance == 0 || distance > kWindowSize) {
+          break;
+        }
+        size_t length = 0;
+        while (length < max_length && data[candidate + length] == data[pos + length]) {
+          length++;
+        }
+        if (length > best_length) {
+          best_length = length;
+          best_distance = distance;
+          if (length == max_length) {
+            break;
+          }
+        }
+        int32_t next = prev[static_cast<size_t>(candidate) % kWindowSize];
+        if (next >= candidate) {
+          break;  // Slot reused by a newer position
+        }
+        candidate = next;
+      }
+    }
+
+    if (best_length >= kMinMatch) {
+      PutMatch(writer, static_cast<uint32_t>(best_length), static_cast<uint32_t>(best_distance));
+      for (size_t i = 0; i < best_length; i++) {
+        insert(pos + i);
+      }
+      pos += best_length;
+    } else {
+      PutLiteralLength(writer, data[pos]);
+      insert(pos);
+      pos++;
+    }
+  }
+
+  PutLiteralLength(writer, 256);  // End of block
+  writer.Finish();
+}
+
+uint32_t Crc32(const std::string& data) {
+  static const auto table = [] {
+    std::vector<uint32_t> t(256);
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (unsigned char byte : data) {
+    crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+void PutLE32(std::string& out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+// Archive suffix after "<filename>." : digits, optionally followed by ".gz"
+bool ParseArchiveId(const std::string& suffix, uint64_t& id) {
+  std::string digits = suffix;
+  if (digits.size() > 3 && digits.compare(digits.size() - 3, 3, ".gz") == 0) {
+    digits.resize(digits.size() - 3);
+  }
+  if (digits.empty() || digits.size() > 19 ||
+      !std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+    return false;
+  }
+  id = std::stoull(digits);
+  return true;
+}
+
+}  // namespace
+
+// ========== Lifecycle ==========
+
+LogRotator::LogRotator() : rotations_(0) {}
+
+LogRotator::~LogRotator() {
+  Stop();
+}
+
+void LogRotator::SetPolicy(const Policy& policy) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  policy_ = policy;
+}
+
+LogRotator::Policy LogRotator::GetPolicy() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return policy_;
+}
+
+void LogRotator::Rotate(std::ofstream&& full_file, const std::string& path, InstallCallback install) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  jobs_.push_back(Job{std::move(full_file), path, std::move(install)});
+  if (!worker_.joinable()) {
+    stop_ = false;
+    worker_ = std::thread(&LogRotator::WorkerLoop, this);
+  }
+  work_cv_.notify_one();
+}
+
+void LogRotator::WaitIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this] { return jobs_.empty() && !busy_; });
+}
+
+void LogRotator::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+// ========== Worker ==========
+
+void LogRotator::WorkerLoop() {
+  // Compression is background work: never compete with logging threads
+#ifdef _WIN32
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+  setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+    if (jobs_.empty()) {
+      break;  // Stopped with nothing left to do
+    }
+
+    Job job = std::move(jobs_.front());
+    jobs_.pop_front();
+    busy_ = true;
+    lock.unlock();
+
+    RunJob(job);
+
+    lock.lock();
+    busy_ = false;
+    idle_cv_.notify_all();
+  }
+}
+
+void LogRotator::RunJob(Job& job) {
+  Policy policy = GetPolicy();
+
+  // 1. Close and archive the full file (the slow part, off the logging thread)
+  job.file.close();
+  std::string archive = job.path + "." +
+      std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+  bool archived = std::rename(job.path.c_str(), archive.c_str()) == 0;
+
+  // 2. Open the fresh file and hand it to the logger
+  std::ofstream fresh(job.path, std::ios::app | std::ios::binary);
+  if (fresh.is_open()) {
+    unsigned char bom[] = {0xEF, 0xBB, 0xBF};
+    fresh.write(reinterpret_cast<const char*>(bom), 3);
+    fresh.flush();
+  }
+  job.install(std::move(fresh));
+  rotations_.fetch_add(1, std::memory_order_relaxed);
+
+  if (!archived) {
+    std::cout << "[AnyWP] [Logger] WARNING: Failed to archive log file: " << job.path << std::endl;
+    return;
+  }
+
+  // 3. Compress (write to a temp name first so a crash never leaves a torn .gz)
+  if (policy.compress) {
+    std::string compressed = archive + ".gz";
+    std::string temp = compressed + ".tmp";
+    if (CompressFile(archive, temp) && std::rename(temp.c_str(), compressed.c_str()) == 0) {
+      std::remove(archive.c_str());
+    } else {
+      std::remove(temp.c_str());
+    }
+  }
+
+  // 4. Retention
+  EnforceRetention(job.path, policy);
+}
+
+// ========== Archives ==========
+
+std::vector<std::string> LogRotator::ListArchives(const std::string& path) {
+  namespace fs = std::filesystem;
+
+  fs::path base(path);
+  fs::path directory = base.has_parent_path() ? base.parent_path() : fs::path(".");
+  std::string prefix = base.filename().string() + ".";
+
+  std::vector<std::pair<uint64_t, std::string>> found;
+  std::error_code ec;
+  for (const auto& entry : fs::directory_iterator(directory, ec)) {
+    std::string name = entry.path().filename().string();
+    uint64_t id = 0;
+    if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+        ParseArchiveId(name.substr(prefix.size()), id)) {
+      found.emplace_back(id, entry.path().string());
+    }
+  }
+
+  std::sort(found.begin(), found.end());
+  std::vector<std::string> archives;
+  for (auto& item : found) {
+    archives.push_back(std::move(item.second));
+  }
+  return archives;
+}
+
+void LogRotator::EnforceRetention(const std::string& path, const Policy& policy) {
+  namespace fs = std::filesystem;
+
+  std::vector<std::string> archives = ListArchives(path);
+  std::vector<uint64_t> sizes;
+  uint64_t total = 0;
+  for (const auto& archive : archives) {
+    std::error_code ec;
+    uint64_t size = fs::file_size(archive, ec);
+    sizes.push_back(ec ? 0 : size);
+    total += sizes.back();
+  }
+
+  // Oldest first; always keep the newest archive
+  size_t remaining = archives.size();
+  for (size_t i = 0; i + 1 < archives.size(); i++) {
+    bool over_count = policy.max_archives > 0 && remaining > policy.max_archives;
+    bool over_bytes = policy.max_total_bytes > 0 && total > policy.max_total_bytes;
+    if (!over_count && !over_bytes) {
+      break;
+    }
+    std::error_code ec;
+    fs::remove(archives[i], ec);
+    total -= sizes[i];
+    remaining--;
+  }
+}
+
+bool LogRotator::CompressFile(const std::string& source, const std::string& destination) {
+  std::ifstream in(source, std::ios::binary);
+  if (!in.is_open()) {
+    return false;
+  }
+  std::string input((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  std::string out;
+  out.reserve(input.size() / 2 + 64);
+  const unsigned char header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 255};
+  out.append(reinterpret_cast<const char*>(header), sizeof(header));
+  Deflate(input, out);
+  PutLE32(out, Crc32(input));
+  PutLE32(out, static_cast<uint32_t>(input.size()));
+
+  std::ofstream file(destination, std::ios::binary | std::ios::trunc);
+  file.write(out.data(), static_cast<std::streamsize>(out.size()));
+  return static_cast<bool>(file);
+}
+
+}  // namespace anywp_engine
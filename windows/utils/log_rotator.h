@@ -0,0 +1,93 @@
+#ifndef ANYWP_ENGINE_LOG_ROTATOR_H_
+#define ANYWP_ENGINE_LOG_ROTATOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace anywp_engine {
+
+/**
+ * LogRotator - Background log file rotation
+ *
+ * The thread that crosses the size threshold only moves its open stream into
+ * a job and keeps logging; lines written meanwhile are held in memory by the
+ * Logger. A worker thread then:
+ *   1. closes the full file and renames it to "<path>.<timestamp>"
+ *   2. opens a fresh file (with UTF-8 BOM) and hands it back via `install`
+ *   3. gzip-compresses the archive to "<path>.<timestamp>.gz"
+ *   4. deletes the oldest archives beyond the count / total-bytes limits
+ *
+ * Thread-safe: Yes
+ */
+class LogRotator {
+public:
+  struct Policy {
+    size_t max_archives = 5;                       // Rotated files kept (0 = unlimited)
+    uint64_t max_total_bytes = 50 * 1024 * 1024;   // Bytes of archives kept (0 = unlimited)
+    bool compress = true;                          // gzip rotated files
+  };
+
+  // Receives the freshly opened file (not open if reopening failed)
+  using InstallCallback = std::function<void(std::ofstream&& fresh_file)>;
+
+  LogRotator();
+  ~LogRotator();
+
+  LogRotator(const LogRotator&) = delete;
+  LogRotator& operator=(const LogRotator&) = delete;
+
+  void SetPolicy(const Policy& policy);
+  Policy GetPolicy() const;
+
+  // Hand off a full log file; returns immediately
+  void Rotate(std::ofstream&& full_file, const std::string& path, InstallCallback install);
+
+  // Block until every submitted rotation (including compression) is done
+  void WaitIdle();
+
+  // Finish pending work and stop the worker thread
+  void Stop();
+
+  size_t GetRotationCount() const { return rotations_.load(std::memory_order_relaxed); }
+
+  // Archives of `path` ("<path>.<timestamp>[.gz]"), oldest first
+  static std::vector<std::string> ListArchives(const std::string& path);
+
+  // Delete the oldest archives of `path` until the policy limits hold
+  static void EnforceRetention(const std::string& path, const Policy& policy);
+
+  // gzip (RFC 1952) `source` into `destination`
+  static bool CompressFile(const std::string& source, const std::string& destination);
+
+private:
+  struct Job {
+    std::ofstream file;
+    std::string path;
+    InstallCallback install;
+  };
+
+  void WorkerLoop();
+  void RunJob(Job& job);
+
+  std::deque<Job> jobs_;
+  Policy policy_;
+  bool busy_ = false;
+  bool stop_ = false;
+  std::thread worker_;
+  std::atomic<size_t> rotations_;
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_LOG_ROTATOR_H_
@@ -0,0 +1,113 @@
+#include "log_site.h"
+
+#include <algorithm>
+
+namespace anywp_engine {
+
+// ========== LogSite ==========
+
+bool LogSite::Resolve() {
+  return LogSiteRegistry::Instance().Register(this);
+}
+
+// ========== LogSiteRegistry ==========
+
+LogSiteRegistry& LogSiteRegistry::Instance() {
+  static LogSiteRegistry instance;
+  return instance;
+}
+
+bool LogSiteRegistry::Register(LogSite* site) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  
+  // Another thread may have registered this site while we waited
+  if (site->state_.load(std::memory_order_relaxed) == LogSite::UNRESOLVED) {
+    site->next_ = head_;
+    head_ = site;
+    site_count_++;
+  }
+  
+  bool enabled = ComputeEnabled(*site);
+  site->state_.store(enabled ? LogSite::ENABLED : LogSite::DISABLED, std::memory_order_relaxed);
+  return enabled;
+}
+
+bool LogSiteRegistry::ComputeEnabled(const LogSite& site) const {
+  bool enabled = site.level_ >= Logger::Instance().GetMinLevel();
+  
+  // File rules first, then per-site rules, so an ID override always wins
+  for (const auto& rule : rules_) {
+    if (!rule.by_id && std::string(site.file_).find(rule.file_pattern) != std::string::npos) {
+      enabled = rule.enabled;
+    }
+  }
+  for (const auto& rule : rules_) {
+    if (rule.by_id && rule.id == site.id_) {
+      enabled = rule.enabled;
+    }
+  }
+  
+  return enabled;
+}
+
+void LogSiteRegistry::SetSiteEnabled(uint32_t id, bool enabled) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rules_.erase(std::remove_if(rules_.begin(), rules_.end(),
+      [id](const Rule& r) { return r.by_id && r.id == id; }), rules_.end());
+    rules_.push_back({true, id, std::string(), enabled});
+  }
+  Refresh();
+}
+
+void LogSiteRegistry::SetFileEnabled(const std::string& file_pattern, bool enabled) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rules_.erase(std::remove_if(rules_.begin(), rules_.end(),
+      [&file_pattern](const Rule& r) { return !r.by_id && r.file_pattern == file_pattern; }), rules_.end());
+    rules_.push_back({false, 0, file_pattern, enabled});
+  }
+  Refresh();
+}
+
+void LogSiteRegistry::ClearOverrides() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rules_.clear();
+  }
+  Refresh();
+}
+
+void LogSiteRegistry::Refresh() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  
+  for (LogSite* site = head_; site != nullptr; site = site->next_) {
+    bool enabled = ComputeEnabled(*site);
+    site->state_.store(enabled ? LogSite::ENABLED : LogSite::DISABLED, std::memory_order_relaxed);
+  }
+}
+
+std::vector<LogSiteRegistry::SiteInfo> LogSiteRegistry::GetSites() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  
+  std::vector<SiteInfo> sites;
+  sites.reserve(site_count_);
+  for (const LogSite* site = head_; site != nullptr; site = site->next_) {
+    SiteInfo info;
+    info.id = site->id_;
+    info.file = site->file_;
+    info.line = site->line_;
+    info.level = site->level_;
+    info.enabled = site->state_.load(std::memory_order_relaxed) == LogSite::ENABLED;
+    sites.push_back(info);
+  }
+  
+  return sites;
+}
+
+size_t LogSiteRegistry::GetSiteCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return site_count_;
+}
+
+}  // namespace anywp_engine
@@ -0,0 +1,205 @@
+#ifndef ANYWP_ENGINE_LOG_SITE_H_
+#define ANYWP_ENGINE_LOG_SITE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+
+namespace anywp_engine {
+
+// Level constants for macro expansions: call sites may include <windows.h>
+// after this header, which re-defines ERROR and breaks Logger::Level::ERROR
+constexpr Logger::Level kLogLevelDebug = Logger::Level::DEBUG;
+constexpr Logger::Level kLogLevelInfo = Logger::Level::INFO;
+constexpr Logger::Level kLogLevelWarning = Logger::Level::WARNING;
+constexpr Logger::Level kLogLevelError = Logger::Level::ERROR;
+
+/**
+ * Compile-time ID of a log call site (FNV-1a over file name and line)
+ *
+ * Only the file's base name is hashed: __FILE__ carries the build path,
+ * which differs between machines and checkouts. IDs therefore stay the same
+ * wherever the engine is built, as long as the call site does not move, and
+ * can be stored in configuration and rate-limit rules or matched against
+ * flight-recorder dumps. Base names are unique within the engine sources.
+ */
+constexpr const char* LogSiteFileName(const char* file) {
+  const char* name = file;
+  for (const char* p = file; *p != '\0'; ++p) {
+    if (*p == '/' || *p == '\\') {
+      name = p + 1;
+    }
+  }
+  return name;
+}
+
+constexpr uint32_t LogSiteId(const char* file, int line) {
+  uint32_t hash = 2166136261u;
+  for (const char* p = LogSiteFileName(file); *p != '\0'; ++p) {
+    hash = (hash ^ static_cast<uint8_t>(*p)) * 16777619u;
+  }
+  for (int shift = 0; shift < 32; shift += 8) {
+    hash = (hash ^ static_cast<uint8_t>(static_cast<uint32_t>(line) >> shift)) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * LogSite - Static descriptor of one ANYWP_LOG_* call site
+ *
+ * Each macro expansion owns a constant-initialized LogSite (no static-init
+ * guard). Its state byte caches the resolved decision "does this site log?",
+ * so a disabled site costs one relaxed load and one predictable branch, and
+ * the message arguments are never evaluated.
+ *
+ * A site registers itself with LogSiteRegistry the first time it runs; until
+ * then its state is UNRESOLVED, which routes that first call to the slow path.
+ */
+class LogSite {
+public:
+  enum State : uint8_t {
+    DISABLED = 0,
+    ENABLED = 1,
+    UNRESOLVED = 2
+  };
+
+  constexpr LogSite(Logger::Level level, const char* file, int line, uint32_t id)
+      : file_(file), line_(line), level_(level), id_(id), state_(UNRESOLVED), next_(nullptr) {}
+
+  LogSite(const LogSite&) = delete;
+  LogSite& operator=(const LogSite&) = delete;
+
+  // Hot-path check used by the ANYWP_LOG_* macros
+  bool ShouldLog() {
+    uint8_t state = state_.load(std::memory_order_relaxed);
+    if (state == DISABLED) {
+      return false;
+    }
+    return state == ENABLED || Resolve();
+  }
+
+  const char* GetFile() const { return file_; }
+  int GetLine() const { return line_; }
+  Logger::Level GetLevel() const { return level_; }
+  uint32_t GetId() const { return id_; }
+
+private:
+  friend class LogSiteRegistry;
+
+  // Slow path: register with the registry and compute the state
+  bool Resolve();
+
+  const char* file_;
+  int line_;
+  Logger::Level level_;
+  uint32_t id_;
+  std::atomic<uint8_t> state_;
+  LogSite* next_;  // Intrusive registry list (guarded by registry mutex)
+};
+
+/**
+ * LogSiteRegistry - Runtime control of individual log call sites
+ *
+ * Features:
+ * - Lists every ANYWP_LOG_* site that has executed (ID, file, line, level)
+ * - Enable/disable a single site by ID, or all sites in matching files
+ *   (dynamic-debug style); rules also apply to sites that register later
+ * - Follows Logger::SetMinLevel() for sites without an override
+ *
+ * Usage:
+ *   // Turn on one DEBUG line in production without lowering the global level
+ *   LogSiteRegistry::Instance().SetSiteEnabled(0x1a2b3c4d, true);
+ *
+ *   // Silence every site in a noisy file
+ *   LogSiteRegistry::Instance().SetFileEnabled("mouse_hook_manager.cpp", false);
+ *
+ * Thread-safe: Yes
+ */
+class LogSiteRegistry {
+public:
+  struct SiteInfo {
+    uint32_t id;
+    std::string file;
+    int line;
+    Logger::Level level;
+    bool enabled;
+  };
+
+  static LogSiteRegistry& Instance();
+
+  // Per-site override (takes precedence over file rules and the min level)
+  void SetSiteEnabled(uint32_t id, bool enabled);
+
+  // Override every site whose file path contains file_pattern
+  void SetFileEnabled(const std::string& file_pattern, bool enabled);
+
+  // Drop all overrides; sites follow the logger's min level again
+  void ClearOverrides();
+
+  // Recompute every site (called by Logger::SetMinLevel)
+  void Refresh();
+
+  std::vector<SiteInfo> GetSites() const;
+  size_t GetSiteCount() const;
+
+private:
+  friend class LogSite;
+
+  LogSiteRegistry() = default;
+  ~LogSiteRegistry() = default;
+
+  LogSiteRegistry(const LogSiteRegistry&) = delete;
+  LogSiteRegistry& operator=(const LogSiteRegistry&) = delete;
+
+  struct Rule {
+    bool by_id;                // true: match id, false: match file_pattern
+    uint32_t id;
+    std::string file_pattern;
+    bool enabled;
+  };
+
+  bool Register(LogSite* site);
+  bool ComputeEnabled(const LogSite& site) const;  // Requires mutex_
+
+  LogSite* head_ = nullptr;
+  size_t site_count_ = 0;
+  std::vector<Rule> rules_;  // Applied in order, last match wins
+  mutable std::mutex mutex_;
+};
+
+}  // namespace anywp_engine
+
+// ========== Call-site macros ==========
+// The level is tested before `component` and `message` are evaluated, and the
+// rate limit before `message` is, so filtered-out and rate-limited lines never
+// build their strings.
+
+#define ANYWP_LOG_AT(level, component, message) \
+  do { \
+    static anywp_engine::LogSite anywp_log_site_( \
+        level, __FILE__, __LINE__, anywp_engine::LogSiteId(__FILE__, __LINE__)); \
+    if (anywp_log_site_.ShouldLog()) { \
+      const auto& anywp_log_component_ = (component); \
+      if (anywp_engine::Logger::Instance().Admit(level, anywp_log_component_)) { \
+        anywp_engine::Logger::Instance().Emit(level, anywp_log_component_, message); \
+      } \
+    } \
+  } while (0)
+
+#define ANYWP_LOG_DEBUG(component, message) \
+  ANYWP_LOG_AT(anywp_engine::kLogLevelDebug, component, message)
+
+#define ANYWP_LOG_INFO(component, message) \
+  ANYWP_LOG_AT(anywp_engine::kLogLevelInfo, component, message)
+
+#define ANYWP_LOG_WARNING(component, message) \
+  ANYWP_LOG_AT(anywp_engine::kLogLevelWarning, component, message)
+
+#define ANYWP_LOG_ERROR(component, message) \
+  ANYWP_LOG_AT(anywp_engine::kLogLevelError, component, message)
+
+#endif  // ANYWP_ENGINE_LOG_SITE_H_
@@ -1,9 +1,9 @@
 #include "logger.h"
+#include "log_formatter.h"
 
 #include <iostream>
 #include <fstream>
 #include <chrono>
-#include <iomanip>
 #include <ctime>
 
 #ifdef _WIN32
@@ -22,6 +22,14 @@
 
 namespace anywp_engine {
 
+namespace {
+
+// Async writer tuning
+constexpr size_t kAsyncBatchSize = 256;
+constexpr std::chrono::milliseconds kAsyncWriterInterval(20);
+
+}  // namespace
+
 Logger::Logger() 
     : min_level_(Level::INFO),
       console_enabled_(true),
@@ -30,7 +38,16 @@ Logger::Logger()
       buffer_size_(100),
       rotation_enabled_(false),
       max_file_size_(10 * 1024 * 1024),  // 10MB
-      current_file_size_(0) {
+      current_file_size_(0),
+      async_enabled_(false),
+      async_producers_(0),
+      overflow_policy_(OverflowPolicy::DROP_OLDEST),
+      async_stop_(false),
+      async_enqueued_(0),
+      async_dropped_(0),
+      async_blocked_(0),
+      async_batches_(0),
+      hot_path_console_lines_(0) {
 #ifdef _WIN32
   // Set console output to UTF-8 at initialization
   SetConsoleOutputCP(CP_UTF8);
@@ -39,11 +56,22 @@ Logger::Logger()
 }
 
 Logger::~Logger() {
+  // Report lines suppressed since the last summary
+  if (rate_limiter_.GetSuppressedTotal() > 0) {
+    ReportSuppressed(LogRateLimiter::Clock::now());
+  }
+  
+  // Drain the async ring (if any) so no queued record is lost on shutdown
+  StopAsyncWriter();
+  
   // Flush any buffered logs before destruction
   if (buffering_enabled_) {
     Flush();
   }
   
+  // Let an in-flight rotation install its file and finish compressing
+  rotator_.Stop();
+  
   if (log_file_.is_open()) {
     log_file_.close();
   }
@@ -69,7 +97,39 @@ void Logger::Error(const std::string& component, const std::string& message) {
 
 void Logger::Log(Level level, const std::string& component, const std::string& message) {
   // Check log level filter
-  if (level < min_level_) {
+  if (level < min_level_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  
+  Write(level, component, message);
+}
+
+void Logger::Write(Level level, const std::string& component, const std::string& message) {
+  if (!Admit(level, component)) {
+    return;
+  }
+  
+  Emit(level, component, message);
+}
+
+bool Logger::Admit(Level level, std::string_view component) {
+  if (!rate_limiter_.HasRules()) {
+    return true;
+  }
+  
+  auto now = LogRateLimiter::Clock::now();
+  bool admitted = rate_limiter_.Admit(static_cast<int>(level), component, now);
+  
+  if (rate_limiter_.ReportDue(now)) {
+    ReportSuppressed(now);
+  }
+  return admitted;
+}
+
+void Logger::Emit(Level level, const std::string& component, const std::string& message) {
+  // Async mode: hand the record to the writer thread without taking mutex_
+  if (async_enabled_.load(std::memory_order_acquire)) {
+    EnqueueAsync(level, component, message);
     return;
   }
 
@@ -78,16 +138,22 @@ void Logger::Log(Level level, const std::string& component, const std::string& m
   // Update statistics
   log_counts_[level]++;
   
-  std::string formatted = FormatLogMessage(level, component, message);
+  std::string_view formatted = FormatLogMessage(level, component, message,
+                                                std::chrono::system_clock::now());
   
-  if (console_enabled_) {
+  if (console_enabled_ && ConsoleAllowedHere()) {
     WriteToConsole(formatted);
   }
   
+  // Plain memory copy into the mapped ring (survives a crash of this process)
+  if (flight_recorder_.IsOpen()) {
+    flight_recorder_.Append(formatted);
+  }
+  
   if (file_enabled_) {
     if (buffering_enabled_) {
       // Add to buffer
-      buffer_.push_back(formatted);
+      buffer_.emplace_back(formatted);
       
       // Auto-flush if buffer is full
       if (buffer_.size() >= buffer_size_) {
@@ -103,11 +169,39 @@ void Logger::Log(Level level, const std::string& component, const std::string& m
 // ========== Configuration ==========
 
 void Logger::SetMinLevel(Level level) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  min_level_ = level;
+  min_level_.store(level, std::memory_order_relaxed);
+  
+  // Re-resolve ANYWP_LOG_* call sites that follow the global level
+  LogSiteRegistry::Instance().Refresh();
+}
+
+void Logger::SetRateLimit(const std::string& component, Level level,
+                          double messages_per_second, size_t burst) {
+  rate_limiter_.SetRateLimit(component, static_cast<int>(level), messages_per_second, burst);
+}
+
+void Logger::SetSampling(const std::string& component, Level level, uint32_t keep_one_in) {
+  rate_limiter_.SetSampling(component, static_cast<int>(level), keep_one_in);
+}
+
+void Logger::ClearRateLimits() {
+  // Report what the old rules suppressed before dropping their counters
+  ReportSuppressed(LogRateLimiter::Clock::now());
+  rate_limiter_.Clear();
+}
+
+void Logger::SetSuppressionReportInterval(std::chrono::milliseconds interval) {
+  rate_limiter_.SetReportInterval(interval);
+}
+
+Logger::Level Logger::GetMinLevel() const {
+  return min_level_.load(std::memory_order_relaxed);
 }
 
 void Logger::EnableFileLogging(const std::string& file_path) {
+  // An in-flight rotation still targets the previous file
+  rotator_.WaitIdle();
+  
   std::lock_guard<std::mutex> lock(mutex_);
   
   if (log_file_.is_open()) {
@@ -144,6 +238,8 @@ void Logger::EnableFileLogging(const std::string& file_path) {
 }
 
 void Logger::DisableFileLogging() {
+  rotator_.WaitIdle();
+  
   std::lock_guard<std::mutex> lock(mutex_);
   
   if (log_file_.is_open()) {
@@ -153,6 +249,24 @@ void Logger::DisableFileLogging() {
   file_enabled_ = false;
 }
 
+bool Logger::EnableFlightRecorder(const std::string& file_path, size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  
+  if (!flight_recorder_.Open(file_path, capacity)) {
+    std::cout << "[AnyWP] [Logger] ERROR: Failed to map flight recorder: " << file_path << std::endl;
+    return false;
+  }
+  
+  std::cout << "[AnyWP] [Logger] Flight recorder enabled: " << file_path
+            << " (" << flight_recorder_.GetCapacity() / 1024 << " KB)" << std::endl;
+  return true;
+}
+
+void Logger::DisableFlightRecorder() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  flight_recorder_.Close();
+}
+
 void Logger::EnableConsoleLogging(bool enable) {
   std::lock_guard<std::mutex> lock(mutex_);
   console_enabled_ = enable;
@@ -160,42 +274,40 @@ void Logger::EnableConsoleLogging(bool enable) {
 
 // ========== Internal Helpers ==========
 
-std::string Logger::GetTimestamp() {
-  auto now = std::chrono::system_clock::now();
-  auto time_t_now = std::chrono::system_clock::to_time_t(now);
-  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-      now.time_since_epoch()) % 1000;
-  
-  std::tm tm_now;
-  localtime_s(&tm_now, &time_t_now);
-  
-  std::ostringstream oss;
-  oss << std::put_time(&tm_now, "%Y-%m-%d %H:%M:%S");
-  oss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-  
-  return oss.str();
+std::string_view Logger::FormatLogMessage(Level level, const std::string& component,
+                                          const std::string& message,
+                                          const std::chrono::system_clock::time_point& now) {
+  // Formats into a per-thread buffer; see log_formatter.h
+  return LogFormatter::Format(level, component, message, now);
 }
 
-std::string Logger::LevelToString(Level level) {
-  switch (level) {
-    case Level::DEBUG:   return "DEBUG";
-    case Level::INFO:    return "INFO";
-    case Level::WARNING: return "WARNING";
-    case Level::ERROR:   return "ERROR";
-    default:             return "UNKNOWN";
+void Logger::ReportSuppressed(LogRateLimiter::Clock::time_point now) {
+  for (const auto& suppression : rate_limiter_.TakeSuppressions(now)) {
+    Level level = static_cast<Level>(suppression.level);
+    std::string_view prefix = LogFormatter::LevelPrefix(level);  // "[LEVEL] "
+    std::string summary = "Suppressed " + std::to_string(suppression.count) +
+                          " messages from " + suppression.component + " (" +
+                          std::string(prefix.substr(1, prefix.size() - 3)) + ", rate limit)";
+    // Summaries bypass the limiter but keep the level of the lines they replace
+    if (level >= min_level_.load(std::memory_order_relaxed)) {
+      Emit(level, "Logger", summary);
+    }
   }
 }
 
-std::string Logger::FormatLogMessage(Level level, const std::string& component, const std::string& message) {
-  std::ostringstream oss;
-  oss << "[" << GetTimestamp() << "] "
-      << "[" << LevelToString(level) << "] "
-      << "[" << component << "] "
-      << message;
-  return oss.str();
+bool Logger::ConsoleAllowedHere() {
+  if (!HotPathScope::IsActive()) {
+    return true;
+  }
+  hot_path_console_lines_.fetch_add(1, std::memory_order_relaxed);
+#ifdef ANYWP_NO_CONSOLE_IO
+  return false;
+#else
+  return true;
+#endif
 }
 
-void Logger::WriteToConsole(const std::string& message) {
+void Logger::WriteToConsole(std::string_view message) {
 #ifdef _WIN32
   // Set console output to UTF-8 to fix Chinese character encoding
   static bool console_utf8_initialized = false;
@@ -204,13 +316,22 @@ void Logger::WriteToConsole(const std::string& message) {
     console_utf8_initialized = true;
   }
 #endif
-  std::cout << message << std::endl;
+  std::cout.write(message.data(), static_cast<std::streamsize>(message.size()));
+  std::cout.put('\n');
+  std::cout.flush();
 }
 
-void Logger::WriteToFile(const std::string& message) {
+void Logger::WriteToFile(std::string_view message) {
+  if (rotating_) {
+    // The rotator is swapping files; hold the line until the new file is installed
+    rotation_pending_.append(message.data(), message.size());
+    rotation_pending_ += '\n';
+    return;
+  }
+  
   if (log_file_.is_open()) {
     // Write UTF-8 string directly (file is opened in binary mode)
-    log_file_.write(message.c_str(), message.length());
+    log_file_.write(message.data(), static_cast<std::streamsize>(message.length()));
     log_file_.write("\n", 1);  // Write newline as binary
     log_file_.flush();  // Ensure immediate write
     
@@ -226,12 +347,37 @@ void Logger::WriteToFile(const std::string& message) {
 // v2.1.0+ Enhanced features implementation
 
 void Logger::Flush() {
+  // Pending rate-limit summaries go out with everything else
+  if (rate_limiter_.GetSuppressedTotal() > 0) {
+    ReportSuppressed(LogRateLimiter::Clock::now());
+  }
+  
+  // Async mode: write out everything queued so far before flushing the file
+  while (DrainAsyncQueue() > 0) {
+  }
+  
+  // Lines held during a rotation reach the disk once the new file is installed
+  rotator_.WaitIdle();
+  
   std::lock_guard<std::mutex> lock(mutex_);
   FlushInternal();
 }
 
 void Logger::FlushInternal() {
-  if (!file_enabled_ || !log_file_.is_open()) {
+  if (!file_enabled_) {
+    return;
+  }
+  
+  if (rotating_) {
+    for (const auto& msg : buffer_) {
+      rotation_pending_ += msg;
+      rotation_pending_ += '\n';
+    }
+    buffer_.clear();
+    return;
+  }
+  
+  if (!log_file_.is_open()) {
     return;
   }
   
@@ -270,8 +416,16 @@ void Logger::EnableRotation(size_t max_file_size) {
   max_file_size_ = max_file_size;
 }
 
+void Logger::SetRotationPolicy(size_t max_archives, uint64_t max_total_bytes, bool compress) {
+  LogRotator::Policy policy;
+  policy.max_archives = max_archives;
+  policy.max_total_bytes = max_total_bytes;
+  policy.compress = compress;
+  rotator_.SetPolicy(policy);
+}
+
 bool Logger::ShouldRotate() const {
-  return current_file_size_ >= max_file_size_;
+  return !rotating_ && current_file_size_ >= max_file_size_;
 }
 
 void Logger::RotateLogFile() {
@@ -279,29 +433,60 @@ void Logger::RotateLogFile() {
     return;
   }
   
-  // Close current file
-  log_file_.close();
+  // Hand the full file to the background rotator and keep going: closing,
+  // renaming, reopening and compressing all happen on its thread, and lines
+  // logged meanwhile are held in rotation_pending_
+  rotating_ = true;
+  rotator_.Rotate(std::move(log_file_), log_file_path_,
+                  [this, path = log_file_path_](std::ofstream&& fresh_file) {
+                    InstallRotatedFile(path, std::move(fresh_file));
+                  });
+  current_file_size_ = 0;
+}
+
+void Logger::InstallRotatedFile(const std::string& path, std::ofstream&& fresh_file) {
+  size_t written = 0;
   
-  // Generate rotated filename
-  std::string rotated_name = log_file_path_ + "." + 
-      std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+  // Copy held lines into the new file outside the mutex; only the last
+  // (small) remainder is written while producers wait
+  constexpr size_t kInstallRemainder = 64 * 1024;
+  std::string chunk;
+  while (fresh_file.is_open()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (rotation_pending_.size() <= kInstallRemainder) {
+        break;
+      }
+      chunk.swap(rotation_pending_);
+    }
+    fresh_file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    written += chunk.size();
+    chunk.clear();
+  }
   
-  // Rename current file
-  std::rename(log_file_path_.c_str(), rotated_name.c_str());
+  std::lock_guard<std::mutex> lock(mutex_);
   
-  // Open new file in binary mode
-  log_file_.open(log_file_path_, std::ios::app | std::ios::binary);
-  // Write UTF-8 BOM for new rotated file
-  if (log_file_.is_open()) {
-    unsigned char bom[] = {0xEF, 0xBB, 0xBF};
-    log_file_.write(reinterpret_cast<const char*>(bom), 3);
-    log_file_.flush();
+  rotating_ = false;
+  if (!file_enabled_ || path != log_file_path_ || !fresh_file.is_open()) {
+    // File logging was redirected meanwhile (or reopening failed)
+    rotation_pending_.clear();
+    if (!fresh_file.is_open()) {
+      file_enabled_ = false;
+      std::cout << "[AnyWP] [Logger] ERROR: Failed to reopen log file after rotation: " << path << std::endl;
+    }
+    return;
   }
-  current_file_size_ = 0;
   
-  if (log_file_.is_open()) {
-    std::cout << "[AnyWP] [Logger] Log file rotated: " << rotated_name << std::endl;
+  log_file_ = std::move(fresh_file);
+  current_file_size_ = 3 + written;  // UTF-8 BOM + lines copied above
+  if (!rotation_pending_.empty()) {
+    log_file_.write(rotation_pending_.data(), static_cast<std::streamsize>(rotation_pending_.size()));
+    current_file_size_ += rotation_pending_.size();
+    rotation_pending_.clear();
   }
+  log_file_.flush();
+  
+  std::cout << "[AnyWP] [Logger] Log file rotated: " << path << std::endl;
 }
 
 std::map<std::string, size_t> Logger::GetStatistics() const {
@@ -314,8 +499,213 @@ std::map<std::string, size_t> Logger::GetStatistics() const {
   stats["ERROR"] = log_counts_.count(Level::ERROR) ? log_counts_.at(Level::ERROR) : 0;
   stats["Total"] = stats["DEBUG"] + stats["INFO"] + stats["WARNING"] + stats["ERROR"];
   
+  // Async mode counters
+  stats["AsyncEnqueued"] = async_enqueued_.load(std::memory_order_relaxed);
+  stats["AsyncDropped"] = async_dropped_.load(std::memory_order_relaxed);
+  stats["AsyncBlocked"] = async_blocked_.load(std::memory_order_relaxed);
+  stats["AsyncBatches"] = async_batches_.load(std::memory_order_relaxed);
+  
+  // Rotation
+  stats["Rotations"] = rotator_.GetRotationCount();
+  
+  // Flight recorder
+  stats["FlightRecorderBytes"] = static_cast<size_t>(flight_recorder_.GetTotalWritten());
+  
+  // Rate limiting
+  stats["RateLimited"] = static_cast<size_t>(rate_limiter_.GetSuppressedTotal());
+  
+  // Console output requested from a hook / message-receive thread
+  stats["HotPathConsoleLines"] = hot_path_console_lines_.load(std::memory_order_relaxed);
+  
   return stats;
 }
 
+// ========== Async Mode ==========
+
+void Logger::EnableAsync(bool enabled, size_t queue_capacity, OverflowPolicy policy) {
+  // Always tear down the current writer first; this drains the old ring
+  StopAsyncWriter();
+  
+  if (!enabled) {
+    return;
+  }
+  
+  async_queue_ = std::make_unique<LogRingBuffer>(queue_capacity);
+  overflow_policy_ = policy;
+  
+  async_batch_.resize(kAsyncBatchSize);
+  for (auto& record : async_batch_) {
+    record.component.reserve(LogRingBuffer::kComponentReserve);
+    record.message.reserve(LogRingBuffer::kMessageReserve);
+  }
+  
+  async_stop_.store(false, std::memory_order_release);
+  async_writer_ = std::thread(&Logger::AsyncWriterLoop, this);
+  async_enabled_.store(true, std::memory_order_release);
+}
+
+bool Logger::IsAsync() const {
+  return async_enabled_.load(std::memory_order_acquire);
+}
+
+void Logger::EnqueueAsync(Level level, const std::string& component, const std::string& message) {
+  // Register as an in-flight producer so StopAsyncWriter() never frees the
+  // ring underneath us; re-check the flag after registering
+  async_producers_.fetch_add(1, std::memory_order_seq_cst);
+  if (!async_enabled_.load(std::memory_order_seq_cst)) {
+    async_producers_.fetch_sub(1, std::memory_order_release);
+    Write(level, component, message);  // Falls through to the synchronous path
+    return;
+  }
+  
+  LogRingBuffer& queue = *async_queue_;
+  auto now = std::chrono::system_clock::now();
+  int raw_level = static_cast<int>(level);
+  
+  bool pushed = queue.TryPush(raw_level, now, component, message);
+  while (!pushed) {
+    // A hot-path thread (hook callback, message receive) never waits for space
+    if (overflow_policy_ == OverflowPolicy::DROP_NEWEST || HotPathScope::IsActive()) {
+      async_dropped_.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+    
+    if (overflow_policy_ == OverflowPolicy::DROP_OLDEST) {
+      if (queue.DiscardOldest()) {
+        async_dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+    } else {
+      // BLOCK: wake the writer and wait briefly for it to free a slot
+      async_blocked_.fetch_add(1, std::memory_order_relaxed);
+      async_wake_cv_.notify_one();
+      std::unique_lock<std::mutex> wait_lock(async_wake_mutex_);
+      async_space_cv_.wait_for(wait_lock, std::chrono::milliseconds(1));
+    }
+    pushed = queue.TryPush(raw_level, now, component, message);
+  }
+  
+  if (pushed) {
+    async_enqueued_.fetch_add(1, std::memory_order_relaxed);
+    // Only wake the writer early when the ring is filling up; otherwise it
+    // picks records up on its next periodic pass
+    if (queue.SizeApprox() >= queue.Capacity() / 2) {
+      async_wake_cv_.notify_one();
+    }
+  }
+  
+  async_producers_.fetch_sub(1, std::memory_order_release);
+}
+
+void Logger::AsyncWriterLoop() {
+  while (!async_stop_.load(std::memory_order_acquire)) {
+    {
+      std::unique_lock<std::mutex> wake_lock(async_wake_mutex_);
+      async_wake_cv_.wait_for(wake_lock, kAsyncWriterInterval, [this] {
+        return async_stop_.load(std::memory_order_acquire) ||
+               async_queue_->SizeApprox() >= async_queue_->Capacity() / 2;
+      });
+    }
+    
+    // Drain everything that is queued, one batch at a time
+    while (DrainAsyncQueue() == kAsyncBatchSize) {
+    }
+  }
+  
+  // Final drain (StopAsyncWriter has already stopped new producers)
+  while (DrainAsyncQueue() > 0) {
+  }
+}
+
+size_t Logger::DrainAsyncQueue() {
+  std::lock_guard<std::mutex> drain_lock(async_drain_mutex_);
+  
+  if (!async_queue_) {
+    return 0;
+  }
+  
+  size_t count = 0;
+  while (count < async_batch_.size() && async_queue_->TryPop(async_batch_[count])) {
+    count++;
+  }
+  
+  if (count == 0) {
+    return 0;
+  }
+  
+  // Slots are free again; release producers blocked on a full ring
+  async_space_cv_.notify_all();
+  
+  std::lock_guard<std::mutex> lock(mutex_);
+  
+  // Format the whole batch into one contiguous block per sink (the block's
+  // capacity is kept between drains)
+  std::string& block = async_block_;
+  block.clear();
+  for (size_t i = 0; i < count; ++i) {
+    const LogRecord& record = async_batch_[i];
+    Level level = static_cast<Level>(record.level);
+    log_counts_[level]++;
+    block += FormatLogMessage(level, record.component, record.message, record.timestamp);
+    block += '\n';
+  }
+  
+  if (console_enabled_) {
+    std::cout.write(block.data(), block.size());
+    std::cout.flush();
+  }
+  
+  if (flight_recorder_.IsOpen()) {
+    flight_recorder_.AppendRaw(block);
+  }
+  
+  if (file_enabled_ && rotating_) {
+    rotation_pending_ += block;
+  } else if (file_enabled_ && log_file_.is_open()) {
+    log_file_.write(block.data(), block.size());
+    log_file_.flush();
+    current_file_size_ += block.size();
+    
+    if (rotation_enabled_ && ShouldRotate()) {
+      RotateLogFile();
+    }
+  }
+  
+  async_batches_.fetch_add(1, std::memory_order_relaxed);
+  return count;
+}
+
+void Logger::StopAsyncWriter() {
+  if (!async_queue_) {
+    return;
+  }
+  
+  // 1. Route new Log() calls to the synchronous path
+  async_enabled_.store(false, std::memory_order_seq_cst);
+  
+  // 2. Wait for in-flight producers (the writer keeps running so that
+  //    producers blocked on a full ring can finish)
+  while (async_producers_.load(std::memory_order_seq_cst) > 0) {
+    async_wake_cv_.notify_one();
+    std::this_thread::yield();
+  }
+  
+  // 3. Stop the writer; it drains whatever is left before exiting
+  {
+    std::lock_guard<std::mutex> wake_lock(async_wake_mutex_);
+    async_stop_.store(true, std::memory_order_release);
+  }
+  async_wake_cv_.notify_one();
+  if (async_writer_.joinable()) {
+    async_writer_.join();
+  }
+  
+  DrainAsyncQueue();
+  
+  {
+    std::lock_guard<std::mutex> drain_lock(async_drain_mutex_);
+    async_queue_.reset();
+  }
+}
+
 }  // namespace anywp_engine
 
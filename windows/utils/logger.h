@@ -2,11 +2,23 @@
 #define ANYWP_ENGINE_LOGGER_H_
 
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <mutex>
 #include <sstream>
 #include <vector>
 #include <map>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+
+#include "log_flight_recorder.h"
+#include "hot_path.h"
+#include "log_rate_limiter.h"
+#include "log_rotator.h"
+#include "log_ring_buffer.h"
 
 // Undef Windows macros that conflict with our enum
 #ifdef ERROR
@@ -22,8 +34,12 @@ namespace anywp_engine {
  * - Thread-safe logging
  * - Multiple log levels (DEBUG, INFO, WARNING, ERROR)
  * - Console and file output
- * - Automatic timestamping
- * - Log file rotation (optional)
+ * - Automatic timestamping (allocation-free formatting, see log_formatter.h)
+ * - Log file rotation (optional): done on a background thread, with gzip
+ *   compression and retention by archive count and total bytes
+ * - Flight recorder (optional): fixed-size memory-mapped ring that keeps the
+ *   last few MB of history across a crash, written without syscalls
+ * - Asynchronous mode (optional): lock-free ring buffer + background writer
  * 
  * Log Format Specification:
  * [YYYY-MM-DD HH:MM:SS.mmm] [LEVEL] [COMPONENT] message
@@ -38,6 +54,22 @@ namespace anywp_engine {
  * - Messages should be in English, no emoji or special symbols
  * - Use appropriate log levels: DEBUG for detailed info, INFO for normal operations,
  *   WARNING for recoverable issues, ERROR for failures
+ * - On hot paths prefer ANYWP_LOG_DEBUG/INFO/WARNING/ERROR (log_site.h): the
+ *   level is checked before the message expression is evaluated, and each
+ *   call site can be toggled at runtime through LogSiteRegistry
+ *
+ * Async Mode:
+ *   Logger::Instance().EnableAsync(true, 8192, Logger::OverflowPolicy::DROP_OLDEST);
+ *   Producers copy the record into a pre-sized ring slot and return; a single
+ *   writer thread drains the ring in batches into the console and file sinks.
+ *   Flush() waits until every queued record is written, and EnableAsync(false)
+ *   (also run by the destructor) drains the ring before the writer exits.
+ *
+ * Rate Limiting:
+ *   Logger::Instance().SetRateLimit("MouseHook", Logger::Level::DEBUG, 20.0, 50);
+ *   Logger::Instance().SetSampling("IframeDetector", Logger::Level::DEBUG, 100);
+ *   Lines over the budget are dropped before formatting and reported as
+ *   "Suppressed N messages from X (LEVEL, rate limit)" every few seconds.
  */
 class Logger {
 public:
@@ -48,6 +80,13 @@ public:
     ERROR
   };
 
+  // Async mode: what a producer does when the ring buffer is full
+  enum class OverflowPolicy {
+    DROP_OLDEST,  // Discard the oldest queued record to make room
+    DROP_NEWEST,  // Discard the record being logged
+    BLOCK         // Wait until the writer frees a slot (hot-path threads drop instead)
+  };
+
   static Logger& Instance() {
     static Logger instance;
     return instance;
@@ -62,19 +101,51 @@ public:
   
   // Generic log method
   void Log(Level level, const std::string& component, const std::string& message);
+  
+  // Log without the min-level check (rate limits still apply)
+  void Write(Level level, const std::string& component, const std::string& message);
+
+  // Rate-limit check for one line; false means suppressed (and counted).
+  // ANYWP_LOG_* call this before building the message, then call Emit().
+  bool Admit(Level level, std::string_view component);
+
+  // Log without the min-level or rate-limit checks
+  void Emit(Level level, const std::string& component, const std::string& message);
 
   // Configuration
   void SetMinLevel(Level level);
+  Level GetMinLevel() const;
   void EnableFileLogging(const std::string& file_path);
   void DisableFileLogging();
   void EnableConsoleLogging(bool enable);
+  
+  // Crash-surviving memory-mapped ring sink (read back with flight_recorder_dump)
+  bool EnableFlightRecorder(const std::string& file_path,
+                            size_t capacity = LogFlightRecorder::kDefaultCapacity);
+  void DisableFlightRecorder();
 
   // v2.1.0+ Enhanced features
   void Flush();  // Manually flush buffered logs
   void SetBuffering(bool enabled, size_t buffer_size = 100);
   void EnableRotation(size_t max_file_size = 10 * 1024 * 1024);  // 10MB default
+  // Archives kept after rotation (0 = unlimited); compressed with gzip by default
+  void SetRotationPolicy(size_t max_archives, uint64_t max_total_bytes, bool compress = true);
   std::map<std::string, size_t> GetStatistics() const;
 
+  // Async mode (lock-free ring buffer drained by a background writer thread)
+  void EnableAsync(bool enabled, size_t queue_capacity = 8192,
+                   OverflowPolicy policy = OverflowPolicy::DROP_OLDEST);
+  bool IsAsync() const;
+
+  // Rate limiting and sampling per component and level; component "*" is the
+  // default for components without their own rule. Suppressed lines are
+  // summarized as "Suppressed N messages from X" at most once per interval.
+  void SetRateLimit(const std::string& component, Level level,
+                    double messages_per_second, size_t burst);
+  void SetSampling(const std::string& component, Level level, uint32_t keep_one_in);
+  void ClearRateLimits();
+  void SetSuppressionReportInterval(std::chrono::milliseconds interval);
+
 private:
   Logger();
   ~Logger();
@@ -82,17 +153,30 @@ private:
   Logger(const Logger&) = delete;
   Logger& operator=(const Logger&) = delete;
 
-  std::string GetTimestamp();
-  std::string LevelToString(Level level);
-  std::string FormatLogMessage(Level level, const std::string& component, const std::string& message);
+  // Returns a view into a per-thread buffer (valid until the next call on this thread)
+  std::string_view FormatLogMessage(Level level, const std::string& component,
+                                    const std::string& message,
+                                    const std::chrono::system_clock::time_point& now);
   
-  void WriteToConsole(const std::string& message);
-  void WriteToFile(const std::string& message);
+  // False when the console sink must be skipped for the calling thread
+  bool ConsoleAllowedHere();
+  void WriteToConsole(std::string_view message);
+  void WriteToFile(std::string_view message);
   void FlushInternal();  // Internal flush (no mutex lock)
   void RotateLogFile();
   bool ShouldRotate() const;
+  void InstallRotatedFile(const std::string& path, std::ofstream&& fresh_file);  // Rotator thread
 
-  Level min_level_;
+  // Async mode helpers
+  void EnqueueAsync(Level level, const std::string& component, const std::string& message);
+  void AsyncWriterLoop();
+  size_t DrainAsyncQueue();  // Returns number of records written
+  void StopAsyncWriter();
+
+  // Emit one summary line per rate-limited component/level
+  void ReportSuppressed(LogRateLimiter::Clock::time_point now);
+
+  std::atomic<Level> min_level_;
   bool console_enabled_;
   bool file_enabled_;
   std::string log_file_path_;
@@ -107,24 +191,43 @@ private:
   bool rotation_enabled_;
   size_t max_file_size_;
   size_t current_file_size_;
+  LogRotator rotator_;
+  bool rotating_ = false;             // File handed to rotator_, not yet replaced
+  std::string rotation_pending_;      // Lines written while rotating_
   
   std::map<Level, size_t> log_counts_;
+  
+  LogFlightRecorder flight_recorder_;  // Guarded by mutex_
+
+  // Async mode state
+  std::atomic<bool> async_enabled_;
+  std::atomic<int> async_producers_;  // Producers currently inside EnqueueAsync
+  std::unique_ptr<LogRingBuffer> async_queue_;
+  OverflowPolicy overflow_policy_;
+  std::thread async_writer_;
+  std::atomic<bool> async_stop_;
+  std::mutex async_wake_mutex_;
+  std::condition_variable async_wake_cv_;   // Wakes the writer
+  std::condition_variable async_space_cv_;  // Wakes producers blocked on a full ring
+  std::mutex async_drain_mutex_;            // Serializes batch drains (keeps line order)
+  std::vector<LogRecord> async_batch_;
+  std::string async_block_;                 // Reused formatting buffer for a batch
+  std::atomic<size_t> async_enqueued_;
+  std::atomic<size_t> async_dropped_;
+  std::atomic<size_t> async_blocked_;
+  std::atomic<size_t> async_batches_;
+
+  // Console lines written (or, with ANYWP_NO_CONSOLE_IO, dropped) inside a HotPathScope
+  std::atomic<size_t> hot_path_console_lines_;
+
+  // Rate limiting
+  LogRateLimiter rate_limiter_;
 };
 
-// Convenience macros
-#define ANYWP_LOG_DEBUG(component, message) \
-  anywp_engine::Logger::Instance().Debug(component, message)
-
-#define ANYWP_LOG_INFO(component, message) \
-  anywp_engine::Logger::Instance().Info(component, message)
-
-#define ANYWP_LOG_WARNING(component, message) \
-  anywp_engine::Logger::Instance().Warning(component, message)
-
-#define ANYWP_LOG_ERROR(component, message) \
-  anywp_engine::Logger::Instance().Error(component, message)
-
 }  // namespace anywp_engine
 
+// ANYWP_LOG_* call-site macros (level checked before arguments are evaluated)
+#include "log_site.h"
+
 #endif  // ANYWP_ENGINE_LOGGER_H_
 
@@ -0,0 +1,147 @@
+#include "mapped_state_storage.h"
+#include "logger.h"
+#include "state_journal.h"
+
+#include <filesystem>
+#include <system_error>
+
+namespace anywp_engine {
+
+namespace {
+
+constexpr const char* kLogComponent = "MappedStateStorage";
+
+// Application names become a directory under the root
+bool IsValidApplicationName(const std::string& name) {
+  return !name.empty() && name != "." && name != ".." &&
+         name.find_first_of("/\\:") == std::string::npos;
+}
+
+}  // namespace
+
+MappedStateStorage::MappedStateStorage(const std::string& root,
+                                       const StateHashFile::Options& options)
+    : root_(root),
+      options_(options) {
+}
+
+MappedStateStorage::~MappedStateStorage() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  file_.reset();
+}
+
+// ========== IStateStorage ==========
+
+bool MappedStateStorage::SaveState(const std::string& key, const std::string& value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_ && file_->Put(key, value);
+}
+
+bool MappedStateStorage::LoadState(const std::string& key, std::string& out_value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_ && file_->Get(key, out_value);
+}
+
+bool MappedStateStorage::ClearState(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_ && file_->Erase(key);
+}
+
+bool MappedStateStorage::ClearAllState() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_ && file_->Clear();
+}
+
+bool MappedStateStorage::HasState(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_ && file_->Contains(key);
+}
+
+std::vector<std::string> MappedStateStorage::GetAllKeys() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_ ? file_->GetKeys() : std::vector<std::string>();
+}
+
+bool MappedStateStorage::SetApplicationName(const std::string& app_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!IsValidApplicationName(app_name)) {
+    ANYWP_LOG_WARNING(kLogComponent, "Invalid application name: " + app_name);
+    return false;
+  }
+  if (file_ && app_name == application_name_) {
+    return true;
+  }
+
+  file_.reset();  // Closes the previous application's file
+  application_name_ = app_name;
+
+  std::string directory =
+      (std::filesystem::u8path(root_) / std::filesystem::u8path(app_name)).u8string();
+  if (StateJournal::Exists(directory) && !Migrate(directory)) {
+    return false;
+  }
+
+  auto file = std::make_unique<StateHashFile>(directory, options_);
+  if (!file->Open()) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to open state store: " + directory);
+    return false;
+  }
+  file_ = std::move(file);
+  ANYWP_LOG_INFO(kLogComponent, "Opened state store (" + app_name + "): " +
+                 std::to_string(file_->GetStats().keys) + " keys");
+  return true;
+}
+
+std::string MappedStateStorage::GetStoragePath() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (application_name_.empty()) {
+    return root_;
+  }
+  return (std::filesystem::u8path(root_) / std::filesystem::u8path(application_name_)).u8string();
+}
+
+// ========== Batch Operations ==========
+
+std::map<std::string, std::string> MappedStateStorage::LoadAllStates() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_ ? file_->GetAll() : std::map<std::string, std::string>();
+}
+
+bool MappedStateStorage::ReplaceAllStates(const std::map<std::string, std::string>& states) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_ && file_->Replace(states);
+}
+
+bool MappedStateStorage::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !file_ || file_->Flush();
+}
+
+StateHashFile::Stats MappedStateStorage::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_ ? file_->GetStats() : StateHashFile::Stats();
+}
+
+// ========== Migration ==========
+
+bool MappedStateStorage::Migrate(const std::string& directory) {
+  std::map<std::string, std::string> state;
+  if (!StateJournal::Read(directory, state)) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to read state to migrate in: " + directory);
+    return false;
+  }
+  if (!StateHashFile::Write(directory, state, options_)) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to migrate state in: " + directory);
+    return false;
+  }
+  // Left behind, the old store would be migrated again over later writes
+  if (!StateJournal::Remove(directory)) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to delete migrated state.json in: " + directory);
+    return false;
+  }
+  ANYWP_LOG_INFO(kLogComponent, "Migrated " + std::to_string(state.size()) +
+                 " keys from state.json to state.map in: " + directory);
+  return true;
+}
+
+}  // namespace anywp_engine
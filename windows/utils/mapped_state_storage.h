@@ -0,0 +1,75 @@
+#ifndef ANYWP_ENGINE_MAPPED_STATE_STORAGE_H_
+#define ANYWP_ENGINE_MAPPED_STATE_STORAGE_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../interfaces/i_state_storage.h"
+#include "state_hash_file.h"
+
+namespace anywp_engine {
+
+/**
+ * MappedStateStorage - IStateStorage backed by a memory-mapped hash file
+ *
+ * Each application's state lives in `root`/[AppName]/state.map (see
+ * StateHashFile): opening it maps the file without parsing it, and a
+ * lookup is one hash probe. Writes update the mapping in place and are in
+ * the page cache when SaveState() returns; Flush() waits for the disk.
+ *
+ * Migration: when an application is opened while it has a state.json /
+ * state.journal store (see StateJournal), that store is newer than any
+ * state.map: it is written out as state.map, replacing it, and its files
+ * are deleted. Only the backend in use keeps files, so switching back and
+ * forth never reads stale state.
+ *
+ * Thread-safe: Yes
+ */
+class MappedStateStorage : public IStateStorage {
+public:
+  explicit MappedStateStorage(const std::string& root,
+                              const StateHashFile::Options& options = StateHashFile::Options());
+  ~MappedStateStorage() override;
+
+  MappedStateStorage(const MappedStateStorage&) = delete;
+  MappedStateStorage& operator=(const MappedStateStorage&) = delete;
+
+  // IStateStorage; all but SetApplicationName() fail until an application
+  // has been opened
+  bool SaveState(const std::string& key, const std::string& value) override;
+  bool LoadState(const std::string& key, std::string& out_value) override;
+  bool ClearState(const std::string& key) override;
+  bool ClearAllState() override;
+  bool HasState(const std::string& key) override;
+  std::vector<std::string> GetAllKeys() override;
+  bool SetApplicationName(const std::string& app_name) override;
+  std::string GetStoragePath() const override;
+
+  // Batch operations; ReplaceAllStates() is atomic
+  std::map<std::string, std::string> LoadAllStates();
+  bool ReplaceAllStates(const std::map<std::string, std::string>& states);
+
+  // Wait until everything written so far is on disk
+  bool Flush();
+
+  StateHashFile::Stats GetStats() const;
+
+private:
+  // Write the application's state.json / state.journal store as state.map,
+  // then delete it
+  bool Migrate(const std::string& directory);
+
+  const std::string root_;
+  const StateHashFile::Options options_;
+
+  mutable std::mutex mutex_;
+  std::string application_name_;
+  std::unique_ptr<StateHashFile> file_;  // nullptr until an application is opened
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_MAPPED_STATE_STORAGE_H_
@@ -0,0 +1,84 @@
+#include "message_router.h"
+
+#include <utility>
+
+namespace anywp_engine {
+
+// The table is built by the compiler; spot-check it there too
+static_assert(MessageRouter::Lookup("saveState") == MessageSlot::SAVE_STATE);
+static_assert(MessageRouter::Lookup("OPEN_URL") == MessageRouter::Lookup("openURL"));
+static_assert(MessageRouter::Lookup("savestate") == MessageSlot::NONE);
+static_assert(MessageRouter::Lookup("") == MessageSlot::NONE);
+
+void MessageRouter::SetHandler(MessageSlot slot, Handler handler) {
+  if (slot != MessageSlot::NONE) {
+    slots_[static_cast<size_t>(slot)] = std::move(handler);
+  }
+}
+
+void MessageRouter::SetHandler(std::string_view type, Handler handler) {
+  MessageSlot slot = Lookup(type);
+  if (slot != MessageSlot::NONE) {
+    SetHandler(slot, std::move(handler));
+    return;
+  }
+  auto it = custom_.find(type);
+  if (it != custom_.end()) {
+    it->second = std::move(handler);
+  } else {
+    custom_.emplace(std::string(type), std::move(handler));
+  }
+}
+
+void MessageRouter::RemoveHandler(MessageSlot slot) {
+  if (slot != MessageSlot::NONE) {
+    slots_[static_cast<size_t>(slot)] = nullptr;
+  }
+}
+
+void MessageRouter::RemoveHandler(std::string_view type) {
+  MessageSlot slot = Lookup(type);
+  if (slot != MessageSlot::NONE) {
+    RemoveHandler(slot);
+    return;
+  }
+  auto it = custom_.find(type);
+  if (it != custom_.end()) {
+    custom_.erase(it);
+  }
+}
+
+bool MessageRouter::HasHandler(std::string_view type) const {
+  MessageSlot slot = Lookup(type);
+  if (slot != MessageSlot::NONE) {
+    return static_cast<bool>(slots_[static_cast<size_t>(slot)]);
+  }
+  return custom_.find(type) != custom_.end();
+}
+
+bool MessageRouter::Dispatch(std::string_view type, const std::string& message) const {
+  MessageSlot slot = Lookup(type);
+  if (slot != MessageSlot::NONE) {
+    return Dispatch(slot, message);
+  }
+  auto it = custom_.find(type);
+  if (it == custom_.end() || !it->second) {
+    return false;
+  }
+  it->second(message);
+  return true;
+}
+
+bool MessageRouter::Dispatch(MessageSlot slot, const std::string& message) const {
+  if (slot == MessageSlot::NONE) {
+    return false;
+  }
+  const Handler& handler = slots_[static_cast<size_t>(slot)];
+  if (!handler) {
+    return false;
+  }
+  handler(message);
+  return true;
+}
+
+}  // namespace anywp_engine
@@ -0,0 +1,164 @@
+#ifndef ANYWP_ENGINE_MESSAGE_ROUTER_H_
+#define ANYWP_ENGINE_MESSAGE_ROUTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "webmessage_types.h"  // Generated from sdk/types/webmessage.ts
+
+namespace anywp_engine {
+
+// Handler slot of every message type the engine knows. Alternative
+// spellings ("openURL" / "OPEN_URL") share a slot.
+enum class MessageSlot {
+  IFRAME_DATA,
+  OPEN_URL,
+  READY,
+  LOG,
+  CONSOLE_LOG,
+  SAVE_STATE,
+  LOAD_STATE,
+  CLEAR_STATE,
+  SET_INTERACTIVE,
+  SDK_READY,
+  SDK_ERROR,
+  PAUSE_RESULT,
+  RESUME_RESULT,
+  COUNT,
+  NONE = COUNT  // Not a known type
+};
+
+namespace message_router_internal {
+
+struct Entry {
+  std::string_view name;
+  MessageSlot slot = MessageSlot::NONE;
+};
+
+// Every name the engine routes. SDK messages take their spellings from the
+// generated types; the rest are engine-internal.
+inline constexpr Entry kKnownTypes[] = {
+    {"IFRAME_DATA", MessageSlot::IFRAME_DATA},
+    {webmessage::OpenUrlMessage::kTypes[0], MessageSlot::OPEN_URL},
+    {webmessage::OpenUrlMessage::kTypes[1], MessageSlot::OPEN_URL},
+    {webmessage::ReadyMessage::kTypes[0], MessageSlot::READY},
+    {webmessage::ReadyMessage::kTypes[1], MessageSlot::READY},
+    {webmessage::LogMessage::kTypes[0], MessageSlot::LOG},
+    {webmessage::LogMessage::kTypes[1], MessageSlot::LOG},
+    {webmessage::ConsoleLogMessage::kTypes[0], MessageSlot::CONSOLE_LOG},
+    {webmessage::SaveStateMessage::kTypes[0], MessageSlot::SAVE_STATE},
+    {webmessage::LoadStateMessage::kTypes[0], MessageSlot::LOAD_STATE},
+    {webmessage::ClearStateMessage::kTypes[0], MessageSlot::CLEAR_STATE},
+    {webmessage::SetInteractiveMessage::kTypes[0], MessageSlot::SET_INTERACTIVE},
+    {webmessage::SdkReadyMessage::kTypes[0], MessageSlot::SDK_READY},
+    {webmessage::SdkErrorMessage::kTypes[0], MessageSlot::SDK_ERROR},
+    {"pauseResult", MessageSlot::PAUSE_RESULT},
+    {"resumeResult", MessageSlot::RESUME_RESULT},
+};
+
+constexpr int kTableBits = 6;
+constexpr size_t kTableSize = size_t{1} << kTableBits;
+
+// FNV-1a, top kTableBits bits
+constexpr uint32_t Hash(std::string_view text, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ seed;
+  for (char c : text) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  return hash >> (32 - kTableBits);
+}
+
+// First seed that puts every known name in its own table entry; 0 if none
+// below the search limit does
+constexpr uint32_t FindSeed() {
+  for (uint32_t seed = 1; seed < 4096; ++seed) {
+    bool used[kTableSize] = {};
+    bool collision = false;
+    for (const Entry& entry : kKnownTypes) {
+      uint32_t index = Hash(entry.name, seed);
+      collision = collision || used[index];
+      used[index] = true;
+    }
+    if (!collision) {
+      return seed;
+    }
+  }
+  return 0;
+}
+
+inline constexpr uint32_t kSeed = FindSeed();
+static_assert(kSeed != 0, "No perfect hash for the known message types: raise kTableBits");
+
+struct Table {
+  Entry entries[kTableSize] = {};
+  constexpr Table() {
+    for (const Entry& entry : kKnownTypes) {
+      entries[Hash(entry.name, kSeed)] = entry;
+    }
+  }
+};
+inline constexpr Table kTable{};
+
+}  // namespace message_router_internal
+
+/**
+ * MessageRouter - Web-message dispatch by "type"
+ *
+ * Known types resolve through a perfect hash computed at compile time: one
+ * FNV-1a pass over the type name, one table probe and one string compare,
+ * then an indexed call. The names of the SDK's messages come from the
+ * generated types (webmessage::X::kTypes), so the table follows
+ * webmessage.ts; a name collision or a seed search that fails is a
+ * static_assert, not a runtime fallback.
+ *
+ * Types the engine does not know (registered by applications at runtime)
+ * go to a fallback map that is only consulted when the hash misses.
+ *
+ *   router.SetHandler(MessageSlot::SAVE_STATE, [](const std::string& msg) {...});
+ *   router.SetHandler("myWidgetEvent", ...);   // custom: fallback map
+ *   router.Dispatch(type, message);
+ *
+ * SDKBridge owns the router; AnyWPEnginePlugin installs its handlers
+ * through SDKBridge, so every message has a single dispatch point.
+ *
+ * Thread-safe: No (set handlers before messages arrive)
+ */
+class MessageRouter {
+public:
+  using Handler = std::function<void(const std::string& message)>;
+
+  // Slot of a known type, or MessageSlot::NONE. Usable in constant
+  // expressions.
+  static constexpr MessageSlot Lookup(std::string_view type);
+
+  // Known type names map to their slot (replacing its handler); anything
+  // else is a custom type
+  void SetHandler(MessageSlot slot, Handler handler);
+  void SetHandler(std::string_view type, Handler handler);
+  void RemoveHandler(MessageSlot slot);
+  void RemoveHandler(std::string_view type);
+
+  bool HasHandler(std::string_view type) const;
+
+  // Runs the handler for `type`; false if there is none
+  bool Dispatch(std::string_view type, const std::string& message) const;
+  bool Dispatch(MessageSlot slot, const std::string& message) const;
+
+private:
+  Handler slots_[static_cast<size_t>(MessageSlot::COUNT)];
+  std::map<std::string, Handler, std::less<>> custom_;
+};
+
+constexpr MessageSlot MessageRouter::Lookup(std::string_view type) {
+  using namespace message_router_internal;
+  const Entry& entry = kTable.entries[Hash(type, kSeed)];
+  return !type.empty() && entry.name == type ? entry.slot : MessageSlot::NONE;
+}
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_MESSAGE_ROUTER_H_
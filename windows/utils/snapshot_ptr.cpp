@@ -0,0 +1,74 @@
+#include "snapshot_ptr.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace anywp_engine {
+namespace snapshot_internal {
+
+namespace {
+
+std::atomic<uint64_t> g_epoch{1};
+std::atomic<EpochRecord*> g_records{nullptr};
+
+EpochRecord* AcquireRecord() {
+  for (EpochRecord* record = g_records.load(std::memory_order_acquire); record;
+       record = record->next) {
+    bool expected = false;
+    if (!record->in_use.load(std::memory_order_relaxed) &&
+        record->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+      return record;
+    }
+  }
+
+  auto* record = new EpochRecord();  // Never freed: other threads may be scanning it
+  record->in_use.store(true, std::memory_order_relaxed);
+  EpochRecord* head = g_records.load(std::memory_order_relaxed);
+  do {
+    record->next = head;
+  } while (!g_records.compare_exchange_weak(head, record, std::memory_order_release,
+                                            std::memory_order_relaxed));
+  return record;
+}
+
+// Hands the record back when its thread exits
+struct ThreadRecord {
+  EpochRecord* record = AcquireRecord();
+  ~ThreadRecord() {
+    record->epoch.store(0, std::memory_order_release);
+    record->depth = 0;
+    record->in_use.store(false, std::memory_order_release);
+  }
+};
+
+}  // namespace
+
+EpochRecord* ThisThreadRecord() {
+  thread_local ThreadRecord thread_record;
+  return thread_record.record;
+}
+
+void Enter(EpochRecord* record) {
+  // seq_cst: the store must be visible to a writer's scan before this
+  // thread loads any snapshot pointer
+  record->epoch.store(g_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+}
+
+uint64_t Advance() {
+  return g_epoch.fetch_add(1, std::memory_order_seq_cst);
+}
+
+uint64_t OldestReader() {
+  uint64_t oldest = std::numeric_limits<uint64_t>::max();
+  for (EpochRecord* record = g_records.load(std::memory_order_acquire); record;
+       record = record->next) {
+    uint64_t epoch = record->epoch.load(std::memory_order_seq_cst);
+    if (epoch != 0) {
+      oldest = std::min(oldest, epoch);
+    }
+  }
+  return oldest;
+}
+
+}  // namespace snapshot_internal
+}  // namespace anywp_engine
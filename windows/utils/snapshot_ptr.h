@@ -0,0 +1,139 @@
+#ifndef ANYWP_ENGINE_SNAPSHOT_PTR_H_
+#define ANYWP_ENGINE_SNAPSHOT_PTR_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace anywp_engine {
+
+namespace snapshot_internal {
+
+// Per-thread reader state; records are reused, never freed
+struct EpochRecord {
+  std::atomic<uint64_t> epoch{0};  // 0 = not reading
+  uint32_t depth = 0;              // Nested EpochGuards on the owning thread
+  std::atomic<bool> in_use{false};
+  EpochRecord* next = nullptr;
+};
+
+EpochRecord* ThisThreadRecord();
+// Ends the current epoch; snapshots retired now are tagged with the result
+uint64_t Advance();
+// Smallest epoch any thread is reading under, or UINT64_MAX
+uint64_t OldestReader();
+void Enter(EpochRecord* record);
+
+}  // namespace snapshot_internal
+
+/**
+ * EpochGuard - Read-side critical section for SnapshotPtr
+ *
+ * Pointers returned by SnapshotPtr::Load() stay valid until the guard is
+ * destroyed. Guards nest. Entering costs one thread_local lookup and one
+ * store to this thread's own record: no lock, no shared counter.
+ *
+ * Keep guarded sections short (copy out what you need, e.g. a shared_ptr):
+ * snapshots retired meanwhile are freed only after the guard ends.
+ *
+ * Thread-safe: Yes (one guard belongs to the thread that created it)
+ */
+class EpochGuard {
+public:
+  EpochGuard() : record_(snapshot_internal::ThisThreadRecord()) {
+    if (record_->depth++ == 0) {
+      snapshot_internal::Enter(record_);
+    }
+  }
+
+  ~EpochGuard() {
+    if (--record_->depth == 0) {
+      record_->epoch.store(0, std::memory_order_release);
+    }
+  }
+
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+
+private:
+  snapshot_internal::EpochRecord* record_;
+};
+
+/**
+ * SnapshotPtr - Atomic pointer to an immutable snapshot, with epoch-based
+ * reclamation
+ *
+ * Replaces std::atomic_load/atomic_store on shared_ptr, which (before
+ * C++20's atomic<shared_ptr>) lock a spinlock from a process-wide pool on
+ * every access. Readers load a raw pointer inside an EpochGuard; writers
+ * swap in a new snapshot and retire the old one, which is deleted once no
+ * thread is still reading under an epoch that could have seen it.
+ *
+ *   {
+ *     EpochGuard guard;
+ *     const Table* table = snapshot.Load();
+ *     list = table->lists[topic];  // shared_ptr copy: outlives the guard
+ *   }
+ *   snapshot.Store(std::make_unique<const Table>(...));  // writer, serialized
+ *
+ * Thread-safe: Load() from any thread under an EpochGuard; Store() calls
+ * must be serialized by the caller. A writer may Load() without a guard:
+ * only writers free snapshots.
+ */
+template <typename T>
+class SnapshotPtr {
+public:
+  SnapshotPtr() = default;
+  explicit SnapshotPtr(std::unique_ptr<const T> initial) : current_(initial.release()) {}
+
+  // No reader may remain
+  ~SnapshotPtr() {
+    delete current_.load(std::memory_order_relaxed);
+    for (const Retired& retired : retired_) {
+      delete retired.snapshot;
+    }
+  }
+
+  SnapshotPtr(const SnapshotPtr&) = delete;
+  SnapshotPtr& operator=(const SnapshotPtr&) = delete;
+
+  const T* Load() const {
+    return current_.load(std::memory_order_seq_cst);
+  }
+
+  void Store(std::unique_ptr<const T> next) {
+    const T* previous = current_.exchange(next.release(), std::memory_order_seq_cst);
+    if (previous) {
+      retired_.push_back({previous, snapshot_internal::Advance()});
+    }
+    Reclaim();
+  }
+
+private:
+  struct Retired {
+    const T* snapshot;
+    uint64_t epoch;
+  };
+
+  void Reclaim() {
+    uint64_t oldest = snapshot_internal::OldestReader();
+    size_t kept = 0;
+    for (const Retired& retired : retired_) {
+      if (retired.epoch < oldest) {
+        delete retired.snapshot;
+      } else {
+        retired_[kept++] = retired;
+      }
+    }
+    retired_.resize(kept);
+  }
+
+  std::atomic<const T*> current_{nullptr};
+  std::vector<Retired> retired_;  // Guarded by the caller's writer lock
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_SNAPSHOT_PTR_H_
@@ -0,0 +1,111 @@
+#include "state_cache.h"
+
+namespace anywp_engine {
+
+StateCache::StateCache()
+    : StateCache(Options()) {
+}
+
+StateCache::StateCache(const Options& options)
+    : options_(options) {
+}
+
+void StateCache::SetOptions(const Options& options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  options_ = options;
+  Shrink(Clock::now());
+}
+
+StateCache::Options StateCache::GetOptions() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return options_;
+}
+
+bool StateCache::Get(const std::string& key, std::string& value, Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    stats_.misses++;
+    return false;
+  }
+  if (Expired(*it->second, now)) {
+    Remove(it->second);
+    stats_.expirations++;
+    stats_.misses++;
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second);
+  value = it->second->value;
+  stats_.hits++;
+  return true;
+}
+
+void StateCache::Put(const std::string& key, const std::string& value, Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    Remove(it->second);
+  }
+
+  Entry entry{key, value, now};
+  size_t cost = Cost(entry);
+  if (cost > options_.max_bytes) {
+    return;  // Would flush everything else and still not fit
+  }
+  lru_.push_front(std::move(entry));
+  entries_[key] = lru_.begin();
+  bytes_ += cost;
+  Shrink(now);
+}
+
+void StateCache::Erase(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    Remove(it->second);
+  }
+}
+
+void StateCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lru_.clear();
+  entries_.clear();
+  bytes_ = 0;
+}
+
+StateCache::Stats StateCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.entries = entries_.size();
+  stats.bytes = bytes_;
+  stats.max_bytes = options_.max_bytes;
+  return stats;
+}
+
+size_t StateCache::Cost(const Entry& entry) {
+  return entry.key.size() + entry.value.size() + kEntryOverhead;
+}
+
+bool StateCache::Expired(const Entry& entry, Clock::time_point now) const {
+  return options_.ttl.count() > 0 && now - entry.stored >= options_.ttl;
+}
+
+void StateCache::Remove(EntryList::iterator it) {
+  bytes_ -= Cost(*it);
+  entries_.erase(it->key);
+  lru_.erase(it);
+}
+
+void StateCache::Shrink(Clock::time_point now) {
+  // Expired entries at the cold end go first, whether or not space is short
+  while (!lru_.empty() && Expired(lru_.back(), now)) {
+    Remove(std::prev(lru_.end()));
+    stats_.expirations++;
+  }
+  while (bytes_ > options_.max_bytes) {
+    Remove(std::prev(lru_.end()));
+    stats_.evictions++;
+  }
+}
+
+}  // namespace anywp_engine
@@ -0,0 +1,95 @@
+#ifndef ANYWP_ENGINE_STATE_CACHE_H_
+#define ANYWP_ENGINE_STATE_CACHE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace anywp_engine {
+
+/**
+ * StateCache - Byte-budgeted LRU cache of state values
+ *
+ * Sits in front of a StateJournal so hot keys skip the disk read. Misses are
+ * filled by the caller one key at a time; nothing is preloaded.
+ *
+ * Features:
+ * - Entries are charged key + value + kEntryOverhead bytes; the least
+ *   recently used are evicted once the total exceeds max_bytes. A value
+ *   larger than the whole budget is never cached.
+ * - Optional TTL: an entry older than `ttl` (since it was stored) is
+ *   dropped when next looked up, and expired entries at the cold end of the
+ *   LRU list are reclaimed by Put(). There is no timer thread.
+ *
+ * Thread-safe: Yes
+ */
+class StateCache {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t kDefaultMaxBytes = 4 * 1024 * 1024;
+  static constexpr size_t kEntryOverhead = 64;  // List node, hash bucket, bookkeeping
+
+  struct Options {
+    size_t max_bytes = kDefaultMaxBytes;
+    std::chrono::milliseconds ttl{0};  // 0: entries never expire
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;    // Dropped to stay within max_bytes
+    uint64_t expirations = 0;  // Dropped because the TTL had passed
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t max_bytes = 0;
+  };
+
+  StateCache();
+  explicit StateCache(const Options& options);
+
+  StateCache(const StateCache&) = delete;
+  StateCache& operator=(const StateCache&) = delete;
+
+  // Evicts immediately if the budget shrank
+  void SetOptions(const Options& options);
+  Options GetOptions() const;
+
+  // Counts a hit or a miss; a hit moves the key to the hot end
+  bool Get(const std::string& key, std::string& value, Clock::time_point now = Clock::now());
+
+  void Put(const std::string& key, const std::string& value, Clock::time_point now = Clock::now());
+  void Erase(const std::string& key);
+  void Clear();
+
+  Stats GetStats() const;
+
+private:
+  struct Entry {
+    std::string key;
+    std::string value;
+    Clock::time_point stored;
+  };
+  using EntryList = std::list<Entry>;
+
+  static size_t Cost(const Entry& entry);
+
+  bool Expired(const Entry& entry, Clock::time_point now) const;  // Requires mutex_
+  void Remove(EntryList::iterator it);                            // Requires mutex_
+  void Shrink(Clock::time_point now);                             // Requires mutex_
+
+  mutable std::mutex mutex_;
+  Options options_;
+  EntryList lru_;  // Most recently used first
+  std::unordered_map<std::string, EntryList::iterator> entries_;
+  size_t bytes_ = 0;
+  Stats stats_;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_STATE_CACHE_H_
@@ -0,0 +1,916 @@
+#define NOMINMAX  // Prevent Windows.h from defining min/max macros
+
+#include "state_hash_file.h"
+#include "file_sync.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace anywp_engine {
+
+namespace {
+
+constexpr const char* kLogComponent = "StateHashFile";
+constexpr const char* kTempSuffix = ".tmp";
+
+constexpr char kMagic[8] = {'A', 'N', 'Y', 'W', 'P', 'H', 'M', '1'};
+constexpr uint32_t kVersion = 1;
+
+constexpr uint64_t kPageSize = 4096;
+constexpr uint64_t kHeaderArea = kPageSize;  // Both header copies
+constexpr uint64_t kMinHeapBytes = 64 * 1024;
+constexpr uint64_t kMinBuckets = 8;
+
+constexpr uint8_t kLive = 1;
+constexpr uint8_t kTombstone = 2;
+
+uint32_t Crc32(const void* data, size_t size, uint32_t crc = 0) {
+  static const auto table = [] {
+    std::vector<uint32_t> t(256);
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  crc ^= 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+uint64_t HashKey(std::string_view key) {
+  uint64_t hash = 14695981039346656037ull;  // FNV-1a
+  for (char c : key) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t RoundUp(uint64_t value, uint64_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Smallest power of two that leaves `keys` room to grow by half before the
+// load limit
+uint64_t BucketsFor(size_t keys, const StateHashFile::Options& options) {
+  uint64_t buckets = kMinBuckets;
+  while (buckets < options.initial_buckets) {
+    buckets <<= 1;
+  }
+  size_t load = std::min<size_t>(std::max<size_t>(options.max_load_percent, 10), 95);
+  while (static_cast<uint64_t>(keys) * 150 > buckets * load) {
+    buckets <<= 1;
+  }
+  return buckets;
+}
+
+}  // namespace
+
+// ========== On-disk Layout ==========
+
+// One header copy; copy (seq % 2) is written, at offset copy * 128
+struct StateHashFile::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t crc;  // CRC-32 of everything after this field
+  uint64_t seq;
+  uint64_t bucket_count;
+  uint64_t heap_start;
+  uint64_t heap_end;
+  uint64_t live_bytes;
+  uint64_t live_keys;
+  uint64_t used_slots;
+  uint32_t clean;  // 0 while a writer has the file open
+  char reserved[52];
+};
+
+// One of a slot's two versions; the key's bytes are at `offset` in the
+// heap, followed by the value's
+struct StateHashFile::SlotVersion {
+  uint64_t seq;
+  uint64_t hash;
+  uint64_t offset;
+  uint32_t key_size;
+  uint32_t value_size;
+  uint32_t data_crc;  // CRC-32 of the key and value bytes
+  uint8_t state;      // kLive or kTombstone; 0 in a never-written version
+  uint8_t reserved[7];
+  uint32_t crc;  // CRC-32 of the fields above
+};
+
+namespace {
+
+constexpr uint64_t kHeaderSize = 128;
+constexpr uint64_t kVersionSize = 48;
+constexpr uint64_t kSlotSize = 2 * kVersionSize;
+
+uint32_t HeaderCrc(const void* header) {
+  constexpr size_t kCovered = 16;  // magic, version, crc
+  return Crc32(static_cast<const char*>(header) + kCovered, kHeaderSize - kCovered);
+}
+
+uint32_t VersionCrc(const void* version) {
+  return Crc32(version, kVersionSize - 4);
+}
+
+}  // namespace
+
+// ========== Platform Mapping ==========
+
+class StateHashFile::MappedFile {
+public:
+  ~MappedFile() { Unmap(); }
+
+  // Map all of an existing file
+  bool Map(const std::filesystem::path& path) {
+#ifdef _WIN32
+    file_ = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    LARGE_INTEGER current;
+    if (!GetFileSizeEx(file_, &current)) {
+      Unmap();
+      return false;
+    }
+    size_ = static_cast<uint64_t>(current.QuadPart);
+#else
+    fd_ = ::open(path.c_str(), O_RDWR);
+    if (fd_ < 0) {
+      return false;
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+      Unmap();
+      return false;
+    }
+    size_ = static_cast<uint64_t>(st.st_size);
+#endif
+    if (size_ < kHeaderArea || !MapView()) {
+      Unmap();
+      return false;
+    }
+    return true;
+  }
+
+  // Grow the file to `size` bytes and map it again; Data() moves
+  bool Resize(uint64_t size) {
+    UnmapView();
+#ifdef _WIN32
+    LARGE_INTEGER target;
+    target.QuadPart = static_cast<LONGLONG>(size);
+    bool resized = SetFilePointerEx(file_, target, nullptr, FILE_BEGIN) && SetEndOfFile(file_);
+#else
+    bool resized = ::ftruncate(fd_, static_cast<off_t>(size)) == 0;
+#endif
+    if (resized) {
+      size_ = size;
+    }
+    return MapView() && resized;
+  }
+
+  // Write [offset, offset + size) back to the disk and wait for it
+  void Sync(uint64_t offset, uint64_t size) {
+    if (!data_ || size == 0) {
+      return;
+    }
+#ifdef _WIN32
+    FlushViewOfFile(data_ + offset, static_cast<SIZE_T>(size));
+    FlushFileBuffers(file_);
+#else
+    static const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = offset / page * page;
+    ::msync(data_ + start, static_cast<size_t>(offset + size - start), MS_SYNC);
+#endif
+  }
+
+  void Unmap() {
+    UnmapView();
+#ifdef _WIN32
+    if (file_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(file_);
+    }
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    fd_ = -1;
+#endif
+    size_ = 0;
+  }
+
+  char* Data() const { return data_; }
+  uint64_t Size() const { return size_; }
+
+private:
+  bool MapView() {
+#ifdef _WIN32
+    mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if (!mapping_) {
+      return false;
+    }
+    data_ = static_cast<char*>(MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, 0));
+#else
+    void* data = ::mmap(nullptr, static_cast<size_t>(size_), PROT_READ | PROT_WRITE, MAP_SHARED,
+                        fd_, 0);
+    data_ = data == MAP_FAILED ? nullptr : static_cast<char*>(data);
+#endif
+    return data_ != nullptr;
+  }
+
+  void UnmapView() {
+#ifdef _WIN32
+    if (data_) {
+      UnmapViewOfFile(data_);
+    }
+    if (mapping_) {
+      CloseHandle(mapping_);
+    }
+    mapping_ = nullptr;
+#else
+    if (data_) {
+      ::munmap(data_, static_cast<size_t>(size_));
+    }
+#endif
+    data_ = nullptr;
+  }
+
+#ifdef _WIN32
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+  char* data_ = nullptr;
+  uint64_t size_ = 0;
+};
+
+// ========== Lifecycle ==========
+
+StateHashFile::StateHashFile(const std::string& directory)
+    : StateHashFile(directory, Options()) {
+}
+
+StateHashFile::StateHashFile(const std::string& directory, const Options& options)
+    : directory_(directory),
+      options_(options) {
+}
+
+StateHashFile::~StateHashFile() {
+  Close();
+}
+
+bool StateHashFile::Open() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (mapping_) {
+    return true;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::u8path(directory_), ec);
+  if (ec) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to create directory: " + directory_);
+    return false;
+  }
+
+  std::filesystem::path path = FilePath();
+  if (!std::filesystem::exists(path, ec)) {
+    std::filesystem::path temp = path;
+    temp += kTempSuffix;
+    if (!WriteImage(temp, Entries(), options_)) {
+      std::filesystem::remove(temp, ec);
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to create " + path.string());
+      return false;
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+      std::filesystem::remove(temp, ec);
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to create " + path.string());
+      return false;
+    }
+    SyncDirectory(path.parent_path());
+  }
+
+  stats_ = Stats();
+  return MapFile();
+}
+
+void StateHashFile::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!mapping_) {
+    return;
+  }
+  WriteHeader(true);
+  mapping_->Sync(0, mapping_->Size());
+  mapping_.reset();
+}
+
+bool StateHashFile::IsOpen() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return mapping_ != nullptr;
+}
+
+std::filesystem::path StateHashFile::FilePath() const {
+  return std::filesystem::u8path(directory_) / kFileName;
+}
+
+bool StateHashFile::Exists(const std::string& directory) {
+  std::error_code ec;
+  return std::filesystem::exists(std::filesystem::u8path(directory) / kFileName, ec);
+}
+
+bool StateHashFile::Remove(const std::string& directory) {
+  std::error_code ec;
+  std::filesystem::remove(std::filesystem::u8path(directory) / kFileName, ec);
+  return !ec;
+}
+
+bool StateHashFile::Write(const std::string& directory,
+                          const std::map<std::string, std::string>& state,
+                          const Options& options) {
+  std::filesystem::path root = std::filesystem::u8path(directory);
+  std::error_code ec;
+  std::filesystem::create_directories(root, ec);
+
+  Entries entries;
+  entries.reserve(state.size());
+  for (const auto& pair : state) {
+    entries.emplace_back(pair.first, pair.second);
+  }
+
+  std::filesystem::path path = root / kFileName;
+  std::filesystem::path temp = path;
+  temp += kTempSuffix;
+  if (!WriteImage(temp, entries, options)) {
+    std::filesystem::remove(temp, ec);
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to write " + temp.string());
+    return false;
+  }
+  std::filesystem::rename(temp, path, ec);
+  if (ec) {
+    std::filesystem::remove(temp, ec);
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to replace " + path.string());
+    return false;
+  }
+  SyncDirectory(root);
+  return true;
+}
+
+// ========== Reads ==========
+
+bool StateHashFile::Get(const std::string& key, std::string& value) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!mapping_) {
+    return false;
+  }
+  Hit hit;
+  if (!Find(key, HashKey(key), hit, nullptr)) {
+    return false;
+  }
+  SlotVersion version;
+  ReadVersion(hit.slot, hit.version, version);
+  value.assign(ValueOf(version));
+  return true;
+}
+
+bool StateHashFile::Contains(const std::string& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Hit hit;
+  return mapping_ && Find(key, HashKey(key), hit, nullptr);
+}
+
+std::vector<std::string> StateHashFile::GetKeys() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> keys;
+  if (mapping_) {
+    for (const auto& entry : LiveEntries()) {
+      keys.emplace_back(entry.first);
+    }
+  }
+  return keys;
+}
+
+std::map<std::string, std::string> StateHashFile::GetAll() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, std::string> state;
+  if (mapping_) {
+    for (const auto& entry : LiveEntries()) {
+      state.emplace(entry.first, entry.second);
+    }
+  }
+  return state;
+}
+
+StateHashFile::Stats StateHashFile::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.keys = keys_;
+  stats.buckets = static_cast<size_t>(bucket_count_);
+  stats.tombstones = used_slots_ - keys_;
+  stats.file_bytes = mapping_ ? mapping_->Size() : 0;
+  stats.heap_bytes = heap_end_;
+  stats.garbage_bytes = heap_end_ - live_bytes_;
+  return stats;
+}
+
+bool StateHashFile::ReadVersion(uint64_t slot, int version, SlotVersion& out) const {
+  std::memcpy(&out, mapping_->Data() + kHeaderArea + slot * kSlotSize + version * kVersionSize,
+              sizeof(out));
+  uint64_t capacity = mapping_->Size() - heap_start_;
+  uint64_t size = static_cast<uint64_t>(out.key_size) + out.value_size;
+  return (out.state == kLive || out.state == kTombstone) && out.crc == VersionCrc(&out) &&
+         out.offset <= capacity && size <= capacity - out.offset;
+}
+
+int StateHashFile::Newest(uint64_t slot) const {
+  SlotVersion a;
+  SlotVersion b;
+  bool valid_a = ReadVersion(slot, 0, a);
+  bool valid_b = ReadVersion(slot, 1, b);
+  if (valid_a && valid_b) {
+    return a.seq > b.seq ? 0 : 1;
+  }
+  return valid_a ? 0 : valid_b ? 1 : -1;
+}
+
+int StateHashFile::LiveVersion(uint64_t slot, int newest) const {
+  SlotVersion version;
+  ReadVersion(slot, newest, version);
+  if (version.state != kLive) {
+    return -1;
+  }
+  if (DataIntact(version)) {
+    return newest;
+  }
+
+  // The newest bytes never made it to disk: fall back to the previous value
+  SlotVersion previous;
+  int older = 1 - newest;
+  if (ReadVersion(slot, older, previous) && previous.state == kLive &&
+      previous.hash == version.hash && DataIntact(previous)) {
+    return older;
+  }
+  return -1;
+}
+
+bool StateHashFile::DataIntact(const SlotVersion& version) const {
+  return Crc32(mapping_->Data() + heap_start_ + version.offset,
+               static_cast<size_t>(version.key_size) + version.value_size) == version.data_crc;
+}
+
+bool StateHashFile::Matches(const SlotVersion& version, uint64_t hash,
+                            const std::string& key) const {
+  return version.hash == hash && KeyOf(version) == key;
+}
+
+std::string_view StateHashFile::KeyOf(const SlotVersion& version) const {
+  return std::string_view(mapping_->Data() + heap_start_ + version.offset, version.key_size);
+}
+
+std::string_view StateHashFile::ValueOf(const SlotVersion& version) const {
+  return std::string_view(mapping_->Data() + heap_start_ + version.offset + version.key_size,
+                          version.value_size);
+}
+
+bool StateHashFile::Find(const std::string& key, uint64_t hash, Hit& hit,
+                         uint64_t* free_slot) const {
+  bool have_free = false;
+  auto note_free = [&](uint64_t slot) {
+    if (free_slot && !have_free) {
+      *free_slot = slot;
+      have_free = true;
+    }
+  };
+
+  uint64_t mask = bucket_count_ - 1;
+  for (uint64_t i = 0; i < bucket_count_; i++) {
+    uint64_t slot = (hash + i) & mask;
+    int newest = Newest(slot);
+    if (newest < 0) {
+      note_free(slot);
+      return false;
+    }
+    // Both versions of a live entry carry its hash: other keys are skipped
+    // without touching the heap
+    SlotVersion version;
+    ReadVersion(slot, newest, version);
+    if (version.state == kLive && version.hash != hash) {
+      continue;
+    }
+    int live = LiveVersion(slot, newest);
+    if (live < 0) {
+      note_free(slot);
+      continue;
+    }
+    ReadVersion(slot, live, version);
+    if (Matches(version, hash, key)) {
+      hit.slot = slot;
+      hit.version = live;
+      return true;
+    }
+  }
+  return false;
+}
+
+StateHashFile::Entries StateHashFile::LiveEntries() const {
+  Entries entries;
+  entries.reserve(keys_);
+  for (uint64_t slot = 0; slot < bucket_count_; slot++) {
+    int newest = Newest(slot);
+    int live = newest < 0 ? -1 : LiveVersion(slot, newest);
+    if (live >= 0) {
+      SlotVersion version;
+      ReadVersion(slot, live, version);
+      entries.emplace_back(KeyOf(version), ValueOf(version));
+    }
+  }
+  return entries;
+}
+
+// ========== Writes ==========
+
+bool StateHashFile::Put(const std::string& key, const std::string& value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!mapping_ || key.size() > UINT32_MAX || value.size() > UINT32_MAX) {
+    return false;
+  }
+
+  uint64_t hash = HashKey(key);
+  Hit hit;
+  uint64_t slot = 0;
+  bool found = Find(key, hash, hit, &slot);
+  if (!found && Newest(slot) < 0 &&
+      (used_slots_ + 1) * 100 > bucket_count_ * options_.max_load_percent) {
+    // A new slot would pass the load limit: rebuild (grows the table or
+    // just drops tombstones) and probe again
+    if (!Rebuild() && used_slots_ + 1 >= bucket_count_) {
+      return false;
+    }
+    if (!mapping_) {
+      return false;
+    }
+    Find(key, hash, hit, &slot);
+  }
+  if (found) {
+    slot = hit.slot;
+  }
+
+  uint64_t offset = 0;
+  if (!AppendData(key, value, offset)) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to grow " + FilePath().string());
+    return false;
+  }
+
+  // Account for whatever the slot held before
+  int previous = found ? hit.version : Newest(slot);
+  SlotVersion old;
+  if (previous < 0) {
+    used_slots_++;
+    keys_++;
+  } else if (ReadVersion(slot, previous, old) && old.state == kLive) {
+    live_bytes_ -= static_cast<uint64_t>(old.key_size) + old.value_size;
+  } else {
+    keys_++;
+  }
+
+  uint32_t data_crc = Crc32(value.data(), value.size(), Crc32(key.data(), key.size()));
+  WriteVersion(slot, kLive, hash, offset, static_cast<uint32_t>(key.size()),
+               static_cast<uint32_t>(value.size()), data_crc);
+  live_bytes_ += key.size() + value.size();
+  MaybeRebuild();
+  return true;
+}
+
+bool StateHashFile::Erase(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!mapping_) {
+    return false;
+  }
+  uint64_t hash = HashKey(key);
+  Hit hit;
+  if (!Find(key, hash, hit, nullptr)) {
+    return true;
+  }
+  SlotVersion old;
+  ReadVersion(hit.slot, hit.version, old);
+  WriteVersion(hit.slot, kTombstone, hash, 0, 0, 0, Crc32(nullptr, 0));
+  live_bytes_ -= static_cast<uint64_t>(old.key_size) + old.value_size;
+  keys_--;
+  MaybeRebuild();
+  return true;
+}
+
+bool StateHashFile::Replace(const std::map<std::string, std::string>& state) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return mapping_ && Rebuild(&state);
+}
+
+bool StateHashFile::Clear() {
+  return Replace({});
+}
+
+bool StateHashFile::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!mapping_) {
+    return false;
+  }
+  mapping_->Sync(0, mapping_->Size());
+  return true;
+}
+
+void StateHashFile::WriteVersion(uint64_t slot, uint8_t state, uint64_t hash, uint64_t offset,
+                                 uint32_t key_size, uint32_t value_size, uint32_t data_crc) {
+  SlotVersion a;
+  SlotVersion b;
+  bool valid_a = ReadVersion(slot, 0, a);
+  bool valid_b = ReadVersion(slot, 1, b);
+
+  // Overwrite the older version (never the only intact one)
+  int target = !valid_a ? 0 : !valid_b ? 1 : a.seq < b.seq ? 0 : 1;
+
+  SlotVersion version{};
+  version.seq = std::max(valid_a ? a.seq : 0, valid_b ? b.seq : 0) + 1;
+  version.hash = hash;
+  version.offset = offset;
+  version.key_size = key_size;
+  version.value_size = value_size;
+  version.data_crc = data_crc;
+  version.state = state;
+  version.crc = VersionCrc(&version);
+
+  uint64_t position = kHeaderArea + slot * kSlotSize + target * kVersionSize;
+  std::memcpy(mapping_->Data() + position, &version, sizeof(version));
+  if (options_.sync_writes) {
+    mapping_->Sync(position, sizeof(version));
+  }
+}
+
+bool StateHashFile::AppendData(const std::string& key, const std::string& value,
+                               uint64_t& offset) {
+  uint64_t size = key.size() + value.size();
+  uint64_t capacity = mapping_->Size() - heap_start_;
+  if (size > capacity - heap_end_) {
+    uint64_t grown = RoundUp(std::max(std::max(capacity * 2, kMinHeapBytes), heap_end_ + size),
+                             kPageSize);
+    if (!mapping_->Resize(heap_start_ + grown)) {
+      if (!mapping_->Data()) {
+        // Not even the old size could be mapped again: close, so later calls
+        // fail instead of writing through a null view (Open() recovers)
+        ANYWP_LOG_ERROR(kLogComponent, "Lost the mapping of " + FilePath().string());
+        mapping_.reset();
+      }
+      return false;
+    }
+  }
+
+  offset = heap_end_;
+  char* data = mapping_->Data() + heap_start_ + offset;
+  std::memcpy(data, key.data(), key.size());
+  std::memcpy(data + key.size(), value.data(), value.size());
+  heap_end_ += size;
+  if (options_.sync_writes) {
+    mapping_->Sync(heap_start_ + offset, size);
+  }
+  return true;
+}
+
+// ========== Header and Recovery ==========
+
+bool StateHashFile::MapFile() {
+  std::filesystem::path path = FilePath();
+  auto mapping = std::make_unique<MappedFile>();
+  if (!mapping->Map(path)) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to map " + path.string());
+    return false;
+  }
+  mapping_ = std::move(mapping);
+
+  if (!LoadHeader()) {
+    ANYWP_LOG_ERROR(kLogComponent, "Not a valid state hash file: " + path.string());
+    mapping_.reset();
+    return false;
+  }
+
+  // Mark the file in use before anything changes in it
+  WriteHeader(false);
+  mapping_->Sync(0, kHeaderArea);
+  return true;
+}
+
+bool StateHashFile::LoadHeader() {
+  const Header* best = nullptr;
+  for (uint64_t copy = 0; copy < 2; copy++) {
+    const auto* header = reinterpret_cast<const Header*>(mapping_->Data() + copy * kHeaderSize);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 && header->version == kVersion &&
+        header->crc == HeaderCrc(header) && (!best || header->seq > best->seq)) {
+      best = header;
+    }
+  }
+  if (!best) {
+    return false;
+  }
+
+  uint64_t buckets = best->bucket_count;
+  if (buckets < kMinBuckets || (buckets & (buckets - 1)) != 0 ||
+      best->heap_start != kHeaderArea + RoundUp(buckets * kSlotSize, kPageSize) ||
+      best->heap_start > mapping_->Size()) {
+    return false;
+  }
+
+  header_seq_ = best->seq;
+  bucket_count_ = buckets;
+  heap_start_ = best->heap_start;
+  if (best->clean && best->heap_end <= mapping_->Size() - heap_start_ &&
+      best->live_bytes <= best->heap_end && best->live_keys <= best->used_slots &&
+      best->used_slots <= buckets) {
+    heap_end_ = best->heap_end;
+    live_bytes_ = best->live_bytes;
+    keys_ = static_cast<size_t>(best->live_keys);
+    used_slots_ = static_cast<size_t>(best->used_slots);
+  } else {
+    ANYWP_LOG_WARNING(kLogComponent, "Recovering after unclean shutdown: " + FilePath().string());
+    Recount();
+    stats_.recovered = true;
+  }
+  return true;
+}
+
+void StateHashFile::WriteHeader(bool clean) {
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.seq = ++header_seq_;
+  header.bucket_count = bucket_count_;
+  header.heap_start = heap_start_;
+  header.heap_end = heap_end_;
+  header.live_bytes = live_bytes_;
+  header.live_keys = keys_;
+  header.used_slots = used_slots_;
+  header.clean = clean ? 1 : 0;
+  header.crc = HeaderCrc(&header);
+  std::memcpy(mapping_->Data() + (header.seq % 2) * kHeaderSize, &header, sizeof(header));
+}
+
+void StateHashFile::Recount() {
+  heap_end_ = 0;
+  live_bytes_ = 0;
+  keys_ = 0;
+  used_slots_ = 0;
+  for (uint64_t slot = 0; slot < bucket_count_; slot++) {
+    int newest = Newest(slot);
+    if (newest < 0) {
+      continue;
+    }
+    used_slots_++;
+
+    // Anything either version points at is in use: new data goes after it
+    SlotVersion version;
+    for (int v = 0; v < 2; v++) {
+      if (ReadVersion(slot, v, version)) {
+        heap_end_ = std::max(heap_end_, version.offset + version.key_size + version.value_size);
+      }
+    }
+    ReadVersion(slot, newest, version);
+    if (version.state == kLive) {
+      keys_++;
+      live_bytes_ += static_cast<uint64_t>(version.key_size) + version.value_size;
+    }
+  }
+}
+
+// ========== Rebuild ==========
+
+bool StateHashFile::WriteImage(const std::filesystem::path& path, const Entries& entries,
+                               const Options& options) {
+  static_assert(sizeof(Header) == kHeaderSize, "Header copy must stay 128 bytes");
+  static_assert(sizeof(SlotVersion) == kVersionSize, "Slot version must stay 48 bytes");
+
+  uint64_t data_bytes = 0;
+  for (const auto& entry : entries) {
+    data_bytes += entry.first.size() + entry.second.size();
+  }
+  uint64_t buckets = BucketsFor(entries.size(), options);
+  uint64_t heap_start = kHeaderArea + RoundUp(buckets * kSlotSize, kPageSize);
+  uint64_t heap_capacity = RoundUp(std::max(kMinHeapBytes, data_bytes * 2), kPageSize);
+
+  // Zero-filled: empty slots and free heap need no further writes
+  std::string image(static_cast<size_t>(heap_start + heap_capacity), '\0');
+  std::vector<bool> used(static_cast<size_t>(buckets), false);
+  uint64_t heap_end = 0;
+  for (const auto& entry : entries) {
+    uint64_t hash = HashKey(entry.first);
+    uint64_t slot = hash & (buckets - 1);
+    while (used[static_cast<size_t>(slot)]) {
+      slot = (slot + 1) & (buckets - 1);
+    }
+    used[static_cast<size_t>(slot)] = true;
+
+    std::memcpy(&image[static_cast<size_t>(heap_start + heap_end)], entry.first.data(),
+                entry.first.size());
+    std::memcpy(&image[static_cast<size_t>(heap_start + heap_end + entry.first.size())],
+                entry.second.data(), entry.second.size());
+
+    SlotVersion version{};
+    version.seq = 1;
+    version.hash = hash;
+    version.offset = heap_end;
+    version.key_size = static_cast<uint32_t>(entry.first.size());
+    version.value_size = static_cast<uint32_t>(entry.second.size());
+    version.data_crc = Crc32(entry.second.data(), entry.second.size(),
+                             Crc32(entry.first.data(), entry.first.size()));
+    version.state = kLive;
+    version.crc = VersionCrc(&version);
+    std::memcpy(&image[static_cast<size_t>(kHeaderArea + slot * kSlotSize)], &version,
+                sizeof(version));
+    heap_end += entry.first.size() + entry.second.size();
+  }
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.seq = 1;
+  header.bucket_count = buckets;
+  header.heap_start = heap_start;
+  header.heap_end = heap_end;
+  header.live_bytes = heap_end;
+  header.live_keys = entries.size();
+  header.used_slots = entries.size();
+  header.clean = 1;
+  header.crc = HeaderCrc(&header);
+  std::memcpy(&image[kHeaderSize], &header, sizeof(header));  // Copy seq % 2
+
+  std::FILE* file = OpenFile(path, "wb");
+  if (!file) {
+    return false;
+  }
+  bool ok = std::fwrite(image.data(), 1, image.size(), file) == image.size() &&
+            std::fflush(file) == 0 && SyncFile(file);
+  return std::fclose(file) == 0 && ok;
+}
+
+bool StateHashFile::Rebuild(const std::map<std::string, std::string>* replacement) {
+  Entries entries;
+  if (replacement) {
+    entries.reserve(replacement->size());
+    for (const auto& pair : *replacement) {
+      entries.emplace_back(pair.first, pair.second);
+    }
+  } else {
+    entries = LiveEntries();  // Views into the mapping: used before it is closed
+  }
+
+  std::filesystem::path path = FilePath();
+  std::filesystem::path temp = path;
+  temp += kTempSuffix;
+  std::error_code ec;
+  if (!WriteImage(temp, entries, options_)) {
+    std::filesystem::remove(temp, ec);
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to write " + temp.string());
+    return false;
+  }
+
+  // Windows cannot rename over a mapped file: close it first. The old file
+  // stays consistent (dirty flag set) if the rename fails.
+  mapping_.reset();
+  std::filesystem::rename(temp, path, ec);
+  bool renamed = !ec;  // Before the cleanup below reuses ec
+  if (renamed) {
+    SyncDirectory(path.parent_path());
+    stats_.rebuilds++;
+  } else {
+    std::filesystem::remove(temp, ec);
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to replace " + path.string());
+  }
+
+  return MapFile() && renamed;
+}
+
+void StateHashFile::MaybeRebuild() {
+  uint64_t garbage = heap_end_ - live_bytes_;
+  if (garbage >= options_.compact_min_bytes && garbage > live_bytes_) {
+    Rebuild();
+  }
+}
+
+}  // namespace anywp_engine
@@ -0,0 +1,181 @@
+#ifndef ANYWP_ENGINE_STATE_HASH_FILE_H_
+#define ANYWP_ENGINE_STATE_HASH_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace anywp_engine {
+
+/**
+ * StateHashFile - Key-value store in a memory-mapped open-addressing hash file
+ *
+ * One file, `directory`/state.map, mapped read-write:
+ *   header   Two checksummed copies (A/B); the newer valid one wins
+ *   buckets  Power-of-two slot array, linear probing
+ *   heap     Key and value bytes, appended
+ *
+ * Open() validates the header and maps the file; nothing is parsed, so
+ * startup cost does not grow with the store. Get() hashes the key (FNV-1a),
+ * probes the bucket array and reads the value straight out of the mapping.
+ *
+ * Each slot holds two versions of its entry (hash, heap offset, sizes,
+ * data CRC, sequence number), each with its own CRC. A write appends the
+ * bytes to the heap and then overwrites the older version in place, so
+ * the slot always keeps one intact version: a torn write, or a version
+ * whose heap bytes never reached the disk, falls back to the previous
+ * value. Erase() writes a tombstone version.
+ *
+ * The header is rewritten only by Open(), Close() and rebuilds; a dirty
+ * flag set while open tells the next Open() to recount keys and heap use
+ * with one pass over the bucket array (no heap reads) after a crash.
+ *
+ * When the table passes Options::max_load_percent (tombstones included) or
+ * more than half the heap is garbage, a rebuild writes live entries to
+ * state.map.tmp, fsyncs it and renames it over state.map; Replace() uses
+ * the same path, so it is atomic.
+ *
+ * Writes land in the page cache and survive a process crash at once; with
+ * Options::sync_writes each one is also flushed to the disk in order
+ * (heap, then slot) before returning. Flush() does the same for everything
+ * written so far. One process may have the file open at a time.
+ *
+ * Thread-safe: Yes
+ */
+class StateHashFile {
+public:
+  static constexpr const char* kFileName = "state.map";
+
+  struct Options {
+    size_t initial_buckets = 256;           // Rounded up to a power of two
+    size_t max_load_percent = 70;           // Used slots (tombstones included) before a rebuild
+    size_t compact_min_bytes = 256 * 1024;  // Garbage below this is never compacted
+    bool sync_writes = false;               // Flush heap and slot to disk on every write
+  };
+
+  struct Stats {
+    size_t keys = 0;
+    size_t buckets = 0;
+    size_t tombstones = 0;
+    uint64_t file_bytes = 0;
+    uint64_t heap_bytes = 0;     // Appended so far, garbage included
+    uint64_t garbage_bytes = 0;  // Overwritten and erased entries
+    size_t rebuilds = 0;         // Since Open()
+    bool recovered = false;      // Last Open() followed an unclean shutdown
+  };
+
+  explicit StateHashFile(const std::string& directory);
+  StateHashFile(const std::string& directory, const Options& options);
+  ~StateHashFile();
+
+  StateHashFile(const StateHashFile&) = delete;
+  StateHashFile& operator=(const StateHashFile&) = delete;
+
+  // Create the directory and an empty file if needed, then map it
+  bool Open();
+  void Close();
+  bool IsOpen() const;
+
+  bool Get(const std::string& key, std::string& value) const;
+  bool Contains(const std::string& key) const;
+  std::vector<std::string> GetKeys() const;
+  std::map<std::string, std::string> GetAll() const;
+
+  bool Put(const std::string& key, const std::string& value);
+  bool Erase(const std::string& key);
+
+  // Replace everything with `state` (atomic: new file, then rename)
+  bool Replace(const std::map<std::string, std::string>& state);
+  bool Clear();
+
+  // Write dirty pages back and wait for the disk
+  bool Flush();
+
+  Stats GetStats() const;
+  const std::string& GetDirectory() const { return directory_; }
+
+  // Whether `directory` already has a hash file
+  static bool Exists(const std::string& directory);
+  // Delete it (the store must not be open); true if it is gone
+  static bool Remove(const std::string& directory);
+
+  // Write a new file holding `state`, replacing any existing one; for
+  // migrations, before the store is opened
+  static bool Write(const std::string& directory, const std::map<std::string, std::string>& state,
+                    const Options& options);
+
+private:
+  class MappedFile;  // Platform mapping (POSIX mmap / Win32 file mapping)
+  struct Header;
+  struct SlotVersion;
+
+  // Key and value views, for writing a file image
+  using Entries = std::vector<std::pair<std::string_view, std::string_view>>;
+
+  // A located entry: its slot and the version holding the live value
+  struct Hit {
+    uint64_t slot = 0;
+    int version = -1;
+  };
+
+  std::filesystem::path FilePath() const;
+
+  // Write `entries` as a complete, fsynced file at `path`
+  static bool WriteImage(const std::filesystem::path& path, const Entries& entries,
+                         const Options& options);
+
+  // Intact version `version` (0 or 1) of `slot`; false if torn or empty
+  bool ReadVersion(uint64_t slot, int version, SlotVersion& out) const;        // Requires mutex_
+  // Newest intact version of `slot`, or -1 for an empty slot
+  int Newest(uint64_t slot) const;                                             // Requires mutex_
+  // Version holding a live value whose heap bytes are intact: the newest,
+  // else the previous one; -1 for a tombstone or an unreadable entry
+  int LiveVersion(uint64_t slot, int newest) const;                            // Requires mutex_
+  bool DataIntact(const SlotVersion& version) const;                           // Requires mutex_
+  bool Matches(const SlotVersion& version, uint64_t hash, const std::string& key) const;  // Requires mutex_
+  std::string_view KeyOf(const SlotVersion& version) const;                    // Requires mutex_
+  std::string_view ValueOf(const SlotVersion& version) const;                  // Requires mutex_
+
+  // Probe for `key`; `free_slot` gets the first tombstone or empty slot
+  bool Find(const std::string& key, uint64_t hash, Hit& hit, uint64_t* free_slot) const;  // Requires mutex_
+  // Live entries, for GetKeys()/GetAll() and rebuilds
+  Entries LiveEntries() const;                                                 // Requires mutex_
+
+  void WriteVersion(uint64_t slot, uint8_t state, uint64_t hash, uint64_t offset,
+                    uint32_t key_size, uint32_t value_size, uint32_t data_crc);  // Requires mutex_
+  bool AppendData(const std::string& key, const std::string& value, uint64_t& offset);  // Requires mutex_
+
+  bool MapFile();                                                               // Requires mutex_
+  bool LoadHeader();                                                            // Requires mutex_
+  void WriteHeader(bool clean);                                                 // Requires mutex_
+  void Recount();                                                               // Requires mutex_
+
+  // Live entries (or `replacement`) -> fresh file -> rename; remaps the result
+  bool Rebuild(const std::map<std::string, std::string>* replacement = nullptr);  // Requires mutex_
+  void MaybeRebuild();                                                          // Requires mutex_
+
+  const std::string directory_;
+  const Options options_;
+
+  mutable std::mutex mutex_;
+  std::unique_ptr<MappedFile> mapping_;
+  uint64_t header_seq_ = 0;
+  uint64_t bucket_count_ = 0;
+  uint64_t heap_start_ = 0;  // File offset of the heap
+  uint64_t heap_end_ = 0;    // Heap bytes used
+  uint64_t live_bytes_ = 0;  // Heap bytes referenced by live entries
+  size_t used_slots_ = 0;    // Live entries plus tombstones
+  size_t keys_ = 0;
+  Stats stats_;
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_STATE_HASH_FILE_H_
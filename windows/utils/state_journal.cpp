@@ -0,0 +1,989 @@
+#include "state_journal.h"
+#include "config_json.h"
+#include "file_sync.h"
+#include "logger.h"
+
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace anywp_engine {
+
+namespace {
+
+constexpr const char* kLogComponent = "StateJournal";
+constexpr const char* kPreviousJournalName = "state.journal.1";
+constexpr const char* kSnapshotTempName = "state.json.tmp";
+constexpr const char* kCorruptSnapshotName = "state.json.corrupt";
+
+constexpr uint8_t kOpPut = 1;
+constexpr uint8_t kOpErase = 2;
+constexpr size_t kRecordHeaderSize = 13;  // checksum + op + key_size + value_size
+
+uint32_t Crc32(const char* data, size_t size) {
+  static const auto table = [] {
+    std::vector<uint32_t> t(256);
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+void PutLE32(std::string& out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+uint32_t GetLE32(const char* data) {
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; i--) {
+    value = (value << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return value;
+}
+
+bool SeekTo(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+bool ReadWholeFile(const std::filesystem::path& path, std::string& content) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  file.seekg(0, std::ios::end);
+  content.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0, std::ios::beg);
+  file.read(&content[0], static_cast<std::streamsize>(content.size()));
+  return static_cast<bool>(file) || content.empty();
+}
+
+bool LoadSnapshot(const std::filesystem::path& path, std::map<std::string, std::string>& state,
+                  uint64_t& bytes) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return true;  // First run
+  }
+  ConfigJson::Values values;
+  std::string error;
+  if (!ConfigJson::Parse(file, values, &error)) {
+    ANYWP_LOG_ERROR(kLogComponent, "Ignoring unreadable snapshot " + path.string() + ":" + error);
+    return false;
+  }
+  for (const auto& pair : values) {
+    std::string value;
+    if (pair.second.TryGet(value)) {
+      state[pair.first] = std::move(value);
+    }
+  }
+  std::error_code ec;
+  bytes = std::filesystem::file_size(path, ec);
+  return true;
+}
+
+// Calls apply(op, key, value_offset, value_size) for the complete, intact
+// records in `data`; returns the length of that prefix
+template <typename Apply>
+size_t ReplayRecords(const std::string& data, size_t& records, Apply apply) {
+  size_t pos = 0;
+  while (data.size() - pos >= kRecordHeaderSize) {
+    const char* record = data.data() + pos;
+    uint8_t op = static_cast<uint8_t>(record[4]);
+    uint64_t key_size = GetLE32(record + 5);
+    uint64_t value_size = GetLE32(record + 9);
+    uint64_t size = kRecordHeaderSize + key_size + value_size;
+    if (size > data.size() - pos ||
+        Crc32(record + 4, static_cast<size_t>(size - 4)) != GetLE32(record) ||
+        (op != kOpPut && op != kOpErase)) {
+      break;
+    }
+
+    apply(op, std::string(record + kRecordHeaderSize, static_cast<size_t>(key_size)),
+          pos + kRecordHeaderSize + key_size, static_cast<uint32_t>(value_size));
+    records++;
+    pos += static_cast<size_t>(size);
+  }
+  return pos;
+}
+
+// One "key": "value" pair of a snapshot; offset and size cover the value's
+// JSON string literal, quotes included
+struct SnapshotEntry {
+  std::string key;
+  uint64_t offset;
+  uint32_t size;
+};
+
+size_t SkipWhitespace(const std::string& data, size_t pos) {
+  while (pos < data.size() &&
+         (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n' || data[pos] == '\r')) {
+    pos++;
+  }
+  return pos;
+}
+
+// End of the string literal opening at data[pos], or npos
+size_t ScanLiteral(const std::string& data, size_t pos) {
+  if (pos >= data.size() || data[pos] != '"') {
+    return std::string::npos;
+  }
+  for (size_t i = pos + 1; i < data.size(); i++) {
+    if (data[i] == '\\') {
+      i++;
+    } else if (data[i] == '"') {
+      return i + 1;
+    }
+  }
+  return std::string::npos;
+}
+
+bool DecodeLiteral(const char* literal, size_t size, std::string& value) {
+  if (size < 2) {
+    return false;
+  }
+  if (!std::memchr(literal, '\\', size)) {
+    value.assign(literal + 1, size - 2);
+    return true;
+  }
+  return ConfigJson::Unquote(std::string(literal, size), value);
+}
+
+// Locate every pair of a flat object of string values: the layout
+// SnapshotWriter and the pre-journal StatePersistence write. False for
+// anything else (nesting, numbers, ...), which the caller parses in full.
+bool IndexSnapshot(const std::string& data, std::vector<SnapshotEntry>& entries) {
+  size_t pos = SkipWhitespace(data, 0);
+  if (pos >= data.size() || data[pos] != '{') {
+    return false;
+  }
+  pos = SkipWhitespace(data, pos + 1);
+  if (pos < data.size() && data[pos] == '}') {
+    return SkipWhitespace(data, pos + 1) == data.size();
+  }
+
+  while (true) {
+    size_t key_end = ScanLiteral(data, pos);
+    if (key_end == std::string::npos) {
+      return false;
+    }
+    SnapshotEntry entry;
+    if (!DecodeLiteral(data.data() + pos, key_end - pos, entry.key)) {
+      return false;
+    }
+    pos = SkipWhitespace(data, key_end);
+    if (pos >= data.size() || data[pos] != ':') {
+      return false;
+    }
+    pos = SkipWhitespace(data, pos + 1);
+    size_t value_end = ScanLiteral(data, pos);
+    if (value_end == std::string::npos) {
+      return false;
+    }
+    entry.offset = pos;
+    entry.size = static_cast<uint32_t>(value_end - pos);
+    entries.push_back(std::move(entry));
+
+    pos = SkipWhitespace(data, value_end);
+    if (pos >= data.size()) {
+      return false;
+    }
+    if (data[pos] == '}') {
+      return SkipWhitespace(data, pos + 1) == data.size();
+    }
+    if (data[pos] != ',') {
+      return false;
+    }
+    pos = SkipWhitespace(data, pos + 1);
+  }
+}
+
+// Streams "key": "value" lines to state.json.tmp and remembers where each
+// value literal lands, so the index can point into the new snapshot.
+// Nothing visible changes until Commit() renames it over state.json.
+class SnapshotWriter {
+public:
+  explicit SnapshotWriter(const std::filesystem::path& directory)
+      : directory_(directory),
+        file_(OpenFile(directory / kSnapshotTempName, "wb")) {
+    if (!file_) {
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to create snapshot in " + directory.string());
+      ok_ = false;
+    }
+    Write("{\n");
+  }
+
+  ~SnapshotWriter() {
+    if (file_) {
+      std::fclose(file_);
+    }
+    if (!committed_) {
+      std::error_code ec;
+      std::filesystem::remove(directory_ / kSnapshotTempName, ec);
+    }
+  }
+
+  SnapshotWriter(const SnapshotWriter&) = delete;
+  SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+  bool Add(const std::string& key, const std::string& value) {
+    std::string prefix = entries_.empty() ? "  " : ",\n  ";
+    prefix += ConfigJson::Quote(key);
+    prefix += ": ";
+    std::string literal = ConfigJson::Quote(value);
+    entries_.push_back({key, bytes_ + prefix.size(), static_cast<uint32_t>(literal.size())});
+    return Write(prefix) && Write(literal);
+  }
+
+  // Close the object and fsync the temporary file
+  bool Finish() {
+    if (!Write("\n}\n") || std::fflush(file_) != 0 || !SyncFile(file_)) {
+      ok_ = false;
+    }
+    if (file_) {
+      ok_ = std::fclose(file_) == 0 && ok_;
+      file_ = nullptr;
+    }
+    return ok_;
+  }
+
+  bool Commit() {
+    std::error_code ec;
+    if (ok_) {
+      std::filesystem::rename(directory_ / kSnapshotTempName,
+                              directory_ / StateJournal::kSnapshotName, ec);
+    }
+    if (!ok_ || ec) {
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to write snapshot in " + directory_.string());
+      return false;
+    }
+    committed_ = true;
+    SyncDirectory(directory_);
+    return true;
+  }
+
+  uint64_t Bytes() const { return bytes_; }
+  const std::vector<SnapshotEntry>& Entries() const { return entries_; }
+
+private:
+  bool Write(const std::string& text) {
+    if (ok_ && std::fwrite(text.data(), 1, text.size(), file_) != text.size()) {
+      ok_ = false;
+    }
+    bytes_ += text.size();
+    return ok_;
+  }
+
+  const std::filesystem::path directory_;
+  std::FILE* file_;
+  bool ok_ = true;
+  bool committed_ = false;
+  uint64_t bytes_ = 0;
+  std::vector<SnapshotEntry> entries_;
+};
+
+}  // namespace
+
+// Read handles on the snapshot and journals, opened on first use and closed
+// together (Windows cannot rename over a file that is still open)
+class StateJournal::ValueReader {
+public:
+  explicit ValueReader(const StateJournal& journal) : journal_(journal) {}
+
+  ~ValueReader() {
+    for (std::FILE* file : files_) {
+      if (file) {
+        std::fclose(file);
+      }
+    }
+  }
+
+  ValueReader(const ValueReader&) = delete;
+  ValueReader& operator=(const ValueReader&) = delete;
+
+  std::FILE* Get(FileId file) {
+    if (!files_[file]) {
+      files_[file] = OpenFile(journal_.PathOf(file), "rb");
+    }
+    return files_[file];
+  }
+
+private:
+  const StateJournal& journal_;
+  std::FILE* files_[kInMemory] = {};
+};
+
+StateJournal::StateJournal(const std::string& directory)
+    : StateJournal(directory, Options()) {
+}
+
+StateJournal::StateJournal(const std::string& directory, const Options& options)
+    : directory_(directory),
+      options_(options) {
+}
+
+StateJournal::~StateJournal() {
+  Close();
+}
+
+std::filesystem::path StateJournal::PathOf(const char* name) const {
+  return std::filesystem::u8path(directory_) / name;
+}
+
+std::filesystem::path StateJournal::PathOf(FileId file) const {
+  switch (file) {
+    case kInSnapshot:        return PathOf(kSnapshotName);
+    case kInPreviousJournal: return PathOf(kPreviousJournalName);
+    default:                 return PathOf(kJournalName);
+  }
+}
+
+bool StateJournal::Open() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (journal_) {
+    return true;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::u8path(directory_), ec);
+  if (ec) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to create directory: " + directory_);
+    return false;
+  }
+
+  stats_ = Stats();
+  pending_.clear();
+  pending_values_.clear();
+  bool has_previous = false;
+  if (!LoadIndex(has_previous) || !OpenJournal(false)) {
+    index_.clear();
+    return false;
+  }
+  if (has_previous) {
+    FoldJournals();
+  }
+
+  ANYWP_LOG_DEBUG(kLogComponent, "Opened " + directory_ + ": " + std::to_string(index_.size()) +
+                  " keys, " + std::to_string(stats_.replayed_records) + " journal records replayed");
+  return true;
+}
+
+void StateJournal::Close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stopping_ = true;
+  lock.unlock();
+  worker_cv_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+
+  lock.lock();
+  if (journal_) {
+    if (!FlushPending(true)) {
+      ANYWP_LOG_ERROR(kLogComponent, std::to_string(pending_.size()) +
+                      " pending writes lost on close of " + directory_);
+    }
+    std::fclose(journal_);
+    journal_ = nullptr;
+  }
+  index_.clear();
+  pending_.clear();
+  pending_values_.clear();
+  flush_scheduled_ = false;
+  compaction_requested_ = false;
+  stopping_ = false;
+}
+
+bool StateJournal::IsOpen() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return journal_ != nullptr;
+}
+
+bool StateJournal::Get(const std::string& key, std::string& value) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+  ValueReader reader(*this);
+  return ReadValue(reader, key, it->second, value);
+}
+
+bool StateJournal::Contains(const std::string& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.find(key) != index_.end();
+}
+
+std::map<std::string, std::string> StateJournal::GetAll() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, std::string> state;
+  ValueReader reader(*this);
+  for (const auto& entry : index_) {
+    std::string value;
+    if (ReadValue(reader, entry.first, entry.second, value)) {
+      state.emplace_hint(state.end(), entry.first, std::move(value));
+    }
+  }
+  return state;
+}
+
+bool StateJournal::Put(const std::string& key, const std::string& value,
+                       Durability durability) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!journal_) {
+    return false;
+  }
+  if (durability == Durability::SYNC) {
+    Location location;
+    if (!Append(kOpPut, key, value, &location) || !CommitJournal(options_.sync_appends)) {
+      return false;
+    }
+    index_[key] = location;
+    pending_.erase(key);  // The record just written is the latest value
+    pending_values_.erase(key);
+  } else {
+    index_[key] = Location();
+    pending_values_[key] = value;
+    MarkPending(key, durability);
+  }
+  MaybeCompact(lock);
+  return true;
+}
+
+bool StateJournal::Erase(const std::string& key, Durability durability) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!journal_) {
+    return false;
+  }
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return true;
+  }
+  if (durability == Durability::SYNC) {
+    if (!Append(kOpErase, key, std::string()) || !CommitJournal(options_.sync_appends)) {
+      return false;
+    }
+    pending_.erase(key);
+  } else {
+    MarkPending(key, durability);
+  }
+  index_.erase(it);
+  pending_values_.erase(key);
+  MaybeCompact(lock);
+  return true;
+}
+
+bool StateJournal::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!journal_) {
+    return false;
+  }
+  bool ok = FlushPending(true);
+  MaybeCompact(lock);
+  return ok;
+}
+
+bool StateJournal::Replace(const std::map<std::string, std::string>& state) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  worker_cv_.wait(lock, [this] { return !compacting_; });
+  if (!journal_) {
+    return false;
+  }
+  return FoldJournals(&state);
+}
+
+bool StateJournal::Clear() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  worker_cv_.wait(lock, [this] { return !compacting_; });
+  if (!journal_) {
+    return false;
+  }
+
+  std::fclose(journal_);
+  journal_ = nullptr;
+  index_.clear();
+  pending_.clear();
+  pending_values_.clear();
+  flush_scheduled_ = false;
+  std::error_code ec;
+  bool removed = true;
+  for (const char* name : {kSnapshotName, kPreviousJournalName, kJournalName}) {
+    std::filesystem::remove(PathOf(name), ec);
+    removed = removed && !ec;
+  }
+  stats_.snapshot_bytes = 0;
+  compaction_requested_ = false;
+  return OpenJournal(true) && removed;
+}
+
+bool StateJournal::Compact() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  worker_cv_.wait(lock, [this] { return !compacting_; });
+  if (!journal_) {
+    return false;
+  }
+  compaction_requested_ = false;
+  return RunCompaction(lock);
+}
+
+void StateJournal::WaitForCompaction() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  worker_cv_.wait(lock, [this] {
+    return stopping_ || (!compacting_ && !compaction_requested_);
+  });
+}
+
+StateJournal::Stats StateJournal::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.keys = index_.size();
+  stats.pending_keys = pending_.size();
+  for (const auto& pair : pending_values_) {
+    stats.pending_bytes += pair.second.size();
+  }
+  return stats;
+}
+
+bool StateJournal::Read(const std::string& directory, std::map<std::string, std::string>& state) {
+  std::filesystem::path root = std::filesystem::u8path(directory);
+  uint64_t bytes = 0;
+  if (!LoadSnapshot(root / kSnapshotName, state, bytes)) {
+    return false;
+  }
+  size_t records = 0;
+  for (const char* name : {kPreviousJournalName, kJournalName}) {
+    std::string data;
+    if (!ReadWholeFile(root / name, data)) {
+      continue;
+    }
+    ReplayRecords(data, records, [&](uint8_t op, std::string key, uint64_t offset, uint32_t size) {
+      if (op == kOpPut) {
+        state[std::move(key)].assign(data.data() + offset, size);
+      } else {
+        state.erase(key);
+      }
+    });
+  }
+  return true;
+}
+
+bool StateJournal::Exists(const std::string& directory) {
+  std::filesystem::path root = std::filesystem::u8path(directory);
+  std::error_code ec;
+  for (const char* name : {kSnapshotName, kPreviousJournalName, kJournalName}) {
+    if (std::filesystem::exists(root / name, ec)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool StateJournal::Remove(const std::string& directory) {
+  std::filesystem::path root = std::filesystem::u8path(directory);
+  bool removed = true;
+  for (const char* name : {kSnapshotName, kPreviousJournalName, kJournalName}) {
+    std::error_code ec;
+    std::filesystem::remove(root / name, ec);
+    removed = removed && !ec;
+  }
+  return removed;
+}
+
+bool StateJournal::ReadValue(ValueReader& reader, const std::string& key,
+                             const Location& location, std::string& value) const {
+  if (location.file == kInMemory) {
+    auto it = pending_values_.find(key);
+    if (it == pending_values_.end()) {
+      return false;
+    }
+    value = it->second;
+    return true;
+  }
+
+  std::FILE* file = reader.Get(location.file);
+  std::string raw(location.size, '\0');
+  bool ok = file && SeekTo(file, location.offset) &&
+            std::fread(&raw[0], 1, raw.size(), file) == raw.size();
+  if (ok && location.quoted) {
+    ok = DecodeLiteral(raw.data(), raw.size(), value);
+  } else if (ok) {
+    value = std::move(raw);
+  }
+  if (!ok) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to read the value of '" + key + "' in " + directory_);
+  }
+  return ok;
+}
+
+bool StateJournal::LoadIndex(bool& has_previous) {
+  index_.clear();
+  std::string data;
+  if (ReadWholeFile(PathOf(kInSnapshot), data)) {
+    std::vector<SnapshotEntry> entries;
+    uint64_t snapshot_bytes = data.size();
+    if (!IndexSnapshot(data, entries)) {
+      // Not our layout (edited by hand?): parse it in full and rewrite it
+      std::map<std::string, std::string> state;
+      uint64_t bytes = 0;
+      entries.clear();
+      if (LoadSnapshot(PathOf(kInSnapshot), state, bytes)) {
+        SnapshotWriter writer(std::filesystem::u8path(directory_));
+        for (const auto& pair : state) {
+          writer.Add(pair.first, pair.second);
+        }
+        if (!writer.Finish() || !writer.Commit()) {
+          return false;
+        }
+        entries = writer.Entries();
+        snapshot_bytes = writer.Bytes();
+      } else {
+        // Unreadable: keep it for inspection instead of letting the next
+        // compaction replace it with the journal alone
+        std::error_code ec;
+        std::filesystem::rename(PathOf(kInSnapshot), PathOf(kCorruptSnapshotName), ec);
+        if (ec) {
+          ANYWP_LOG_ERROR(kLogComponent, "Failed to set aside unreadable snapshot in " + directory_);
+          return false;
+        }
+        ANYWP_LOG_WARNING(kLogComponent, "Moved unreadable snapshot to " +
+                          std::string(kCorruptSnapshotName) + " in " + directory_);
+        snapshot_bytes = 0;
+      }
+    }
+    for (auto& entry : entries) {
+      index_[std::move(entry.key)] = Location{kInSnapshot, true, entry.offset, entry.size};
+    }
+    stats_.snapshot_bytes = snapshot_bytes;
+  }
+
+  for (FileId file : {kInPreviousJournal, kInJournal}) {
+    data.clear();
+    if (!ReadWholeFile(PathOf(file), data)) {
+      continue;
+    }
+    has_previous = has_previous || file == kInPreviousJournal;
+    size_t valid = ReplayRecords(data, stats_.replayed_records,
+        [&](uint8_t op, std::string key, uint64_t offset, uint32_t size) {
+          if (op == kOpPut) {
+            index_[std::move(key)] = Location{file, false, offset, size};
+          } else {
+            index_.erase(key);
+          }
+        });
+    // A torn tail in the previous journal is harmless: Open() folds it into
+    // a snapshot and deletes it
+    if (file == kInJournal && valid < data.size()) {
+      std::error_code ec;
+      stats_.discarded_bytes = data.size() - valid;
+      std::filesystem::resize_file(PathOf(kJournalName), valid, ec);
+      if (ec) {
+        ANYWP_LOG_ERROR(kLogComponent, "Failed to truncate torn journal in " + directory_);
+        return false;
+      }
+      ANYWP_LOG_WARNING(kLogComponent, "Discarded " + std::to_string(stats_.discarded_bytes) +
+                        " bytes of torn journal in " + directory_);
+    }
+  }
+  return true;
+}
+
+bool StateJournal::Append(uint8_t op, const std::string& key, const std::string& value,
+                          Location* location) {
+  if (!journal_) {
+    return false;
+  }
+
+  record_.clear();
+  record_.reserve(kRecordHeaderSize + key.size() + value.size());
+  record_.append(4, '\0');  // Checksum, filled in below
+  record_.push_back(static_cast<char>(op));
+  PutLE32(record_, static_cast<uint32_t>(key.size()));
+  PutLE32(record_, static_cast<uint32_t>(value.size()));
+  record_ += key;
+  record_ += value;
+  uint32_t checksum = Crc32(record_.data() + 4, record_.size() - 4);
+  for (int i = 0; i < 4; i++) {
+    record_[i] = static_cast<char>((checksum >> (8 * i)) & 0xFF);
+  }
+
+  if (std::fwrite(record_.data(), 1, record_.size(), journal_) != record_.size()) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to append to journal in " + directory_);
+    RewindJournal();
+    return false;
+  }
+  if (location) {
+    *location = Location{kInJournal, false, stats_.journal_bytes + kRecordHeaderSize + key.size(),
+                         static_cast<uint32_t>(value.size())};
+  }
+  stats_.journal_bytes += record_.size();
+  stats_.written_bytes += record_.size();
+  return true;
+}
+
+bool StateJournal::CommitJournal(bool sync) {
+  if (!journal_) {
+    return false;
+  }
+  if (std::fflush(journal_) != 0 || (sync && !SyncFile(journal_))) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to flush journal in " + directory_);
+    RewindJournal();
+    return false;
+  }
+  committed_bytes_ = stats_.journal_bytes;
+  return true;
+}
+
+void StateJournal::RewindJournal() {
+  // Reopen: after a failed write the stream's buffer and position are unknown
+  std::fclose(journal_);
+  journal_ = nullptr;
+  std::error_code ec;
+  std::filesystem::resize_file(PathOf(kJournalName), committed_bytes_, ec);
+  if (ec) {
+    // Records appended after a partial one would be lost on replay: stop
+    // writing until the journal is opened again
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to truncate journal in " + directory_);
+    return;
+  }
+  OpenJournal(false);
+}
+
+bool StateJournal::FlushPending(bool sync) {
+  if (!journal_) {
+    return false;
+  }
+  // Keys stay pending (and in memory) until their records are committed; a
+  // retry after a partial failure only repeats records, which replay
+  // idempotently
+  std::vector<std::pair<Location*, Location>> written;
+  bool ok = true;
+  for (const std::string& key : pending_) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      ok = Append(kOpErase, key, std::string());
+    } else {
+      Location location;
+      ok = Append(kOpPut, key, pending_values_[key], &location);
+      written.emplace_back(&it->second, location);
+    }
+    if (!ok) {
+      break;
+    }
+  }
+  if (!ok || ((!pending_.empty() || sync) && !CommitJournal(sync))) {
+    return false;
+  }
+  for (const auto& entry : written) {
+    *entry.first = entry.second;
+  }
+  if (!pending_.empty()) {
+    pending_.clear();
+    pending_values_.clear();
+    stats_.flushes++;
+  }
+  flush_scheduled_ = false;
+  return true;
+}
+
+void StateJournal::MarkPending(const std::string& key, Durability durability) {
+  pending_.insert(key);
+  if (durability != Durability::ASYNC || flush_scheduled_) {
+    return;  // An earlier write already set the deadline
+  }
+  flush_scheduled_ = true;
+  flush_due_ = std::chrono::steady_clock::now() + options_.flush_window;
+  StartWorker();
+  worker_cv_.notify_all();
+}
+
+bool StateJournal::OpenJournal(bool truncate) {
+  journal_ = OpenFile(PathOf(kJournalName), truncate ? "wb" : "ab");
+  if (!journal_) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to open journal in " + directory_);
+    return false;
+  }
+  // Records are appended at the end; their locations are computed from this
+  std::error_code ec;
+  stats_.journal_bytes = truncate ? 0 : std::filesystem::file_size(PathOf(kJournalName), ec);
+  committed_bytes_ = stats_.journal_bytes;
+  return true;
+}
+
+void StateJournal::MaybeCompact(std::unique_lock<std::mutex>& lock) {
+  if (compacting_ || compaction_requested_ ||
+      stats_.journal_bytes < options_.compact_min_bytes ||
+      stats_.journal_bytes <= options_.compact_ratio * stats_.snapshot_bytes) {
+    return;
+  }
+  if (!options_.background_compaction) {
+    RunCompaction(lock);
+    return;
+  }
+  compaction_requested_ = true;
+  StartWorker();
+  worker_cv_.notify_all();
+}
+
+bool StateJournal::FoldJournals(const std::map<std::string, std::string>* replacement) {
+  SnapshotWriter writer(std::filesystem::u8path(directory_));
+  bool ok = true;
+  if (replacement) {
+    for (auto it = replacement->begin(); ok && it != replacement->end(); ++it) {
+      ok = writer.Add(it->first, it->second);
+    }
+  } else {
+    ValueReader reader(*this);  // Closed before the rename below
+    std::string value;
+    for (auto it = index_.begin(); ok && it != index_.end(); ++it) {
+      ok = ReadValue(reader, it->first, it->second, value) && writer.Add(it->first, value);
+    }
+  }
+  if (!ok || !writer.Finish() || !writer.Commit()) {
+    return false;
+  }
+
+  index_.clear();
+  for (const auto& entry : writer.Entries()) {
+    index_.emplace_hint(index_.end(), entry.key,
+                        Location{kInSnapshot, true, entry.offset, entry.size});
+  }
+  pending_.clear();  // The snapshot holds their values
+  pending_values_.clear();
+  flush_scheduled_ = false;
+
+  std::error_code ec;
+  std::filesystem::remove(PathOf(kPreviousJournalName), ec);
+  if (journal_) {
+    std::fclose(journal_);
+    journal_ = nullptr;
+  }
+  stats_.snapshot_bytes = writer.Bytes();
+  stats_.written_bytes += writer.Bytes();
+  stats_.compactions++;
+  return OpenJournal(true);
+}
+
+bool StateJournal::RunCompaction(std::unique_lock<std::mutex>& lock) {
+  std::error_code ec;
+  if (std::filesystem::exists(PathOf(kPreviousJournalName), ec)) {
+    // A failed compaction left it; renaming over it would lose its records
+    return FoldJournals();
+  }
+
+  // Pending writes go to the journal being retired so the snapshot and the
+  // journals agree; writes continue in a fresh journal while it is written
+  FlushPending(false);
+  if (!journal_) {
+    return false;  // Lost by a failed flush
+  }
+  std::fclose(journal_);
+  journal_ = nullptr;
+  std::filesystem::rename(PathOf(kJournalName), PathOf(kPreviousJournalName), ec);
+  if (ec) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to rotate journal in " + directory_);
+    OpenJournal(false);
+    return false;
+  }
+  for (auto& entry : index_) {
+    if (entry.second.file == kInJournal) {
+      entry.second.file = kInPreviousJournal;
+    }
+  }
+  if (!OpenJournal(true)) {
+    return false;
+  }
+  compacting_ = true;
+  // Unlocked, only the snapshot and state.journal.1 are read, and neither
+  // changes until the new snapshot is committed under the lock
+  std::vector<std::pair<std::string, Location>> entries(index_.begin(), index_.end());
+  std::map<std::string, std::string> unflushed = pending_values_;  // If the flush failed
+
+  lock.unlock();
+  SnapshotWriter writer(std::filesystem::u8path(directory_));
+  bool ok = true;
+  {
+    ValueReader reader(*this);
+    std::string value;
+    for (auto it = entries.begin(); ok && it != entries.end(); ++it) {
+      if (it->second.file == kInMemory) {
+        value = unflushed[it->first];
+      } else {
+        ok = ReadValue(reader, it->first, it->second, value);
+      }
+      ok = ok && writer.Add(it->first, value);
+    }
+  }
+  ok = ok && writer.Finish();
+  lock.lock();
+
+  // Commit and repoint the index together: a Get() in between would read
+  // old offsets from the new file. Keys written meanwhile point elsewhere.
+  ok = ok && writer.Commit();
+  if (ok) {
+    for (const auto& entry : writer.Entries()) {
+      auto it = index_.find(entry.key);
+      if (it != index_.end() &&
+          (it->second.file == kInSnapshot || it->second.file == kInPreviousJournal)) {
+        it->second = Location{kInSnapshot, true, entry.offset, entry.size};
+      }
+    }
+    std::filesystem::remove(PathOf(kPreviousJournalName), ec);
+    stats_.snapshot_bytes = writer.Bytes();
+    stats_.written_bytes += writer.Bytes();
+    stats_.compactions++;
+  }
+
+  compacting_ = false;
+  worker_cv_.notify_all();
+  return ok;
+}
+
+void StateJournal::StartWorker() {
+  if (!worker_.joinable()) {
+    worker_ = std::thread(&StateJournal::WorkerLoop, this);
+  }
+}
+
+void StateJournal::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (compaction_requested_) {
+      compaction_requested_ = false;
+      if (journal_) {
+        RunCompaction(lock);
+      }
+      worker_cv_.notify_all();
+    } else if (flush_scheduled_ && std::chrono::steady_clock::now() >= flush_due_) {
+      flush_scheduled_ = false;
+      if (journal_ && !FlushPending(false)) {
+        // Retry after another window rather than spinning on a failing disk
+        flush_scheduled_ = true;
+        flush_due_ = std::chrono::steady_clock::now() + options_.flush_window;
+      }
+      MaybeCompact(lock);
+    } else if (flush_scheduled_) {
+      worker_cv_.wait_until(lock, flush_due_);
+    } else {
+      worker_cv_.wait(lock);
+    }
+  }
+}
+
+}  // namespace anywp_engine
@@ -0,0 +1,219 @@
+#ifndef ANYWP_ENGINE_STATE_JOURNAL_H_
+#define ANYWP_ENGINE_STATE_JOURNAL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace anywp_engine {
+
+/**
+ * StateJournal - Key-value store persisted as a snapshot plus a journal
+ *
+ * Files in `directory`:
+ *   state.json       Snapshot: one JSON object of string values
+ *   state.journal    Records appended since the snapshot
+ *   state.journal.1  Previous journal while a compaction is running
+ *
+ * Only an index of where each key's latest value lives is kept in memory;
+ * Get() reads the value from the snapshot or journal on demand, so large
+ * values cost disk, not RAM (put a StateCache in front for hot keys).
+ *
+ * Put() and Erase() append one record, so a write costs the size of the
+ * entry, not of the store. Once the journal outgrows the snapshot (see
+ * Options), a background compaction writes a new snapshot: the live journal
+ * is renamed to state.journal.1 and writes continue in a fresh one, the map
+ * is written to state.json.tmp, fsynced and renamed over state.json, and
+ * only then is state.journal.1 deleted.
+ *
+ * Record layout (little-endian):
+ *   checksum   uint32  CRC-32 of the rest of the record
+ *   op         uint8   1 = put, 2 = erase
+ *   key_size   uint32
+ *   value_size uint32
+ *   key, value bytes
+ *
+ * Open() loads the snapshot and replays state.journal.1 then state.journal.
+ * Replay stops at the first torn or corrupt record (a crash mid-append) and
+ * the journal is truncated there. A snapshot that does not parse is renamed
+ * to state.json.corrupt rather than overwritten by the next compaction. A
+ * failed append or flush truncates the journal back to its last committed
+ * length, so no partial record is left for later records to follow.
+ *
+ * Each write picks its durability:
+ *   SYNC    appended before returning; survives a process crash (and power
+ *           loss too with Options::sync_appends)
+ *   ASYNC   in memory now; a background flush appends it within
+ *           Options::flush_window. Repeated writes to a key in the window
+ *           coalesce into one record.
+ *   MEMORY  in memory only until the next Flush(), flush or compaction
+ * Pending values are held in memory until flushed. Reads always see the
+ * latest write. Flush() appends everything pending and fsyncs; Close()
+ * flushes first.
+ *
+ * Thread-safe: Yes
+ */
+class StateJournal {
+public:
+  static constexpr const char* kSnapshotName = "state.json";
+  static constexpr const char* kJournalName = "state.journal";
+
+  enum class Durability {
+    MEMORY,
+    ASYNC,
+    SYNC
+  };
+
+  struct Options {
+    size_t compact_min_bytes = 256 * 1024;  // Journals smaller than this are never compacted
+    size_t compact_ratio = 2;               // Compact once journal > ratio x snapshot size
+    bool background_compaction = true;      // false: compact inline in Put()/Erase()
+    bool sync_appends = false;              // fsync every SYNC record
+    std::chrono::milliseconds flush_window{50};  // ASYNC writes wait at most this long
+  };
+
+  struct Stats {
+    size_t keys = 0;
+    uint64_t journal_bytes = 0;
+    uint64_t snapshot_bytes = 0;
+    size_t replayed_records = 0;   // By the last Open()
+    uint64_t discarded_bytes = 0;  // Torn tail dropped by the last Open()
+    size_t compactions = 0;
+    uint64_t written_bytes = 0;    // Records and snapshots written since Open()
+    size_t pending_keys = 0;       // ASYNC/MEMORY writes not yet in the journal
+    uint64_t pending_bytes = 0;    // Values held in memory for those writes
+    size_t flushes = 0;            // Batches of pending writes appended
+  };
+
+  explicit StateJournal(const std::string& directory);
+  StateJournal(const std::string& directory, const Options& options);
+  ~StateJournal();
+
+  StateJournal(const StateJournal&) = delete;
+  StateJournal& operator=(const StateJournal&) = delete;
+
+  // Create the directory if needed, load the snapshot and replay the journal
+  bool Open();
+  void Close();
+  bool IsOpen() const;
+
+  // Reads from disk unless the key has a pending write
+  bool Get(const std::string& key, std::string& value) const;
+  bool Contains(const std::string& key) const;
+  std::map<std::string, std::string> GetAll() const;
+
+  // False only if a SYNC write could not be appended (nothing changes then)
+  bool Put(const std::string& key, const std::string& value,
+           Durability durability = Durability::SYNC);
+  bool Erase(const std::string& key, Durability durability = Durability::SYNC);
+
+  // Append every pending write and fsync the journal
+  bool Flush();
+
+  // Replace everything with `state`: new snapshot, empty journal
+  bool Replace(const std::map<std::string, std::string>& state);
+
+  // Forget everything and delete the files
+  bool Clear();
+
+  // Snapshot now and wait for it
+  bool Compact();
+
+  // Block until a running background compaction has finished
+  void WaitForCompaction();
+
+  Stats GetStats() const;
+  const std::string& GetDirectory() const { return directory_; }
+
+  // Load a store without opening it for writing (nothing is truncated or
+  // compacted, so it is safe while another StateJournal has it open)
+  static bool Read(const std::string& directory, std::map<std::string, std::string>& state);
+
+  // Whether `directory` holds a snapshot or journal; delete them (the store
+  // must not be open), true if they are gone
+  static bool Exists(const std::string& directory);
+  static bool Remove(const std::string& directory);
+
+private:
+  enum FileId : uint8_t {
+    kInSnapshot,
+    kInPreviousJournal,
+    kInJournal,
+    kInMemory  // Pending write: the value is in pending_values_
+  };
+
+  // Where a key's latest value is
+  struct Location {
+    FileId file = kInMemory;
+    bool quoted = false;  // JSON string literal (snapshot) rather than raw bytes
+    uint64_t offset = 0;
+    uint32_t size = 0;
+  };
+
+  // Open read handles on the files a Location can point into
+  class ValueReader;
+
+  std::filesystem::path PathOf(const char* name) const;
+  std::filesystem::path PathOf(FileId file) const;
+
+  bool ReadValue(ValueReader& reader, const std::string& key, const Location& location,
+                 std::string& value) const;                                     // Requires mutex_
+
+  // Index the snapshot, then replay the journals into the index
+  bool LoadIndex(bool& has_previous);                                           // Requires mutex_
+
+  // Buffered; CommitJournal() hands the records to the OS. `location` gets
+  // where the value was written.
+  bool Append(uint8_t op, const std::string& key, const std::string& value,
+              Location* location = nullptr);                                    // Requires mutex_
+  bool CommitJournal(bool sync);                                                // Requires mutex_
+  // Drop whatever a failed append/commit left past committed_bytes_
+  void RewindJournal();                                                         // Requires mutex_
+
+  // Append the current value (or an erase) of every pending key
+  bool FlushPending(bool sync);                                                 // Requires mutex_
+  void MarkPending(const std::string& key, Durability durability);             // Requires mutex_
+  bool OpenJournal(bool truncate);                                              // Requires mutex_
+  void MaybeCompact(std::unique_lock<std::mutex>& lock);
+
+  // Snapshot the current state (or `replacement`) and start an empty
+  // journal; with the lock held throughout
+  bool FoldJournals(const std::map<std::string, std::string>* replacement = nullptr);  // Requires mutex_
+
+  // Rotate the journal and snapshot a copy of the map; `lock` is released
+  // while the snapshot is written
+  bool RunCompaction(std::unique_lock<std::mutex>& lock);
+  void StartWorker();                                                           // Requires mutex_
+  void WorkerLoop();
+
+  const std::string directory_;
+  const Options options_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable worker_cv_;
+  std::map<std::string, Location> index_;  // Every live key
+  std::FILE* journal_ = nullptr;
+  uint64_t committed_bytes_ = 0;  // Journal length as of the last successful commit
+  std::string record_;  // Reused encode buffer
+  Stats stats_;
+  std::set<std::string> pending_;  // Keys written ASYNC/MEMORY since the last flush
+  std::map<std::string, std::string> pending_values_;  // Values of kInMemory keys
+  bool flush_scheduled_ = false;
+  std::chrono::steady_clock::time_point flush_due_;
+  bool compaction_requested_ = false;
+  bool compacting_ = false;
+  bool stopping_ = false;
+  std::thread worker_;  // Background flushes and compactions
+};
+
+}  // namespace anywp_engine
+
+#endif  // ANYWP_ENGINE_STATE_JOURNAL_H_
@@ -1,7 +1,8 @@
 #include "state_persistence.h"
+#include "json_reader.h"
 #include "logger.h"  // v1.4.1+ Phase B: Use Logger instead of std::cout
+#include "log_payload.h"
 
-#include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
@@ -14,6 +15,33 @@
 
 namespace anywp_engine {
 
+namespace {
+
+constexpr const char* kLogComponent = "StatePersistence";
+
+// State keys are short identifiers; values are logged as a digest only
+constexpr size_t kKeyPreview = 64;
+
+// Reserved key marking stores whose page-saved values are stored decoded.
+// Older stores kept the JSON string body the page sent, escapes intact,
+// and loadState decoded whatever parsed as one.
+constexpr const char* kFormatKey = "__anywp.state_format";
+constexpr const char* kFormatVersion = "2";
+
+// One-time upgrade of a store without kFormatKey: decode every value that
+// is a JSON string body, as loadState used to on each read, and tag it
+void UpgradeFormat(std::map<std::string, std::string>& state) {
+  std::string decoded;
+  for (auto& pair : state) {
+    if (JsonReader::Unescape(pair.second, decoded)) {
+      pair.second.swap(decoded);
+    }
+  }
+  state[kFormatKey] = kFormatVersion;
+}
+
+}  // namespace
+
 StatePersistence::StatePersistence() 
     : application_name_("Default") {
 }
@@ -26,12 +54,6 @@ StatePersistence::~StatePersistence() {
 void StatePersistence::SetApplicationName(const std::string& name) {
   std::lock_guard<std::mutex> lock(mutex_);
   
-  if (name.empty()) {
-    std::cout << "[AnyWP] [State] WARNING: Empty application name, using 'Default'" << std::endl;
-    application_name_ = "Default";
-    return;
-  }
-  
   // Sanitize application name (remove invalid filename characters)
   std::string sanitized_name;
   for (char c : name) {
@@ -43,20 +65,25 @@ void StatePersistence::SetApplicationName(const std::string& name) {
   }
   
   if (sanitized_name.empty()) {
-    std::cout << "[AnyWP] [State] WARNING: Invalid application name, using 'Default'" << std::endl;
-    application_name_ = "Default";
-    return;
-  }
-  
-  // Clear cache when switching applications
-  if (application_name_ != sanitized_name && !state_cache_.empty()) {
-    std::cout << "[AnyWP] [State] Switching from '" << application_name_ 
-              << "' to '" << sanitized_name << "', clearing cache" << std::endl;
-    state_cache_.clear();
+    ANYWP_LOG_WARNING(kLogComponent, name.empty() ? "Empty application name, using 'Default'"
+                                                  : "Invalid application name, using 'Default'");
+    sanitized_name = "Default";
+  }
+  
+  // Close the previous application's store (and drop its cached values)
+  // when switching
+  if (application_name_ != sanitized_name) {
+    if (journal_ || mapped_) {
+      ANYWP_LOG_INFO(kLogComponent, "Switching from '" + application_name_ + "' to '" +
+                     sanitized_name + "', closing its store");
+      journal_.reset();
+      mapped_.reset();
+    }
+    cache_.Clear();
   }
   
   application_name_ = sanitized_name;
-  std::cout << "[AnyWP] [State] Application name set to: " << application_name_ << std::endl;
+  ANYWP_LOG_INFO(kLogComponent, "Application name set to: " + application_name_);
 }
 
 std::string StatePersistence::GetApplicationName() const {
@@ -70,26 +97,33 @@ std::string StatePersistence::GetStoragePath() const {
 
 // ========== State Operations ==========
 
-bool StatePersistence::SaveState(const std::string& key, const std::string& value) {
+bool StatePersistence::SaveState(const std::string& key, const std::string& value,
+                                 Durability durability) {
   std::lock_guard<std::mutex> lock(mutex_);
   
   try {
-    // Update in-memory cache
-    state_cache_[key] = value;
-    
-    // Save to file
-    bool success = SaveStateFile(state_cache_);
+    bool success = false;
+    if (backend_ == Backend::MAPPED_HASH) {
+      // Already in the page cache once written; SYNC also waits for the disk
+      MappedStateStorage* mapped = Mapped();
+      success = mapped && mapped->SaveState(key, value) &&
+                (durability != Durability::SYNC || mapped->Flush());
+    } else {
+      StateJournal* journal = Journal();
+      success = journal && journal->Put(key, value, durability);
+    }
     
     if (success) {
-      std::cout << "[AnyWP] [State] Saved to file (" << application_name_ 
-                << "): " << key << " = " << value << std::endl;
+      cache_.Put(key, value);
+      ANYWP_LOG_DEBUG(kLogComponent, "Saved (" + application_name_ + "): " +
+                      LogPayload(key, kKeyPreview) + " = " + LogDigest(value));
     } else {
-      std::cout << "[AnyWP] [State] ERROR: Failed to save state to file" << std::endl;
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to save state to file");
     }
     
     return success;
   } catch (const std::exception& e) {
-    std::cout << "[AnyWP] [State] ERROR: Exception in SaveState: " << e.what() << std::endl;
+    ANYWP_LOG_ERROR(kLogComponent, std::string("Exception in SaveState: ") + e.what());
     return false;
   }
 }
@@ -97,32 +131,33 @@ bool StatePersistence::SaveState(const std::string& key, const std::string& valu
 std::string StatePersistence::LoadState(const std::string& key) {
   std::lock_guard<std::mutex> lock(mutex_);
   
-  // Check cache first
-  auto it = state_cache_.find(key);
-  if (it != state_cache_.end()) {
-    std::cout << "[AnyWP] [State] Loaded from cache (" << application_name_ 
-              << "): " << key << " = " << it->second << std::endl;
-    return it->second;
+  std::string value;
+  if (cache_.Get(key, value)) {
+    return value;
   }
   
-  // Load all state from file if cache is empty
-  if (state_cache_.empty()) {
-    try {
-      state_cache_ = LoadStateFile();
-    } catch (const std::exception& e) {
-      std::cout << "[AnyWP] [State] ERROR: Exception in LoadStateFile: " << e.what() << std::endl;
+  try {
+    // Miss: read just this key from disk
+    bool found = false;
+    if (backend_ == Backend::MAPPED_HASH) {
+      MappedStateStorage* mapped = Mapped();
+      found = mapped && mapped->LoadState(key, value);
+    } else {
+      StateJournal* journal = Journal();
+      found = journal && journal->Get(key, value);
     }
+    if (found) {
+      cache_.Put(key, value);
+      ANYWP_LOG_DEBUG(kLogComponent, "Loaded (" + application_name_ + "): " +
+                      LogPayload(key, kKeyPreview) + " = " + LogDigest(value));
+      return value;
+    }
+  } catch (const std::exception& e) {
+    ANYWP_LOG_ERROR(kLogComponent, std::string("Exception in LoadState: ") + e.what());
   }
   
-  // Check cache again after loading
-  it = state_cache_.find(key);
-  if (it != state_cache_.end()) {
-    std::cout << "[AnyWP] [State] Loaded from file (" << application_name_ 
-              << "): " << key << " = " << it->second << std::endl;
-    return it->second;
-  }
-  
-  std::cout << "[AnyWP] [State] Key not found (" << application_name_ << "): " << key << std::endl;
+  ANYWP_LOG_DEBUG(kLogComponent, "Key not found (" + application_name_ + "): " +
+                  LogPayload(key, kKeyPreview));
   return "";
 }
 
@@ -130,29 +165,40 @@ bool StatePersistence::ClearState() {
   std::lock_guard<std::mutex> lock(mutex_);
   
   try {
-    // Clear in-memory cache
-    state_cache_.clear();
-    
-    // Delete state file
-    std::string app_data = GetAppDataPath();
-    if (app_data.empty()) {
-      std::cout << "[AnyWP] [State] ERROR: Failed to get app data path" << std::endl;
+    if (backend_ == Backend::MAPPED_HASH) {
+      MappedStateStorage* mapped = Mapped();
+      if (!mapped) {
+        return false;
+      }
+      cache_.Clear();
+      StateJournal::Remove(mapped->GetStoragePath());
+      if (!mapped->ClearAllState() || !mapped->SaveState(kFormatKey, kFormatVersion)) {
+        ANYWP_LOG_ERROR(kLogComponent, "Failed to clear state in: " + mapped->GetStoragePath());
+        return false;
+      }
+      ANYWP_LOG_INFO(kLogComponent, "Cleared all state (" + application_name_ + ")");
+      return true;
+    }
+
+    StateJournal* journal = Journal();
+    if (!journal) {
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to get app data path");
       return false;
     }
     
-    std::string state_file = app_data + "\\state.json";
-    
-    // Delete file if exists
-    if (DeleteFileA(state_file.c_str()) || GetLastError() == ERROR_FILE_NOT_FOUND) {
-      std::cout << "[AnyWP] [State] Cleared all state (" << application_name_ 
-                << ") (deleted file: " << state_file << ")" << std::endl;
+    cache_.Clear();
+    // The next switch would migrate a leftover state.map back in
+    StateHashFile::Remove(journal->GetDirectory());
+    if (journal->Clear() && journal->Put(kFormatKey, kFormatVersion)) {
+      ANYWP_LOG_INFO(kLogComponent, "Cleared all state (" + application_name_ +
+                     ") (deleted files in: " + journal->GetDirectory() + ")");
       return true;
     } else {
-      std::cout << "[AnyWP] [State] ERROR: Failed to delete state file: " << GetLastError() << std::endl;
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to delete state files in: " + journal->GetDirectory());
       return false;
     }
   } catch (const std::exception& e) {
-    std::cout << "[AnyWP] [State] ERROR: Exception in ClearState: " << e.what() << std::endl;
+    ANYWP_LOG_ERROR(kLogComponent, std::string("Exception in ClearState: ") + e.what());
     return false;
   }
 }
@@ -160,27 +206,92 @@ bool StatePersistence::ClearState() {
 std::map<std::string, std::string> StatePersistence::LoadAllStates() {
   std::lock_guard<std::mutex> lock(mutex_);
   
-  if (state_cache_.empty()) {
-    try {
-      state_cache_ = LoadStateFile();
-    } catch (const std::exception& e) {
-      std::cout << "[AnyWP] [State] ERROR: Exception in LoadAllStates: " << e.what() << std::endl;
+  try {
+    std::map<std::string, std::string> states;
+    if (backend_ == Backend::MAPPED_HASH) {
+      if (MappedStateStorage* mapped = Mapped()) {
+        states = mapped->LoadAllStates();
+      }
+    } else if (StateJournal* journal = Journal()) {
+      states = journal->GetAll();
     }
+    states.erase(kFormatKey);
+    return states;
+  } catch (const std::exception& e) {
+    ANYWP_LOG_ERROR(kLogComponent, std::string("Exception in LoadAllStates: ") + e.what());
   }
-  
-  return state_cache_;
+  return {};
 }
 
 bool StatePersistence::SaveAllStates(const std::map<std::string, std::string>& states) {
   std::lock_guard<std::mutex> lock(mutex_);
   
-  state_cache_ = states;
-  return SaveStateFile(state_cache_);
+  cache_.Clear();
+  std::map<std::string, std::string> tagged = states;
+  tagged[kFormatKey] = kFormatVersion;
+  if (backend_ == Backend::MAPPED_HASH) {
+    MappedStateStorage* mapped = Mapped();
+    return mapped && mapped->ReplaceAllStates(tagged);
+  }
+  StateJournal* journal = Journal();
+  return journal && journal->Replace(tagged);
+}
+
+bool StatePersistence::SetBackend(Backend backend) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (backend != backend_) {
+    // Closing flushes whatever the old store still holds in memory
+    journal_.reset();
+    mapped_.reset();
+    cache_.Clear();
+    backend_ = backend;
+    ANYWP_LOG_INFO(kLogComponent, std::string("Storage backend set to: ") +
+                   (backend == Backend::MAPPED_HASH ? "mapped hash file" : "journal"));
+  }
+  
+  // Open now (migrating the other backend's files) so the caller learns
+  // whether the switch worked
+  try {
+    return backend == Backend::MAPPED_HASH ? Mapped() != nullptr : Journal() != nullptr;
+  } catch (const std::exception& e) {
+    ANYWP_LOG_ERROR(kLogComponent, std::string("Exception in SetBackend: ") + e.what());
+    return false;
+  }
+}
+
+StatePersistence::Backend StatePersistence::GetBackend() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return backend_;
+}
+
+void StatePersistence::ConfigureCache(const StateCache::Options& options) {
+  cache_.SetOptions(options);
+}
+
+StateCache::Stats StatePersistence::GetCacheStats() const {
+  return cache_.GetStats();
+}
+
+bool StatePersistence::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  
+  // Nothing was written if the store was never opened
+  bool success = true;
+  if (journal_) {
+    success = journal_->Flush();
+  } else if (mapped_) {
+    success = mapped_->Flush();
+  }
+  if (!success) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to flush state (" + application_name_ + ")");
+    return false;
+  }
+  return true;
 }
 
 // ========== Internal Helpers ==========
 
-std::string StatePersistence::GetAppDataPath() const {
+std::string StatePersistence::GetStorageRoot() const {
   wchar_t* path = nullptr;
   HRESULT hr = SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &path);
   
@@ -191,198 +302,104 @@ std::string StatePersistence::GetAppDataPath() const {
     WideCharToMultiByte(CP_UTF8, 0, path, -1, &result[0], size_needed, nullptr, nullptr);
     CoTaskMemFree(path);
     
-    // Append AnyWPEngine directory and app-specific subdirectory
-    // Path: %LOCALAPPDATA%\AnyWPEngine\[AppName]
-    result += "\\AnyWPEngine\\" + application_name_;
+    // Path: %LOCALAPPDATA%\AnyWPEngine
+    result += "\\AnyWPEngine";
     return result;
   }
   
   return "";
 }
 
-bool StatePersistence::EnsureDirectoryExists(const std::string& path) {
-  struct stat info;
-  if (stat(path.c_str(), &info) != 0) {
-    // Directory doesn't exist, create it (including parent directories)
-    // First create parent directory
-    size_t pos = path.find_last_of("\\/");
-    if (pos != std::string::npos) {
-      std::string parent = path.substr(0, pos);
-      if (!EnsureDirectoryExists(parent)) {
-        return false;
-      }
-    }
-    return _mkdir(path.c_str()) == 0;
-  }
-  return (info.st_mode & S_IFDIR) != 0;
-}
-
-// ========== JSON Helpers ==========
-
-std::string StatePersistence::EscapeJson(const std::string& str) {
-  std::string result;
-  result.reserve(str.size());
-  
-  for (char c : str) {
-    switch (c) {
-      case '"':  result += "\\\""; break;
-      case '\\': result += "\\\\"; break;
-      case '\b': result += "\\b"; break;
-      case '\f': result += "\\f"; break;
-      case '\n': result += "\\n"; break;
-      case '\r': result += "\\r"; break;
-      case '\t': result += "\\t"; break;
-      default:
-        if (c < 0x20) {
-          // Control character - encode as \uXXXX
-          char buf[7];
-          sprintf_s(buf, "\\u%04x", static_cast<unsigned char>(c));
-          result += buf;
-        } else {
-          result += c;
-        }
-    }
-  }
-  
-  return result;
+std::string StatePersistence::GetAppDataPath() const {
+  // Path: %LOCALAPPDATA%\AnyWPEngine\[AppName]
+  std::string root = GetStorageRoot();
+  return root.empty() ? root : root + "\\" + application_name_;
 }
 
-std::string StatePersistence::UnescapeJson(const std::string& str) {
-  std::string result;
-  result.reserve(str.size());
-  
-  for (size_t i = 0; i < str.size(); ++i) {
-    if (str[i] == '\\' && i + 1 < str.size()) {
-      switch (str[i + 1]) {
-        case '"':  result += '"'; i++; break;
-        case '\\': result += '\\'; i++; break;
-        case 'b':  result += '\b'; i++; break;
-        case 'f':  result += '\f'; i++; break;
-        case 'n':  result += '\n'; i++; break;
-        case 'r':  result += '\r'; i++; break;
-        case 't':  result += '\t'; i++; break;
-        case 'u':  // Unicode escape sequence
-          if (i + 5 < str.size()) {
-            // Simple implementation - just skip it for now
-            i += 5;
-          }
-          break;
-        default:
-          result += str[i];
-      }
-    } else {
-      result += str[i];
-    }
+StateJournal* StatePersistence::Journal() {
+  if (journal_) {
+    return journal_.get();
   }
   
-  return result;
-}
-
-// ========== File I/O ==========
-
-std::map<std::string, std::string> StatePersistence::LoadStateFile() {
-  std::map<std::string, std::string> state;
-  
   std::string app_data = GetAppDataPath();
   if (app_data.empty()) {
-    std::cout << "[AnyWP] [State] ERROR: Failed to get app data path" << std::endl;
-    return state;
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to get app data path");
+    return nullptr;
   }
   
-  std::string state_file = app_data + "\\state.json";
-  std::ifstream file(state_file);
-  
-  if (!file.is_open()) {
-    std::cout << "[AnyWP] [State] State file not found (first run): " << state_file << std::endl;
-    return state;
+  auto journal = std::make_unique<StateJournal>(app_data);
+  if (!journal->Open()) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to open state store: " + app_data);
+    return nullptr;
   }
-  
-  // Read entire file
-  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-  file.close();
-  
-  if (content.empty() || content == "{}") {
-    return state;
+  if (StateHashFile::Exists(app_data) && !MigrateFromMapped(*journal)) {
+    return nullptr;
   }
-  
-  // Simple JSON parser for key-value pairs
-  // Format: {"key1": "value1", "key2": "value2"}
-  size_t pos = 0;
-  while (pos < content.size()) {
-    // Find key start
-    size_t key_start = content.find('"', pos);
-    if (key_start == std::string::npos) break;
-    key_start++;
-    
-    // Find key end
-    size_t key_end = content.find('"', key_start);
-    if (key_end == std::string::npos) break;
-    
-    std::string key = content.substr(key_start, key_end - key_start);
-    
-    // Find value start
-    size_t value_start = content.find('"', key_end + 1);
-    if (value_start == std::string::npos) break;
-    value_start++;
-    
-    // Find value end (handle escaped quotes)
-    size_t value_end = value_start;
-    while (value_end < content.size()) {
-      if (content[value_end] == '"' && (value_end == 0 || content[value_end - 1] != '\\')) {
-        break;
-      }
-      value_end++;
+  if (!journal->Contains(kFormatKey)) {
+    std::map<std::string, std::string> state = journal->GetAll();
+    UpgradeFormat(state);
+    if (!journal->Replace(state)) {
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to upgrade state format in: " + app_data);
+      return nullptr;
     }
-    
-    if (value_end == std::string::npos) break;
-    
-    std::string value = content.substr(value_start, value_end - value_start);
-    value = UnescapeJson(value);
-    
-    state[key] = value;
-    pos = value_end + 1;
   }
-  
-  std::cout << "[AnyWP] [State] Loaded " << state.size() << " entries from file" << std::endl;
-  return state;
+  journal_ = std::move(journal);
+  return journal_.get();
 }
 
-bool StatePersistence::SaveStateFile(const std::map<std::string, std::string>& state) {
-  std::string app_data = GetAppDataPath();
-  if (app_data.empty()) {
-    std::cout << "[AnyWP] [State] ERROR: Failed to get app data path" << std::endl;
-    return false;
+bool StatePersistence::MigrateFromMapped(StateJournal& journal) {
+  // A state.map is newer than the journal: MappedStateStorage deleted the
+  // journal's files when it migrated them
+  const std::string& directory = journal.GetDirectory();
+  std::map<std::string, std::string> state;
+  {
+    StateHashFile file(directory);
+    if (!file.Open()) {
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to read state to migrate in: " + directory);
+      return false;
+    }
+    state = file.GetAll();
   }
-  
-  // Ensure directory exists
-  if (!EnsureDirectoryExists(app_data)) {
-    std::cout << "[AnyWP] [State] ERROR: Failed to create directory: " << app_data << std::endl;
+  if (!journal.Replace(state)) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to migrate state in: " + directory);
     return false;
   }
-  
-  std::string state_file = app_data + "\\state.json";
-  std::ofstream file(state_file);
-  
-  if (!file.is_open()) {
-    std::cout << "[AnyWP] [State] ERROR: Failed to open file: " << state_file << std::endl;
+  if (!StateHashFile::Remove(directory)) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to delete migrated state.map in: " + directory);
     return false;
   }
-  
-  // Write JSON
-  file << "{\n";
-  
-  size_t count = 0;
-  for (const auto& pair : state) {
-    if (count > 0) file << ",\n";
-    file << "  \"" << EscapeJson(pair.first) << "\": \"" << EscapeJson(pair.second) << "\"";
-    count++;
+  ANYWP_LOG_INFO(kLogComponent, "Migrated " + std::to_string(state.size()) +
+                 " keys from state.map to state.json in: " + directory);
+  return true;
+}
+
+MappedStateStorage* StatePersistence::Mapped() {
+  if (mapped_) {
+    return mapped_.get();
   }
   
-  file << "\n}\n";
-  file.close();
+  std::string root = GetStorageRoot();
+  if (root.empty()) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to get app data path");
+    return nullptr;
+  }
   
-  std::cout << "[AnyWP] [State] Saved " << state.size() << " entries to file: " << state_file << std::endl;
-  return true;
+  auto mapped = std::make_unique<MappedStateStorage>(root);
+  if (!mapped->SetApplicationName(application_name_)) {
+    ANYWP_LOG_ERROR(kLogComponent, "Failed to open state store: " + mapped->GetStoragePath());
+    return nullptr;
+  }
+  if (!mapped->HasState(kFormatKey)) {
+    std::map<std::string, std::string> state = mapped->LoadAllStates();
+    UpgradeFormat(state);
+    if (!mapped->ReplaceAllStates(state)) {
+      ANYWP_LOG_ERROR(kLogComponent, "Failed to upgrade state format in: " +
+                      mapped->GetStoragePath());
+      return nullptr;
+    }
+  }
+  mapped_ = std::move(mapped);
+  return mapped_.get();
 }
 
 // ========== v1.4.1+ Phase B: Standalone utility functions ==========
@@ -492,59 +509,11 @@ std::map<std::string, std::string> LoadStateFileForApp(const std::string& app_na
     return state;
   }
   
-  std::string state_file = app_data + "\\state.json";
-  std::ifstream file(state_file);
-  
-  if (!file.is_open()) {
-    Logger::Instance().Info("StatePersistence", "State file not found (first run): " + state_file);
-    return state;
-  }
-  
-  // Read entire file
-  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-  file.close();
-  
-  if (content.empty() || content == "{}") {
+  if (!StateJournal::Read(app_data, state)) {
+    Logger::Instance().Error("StatePersistence", "Failed to read state in: " + app_data);
     return state;
   }
-  
-  // Simple JSON parser for key-value pairs
-  // Format: {"key1": "value1", "key2": "value2"}
-  size_t pos = 0;
-  while (pos < content.size()) {
-    // Find key start
-    size_t key_start = content.find('"', pos);
-    if (key_start == std::string::npos) break;
-    key_start++;
-    
-    // Find key end
-    size_t key_end = content.find('"', key_start);
-    if (key_end == std::string::npos) break;
-    
-    std::string key = content.substr(key_start, key_end - key_start);
-    
-    // Find value start
-    size_t value_start = content.find('"', key_end + 1);
-    if (value_start == std::string::npos) break;
-    value_start++;
-    
-    // Find value end (handle escaped quotes)
-    size_t value_end = value_start;
-    while (value_end < content.size()) {
-      if (content[value_end] == '"' && (value_end == 0 || content[value_end - 1] != '\\')) {
-        break;
-      }
-      value_end++;
-    }
-    
-    if (value_end == std::string::npos) break;
-    
-    std::string value = content.substr(value_start, value_end - value_start);
-    value = UnescapeJsonString(value);
-    
-    state[key] = value;
-    pos = value_end + 1;
-  }
+  state.erase(kFormatKey);
   
   Logger::Instance().Info("StatePersistence", "Loaded " + std::to_string(state.size()) + " entries from file");
   return state;
@@ -557,34 +526,15 @@ bool SaveStateFileForApp(const std::map<std::string, std::string>& state, const
     return false;
   }
   
-  // Ensure directory exists
-  if (!EnsureDirectoryExistsUtil(app_data)) {
-    Logger::Instance().Error("StatePersistence", "Failed to create directory: " + app_data);
-    return false;
-  }
-  
-  std::string state_file = app_data + "\\state.json";
-  std::ofstream file(state_file);
-  
-  if (!file.is_open()) {
-    Logger::Instance().Error("StatePersistence", "Failed to open file: " + state_file);
+  std::map<std::string, std::string> tagged = state;
+  tagged[kFormatKey] = kFormatVersion;
+  StateJournal journal(app_data);
+  if (!journal.Open() || !journal.Replace(tagged)) {
+    Logger::Instance().Error("StatePersistence", "Failed to save state in: " + app_data);
     return false;
   }
   
-  // Write JSON
-  file << "{\n";
-  
-  size_t count = 0;
-  for (const auto& pair : state) {
-    if (count > 0) file << ",\n";
-    file << "  \"" << EscapeJsonString(pair.first) << "\": \"" << EscapeJsonString(pair.second) << "\"";
-    count++;
-  }
-  
-  file << "\n}\n";
-  file.close();
-  
-  Logger::Instance().Info("StatePersistence", "Saved " + std::to_string(state.size()) + " entries to file: " + state_file);
+  Logger::Instance().Info("StatePersistence", "Saved " + std::to_string(state.size()) + " entries to: " + app_data);
   return true;
 }
 
@@ -3,23 +3,47 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <mutex>
 
+#include "mapped_state_storage.h"
+#include "state_cache.h"
+#include "state_journal.h"
+
 namespace anywp_engine {
 
 /**
  * StatePersistence - Application-level state storage with isolation
  * 
  * Features:
- * - Key-value storage persisted to JSON file
+ * - Key-value storage persisted to a JSON snapshot plus an append-only
+ *   journal (see StateJournal): SaveState() appends one record instead of
+ *   rewriting the whole file
+ * - Values are read from disk one key at a time and kept in a byte-budgeted
+ *   LRU cache (see StateCache); memory does not grow with the store
+ * - Write-behind by default: SaveState() returns once the value is in memory
+ *   and a background flush appends it shortly after; callers that need the
+ *   write on disk first pass Durability::SYNC, and Flush() forces the rest
+ * - Two storage backends, switchable at runtime (SetBackend()): the JSON
+ *   journal above, or a memory-mapped hash file (see MappedStateStorage)
+ *   that opens without parsing. Opening either one migrates the other's
+ *   files into it and deletes them, so the state follows every switch
  * - Application-level isolation (each app has separate storage)
  * - Thread-safe operations
  * - Automatic directory creation
  * 
- * Storage Path: %LOCALAPPDATA%\AnyWPEngine\[AppName]\state.json
+ * Storage Path: %LOCALAPPDATA%\AnyWPEngine\[AppName]\state.json (+ state.journal)
+ *               or ...\[AppName]\state.map with Backend::MAPPED_HASH
  */
 class StatePersistence {
 public:
+  using Durability = StateJournal::Durability;
+
+  enum class Backend {
+    JOURNAL,     // state.json + state.journal (default)
+    MAPPED_HASH  // state.map
+  };
+
   StatePersistence();
   ~StatePersistence();
 
@@ -29,7 +53,8 @@ public:
   std::string GetStoragePath() const;
 
   // State operations
-  bool SaveState(const std::string& key, const std::string& value);
+  bool SaveState(const std::string& key, const std::string& value,
+                 Durability durability = Durability::ASYNC);
   std::string LoadState(const std::string& key);
   bool ClearState();
   
@@ -37,22 +62,38 @@ public:
   std::map<std::string, std::string> LoadAllStates();
   bool SaveAllStates(const std::map<std::string, std::string>& states);
 
+  // Write pending saves to disk and fsync; call before the process may die
+  // (shutdown, session lock, suspend)
+  bool Flush();
+
+  // Flush and close the current store and open (migrating into) the one
+  // for `backend`; false if it cannot be opened
+  bool SetBackend(Backend backend);
+  Backend GetBackend() const;
+
+  // Cache budget and TTL; hit/miss/eviction counters for diagnostics
+  void ConfigureCache(const StateCache::Options& options);
+  StateCache::Stats GetCacheStats() const;
+
 private:
   // Internal helpers
+  std::string GetStorageRoot() const;  // %LOCALAPPDATA%\AnyWPEngine
   std::string GetAppDataPath() const;
-  bool EnsureDirectoryExists(const std::string& path);
-  
-  // JSON helpers
-  std::string EscapeJson(const std::string& str);
-  std::string UnescapeJson(const std::string& str);
   
-  // File I/O
-  std::map<std::string, std::string> LoadStateFile();
-  bool SaveStateFile(const std::map<std::string, std::string>& state);
+  // The current application's store, opened on first use; nullptr if the
+  // app data directory is unavailable. Only the one for backend_ is used.
+  StateJournal* Journal();        // Requires mutex_
+  MappedStateStorage* Mapped();  // Requires mutex_
+  // Replace the just-opened journal's state with the application's
+  // state.map, then delete state.map
+  bool MigrateFromMapped(StateJournal& journal);
 
   // State management
   std::string application_name_;
-  std::map<std::string, std::string> state_cache_;
+  Backend backend_ = Backend::JOURNAL;
+  std::unique_ptr<StateJournal> journal_;
+  std::unique_ptr<MappedStateStorage> mapped_;
+  StateCache cache_;  // Internally locked: GetCacheStats() needs no mutex_
   mutable std::mutex mutex_;
 };
 
@@ -69,7 +110,7 @@ bool EnsureDirectoryExistsUtil(const std::string& path);
 std::string EscapeJsonString(const std::string& str);
 std::string UnescapeJsonString(const std::string& str);
 
-// Load/save entire state file
+// Load/save entire state file (snapshot plus journal)
 std::map<std::string, std::string> LoadStateFileForApp(const std::string& app_name);
 bool SaveStateFileForApp(const std::map<std::string, std::string>& state, const std::string& app_name);
 
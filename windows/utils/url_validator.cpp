@@ -1,11 +1,18 @@
 #include "url_validator.h"
+#include "logger.h"
+#include "log_payload.h"
 
 #include <algorithm>
 #include <cctype>
-#include <iostream>
 
 namespace anywp_engine {
 
+namespace {
+
+constexpr const char* kLogComponent = "Security";
+
+}  // namespace
+
 URLValidator::URLValidator() {
 }
 
@@ -31,13 +38,13 @@ bool URLValidator::IsAllowed(const std::string& url) {
   // Check blacklist (overrides whitelist)
   for (const auto& pattern : blacklist_) {
     if (MatchesPattern(url, pattern)) {
-      std::cout << "[AnyWP] [Security] URL blocked by blacklist: " << url << std::endl;
+      ANYWP_LOG_WARNING(kLogComponent, "URL blocked by blacklist: " + LogPayload(url));
       return false;
     }
   }
   
   if (!allowed && !whitelist_.empty()) {
-    std::cout << "[AnyWP] [Security] URL not in whitelist: " << url << std::endl;
+    ANYWP_LOG_WARNING(kLogComponent, "URL not in whitelist: " + LogPayload(url));
   }
   
   return allowed;
@@ -47,12 +54,12 @@ bool URLValidator::IsAllowed(const std::string& url) {
 
 void URLValidator::AddWhitelist(const std::string& pattern) {
   whitelist_.push_back(pattern);
-  std::cout << "[AnyWP] [Security] Added to whitelist: " << pattern << std::endl;
+  ANYWP_LOG_INFO(kLogComponent, "Added to whitelist: " + pattern);
 }
 
 void URLValidator::ClearWhitelist() {
   whitelist_.clear();
-  std::cout << "[AnyWP] [Security] Whitelist cleared" << std::endl;
+  ANYWP_LOG_INFO(kLogComponent, "Whitelist cleared");
 }
 
 const std::vector<std::string>& URLValidator::GetWhitelist() const {
@@ -63,12 +70,12 @@ const std::vector<std::string>& URLValidator::GetWhitelist() const {
 
 void URLValidator::AddBlacklist(const std::string& pattern) {
   blacklist_.push_back(pattern);
-  std::cout << "[AnyWP] [Security] Added to blacklist: " << pattern << std::endl;
+  ANYWP_LOG_INFO(kLogComponent, "Added to blacklist: " + pattern);
 }
 
 void URLValidator::ClearBlacklist() {
   blacklist_.clear();
-  std::cout << "[AnyWP] [Security] Blacklist cleared" << std::endl;
+  ANYWP_LOG_INFO(kLogComponent, "Blacklist cleared");
 }
 
 const std::vector<std::string>& URLValidator::GetBlacklist() const {